@@ -463,6 +463,20 @@ struct TextureComponentMapping
   TextureComponentMapping(const TextureComponentMapping &) = default;
   TextureComponentMapping &operator=(const TextureComponentMapping &) = default;
 
+  DOCUMENT("");
+  bool operator==(const TextureComponentMapping &o) const
+  {
+    return blackPoint == o.blackPoint && whitePoint == o.whitePoint;
+  }
+  bool operator<(const TextureComponentMapping &o) const
+  {
+    if(!(blackPoint == o.blackPoint))
+      return blackPoint < o.blackPoint;
+    if(!(whitePoint == o.whitePoint))
+      return whitePoint < o.whitePoint;
+    return false;
+  }
+
   DOCUMENT("The value that should be mapped to ``0``");
   float blackPoint = 0.0f;
   DOCUMENT("The value that should be mapped to ``255``");
@@ -484,6 +498,20 @@ struct TextureSampleMapping
   TextureSampleMapping(const TextureSampleMapping &) = default;
   TextureSampleMapping &operator=(const TextureSampleMapping &) = default;
 
+  DOCUMENT("");
+  bool operator==(const TextureSampleMapping &o) const
+  {
+    return mapToArray == o.mapToArray && sampleIndex == o.sampleIndex;
+  }
+  bool operator<(const TextureSampleMapping &o) const
+  {
+    if(!(mapToArray == o.mapToArray))
+      return mapToArray < o.mapToArray;
+    if(!(sampleIndex == o.sampleIndex))
+      return sampleIndex < o.sampleIndex;
+    return false;
+  }
+
   DOCUMENT(R"(
 ``True`` if the samples should be mapped to array slices. A multisampled array expands each slice
 in-place, so it would be slice 0: sample 0, slice 0: sample 1, slice 1: sample 0, etc.
@@ -516,6 +544,25 @@ struct TextureSliceMapping
   TextureSliceMapping(const TextureSliceMapping &) = default;
   TextureSliceMapping &operator=(const TextureSliceMapping &) = default;
 
+  DOCUMENT("");
+  bool operator==(const TextureSliceMapping &o) const
+  {
+    return sliceIndex == o.sliceIndex && slicesAsGrid == o.slicesAsGrid &&
+           sliceGridWidth == o.sliceGridWidth && cubeCruciform == o.cubeCruciform;
+  }
+  bool operator<(const TextureSliceMapping &o) const
+  {
+    if(!(sliceIndex == o.sliceIndex))
+      return sliceIndex < o.sliceIndex;
+    if(!(slicesAsGrid == o.slicesAsGrid))
+      return slicesAsGrid < o.slicesAsGrid;
+    if(!(sliceGridWidth == o.sliceGridWidth))
+      return sliceGridWidth < o.sliceGridWidth;
+    if(!(cubeCruciform == o.cubeCruciform))
+      return cubeCruciform < o.cubeCruciform;
+    return false;
+  }
+
   DOCUMENT(R"(
 Selects the (depth/array) slice to save.
 
@@ -563,6 +610,41 @@ struct TextureSave
   TextureSave(const TextureSave &) = default;
   TextureSave &operator=(const TextureSave &) = default;
 
+  DOCUMENT("");
+  bool operator==(const TextureSave &o) const
+  {
+    return resourceId == o.resourceId && typeCast == o.typeCast && destType == o.destType &&
+           mip == o.mip && comp == o.comp && sample == o.sample && slice == o.slice &&
+           channelExtract == o.channelExtract && alpha == o.alpha && alphaCol == o.alphaCol &&
+           jpegQuality == o.jpegQuality;
+  }
+  bool operator<(const TextureSave &o) const
+  {
+    if(!(resourceId == o.resourceId))
+      return resourceId < o.resourceId;
+    if(!(typeCast == o.typeCast))
+      return typeCast < o.typeCast;
+    if(!(destType == o.destType))
+      return destType < o.destType;
+    if(!(mip == o.mip))
+      return mip < o.mip;
+    if(!(comp == o.comp))
+      return comp < o.comp;
+    if(!(sample == o.sample))
+      return sample < o.sample;
+    if(!(slice == o.slice))
+      return slice < o.slice;
+    if(!(channelExtract == o.channelExtract))
+      return channelExtract < o.channelExtract;
+    if(!(alpha == o.alpha))
+      return alpha < o.alpha;
+    if(!(alphaCol == o.alphaCol))
+      return alphaCol < o.alphaCol;
+    if(!(jpegQuality == o.jpegQuality))
+      return jpegQuality < o.jpegQuality;
+    return false;
+  }
+
   DOCUMENT("The :class:`ResourceId` of the texture to save.");
   ResourceId resourceId;
 
@@ -199,10 +199,12 @@ struct ResourceFormat
   ResourceFormat(const ResourceFormat &) = default;
   ResourceFormat &operator=(const ResourceFormat &) = default;
 
+  // the block footprint is informational, only some APIs and formats report it, so it isn't
+  // compared. Otherwise the same format read from different sources may not compare equal
   bool operator==(const ResourceFormat &r) const
   {
     return type == r.type && compCount == r.compCount && compByteWidth == r.compByteWidth &&
-           compType == r.compType && flags == r.flags;
+           compType == r.compType && ComparedFlags() == r.ComparedFlags();
   }
   bool operator<(const ResourceFormat &r) const
   {
@@ -214,8 +216,8 @@ struct ResourceFormat
       return compByteWidth < r.compByteWidth;
     if(compType != r.compType)
       return compType < r.compType;
-    if(flags != r.flags)
-      return flags < r.flags;
+    if(ComparedFlags() != r.ComparedFlags())
+      return ComparedFlags() < r.ComparedFlags();
     return false;
   }
 
@@ -332,6 +334,52 @@ Invalid values will result in 1 being set.
       flags |= ResourceFormat_3Planes;
   }
 
+  DOCUMENT(R"(Get the width in texels of a block, for block-compressed formats where the block
+size varies such as :attr:`ResourceFormatType.ASTC`.
+
+If the block size is not known, or the format doesn't have a variable block size, 0 is returned.
+
+:return: The width of a block in texels.
+:rtype: int
+)");
+  uint32_t BlockWidth() const { return BlockFootprint(0); }
+  DOCUMENT(R"(Get the height in texels of a block. See :meth:`BlockWidth`.
+
+:return: The height of a block in texels.
+:rtype: int
+)");
+  uint32_t BlockHeight() const { return BlockFootprint(1); }
+  DOCUMENT(R"(Get the depth in texels of a block. See :meth:`BlockWidth`.
+
+This will be 1 for formats with two-dimensional blocks, when the block size is known.
+
+:return: The depth of a block in texels.
+:rtype: int
+)");
+  uint32_t BlockDepth() const { return BlockFootprint(2); }
+  DOCUMENT(R"(Set the block footprint of a variable block size format. See :meth:`BlockWidth`.
+
+Only the footprints valid for :attr:`ResourceFormatType.ASTC` and :attr:`ResourceFormatType.PVRTC`
+can be stored, other values will result in an unknown footprint being set.
+
+:param int width: The width of a block in texels.
+:param int height: The height of a block in texels.
+:param int depth: The depth of a block in texels.
+)");
+  void SetBlockFootprint(uint32_t width, uint32_t height, uint32_t depth)
+  {
+    flags &= ~ResourceFormat_Footprint_Mask;
+    for(uint16_t i = 1; i < ResourceFormat_Footprint_Count; i++)
+    {
+      const uint8_t *fp = GetFootprint(i);
+      if(fp[0] == width && fp[1] == height && fp[2] == depth)
+      {
+        flags |= (i << ResourceFormat_Footprint_Shift);
+        break;
+      }
+    }
+  }
+
   DOCUMENT(R"(:return: ``True`` if the ``ResourceFormat`` is a block-compressed type.
 :rtype: bool
 )");
@@ -446,9 +494,60 @@ private:
     ResourceFormat_2Planes = 0x020,
     ResourceFormat_3Planes = 0x040,
     ResourceFormat_Planes_Mask = 0x060,
+
+    ResourceFormat_Footprint_Shift = 7,
+    ResourceFormat_Footprint_Mask = 0xF80,
   };
   uint16_t flags;
 
+  enum
+  {
+    ResourceFormat_Footprint_Count = 26,
+  };
+
+  // the footprint is stored as an index into this table, with 0 meaning unknown
+  static const uint8_t *GetFootprint(uint32_t idx)
+  {
+    static const uint8_t footprints[ResourceFormat_Footprint_Count][3] = {
+        {0, 0, 0},
+        // ASTC 2D
+        {4, 4, 1},
+        {5, 4, 1},
+        {5, 5, 1},
+        {6, 5, 1},
+        {6, 6, 1},
+        {8, 5, 1},
+        {8, 6, 1},
+        {8, 8, 1},
+        {10, 5, 1},
+        {10, 6, 1},
+        {10, 8, 1},
+        {10, 10, 1},
+        {12, 10, 1},
+        {12, 12, 1},
+        // ASTC 3D
+        {3, 3, 3},
+        {4, 3, 3},
+        {4, 4, 3},
+        {4, 4, 4},
+        {5, 4, 4},
+        {5, 5, 4},
+        {5, 5, 5},
+        {6, 5, 5},
+        {6, 6, 5},
+        {6, 6, 6},
+        // PVRTC 2bpp. 4bpp is the same as ASTC 4x4
+        {8, 4, 1},
+    };
+    return footprints[idx < ResourceFormat_Footprint_Count ? idx : 0];
+  }
+
+  uint16_t ComparedFlags() const { return flags & ~ResourceFormat_Footprint_Mask; }
+  uint32_t BlockFootprint(uint32_t dim) const
+  {
+    return GetFootprint((flags & ResourceFormat_Footprint_Mask) >> ResourceFormat_Footprint_Shift)[dim];
+  }
+
   // make DoSerialise a friend so it can serialise flags
   template <typename SerialiserType>
   friend void DoSerialise(SerialiserType &ser, ResourceFormat &el);
@@ -2293,3 +2392,93 @@ struct DebugPixelInputs
 };
 
 DECLARE_REFLECTION_STRUCT(DebugPixelInputs);
+
+DOCUMENT(R"(Identifies one shader invocation at the current event to debug as part of a batch with
+:meth:`ReplayController.ProfileShaderDebug`. Only the members for :data:`stage` are used, and they
+have the same meaning as the parameters to :meth:`ReplayController.DebugVertex`,
+:meth:`ReplayController.DebugPixel`, :meth:`ReplayController.DebugThread` or
+:meth:`ReplayController.DebugMeshThread`.
+)");
+struct ShaderDebugInvocation
+{
+  DOCUMENT("");
+  ShaderDebugInvocation() = default;
+  ShaderDebugInvocation(const ShaderDebugInvocation &) = default;
+  ShaderDebugInvocation &operator=(const ShaderDebugInvocation &) = default;
+
+  bool operator==(const ShaderDebugInvocation &o) const
+  {
+    return stage == o.stage && vertexId == o.vertexId && instanceId == o.instanceId &&
+           index == o.index && view == o.view && x == o.x && y == o.y &&
+           pixelInputs.sample == o.pixelInputs.sample &&
+           pixelInputs.primitive == o.pixelInputs.primitive &&
+           pixelInputs.view == o.pixelInputs.view && groupId == o.groupId && threadId == o.threadId;
+  }
+  bool operator<(const ShaderDebugInvocation &o) const
+  {
+    if(!(stage == o.stage))
+      return stage < o.stage;
+    if(!(vertexId == o.vertexId))
+      return vertexId < o.vertexId;
+    if(!(instanceId == o.instanceId))
+      return instanceId < o.instanceId;
+    if(!(index == o.index))
+      return index < o.index;
+    if(!(view == o.view))
+      return view < o.view;
+    if(!(y == o.y))
+      return y < o.y;
+    if(!(x == o.x))
+      return x < o.x;
+    if(!(pixelInputs.sample == o.pixelInputs.sample))
+      return pixelInputs.sample < o.pixelInputs.sample;
+    if(!(pixelInputs.primitive == o.pixelInputs.primitive))
+      return pixelInputs.primitive < o.pixelInputs.primitive;
+    if(!(pixelInputs.view == o.pixelInputs.view))
+      return pixelInputs.view < o.pixelInputs.view;
+    if(!(groupId == o.groupId))
+      return groupId < o.groupId;
+    return threadId < o.threadId;
+  }
+
+  DOCUMENT(R"(The stage to debug. This must be :data:`ShaderStage.Vertex`,
+:data:`ShaderStage.Pixel`, :data:`ShaderStage.Compute` or :data:`ShaderStage.Mesh`.
+
+:type: ShaderStage
+)");
+  ShaderStage stage = ShaderStage::Compute;
+
+  DOCUMENT("For vertex shaders, the vertex ID.");
+  uint32_t vertexId = 0;
+  DOCUMENT("For vertex shaders, the instance ID.");
+  uint32_t instanceId = 0;
+  DOCUMENT(R"(For vertex shaders, the index used to look up vertex inputs with all drawcall offsets
+applied.
+)");
+  uint32_t index = 0;
+  DOCUMENT("For vertex shaders, the multiview view or 0 if multiview is not in use.");
+  uint32_t view = 0;
+
+  DOCUMENT("For pixel shaders, the x co-ordinate.");
+  uint32_t x = 0;
+  DOCUMENT("For pixel shaders, the y co-ordinate.");
+  uint32_t y = 0;
+  DOCUMENT(R"(For pixel shaders, which fragment at the co-ordinate to debug.
+
+:type: DebugPixelInputs
+)");
+  DebugPixelInputs pixelInputs;
+
+  DOCUMENT(R"(For compute and mesh shaders, the 3D workgroup index.
+
+:type: Tuple[int,int,int]
+)");
+  rdcfixedarray<uint32_t, 3> groupId = {0, 0, 0};
+  DOCUMENT(R"(For compute and mesh shaders, the 3D thread index within the workgroup.
+
+:type: Tuple[int,int,int]
+)");
+  rdcfixedarray<uint32_t, 3> threadId = {0, 0, 0};
+};
+
+DECLARE_REFLECTION_STRUCT(ShaderDebugInvocation);
@@ -0,0 +1,401 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <functional>
+#include "apidefs.h"
+#include "rdcarray.h"
+#include "rdcpair.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RDC_FLATHASHMAP_SSE2 1
+#include <emmintrin.h>
+#else
+#define RDC_FLATHASHMAP_SSE2 0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// this is a hash map with a std::unordered_map like interface, using open addressing so that
+// inserts don't allocate a node per element. Elements are stored in one flat array alongside an
+// array of control bytes - one per slot - which hold either a marker for empty/deleted slots or 7
+// bits of the element's hash. Lookups probe a group of 16 control bytes at a time (with SSE2 where
+// available) and only compare keys whose hash bits match.
+//
+// Unlike std::unordered_map, any insert can move elements so iterators, pointers and references to
+// elements are invalidated by insertion. Erasing does not move other elements.
+//
+// Key and Value must be default constructible, empty slots hold default constructed pairs.
+DOCUMENT("");
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+struct rdcflathashmap
+{
+  using value_type = rdcpair<Key, Value>;
+  using size_type = size_t;
+
+  template <typename MapType, typename ElemType>
+  struct iterator_base
+  {
+    iterator_base() = default;
+    iterator_base(MapType *m, size_t i) : map(m), idx(i) {}
+    // allow conversion from iterator to const_iterator
+    template <typename M, typename E>
+    iterator_base(const iterator_base<M, E> &o) : map(o.map), idx(o.idx)
+    {
+    }
+
+    ElemType &operator*() const { return map->slots[idx]; }
+    ElemType *operator->() const { return &map->slots[idx]; }
+    iterator_base &operator++()
+    {
+      idx = map->next_full(idx + 1);
+      return *this;
+    }
+    iterator_base operator++(int)
+    {
+      iterator_base ret = *this;
+      ++(*this);
+      return ret;
+    }
+    bool operator==(const iterator_base &o) const { return idx == o.idx; }
+    bool operator!=(const iterator_base &o) const { return idx != o.idx; }
+    MapType *map = NULL;
+    size_t idx = 0;
+  };
+
+  using iterator = iterator_base<rdcflathashmap, value_type>;
+  using const_iterator = iterator_base<const rdcflathashmap, const value_type>;
+
+  rdcflathashmap() = default;
+  rdcflathashmap(const rdcflathashmap &) = default;
+  rdcflathashmap &operator=(const rdcflathashmap &) = default;
+  rdcflathashmap(rdcflathashmap &&o) { swap(o); }
+  rdcflathashmap &operator=(rdcflathashmap &&o)
+  {
+    clear();
+    swap(o);
+    return *this;
+  }
+
+  iterator begin() { return iterator(this, next_full(0)); }
+  iterator end() { return iterator(this, slots.size()); }
+  const_iterator begin() const { return const_iterator(this, next_full(0)); }
+  const_iterator end() const { return const_iterator(this, slots.size()); }
+  bool empty() const { return usedCount == 0; }
+  size_t size() const { return usedCount; }
+  size_t capacity() const { return slots.size(); }
+  iterator find(const Key &key)
+  {
+    size_t idx = find_idx(key, hash_key(key));
+    return iterator(this, idx == NotFound ? slots.size() : idx);
+  }
+
+  const_iterator find(const Key &key) const
+  {
+    size_t idx = find_idx(key, hash_key(key));
+    return const_iterator(this, idx == NotFound ? slots.size() : idx);
+  }
+
+  size_t count(const Key &key) const { return find_idx(key, hash_key(key)) == NotFound ? 0 : 1; }
+  bool contains(const Key &key) const { return find_idx(key, hash_key(key)) != NotFound; }
+  Value &operator[](const Key &key) { return slots[insert_idx(key).first].second; }
+  rdcpair<iterator, bool> insert(const value_type &val)
+  {
+    rdcpair<size_t, bool> res = insert_idx(val.first);
+    if(res.second)
+      slots[res.first].second = val.second;
+    return {iterator(this, res.first), res.second};
+  }
+
+  rdcpair<iterator, bool> insert(value_type &&val)
+  {
+    rdcpair<size_t, bool> res = insert_idx(val.first);
+    if(res.second)
+      slots[res.first].second = std::move(val.second);
+    return {iterator(this, res.first), res.second};
+  }
+
+  size_t erase(const Key &key)
+  {
+    size_t idx = find_idx(key, hash_key(key));
+    if(idx == NotFound)
+      return 0;
+    erase_idx(idx);
+    return 1;
+  }
+
+  iterator erase(const_iterator it)
+  {
+    erase_idx(it.idx);
+    return iterator(this, next_full(it.idx + 1));
+  }
+
+  void reserve(size_t s)
+  {
+    // keep the load factor below 7/8
+    size_t needed = GroupSize;
+    while(needed - needed / 8 < s)
+      needed *= 2;
+
+    if(needed > slots.size())
+      rehash(needed);
+  }
+
+  void clear()
+  {
+    if(usedCount == 0 && deletedCount == 0)
+      return;
+
+    for(size_t i = 0; i < slots.size(); i++)
+      if(ctrl[i] >= 0)
+        slots[i] = value_type();
+    memset(ctrl.data(), CtrlEmpty, ctrl.size());
+    usedCount = 0;
+    deletedCount = 0;
+  }
+
+  void swap(rdcflathashmap &other)
+  {
+    slots.swap(other.slots);
+    ctrl.swap(other.ctrl);
+    std::swap(usedCount, other.usedCount);
+    std::swap(deletedCount, other.deletedCount);
+  }
+
+private:
+  static const size_t GroupSize = 16;
+  static const size_t NotFound = ~size_t(0);
+
+  static const int8_t CtrlEmpty = -128;
+  static const int8_t CtrlDeleted = -2;
+
+  rdcarray<value_type> slots;
+  rdcarray<int8_t> ctrl;
+  size_t usedCount = 0;
+  size_t deletedCount = 0;
+
+  static uint64_t hash_key(const Key &key)
+  {
+    // mix the hash, as std::hash is commonly the identity for integers and we need good entropy in
+    // both the low bits (which pick the group) and the high bits (stored in the control bytes)
+    uint64_t h = uint64_t(Hash()(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  static int8_t hash_ctrl(uint64_t hash) { return int8_t((hash >> 57) & 0x7f); }
+  // returns a bitmask of which control bytes in the group starting at idx match the given value
+  uint32_t match_group(size_t idx, int8_t val) const
+  {
+#if RDC_FLATHASHMAP_SSE2
+    __m128i group = _mm_loadu_si128((const __m128i *)(ctrl.data() + idx));
+    return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(val))));
+#else
+    uint32_t ret = 0;
+    for(size_t i = 0; i < GroupSize; i++)
+      if(ctrl[idx + i] == val)
+        ret |= 1U << i;
+    return ret;
+#endif
+  }
+
+  // returns a bitmask of which control bytes are empty or deleted
+  uint32_t match_free(size_t idx) const
+  {
+#if RDC_FLATHASHMAP_SSE2
+    // empty and deleted both have the top bit set, full slots never do
+    __m128i group = _mm_loadu_si128((const __m128i *)(ctrl.data() + idx));
+    return uint32_t(_mm_movemask_epi8(group));
+#else
+    uint32_t ret = 0;
+    for(size_t i = 0; i < GroupSize; i++)
+      if(ctrl[idx + i] < 0)
+        ret |= 1U << i;
+    return ret;
+#endif
+  }
+
+  static uint32_t lowest_bit(uint32_t mask)
+  {
+#if defined(_MSC_VER)
+    unsigned long ret = 0;
+    _BitScanForward(&ret, mask);
+    return ret;
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+
+  // groups are probed quadratically (1, 2, 3... groups further each step). With a power of two
+  // number of groups this visits every group.
+  size_t num_groups() const { return slots.size() / GroupSize; }
+  size_t first_group(uint64_t hash) const { return size_t(hash & (num_groups() - 1)) * GroupSize; }
+  size_t next_group(size_t idx, size_t step) const
+  {
+    return (idx + step * GroupSize) & (slots.size() - 1);
+  }
+
+  size_t next_full(size_t idx) const
+  {
+    while(idx < ctrl.size() && ctrl[idx] < 0)
+      idx++;
+    return idx;
+  }
+
+  size_t find_idx(const Key &key, uint64_t hash) const
+  {
+    if(usedCount == 0)
+      return NotFound;
+
+    const int8_t h2 = hash_ctrl(hash);
+    size_t idx = first_group(hash);
+
+    for(size_t step = 1; step <= num_groups(); step++)
+    {
+      uint32_t mask = match_group(idx, h2);
+      while(mask)
+      {
+        uint32_t bit = lowest_bit(mask);
+        if(slots[idx + bit].first == key)
+          return idx + bit;
+        mask &= mask - 1;
+      }
+
+      // if there's an empty slot in this group then the key would have been inserted here
+      if(match_group(idx, CtrlEmpty))
+        return NotFound;
+
+      idx = next_group(idx, step);
+    }
+
+    return NotFound;
+  }
+
+  rdcpair<size_t, bool> insert_idx(const Key &key)
+  {
+    uint64_t hash = hash_key(key);
+
+    size_t idx = find_idx(key, hash);
+    if(idx != NotFound)
+      return {idx, false};
+
+    // grow (or clean out deleted slots) once we'd exceed a 7/8 load factor
+    if(slots.empty() || (usedCount + deletedCount + 1) > slots.size() - slots.size() / 8)
+    {
+      if(usedCount + 1 > (slots.size() - slots.size() / 8) / 2)
+        rehash(slots.empty() ? GroupSize : slots.size() * 2);
+      else
+        rehash(slots.size());
+    }
+
+    idx = first_group(hash);
+    for(size_t step = 1;; step++)
+    {
+      uint32_t mask = match_free(idx);
+      if(mask)
+      {
+        idx += lowest_bit(mask);
+        break;
+      }
+
+      idx = next_group(idx, step);
+    }
+
+    if(ctrl[idx] == CtrlDeleted)
+      deletedCount--;
+
+    ctrl[idx] = hash_ctrl(hash);
+    slots[idx].first = key;
+    usedCount++;
+
+    return {idx, true};
+  }
+
+  void erase_idx(size_t idx)
+  {
+    slots[idx] = value_type();
+
+    // if the group still has an empty slot, no probe sequence can have continued past it so we can
+    // mark this slot empty instead of leaving a tombstone.
+    size_t group = idx & ~(GroupSize - 1);
+    if(match_group(group, CtrlEmpty))
+    {
+      ctrl[idx] = CtrlEmpty;
+    }
+    else
+    {
+      ctrl[idx] = CtrlDeleted;
+      deletedCount++;
+    }
+
+    usedCount--;
+  }
+
+  void rehash(size_t newSize)
+  {
+    rdcarray<value_type> oldSlots;
+    rdcarray<int8_t> oldCtrl;
+    oldSlots.swap(slots);
+    oldCtrl.swap(ctrl);
+
+    slots.resize(newSize);
+    ctrl.resize(newSize);
+    memset(ctrl.data(), CtrlEmpty, newSize);
+    usedCount = 0;
+    deletedCount = 0;
+
+    for(size_t i = 0; i < oldCtrl.size(); i++)
+    {
+      if(oldCtrl[i] < 0)
+        continue;
+
+      uint64_t hash = hash_key(oldSlots[i].first);
+      size_t idx = first_group(hash);
+      for(size_t step = 1;; step++)
+      {
+        uint32_t mask = match_free(idx);
+        if(mask)
+        {
+          idx += lowest_bit(mask);
+          break;
+        }
+
+        idx = next_group(idx, step);
+      }
+
+      ctrl[idx] = hash_ctrl(hash);
+      slots[idx] = std::move(oldSlots[i]);
+      usedCount++;
+    }
+  }
+};
@@ -1034,18 +1034,70 @@ calculated in that time.
 This will always perform at least one step. If the list is empty, the debugging process has
 completed, further calls will return an empty list.
 
+Each state is returned exactly once and in order. Moving the debugger with :meth:`SeekDebug` does
+not change this: the next call carries on from the step after the last state this function
+returned, wherever the debugger was moved to in the meantime.
+
 :param ShaderDebugger debugger: The shader debugger to continue running.
 :return: A number of subsequent states.
 :rtype: List[ShaderDebugState]
 )");
   virtual rdcarray<ShaderDebugState> ContinueDebug(ShaderDebugger *debugger) = 0;
 
+  DOCUMENT(R"(Move a shader's debugging to a given step, which may be before or after the steps
+that have been returned so far from :meth:`ContinueDebug`.
+
+While debugging, the debugger periodically saves a checkpoint of the complete shader state. Moving
+to an earlier step restores the nearest checkpoint before it and re-executes from there, so a
+client does not need to keep every :class:`ShaderDebugState` to be able to step backwards. It can
+discard states it no longer needs and seek back to them on demand, which keeps memory use bounded
+for long running shaders. How often checkpoints are saved is controlled by the
+``Replay_Debug_ShaderCheckpointInterval`` and ``Replay_Debug_ShaderMaxCheckpoints`` config
+settings.
+
+The returned state is a complete snapshot rather than a delta: its
+:data:`~ShaderDebugState.changes` contain every live variable with an empty
+:data:`~ShaderVariableChange.before`, in the same way as :data:`ShaderDebugTrace.initialState`.
+Applying it replaces all variable values. Seeking does not affect which states
+:meth:`ContinueDebug` returns next, it carries on from the last state it returned.
+
+If the step is past the end of the shader, the debugger moves to the last step instead.
+
+:param ShaderDebugger debugger: The shader debugger to move.
+:param int stepIndex: The :data:`~ShaderDebugState.stepIndex` to move to.
+:return: The complete state at the step that was reached, or an empty state if seeking is not
+  supported.
+:rtype: ShaderDebugState
+)");
+  virtual ShaderDebugState SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex) = 0;
+
   DOCUMENT(R"(Free a debugging trace from running a shader invocation debug.
 
 :param ShaderDebugTrace trace: The shader debugging trace to free.
 )");
   virtual void FreeTrace(ShaderDebugTrace *trace) = 0;
 
+  DOCUMENT(R"(Debug a batch of invocations of the current event's shader and gather execution
+statistics from them, without keeping any of the traces. This can be used to find which
+instructions and source lines are hot, which are never executed, and where control flow diverges
+or loop trip counts vary between invocations.
+
+All invocations must be for the same stage. Invocations that can't be debugged, or are for a
+different stage than the first, are counted in :data:`ShaderDebugProfile.failedInvocations`.
+
+Each invocation is run to completion with the CPU shader debugger, so this can take a long time
+for large batches or long-running shaders. For compute and mesh shaders the debugger simulates the
+whole workgroup, and where it supports it every thread in the group is profiled. Later invocations
+in a group that has already been simulated are then skipped, so listing one thread per group is
+enough.
+
+:param List[ShaderDebugInvocation] invocations: The invocations to debug.
+:return: The combined statistics for all invocations.
+:rtype: ShaderDebugProfile
+)");
+  virtual ShaderDebugProfile ProfileShaderDebug(
+      const rdcarray<ShaderDebugInvocation> &invocations) = 0;
+
   DOCUMENT(R"(Retrieve a list of ways a given resource is used.
 
 :param ResourceId id: The id of the texture or buffer resource to be queried.
@@ -1086,6 +1138,21 @@ texture to something compatible with the target file format.
 )");
   virtual ResultDetails SaveTexture(const TextureSave &saveData, const rdcstr &path) = 0;
 
+  DOCUMENT(R"(Save several textures to files on disk. This gives the same results as calling
+:meth:`SaveTexture` for each in turn, but where possible each texture is converted and encoded in
+the background while the next one is read back, which is much faster when saving many textures.
+
+Every texture is attempted even if an earlier one fails.
+
+:param List[TextureSave] saveData: The configuration settings of which textures to save, and how.
+:param List[str] paths: The path to save each texture to on disk, in the same order as
+  ``saveData``.
+:return: The result of the operation. If any textures failed to save, this is the first failure.
+:rtype: ResultDetails
+)");
+  virtual ResultDetails SaveTextures(const rdcarray<TextureSave> &saveData,
+                                     const rdcarray<rdcstr> &paths) = 0;
+
   DOCUMENT(R"(Retrieve the generated data from one of the geometry processing shader stages.
 
 :param int instance: The index of the instance to retrieve data for, or 0 for non-instanced draws.
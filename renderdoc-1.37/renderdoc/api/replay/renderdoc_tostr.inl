@@ -1187,6 +1187,8 @@ rdcstr DoStringise(const SectionFlags &el)
     STRINGISE_BITFIELD_CLASS_BIT_NAMED(ASCIIStored, "Stored as ASCII");
     STRINGISE_BITFIELD_CLASS_BIT_NAMED(LZ4Compressed, "Compressed with LZ4");
     STRINGISE_BITFIELD_CLASS_BIT_NAMED(ZstdCompressed, "Compressed with Zstd");
+    STRINGISE_BITFIELD_CLASS_BIT_NAMED(IndependentBlocks, "Independently compressed blocks");
+    STRINGISE_BITFIELD_CLASS_BIT_NAMED(SeekTable, "Has seek table");
   }
   END_BITFIELD_STRINGISE();
 }
@@ -4579,6 +4579,17 @@ DOCUMENT(R"(A set of flags describing the properties of a section in a renderdoc
 .. data:: ZstdCompressed
 
   This section is compressed with Zstd on disk.
+
+.. data:: IndependentBlocks
+
+  The compressed blocks in this section don't reference any previous block, so they can be
+  decompressed in parallel. This is set automatically when writing a compressed section.
+
+.. data:: SeekTable
+
+  The compressed data in this section is followed by a table of block offsets, allowing reads to
+  skip directly to a given offset without decompressing everything before it. This is set
+  automatically when writing a compressed section.
 )");
 enum class SectionFlags : uint32_t
 {
@@ -4586,6 +4597,8 @@ enum class SectionFlags : uint32_t
   ASCIIStored = 0x1,
   LZ4Compressed = 0x2,
   ZstdCompressed = 0x4,
+  IndependentBlocks = 0x8,
+  SeekTable = 0x10,
 };
 
 BITMASK_OPERATORS(SectionFlags);
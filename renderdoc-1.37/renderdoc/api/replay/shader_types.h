@@ -998,6 +998,151 @@ per-instruction information such as source line mapping, and source variables.
 
 DECLARE_REFLECTION_STRUCT(ShaderDebugTrace);
 
+DOCUMENT(R"(Execution statistics for one instruction, combined over a batch of shader invocations
+debugged with :meth:`ReplayController.ProfileShaderDebug`.
+)");
+struct ShaderInstructionProfile
+{
+  DOCUMENT("");
+  ShaderInstructionProfile() = default;
+  ShaderInstructionProfile(const ShaderInstructionProfile &) = default;
+  ShaderInstructionProfile &operator=(const ShaderInstructionProfile &) = default;
+
+  bool operator==(const ShaderInstructionProfile &o) const
+  {
+    return instruction == o.instruction && executions == o.executions &&
+           invocations == o.invocations && minExecutions == o.minExecutions &&
+           maxExecutions == o.maxExecutions;
+  }
+  bool operator<(const ShaderInstructionProfile &o) const { return instruction < o.instruction; }
+  DOCUMENT("The instruction these statistics are for.");
+  uint32_t instruction = 0;
+
+  DOCUMENT("The total number of times this instruction was executed by all invocations.");
+  uint64_t executions = 0;
+
+  DOCUMENT(R"(How many invocations executed this instruction at least once. If this is less than
+:data:`ShaderDebugProfile.invocations` then control flow diverged around it.
+)");
+  uint32_t invocations = 0;
+
+  DOCUMENT(R"(The fewest times any invocation that reached this instruction executed it. Inside a
+loop this is the smallest trip count.
+)");
+  uint32_t minExecutions = 0;
+
+  DOCUMENT(R"(The most times any single invocation executed this instruction. Inside a loop this is
+the largest trip count.
+)");
+  uint32_t maxExecutions = 0;
+};
+
+DECLARE_REFLECTION_STRUCT(ShaderInstructionProfile);
+
+DOCUMENT(R"(Execution statistics for one source line, combined over a batch of shader invocations
+debugged with :meth:`ReplayController.ProfileShaderDebug`.
+)");
+struct ShaderLineProfile
+{
+  DOCUMENT("");
+  ShaderLineProfile() = default;
+  ShaderLineProfile(const ShaderLineProfile &) = default;
+  ShaderLineProfile &operator=(const ShaderLineProfile &) = default;
+
+  bool operator==(const ShaderLineProfile &o) const
+  {
+    return fileIndex == o.fileIndex && line == o.line && executions == o.executions &&
+           instructions == o.instructions && invocations == o.invocations &&
+           minExecutions == o.minExecutions && maxExecutions == o.maxExecutions;
+  }
+  bool operator<(const ShaderLineProfile &o) const
+  {
+    if(!(fileIndex == o.fileIndex))
+      return fileIndex < o.fileIndex;
+    return line < o.line;
+  }
+  DOCUMENT(R"(The index of the source file in :data:`ShaderDebugInfo.files` that this line is in.
+
+If the instructions have no source mapping this is ``-1``, and :data:`line` is a line in the
+disassembly instead.
+)");
+  int32_t fileIndex = -1;
+
+  DOCUMENT("The 1-based line number.");
+  uint32_t line = 0;
+
+  DOCUMENT(R"(The total number of instructions executed on this line by all invocations. This is the
+line's share of the simulated work, and is the best measure of how hot it is.
+)");
+  uint64_t executions = 0;
+
+  DOCUMENT("How many different instructions that map to this line were executed.");
+  uint32_t instructions = 0;
+
+  DOCUMENT(R"(How many invocations executed any instruction on this line. If this is less than
+:data:`ShaderDebugProfile.invocations` then control flow diverged around it.
+)");
+  uint32_t invocations = 0;
+
+  DOCUMENT(R"(The fewest times any invocation that reached this line executed it, counting the most
+executed instruction on the line. Inside a loop this is the smallest trip count.
+)");
+  uint32_t minExecutions = 0;
+
+  DOCUMENT(R"(The most times any single invocation executed this line, counting the most executed
+instruction on the line. Inside a loop this is the largest trip count.
+)");
+  uint32_t maxExecutions = 0;
+};
+
+DECLARE_REFLECTION_STRUCT(ShaderLineProfile);
+
+DOCUMENT(R"(The statistics gathered from debugging a batch of shader invocations with
+:meth:`ReplayController.ProfileShaderDebug`.
+)");
+struct ShaderDebugProfile
+{
+  DOCUMENT("");
+  ShaderDebugProfile() = default;
+  ShaderDebugProfile(const ShaderDebugProfile &) = default;
+  ShaderDebugProfile &operator=(const ShaderDebugProfile &) = default;
+
+  DOCUMENT(R"(The shader stage that was debugged.
+
+:type: ShaderStage
+)");
+  ShaderStage stage = ShaderStage::Vertex;
+
+  DOCUMENT(R"(The number of invocations that were successfully debugged. For compute and mesh
+shaders this includes the other threads of each simulated workgroup, when they were profiled.
+)");
+  uint32_t invocations = 0;
+
+  DOCUMENT(R"(The number of requested invocations that couldn't be debugged, for example pixels
+that the event didn't write to.
+)");
+  uint32_t failedInvocations = 0;
+
+  DOCUMENT("The total number of instructions executed by all invocations.");
+  uint64_t steps = 0;
+
+  DOCUMENT(R"(The statistics for each instruction that was executed at least once, sorted by
+instruction.
+
+:type: List[ShaderInstructionProfile]
+)");
+  rdcarray<ShaderInstructionProfile> instructions;
+
+  DOCUMENT(R"(The statistics for each source line that was executed at least once, sorted by file
+and line.
+
+:type: List[ShaderLineProfile]
+)");
+  rdcarray<ShaderLineProfile> lines;
+};
+
+DECLARE_REFLECTION_STRUCT(ShaderDebugProfile);
+
 DOCUMENT(R"(The information describing an input or output signature element describing the interface
 between shader stages.
 
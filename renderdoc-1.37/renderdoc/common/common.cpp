@@ -39,33 +39,29 @@ void rdcassert(const char *msg, const char *file, unsigned int line, const char
                 "Assertion failed: %s", msg);
 }
 
-#if 0
-static __m128 zero = {0};
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DIFF_SSE2 OPTION_ON
+#define DIFF_NEON OPTION_OFF
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define DIFF_SSE2 OPTION_OFF
+#define DIFF_NEON OPTION_ON
+#else
+#define DIFF_SSE2 OPTION_OFF
+#define DIFF_NEON OPTION_OFF
 #endif
 
 // assumes a and b both point to 16-byte aligned 16-byte chunks of memory.
 // Returns if they're equal or different
 bool Vec16NotEqual(void *a, void *b)
 {
-// disabled SSE version as it's acting dodgy
-#if 0
-	__m128 avec = _mm_load_ps(aflt);
-	__m128 bvec = _mm_load_ps(bflt);
-
-	__m128 diff = _mm_xor_ps(avec, bvec);
-
-	__m128 eq = _mm_cmpeq_ps(diff, zero);
-	int mask = _mm_movemask_ps(eq);
-	int signMask = _mm_movemask_ps(diff);
-
-	// first check ensures that diff is floatequal to zero (ie. avec bitwise equal to bvec).
-	// HOWEVER -0 is floatequal to 0, so we ensure no sign bits are set on diff
-	if((mask^0xf) || signMask != 0)
-	{
-		return true;
-	}
-	
-	return false;
+#if ENABLED(DIFF_SSE2)
+  __m128i eq = _mm_cmpeq_epi8(_mm_load_si128((const __m128i *)a), _mm_load_si128((const __m128i *)b));
+  return _mm_movemask_epi8(eq) != 0xffff;
+#elif ENABLED(DIFF_NEON)
+  uint8x16_t eq = vceqq_u8(vld1q_u8((const uint8_t *)a), vld1q_u8((const uint8_t *)b));
+  return vminvq_u8(eq) != 0xff;
 #elif ENABLED(RDOC_X64)
   uint64_t *a64 = (uint64_t *)a;
   uint64_t *b64 = (uint64_t *)b;
@@ -79,6 +75,169 @@ bool Vec16NotEqual(void *a, void *b)
 #endif
 }
 
+// the granularity FindDiffRanges scans at. Differences are refined to the byte at the edges of each
+// range, so this only affects how quickly identical memory is skipped.
+static const size_t DiffLineSize = 64;
+
+// Returns if the DiffLineSize bytes at a and b differ. No alignment is required.
+static bool LineNotEqual(const byte *a, const byte *b)
+{
+#if ENABLED(DIFF_SSE2)
+  __m128i eq0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a + 0),
+                               _mm_loadu_si128((const __m128i *)b + 0));
+  __m128i eq1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a + 1),
+                               _mm_loadu_si128((const __m128i *)b + 1));
+  __m128i eq2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a + 2),
+                               _mm_loadu_si128((const __m128i *)b + 2));
+  __m128i eq3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a + 3),
+                               _mm_loadu_si128((const __m128i *)b + 3));
+
+  __m128i eq = _mm_and_si128(_mm_and_si128(eq0, eq1), _mm_and_si128(eq2, eq3));
+  return _mm_movemask_epi8(eq) != 0xffff;
+#elif ENABLED(DIFF_NEON)
+  uint8x16_t eq0 = vceqq_u8(vld1q_u8(a + 0), vld1q_u8(b + 0));
+  uint8x16_t eq1 = vceqq_u8(vld1q_u8(a + 16), vld1q_u8(b + 16));
+  uint8x16_t eq2 = vceqq_u8(vld1q_u8(a + 32), vld1q_u8(b + 32));
+  uint8x16_t eq3 = vceqq_u8(vld1q_u8(a + 48), vld1q_u8(b + 48));
+
+  uint8x16_t eq = vandq_u8(vandq_u8(eq0, eq1), vandq_u8(eq2, eq3));
+  return vminvq_u8(eq) != 0xff;
+#else
+  uint64_t diff = 0;
+  for(size_t i = 0; i < DiffLineSize; i += sizeof(uint64_t))
+  {
+    uint64_t x, y;
+    memcpy(&x, a + i, sizeof(x));
+    memcpy(&y, b + i, sizeof(y));
+    diff |= x ^ y;
+  }
+  return diff != 0;
+#endif
+}
+
+size_t FindDiffRanges(const void *a, const void *b, size_t bufSize, DiffRange *ranges,
+                      size_t maxRanges, size_t mergeGap)
+{
+  DiffRange whole = {0, bufSize};
+  return FindDiffRanges(a, b, &whole, 1, ranges, maxRanges, mergeGap);
+}
+
+size_t FindDiffRanges(const void *a, const void *b, const DiffRange *spans, size_t numSpans,
+                      DiffRange *ranges, size_t maxRanges, size_t mergeGap)
+{
+  if(maxRanges == 0)
+    return 0;
+
+  const byte *abyte = (const byte *)a;
+  const byte *bbyte = (const byte *)b;
+
+  size_t numRanges = 0;
+
+  // the range currently being extended. Its end is only made byte-accurate once it's closed, until
+  // then it's the end of the last differing line.
+  bool open = false;
+  DiffRange cur = {};
+
+  auto closeRange = [&]() {
+    // make sure we're byte-accurate, to comply with WRITE_NO_OVERWRITE
+    while(cur.end > cur.start && abyte[cur.end - 1] == bbyte[cur.end - 1])
+      cur.end--;
+
+    open = false;
+
+    // the memory may be changing underneath us, in which case the difference we saw may be gone
+    if(cur.end == cur.start)
+      return;
+
+    if(numRanges == maxRanges)
+    {
+      // we're out of space, merge whichever neighbouring pair has the smallest gap. This includes
+      // the new range, which may just extend the last one.
+      size_t best = numRanges - 1;
+      size_t bestGap = cur.start - ranges[numRanges - 1].end;
+      for(size_t i = 0; i + 1 < numRanges; i++)
+      {
+        size_t gap = ranges[i + 1].start - ranges[i].end;
+        if(gap < bestGap)
+        {
+          best = i;
+          bestGap = gap;
+        }
+      }
+
+      if(best == numRanges - 1)
+      {
+        ranges[best].end = cur.end;
+      }
+      else
+      {
+        ranges[best].end = ranges[best + 1].end;
+        for(size_t i = best + 1; i + 1 < numRanges; i++)
+          ranges[i] = ranges[i + 1];
+        ranges[numRanges - 1] = cur;
+      }
+    }
+    else
+    {
+      ranges[numRanges++] = cur;
+    }
+  };
+
+  auto diffBytes = [&](size_t offs, size_t size) {
+    // find the first and last differing byte in this span, if any
+    size_t first = offs, last = offs + size;
+    while(first < last && abyte[first] == bbyte[first])
+      first++;
+    if(first == last)
+      return;
+    while(last > first + 1 && abyte[last - 1] == bbyte[last - 1])
+      last--;
+
+    if(open && first - cur.end > mergeGap)
+      closeRange();
+
+    if(!open)
+    {
+      cur.start = first;
+      open = true;
+    }
+    cur.end = last;
+  };
+
+  // the open range carries over between spans, so differences either side of a small gap are still
+  // coalesced and the merging above bounds the ranges across every span
+  for(size_t s = 0; s < numSpans; s++)
+  {
+    const size_t spanStart = spans[s].start;
+    const size_t spanSize = spans[s].end - spans[s].start;
+    const size_t numLines = spanSize / DiffLineSize;
+
+    for(size_t l = 0; l < numLines; l++)
+    {
+      const size_t offs = spanStart + l * DiffLineSize;
+
+      if(!LineNotEqual(abyte + offs, bbyte + offs))
+        continue;
+
+      // if this line is close enough to the open range we can extend it to the end of this line
+      // without looking at the bytes, the end is refined when the range is closed.
+      if(open && offs - cur.end <= mergeGap)
+        cur.end = offs + DiffLineSize;
+      else
+        diffBytes(offs, DiffLineSize);
+    }
+
+    // handle any bytes at the end that don't fill a line
+    if(spanSize > numLines * DiffLineSize)
+      diffBytes(spanStart + numLines * DiffLineSize, spanSize - numLines * DiffLineSize);
+  }
+
+  if(open)
+    closeRange();
+
+  return numRanges;
+}
+
 bool FindDiffRange(void *a, void *b, size_t bufSize, size_t &diffStart, size_t &diffEnd)
 {
   RDCASSERT(uintptr_t(a) % 16 == 0);
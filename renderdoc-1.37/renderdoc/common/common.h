@@ -304,6 +304,26 @@ T AlignToMultiple(T value, T multiple)
   (((uint32_t)(d) << 24) | ((uint32_t)(c) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(a))
 
 bool FindDiffRange(void *a, void *b, size_t bufSize, size_t &diffStart, size_t &diffEnd);
+
+struct DiffRange
+{
+  size_t start;
+  size_t end;
+};
+
+// finds the [start, end) ranges of bytes that differ between a and b and writes up to maxRanges of
+// them in increasing order, returning how many were written. Ranges separated by no more than
+// mergeGap identical bytes are coalesced, and if there would be more than maxRanges the closest
+// neighbours are merged, so the ranges returned always cover every difference.
+size_t FindDiffRanges(const void *a, const void *b, size_t bufSize, DiffRange *ranges,
+                      size_t maxRanges, size_t mergeGap = 256);
+// as above but only compares the given spans of the buffers, which must be in increasing order and
+// not overlap. At most maxRanges are written in total over all the spans.
+size_t FindDiffRanges(const void *a, const void *b, const DiffRange *spans, size_t numSpans,
+                      DiffRange *ranges, size_t maxRanges, size_t mergeGap = 256);
+// the most separate ranges a coherent map is flushed in when changes are found. Beyond this nearby
+// changes are merged, trading some redundant data for fewer chunks.
+static const size_t MaxMapFlushRanges = 32;
 uint32_t CalcNumMips(int Width, int Height, int Depth);
 
 typedef uint8_t byte;
@@ -0,0 +1,244 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "common/common.h"
+#include "common/timing.h"
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Test finding difference ranges", "[diff]")
+{
+  const size_t size = 64 * 1024 + 13;
+
+  byte *a = AllocAlignedBuffer(size);
+  byte *b = AllocAlignedBuffer(size);
+
+  for(size_t i = 0; i < size; i++)
+    a[i] = b[i] = byte(i * 31);
+
+  DiffRange ranges[8] = {};
+
+  SECTION("No differences")
+  {
+    CHECK(FindDiffRanges(a, b, size, ranges, 8) == 0);
+    CHECK(FindDiffRanges(a, b, 0, ranges, 8) == 0);
+
+    size_t start = 0, end = 0;
+    CHECK_FALSE(FindDiffRange(a, b, size, start, end));
+  };
+
+  SECTION("Single bytes at each end")
+  {
+    b[1] ^= 0xff;
+    b[size - 2] ^= 0xff;
+
+    REQUIRE(FindDiffRanges(a, b, size, ranges, 8) == 2);
+    CHECK(ranges[0].start == 1);
+    CHECK(ranges[0].end == 2);
+    CHECK(ranges[1].start == size - 2);
+    CHECK(ranges[1].end == size - 1);
+
+    // the single range version has to cover everything in between
+    size_t start = 0, end = 0;
+    CHECK(FindDiffRange(a, b, size, start, end));
+    CHECK(start == 1);
+    CHECK(end == size - 1);
+
+    // with only one range allowed the same is true
+    REQUIRE(FindDiffRanges(a, b, size, ranges, 1) == 1);
+    CHECK(ranges[0].start == 1);
+    CHECK(ranges[0].end == size - 1);
+  };
+
+  SECTION("Unaligned pointers")
+  {
+    b[1000] ^= 0xff;
+    b[5000] ^= 0xff;
+
+    REQUIRE(FindDiffRanges(a + 3, b + 3, size - 3, ranges, 8) == 2);
+    CHECK(ranges[0].start == 997);
+    CHECK(ranges[0].end == 998);
+    CHECK(ranges[1].start == 4997);
+    CHECK(ranges[1].end == 4998);
+  };
+
+  SECTION("Nearby changes are coalesced")
+  {
+    b[1000] ^= 0xff;
+    b[1100] ^= 0xff;
+    b[1300] ^= 0xff;
+    b[2000] ^= 0xff;
+
+    // the default gap merges the first three but not the last
+    REQUIRE(FindDiffRanges(a, b, size, ranges, 8) == 2);
+    CHECK(ranges[0].start == 1000);
+    CHECK(ranges[0].end == 1301);
+    CHECK(ranges[1].start == 2000);
+    CHECK(ranges[1].end == 2001);
+
+    REQUIRE(FindDiffRanges(a, b, size, ranges, 8, 0) == 4);
+    CHECK(ranges[1].start == 1100);
+    CHECK(ranges[1].end == 1101);
+  };
+
+  SECTION("Too many ranges merges the closest")
+  {
+    // changes with increasing gaps between them
+    size_t offsets[] = {100, 1000, 3000, 7000, 15000, 31000};
+    for(size_t o : offsets)
+      b[o] ^= 0xff;
+
+    REQUIRE(FindDiffRanges(a, b, size, ranges, 3, 0) == 3);
+    CHECK(ranges[0].start == 100);
+    CHECK(ranges[0].end == 7001);
+    CHECK(ranges[1].start == 15000);
+    CHECK(ranges[1].end == 15001);
+    CHECK(ranges[2].start == 31000);
+    CHECK(ranges[2].end == 31001);
+  };
+
+  SECTION("Ranges always cover every difference")
+  {
+    uint32_t state = 1;
+    for(int i = 0; i < 200; i++)
+    {
+      state = state * 1664525U + 1013904223U;
+      b[state % size] ^= 0x1;
+    }
+
+    size_t num = FindDiffRanges(a, b, size, ranges, 8, 16);
+    REQUIRE(num > 0);
+    REQUIRE(num <= 8);
+
+    size_t r = 0;
+    for(size_t i = 0; i < size; i++)
+    {
+      bool inRange = false;
+      for(r = 0; r < num; r++)
+        if(i >= ranges[r].start && i < ranges[r].end)
+          inRange = true;
+
+      if(a[i] != b[i])
+        CHECK(inRange);
+    }
+
+    for(r = 0; r + 1 < num; r++)
+      CHECK(ranges[r].end < ranges[r + 1].start);
+
+    // every range starts and ends on a difference
+    for(r = 0; r < num; r++)
+    {
+      CHECK(a[ranges[r].start] != b[ranges[r].start]);
+      CHECK(a[ranges[r].end - 1] != b[ranges[r].end - 1]);
+    }
+  };
+
+  SECTION("Only the given spans are compared")
+  {
+    b[100] ^= 0xff;
+    b[5000] ^= 0xff;
+    b[9000] ^= 0xff;
+    b[20000] ^= 0xff;
+
+    DiffRange spans[] = {{4096, 8192}, {8192 + 100, 12288}, {16384, 24576}};
+
+    // the change at 100 is outside every span
+    REQUIRE(FindDiffRanges(a, b, spans, 3, ranges, 8) == 3);
+    CHECK(ranges[0].start == 5000);
+    CHECK(ranges[0].end == 5001);
+    CHECK(ranges[1].start == 9000);
+    CHECK(ranges[1].end == 9001);
+    CHECK(ranges[2].start == 20000);
+    CHECK(ranges[2].end == 20001);
+
+    // the limit applies over all the spans together
+    REQUIRE(FindDiffRanges(a, b, spans, 3, ranges, 1) == 1);
+    CHECK(ranges[0].start == 5000);
+    CHECK(ranges[0].end == 20001);
+
+    // spans that end off a line boundary still see their last bytes
+    b[12287] ^= 0xff;
+    DiffRange tail[] = {{12000, 12288}};
+    REQUIRE(FindDiffRanges(a, b, tail, 1, ranges, 8) == 1);
+    CHECK(ranges[0].start == 12287);
+    CHECK(ranges[0].end == 12288);
+  };
+
+  FreeAlignedBuffer(a);
+  FreeAlignedBuffer(b);
+};
+
+TEST_CASE("Benchmark finding difference ranges", "[diff][!benchmark]")
+{
+  const size_t size = 64 * 1024 * 1024;
+
+  byte *a = AllocAlignedBuffer(size);
+  byte *b = AllocAlignedBuffer(size);
+
+  memset(a, 0x3c, size);
+  memset(b, 0x3c, size);
+
+  DiffRange ranges[32];
+
+  const int iterations = 10;
+
+  auto run = [&](const char *name) {
+    size_t start = 0, end = 0;
+
+    PerformanceTimer timer;
+    for(int i = 0; i < iterations; i++)
+      FindDiffRange(a, b, size, start, end);
+    double single = timer.GetMilliseconds() / iterations;
+
+    size_t num = 0;
+    timer.Restart();
+    for(int i = 0; i < iterations; i++)
+      num = FindDiffRanges(a, b, size, ranges, 32);
+    double multi = timer.GetMilliseconds() / iterations;
+
+    uint64_t multiBytes = 0;
+    for(size_t r = 0; r < num; r++)
+      multiBytes += ranges[r].end - ranges[r].start;
+
+    RDCLOG("Diff %s: single range %.2f ms (%llu bytes), %zu ranges %.2f ms (%llu bytes)", name,
+           single, uint64_t(start < end ? end - start : 0), num, multi, multiBytes);
+  };
+
+  run("identical");
+
+  b[16] ^= 0xff;
+  b[size - 16] ^= 0xff;
+  run("both ends");
+
+  for(size_t i = 0; i < size; i += 1024 * 1024)
+    b[i + 100] ^= 0xff;
+  run("scattered");
+
+  FreeAlignedBuffer(a);
+  FreeAlignedBuffer(b);
+};
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -23,7 +23,16 @@
  ******************************************************************************/
 
 #include <math.h>
+#include <algorithm>
+#include "api/replay/replay_enums.h"
+#include "core/settings.h"
+#include "formatting.h"
 #include "threading.h"
+#include "timing.h"
+
+RDOC_CONFIG(rdcstr, Replay_Debug_JobTracePath, "",
+            "If set, job system activity during replay is traced and written to this path as a "
+            "Chrome profiler JSON when the job system shuts down, with a summary in the log.");
 
 namespace Threading
 {
@@ -66,118 +75,221 @@ static float spinForce = 0.0f;
 
 // Principles:
 // - don't need priorities (yet)
-// - jobs are basically go-wide then one big sync, no need to track lifetimes, don't need a
-// continuous
-//   rolling parallelisation only using this during specific points (loading, shader debugging)
-// - all jobs explicitly launched from main thread, jobs cannot launch jobs
-// - only simple dependencies: 1 job depends on N parents
+// - jobs are mostly go-wide then one big sync, no need to track lifetimes past a sync. Only using
+//   this during specific points (loading, shader debugging)
+// - jobs are launched from the main thread, or from within a running job to spawn nested work.
+//   Other threads cannot launch jobs
+// - only simple dependencies: 1 job depends on N parents. A job is not queued at all until its
+//   parents have completed, so dependency chains don't spin
 // - don't need to be fair: as long as all jobs complete, can happen in mostly any order
-// - jobs should not be too fast, 2ms would be a lower bound
+// - jobs can be small. Each worker has its own queue so adding and taking jobs doesn't contend on a
+//   global lock, and idle workers steal from the front of other queues
 // - since we expect one sync point, we don't expect perfect forward progress indefinitely with no
-// syncs
+//   syncs
 //
 // Safety analysis:
 //
 // - over-waking a semaphore a little is not a problem, the worker might spin a bit but it will
-// eventually
-//   go back to sleep once it can't get any work.
-// - waking one semaphore is sufficient to drain the queue as one worker alone will eventually
+//   eventually go back to sleep once it can't get any work.
+// - waking one semaphore is sufficient to drain the queues as one worker alone will eventually
 //   complete all work just potentially without the best parallelism if other workers are sleeping
 // - semaphore count limits mean we should not do one wake-per-job or it might overflow in theory
 // - we wake workers in a chain. Threads mark when they go to sleep and are prioritised to wake up
-//   for new jobs as we assume maximum saturation is desired. When a thread finds work in the queue
-//   pending it will try to wake a sleeping sibling.
-// - The main thread could in theory push work right as all threads are going to sleep but fail to
-//   wake any of them if it thinks they're running. This can only happen for one job at most at a
-//   time, the most recent job to be pushed, as otherwise the next job would find sleeping
-//   threads and wake them. Forward progress is guaranteed by an assumed SyncAll() call. This could
-//   be improved by forcing the main thread to always wake at least one thread, or perhaps to wait
-//   until either it's woken a thread or the job has been grabbed from the job queue.
+//   for new jobs as we assume maximum saturation is desired. When a thread finds more work queued
+//   after taking a job it will try to wake a sleeping sibling.
+// - a worker marks itself as not running *before* it checks the queued job count one last time and
+//   goes to sleep, and queuing a job increments the count *before* looking for sleeping workers.
+//   So either the worker sees the new job, or the thread queuing it sees the worker asleep and
+//   wakes it.
 // - threads could be mis-identified as both sleeping or waking due to the gap between the atomic on
 //   'running' and the semaphore sleep/wake, but as a result of the above double-waking a thread is
 //   not a big problem as it will eventually sleep if there's no room. Thinking a thread is running
 //   when it's just gone to sleep is also fine as this is equivalent to if the thread really were
 //   running - we still have forward progress.
+// - a job's dependents are registered and its completion is marked under the job's lock, so a
+//   dependent is either registered before completion (and released by it) or sees it complete.
 
 namespace JobSystem
 {
 
 struct Job
 {
-  // 0 = not run or running, 1 = complete
+  // 0 = not run or running, 1 = complete, 2 = complete and no longer referenced by the thread that
+  // ran it, so it can be deleted by whoever owns it
   int32_t state = 0;
 
-  void run()
-  {
-    // run should not be called multiple times
-    RDCASSERT(state == 0);
-
-    callback();
-    Atomic::Inc32(&state);
+  // number of parents that haven't completed. Starts at 1 while the job is being added so that it
+  // can't be queued by a parent completing before all parents are registered
+  int32_t pendingParents = 1;
 
-    // run should not be called multiple times
-    RDCASSERT(state == 1);
-  }
+  // protects state changing and dependents
+  Threading::CriticalSection lock;
 
-  // list of jobs that must be complete before this job can be run
-  rdcarray<Job *> parents;
+  // jobs that are waiting on this one to complete
+  rdcarray<Job *> dependents;
 
   // the actual callback
   std::function<void()> callback;
+
+  // only set while tracing
+  uint64_t id = 0;
+  uint32_t numParents = 0;
+  double addedTime = 0.0;
+  double readyTime = 0.0;
 };
 
 };    // namespace JobSystem
 
-// TODO: could be multiple queues per-priority in future...
+// a simple deque. The owning thread pushes and pops at the back, other threads steal from the front
+struct JobDeque
+{
+  void push_back(Threading::JobSystem::Job *job) { jobs.push_back(job); }
+  Threading::JobSystem::Job *pop_back()
+  {
+    if(head == jobs.size())
+      return NULL;
+
+    Threading::JobSystem::Job *ret = jobs.back();
+    jobs.pop_back();
+    compact();
+    return ret;
+  }
+  Threading::JobSystem::Job *pop_front()
+  {
+    if(head == jobs.size())
+      return NULL;
+
+    Threading::JobSystem::Job *ret = jobs[head++];
+    compact();
+    return ret;
+  }
+  void clear()
+  {
+    jobs.clear();
+    head = 0;
+  }
 
-// locked access to the queue and shutdown flag
-Threading::CriticalSection queueLock;
-// global flags for workers to shut down. DOES NOT automatically drain work, requires a sync first
-bool shutdown = false;
-// added to on on main thread and worker threads pull from and potentially reorder
-rdcarray<Threading::JobSystem::Job *> jobQueue;
+private:
+  void compact()
+  {
+    if(head == jobs.size())
+    {
+      clear();
+    }
+    else if(head > 64 && head > jobs.size() / 2)
+    {
+      jobs.erase(0, head);
+      head = 0;
+    }
+  }
 
-// list of jobs, only for lifetime management. Only accessed on main thread, for cleanup in SyncAll()
-rdcarray<Threading::JobSystem::Job *> allocatedJobs;
+  rdcarray<Threading::JobSystem::Job *> jobs;
+  size_t head = 0;
+};
 
-struct JobWorker
+// state for each thread that can run jobs - the workers and the main thread
+struct JobThread
 {
   size_t idx;
 
-  Threading::Semaphore *semaphore;
-  Threading::ThreadHandle thread;
+  // locked access to the queue. Only contended when another thread is stealing
+  Threading::CriticalSection queueLock;
+  JobDeque queue;
+
+  // list of jobs added on this thread, only for lifetime management. Only accessed on this thread,
+  // or on the main thread for cleanup in SyncAll() when no jobs are running
+  rdcarray<Threading::JobSystem::Job *> allocatedJobs;
+
+  // the main thread doesn't have a semaphore or thread handle
+  Threading::Semaphore *semaphore = NULL;
+  Threading::ThreadHandle thread = 0;
 
   // 1 = running, or 0 = currently sleeping
   int32_t running = 1;
+
+  // events recorded on this thread while tracing. The lock is only contended when the trace ends
+  Threading::CriticalSection traceLock;
+  rdcarray<Threading::JobSystem::TraceEvent> trace;
 };
 
-// the thread ID of the main thread - only thread that can access the external API
+// global flag for workers to shut down. DOES NOT automatically drain work, requires a sync first
+int32_t shutdown = 0;
+
+// number of jobs sitting in any queue, used to quickly check if there's anything to steal
+int32_t queuedJobs = 0;
+// number of jobs added that haven't completed, whether queued, waiting on parents, or running
+int32_t outstandingJobs = 0;
+
+// the thread ID of the main thread - only thread outside of jobs that can access the external API
 uint64_t mainThread;
 
-rdcarray<JobWorker> workers;
+// held while initialising or shutting down, so that TryInit() can safely check if the job system
+// is already running
+Threading::CriticalSection initLock;
+
+// whether we're recording trace events. Only changed on the main thread while no jobs are outstanding
+bool tracing = false;
+PerformanceTimer traceTimer;
+int64_t nextTraceJobID = 0;
+
+// TLS slot pointing to the current thread's JobThread, if it's the main thread or a worker
+uint64_t jobThreadSlot = 0;
+
+// the workers, followed by the main thread. Pointers so that worker threads can hold onto them
+rdcarray<JobThread *> jobThreads;
+size_t numWorkers = 0;
+
+void RecordTraceEvent(JobThread *thread, Threading::JobSystem::TraceEvent::Type type, double start,
+                      Threading::JobSystem::Job *job = NULL)
+{
+  Threading::JobSystem::TraceEvent ev = {};
+  ev.type = type;
+  ev.thread = thread->idx == numWorkers ? Threading::JobSystem::TraceEvent::MainThread
+                                       : (uint32_t)thread->idx;
+  ev.added = ev.ready = ev.start = start;
+  ev.end = traceTimer.GetMicroseconds();
+
+  if(job)
+  {
+    ev.id = job->id;
+    ev.numParents = job->numParents;
+    ev.added = job->addedTime;
+    ev.ready = job->readyTime;
+  }
+
+  SCOPED_LOCK(thread->traceLock);
+  thread->trace.push_back(ev);
+}
+
+JobThread *CurrentJobThread()
+{
+  if(jobThreadSlot == 0)
+    return NULL;
+  return (JobThread *)Threading::GetTLSValue(jobThreadSlot);
+}
 
 // wake at most one sleeping worker, either starting from 0 (and any) or starting from N (and not waking itself)
 bool TryWakeFirstSleepingWorker(size_t firstIdx = ~0U)
 {
   size_t exclude = firstIdx;
-  if(firstIdx == ~0U)
+  if(firstIdx >= numWorkers)
     firstIdx = 0;
 
   // loop over every worker, find the next one asleep and wake it
-  for(size_t i = 0; i < workers.size(); i++)
+  for(size_t i = 0; i < numWorkers; i++)
   {
-    size_t idx = (firstIdx + i) % workers.size();
+    size_t idx = (firstIdx + i) % numWorkers;
 
     if(idx == exclude)
       continue;
 
     // worker running state should always be 0 or 1
-    int32_t running = workers[idx].running;
+    int32_t running = jobThreads[idx]->running;
     RDCASSERT(running == 0 || running == 1);
 
-    if(Atomic::CmpExch32(&workers[idx].running, 0, 0) == 0)
+    if(Atomic::CmpExch32(&jobThreads[idx]->running, 0, 0) == 0)
     {
-      workers[idx].semaphore->Wake(1);
+      jobThreads[idx]->semaphore->Wake(1);
       return true;
     }
   }
@@ -185,134 +297,183 @@ bool TryWakeFirstSleepingWorker(size_t firstIdx = ~0U)
   return false;
 }
 
-bool RunJobIfReady(Threading::JobSystem::Job *curJob)
+// queue a job whose parents have all completed, on the given thread
+void EnqueueJob(JobThread *thread, Threading::JobSystem::Job *job)
 {
-  // default to ready to run if there are no parents
-  bool dependenciesSatisfied = true;
+  if(tracing)
+    job->readyTime = traceTimer.GetMicroseconds();
 
-  // check all parent jobs if they're completed. This is conservative,
-  // they might have finished but not updated state or one might finish after
-  // we checked it, but that's fine
-  for(Threading::JobSystem::Job *p : curJob->parents)
   {
-    if(Atomic::CmpExch32(&p->state, 0, 0) == 0)
-      dependenciesSatisfied = false;
+    SCOPED_LOCK(thread->queueLock);
+    RandomSleepSpin(true);
+    thread->queue.push_back(job);
+  }
+
+  Atomic::Inc32(&queuedJobs);
 
-    // check that parent state is valid, should either be finished or not
-    int32_t state = p->state;
-    RDCASSERT(state == 0 || state == 1);
+  RandomSleepSpin(false);
+
+  TryWakeFirstSleepingWorker(thread->idx);
+}
+
+// take a job from our own queue, or steal the oldest job from another thread's queue
+Threading::JobSystem::Job *TryGetJob(JobThread *thread)
+{
+  if(Atomic::CmpExch32(&queuedJobs, 0, 0) == 0)
+    return NULL;
+
+  Threading::JobSystem::Job *ret = NULL;
+
+  {
+    SCOPED_LOCK(thread->queueLock);
+    RandomSleepSpin(true);
+    ret = thread->queue.pop_back();
   }
 
-  // if we can run the job, run it. Return whether or not it was run
-  if(dependenciesSatisfied)
+  for(size_t i = 1; ret == NULL && i < jobThreads.size(); i++)
   {
-    curJob->run();
-    return true;
+    JobThread *victim = jobThreads[(thread->idx + i) % jobThreads.size()];
+
+    RandomSleepSpin(false);
+
+    SCOPED_LOCK(victim->queueLock);
+    RandomSleepSpin(true);
+    ret = victim->queue.pop_front();
   }
 
-  return false;
+  if(ret)
+    Atomic::Dec32(&queuedJobs);
+
+  return ret;
 }
 
-void WorkerThread(JobWorker &worker)
+void RunJob(JobThread *thread, Threading::JobSystem::Job *job)
 {
-  // outer loop until shutdown
-  while(true)
+  // run should not be called multiple times
+  RDCASSERT(job->state == 0);
+
+  const double start = tracing ? traceTimer.GetMicroseconds() : 0.0;
+
+  job->callback();
+
+  if(tracing)
+    RecordTraceEvent(thread, Threading::JobSystem::TraceEvent::Job, start, job);
+
+  // release anything captured by the callback now rather than at the next sync
+  job->callback = std::function<void()>();
+
+  rdcarray<Threading::JobSystem::Job *> dependents;
+
   {
-    // job we grabbed to work on
-    Threading::JobSystem::Job *curJob = NULL;
-    // if there is even more work to do
-    bool moreWork = false;
+    SCOPED_LOCK(job->lock);
+    Atomic::Inc32(&job->state);
+    dependents.swap(job->dependents);
+  }
 
-    RandomSleepSpin(false);
+  // this is the last access to the job. Once it's retired, WaitForJob can return and the job can
+  // be deleted by its owner
+  int32_t state = Atomic::Inc32(&job->state);
 
-    {
-      SCOPED_LOCK(queueLock);
+  // run should not be called multiple times
+  RDCASSERT(state == 2);
+
+  RandomSleepSpin(false);
 
-      RandomSleepSpin(true);
+  // queue any dependents that were only waiting on us. They go on our own queue since they're
+  // likely to touch the same data
+  for(Threading::JobSystem::Job *dep : dependents)
+    if(Atomic::Dec32(&dep->pendingParents) == 0)
+      EnqueueJob(thread, dep);
 
-      // grab a job if the queue is non-empty
-      if(!jobQueue.empty())
-      {
-        curJob = jobQueue.back();
-        jobQueue.pop_back();
-      }
-      // if there's even more work, note it so we can wake up a sibling worker as needed
-      moreWork = !jobQueue.empty();
+  // this must come last, once it's decremented a sync could return and the caller may assume all
+  // work is done
+  Atomic::Dec32(&outstandingJobs);
+}
 
-      RandomSleepSpin(true);
+// called while waiting on jobs running elsewhere. Yield at first since jobs can be short, but sleep
+// if we've been waiting a while so we don't starve the threads doing the work
+void BackoffWait(uint32_t &idleLoops)
+{
+  if(idleLoops++ < 100)
+    Threading::Sleep(0);
+  else
+    Threading::Sleep(1);
+}
 
-      // shut down immediately if requested, check this in the lock
-      if(shutdown)
-        break;
-    }
+void WorkerThread(JobThread &worker)
+{
+  Threading::SetTLSValue(jobThreadSlot, &worker);
 
+  // outer loop until shutdown
+  while(Atomic::CmpExch32(&shutdown, 0, 0) == 0)
+  {
     RandomSleepSpin(false);
 
-    // if there's no more work, go to sleep
-    if(!curJob)
-    {
-      RDCASSERT(worker.running == 1);
-      Atomic::Dec32(&worker.running);
+    Threading::JobSystem::Job *curJob = TryGetJob(&worker);
 
-      RandomSleepSpin(false);
+    RandomSleepSpin(false);
 
-      // check the queue once more here to allow constant forward progress without a sync.
-      // If the main thread pushed work after we last checked, but it thought we were running so
-      // didn't wake us up and we got here, we can check for work and re-wake without a semaphore
-      // signal that might never come.
-      // If there's no work here then when the main thread adds more it will definitely see us (or
-      // at least one worker) not running and wake us
-      {
-        SCOPED_LOCK(queueLock);
-        RandomSleepSpin(true);
-
-        if(!jobQueue.empty())
-        {
-          RandomSleepSpin(true);
-
-          Atomic::Inc32(&worker.running);
-          continue;
-        }
-      }
+    if(curJob)
+    {
+      // if there's more work to do, try to wake a sleeping worker too. If none are sleeping, this
+      // will do nothing
+      if(Atomic::CmpExch32(&queuedJobs, 0, 0) > 0)
+        TryWakeFirstSleepingWorker(worker.idx);
 
       RandomSleepSpin(false);
 
-      worker.semaphore->WaitForWake();
-      RDCASSERT(worker.running == 0);
-      Atomic::Inc32(&worker.running);
-
-      RandomSleepSpin(false);
+      RunJob(&worker, curJob);
+      continue;
     }
 
-    // if there's more work to do, try to wake a sleeping worker too. If none are sleeping, this will do nothing
-    if(moreWork)
-      TryWakeFirstSleepingWorker(worker.idx);
+    // if there's no more work, go to sleep
+    RDCASSERT(worker.running == 1);
+    Atomic::Dec32(&worker.running);
 
     RandomSleepSpin(false);
 
-    // run our job, and push it back onto the queue if it couldn't be run
-    if(curJob && !RunJobIfReady(curJob))
+    // check once more here to allow constant forward progress without a sync.
+    // If work was queued after we last checked, but whoever queued it thought we were running so
+    // didn't wake us up and we got here, we can pick it up without a semaphore signal that might
+    // never come.
+    // If there's no work here then when more is added the adding thread will definitely see us (or
+    // at least one worker) not running and wake us
+    if(Atomic::CmpExch32(&queuedJobs, 0, 0) > 0 || Atomic::CmpExch32(&shutdown, 0, 0) != 0)
     {
-      SCOPED_LOCK(queueLock);
+      Atomic::Inc32(&worker.running);
+      continue;
+    }
+
+    RandomSleepSpin(false);
 
-      RandomSleepSpin(true);
-      jobQueue.insert(0, curJob);
+    const double idleStart = tracing ? traceTimer.GetMicroseconds() : 0.0;
 
-      RandomSleepSpin(true);
-    }
+    worker.semaphore->WaitForWake();
+    Atomic::Inc32(&worker.running);
+
+    if(tracing)
+      RecordTraceEvent(&worker, Threading::JobSystem::TraceEvent::Idle, idleStart);
+
+    RandomSleepSpin(false);
   }
 
   Atomic::Dec32(&worker.running);
+
+  Threading::SetTLSValue(jobThreadSlot, NULL);
 }
 
 namespace JobSystem
 {
-void Init(uint32_t numThreads)
+static void InitLocked(uint32_t numThreads)
 {
   mainThread = Threading::GetCurrentID();
 
-  shutdown = false;
-  jobQueue.clear();
+  shutdown = 0;
+  queuedJobs = 0;
+  outstandingJobs = 0;
+
+  if(jobThreadSlot == 0)
+    jobThreadSlot = Threading::AllocateTLSSlot();
 
   // if numThreads is 0, auto-select a number of threads
   if(numThreads == 0)
@@ -334,17 +495,50 @@ void Init(uint32_t numThreads)
 
   RDCLOG("Initialising job system with %u threads", numThreads);
 
-  workers.resize(numThreads);
+  numWorkers = numThreads;
+
+  // create all the thread state before starting any threads, since they can steal from each other
+  jobThreads.resize(numThreads + 1);
+  for(size_t i = 0; i < jobThreads.size(); i++)
+  {
+    jobThreads[i] = new JobThread;
+    jobThreads[i]->idx = i;
+  }
+
+  Threading::SetTLSValue(jobThreadSlot, jobThreads[numWorkers]);
+
   for(size_t i = 0; i < numThreads; i++)
   {
-    workers[i].idx = i;
-    workers[i].semaphore = Threading::Semaphore::Create();
-    workers[i].thread = Threading::CreateThread([i] { WorkerThread(workers[i]); });
+    JobThread *worker = jobThreads[i];
+    worker->semaphore = Threading::Semaphore::Create();
+    worker->thread = Threading::CreateThread([worker] { WorkerThread(*worker); });
   }
+
+  if(!Replay_Debug_JobTracePath().empty())
+    BeginTrace();
+}
+
+void Init(uint32_t numThreads)
+{
+  SCOPED_LOCK(initLock);
+  InitLocked(numThreads);
+}
+
+bool TryInit(uint32_t numThreads)
+{
+  SCOPED_LOCK(initLock);
+
+  if(mainThread != 0)
+    return false;
+
+  InitLocked(numThreads);
+  return true;
 }
 
 void Shutdown()
 {
+  SCOPED_LOCK(initLock);
+
   if(mainThread == 0)
     return;
 
@@ -352,94 +546,394 @@ void Shutdown()
 
   SyncAllJobs();
 
-  mainThread = 0;
-
+  if(tracing)
   {
-    SCOPED_LOCK(queueLock);
-    shutdown = true;
+    rdcarray<TraceEvent> trace = EndTrace();
+
+    rdcstr path = Replay_Debug_JobTracePath();
+    if(!path.empty())
+    {
+      RDCLOG("Job system trace:\n%s", SummariseTrace(trace).c_str());
+
+      RDResult res = ExportTraceChrome(path, trace);
+      if(res != ResultCode::Succeeded)
+        RDCERR("Couldn't write job trace: %s", res.message.c_str());
+      else
+        RDCLOG("Wrote job trace to %s", path.c_str());
+    }
   }
-  for(size_t i = 0; i < workers.size(); i++)
-    workers[i].semaphore->Wake(1);
 
-  for(size_t i = 0; i < workers.size(); i++)
+  mainThread = 0;
+
+  Atomic::Inc32(&shutdown);
+
+  for(size_t i = 0; i < numWorkers; i++)
+    jobThreads[i]->semaphore->Wake(1);
+
+  for(size_t i = 0; i < numWorkers; i++)
   {
-    Threading::JoinThread(workers[i].thread);
-    Threading::CloseThread(workers[i].thread);
-    workers[i].semaphore->Destroy();
+    Threading::JoinThread(jobThreads[i]->thread);
+    Threading::CloseThread(jobThreads[i]->thread);
+    jobThreads[i]->semaphore->Destroy();
   }
 
-  workers.clear();
+  for(JobThread *t : jobThreads)
+    delete t;
+
+  jobThreads.clear();
+  numWorkers = 0;
+
+  Threading::SetTLSValue(jobThreadSlot, NULL);
 }
 
 void SyncAllJobs()
 {
-  if(workers.empty())
+  if(jobThreads.empty())
     return;
 
   RDCASSERTEQUAL(mainThread, Threading::GetCurrentID());
 
-  while(true)
+  JobThread *self = jobThreads[numWorkers];
+
+  uint32_t idleLoops = 0;
+  double waitStart = tracing ? traceTimer.GetMicroseconds() : 0.0;
+
+  // help run jobs until everything is complete. Since only the main thread or jobs can add jobs,
+  // once this hits 0 nothing else can be added
+  while(Atomic::CmpExch32(&outstandingJobs, 0, 0) > 0)
   {
-    // job we grabbed to work on
-    Job *curJob = NULL;
+    Job *curJob = TryGetJob(self);
 
+    if(curJob)
     {
-      SCOPED_LOCK(queueLock);
-      if(jobQueue.empty())
-        break;
+      if(tracing)
+        RecordTraceEvent(self, TraceEvent::Wait, waitStart);
 
-      curJob = jobQueue.back();
-      jobQueue.pop_back();
-    }
+      TryWakeFirstSleepingWorker();
+      RunJob(self, curJob);
+      idleLoops = 0;
 
-    if(!RunJobIfReady(curJob))
+      waitStart = tracing ? traceTimer.GetMicroseconds() : 0.0;
+    }
+    else
     {
-      SCOPED_LOCK(queueLock);
-      jobQueue.insert(0, curJob);
+      // the remaining jobs are running on workers (or waiting on parents that are)
+      BackoffWait(idleLoops);
     }
+  }
+
+  if(tracing)
+    RecordTraceEvent(self, TraceEvent::Wait, waitStart);
 
-    TryWakeFirstSleepingWorker();
+  // delete all jobs
+  for(JobThread *t : jobThreads)
+  {
+    for(Job *job : t->allocatedJobs)
+      delete job;
+    t->allocatedJobs.clear();
   }
+}
+
+bool IsAvailable()
+{
+  return CurrentJobThread() != NULL;
+}
 
-  // the queue is now empty, but workers may still be running
-  bool workersRunning = false;
-  do
+// add a job. If owned is true the caller is responsible for deleting it after waiting on it,
+// otherwise it's deleted at the next sync
+Job *AddJobInternal(std::function<void()> &&callback, const rdcarray<Job *> &parents, bool owned)
+{
+  JobThread *self = CurrentJobThread();
+
+  RDCASSERTMSG("Jobs can only be added on the main thread or from within a job", self);
+  if(!self)
+    return NULL;
+
+  Job *ret = new Job;
+  ret->callback = std::move(callback);
+
+  if(tracing)
   {
-    workersRunning = false;
+    ret->id = (uint64_t)Atomic::Inc64(&nextTraceJobID);
+    ret->numParents = (uint32_t)parents.size();
+    ret->addedTime = traceTimer.GetMicroseconds();
+  }
+
+  if(!owned)
+    self->allocatedJobs.push_back(ret);
 
-    // if any worker is running, we keep looping. We know a worker can't wake up again after it's
-    // finished running because we force-drained the queue and nothing else will be adding work
-    for(size_t i = 0; i < workers.size(); i++)
-      workersRunning |= (Atomic::CmpExch32(&workers[i].running, 1, 1) == 1);
+  Atomic::Inc32(&outstandingJobs);
 
-    // sleep rather than spinning
-    if(workersRunning)
-      Threading::Sleep(1);
+  // register with any parents that haven't completed yet
+  for(Job *p : parents)
+  {
+    if(!p)
+      continue;
+
+    SCOPED_LOCK(p->lock);
+    if(p->state == 0)
+    {
+      Atomic::Inc32(&ret->pendingParents);
+      p->dependents.push_back(ret);
+    }
+  }
 
-  } while(workersRunning);
+  // release the hold we had while registering. If all parents are complete, queue it now
+  if(Atomic::Dec32(&ret->pendingParents) == 0)
+    EnqueueJob(self, ret);
 
-  // delete all jobs
-  for(Job *job : allocatedJobs)
-    delete job;
-  allocatedJobs.clear();
+  return ret;
 }
 
 Job *AddJob(std::function<void()> &&callback, const rdcarray<Job *> &parents)
 {
-  RDCASSERTEQUAL(mainThread, Threading::GetCurrentID());
+  return AddJobInternal(std::move(callback), parents, false);
+}
 
-  Job *ret = new Job;
-  ret->callback = std::move(callback);
-  ret->parents = parents;
+Job *AddOwnedJob(std::function<void()> &&callback, const rdcarray<Job *> &parents)
+{
+  return AddJobInternal(std::move(callback), parents, true);
+}
+
+void DeleteJob(Job *job)
+{
+  if(!job)
+    return;
+
+  // the job must have been waited on, so that nothing else is referencing it
+  RDCASSERT(Atomic::CmpExch32(&job->state, 0, 0) == 2);
+
+  delete job;
+}
+
+void WaitForJob(Job *job)
+{
+  JobThread *self = CurrentJobThread();
+
+  RDCASSERTMSG("Jobs can only be waited on on the main thread or from within a job", self);
+  if(!self || !job)
+    return;
+
+  uint32_t idleLoops = 0;
+  double waitStart = tracing ? traceTimer.GetMicroseconds() : 0.0;
+
+  // run other jobs while we wait, this avoids deadlocks when jobs wait on nested jobs and keeps
+  // this thread busy. Wait for the job to be retired rather than just completed, so that the
+  // thread that ran it is finished with it
+  while(Atomic::CmpExch32(&job->state, 0, 0) < 2)
+  {
+    Job *curJob = TryGetJob(self);
+
+    if(curJob)
+    {
+      if(tracing)
+        RecordTraceEvent(self, TraceEvent::Wait, waitStart);
+
+      RunJob(self, curJob);
+      idleLoops = 0;
+
+      waitStart = tracing ? traceTimer.GetMicroseconds() : 0.0;
+    }
+    else
+    {
+      BackoffWait(idleLoops);
+    }
+  }
+
+  if(tracing)
+    RecordTraceEvent(self, TraceEvent::Wait, waitStart);
+}
+
+void ParallelFor(size_t count, size_t grainSize, std::function<void(size_t begin, size_t end)> func)
+{
+  if(count == 0)
+    return;
+
+  grainSize = RDCMAX(grainSize, (size_t)1);
 
-  allocatedJobs.push_back(ret);
+  const size_t numChunks = (count + grainSize - 1) / grainSize;
 
+  // if we're not able to spread this out, just run it inline
+  if(numChunks == 1 || numWorkers == 0 || !IsAvailable() || numChunks > INT32_MAX)
   {
-    SCOPED_LOCK(queueLock);
-    jobQueue.insert(0, ret);
+    func(0, count);
+    return;
   }
 
-  TryWakeFirstSleepingWorker();
+  // rather than a job per chunk, a job per thread takes chunks until there are none left. That
+  // balances load without allocating a job for every chunk
+  int32_t nextChunk = 0;
+
+  std::function<void()> runChunks = [&nextChunk, numChunks, count, grainSize, &func]() {
+    while(true)
+    {
+      size_t chunk = size_t(Atomic::Inc32(&nextChunk) - 1);
+      if(chunk >= numChunks)
+        break;
+
+      func(chunk * grainSize, RDCMIN(count, (chunk + 1) * grainSize));
+    }
+  };
+
+  // these jobs are owned here rather than deleted at the next sync, since this can be called
+  // repeatedly (e.g. every shader debug step) with no sync in between
+  rdcarray<Job *> jobs;
+  for(size_t i = 0; i < RDCMIN(numChunks - 1, numWorkers); i++)
+  {
+    std::function<void()> cb = runChunks;
+    jobs.push_back(AddOwnedJob(std::move(cb)));
+  }
+
+  // this thread takes chunks too
+  runChunks();
+
+  for(Job *job : jobs)
+  {
+    WaitForJob(job);
+    DeleteJob(job);
+  }
+}
+
+void BeginTrace()
+{
+  if(jobThreads.empty())
+    return;
+
+  SyncAllJobs();
+
+  for(JobThread *t : jobThreads)
+  {
+    SCOPED_LOCK(t->traceLock);
+    t->trace.clear();
+  }
+
+  nextTraceJobID = 0;
+  traceTimer.Restart();
+  tracing = true;
+}
+
+rdcarray<TraceEvent> EndTrace()
+{
+  rdcarray<TraceEvent> ret;
+
+  if(jobThreads.empty() || !tracing)
+    return ret;
+
+  SyncAllJobs();
+
+  tracing = false;
+
+  for(JobThread *t : jobThreads)
+  {
+    SCOPED_LOCK(t->traceLock);
+    ret.append(t->trace);
+    t->trace.clear();
+  }
+
+  std::sort(ret.begin(), ret.end(),
+            [](const TraceEvent &a, const TraceEvent &b) { return a.start < b.start; });
+
+  return ret;
+}
+
+rdcstr SummariseTrace(const rdcarray<TraceEvent> &events)
+{
+  // decade buckets from <10us up to >=1s
+  static const uint32_t numBuckets = 7;
+  static const char *bucketNames[numBuckets] = {
+      "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s",
+  };
+
+  struct Histogram
+  {
+    const char *name;
+    uint64_t counts[numBuckets];
+    double total;
+    double max;
+
+    void Add(double micro)
+    {
+      uint32_t bucket = 0;
+      for(double limit = 10.0; bucket + 1 < numBuckets && micro >= limit; limit *= 10.0)
+        bucket++;
+      counts[bucket]++;
+      total += micro;
+      max = RDCMAX(max, micro);
+    }
+  };
+
+  Histogram hists[] = {
+      {"Parent wait (added -> ready)"},
+      {"Queue delay (ready -> start)"},
+      {"Run time"},
+  };
+
+  struct ThreadTotals
+  {
+    double busy, idle, wait;
+  };
+  // workers, with the main thread last
+  rdcarray<ThreadTotals> threads;
+  uint32_t numTracedWorkers = 0;
+
+  for(const TraceEvent &ev : events)
+    if(ev.thread != TraceEvent::MainThread)
+      numTracedWorkers = RDCMAX(numTracedWorkers, ev.thread + 1);
+
+  threads.resize(numTracedWorkers + 1);
+
+  uint64_t numJobs = 0;
+  double traceEnd = 0.0;
+
+  for(const TraceEvent &ev : events)
+  {
+    ThreadTotals &totals = threads[RDCMIN(ev.thread, numTracedWorkers)];
+
+    const double duration = ev.end - ev.start;
+    traceEnd = RDCMAX(traceEnd, ev.end);
+
+    if(ev.type == TraceEvent::Job)
+    {
+      numJobs++;
+      hists[0].Add(ev.ready - ev.added);
+      hists[1].Add(ev.start - ev.ready);
+      hists[2].Add(duration);
+      totals.busy += duration;
+    }
+    else if(ev.type == TraceEvent::Idle)
+    {
+      totals.idle += duration;
+    }
+    else if(ev.type == TraceEvent::Wait)
+    {
+      totals.wait += duration;
+    }
+  }
+
+  rdcstr ret = StringFormat::Fmt("%llu jobs over %.2f ms\n", numJobs, traceEnd / 1000.0);
+
+  ret += StringFormat::Fmt("  %-30s", "");
+  for(uint32_t b = 0; b < numBuckets; b++)
+    ret += StringFormat::Fmt(" %8s", bucketNames[b]);
+  ret += StringFormat::Fmt(" %10s %10s\n", "avg ms", "max ms");
+
+  for(const Histogram &h : hists)
+  {
+    ret += StringFormat::Fmt("  %-30s", h.name);
+    for(uint32_t b = 0; b < numBuckets; b++)
+      ret += StringFormat::Fmt(" %8llu", h.counts[b]);
+    ret += StringFormat::Fmt(" %10.3f %10.3f\n", numJobs ? h.total / numJobs / 1000.0 : 0.0,
+                             h.max / 1000.0);
+  }
+
+  for(size_t i = 0; i < threads.size(); i++)
+  {
+    const rdcstr name =
+        i + 1 == threads.size() ? rdcstr("Main") : StringFormat::Fmt("Worker %zu", i);
+    ret += StringFormat::Fmt("  %-10s busy %10.2f ms, idle %10.2f ms, waiting %10.2f ms\n",
+                             name.c_str(), threads[i].busy / 1000.0, threads[i].idle / 1000.0,
+                             threads[i].wait / 1000.0);
+  }
 
   return ret;
 }
@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include "api/replay/replay_enums.h"
 #include "threading.h"
 
 namespace Threading
@@ -133,6 +134,106 @@ void RunJobTests()
     for(size_t c = 0; c < numChains; c++)
       CHECK(a[c] == b[c]);
   }
+
+  // dependency on jobs that have already completed
+  {
+    bool flag = false;
+    Threading::JobSystem::Job *first = Threading::JobSystem::AddJob([]() {});
+    Threading::JobSystem::WaitForJob(first);
+    Threading::JobSystem::AddJob([&flag]() { flag = true; }, {first});
+
+    Threading::JobSystem::SyncAllJobs();
+
+    CHECK(flag);
+  }
+
+  // owned jobs, added and freed repeatedly with no sync
+  {
+    CHECK(Threading::JobSystem::IsAvailable());
+
+    int32_t count = 0;
+    for(int32_t i = 0; i < 100; i++)
+    {
+      Threading::JobSystem::Job *job =
+          Threading::JobSystem::AddOwnedJob([&count]() { Atomic::Inc32(&count); });
+      Threading::JobSystem::WaitForJob(job);
+      Threading::JobSystem::DeleteJob(job);
+    }
+
+    CHECK(count == 100);
+  }
+
+  // nested jobs, both waited on by their parent and left for the sync
+  {
+    static const int32_t numOuter = 20;
+    static const int32_t numInner = 50;
+    int32_t waited = 0;
+    int32_t unwaited = 0;
+
+    for(int32_t o = 0; o < numOuter; o++)
+    {
+      Threading::JobSystem::AddJob([&waited, &unwaited]() {
+        rdcarray<Threading::JobSystem::Job *> inner;
+        for(int32_t i = 0; i < numInner; i++)
+        {
+          inner.push_back(Threading::JobSystem::AddJob([&waited]() { Atomic::Inc32(&waited); }));
+          Threading::JobSystem::AddJob([&unwaited]() { Atomic::Inc32(&unwaited); });
+        }
+
+        for(Threading::JobSystem::Job *job : inner)
+          Threading::JobSystem::WaitForJob(job);
+      });
+    }
+
+    Threading::JobSystem::SyncAllJobs();
+
+    CHECK(waited == numOuter * numInner);
+    CHECK(unwaited == numOuter * numInner);
+  }
+
+  // parallel for, on the main thread and nested within jobs
+  {
+    rdcarray<uint32_t> values;
+    values.resize(100000);
+
+    Threading::JobSystem::ParallelFor(values.size(), 64, [&values](size_t begin, size_t end) {
+      for(size_t i = begin; i < end; i++)
+        values[i] = uint32_t(i * 3);
+    });
+
+    bool allSet = true;
+    for(size_t i = 0; i < values.size(); i++)
+      allSet &= (values[i] == uint32_t(i * 3));
+    CHECK(allSet);
+
+    static const size_t numJobs = 16;
+    uint64_t sums[numJobs] = {};
+
+    for(size_t j = 0; j < numJobs; j++)
+    {
+      Threading::JobSystem::AddJob([&sums, &values, j]() {
+        rdcarray<uint64_t> partials;
+        partials.resize(values.size() / 1000);
+        Threading::JobSystem::ParallelFor(partials.size(), 4, [&](size_t begin, size_t end) {
+          for(size_t p = begin; p < end; p++)
+            for(size_t i = p * 1000; i < (p + 1) * 1000; i++)
+              partials[p] += values[i] + j;
+        });
+
+        for(uint64_t p : partials)
+          sums[j] += p;
+      });
+    }
+
+    Threading::JobSystem::SyncAllJobs();
+
+    uint64_t expected = 0;
+    for(uint32_t v : values)
+      expected += v;
+
+    for(size_t j = 0; j < numJobs; j++)
+      CHECK(sums[j] == expected + j * values.size());
+  }
 }
 
 TEST_CASE("Check job system behaviour is correct with common thread counts", "[jobs]")
@@ -158,6 +259,91 @@ TEST_CASE("Check job system behaviour is correct with common thread counts", "[j
   Threading::JobSystem::Shutdown();
 }
 
+TEST_CASE("Check job system is only initialised once by TryInit", "[jobs]")
+{
+  CHECK_FALSE(Threading::JobSystem::IsAvailable());
+
+  REQUIRE(Threading::JobSystem::TryInit(2));
+  CHECK(Threading::JobSystem::IsAvailable());
+
+  // another thread can't take over while it's running
+  bool otherInit = true;
+  Threading::ThreadHandle other = Threading::CreateThread(
+      [&otherInit]() { otherInit = Threading::JobSystem::TryInit(2); });
+  Threading::JoinThread(other);
+  Threading::CloseThread(other);
+
+  CHECK_FALSE(otherInit);
+  CHECK_FALSE(Threading::JobSystem::TryInit(2));
+
+  RunJobTests();
+
+  Threading::JobSystem::Shutdown();
+
+  CHECK_FALSE(Threading::JobSystem::IsAvailable());
+}
+
+TEST_CASE("Check job system tracing", "[jobs]")
+{
+  Threading::randomSleepRange = 0;
+  Threading::randomSpinRange = 0;
+
+  Threading::JobSystem::Init(2);
+
+  Threading::JobSystem::BeginTrace();
+
+  rdcarray<Threading::JobSystem::Job *> parents;
+  for(int i = 0; i < 10; i++)
+    parents.push_back(Threading::JobSystem::AddJob([]() { Threading::Sleep(1); }));
+
+  Threading::JobSystem::AddJob([]() {}, parents);
+
+  rdcarray<Threading::JobSystem::TraceEvent> trace = Threading::JobSystem::EndTrace();
+
+  Threading::JobSystem::Shutdown();
+
+  uint32_t numJobs = 0;
+  for(const Threading::JobSystem::TraceEvent &ev : trace)
+  {
+    CHECK(ev.end >= ev.start);
+    CHECK((ev.thread < 2 || ev.thread == Threading::JobSystem::TraceEvent::MainThread));
+
+    if(ev.type == Threading::JobSystem::TraceEvent::Job)
+    {
+      numJobs++;
+
+      CHECK(ev.added <= ev.ready);
+      CHECK(ev.ready <= ev.start);
+
+      // only the last job has parents, and it can't be ready until they've all run
+      if(ev.numParents > 0)
+      {
+        CHECK(ev.numParents == 10);
+        for(const Threading::JobSystem::TraceEvent &parent : trace)
+          if(parent.type == Threading::JobSystem::TraceEvent::Job && parent.numParents == 0)
+            CHECK(parent.end <= ev.ready);
+      }
+    }
+  }
+
+  CHECK(numJobs == 11);
+
+  rdcstr summary = Threading::JobSystem::SummariseTrace(trace);
+  CHECK(summary.contains("11 jobs"));
+  CHECK(summary.contains("Main"));
+
+  rdcstr filename = FileIO::GetTempFolderFilename() + "/jobtrace.json";
+  CHECK(Threading::JobSystem::ExportTraceChrome(filename, trace).code == ResultCode::Succeeded);
+
+  rdcstr json;
+  FileIO::ReadAll(filename, json);
+  CHECK(json.beginsWith("{"));
+  CHECK(json.contains("\"traceEvents\""));
+  CHECK(json.contains("\"Job 11\""));
+
+  FileIO::Delete(filename);
+}
+
 // since lock contention can get really bad with many threads, only do this test once
 TEST_CASE("Stress test job system with many threads", "[jobs][stress]")
 {
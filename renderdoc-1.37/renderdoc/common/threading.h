@@ -115,9 +115,68 @@ namespace JobSystem
 {
 struct Job;
 void Init(uint32_t numThreads = 0);
+// initialises the job system with this as the main thread, unless it's already running. Returns
+// true if it was initialised, in which case the caller must Shutdown() on this thread when done
+bool TryInit(uint32_t numThreads = 0);
 void Shutdown();
+// returns true if jobs can be added on this thread: the job system is initialised and this is the
+// main thread or a job
+bool IsAvailable();
+// can be called on the main thread, or from within a job to add nested work. The job is queued once
+// all of its parents have completed.
 Job *AddJob(std::function<void()> &&cb, const rdcarray<Job *> &parents = {});
+// like AddJob, but the job isn't freed by SyncAllJobs. The caller must WaitForJob then DeleteJob,
+// for code that adds jobs repeatedly without a sync in between
+Job *AddOwnedJob(std::function<void()> &&cb, const rdcarray<Job *> &parents = {});
+void DeleteJob(Job *job);
+// wait for a job to complete, running other jobs on this thread in the meantime. Can be called on
+// the main thread or from within a job
+void WaitForJob(Job *job);
+// split [0, count) into chunks of grainSize and call func(begin, end) for each in parallel,
+// returning once all chunks have completed. Can be called on the main thread or from within a job
+void ParallelFor(size_t count, size_t grainSize, std::function<void(size_t begin, size_t end)> func);
 void SyncAllJobs();
+
+// a span of time recorded while tracing, on a worker or the main thread
+struct TraceEvent
+{
+  enum Type : uint32_t
+  {
+    // a job running
+    Job,
+    // a worker asleep with nothing to do
+    Idle,
+    // the main thread in SyncAllJobs, or any thread blocked in WaitForJob, not counting time spent
+    // running other jobs in the meantime
+    Wait,
+  };
+
+  Type type;
+  static const uint32_t MainThread = ~0U;
+
+  // the worker index, or MainThread
+  uint32_t thread;
+
+  // for jobs, a unique ID and the number of parents it was added with
+  uint64_t id;
+  uint32_t numParents;
+
+  // microseconds since tracing began. For jobs, added is when AddJob was called and ready is when
+  // its parents had all completed and it was queued. For other events these are the same as start
+  double added, ready, start, end;
+};
+
+// opt-in tracing of job timings. Both must be called on the main thread and will sync all jobs.
+// Tracing also starts automatically on Init() if the Replay.Debug.JobTracePath config is set, in
+// which case it's written out on Shutdown().
+void BeginTrace();
+rdcarray<TraceEvent> EndTrace();
+
+// a human readable summary of a trace with latency histograms and thread utilisation
+rdcstr SummariseTrace(const rdcarray<TraceEvent> &events);
+// write a trace as a Chrome profiler JSON, implemented with the other chrome exporter in
+// serialise/codecs/chrome_json_codec.cpp
+RDResult ExportTraceChrome(const rdcstr &filename, const rdcarray<TraceEvent> &events);
 };
 
 };
@@ -60,6 +60,17 @@ RDOC_CONFIG(bool, Replay_Debug_PrintChunkTimings, false, "Print stats of chunk p
 RDOC_CONFIG(bool, Replay_Debug_SingleThreadedCompilation, false,
             "Compile all shaders and PSOs single-threaded.");
 
+RDOC_CONFIG(bool, Replay_Debug_SingleThreadedShaderDebugging, false,
+            "Step all lanes of a debugged shader's workgroup on the replay thread.");
+
+RDOC_CONFIG(uint32_t, Replay_Debug_ShaderCheckpointInterval, 1000,
+            "How many steps apart the shader debugger saves a checkpoint of the complete shader "
+            "state, to be able to seek backwards by re-executing. 0 disables checkpoints.");
+
+RDOC_CONFIG(uint32_t, Replay_Debug_ShaderMaxCheckpoints, 32,
+            "The most checkpoints the shader debugger keeps for one debugged invocation. When "
+            "exceeded, every other checkpoint is dropped and the interval doubles.");
+
 // this is declared centrally so it can be shared with any backend - the name is a misnomer but kept
 // for backwards compatibility reasons.
 RDOC_CONFIG(rdcarray<rdcstr>, DXBC_Debug_SearchDirPaths, {},
@@ -2036,8 +2047,13 @@ void RenderDoc::FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber)
       size_t sz = 0;
       Callstack::GetLoadedModules(NULL, sz);
 
+      // retry with the new size if a module was loaded in between
       byte *buf = new byte[sz];
-      Callstack::GetLoadedModules(buf, sz);
+      while(!Callstack::GetLoadedModules(buf, sz))
+      {
+        delete[] buf;
+        buf = new byte[sz];
+      }
 
       w->Write(buf, sz);
 
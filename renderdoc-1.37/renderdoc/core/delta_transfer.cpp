@@ -0,0 +1,444 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "delta_transfer.h"
+#include "api/replay/rdcflathashmap.h"
+#include "zstd/zstd.h"
+
+// the granularity at which reference data is indexed. Matches can be extended to any length and
+// start at any offset in the new data, but must cover at least one whole block to be found.
+// Smaller blocks find more matches but make the index bigger and produce more, shorter copies.
+static const size_t DeltaBlockSize = 64;
+
+// once a literal run is this long we start skipping ahead instead of testing every byte, so that
+// data which has no match anywhere doesn't cost a hash lookup per byte.
+static const size_t DeltaSkipThreshold = 1024;
+
+// the shortest run of unchanged bytes at the start of a changed block that is worth a copy op
+// instead of being sent as part of the literal run.
+static const size_t DeltaMinPrefixCopy = 8;
+
+// the op stream is only an intermediate, we compress it at a fast level since the heavy lifting of
+// removing redundancy is done by the block matching.
+static const int DeltaCompressionLevel = 3;
+
+static const uint32_t DeltaHashMultiplier = 0x01000193U;
+
+enum class DeltaOp : byte
+{
+  Literal = 0,
+  Copy = 1,
+};
+
+static uint32_t BlockHash(const byte *data)
+{
+  uint32_t hash = 0;
+  for(size_t i = 0; i < DeltaBlockSize; i++)
+    hash = hash * DeltaHashMultiplier + data[i];
+  return hash;
+}
+
+static uint32_t BlockHashOutFactor()
+{
+  // the multiplier to the power of the block size minus one, the factor applied to the byte that
+  // leaves the window when rolling.
+  uint32_t factor = 1;
+  for(size_t i = 0; i < DeltaBlockSize - 1; i++)
+    factor *= DeltaHashMultiplier;
+  return factor;
+}
+
+static size_t MatchLength(const byte *a, const byte *b, size_t maxLength)
+{
+  size_t len = 0;
+
+  while(len + sizeof(uint64_t) <= maxLength)
+  {
+    uint64_t x, y;
+    memcpy(&x, a + len, sizeof(x));
+    memcpy(&y, b + len, sizeof(y));
+    if(x != y)
+      break;
+    len += sizeof(uint64_t);
+  }
+
+  while(len < maxLength && a[len] == b[len])
+    len++;
+
+  return len;
+}
+
+static void WriteVarint(bytebuf &out, uint64_t val)
+{
+  while(val >= 0x80)
+  {
+    out.push_back(byte(val & 0x7f) | 0x80);
+    val >>= 7;
+  }
+  out.push_back(byte(val));
+}
+
+static bool ReadVarint(const byte *&cur, const byte *end, uint64_t &val)
+{
+  val = 0;
+  for(uint32_t shift = 0; shift < 64; shift += 7)
+  {
+    if(cur >= end)
+      return false;
+
+    byte b = *(cur++);
+    val |= uint64_t(b & 0x7f) << shift;
+
+    if((b & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+static void WriteLiteral(bytebuf &ops, const byte *data, size_t length, DeltaTransferStats &stats)
+{
+  if(length == 0)
+    return;
+
+  ops.push_back(byte(DeltaOp::Literal));
+  WriteVarint(ops, length);
+  ops.append(data, length);
+
+  stats.literalBytes += length;
+}
+
+static void WriteCopy(bytebuf &ops, size_t ref, size_t offset, size_t length,
+                      DeltaTransferStats &stats)
+{
+  ops.push_back(byte(DeltaOp::Copy));
+  WriteVarint(ops, ref);
+  WriteVarint(ops, offset);
+  WriteVarint(ops, length);
+
+  stats.copiedBytes += length;
+}
+
+RDResult EncodeDelta(const rdcarray<const bytebuf *> &references, const bytebuf &newData,
+                     bytebuf &encoded, DeltaTransferStats *stats)
+{
+  DeltaTransferStats local;
+
+  const byte *src = newData.data();
+  const size_t size = newData.size();
+
+  bytebuf ops;
+  ops.reserve(64);
+  WriteVarint(ops, size);
+
+  const bytebuf *primary = references.empty() ? NULL : references[0];
+
+  // index every whole block in each reference. Where blocks collide we keep the first, which
+  // prefers the primary reference and earlier data.
+  rdcflathashmap<uint32_t, uint64_t> blockIndex;
+
+  if(size >= DeltaBlockSize)
+  {
+    size_t totalBlocks = 0;
+    for(const bytebuf *ref : references)
+      if(ref)
+        totalBlocks += ref->size() / DeltaBlockSize;
+
+    blockIndex.reserve(totalBlocks);
+
+    for(size_t r = 0; r < references.size(); r++)
+    {
+      if(!references[r])
+        continue;
+
+      const byte *refData = references[r]->data();
+      const size_t refSize = references[r]->size();
+
+      for(size_t offs = 0; offs + DeltaBlockSize <= refSize; offs += DeltaBlockSize)
+        blockIndex.insert({BlockHash(refData + offs), (uint64_t(r) << 48) | offs});
+    }
+  }
+
+  const uint32_t outFactor = BlockHashOutFactor();
+
+  size_t pos = 0;
+  size_t literalStart = 0;
+  uint32_t hash = 0;
+  bool hashValid = false;
+
+  while(pos + DeltaBlockSize <= size)
+  {
+    size_t matchRef = ~0U;
+    size_t matchOffs = 0;
+
+    // the common case is that a region is unchanged from the last time this resource was sent, so
+    // test the same offset in the primary reference before doing any lookup.
+    if(primary && pos + DeltaBlockSize <= primary->size())
+    {
+      size_t same = MatchLength(src + pos, primary->data() + pos, DeltaBlockSize);
+
+      if(same == DeltaBlockSize)
+      {
+        matchRef = 0;
+        matchOffs = pos;
+      }
+      else if(pos == literalStart && same >= DeltaMinPrefixCopy)
+      {
+        // the change starts part-way into this block. Copy the unchanged bytes before it, as a
+        // match found further on can only extend backwards as far as the start of the literal run.
+        WriteCopy(ops, 0, pos, same, local);
+
+        pos += same;
+        literalStart = pos;
+        hashValid = false;
+        continue;
+      }
+    }
+
+    if(matchRef == ~0U)
+    {
+      if(!hashValid)
+      {
+        hash = BlockHash(src + pos);
+        hashValid = true;
+      }
+
+      auto it = blockIndex.find(hash);
+      if(it != blockIndex.end())
+      {
+        size_t r = size_t(it->second >> 48);
+        size_t offs = size_t(it->second & 0xffffffffffffULL);
+
+        // the hash is weak, so verify the block
+        if(memcmp(src + pos, references[r]->data() + offs, DeltaBlockSize) == 0)
+        {
+          matchRef = r;
+          matchOffs = offs;
+        }
+      }
+    }
+
+    if(matchRef != ~0U)
+    {
+      const bytebuf &ref = *references[matchRef];
+
+      // extend the match backwards into the pending literal run, since the block index only
+      // contains aligned blocks the real start of the match may be earlier.
+      while(pos > literalStart && matchOffs > 0 && src[pos - 1] == ref[matchOffs - 1])
+      {
+        pos--;
+        matchOffs--;
+      }
+
+      size_t length = MatchLength(src + pos, ref.data() + matchOffs,
+                                  RDCMIN(size - pos, ref.size() - matchOffs));
+
+      WriteLiteral(ops, src + literalStart, pos - literalStart, local);
+      WriteCopy(ops, matchRef, matchOffs, length, local);
+
+      pos += length;
+      literalStart = pos;
+      hashValid = false;
+    }
+    else
+    {
+      // step one byte at a time normally so we can roll the hash, but once we've gone a long way
+      // without finding anything start to skip to bound the cost on data that is all new.
+      size_t step = 1 + (pos - literalStart) / DeltaSkipThreshold;
+
+      if(step == 1)
+      {
+        if(pos + DeltaBlockSize < size)
+          hash = (hash - src[pos] * outFactor) * DeltaHashMultiplier + src[pos + DeltaBlockSize];
+      }
+      else
+      {
+        step = RDCMIN(step, DeltaBlockSize);
+        hashValid = false;
+      }
+
+      pos += step;
+    }
+  }
+
+  WriteLiteral(ops, src + literalStart, size - literalStart, local);
+
+  local.rawBytes = size;
+
+  const size_t bound = ZSTD_compressBound(ops.size());
+
+  encoded.resize(sizeof(uint64_t) + bound);
+
+  uint64_t opsSize = ops.size();
+  memcpy(encoded.data(), &opsSize, sizeof(opsSize));
+
+  size_t compSize = ZSTD_compress(encoded.data() + sizeof(uint64_t), bound, ops.data(), ops.size(),
+                                  DeltaCompressionLevel);
+
+  if(ZSTD_isError(compSize))
+  {
+    encoded.clear();
+    RETURN_ERROR_RESULT(ResultCode::CompressionFailed, "Compression failed: %s",
+                        ZSTD_getErrorName(compSize));
+  }
+
+  encoded.resize(sizeof(uint64_t) + compSize);
+
+  local.encodedBytes = encoded.size();
+
+  if(stats)
+  {
+    stats->rawBytes += local.rawBytes;
+    stats->copiedBytes += local.copiedBytes;
+    stats->literalBytes += local.literalBytes;
+    stats->encodedBytes += local.encodedBytes;
+  }
+
+  return ResultCode::Succeeded;
+}
+
+RDResult DecodeDelta(const rdcarray<const bytebuf *> &references, const bytebuf &encoded,
+                     bytebuf &decoded, DeltaTransferStats *stats)
+{
+  DeltaTransferStats local;
+
+  uint64_t opsSize = 0;
+
+  if(encoded.size() < sizeof(opsSize))
+    RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "Delta data is truncated: %zu bytes",
+                        encoded.size());
+
+  memcpy(&opsSize, encoded.data(), sizeof(opsSize));
+
+  const byte *payload = encoded.data() + sizeof(uint64_t);
+  const size_t payloadSize = encoded.size() - sizeof(uint64_t);
+
+  // check the size against the compressed frame before allocating for it. The frame records its
+  // content size, and each block in it has a 3 byte header and decompresses to at most 128kB, so a
+  // corrupted size is caught here rather than by a huge allocation
+  const uint64_t maxOpsSize = (uint64_t(payloadSize) / 3 + 1) * (128 * 1024);
+  unsigned long long frameSize = ZSTD_getFrameContentSize(payload, payloadSize);
+  if(frameSize == ZSTD_CONTENTSIZE_ERROR || frameSize == ZSTD_CONTENTSIZE_UNKNOWN ||
+     frameSize != opsSize || opsSize > maxOpsSize)
+    RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
+                        "Delta ops size %llu doesn't match the %zu byte compressed payload",
+                        opsSize, payloadSize);
+
+  bytebuf ops;
+  ops.resize((size_t)opsSize);
+
+  size_t decompSize = ZSTD_decompress(ops.data(), ops.size(), payload, payloadSize);
+
+  if(ZSTD_isError(decompSize))
+    RETURN_ERROR_RESULT(ResultCode::CompressionFailed, "Decompression failed: %s",
+                        ZSTD_getErrorName(decompSize));
+
+  if(decompSize != opsSize)
+    RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "Delta ops decompressed to %zu bytes, expected %llu",
+                        decompSize, opsSize);
+
+  const byte *cur = ops.begin();
+  const byte *end = ops.end();
+
+  uint64_t size = 0;
+  if(!ReadVarint(cur, end, size))
+    RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "Delta ops are missing the data size");
+
+  // every output byte comes from a literal in the remaining ops, or from a copy out of a reference.
+  // A copy takes at least 4 bytes of ops, so bound the size before reserving it
+  {
+    uint64_t maxRefSize = 0;
+    for(const bytebuf *ref : references)
+      if(ref)
+        maxRefSize = RDCMAX(maxRefSize, (uint64_t)ref->size());
+
+    const uint64_t remaining = uint64_t(end - cur);
+    if(size > remaining + (remaining / 4) * maxRefSize)
+      RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
+                          "Delta data size %llu is larger than %llu bytes of ops can produce", size,
+                          remaining);
+  }
+
+  bytebuf result;
+  result.reserve((size_t)size);
+
+  while(cur < end)
+  {
+    DeltaOp op = DeltaOp(*(cur++));
+
+    if(op == DeltaOp::Literal)
+    {
+      uint64_t length = 0;
+      if(!ReadVarint(cur, end, length) || length > uint64_t(end - cur) ||
+         result.size() + length > size)
+        RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "Invalid literal in delta at %llu",
+                            (uint64_t)result.size());
+
+      result.append(cur, (size_t)length);
+      cur += length;
+
+      local.literalBytes += length;
+    }
+    else if(op == DeltaOp::Copy)
+    {
+      uint64_t ref = 0, offset = 0, length = 0;
+      if(!ReadVarint(cur, end, ref) || !ReadVarint(cur, end, offset) ||
+         !ReadVarint(cur, end, length))
+        RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "Truncated copy in delta at %llu",
+                            (uint64_t)result.size());
+
+      if(ref >= references.size() || !references[(size_t)ref] ||
+         offset + length > references[(size_t)ref]->size() || result.size() + length > size)
+        RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
+                            "Invalid copy {%llu, %llu, %llu} in delta at %llu", ref, offset,
+                            length, (uint64_t)result.size());
+
+      result.append(references[(size_t)ref]->data() + offset, (size_t)length);
+
+      local.copiedBytes += length;
+    }
+    else
+    {
+      RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "Unknown delta op %u", (uint32_t)op);
+    }
+  }
+
+  if(result.size() != size)
+    RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "Delta produced %llu bytes, expected %llu",
+                        (uint64_t)result.size(), size);
+
+  decoded.swap(result);
+
+  local.rawBytes = size;
+  local.encodedBytes = encoded.size();
+
+  if(stats)
+  {
+    stats->rawBytes += local.rawBytes;
+    stats->copiedBytes += local.copiedBytes;
+    stats->literalBytes += local.literalBytes;
+    stats->encodedBytes += local.encodedBytes;
+  }
+
+  return ResultCode::Succeeded;
+}
@@ -0,0 +1,58 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "api/replay/rdcarray.h"
+#include "api/replay/replay_enums.h"
+#include "common/common.h"
+#include "common/formatting.h"
+#include "common/result.h"
+
+// running totals of what delta encoding has done, so the savings over sending the raw bytes can be
+// reported.
+struct DeltaTransferStats
+{
+  // the size of the data that was encoded/decoded
+  uint64_t rawBytes = 0;
+  // how many of those bytes were copied out of a reference buffer
+  uint64_t copiedBytes = 0;
+  // how many bytes had to be sent as literals
+  uint64_t literalBytes = 0;
+  // the size of the encoded data after compression, as actually transferred
+  uint64_t encodedBytes = 0;
+};
+
+// encodes newData as a list of copies out of the reference buffers and runs of literal bytes, then
+// compresses the result. The reference buffers are matched with a rolling hash over fixed-size
+// blocks so that data which has moved - e.g. a neighbouring mip or slice with similar contents, or
+// a sub-region that scrolled - can still be found. The first reference is assumed to be the
+// previous contents of the same resource and is checked at the same offset first.
+//
+// The same references in the same order must be passed to DecodeDelta to reconstruct the data.
+RDResult EncodeDelta(const rdcarray<const bytebuf *> &references, const bytebuf &newData,
+                     bytebuf &encoded, DeltaTransferStats *stats = NULL);
+
+RDResult DecodeDelta(const rdcarray<const bytebuf *> &references, const bytebuf &encoded,
+                     bytebuf &decoded, DeltaTransferStats *stats = NULL);
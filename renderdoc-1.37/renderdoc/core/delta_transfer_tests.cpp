@@ -0,0 +1,282 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "common/globalconfig.h"
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "common/timing.h"
+#include "delta_transfer.h"
+#include "zstd/zstd.h"
+
+#include "catch/catch.hpp"
+
+static bytebuf MakeNoise(size_t size, uint32_t seed)
+{
+  bytebuf ret;
+  ret.resize(size);
+  uint32_t state = seed;
+  for(size_t i = 0; i < size; i++)
+  {
+    state = state * 1664525U + 1013904223U;
+    ret[i] = byte(state >> 24);
+  }
+  return ret;
+}
+
+static bool RoundTrip(const rdcarray<const bytebuf *> &refs, const bytebuf &data,
+                      DeltaTransferStats &stats)
+{
+  bytebuf encoded;
+  RDResult res = EncodeDelta(refs, data, encoded, &stats);
+  if(res.code != ResultCode::Succeeded)
+    return false;
+
+  bytebuf decoded;
+  res = DecodeDelta(refs, encoded, decoded);
+  if(res.code != ResultCode::Succeeded)
+    return false;
+
+  return decoded == data;
+}
+
+TEST_CASE("Test delta transfer encoding", "[delta]")
+{
+  const bytebuf base = MakeNoise(256 * 1024, 1234);
+
+  SECTION("No references")
+  {
+    DeltaTransferStats stats;
+    CHECK(RoundTrip({}, base, stats));
+    CHECK(stats.copiedBytes == 0);
+    CHECK(stats.literalBytes == base.size());
+  };
+
+  SECTION("Empty and tiny data")
+  {
+    DeltaTransferStats stats;
+    CHECK(RoundTrip({&base}, bytebuf(), stats));
+
+    bytebuf tiny = {1, 2, 3};
+    CHECK(RoundTrip({&base}, tiny, stats));
+    CHECK(RoundTrip({}, tiny, stats));
+  };
+
+  SECTION("Unchanged data")
+  {
+    DeltaTransferStats stats;
+    CHECK(RoundTrip({&base}, base, stats));
+    CHECK(stats.copiedBytes == base.size());
+    CHECK(stats.literalBytes == 0);
+    CHECK(stats.encodedBytes < 64);
+  };
+
+  SECTION("Sparse changes")
+  {
+    bytebuf data = base;
+    for(size_t i = 0; i < data.size(); i += 4096)
+      data[i + 17] ^= 0xff;
+
+    DeltaTransferStats stats;
+    CHECK(RoundTrip({&base}, data, stats));
+    // only single bytes changed, so the literal data should be tiny and not padded out to blocks
+    CHECK(stats.literalBytes == data.size() / 4096);
+    CHECK(stats.encodedBytes < data.size() / 100);
+  };
+
+  SECTION("Shifted data")
+  {
+    // insert some bytes at the start so nothing is at the same offset any more
+    bytebuf data = MakeNoise(37, 99);
+    data.append(base.data(), base.size() - 1000);
+
+    DeltaTransferStats stats;
+    CHECK(RoundTrip({&base}, data, stats));
+    CHECK(stats.literalBytes == 37);
+  };
+
+  SECTION("Matching across references")
+  {
+    const bytebuf other = MakeNoise(64 * 1024, 5678);
+
+    // new data is built out of pieces of both references at arbitrary offsets, plus new data
+    bytebuf data;
+    data.append(other.data() + 1001, 20000);
+    data.append(base.data() + 77777, 30000);
+    data.append(MakeNoise(500, 42));
+    data.append(other.data() + 3, 10000);
+
+    DeltaTransferStats stats;
+    CHECK(RoundTrip({&base, &other}, data, stats));
+    CHECK(stats.literalBytes == 500);
+    CHECK(stats.copiedBytes == data.size() - 500);
+
+    // a missing reference is allowed and is skipped
+    CHECK(RoundTrip({NULL, &other}, data, stats));
+  };
+
+  SECTION("Different size from reference")
+  {
+    bytebuf smaller(base.data(), base.size() / 2);
+    bytebuf larger = base;
+    larger.append(MakeNoise(1000, 7));
+
+    DeltaTransferStats stats;
+    CHECK(RoundTrip({&base}, smaller, stats));
+    CHECK(RoundTrip({&base}, larger, stats));
+    CHECK(RoundTrip({&smaller}, base, stats));
+  };
+
+  SECTION("Corrupted data is rejected")
+  {
+    bytebuf data = base;
+    data[100] ^= 0x1;
+
+    bytebuf encoded;
+    RDResult res = EncodeDelta({&base}, data, encoded);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    bytebuf decoded;
+
+    // decoding against a smaller reference means copies are out of bounds
+    bytebuf smaller(base.data(), 1000);
+    EXPECT_ERROR();
+    res = DecodeDelta({&smaller}, encoded, decoded);
+    CHECK(res.code == ResultCode::FileCorrupted);
+    CHECK(DID_ERROR_HAPPEN());
+    CHECK(decoded.empty());
+
+    EXPECT_ERROR();
+    res = DecodeDelta({&base}, bytebuf(encoded.data(), 4), decoded);
+    CHECK(res.code == ResultCode::FileCorrupted);
+    CHECK(DID_ERROR_HAPPEN());
+
+    EXPECT_ERROR();
+    res = DecodeDelta({&base}, bytebuf(encoded.data(), encoded.size() - 4), decoded);
+    CHECK(res.code != ResultCode::Succeeded);
+    CHECK(DID_ERROR_HAPPEN());
+
+    // a corrupted ops size is rejected before anything is allocated for it
+    {
+      bytebuf badSize = encoded;
+      uint64_t opsSize = ~0ULL >> 4;
+      memcpy(badSize.data(), &opsSize, sizeof(opsSize));
+
+      EXPECT_ERROR();
+      res = DecodeDelta({&base}, badSize, decoded);
+      CHECK(res.code == ResultCode::FileCorrupted);
+      CHECK(DID_ERROR_HAPPEN());
+    }
+  };
+
+  SECTION("Corrupted data size is rejected")
+  {
+    // a delta of only literals, so its declared size can't come from copies
+    bytebuf data = MakeNoise(256, 7);
+
+    bytebuf encoded;
+    RDResult res = EncodeDelta({}, data, encoded);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    // rewrite the ops with the data size varint claiming far more than the literals hold
+    uint64_t opsSize = 0;
+    memcpy(&opsSize, encoded.data(), sizeof(opsSize));
+
+    bytebuf ops;
+    ops.resize((size_t)opsSize);
+    REQUIRE(ZSTD_decompress(ops.data(), ops.size(), encoded.data() + sizeof(uint64_t),
+                            encoded.size() - sizeof(uint64_t)) == opsSize);
+
+    // the size is 256, encoded as the two byte varint 0x80 0x02. Make it 0x80 0x80 ... 0x02
+    bytebuf badOps;
+    badOps.push_back(0x80);
+    for(int i = 0; i < 6; i++)
+      badOps.push_back(0x80);
+    badOps.append(ops.data() + 1, ops.size() - 1);
+
+    bytebuf badEncoded;
+    badEncoded.resize(sizeof(uint64_t) + ZSTD_compressBound(badOps.size()));
+    uint64_t badOpsSize = badOps.size();
+    memcpy(badEncoded.data(), &badOpsSize, sizeof(badOpsSize));
+    size_t compSize = ZSTD_compress(badEncoded.data() + sizeof(uint64_t),
+                                    badEncoded.size() - sizeof(uint64_t), badOps.data(),
+                                    badOps.size(), 1);
+    REQUIRE_FALSE(ZSTD_isError(compSize));
+    badEncoded.resize(sizeof(uint64_t) + compSize);
+
+    bytebuf decoded;
+    EXPECT_ERROR();
+    res = DecodeDelta({}, badEncoded, decoded);
+    CHECK(res.code == ResultCode::FileCorrupted);
+    CHECK(DID_ERROR_HAPPEN());
+  };
+};
+
+TEST_CASE("Benchmark delta transfer encoding", "[delta][!benchmark]")
+{
+  // roughly a 1080p RGBA8 image, with a previous frame and a neighbouring mip-sized reference
+  const bytebuf previous = MakeNoise(1920 * 1080 * 4, 1);
+  const bytebuf neighbour = MakeNoise(960 * 540 * 4, 2);
+
+  bytebuf data = previous;
+  // change a band of rows, as if something moved across part of the screen
+  for(size_t i = 400 * 1920 * 4; i < 480 * 1920 * 4; i++)
+    data[i] = byte(i * 7);
+
+  const bytebuf fresh = MakeNoise(data.size(), 3);
+
+  struct
+  {
+    const char *name;
+    const bytebuf *data;
+  } cases[] = {
+      {"unchanged", &previous},
+      {"partial", &data},
+      {"all new", &fresh},
+  };
+
+  for(auto &c : cases)
+  {
+    DeltaTransferStats stats;
+    bytebuf encoded;
+
+    PerformanceTimer timer;
+    EncodeDelta({&previous, &neighbour}, *c.data, encoded, &stats);
+    double encodeTime = timer.GetMilliseconds();
+
+    bytebuf decoded;
+    timer.Restart();
+    DecodeDelta({&previous, &neighbour}, encoded, decoded);
+    double decodeTime = timer.GetMilliseconds();
+
+    CHECK(decoded == *c.data);
+
+    RDCLOG("Delta %s: %llu bytes -> %llu encoded (%llu copied, %llu literal). Encode %.2f ms, "
+           "decode %.2f ms",
+           c.name, stats.rawBytes, stats.encodedBytes, stats.copiedBytes, stats.literalBytes,
+           encodeTime, decodeTime);
+  }
+};
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -359,6 +359,8 @@ public:
     return new ShaderDebugTrace();
   }
   rdcarray<ShaderDebugState> ContinueDebug(ShaderDebugger *debugger) { return {}; }
+  ShaderDebugState SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex) { return {}; }
+  rdcarray<rdcarray<uint32_t>> GetDebugLaneExecutions(ShaderDebugger *debugger) { return {}; }
   void FreeDebugger(ShaderDebugger *debugger) { delete debugger; }
   void BuildTargetShader(ShaderEncoding sourceEncoding, const bytebuf &source, const rdcstr &entry,
                          const ShaderCompileFlags &compileFlags, ShaderStage type, ResourceId &id,
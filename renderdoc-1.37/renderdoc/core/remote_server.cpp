@@ -673,12 +673,11 @@ static void ActiveRemoteClientThread(ClientThread *threadData,
 
       if(resolver)
       {
-        StackFrames.reserve(StackAddresses.size());
-        for(uint64_t frame : StackAddresses)
-        {
-          Callstack::AddressDetails info = resolver->GetAddr(frame);
+        rdcarray<Callstack::AddressDetails> infos = resolver->GetAddrs(StackAddresses);
+
+        StackFrames.reserve(infos.size());
+        for(Callstack::AddressDetails &info : infos)
           StackFrames.push_back(info.formattedString());
-        }
       }
       else
       {
@@ -24,8 +24,8 @@
  ******************************************************************************/
 
 #include "replay_proxy.h"
-#include <list>
 #include "lz4/lz4.h"
+#include "replay/block_decode.h"
 #include "replay/dummy_driver.h"
 #include "serialise/lz4io.h"
 
@@ -96,6 +96,8 @@ rdcstr DoStringise(const ReplayProxyPacket &el)
     STRINGISE_ENUM_NAMED(eReplayProxy_GetDriverInfo, "GetDriverInfo");
 
     STRINGISE_ENUM_NAMED(eReplayProxy_ContinueDebug, "ContinueDebug");
+    STRINGISE_ENUM_NAMED(eReplayProxy_SeekDebug, "SeekDebug");
+    STRINGISE_ENUM_NAMED(eReplayProxy_GetDebugLaneExecutions, "GetDebugLaneExecutions");
     STRINGISE_ENUM_NAMED(eReplayProxy_FreeDebugger, "FreeDebugger");
 
     STRINGISE_ENUM_NAMED(eReplayProxy_GetDescriptors, "GetDescriptors");
@@ -269,6 +271,11 @@ ReplayProxy::~ReplayProxy()
 
   ShutdownPreviewWindow();
 
+  if(m_DeltaStats.rawBytes > 0)
+    RDCLOG("Delta transfers: %llu bytes of resource data sent as %llu bytes (%llu copied, %llu literal)",
+           m_DeltaStats.rawBytes, m_DeltaStats.encodedBytes, m_DeltaStats.copiedBytes,
+           m_DeltaStats.literalBytes);
+
   if(m_Proxy)
     m_Proxy->Shutdown();
   m_Proxy = NULL;
@@ -1780,6 +1787,71 @@ rdcarray<ShaderDebugState> ReplayProxy::ContinueDebug(ShaderDebugger *debugger)
   PROXY_FUNCTION(ContinueDebug, debugger);
 }
 
+template <typename ParamSerialiser, typename ReturnSerialiser>
+ShaderDebugState ReplayProxy::Proxied_SeekDebug(ParamSerialiser &paramser, ReturnSerialiser &retser,
+                                                ShaderDebugger *debugger, uint32_t stepIndex)
+{
+  const ReplayProxyPacket expectedPacket = eReplayProxy_SeekDebug;
+  ReplayProxyPacket packet = eReplayProxy_SeekDebug;
+  ShaderDebugState ret;
+
+  {
+    BEGIN_PARAMS();
+    uint64_t debugger_ptr = (uint64_t)(uintptr_t)debugger;
+    SERIALISE_ELEMENT(debugger_ptr);
+    SERIALISE_ELEMENT(stepIndex);
+    debugger = (ShaderDebugger *)(uintptr_t)debugger_ptr;
+    END_PARAMS();
+  }
+
+  {
+    REMOTE_EXECUTION();
+    if(paramser.IsReading() && !paramser.IsErrored() && !m_IsErrored)
+      ret = m_Remote->SeekDebug(debugger, stepIndex);
+  }
+
+  SERIALISE_RETURN(ret);
+
+  return ret;
+}
+
+ShaderDebugState ReplayProxy::SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex)
+{
+  PROXY_FUNCTION(SeekDebug, debugger, stepIndex);
+}
+
+template <typename ParamSerialiser, typename ReturnSerialiser>
+rdcarray<rdcarray<uint32_t>> ReplayProxy::Proxied_GetDebugLaneExecutions(
+    ParamSerialiser &paramser, ReturnSerialiser &retser, ShaderDebugger *debugger)
+{
+  const ReplayProxyPacket expectedPacket = eReplayProxy_GetDebugLaneExecutions;
+  ReplayProxyPacket packet = eReplayProxy_GetDebugLaneExecutions;
+  rdcarray<rdcarray<uint32_t>> ret;
+
+  {
+    BEGIN_PARAMS();
+    uint64_t debugger_ptr = (uint64_t)(uintptr_t)debugger;
+    SERIALISE_ELEMENT(debugger_ptr);
+    debugger = (ShaderDebugger *)(uintptr_t)debugger_ptr;
+    END_PARAMS();
+  }
+
+  {
+    REMOTE_EXECUTION();
+    if(paramser.IsReading() && !paramser.IsErrored() && !m_IsErrored)
+      ret = m_Remote->GetDebugLaneExecutions(debugger);
+  }
+
+  SERIALISE_RETURN(ret);
+
+  return ret;
+}
+
+rdcarray<rdcarray<uint32_t>> ReplayProxy::GetDebugLaneExecutions(ShaderDebugger *debugger)
+{
+  PROXY_FUNCTION(GetDebugLaneExecutions, debugger);
+}
+
 template <typename ParamSerialiser, typename ReturnSerialiser>
 void ReplayProxy::Proxied_FreeDebugger(ParamSerialiser &paramser, ReturnSerialiser &retser,
                                        ShaderDebugger *debugger)
@@ -2167,276 +2239,62 @@ void ReplayProxy::FetchStructuredFile()
   PROXY_FUNCTION(FetchStructuredFile);
 }
 
-struct DeltaSection
-{
-  uint64_t offs = 0;
-  bytebuf contents;
-
-  void swap(DeltaSection &o)
-  {
-    std::swap(offs, o.offs);
-    contents.swap(o.contents);
-  }
-};
-
-DECLARE_REFLECTION_STRUCT(DeltaSection);
-
 template <typename SerialiserType>
-void DoSerialise(SerialiserType &ser, DeltaSection &el)
+void ReplayProxy::DeltaTransferBytes(SerialiserType &xferser, bytebuf &referenceData, bytebuf &newData,
+                                     const rdcarray<const bytebuf *> &extraReferences)
 {
-  SERIALISE_MEMBER(offs);
-  SERIALISE_MEMBER(contents);
-}
+  // the first reference is always the previous contents of this resource, any others are other
+  // data that's available on both sides and is likely to share contents.
+  rdcarray<const bytebuf *> references;
+  references.reserve(extraReferences.size() + 1);
+  references.push_back(&referenceData);
+  references.append(extraReferences);
+
+  // empty means the data is unchanged
+  bytebuf encoded;
 
-template <typename SerialiserType>
-void ReplayProxy::DeltaTransferBytes(SerialiserType &xferser, bytebuf &referenceData, bytebuf &newData)
-{
-  // lz4 compress
   if(xferser.IsReading())
   {
-    uint64_t uncompSize = 0;
-    xferser.Serialise("uncompSize"_lit, uncompSize);
+    xferser.Serialise("encoded"_lit, encoded);
 
-    if(uncompSize == 0)
+    if(encoded.empty())
     {
       // fast path - no changes.
       RDCDEBUG("Unchanged");
       return;
     }
-    else
-    {
-      rdcarray<DeltaSection> deltas;
-
-      {
-        ReadSerialiser ser(
-            new StreamReader(new LZ4Decompressor(xferser.GetReader(), Ownership::Nothing),
-                             uncompSize, Ownership::Stream),
-            Ownership::Stream);
-
-        SERIALISE_ELEMENT(deltas);
-
-        // add any necessary padding.
-        uint64_t offs = ser.GetReader()->GetOffset();
-        RDCASSERT(offs <= uncompSize, offs, uncompSize);
-
-        if(offs < uncompSize)
-        {
-          if(uncompSize - offs > 128)
-          {
-            RDCERR("Unexpected amount of padding: %llu", uncompSize - offs);
-            m_IsErrored = true;
-          }
-          ser.GetReader()->Read(NULL, uncompSize - offs);
-        }
-      }
-
-      if(deltas.empty())
-      {
-        RDCERR("Unexpected empty delta list");
-        m_IsErrored = true;
-      }
-      else if(referenceData.empty())
-      {
-        // if we don't have reference data we blat the whole contents.
-        // in this case we only expect one delta with the whole range
-        if(deltas.size() != 1)
-          RDCERR("Got more than one delta with no reference data - taking first delta.");
 
-        referenceData = deltas.front().contents;
-        RDCDEBUG("Creating new reference data, %llu bytes", (uint64_t)referenceData.size());
-      }
-      else
-      {
-        uint64_t deltaBytes = 0;
-
-        // apply deltas to refData
-        for(const DeltaSection &delta : deltas)
-        {
-          if(delta.offs + delta.contents.size() > referenceData.size())
-          {
-            RDCERR("{%llu, %llu} larger than reference data (%llu bytes) - expanding to fit.",
-                   delta.offs, (uint64_t)delta.contents.size(), (uint64_t)referenceData.size());
-
-            referenceData.resize(size_t(delta.offs + delta.contents.size()));
-          }
+    bytebuf decoded;
+    RDResult res = DecodeDelta(references, encoded, decoded, &m_DeltaStats);
 
-          byte *dst = referenceData.data() + (ptrdiff_t)delta.offs;
-          const byte *src = delta.contents.data();
-
-          memcpy(dst, src, delta.contents.size());
+    if(res != ResultCode::Succeeded)
+    {
+      RDCERR("Failed to decode delta: %s", res.message.c_str());
+      m_IsErrored = true;
+      return;
+    }
 
-          deltaBytes += (uint64_t)delta.contents.size();
-        }
+    RDCDEBUG("Decoded %llu bytes from %llu byte delta", (uint64_t)decoded.size(),
+             (uint64_t)encoded.size());
 
-        RDCDEBUG("Applied %u deltas data, %llu total delta bytes to %llu resource size",
-                 (uint32_t)deltas.size(), deltaBytes, (uint64_t)referenceData.size());
-      }
-    }
+    referenceData.swap(decoded);
   }
   else
   {
-    uint64_t uncompSize = 0;
-
-    // we use a list so that we don't have to reserve and pushing new sections will never cause
-    // previous ones to be reallocated and move around lots of data.
-    std::list<DeltaSection> deltasList;
-
-    if(referenceData.empty())
+    if(referenceData.size() != newData.size() ||
+       memcmp(referenceData.data(), newData.data(), newData.size()) != 0)
     {
-      // no previous reference data, need to transfer the whole object.
-      deltasList.resize(1);
-      deltasList.back().contents = newData;
-    }
-    else
-    {
-      if(referenceData.size() != newData.size())
-      {
-        RDCERR("Reference data existed at %llu bytes, but new data is now %llu bytes",
-               referenceData.size(), newData.size());
-
-        // re-transfer the whole block, something went seriously wrong if the resource changed size.
-        deltasList.resize(1);
-        deltasList.back().contents = newData;
-      }
-      else
-      {
-        // do actual diff.
-        const byte *srcBegin = newData.data();
-        const byte *src = srcBegin;
-        const byte *dst = referenceData.data();
-        size_t bytesRemain = newData.size();
-
-        // we only care about large-ish chunks at a time. This prevents us generating lots of tiny
-        // deltas where we could batch changes together. This is tuned to not be too large (and
-        // thus causing us to miss too many sections we could skip) and not too small (causing us
-        // to devolve into lots of byte-wise deltas). The current value as of this comment of 128
-        // is definitely on the small end of the range, but consider e.g. an android image of
-        // 1440x2560 and a pixel-wide line that goes vertically from top to bottom. Reading
-        // horizontally that will mean 2560 different diffs, and only actually one pixel changed.
-        // The larger this value gets, the more redundant data we'll send along with.
-        const size_t chunkSize = 128;
-
-        // we use a simple state machine. Start in state 1
-        //
-        // State 1: No active delta. Look at the current chunk, if there's no difference move to the
-        //          next chunk and stay in this state. If there is a difference, push a delta onto
-        //          the list at the current offset. Copy the current chunk into the contents of the
-        //          delta. Move to state 2.
-        // State 2. Active delta. Look at the current chunk, if there is a difference then append
-        //          the current chunk to the last delta's contents, move to the next chunk, and stay
-        //          in this state. If there isn't a difference, move back to state 1 (the delta is
-        //          already 'finished' so we have no need to do anything more on it).
-        //
-        // At any point we can end the loop, both states are 'complete' at all points.
-
-        enum DeltaState
-        {
-          None,
-          Active
-        };
-        DeltaState state = DeltaState::None;
-
-        // loop over whole chunks
-        while(bytesRemain > chunkSize)
-        {
-          // check if there's a difference in this chunk.
-          bool chunkDiff = memcmp(src, dst, chunkSize) != 0;
-
-          // if we're in state 1
-          if(state == DeltaState::None)
-          {
-            // if there's a difference, append a new delta with the current offset and chunk
-            // contents and move to state 2
-            if(chunkDiff)
-            {
-              deltasList.push_back(DeltaSection());
-              deltasList.back().offs = src - srcBegin;
-              deltasList.back().contents.append(src, chunkSize);
-
-              state = DeltaState::Active;
-            }
-          }
-          // if we're in state 2
-          else if(state == DeltaState::Active)
-          {
-            // continue to append to the delta if there's another difference in this chunk.
-            if(chunkDiff)
-            {
-              deltasList.back().contents.append(src, chunkSize);
-            }
-            else
-            {
-              state = DeltaState::None;
-            }
-          }
-
-          // move to the next chunk
-          bytesRemain -= chunkSize;
-          src += chunkSize;
-          dst += chunkSize;
-        }
+      RDResult res = EncodeDelta(references, newData, encoded, &m_DeltaStats);
 
-        // if there are still some bytes remaining at the end of the image, smaller than the chunk
-        // size, just diff directly and send if needed. We could combine this with the last delta if
-        // we ended in the active state.
-        if(bytesRemain > 0 && memcmp(src, dst, bytesRemain) != 0)
-        {
-          deltasList.push_back(DeltaSection());
-          deltasList.back().offs = src - srcBegin;
-          deltasList.back().contents.append(src, bytesRemain);
-        }
-      }
-    }
-
-    // serialise as an array, move the storage from the list into here
-    rdcarray<DeltaSection> deltas;
-    deltas.resize(deltasList.size());
-
-    {
-      // swap between the list and array, so all the buffers just move storage
-      size_t i = 0;
-      for(auto it = deltasList.begin(); it != deltasList.end(); it++)
+      if(res != ResultCode::Succeeded)
       {
-        deltas[i].swap(*it);
-        i++;
+        RDCERR("Failed to encode delta: %s", res.message.c_str());
+        m_IsErrored = true;
+        encoded.clear();
       }
     }
 
-    // fast path - no changes.
-    if(deltas.empty())
-    {
-      uncompSize = 0;
-    }
-    else
-    {
-      // serialise to an invalid writer, to get the size of the data that will be written.
-      WriteSerialiser ser(new StreamWriter(StreamWriter::InvalidStream), Ownership::Stream);
-
-      SERIALISE_ELEMENT(deltas);
-
-      uncompSize = ser.GetWriter()->GetOffset() + ser.GetChunkAlignment();
-    }
-
-    xferser.Serialise("uncompSize"_lit, uncompSize);
-
-    if(uncompSize > 0)
-    {
-      WriteSerialiser ser(new StreamWriter(new LZ4Compressor(xferser.GetWriter(), Ownership::Nothing),
-                                           Ownership::Stream),
-                          Ownership::Stream);
-
-      SERIALISE_ELEMENT(deltas);
-
-      char empty[128] = {};
-
-      // add any necessary padding.
-      uint64_t offs = ser.GetWriter()->GetOffset();
-      RDCASSERT(offs <= uncompSize, offs, uncompSize);
-      RDCASSERT(uncompSize - offs < sizeof(empty), offs, uncompSize);
-
-      if(offs < uncompSize)
-        ser.GetWriter()->Write(empty, uncompSize - offs);
-    }
+    xferser.Serialise("encoded"_lit, encoded);
 
     // This is the proxy side, so we have the complete newest contents in data. Swap the new data
     // into refData for next time.
@@ -2471,7 +2329,19 @@ void ReplayProxy::Proxied_CacheBufferData(ParamSerialiser &paramser, ReturnSeria
     SERIALISE_ELEMENT(packet);
   }
 
-  DeltaTransferBytes(retser, m_ProxyBufferData[buff], data);
+  // as well as the buffer's previous contents, use the last buffer transferred as a reference in
+  // case data is being copied or streamed between buffers.
+  rdcarray<const bytebuf *> extraReferences;
+  if(m_LastDeltaBuffer != buff)
+  {
+    auto it = m_ProxyBufferData.find(m_LastDeltaBuffer);
+    if(it != m_ProxyBufferData.end())
+      extraReferences.push_back(&it->second);
+  }
+
+  DeltaTransferBytes(retser, m_ProxyBufferData[buff], data, extraReferences);
+
+  m_LastDeltaBuffer = buff;
 
   retser.EndChunk();
 
@@ -2514,7 +2384,30 @@ void ReplayProxy::Proxied_CacheTextureData(ParamSerialiser &paramser, ReturnSeri
   }
 
   TextureCacheEntry entry = {tex, sub};
-  DeltaTransferBytes(retser, m_ProxyTextureData[entry], data);
+
+  // other subresources of the same texture often have similar contents - neighbouring slices,
+  // samples, or mips of images with flat regions - and the last texture transferred may be a
+  // copy or a previous version of this one.
+  rdcarray<const bytebuf *> extraReferences;
+  for(auto it = m_ProxyTextureData.lower_bound({tex, Subresource(0, 0, 0)});
+      it != m_ProxyTextureData.end() && it->first.replayid == tex &&
+      extraReferences.size() < MaxDeltaReferences;
+      ++it)
+  {
+    if(it->first.sub != sub)
+      extraReferences.push_back(&it->second);
+  }
+
+  if(m_LastDeltaTexture.replayid != tex && extraReferences.size() < MaxDeltaReferences)
+  {
+    auto it = m_ProxyTextureData.find(m_LastDeltaTexture);
+    if(it != m_ProxyTextureData.end())
+      extraReferences.push_back(&it->second);
+  }
+
+  DeltaTransferBytes(retser, m_ProxyTextureData[entry], data, extraReferences);
+
+  m_LastDeltaTexture = entry;
 
   retser.EndChunk();
 
@@ -2592,6 +2485,7 @@ void ReplayProxy::RemapProxyTextureIfNeeded(TextureDescription &tex, GetTextureD
       case ResourceFormatType::R4G4:
       case ResourceFormatType::R4G4B4A4:
       case ResourceFormatType::ETC2:
+      case ResourceFormatType::PVRTC:
         params.remap = RemapTexture::RGBA8;
         tex.format.compType = CompType::UNorm;
         break;
@@ -2689,8 +2583,21 @@ void ReplayProxy::EnsureTexCached(ResourceId &texid, CompType &typeCast, const S
       TextureDescription tex = GetTexture(texid);
 
       ProxyTextureProperties proxy;
+
+      const ResourceFormat originalFormat = tex.format;
       RemapProxyTextureIfNeeded(tex, proxy.params);
 
+      // block formats we can decode ourselves are transferred compressed, which is both much smaller
+      // and doesn't depend on the remote GPU being able to render out the format.
+      if(proxy.params.remap != RemapTexture::NoRemap && CanDecodeBlockCompressed(originalFormat))
+      {
+        proxy.decodeOnCPU = true;
+        proxy.decodeFormat = originalFormat;
+        proxy.width = tex.width;
+        proxy.height = tex.height;
+        proxy.depth = tex.depth;
+      }
+
       proxy.id = m_Proxy->CreateProxyTexture(tex);
       proxy.msSamp = RDCMAX(1U, tex.msSamp);
       proxyit = m_ProxyTextures.insert(std::make_pair(texid, proxy)).first;
@@ -2715,6 +2622,17 @@ void ReplayProxy::EnsureTexCached(ResourceId &texid, CompType &typeCast, const S
       params.typeCast = typeCast;
       params.standardLayout = true;
 
+      // a type cast other than the remap's own can only be applied by the remote GPU
+      const bool decodeOnCPU =
+          proxy.decodeOnCPU &&
+          (typeCast == proxy.params.typeCast || typeCast == proxy.decodeFormat.compType);
+
+      if(decodeOnCPU)
+      {
+        params.remap = RemapTexture::NoRemap;
+        params.typeCast = CompType::Typeless;
+      }
+
 #if ENABLED(TRANSFER_RESOURCE_CONTENTS_DELTAS)
       CacheTextureData(texid, s, params);
 #else
@@ -2723,7 +2641,25 @@ void ReplayProxy::EnsureTexCached(ResourceId &texid, CompType &typeCast, const S
 
       auto it = m_ProxyTextureData.find(sampleArrayEntry);
       if(it != m_ProxyTextureData.end())
-        m_Proxy->SetProxyTextureData(proxy.id, s, it->second.data(), it->second.size());
+      {
+        if(decodeOnCPU)
+        {
+          // decode into a separate buffer, the cached data must stay as it was transferred since
+          // it's the reference for the next delta.
+          bytebuf decoded;
+          RDResult res = DecodeBlockCompressed(
+              proxy.decodeFormat, proxy.params.remap, RDCMAX(1U, proxy.width >> s.mip),
+              RDCMAX(1U, proxy.height >> s.mip), RDCMAX(1U, proxy.depth >> s.mip), it->second,
+              decoded);
+
+          if(res == ResultCode::Succeeded)
+            m_Proxy->SetProxyTextureData(proxy.id, s, decoded.data(), decoded.size());
+        }
+        else
+        {
+          m_Proxy->SetProxyTextureData(proxy.id, s, it->second.data(), it->second.size());
+        }
+      }
     }
 
     m_TextureProxyCache.insert(entry);
@@ -3203,6 +3139,8 @@ bool ReplayProxy::Tick(int type)
       break;
     }
     case eReplayProxy_ContinueDebug: ContinueDebug(NULL); break;
+    case eReplayProxy_SeekDebug: SeekDebug(NULL, 0); break;
+    case eReplayProxy_GetDebugLaneExecutions: GetDebugLaneExecutions(NULL); break;
     case eReplayProxy_FreeDebugger: FreeDebugger(NULL); break;
     case eReplayProxy_RenderOverlay:
       RenderOverlay(ResourceId(), FloatVector(), DebugOverlay::NoOverlay, 0, rdcarray<uint32_t>());
@@ -25,6 +25,7 @@
 
 #pragma once
 
+#include "delta_transfer.h"
 #include "os/os_specific.h"
 #include "replay/replay_driver.h"
 #include "serialise/serialiser.h"
@@ -103,6 +104,8 @@ enum ReplayProxyPacket
   eReplayProxy_GetAvailableGPUs,
 
   eReplayProxy_ContinueDebug,
+  eReplayProxy_SeekDebug,
+  eReplayProxy_GetDebugLaneExecutions,
   eReplayProxy_FreeDebugger,
 
   eReplayProxy_FatalErrorCheck,
@@ -554,6 +557,10 @@ public:
                              const rdcfixedarray<uint32_t, 3> &groupid,
                              const rdcfixedarray<uint32_t, 3> &threadid);
   IMPLEMENT_FUNCTION_PROXIED(rdcarray<ShaderDebugState>, ContinueDebug, ShaderDebugger *debugger);
+  IMPLEMENT_FUNCTION_PROXIED(ShaderDebugState, SeekDebug, ShaderDebugger *debugger,
+                             uint32_t stepIndex);
+  IMPLEMENT_FUNCTION_PROXIED(rdcarray<rdcarray<uint32_t>>, GetDebugLaneExecutions,
+                             ShaderDebugger *debugger);
   IMPLEMENT_FUNCTION_PROXIED(void, FreeDebugger, ShaderDebugger *debugger);
 
   IMPLEMENT_FUNCTION_PROXIED(rdcarray<ShaderEncoding>, GetTargetShaderEncodings);
@@ -573,9 +580,11 @@ public:
                              const GetTextureDataParams &params);
 
   // utility function to serialise the contents of a byte array given the previous contents that's
-  // available on both sides of the communication.
+  // available on both sides of the communication. Any extra references must also be identical on
+  // both sides, and are searched for matching data as well.
   template <typename SerialiserType>
-  void DeltaTransferBytes(SerialiserType &xferser, bytebuf &referenceData, bytebuf &newData);
+  void DeltaTransferBytes(SerialiserType &xferser, bytebuf &referenceData, bytebuf &newData,
+                          const rdcarray<const bytebuf *> &extraReferences);
 
   void FileChanged() {}
   // will never be used
@@ -637,6 +646,12 @@ private:
     uint32_t msSamp;
     GetTextureDataParams params;
 
+    // if set, the raw blocks are fetched and decoded locally instead of remapping on the remote GPU.
+    // decodeFormat and the dimensions are those of the original texture.
+    bool decodeOnCPU = false;
+    ResourceFormat decodeFormat;
+    uint32_t width = 1, height = 1, depth = 1;
+
     ProxyTextureProperties() {}
     // Create a proxy Id with the default get-data parameters.
     ProxyTextureProperties(ResourceId proxyid) : id(proxyid) {}
@@ -653,6 +668,18 @@ private:
   std::map<TextureCacheEntry, bytebuf> m_ProxyTextureData;
   std::map<ResourceId, bytebuf> m_ProxyBufferData;
 
+  // the most recent resources delta transferred, used as extra references for the next transfer.
+  // Like the data above these are identical on both sides.
+  TextureCacheEntry m_LastDeltaTexture = {};
+  ResourceId m_LastDeltaBuffer;
+
+  // the maximum number of extra references searched for a texture transfer beyond its own contents,
+  // to bound the cost of indexing textures with many subresources.
+  static const size_t MaxDeltaReferences = 8;
+
+  // totals of the delta transfers on this side, logged on shutdown to show the savings.
+  DeltaTransferStats m_DeltaStats;
+
   // this lists any textures which are only created locally (e.g. custom visualisation shaders) and
   // should not be treated as proxied.
   std::set<ResourceId> m_LocalTextures;
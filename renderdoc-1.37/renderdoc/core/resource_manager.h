@@ -30,6 +30,7 @@
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include "api/replay/rdcflathashmap.h"
 #include "api/replay/rdcflatmap.h"
 #include "api/replay/resourceid.h"
 #include "common/threading.h"
@@ -267,23 +268,18 @@ inline InitReqType InitReq(FrameRefType refType, InitPolicy policy, bool initial
 
 // handle marking a resource referenced for read or write and storing RAW access etc.
 template <typename Compose>
-bool MarkReferenced(std::unordered_map<ResourceId, FrameRefType> &refs, ResourceId id,
+bool MarkReferenced(rdcflathashmap<ResourceId, FrameRefType> &refs, ResourceId id,
                     FrameRefType refType, Compose comp)
 {
-  auto refit = refs.find(id);
-  if(refit == refs.end())
-  {
-    refs[id] = refType;
+  auto refit = refs.insert({id, refType});
+  if(refit.second)
     return true;
-  }
-  else
-  {
-    refit->second = comp(refit->second, refType);
-  }
+
+  refit.first->second = comp(refit.first->second, refType);
   return false;
 }
 
-inline bool MarkReferenced(std::unordered_map<ResourceId, FrameRefType> &refs, ResourceId id,
+inline bool MarkReferenced(rdcflathashmap<ResourceId, FrameRefType> &refs, ResourceId id,
                            FrameRefType refType)
 {
   return MarkReferenced(refs, id, refType, ComposeFrameRefs);
@@ -534,7 +530,7 @@ protected:
   rdcarray<StoredChunk> m_Chunks;
   Threading::CriticalSection *m_ChunkLock;
 
-  std::unordered_map<ResourceId, FrameRefType> m_FrameRefs;
+  rdcflathashmap<ResourceId, FrameRefType> m_FrameRefs;
 };
 
 template <typename Compose>
@@ -704,6 +700,10 @@ protected:
   virtual rdcarray<ResourceId> InitialContentResources();
 
   void UpdateLastWriteTime(ResourceId id, FrameRefType refType);
+  void UpdateLastWriteTime(ResourceId id, FrameRefType refType, double now);
+
+  void AddThreadWriteRef(ResourceId id, FrameRefType refType);
+  void MergeThreadWriteRefs();
 
   void Prepare_InitialStateIfPostponed(ResourceId id, bool midframe);
   void SkipOrPostponeOrPrepare_InitialState(ResourceId id, FrameRefType refType);
@@ -725,7 +725,7 @@ protected:
   std::map<RealResourceType, WrappedResourceType> m_WrapperMap;
 
   // used during capture - holds resources referenced in current frame (and how they're referenced)
-  std::unordered_map<ResourceId, FrameRefType> m_FrameReferencedResources;
+  rdcflathashmap<ResourceId, FrameRefType> m_FrameReferencedResources;
 
   // used during capture - holds resources marked as dirty, needing initial contents
   std::set<ResourceId> m_DirtyResources;
@@ -757,7 +757,7 @@ protected:
   std::unordered_map<ResourceId, WrappedResourceType> m_CurrentResourceMap;
 
   // used during replay - maps back and forth from original id to live id and vice-versa
-  std::unordered_map<ResourceId, ResourceId> m_OriginalIDs, m_LiveIDs;
+  rdcflathashmap<ResourceId, ResourceId> m_OriginalIDs, m_LiveIDs;
 
   // used during replay - holds resources allocated and the original id that they represent
   std::unordered_map<ResourceId, WrappedResourceType> m_LiveResourceMap;
@@ -808,6 +808,35 @@ protected:
 
   PerformanceTimer m_ResourcesUpdateTimer;
 
+  // while background capturing, write references only update m_ResourceRefTimes. Rather than
+  // having every recording thread take m_Lock for each reference they're batched up per-thread and
+  // merged in timestamp order under m_Lock, either at submit time or whenever anything looks at the
+  // write times.
+  struct PendingWriteRef
+  {
+    ResourceId id;
+    FrameRefType refType;
+    double time;
+
+    bool operator<(const PendingWriteRef &o) const { return time < o.time; }
+  };
+
+  struct ThreadWriteRefs
+  {
+    Threading::CriticalSection lock;
+    rdcarray<PendingWriteRef> refs;
+    // 1 if refs is non-empty. Only changed under the lock, but can be checked without it so merging
+    // can skip threads with nothing pending
+    int32_t dirty = 0;
+  };
+
+  // if a thread builds up this many references without anything merging them, it merges them itself
+  static const size_t MaxPendingThreadWriteRefs = 16384;
+
+  uint64_t m_WriteRefsSlot;
+  Threading::CriticalSection m_WriteRefsLock;
+  rdcarray<ThreadWriteRefs *> m_ThreadWriteRefs;
+
   // The capture state is propagated by a specific driver.
   CaptureState &m_State;
 };
@@ -816,6 +845,7 @@ template <typename Configuration>
 ResourceManager<Configuration>::ResourceManager(CaptureState &state) : m_State(state)
 {
   m_Capturing = IsCaptureMode(state);
+  m_WriteRefsSlot = Threading::AllocateTLSSlot();
   RenderDoc::Inst().RegisterMemoryRegion(this, sizeof(ResourceManager));
 }
 
@@ -845,6 +875,11 @@ ResourceManager<Configuration>::~ResourceManager()
   RDCASSERT(m_InitialContents.empty());
   RDCASSERT(m_ResourceRecords.empty());
 
+  for(ThreadWriteRefs *refs : m_ThreadWriteRefs)
+    delete refs;
+  m_ThreadWriteRefs.clear();
+  Threading::FreeTLSSlot(m_WriteRefsSlot);
+
   RenderDoc::Inst().UnregisterMemoryRegion(this);
 }
 
@@ -856,6 +891,8 @@ void ResourceManager<Configuration>::MarkBackgroundFrameReferenced(
 
   if(IsBackgroundCapturing(m_State))
   {
+    MergeThreadWriteRefs();
+
     if(refs.size() <= m_ResourceRefTimes.size())
     {
       for(auto it = refs.begin(); it != refs.end(); ++it)
@@ -881,6 +918,8 @@ void ResourceManager<Configuration>::CleanBackgroundFrameReferences()
 
   if(IsBackgroundCapturing(m_State))
   {
+    MergeThreadWriteRefs();
+
     double now = m_ResourcesUpdateTimer.GetMilliseconds();
 
     // retire any old entries, if they were written once they shouldn't be tracked forever. This
@@ -925,11 +964,20 @@ template <typename Compose>
 void ResourceManager<Configuration>::MarkResourceFrameReferenced(ResourceId id,
                                                                  FrameRefType refType, Compose comp)
 {
-  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
-
   if(id == ResourceId())
     return;
 
+  // while background capturing the only effect of a reference is on write times, which reads don't
+  // touch at all. Writes are batched on this thread to avoid contending on m_Lock.
+  if(IsBackgroundCapturing(m_State))
+  {
+    if(IsDirtyFrameRef(refType))
+      AddThreadWriteRef(id, refType);
+    return;
+  }
+
+  SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+
   if(IsActiveCapturing(m_State))
   {
     SkipOrPostponeOrPrepare_InitialState(id, refType);
@@ -1211,6 +1259,7 @@ template <typename Configuration>
 inline void ResourceManager<Configuration>::ResetLastWriteTimes()
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+  MergeThreadWriteRefs();
   for(auto it = m_ResourceRefTimes.begin(); it != m_ResourceRefTimes.end(); ++it)
   {
     // Reset only those resources which were below the threshold on
@@ -1225,6 +1274,18 @@ inline void ResourceManager<Configuration>::UpdateLastWriteTime(ResourceId id, F
 {
   // parent must hold m_Lock for us
 
+  // apply any batched writes first so they're not applied on top of this one
+  MergeThreadWriteRefs();
+
+  UpdateLastWriteTime(id, refType, m_ResourcesUpdateTimer.GetMilliseconds());
+}
+
+template <typename Configuration>
+inline void ResourceManager<Configuration>::UpdateLastWriteTime(ResourceId id,
+                                                                FrameRefType refType, double now)
+{
+  // parent must hold m_Lock for us
+
   // only care about write refs. A read ref would invalidate skippable state, however a skippable
   // resource is left in an undefined state where reads are not valid so we don't. We need to see
   // another write first before a read could be a problem, so we just pay attention for that write.
@@ -1241,8 +1302,6 @@ inline void ResourceManager<Configuration>::UpdateLastWriteTime(ResourceId id, F
     it = m_ResourceRefTimes.begin() + idx;
   }
 
-  double now = m_ResourcesUpdateTimer.GetMilliseconds();
-
   it->writeTime = now;
 
   if(refType == eFrameRef_CompleteWriteAndDiscard)
@@ -1258,10 +1317,82 @@ inline void ResourceManager<Configuration>::UpdateLastWriteTime(ResourceId id, F
   }
 }
 
+template <typename Configuration>
+void ResourceManager<Configuration>::AddThreadWriteRef(ResourceId id, FrameRefType refType)
+{
+  ThreadWriteRefs *refs = (ThreadWriteRefs *)Threading::GetTLSValue(m_WriteRefsSlot);
+
+  if(refs == NULL)
+  {
+    refs = new ThreadWriteRefs;
+
+    {
+      SCOPED_LOCK(m_WriteRefsLock);
+      m_ThreadWriteRefs.push_back(refs);
+    }
+
+    Threading::SetTLSValue(m_WriteRefsSlot, refs);
+  }
+
+  size_t pending;
+
+  {
+    SCOPED_LOCK(refs->lock);
+    refs->refs.push_back({id, refType, m_ResourcesUpdateTimer.GetMilliseconds()});
+    pending = refs->refs.size();
+
+    // only flag the first pending reference, so that the flag isn't written on every reference
+    if(pending == 1)
+      Atomic::CmpExch32(&refs->dirty, 0, 1);
+  }
+
+  if(pending >= MaxPendingThreadWriteRefs)
+  {
+    SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+    MergeThreadWriteRefs();
+  }
+}
+
+template <typename Configuration>
+void ResourceManager<Configuration>::MergeThreadWriteRefs()
+{
+  // parent must hold m_Lock for us
+
+  rdcarray<PendingWriteRef> merged;
+
+  {
+    SCOPED_LOCK(m_WriteRefsLock);
+
+    for(ThreadWriteRefs *refs : m_ThreadWriteRefs)
+    {
+      // skip threads with nothing pending without taking their lock
+      if(Atomic::CmpExch32(&refs->dirty, 0, 0) == 0)
+        continue;
+
+      SCOPED_LOCK(refs->lock);
+
+      merged.append(refs->refs);
+      refs->refs.clear();
+      Atomic::CmpExch32(&refs->dirty, 1, 0);
+    }
+  }
+
+  if(merged.empty())
+    return;
+
+  // each thread's references are already in order, this interleaves them. A stable sort keeps
+  // references from the same thread with identical timestamps in the order they were made.
+  std::stable_sort(merged.begin(), merged.end());
+
+  for(const PendingWriteRef &ref : merged)
+    UpdateLastWriteTime(ref.id, ref.refType, ref.time);
+}
+
 template <typename Configuration>
 inline bool ResourceManager<Configuration>::HasPersistentAge(ResourceId id)
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+  MergeThreadWriteRefs();
 
   ResourceRefTimes *it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
 
@@ -1275,6 +1406,7 @@ template <typename Configuration>
 inline bool ResourceManager<Configuration>::HasSkippableAge(ResourceId id)
 {
   SCOPED_LOCK_OPTIONAL(m_Lock, m_Capturing);
+  MergeThreadWriteRefs();
 
   ResourceRefTimes *it = std::lower_bound(m_ResourceRefTimes.begin(), m_ResourceRefTimes.end(), id);
 
@@ -1963,6 +2095,9 @@ void ResourceManager<Configuration>::ReleaseCurrentResource(ResourceId id)
   if(IsActiveCapturing(m_State))
     Prepare_InitialStateIfPostponed(id, true);
 
+  // make sure no batched write re-adds this resource's write time after it's removed
+  MergeThreadWriteRefs();
+
   m_CurrentResourceMap.erase(id);
   m_DirtyResources.erase(id);
 
@@ -0,0 +1,297 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "common/globalconfig.h"
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include <set>
+#include "resource_manager.h"
+
+#include "catch/catch.hpp"
+
+namespace
+{
+struct TestResourceRecord : public ResourceRecord
+{
+  enum
+  {
+    NullResource = 0
+  };
+
+  TestResourceRecord(ResourceId id) : ResourceRecord(id, true) {}
+};
+
+struct TestInitialContents
+{
+  template <typename Configuration>
+  void Free(ResourceManager<Configuration> *rm)
+  {
+  }
+};
+
+struct TestResourceManagerConfiguration
+{
+  typedef uint64_t WrappedResourceType;
+  typedef uint64_t RealResourceType;
+  typedef TestResourceRecord RecordType;
+  typedef TestInitialContents InitialContentData;
+};
+
+class TestResourceManager : public ResourceManager<TestResourceManagerConfiguration>
+{
+public:
+  TestResourceManager(CaptureState &state) : ResourceManager(state) {}
+  // the reference path as it was before write references were batched, with every reference
+  // taking the manager lock.
+  void MarkResourceFrameReferencedLocked(ResourceId id, FrameRefType refType)
+  {
+    SCOPED_LOCK(m_Lock);
+    UpdateLastWriteTime(id, refType);
+  }
+
+  rdcarray<ResourceRefTimes> GetWriteTimes()
+  {
+    SCOPED_LOCK(m_Lock);
+    MergeThreadWriteRefs();
+    return m_ResourceRefTimes;
+  }
+
+private:
+  ResourceId GetID(uint64_t res) { return ResourceId(); }
+  bool ResourceTypeRelease(uint64_t res) { return true; }
+  bool Prepare_InitialState(uint64_t res) { return true; }
+  uint64_t GetSize_InitialState(ResourceId id, const TestInitialContents &initial) { return 0; }
+  bool Serialise_InitialState(WriteSerialiser &ser, ResourceId id, TestResourceRecord *record,
+                              const TestInitialContents *initialData)
+  {
+    return true;
+  }
+  void Create_InitialState(ResourceId id, uint64_t live, bool hasData) {}
+  void Apply_InitialState(uint64_t live, TestInitialContents &initial) {}
+};
+
+void MarkReferencesThreaded(uint32_t numThreads, uint32_t refsPerThread,
+                            const rdcarray<ResourceId> &ids,
+                            std::function<void(ResourceId, FrameRefType)> mark)
+{
+  rdcarray<Threading::ThreadHandle> threads;
+
+  for(uint32_t t = 0; t < numThreads; t++)
+  {
+    threads.push_back(Threading::CreateThread([t, refsPerThread, &ids, &mark]() {
+      for(uint32_t i = 0; i < refsPerThread; i++)
+      {
+        // one in four references is a write, the rest are reads
+        FrameRefType refType = (i % 4) == 0 ? eFrameRef_PartialWrite : eFrameRef_Read;
+        mark(ids[(t * 7919 + i) % ids.size()], refType);
+      }
+    }));
+  }
+
+  for(Threading::ThreadHandle th : threads)
+  {
+    Threading::JoinThread(th);
+    Threading::CloseThread(th);
+  }
+}
+};
+
+TEST_CASE("Test batched resource write references", "[resourcemanager]")
+{
+  CaptureState state = CaptureState::BackgroundCapturing;
+
+  TestResourceManager mgr(state);
+
+  SECTION("References from multiple threads are all merged")
+  {
+    const uint32_t numThreads = 4;
+
+    rdcarray<ResourceId> written[numThreads];
+    rdcarray<ResourceId> read;
+
+    for(uint32_t t = 0; t < numThreads; t++)
+      for(uint32_t i = 0; i < 100; i++)
+        written[t].push_back(ResourceIDGen::GetNewUniqueID());
+
+    for(uint32_t i = 0; i < 100; i++)
+      read.push_back(ResourceIDGen::GetNewUniqueID());
+
+    rdcarray<Threading::ThreadHandle> threads;
+
+    for(uint32_t t = 0; t < numThreads; t++)
+    {
+      threads.push_back(Threading::CreateThread([t, &mgr, &written, &read]() {
+        for(ResourceId id : written[t])
+        {
+          mgr.MarkResourceFrameReferenced(id, eFrameRef_Read);
+          mgr.MarkResourceFrameReferenced(id, eFrameRef_PartialWrite);
+        }
+
+        for(ResourceId id : read)
+          mgr.MarkResourceFrameReferenced(id, eFrameRef_Read);
+      }));
+    }
+
+    for(Threading::ThreadHandle th : threads)
+    {
+      Threading::JoinThread(th);
+      Threading::CloseThread(th);
+    }
+
+    auto times = mgr.GetWriteTimes();
+
+    // read references don't record anything
+    CHECK(times.size() == numThreads * 100);
+
+    for(size_t i = 1; i < times.size(); i++)
+      CHECK(times[i - 1].id < times[i].id);
+
+    for(size_t i = 0; i < times.size(); i++)
+    {
+      CHECK(times[i].writeTime > 0.0);
+      CHECK(times[i].firstSkipTime == 0.0);
+    }
+
+    // references are merged at submit time
+    for(uint32_t t = 0; t < numThreads; t++)
+      mgr.MarkResourceFrameReferenced(written[t][0], eFrameRef_CompleteWriteAndDiscard);
+
+    rdcflatmap<ResourceId, FrameRefType> submitRefs;
+    mgr.MarkBackgroundFrameReferenced(submitRefs);
+
+    times = mgr.GetWriteTimes();
+
+    uint32_t skippable = 0;
+    for(size_t i = 0; i < times.size(); i++)
+      if(times[i].firstSkipTime > 0.0)
+        skippable++;
+
+    CHECK(skippable == numThreads);
+  };
+
+  SECTION("Discarding writes are applied in order")
+  {
+    ResourceId id = ResourceIDGen::GetNewUniqueID();
+
+    mgr.MarkResourceFrameReferenced(id, eFrameRef_CompleteWriteAndDiscard);
+    mgr.MarkResourceFrameReferenced(id, eFrameRef_CompleteWriteAndDiscard);
+
+    auto times = mgr.GetWriteTimes();
+
+    REQUIRE(times.size() == 1);
+    double firstSkip = times[0].firstSkipTime;
+    CHECK(firstSkip > 0.0);
+    CHECK(times[0].writeTime >= firstSkip);
+
+    mgr.MarkResourceFrameReferenced(id, eFrameRef_CompleteWriteAndDiscard);
+
+    times = mgr.GetWriteTimes();
+
+    REQUIRE(times.size() == 1);
+    CHECK(times[0].firstSkipTime == firstSkip);
+
+    mgr.MarkResourceFrameReferenced(id, eFrameRef_CompleteWriteAndDiscard);
+    mgr.MarkResourceFrameReferenced(id, eFrameRef_PartialWrite);
+
+    times = mgr.GetWriteTimes();
+
+    REQUIRE(times.size() == 1);
+    CHECK(times[0].firstSkipTime == 0.0);
+  };
+
+  SECTION("Large batches merge themselves")
+  {
+    rdcarray<ResourceId> ids;
+    for(uint32_t i = 0; i < 1000; i++)
+      ids.push_back(ResourceIDGen::GetNewUniqueID());
+
+    const uint32_t numThreads = 2, refsPerThread = 100000;
+
+    MarkReferencesThreaded(numThreads, refsPerThread, ids,
+                           [&mgr](ResourceId id, FrameRefType refType) {
+                             mgr.MarkResourceFrameReferenced(id, refType);
+                           });
+
+    // only writes get a write time, and with the fixed stride each thread only writes some of the
+    // resources
+    std::set<ResourceId> written;
+    for(uint32_t t = 0; t < numThreads; t++)
+      for(uint32_t i = 0; i < refsPerThread; i += 4)
+        written.insert(ids[(t * 7919 + i) % ids.size()]);
+
+    CHECK(mgr.GetWriteTimes().size() == written.size());
+  };
+
+  mgr.Shutdown();
+};
+
+TEST_CASE("Benchmark resource frame references", "[resourcemanager][!benchmark]")
+{
+  CaptureState state = CaptureState::BackgroundCapturing;
+
+  const uint32_t totalRefs = 8 * 1024 * 1024;
+  const uint32_t threadCounts[] = {1, 2, 4, 8};
+
+  rdcarray<ResourceId> ids;
+  for(uint32_t i = 0; i < 4096; i++)
+    ids.push_back(ResourceIDGen::GetNewUniqueID());
+
+  RDCLOG("Background frame references, %u references over %zu resources", totalRefs, ids.size());
+
+  for(uint32_t numThreads : threadCounts)
+  {
+    double ms[2] = {};
+
+    for(int batched = 0; batched < 2; batched++)
+    {
+      TestResourceManager mgr(state);
+
+      PerformanceTimer timer;
+
+      if(batched)
+        MarkReferencesThreaded(numThreads, totalRefs / numThreads, ids,
+                               [&mgr](ResourceId id, FrameRefType refType) {
+                                 mgr.MarkResourceFrameReferenced(id, refType);
+                               });
+      else
+        MarkReferencesThreaded(numThreads, totalRefs / numThreads, ids,
+                               [&mgr](ResourceId id, FrameRefType refType) {
+                                 mgr.MarkResourceFrameReferencedLocked(id, refType);
+                               });
+
+      // include the merge that would happen at submit time
+      mgr.GetWriteTimes();
+
+      ms[batched] = timer.GetMilliseconds();
+
+      mgr.Shutdown();
+    }
+
+    RDCLOG("  %u threads: locked %8.1f Mrefs/s, batched %8.1f Mrefs/s", numThreads,
+           double(totalRefs) / 1000.0 / ms[0], double(totalRefs) / 1000.0 / ms[1]);
+  }
+};
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -84,6 +84,8 @@ void D3D11Replay::Shutdown()
 
   // explicitly delete the device, as all the replay resources created will be keeping refs on it
   delete m_pDevice;
+
+  Threading::JobSystem::Shutdown();
 }
 
 RDResult D3D11Replay::FatalErrorCheck()
@@ -275,6 +277,10 @@ void D3D11Replay::CreateResources(IDXGIFactory *factory)
   }
 
   RenderDoc::Inst().SetProgress(LoadProgress::DebugManagerInit, 1.0f);
+
+  // worker threads are used to step large shader debug workgroups
+  if(!m_Proxy)
+    Threading::JobSystem::Init();
 }
 
 void D3D11Replay::DestroyResources()
@@ -291,6 +291,8 @@ public:
   ShaderDebugTrace *DebugMeshThread(uint32_t eventId, const rdcfixedarray<uint32_t, 3> &groupid,
                                     const rdcfixedarray<uint32_t, 3> &threadid);
   rdcarray<ShaderDebugState> ContinueDebug(ShaderDebugger *debugger);
+  ShaderDebugState SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex);
+  rdcarray<rdcarray<uint32_t>> GetDebugLaneExecutions(ShaderDebugger *debugger);
   void FreeDebugger(ShaderDebugger *debugger);
 
   uint32_t PickVertex(uint32_t eventId, int32_t width, int32_t height, const MeshDisplay &cfg,
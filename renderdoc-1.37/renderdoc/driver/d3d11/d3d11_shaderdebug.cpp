@@ -2722,6 +2722,27 @@ rdcarray<ShaderDebugState> D3D11Replay::ContinueDebug(ShaderDebugger *debugger)
   return interpreter->ContinueDebug(&apiWrapper);
 }
 
+ShaderDebugState D3D11Replay::SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex)
+{
+  DXBCDebug::InterpretDebugger *interpreter = (DXBCDebug::InterpretDebugger *)debugger;
+
+  if(!interpreter)
+    return {};
+
+  D3D11DebugAPIWrapper apiWrapper(m_pDevice, interpreter->dxbc, interpreter->global,
+                                  interpreter->eventId);
+
+  D3D11MarkerRegion region("SeekDebug Simulation Loop");
+
+  return interpreter->SeekDebug(&apiWrapper, stepIndex);
+}
+
+rdcarray<rdcarray<uint32_t>> D3D11Replay::GetDebugLaneExecutions(ShaderDebugger *debugger)
+{
+  // the DXBC debugger doesn't count executions for the other lanes it simulates
+  return {};
+}
+
 void D3D11Replay::FreeDebugger(ShaderDebugger *debugger)
 {
   delete debugger;
@@ -3504,6 +3504,38 @@ rdcarray<ShaderDebugState> D3D12Replay::ContinueDebug(ShaderDebugger *debugger)
   }
 }
 
+ShaderDebugState D3D12Replay::SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex)
+{
+  if(!debugger)
+    return {};
+
+  if(((DXBCContainerDebugger *)debugger)->isDXIL)
+  {
+    DXILDebug::Debugger *dxilDebugger = (DXILDebug::Debugger *)debugger;
+    DXILDebug::D3D12APIWrapper apiWrapper(m_pDevice, dxilDebugger->GetProgram(),
+                                          dxilDebugger->GetGlobalState(), dxilDebugger->GetEventId());
+    D3D12MarkerRegion region(m_pDevice->GetQueue()->GetReal(), "SeekDebug Simulation Loop");
+    return dxilDebugger->SeekDebug(&apiWrapper, stepIndex);
+  }
+  else
+  {
+    DXBCDebug::InterpretDebugger *interpreter = (DXBCDebug::InterpretDebugger *)debugger;
+
+    D3D12DebugAPIWrapper apiWrapper(m_pDevice, interpreter->dxbc, interpreter->global,
+                                    interpreter->eventId);
+
+    D3D12MarkerRegion region(m_pDevice->GetQueue()->GetReal(), "SeekDebug Simulation Loop");
+
+    return interpreter->SeekDebug(&apiWrapper, stepIndex);
+  }
+}
+
+rdcarray<rdcarray<uint32_t>> D3D12Replay::GetDebugLaneExecutions(ShaderDebugger *debugger)
+{
+  // the DXBC and DXIL debuggers don't count executions for the other lanes they simulate
+  return {};
+}
+
 void D3D12Replay::FreeDebugger(ShaderDebugger *debugger)
 {
   delete debugger;
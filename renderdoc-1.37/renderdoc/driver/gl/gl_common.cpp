@@ -2140,6 +2140,20 @@ ResourceFormat MakeResourceFormat(GLenum target, GLenum fmt)
       default: RDCERR("Unexpected compressed format %#x", fmt); break;
     }
 
+    if(ret.type == ResourceFormatType::ASTC)
+    {
+      rdcfixedarray<uint32_t, 3> blockSize = GetCompressedBlockSize(fmt);
+      ret.SetBlockFootprint(blockSize[0], blockSize[1], blockSize[2]);
+    }
+    else if(ret.type == ResourceFormatType::PVRTC)
+    {
+      if(fmt == eGL_COMPRESSED_SRGB_PVRTC_2BPPV1_EXT ||
+         fmt == eGL_COMPRESSED_SRGB_ALPHA_PVRTC_2BPPV1_EXT)
+        ret.SetBlockFootprint(8, 4, 1);
+      else
+        ret.SetBlockFootprint(4, 4, 1);
+    }
+
     return ret;
   }
 
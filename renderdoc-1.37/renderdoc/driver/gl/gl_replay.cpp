@@ -4319,6 +4319,18 @@ rdcarray<ShaderDebugState> GLReplay::ContinueDebug(ShaderDebugger *debugger)
   return {};
 }
 
+ShaderDebugState GLReplay::SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex)
+{
+  GLNOTIMP("SeekDebug");
+  return {};
+}
+
+rdcarray<rdcarray<uint32_t>> GLReplay::GetDebugLaneExecutions(ShaderDebugger *debugger)
+{
+  GLNOTIMP("GetDebugLaneExecutions");
+  return {};
+}
+
 void GLReplay::FreeDebugger(ShaderDebugger *debugger)
 {
   delete debugger;
@@ -3070,19 +3070,22 @@ void WrappedOpenGL::PersistentMapMemoryBarrier(const std::set<GLResourceRecord *
 
     if(record->Map.ptr)
     {
-      size_t diffStart = 0, diffEnd = record->Map.length;
-      bool found = true;
+      DiffRange diffs[MaxMapFlushRanges];
+      size_t numDiffs = 1;
+      diffs[0] = {0, (size_t)record->Map.length};
 
       if(record->GetShadowPtr(0))
-        found = FindDiffRange(record->GetShadowPtr(0), record->Map.ptr, (size_t)record->Map.length,
-                              diffStart, diffEnd);
+        numDiffs = FindDiffRanges(record->GetShadowPtr(0), record->Map.ptr,
+                                  (size_t)record->Map.length, diffs, MaxMapFlushRanges);
+      else
+        record->AllocShadowStorage(record->Map.length);
 
-      if(found && diffEnd > diffStart)
+      for(size_t d = 0; d < numDiffs; d++)
       {
-        // update the modified region in the 'comparison' shadow buffer for next check
-        if(record->GetShadowPtr(0) == NULL)
-          record->AllocShadowStorage(record->Map.length);
+        const size_t diffStart = diffs[d].start;
+        const size_t diffEnd = diffs[d].end;
 
+        // update the modified region in the 'comparison' shadow buffer for next check
         memcpy(record->GetShadowPtr(0) + diffStart, record->Map.ptr + diffStart, diffEnd - diffStart);
 
         // we use our own flush function so it will serialise chunks when necessary, and it
@@ -26,6 +26,7 @@
 #include "dxbc_debug.h"
 #include <algorithm>
 #include "common/formatting.h"
+#include "common/threading.h"
 #include "core/settings.h"
 #include "driver/dxgi/dxgi_common.h"
 #include "maths/formatpacking.h"
@@ -36,6 +37,15 @@
 RDOC_DEBUG_CONFIG(bool, D3D_Hack_EnableGroups, false,
                   "Work in progress allow shaders to be debugged with workgroup requirements.");
 
+RDOC_EXTERN_CONFIG(bool, Replay_Debug_SingleThreadedShaderDebugging);
+RDOC_EXTERN_CONFIG(uint32_t, Replay_Debug_ShaderCheckpointInterval);
+RDOC_EXTERN_CONFIG(uint32_t, Replay_Debug_ShaderMaxCheckpoints);
+
+// stepping lanes on worker threads only pays off for large workgroups, which are only possible
+// for compute shaders with D3D_Hack_EnableGroups
+static const int ParallelLaneThreshold = 64;
+static const size_t ParallelLaneGrainSize = 16;
+
 using namespace DXBCBytecode;
 using namespace DXDebug;
 
@@ -424,6 +434,111 @@ bool OperationFlushing(const DXBCBytecode::OpcodeType &op)
   return false;
 }
 
+// operations which only read the executing lane's registers, constant buffers and the previous
+// tick's copy of the workgroup, only write the executing lane's registers, and never call out to
+// the API wrapper. Lanes can execute these concurrently in any order
+bool OperationLaneLocal(const DXBCBytecode::OpcodeType &op)
+{
+  switch(op)
+  {
+    case OPCODE_NOP:
+    case OPCODE_DADD:
+    case OPCODE_IADD:
+    case OPCODE_ADD:
+    case OPCODE_DDIV:
+    case OPCODE_DIV:
+    case OPCODE_UDIV:
+    case OPCODE_BFREV:
+    case OPCODE_COUNTBITS:
+    case OPCODE_FIRSTBIT_HI:
+    case OPCODE_FIRSTBIT_LO:
+    case OPCODE_FIRSTBIT_SHI:
+    case OPCODE_IMUL:
+    case OPCODE_UMUL:
+    case OPCODE_DMUL:
+    case OPCODE_MUL:
+    case OPCODE_UADDC:
+    case OPCODE_USUBB:
+    case OPCODE_IMAD:
+    case OPCODE_UMAD:
+    case OPCODE_MAD:
+    case OPCODE_DFMA:
+    case OPCODE_DP2:
+    case OPCODE_DP3:
+    case OPCODE_DP4:
+    case OPCODE_F16TOF32:
+    case OPCODE_F32TOF16:
+    case OPCODE_FRC:
+    case OPCODE_ROUND_PI:
+    case OPCODE_ROUND_NI:
+    case OPCODE_ROUND_Z:
+    case OPCODE_ROUND_NE:
+    case OPCODE_INEG:
+    case OPCODE_IMIN:
+    case OPCODE_UMIN:
+    case OPCODE_DMIN:
+    case OPCODE_MIN:
+    case OPCODE_UMAX:
+    case OPCODE_IMAX:
+    case OPCODE_DMAX:
+    case OPCODE_MAX:
+    case OPCODE_SQRT:
+    case OPCODE_DRCP:
+    case OPCODE_IBFE:
+    case OPCODE_UBFE:
+    case OPCODE_BFI:
+    case OPCODE_ISHL:
+    case OPCODE_USHR:
+    case OPCODE_ISHR:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_NOT:
+    case OPCODE_DMOV:
+    case OPCODE_MOV:
+    case OPCODE_DMOVC:
+    case OPCODE_MOVC:
+    case OPCODE_SWAPC:
+    case OPCODE_ITOF:
+    case OPCODE_UTOF:
+    case OPCODE_FTOI:
+    case OPCODE_FTOU:
+    case OPCODE_ITOD:
+    case OPCODE_UTOD:
+    case OPCODE_FTOD:
+    case OPCODE_DTOI:
+    case OPCODE_DTOU:
+    case OPCODE_DTOF:
+    case OPCODE_EQ:
+    case OPCODE_NE:
+    case OPCODE_LT:
+    case OPCODE_GE:
+    case OPCODE_DEQ:
+    case OPCODE_DNE:
+    case OPCODE_DGE:
+    case OPCODE_DLT:
+    case OPCODE_IEQ:
+    case OPCODE_INE:
+    case OPCODE_IGE:
+    case OPCODE_ILT:
+    case OPCODE_ULT:
+    case OPCODE_UGE:
+    // derivatives read neighbours from the previous tick's copy, which isn't written while stepping
+    case OPCODE_DERIV_RTX:
+    case OPCODE_DERIV_RTX_COARSE:
+    case OPCODE_DERIV_RTX_FINE:
+    case OPCODE_DERIV_RTY:
+    case OPCODE_DERIV_RTY_COARSE:
+    case OPCODE_DERIV_RTY_FINE: return true;
+
+    // everything else - transcendentals calculated on the GPU, resource access, groupshared
+    // memory, atomics and flow control - is stepped serially
+    default: break;
+  }
+
+  return false;
+}
+
 bool OperandSwizzle(const Operation &op, const Operand &oper)
 {
   switch(op.operation)
@@ -1921,7 +2036,9 @@ void ThreadState::StepNext(ShaderDebugState *state, DebugAPIWrapper *apiWrapper,
 
   const Operation &op = program->GetInstruction((size_t)nextInstruction);
 
-  apiWrapper->SetCurrentInstruction(nextInstruction);
+  // lanes stepped concurrently have no API wrapper, and only execute lane-local operations
+  if(apiWrapper)
+    apiWrapper->SetCurrentInstruction(nextInstruction);
   nextInstruction++;
 
   if(nextInstruction >= program->GetNumInstructions())
@@ -4969,6 +5086,8 @@ ShaderDebugTrace *InterpretDebugger::BeginDebug(const DXBC::DXBCContainer *dxbcC
   this->dxbc = dxbcContainer;
   this->activeLaneIndex = activeIndex;
 
+  checkpoints.Init(Replay_Debug_ShaderCheckpointInterval(), Replay_Debug_ShaderMaxCheckpoints());
+
   uint32_t numthreads[3] = {0, 0, 0};
 
   for(size_t i = 0; i < dxbcContainer->GetDXBCByteCode()->GetNumDeclarations(); i++)
@@ -5474,66 +5593,281 @@ rdcarray<ShaderDebugState> InterpretDebugger::ContinueDebug(DXBCDebug::DebugAPIW
 
   rdcarray<ShaderDebugState> ret;
 
-  // if we've finished, return an empty set to signify that
-  if(active.Finished())
-    return ret;
+  rdcarray<DXBCDebug::ThreadState> oldworkgroup = workgroup;
+
+  rdcarray<bool> activeMask;
+  auto restore = [this](uint32_t step) { RestoreCheckpoint(step); };
+  auto stepWorkgroup = [this, apiWrapper, &oldworkgroup,
+                        &activeMask](rdcarray<ShaderDebugState> &states) {
+    return StepWorkgroup(apiWrapper, oldworkgroup, activeMask, states);
+  };
 
   // initialise a blank set of shader variable changes in the first ShaderDebugState
   if(steps == 0)
   {
-    ShaderDebugState initial;
+    // if we've finished, return an empty set to signify that
+    if(active.Finished())
+      return ret;
 
-    active.PrepareInitial(initial);
+    ret.push_back(BeginStepping());
+  }
+  else if(checkpoints.Resume(uint32_t(steps - 1), numContinued, restore, stepWorkgroup))
+  {
+    ret.push_back(initialState);
+  }
 
-    ret.push_back(std::move(initial));
+  // continue stepping until we have 100 target steps completed in a chunk. This may involve doing
+  // more steps if our target thread is inactive
+  for(int stepEnd = steps + 100; steps < stepEnd;)
+  {
+    if(!StepWorkgroup(apiWrapper, oldworkgroup, activeMask, ret))
+      break;
+  }
+
+  numContinued = uint32_t(steps);
+
+  return ret;
+}
+
+ShaderDebugState InterpretDebugger::SeekDebug(DXBCDebug::DebugAPIWrapper *apiWrapper,
+                                              uint32_t stepIndex)
+{
+  if(!checkpoints.Enabled())
+    return ShaderDebugState();
 
-    steps++;
+  if(steps == 0)
+  {
+    if(activeLane().Finished())
+      return ShaderDebugState();
+
+    BeginStepping();
   }
 
-  rdcarray<DXBCDebug::ThreadState> oldworkgroup = workgroup;
+  uint32_t current = uint32_t(steps - 1);
 
+  // if we've already finished we know where the last step is
+  if(activeLane().Finished())
+    stepIndex = RDCMIN(stepIndex, current);
+
+  rdcarray<DXBCDebug::ThreadState> oldworkgroup = workgroup;
   rdcarray<bool> activeMask;
+  ShaderDebugState ret = checkpoints.Seek(
+      current, stepIndex, [this](uint32_t step) { RestoreCheckpoint(step); },
+      [this, apiWrapper, &oldworkgroup, &activeMask](rdcarray<ShaderDebugState> &states) {
+        return StepWorkgroup(apiWrapper, oldworkgroup, activeMask, states);
+      });
 
-  // continue stepping until we have 100 target steps completed in a chunk. This may involve doing
-  // more steps if our target thread is inactive
-  for(int stepEnd = steps + 100; steps < stepEnd;)
+  if(stepIndex == 0)
   {
-    if(active.Finished())
-      break;
+    activeLane().PrepareInitial(ret);
+  }
+  else
+  {
+    // return a full state, rather than the changes made by this step
+    ret.changes.clear();
+    for(const ShaderVariable &v : activeLane().variables)
+      ret.changes.push_back({ShaderVariable(), v});
+  }
+
+  ret.stepIndex = uint32_t(steps - 1);
+
+  return ret;
+}
+
+ShaderDebugState InterpretDebugger::BeginStepping()
+{
+  ShaderDebugState initial;
+
+  activeLane().PrepareInitial(initial);
+
+  steps++;
+
+  // always checkpoint the start so that every step can be reached again
+  if(checkpoints.ShouldSave(0))
+  {
+    SaveCheckpoint();
+    initialState = initial;
+  }
+
+  return initial;
+}
+
+bool InterpretDebugger::StepWorkgroup(DXBCDebug::DebugAPIWrapper *apiWrapper,
+                                      rdcarray<DXBCDebug::ThreadState> &oldworkgroup,
+                                      rdcarray<bool> &activeMask, rdcarray<ShaderDebugState> &ret)
+{
+  DXBCDebug::ThreadState &active = activeLane();
+
+  if(active.Finished())
+    return false;
+
+  if(checkpoints.ShouldSave(uint32_t(steps - 1)))
+    SaveCheckpoint();
 
-    // set up the old workgroup so that cross-workgroup/cross-quad operations (e.g. DDX/DDY) get
-    // consistent results even when we step the quad out of order. Otherwise if an operation reads
-    // and writes from the same register we'd trash data needed for other workgroup elements.
+  const bool parallel = !Replay_Debug_SingleThreadedShaderDebugging() &&
+                        workgroup.count() >= ParallelLaneThreshold;
+
+  // set up the old workgroup so that cross-workgroup/cross-quad operations (e.g. DDX/DDY) get
+  // consistent results even when we step the quad out of order. Otherwise if an operation reads
+  // and writes from the same register we'd trash data needed for other workgroup elements.
+  if(parallel)
+  {
+    Threading::JobSystem::ParallelFor(oldworkgroup.size(), ParallelLaneGrainSize,
+                                      [this, &oldworkgroup](size_t begin, size_t end) {
+                                        for(size_t i = begin; i < end; i++)
+                                          oldworkgroup[i].variables = workgroup[i].variables;
+                                      });
+  }
+  else
+  {
     for(size_t i = 0; i < oldworkgroup.size(); i++)
       oldworkgroup[i].variables = workgroup[i].variables;
+  }
 
-    // calculate the current mask of which threads are active
-    CalcActiveMask(activeMask);
+  // calculate the current mask of which threads are active
+  CalcActiveMask(activeMask);
 
-    // step all active members of the workgroup
-    for(int i = 0; i < workgroup.count(); i++)
+  // if every active lane is on a lane-local operation the order they step in doesn't matter, so
+  // step all but the active lane on worker threads. The active lane records the debug state
+  if(parallel && CanStepLanesInParallel(activeMask))
+  {
+    Threading::JobSystem::ParallelFor(
+        workgroup.size(), ParallelLaneGrainSize,
+        [this, &activeMask, &oldworkgroup](size_t begin, size_t end) {
+          for(size_t i = begin; i < end; i++)
+          {
+            if(int(i) != activeLaneIndex && activeMask[i])
+              workgroup[i].StepNext(NULL, NULL, oldworkgroup);
+          }
+        });
+
+    if(activeMask[activeLaneIndex])
     {
-      if(activeMask[i])
+      ShaderDebugState state;
+      active.StepNext(&state, apiWrapper, oldworkgroup);
+      state.stepIndex = steps;
+      state.nextInstruction = active.nextInstruction;
+      ret.push_back(std::move(state));
+
+      steps++;
+    }
+
+    return true;
+  }
+
+  // step all active members of the workgroup
+  for(int i = 0; i < workgroup.count(); i++)
+  {
+    if(activeMask[i])
+    {
+      if(i == activeLaneIndex)
       {
-        if(i == activeLaneIndex)
-        {
-          ShaderDebugState state;
-          workgroup[i].StepNext(&state, apiWrapper, oldworkgroup);
-          state.stepIndex = steps;
-          state.nextInstruction = workgroup[i].nextInstruction;
-          ret.push_back(std::move(state));
+        ShaderDebugState state;
+        workgroup[i].StepNext(&state, apiWrapper, oldworkgroup);
+        state.stepIndex = steps;
+        state.nextInstruction = workgroup[i].nextInstruction;
+        ret.push_back(std::move(state));
 
-          steps++;
-        }
-        else
-        {
-          workgroup[i].StepNext(NULL, apiWrapper, oldworkgroup);
-        }
+        steps++;
+      }
+      else
+      {
+        workgroup[i].StepNext(NULL, apiWrapper, oldworkgroup);
       }
     }
   }
 
-  return ret;
+  return true;
+}
+
+InterpretDebugger::Checkpoint::~Checkpoint()
+{
+  for(auto it = uavs.begin(); it != uavs.end(); ++it)
+    it->second.data->Release();
+}
+
+void InterpretDebugger::SaveCheckpoint()
+{
+  uint32_t step = uint32_t(steps - 1);
+
+  // share UAV contents with the previous checkpoint where they haven't changed. This has to be
+  // done before adding the new checkpoint, as that may drop the previous one
+  uint32_t prevStep = 0;
+  const Checkpoint *prev = step > 0 ? checkpoints.FindNearest(step - 1, prevStep) : NULL;
+
+  std::map<BindingSlot, UAVCheckpoint> uavs;
+  for(auto it = global.uavs.begin(); it != global.uavs.end(); ++it)
+  {
+    CheckpointBytes *prevData = NULL;
+    if(prev)
+    {
+      auto prevIt = prev->uavs.find(it->first);
+      if(prevIt != prev->uavs.end())
+        prevData = prevIt->second.data;
+    }
+
+    UAVCheckpoint &uav = uavs[it->first];
+    uav.data = CheckpointBytes::Share(prevData, it->second.data);
+    uav.hiddenCounter = it->second.hiddenCounter;
+  }
+
+  Checkpoint &cp = checkpoints.Add(step);
+  cp.workgroup = workgroup;
+  cp.groupshared = global.groupshared;
+  cp.uavs.swap(uavs);
+}
+
+void InterpretDebugger::RestoreCheckpoint(uint32_t step)
+{
+  uint32_t cpStep = 0;
+  const Checkpoint *cp = checkpoints.FindNearest(step, cpStep);
+  if(!cp)
+  {
+    RDCERR("No checkpoint available to restore step %u", step);
+    return;
+  }
+
+  workgroup = cp->workgroup;
+  global.groupshared = cp->groupshared;
+
+  // UAVs first used after the checkpoint are dropped, to be fetched again untouched
+  for(auto it = global.uavs.begin(); it != global.uavs.end();)
+  {
+    auto saved = cp->uavs.find(it->first);
+    if(saved == cp->uavs.end())
+    {
+      it = global.uavs.erase(it);
+      continue;
+    }
+
+    it->second.data = saved->second.data->Data();
+    it->second.hiddenCounter = saved->second.hiddenCounter;
+    ++it;
+  }
+
+  steps = int(cpStep + 1);
+}
+
+bool InterpretDebugger::CanStepLanesInParallel(const rdcarray<bool> &activeMask) const
+{
+  const DXBCBytecode::Program *program = dxbc->GetDXBCByteCode();
+
+  int numActive = 0;
+  for(int i = 0; i < workgroup.count(); i++)
+  {
+    if(!activeMask[i])
+      continue;
+
+    const DXBCDebug::ThreadState &thread = workgroup[i];
+
+    if(thread.nextInstruction >= program->GetNumInstructions() ||
+       !DXBCDebug::OperationLaneLocal(program->GetInstruction(thread.nextInstruction).operation))
+      return false;
+
+    numActive++;
+  }
+
+  return numActive >= ParallelLaneThreshold;
 }
 
 };    // namespace ShaderDebug
@@ -26,6 +26,7 @@
 #pragma once
 
 #include "common/common.h"
+#include "replay/common/debug_checkpoints.h"
 #include "dx_debug.h"
 #include "dxbc_bytecode.h"
 
@@ -294,7 +295,43 @@ struct InterpretDebugger : public DXBCContainerDebugger
   const DXBC::DXBCContainer *dxbc;
 
   void CalcActiveMask(rdcarray<bool> &activeMask);
+  bool CanStepLanesInParallel(const rdcarray<bool> &activeMask) const;
   rdcarray<ShaderDebugState> ContinueDebug(DebugAPIWrapper *apiWrapper);
+  ShaderDebugState SeekDebug(DebugAPIWrapper *apiWrapper, uint32_t stepIndex);
+
+private:
+  struct UAVCheckpoint
+  {
+    CheckpointBytes *data = NULL;
+    uint32_t hiddenCounter = 0;
+  };
+
+  struct Checkpoint
+  {
+    Checkpoint() = default;
+    ~Checkpoint();
+
+    rdcarray<ThreadState> workgroup;
+    rdcarray<GlobalState::groupsharedMem> groupshared;
+    std::map<BindingSlot, UAVCheckpoint> uavs;
+
+  private:
+    Checkpoint(const Checkpoint &) = delete;
+    Checkpoint &operator=(const Checkpoint &) = delete;
+  };
+
+  DebugCheckpoints<Checkpoint> checkpoints;
+
+  // how many states ContinueDebug has returned, to carry on from there after seeking, and the first
+  // of them which can't be re-executed
+  uint32_t numContinued = 0;
+  ShaderDebugState initialState;
+
+  ShaderDebugState BeginStepping();
+  bool StepWorkgroup(DebugAPIWrapper *apiWrapper, rdcarray<ThreadState> &oldworkgroup,
+                     rdcarray<bool> &activeMask, rdcarray<ShaderDebugState> &ret);
+  void SaveCheckpoint();
+  void RestoreCheckpoint(uint32_t step);
 };
 
 uint32_t GetLogicalIdentifierForBindingSlot(const DXBCBytecode::Program &program,
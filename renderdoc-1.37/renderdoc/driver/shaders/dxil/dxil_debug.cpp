@@ -31,6 +31,9 @@
 RDOC_CONFIG(bool, D3D12_DXILShaderDebugger_Logging, false,
             "Debug logging for the DXIL shader debugger");
 
+RDOC_EXTERN_CONFIG(uint32_t, Replay_Debug_ShaderCheckpointInterval);
+RDOC_EXTERN_CONFIG(uint32_t, Replay_Debug_ShaderMaxCheckpoints);
+
 // TODO: Extend support for Compound Constants: arithmetic, logical ops
 // TODO: Assert m_Block in ThreadState is correct per instruction
 // TODO: Automatically execute phi instructions after a branch
@@ -1689,6 +1692,109 @@ void ThreadState::InitialiseHelper(const ThreadState &activeState)
   m_IsGlobal = activeState.m_IsGlobal;
 }
 
+void ThreadState::SaveCheckpoint(LaneCheckpoint &cp) const
+{
+  cp.callstack = m_Callstack;
+  cp.output = m_Output;
+  cp.variables = m_Variables;
+  cp.phiVariables = m_PhiVariables;
+  cp.live = m_Live;
+  cp.isGlobal = m_IsGlobal;
+  cp.assigned = m_Assigned;
+  cp.annotatedProperties = m_AnnotatedProperties;
+  cp.directHeapAccessBindings = m_DirectHeapAccessBindings;
+
+  // global memory is shared by the workgroup and saved once by the debugger
+  cp.allocations.clear();
+  for(auto it = m_Memory.m_Allocations.begin(); it != m_Memory.m_Allocations.end(); ++it)
+  {
+    if(!it->second.global)
+      cp.allocations[it->first] =
+          bytebuf((const byte *)it->second.backingMemory, (size_t)it->second.size);
+  }
+
+  cp.pointers.clear();
+  for(auto it = m_Memory.m_Pointers.begin(); it != m_Memory.m_Pointers.end(); ++it)
+  {
+    const MemoryTracking::Pointer &ptr = it->second;
+    auto alloc = m_Memory.m_Allocations.find(ptr.baseMemoryId);
+    if(alloc == m_Memory.m_Allocations.end())
+      continue;
+
+    uint64_t offset = (const byte *)ptr.memory - (const byte *)alloc->second.backingMemory;
+    cp.pointers[it->first] = {ptr.baseMemoryId, offset, ptr.size};
+  }
+
+  cp.functionInfo = m_FunctionInfo;
+  cp.functionInstructionIdx = m_FunctionInstructionIdx;
+  cp.currentInstruction = m_CurrentInstruction;
+  cp.block = m_Block;
+  cp.previousBlock = m_PreviousBlock;
+  cp.activeGlobalInstructionIdx = m_ActiveGlobalInstructionIdx;
+  cp.accessedSRVs = m_accessedSRVs;
+  cp.accessedUAVs = m_accessedUAVs;
+  cp.killed = m_Killed;
+  cp.ended = m_Ended;
+}
+
+void ThreadState::RestoreCheckpoint(const LaneCheckpoint &cp)
+{
+  m_Callstack = cp.callstack;
+  m_Output = cp.output;
+  m_Variables = cp.variables;
+  m_PhiVariables = cp.phiVariables;
+  m_Live = cp.live;
+  m_IsGlobal = cp.isGlobal;
+  m_Assigned = cp.assigned;
+  m_AnnotatedProperties = cp.annotatedProperties;
+  m_DirectHeapAccessBindings = cp.directHeapAccessBindings;
+
+  // free stack allocations made after the checkpoint, then put back the saved contents. Allocations
+  // freed by restoring an earlier checkpoint are recreated
+  for(auto it = m_Memory.m_Allocations.begin(); it != m_Memory.m_Allocations.end();)
+  {
+    if(!it->second.global && cp.allocations.find(it->first) == cp.allocations.end())
+    {
+      free(it->second.backingMemory);
+      it = m_Memory.m_Allocations.erase(it);
+      continue;
+    }
+    ++it;
+  }
+
+  for(auto it = cp.allocations.begin(); it != cp.allocations.end(); ++it)
+  {
+    MemoryTracking::Allocation &alloc = m_Memory.m_Allocations[it->first];
+    if(alloc.backingMemory == NULL || alloc.size != it->second.size())
+    {
+      free(alloc.backingMemory);
+      alloc.backingMemory = malloc(it->second.size());
+      alloc.size = it->second.size();
+      alloc.global = false;
+    }
+    memcpy(alloc.backingMemory, it->second.data(), it->second.size());
+  }
+
+  m_Memory.m_Pointers.clear();
+  for(auto it = cp.pointers.begin(); it != cp.pointers.end(); ++it)
+  {
+    const LaneCheckpoint::Pointer &ptr = it->second;
+    byte *base = (byte *)m_Memory.m_Allocations[ptr.baseMemoryId].backingMemory;
+    m_Memory.m_Pointers[it->first] = {ptr.baseMemoryId, base + ptr.offset, ptr.size};
+  }
+
+  m_FunctionInfo = cp.functionInfo;
+  m_FunctionInstructionIdx = cp.functionInstructionIdx;
+  m_CurrentInstruction = cp.currentInstruction;
+  m_Block = cp.block;
+  m_PreviousBlock = cp.previousBlock;
+  m_ActiveGlobalInstructionIdx = cp.activeGlobalInstructionIdx;
+  m_accessedSRVs = cp.accessedSRVs;
+  m_accessedUAVs = cp.accessedUAVs;
+  m_Killed = cp.killed;
+  m_Ended = cp.ended;
+}
+
 bool ThreadState::Finished() const
 {
   return m_Killed || m_Ended || m_Callstack.empty();
@@ -7611,6 +7717,8 @@ ShaderDebugTrace *Debugger::BeginDebug(uint32_t eventId, const DXBC::DXBCContain
   m_Steps = 0;
   m_Stage = shaderStage;
 
+  m_Checkpoints.Init(Replay_Debug_ShaderCheckpointInterval(), Replay_Debug_ShaderMaxCheckpoints());
+
   // Ensure the DXIL reflection data is built
   DXIL::Program *program = ((DXIL::Program *)m_Program);
   program->BuildReflection();
@@ -8453,101 +8561,268 @@ ShaderDebugTrace *Debugger::BeginDebug(uint32_t eventId, const DXBC::DXBCContain
 
 rdcarray<ShaderDebugState> Debugger::ContinueDebug(DebugAPIWrapper *apiWrapper)
 {
-  ThreadState &active = GetActiveLane();
-
   rdcarray<ShaderDebugState> ret;
 
+  rdcarray<bool> activeMask;
+  auto restore = [this](uint32_t step) { RestoreCheckpoint(step); };
+  auto stepWorkgroup = [this, apiWrapper, &activeMask](rdcarray<ShaderDebugState> &states) {
+    return StepWorkgroup(apiWrapper, activeMask, states);
+  };
+
   // initialise the first ShaderDebugState if we haven't stepped yet
   if(m_Steps == 0)
+    ret.push_back(BeginStepping());
+  else if(m_Checkpoints.Resume(uint32_t(m_Steps - 1), m_NumContinued, restore, stepWorkgroup))
+    ret.push_back(m_InitialState);
+
+  for(int stepEnd = m_Steps + 100; m_Steps < stepEnd;)
+  {
+    if(!StepWorkgroup(apiWrapper, activeMask, ret))
+      break;
+  }
+
+  m_NumContinued = uint32_t(m_Steps);
+
+  return ret;
+}
+
+ShaderDebugState Debugger::SeekDebug(DebugAPIWrapper *apiWrapper, uint32_t stepIndex)
+{
+  if(!m_Checkpoints.Enabled())
+    return ShaderDebugState();
+
+  if(m_Steps == 0)
+    BeginStepping();
+
+  ThreadState &active = GetActiveLane();
+
+  uint32_t current = uint32_t(m_Steps - 1);
+
+  // if we've already finished we know where the last step is
+  if(active.Finished())
+    stepIndex = RDCMIN(stepIndex, current);
+
+  rdcarray<bool> activeMask;
+  ShaderDebugState ret = m_Checkpoints.Seek(
+      current, stepIndex, [this](uint32_t step) { RestoreCheckpoint(step); },
+      [this, apiWrapper, &activeMask](rdcarray<ShaderDebugState> &states) {
+        return StepWorkgroup(apiWrapper, activeMask, states);
+      });
+
+  // return a full state, rather than the changes made by this step
+  ret.changes.clear();
+  for(auto it = active.m_Variables.begin(); it != active.m_Variables.end(); ++it)
+  {
+    if(active.m_Live[it->first])
+      ret.changes.push_back({ShaderVariable(), it->second});
+  }
+
+  for(const GlobalConstant &c : m_GlobalState.constants)
+  {
+    if(!active.m_Live[c.id])
+      ret.changes.push_back({ShaderVariable(), c.var});
+  }
+
+  ret.nextInstruction = active.m_ActiveGlobalInstructionIdx;
+  ret.callstack.clear();
+  active.FillCallstack(ret);
+  ret.stepIndex = uint32_t(m_Steps - 1);
+
+  return ret;
+}
+
+ShaderDebugState Debugger::BeginStepping()
+{
+  ShaderDebugState initial;
+
+  for(size_t lane = 0; lane < m_Workgroups.size(); lane++)
+  {
+    ThreadState &thread = m_Workgroups[lane];
+
+    if(lane == m_ActiveLaneIndex)
+    {
+      thread.EnterEntryPoint(m_EntryPointFunction, &initial);
+      thread.FillCallstack(initial);
+      initial.nextInstruction = thread.m_ActiveGlobalInstructionIdx;
+    }
+    else
+    {
+      thread.EnterEntryPoint(m_EntryPointFunction, NULL);
+    }
+  }
+
+  // globals won't be filled out by entering the entry point, ensure their change is registered.
+  for(const GlobalVariable &gv : m_GlobalState.globals)
+    initial.changes.push_back({ShaderVariable(), gv.var});
+
+  // constants won't be filled out by entering the entry point, ensure their change is registered.
+  for(const GlobalConstant &c : m_GlobalState.constants)
+    initial.changes.push_back({ShaderVariable(), c.var});
+
+  m_Steps++;
+
+  // always checkpoint the start so that every step can be reached again
+  if(m_Checkpoints.ShouldSave(0))
   {
-    ShaderDebugState initial;
+    SaveCheckpoint();
+    m_InitialState = initial;
+  }
+
+  return initial;
+}
+
+bool Debugger::StepWorkgroup(DebugAPIWrapper *apiWrapper, rdcarray<bool> &activeMask,
+                             rdcarray<ShaderDebugState> &ret)
+{
+  ThreadState &active = GetActiveLane();
+
+  if(active.Finished())
+    return false;
+
+  if(m_Checkpoints.ShouldSave(uint32_t(m_Steps - 1)))
+    SaveCheckpoint();
+
+  // calculate the current mask of which threads are active
+  CalcActiveMask(activeMask);
 
-    for(size_t lane = 0; lane < m_Workgroups.size(); lane++)
+  // step all active members of the workgroup
+  ShaderDebugState state;
+  bool hasDebugState = false;
+  for(size_t lane = 0; lane < m_Workgroups.size(); lane++)
+  {
+    if(activeMask[lane])
     {
       ThreadState &thread = m_Workgroups[lane];
+      if(thread.Finished())
+      {
+        if(lane == m_ActiveLaneIndex)
+          ret.emplace_back();
+        continue;
+      }
 
       if(lane == m_ActiveLaneIndex)
       {
-        thread.EnterEntryPoint(m_EntryPointFunction, &initial);
-        thread.FillCallstack(initial);
-        initial.nextInstruction = thread.m_ActiveGlobalInstructionIdx;
+        hasDebugState = true;
+        state.stepIndex = m_Steps;
+        thread.StepNext(&state, apiWrapper, m_Workgroups);
+        m_Steps++;
       }
       else
       {
-        thread.EnterEntryPoint(m_EntryPointFunction, NULL);
+        thread.StepNext(NULL, apiWrapper, m_Workgroups);
       }
     }
+  }
+  for(size_t lane = 0; lane < m_Workgroups.size(); lane++)
+  {
+    if(activeMask[lane])
+      m_Workgroups[lane].StepOverNopInstructions();
+  }
+  // Update UI state after the execute and step over nops to make sure state.nextInstruction is in sync
+  if(hasDebugState)
+  {
+    ThreadState &thread = m_Workgroups[m_ActiveLaneIndex];
+    state.nextInstruction = thread.m_ActiveGlobalInstructionIdx;
+    thread.FillCallstack(state);
+    ret.push_back(std::move(state));
+  }
 
-    // globals won't be filled out by entering the entry point, ensure their change is registered.
-    for(const GlobalVariable &gv : m_GlobalState.globals)
-      initial.changes.push_back({ShaderVariable(), gv.var});
+  return true;
+}
 
-    // constants won't be filled out by entering the entry point, ensure their change is registered.
-    for(const GlobalConstant &c : m_GlobalState.constants)
-      initial.changes.push_back({ShaderVariable(), c.var});
+Debugger::Checkpoint::~Checkpoint()
+{
+  for(auto it = globalMemory.begin(); it != globalMemory.end(); ++it)
+    it->second->Release();
+  for(auto it = uavs.begin(); it != uavs.end(); ++it)
+    it->second.data->Release();
+}
 
-    ret.push_back(std::move(initial));
+void Debugger::SaveCheckpoint()
+{
+  uint32_t step = uint32_t(m_Steps - 1);
+
+  // share memory and UAV contents with the previous checkpoint where they haven't changed. This has
+  // to be done before adding the new checkpoint, as that may drop the previous one
+  uint32_t prevStep = 0;
+  const Checkpoint *prev = step > 0 ? m_Checkpoints.FindNearest(step - 1, prevStep) : NULL;
+
+  std::map<Id, CheckpointBytes *> globalMemory;
+  for(auto it = m_GlobalState.memory.m_Allocations.begin();
+      it != m_GlobalState.memory.m_Allocations.end(); ++it)
+  {
+    CheckpointBytes *prevData = NULL;
+    if(prev)
+    {
+      auto prevIt = prev->globalMemory.find(it->first);
+      if(prevIt != prev->globalMemory.end())
+        prevData = prevIt->second;
+    }
 
-    m_Steps++;
+    bytebuf bytes((const byte *)it->second.backingMemory, (size_t)it->second.size);
+    globalMemory[it->first] = CheckpointBytes::Share(prevData, bytes);
   }
 
-  // if we've finished, return an empty set to signify that
-  if(active.Finished())
-    return ret;
+  std::map<BindingSlot, UAVCheckpoint> uavs;
+  for(auto it = m_GlobalState.uavs.begin(); it != m_GlobalState.uavs.end(); ++it)
+  {
+    CheckpointBytes *prevData = NULL;
+    if(prev)
+    {
+      auto prevIt = prev->uavs.find(it->first);
+      if(prevIt != prev->uavs.end())
+        prevData = prevIt->second.data;
+    }
 
-  rdcarray<bool> activeMask;
+    UAVCheckpoint &uav = uavs[it->first];
+    uav.data = CheckpointBytes::Share(prevData, it->second.data);
+    uav.hiddenCounter = it->second.hiddenCounter;
+  }
 
-  for(int stepEnd = m_Steps + 100; m_Steps < stepEnd;)
+  Checkpoint &cp = m_Checkpoints.Add(step);
+  cp.lanes.resize(m_Workgroups.size());
+  for(size_t lane = 0; lane < m_Workgroups.size(); lane++)
+    m_Workgroups[lane].SaveCheckpoint(cp.lanes[lane]);
+  cp.globalMemory.swap(globalMemory);
+  cp.uavs.swap(uavs);
+}
+
+void Debugger::RestoreCheckpoint(uint32_t step)
+{
+  uint32_t cpStep = 0;
+  const Checkpoint *cp = m_Checkpoints.FindNearest(step, cpStep);
+  if(!cp)
   {
-    if(active.Finished())
-      break;
+    RDCERR("No checkpoint available to restore step %u", step);
+    return;
+  }
 
-    // calculate the current mask of which threads are active
-    CalcActiveMask(activeMask);
+  for(size_t lane = 0; lane < m_Workgroups.size(); lane++)
+    m_Workgroups[lane].RestoreCheckpoint(cp->lanes[lane]);
 
-    // step all active members of the workgroup
-    ShaderDebugState state;
-    bool hasDebugState = false;
-    for(size_t lane = 0; lane < m_Workgroups.size(); lane++)
-    {
-      if(activeMask[lane])
-      {
-        ThreadState &thread = m_Workgroups[lane];
-        if(thread.Finished())
-        {
-          if(lane == m_ActiveLaneIndex)
-            ret.emplace_back();
-          continue;
-        }
+  // global allocations are fixed for the whole debug session so are restored in place
+  for(auto it = cp->globalMemory.begin(); it != cp->globalMemory.end(); ++it)
+  {
+    MemoryTracking::Allocation &alloc = m_GlobalState.memory.m_Allocations[it->first];
+    memcpy(alloc.backingMemory, it->second->Data().data(), it->second->Data().size());
+  }
 
-        if(lane == m_ActiveLaneIndex)
-        {
-          hasDebugState = true;
-          state.stepIndex = m_Steps;
-          thread.StepNext(&state, apiWrapper, m_Workgroups);
-          m_Steps++;
-        }
-        else
-        {
-          thread.StepNext(NULL, apiWrapper, m_Workgroups);
-        }
-      }
-    }
-    for(size_t lane = 0; lane < m_Workgroups.size(); lane++)
-    {
-      if(activeMask[lane])
-        m_Workgroups[lane].StepOverNopInstructions();
-    }
-    // Update UI state after the execute and step over nops to make sure state.nextInstruction is in sync
-    if(hasDebugState)
+  // UAVs first used after the checkpoint are dropped, to be fetched again untouched
+  for(auto it = m_GlobalState.uavs.begin(); it != m_GlobalState.uavs.end();)
+  {
+    auto saved = cp->uavs.find(it->first);
+    if(saved == cp->uavs.end())
     {
-      ThreadState &thread = m_Workgroups[m_ActiveLaneIndex];
-      state.nextInstruction = thread.m_ActiveGlobalInstructionIdx;
-      thread.FillCallstack(state);
-      ret.push_back(std::move(state));
+      it = m_GlobalState.uavs.erase(it);
+      continue;
     }
+
+    it->second.data = saved->second.data->Data();
+    it->second.hiddenCounter = saved->second.hiddenCounter;
+    ++it;
   }
-  return ret;
+
+  m_Steps = int(cpStep + 1);
 }
 
 const FunctionInfo *Debugger::GetFunctionInfo(const DXIL::Function *function) const
@@ -29,6 +29,7 @@
 #include "driver/shaders/dxbc/dx_debug.h"
 #include "driver/shaders/dxbc/dxbc_bytecode.h"
 #include "driver/shaders/dxbc/dxbc_container.h"
+#include "replay/common/debug_checkpoints.h"
 #include "dxil_bytecode.h"
 #include "dxil_controlflow.h"
 #include "dxil_debuginfo.h"
@@ -46,6 +47,7 @@ typedef DXBC::InterpolationMode InterpolationMode;
 
 class Debugger;
 struct GlobalState;
+struct LaneCheckpoint;
 
 // D3D12 descriptors are equal sized and treated as effectively one byte in size
 const uint32_t D3D12_DESCRIPTOR_BYTESIZE = 1;
@@ -276,6 +278,8 @@ struct ThreadState
   void ProcessScopeChange(const rdcarray<bool> &oldLive, const rdcarray<bool> &newLive);
 
   void InitialiseHelper(const ThreadState &activeState);
+  void SaveCheckpoint(LaneCheckpoint &cp) const;
+  void RestoreCheckpoint(const LaneCheckpoint &cp);
   static bool ThreadsAreDiverged(const rdcarray<ThreadState> &workgroups);
 
   bool GetShaderVariableHelper(const DXIL::Value *dxilValue, DXIL::Operation op, DXIL::DXOp dxOpCode,
@@ -349,6 +353,40 @@ struct ThreadState
   bool m_Ended = true;
 };
 
+// The mutable state of a lane at a checkpoint. Stack allocations are saved by contents and
+// pointers by offset, since the backing memory may be reallocated when the checkpoint is restored
+struct LaneCheckpoint
+{
+  struct Pointer
+  {
+    Id baseMemoryId;
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  rdcarray<StackFrame *> callstack;
+  GlobalVariable output;
+  std::map<Id, ShaderVariable> variables;
+  std::map<Id, ShaderVariable> phiVariables;
+  rdcarray<bool> live;
+  rdcarray<bool> isGlobal;
+  rdcarray<bool> assigned;
+  std::map<Id, ThreadState::AnnotationProperties> annotatedProperties;
+  std::map<Id, ResourceReferenceInfo> directHeapAccessBindings;
+  std::map<Id, bytebuf> allocations;
+  std::map<Id, Pointer> pointers;
+  const FunctionInfo *functionInfo = NULL;
+  uint32_t functionInstructionIdx = ~0U;
+  const DXIL::Instruction *currentInstruction = NULL;
+  uint32_t block = ~0U;
+  uint32_t previousBlock = ~0U;
+  uint32_t activeGlobalInstructionIdx = ~0U;
+  rdcarray<BindingSlot> accessedSRVs;
+  rdcarray<BindingSlot> accessedUAVs;
+  bool killed = true;
+  bool ended = true;
+};
+
 struct GlobalState
 {
   typedef std::map<ShaderBuiltin, ShaderVariable> BuiltinInputs;
@@ -521,6 +559,7 @@ public:
   ShaderDebugTrace *BeginDebug(uint32_t eventId, const DXBC::DXBCContainer *dxbcContainer,
                                const ShaderReflection &reflection, uint32_t activeLaneIndex);
   rdcarray<ShaderDebugState> ContinueDebug(DebugAPIWrapper *apiWrapper);
+  ShaderDebugState SeekDebug(DebugAPIWrapper *apiWrapper, uint32_t stepIndex);
   GlobalState &GetGlobalState() { return m_GlobalState; }
   ThreadState &GetActiveLane() { return m_Workgroups[m_ActiveLaneIndex]; }
   ThreadState &GetWorkgroup(const uint32_t i) { return m_Workgroups[i]; }
@@ -547,6 +586,39 @@ private:
   void AddLocalVariable(const DXIL::SourceMappingInfo &srcMapping, uint32_t instructionIndex);
   void ParseDebugData();
 
+  struct UAVCheckpoint
+  {
+    CheckpointBytes *data = NULL;
+    uint32_t hiddenCounter = 0;
+  };
+
+  struct Checkpoint
+  {
+    Checkpoint() = default;
+    ~Checkpoint();
+
+    rdcarray<LaneCheckpoint> lanes;
+    std::map<Id, CheckpointBytes *> globalMemory;
+    std::map<BindingSlot, UAVCheckpoint> uavs;
+
+  private:
+    Checkpoint(const Checkpoint &) = delete;
+    Checkpoint &operator=(const Checkpoint &) = delete;
+  };
+
+  ShaderDebugState BeginStepping();
+  bool StepWorkgroup(DebugAPIWrapper *apiWrapper, rdcarray<bool> &activeMask,
+                     rdcarray<ShaderDebugState> &ret);
+  void SaveCheckpoint();
+  void RestoreCheckpoint(uint32_t step);
+
+  DebugCheckpoints<Checkpoint> m_Checkpoints;
+
+  // how many states ContinueDebug has returned, to carry on from there after seeking, and the first
+  // of them which can't be re-executed
+  uint32_t m_NumContinued = 0;
+  ShaderDebugState m_InitialState;
+
   rdcarray<ThreadState> m_Workgroups;
   std::map<const DXIL::Function *, FunctionInfo> m_FunctionInfos;
 
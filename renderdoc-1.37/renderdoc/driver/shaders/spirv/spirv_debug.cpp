@@ -161,15 +161,77 @@ static ShaderVariable MakeIdentity(const rdcspv::DataType &type, float val, bool
 
 namespace rdcspv
 {
-ThreadState::ThreadState(Debugger &debug, const GlobalState &globalState)
+void LaneRegisterFile::Init(uint32_t numIds, uint32_t numLanes)
+{
+  m_NumLanes = numLanes;
+  m_Registers.clear();
+  m_Registers.resize(numIds);
+
+  for(uint32_t i = 0; i < numIds; i++)
+    m_Registers[i].name = GetRawName(Id::fromWord(i));
+}
+
+void LaneRegisterFile::AllocateLanes(Id id)
+{
+  Register &reg = m_Registers[id.value()];
+  if(reg.lanes.empty())
+    reg.lanes.fill(m_NumLanes, reg.shared);
+}
+
+void LaneRegisterFile::SetShared(Id id, const ShaderVariable &val)
+{
+  Register &reg = m_Registers[id.value()];
+  reg.shared = val;
+  reg.shared.name = reg.name;
+}
+
+void LaneRegisterFile::Save(Snapshot &snapshot) const
+{
+  snapshot.clear();
+
+  for(size_t i = 0; i < m_Registers.size(); i++)
+  {
+    if(!m_Registers[i].lanes.empty())
+      snapshot.push_back({Id::fromWord((uint32_t)i), m_Registers[i].lanes});
+  }
+}
+
+void LaneRegisterFile::Restore(const Snapshot &snapshot)
+{
+  size_t s = 0;
+  for(size_t i = 0; i < m_Registers.size(); i++)
+  {
+    Register &reg = m_Registers[i];
+
+    if(s < snapshot.size() && snapshot[s].first.value() == i)
+    {
+      // assign element-wise so the lanes are never reallocated
+      const rdcarray<ShaderVariable> &lanes = snapshot[s].second;
+      reg.lanes.resize(lanes.size());
+      for(size_t l = 0; l < lanes.size(); l++)
+        reg.lanes[l] = lanes[l];
+      s++;
+    }
+    else if(!reg.lanes.empty())
+    {
+      // lanes allocated since the snapshot was taken still had the shared value at that point
+      for(ShaderVariable &lane : reg.lanes)
+        lane = reg.shared;
+    }
+  }
+}
+
+ThreadState::ThreadState(Debugger &debug, const GlobalState &globalState, uint32_t laneIndex)
     : debugger(debug), global(globalState)
 {
+  ids.file = &debug.GetRegisters();
+  ids.lane = laneIndex;
 }
 
 ThreadState::~ThreadState()
 {
   for(StackFrame *stack : callstack)
-    delete stack;
+    stack->Release();
   callstack.clear();
 }
 
@@ -178,6 +240,71 @@ bool ThreadState::Finished() const
   return dead || callstack.empty();
 }
 
+void ThreadState::SaveCheckpoint(LaneCheckpoint &checkpoint) const
+{
+  checkpoint.nextInstruction = nextInstruction;
+  checkpoint.outputs = outputs;
+  checkpoint.privates = privates;
+  checkpoint.pointersForId = pointersForId;
+  checkpoint.mergeBlock = mergeBlock;
+  checkpoint.returnValue = returnValue;
+  checkpoint.live = live;
+  checkpoint.helperInvocation = helperInvocation;
+  checkpoint.dead = dead;
+
+  checkpoint.callstack.resize(callstack.size());
+  for(size_t i = 0; i < callstack.size(); i++)
+  {
+    StackFrame *frame = callstack[i];
+    LaneCheckpoint::Frame &saved = checkpoint.callstack[i];
+
+    frame->AddRef();
+    saved.frame = frame;
+    saved.locals = frame->locals;
+    saved.idsCreated = frame->idsCreated;
+    saved.localsUsed = frame->localsUsed;
+    saved.live = frame->live;
+    saved.lastBlock = frame->lastBlock;
+    saved.curBlock = frame->curBlock;
+  }
+}
+
+void ThreadState::RestoreCheckpoint(const LaneCheckpoint &checkpoint)
+{
+  // the checkpoint holds its own references so any frames it shares with the callstack survive
+  for(StackFrame *frame : callstack)
+    frame->Release();
+  callstack.clear();
+
+  for(const LaneCheckpoint::Frame &saved : checkpoint.callstack)
+  {
+    StackFrame *frame = saved.frame;
+
+    frame->AddRef();
+    for(size_t i = 0; i < saved.locals.size(); i++)
+      AssignValue(frame->locals[i], saved.locals[i]);
+    frame->idsCreated = saved.idsCreated;
+    frame->localsUsed = saved.localsUsed;
+    frame->live = saved.live;
+    frame->lastBlock = saved.lastBlock;
+    frame->curBlock = saved.curBlock;
+
+    callstack.push_back(frame);
+  }
+
+  nextInstruction = checkpoint.nextInstruction;
+  for(size_t i = 0; i < checkpoint.outputs.size(); i++)
+    AssignValue(outputs[i], checkpoint.outputs[i]);
+  for(size_t i = 0; i < checkpoint.privates.size(); i++)
+    AssignValue(privates[i], checkpoint.privates[i]);
+  pointersForId = checkpoint.pointersForId;
+  mergeBlock = checkpoint.mergeBlock;
+  returnValue = checkpoint.returnValue;
+  live = checkpoint.live;
+  helperInvocation = checkpoint.helperInvocation;
+  dead = checkpoint.dead;
+}
+
 void ThreadState::FillCallstack(rdcarray<Id> &funcs)
 {
   for(const StackFrame *frame : callstack)
@@ -322,11 +449,11 @@ void ThreadState::WritePointerValue(Id pointer, const ShaderVariable &val)
 
   if(!m_State)
   {
-    debugger.WriteThroughPointer(ids[pointer], val);
+    debugger.WriteThroughPointer(ids.Mutable(pointer), val);
   }
   else
   {
-    ShaderVariable &var = ids[pointer];
+    ShaderVariable &var = ids.Mutable(pointer);
 
     if(ContainsNaNInf(val))
       m_State->flags |= ShaderEvents::GeneratedNanOrInf;
@@ -404,9 +531,6 @@ void ThreadState::WritePointerValue(Id pointer, const ShaderVariable &val)
       pointers.push_back(pointer);
     if(!pointers.contains(ptrid) && ptrid != Id())
       pointers.push_back(ptrid);
-
-    for(size_t i = 0; i < pointers.size(); i++)
-      lastWrite[pointers[i]] = m_State ? m_State->stepIndex : nextInstruction;
   }
 }
 
@@ -420,17 +544,20 @@ void ThreadState::SetDst(Id id, const ShaderVariable &val)
   if(m_State && ContainsNaNInf(val))
     m_State->flags |= ShaderEvents::GeneratedNanOrInf;
 
-  ShaderVariable prev = ids[id];
+  ShaderVariable &dst = ids.Mutable(id);
 
   // if this id didn't exist before it's not a global so it's a local variable, function parameter,
   // or plain id. Track it in the current frame so it's emptied upon return
-  if(prev.name.empty() && prev.type == VarType::Unknown)
+  if(dst.name.empty() && dst.type == VarType::Unknown)
     callstack.back()->idsCreated.push_back(id);
 
-  ids[id] = val;
-  ids[id].name = GetRawName(id);
+  // only the active lane records changes, so only it needs the previous value
+  ShaderVariable prev;
+  if(m_State)
+    prev = dst;
 
-  lastWrite[id] = m_State ? m_State->stepIndex : nextInstruction;
+  dst = val;
+  dst.name = ids.file->GetName(id);
 
   auto it = std::lower_bound(live.begin(), live.end(), id);
   live.insert(it - live.begin(), id);
@@ -449,7 +576,7 @@ void ThreadState::SetDst(Id id, const ShaderVariable &val)
   {
     ShaderVariableChange change;
     change.before = debugger.GetPointerValue(prev);
-    change.after = debugger.GetPointerValue(ids[id]);
+    change.after = debugger.GetPointerValue(dst);
     m_State->changes.push_back(change);
   }
 }
@@ -621,17 +748,15 @@ void ThreadState::JumpToLabel(Id target)
   nextInstruction = debugger.GetInstructionForLabel(target) + 1;
 
   // if jumping to an empty unconditional loop header, continue to the loop block
-  Iter it = debugger.GetIterForInstruction(nextInstruction);
-  if(it.opcode() == Op::LoopMerge)
+  const DecodedInstruction &inst = debugger.GetDecodedInstruction(nextInstruction);
+  if(inst.op == Op::LoopMerge)
   {
-    OpLoopMerge merge(it);
+    mergeBlock = inst.target;
 
-    mergeBlock = merge.mergeBlock;
-
-    it++;
-    if(it.opcode() == Op::Branch)
+    const DecodedInstruction &next = debugger.GetDecodedInstruction(nextInstruction + 1);
+    if(next.op == Op::Branch)
     {
-      JumpToLabel(OpBranch(it).targetLabel);
+      JumpToLabel(next.target);
     }
   }
 
@@ -646,7 +771,7 @@ bool ThreadState::ReferencePointer(Id id)
   {
     StackFrame *frame = callstack.back();
 
-    rdcstr name = GetRawName(id);
+    const rdcstr &name = ids.file->GetName(id);
 
     // see if this is a local variable which is newly referenced, if so add source vars for it
     for(size_t i = 0; i < frame->locals.size(); i++)
@@ -674,47 +799,14 @@ void ThreadState::SkipIgnoredInstructions()
   // in pixel shaders, but otherwise skip them.
   while(true)
   {
-    Iter it = debugger.GetIterForInstruction(nextInstruction);
-    rdcspv::Op op = it.opcode();
-    if(op == Op::Line || op == Op::NoLine || op == Op::Undef)
-    {
-      nextInstruction++;
-      continue;
-    }
-
-    if(op == Op::ExtInst || op == Op::ExtInstWithForwardRefsKHR)
-    {
-      if(debugger.IsDebugExtInstSet(Id::fromWord(it.word(3))))
-      {
-        if(ShaderDbg(it.word(4)) != ShaderDbg::Value || !debugger.InDebugScope(nextInstruction))
-        {
-          nextInstruction++;
-          continue;
-        }
-      }
-    }
-
-    if(op == Op::SelectionMerge)
-    {
-      OpSelectionMerge merge(it);
-
-      mergeBlock = merge.mergeBlock;
-
-      nextInstruction++;
-      continue;
-    }
-
-    if(op == Op::LoopMerge)
-    {
-      OpLoopMerge merge(it);
-
-      mergeBlock = merge.mergeBlock;
+    const DecodedInstruction &inst = debugger.GetDecodedInstruction(nextInstruction);
+    if(!inst.skip)
+      break;
 
-      nextInstruction++;
-      continue;
-    }
+    if(inst.op == Op::SelectionMerge || inst.op == Op::LoopMerge)
+      mergeBlock = inst.target;
 
-    break;
+    nextInstruction++;
   }
 }
 
@@ -732,15 +824,17 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 {
   m_State = state;
 
+  if(!executions.empty())
+    executions[nextInstruction]++;
+
+  const DecodedInstruction &inst = debugger.GetDecodedInstruction(nextInstruction);
   Iter it = debugger.GetIterForInstruction(nextInstruction);
   nextInstruction++;
 
-  OpDecoder opdata(it);
-
   // don't skip any instructions here. These should be skipped *after* processing, so that
   // nextInstruction always points to the next real instruction.
 
-  switch(opdata.op)
+  switch(inst.op)
   {
     //////////////////////////////////////////////////////////////////////////////
     //
@@ -785,38 +879,37 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::AccessChain:
     case Op::InBoundsAccessChain:
     {
-      OpAccessChain chain(it);
-
-      rdcarray<uint32_t> indices;
+      rdcarray<uint32_t> &indices = m_IndexScratch;
 
       // evaluate the indices
-      indices.reserve(chain.indexes.size());
-      for(Id id : chain.indexes)
-        indices.push_back(uintComp(GetSrc(id), 0));
+      const Id *indexIds = debugger.GetDecodedOperands(inst);
+      indices.clear();
+      for(uint32_t i = 0; i < inst.numOperands; i++)
+        indices.push_back(uintComp(GetSrc(indexIds[i]), 0));
 
-      SetDst(chain.result, debugger.MakeCompositePointer(
-                               ids[chain.base], debugger.GetPointerBaseId(ids[chain.base]), indices));
+      SetDst(inst.result, debugger.MakeCompositePointer(
+                              ids[inst.base], debugger.GetPointerBaseId(ids[inst.base]), indices));
       break;
     }
     case Op::PtrAccessChain:
     case Op::InBoundsPtrAccessChain:
     {
-      OpPtrAccessChain chain(it);
+      rdcarray<uint32_t> &indices = m_IndexScratch;
 
-      rdcarray<uint32_t> indices;
       // evaluate the indices
-      indices.reserve(chain.indexes.size());
-      for(Id id : chain.indexes)
-        indices.push_back(uintComp(GetSrc(id), 0));
+      const Id *indexIds = debugger.GetDecodedOperands(inst);
+      indices.clear();
+      for(uint32_t i = 0; i < inst.numOperands; i++)
+        indices.push_back(uintComp(GetSrc(indexIds[i]), 0));
 
-      ShaderVariable base = ids[chain.base];
+      ShaderVariable base = ids[inst.base];
       PointerVal val = base.GetPointer();
-      int32_t element = intComp(GetSrc(chain.element), 0);
+      int32_t element = intComp(GetSrc(inst.element), 0);
       // adjust the address by the element. We should have the array stride since the base pointer
       // must point into an array and we can't go outside it.
       base.SetTypedPointer(val.pointer + element * debugger.GetPointerArrayStride(base), val.shader,
                            val.pointerTypeID);
-      SetDst(chain.result,
+      SetDst(inst.result,
              debugger.MakeCompositePointer(base, debugger.GetPointerBaseId(base), indices));
       break;
     }
@@ -873,7 +966,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       var.rows = var.columns = 1;
       var.type = VarType::Bool;
 
-      if(opdata.op == Op::PtrEqual)
+      if(inst.op == Op::PtrEqual)
         setUintComp(var, 0, isEqual ? 1 : 0);
       else
         setUintComp(var, 0, isEqual ? 0 : 1);
@@ -920,11 +1013,11 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       OpDPdx deriv(it);
 
       DerivDir dir = DDX;
-      if(opdata.op == Op::DPdy || opdata.op == Op::DPdyCoarse || opdata.op == Op::DPdyFine)
+      if(inst.op == Op::DPdy || inst.op == Op::DPdyCoarse || inst.op == Op::DPdyFine)
         dir = DDY;
 
       DerivType type = Coarse;
-      if(opdata.op == Op::DPdxFine || opdata.op == Op::DPdyFine)
+      if(inst.op == Op::DPdxFine || inst.op == Op::DPdyFine)
         type = Fine;
 
       SetDst(deriv.result, CalcDeriv(dir, type, workgroup, deriv.p));
@@ -939,7 +1032,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       OpFwidth deriv(it);
 
       DerivType type = Coarse;
-      if(opdata.op == Op::FwidthFine)
+      if(inst.op == Op::FwidthFine)
         type = Fine;
 
       ShaderVariable var = CalcDeriv(DDX, type, workgroup, deriv.p);
@@ -1230,7 +1323,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable conv = var;
       conv.type = resultType.scalar().Type();
 
-      if(opdata.op == Op::ConvertFToS)
+      if(inst.op == Op::ConvertFToS)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1245,7 +1338,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, conv.type);
         }
       }
-      else if(opdata.op == Op::ConvertFToU)
+      else if(inst.op == Op::ConvertFToU)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1260,7 +1353,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, conv.type);
         }
       }
-      else if(opdata.op == Op::ConvertSToF)
+      else if(inst.op == Op::ConvertSToF)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1278,7 +1371,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
             comp<double>(conv, c) = (double)x;
         }
       }
-      else if(opdata.op == Op::ConvertUToF)
+      else if(inst.op == Op::ConvertUToF)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1545,7 +1638,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable b = GetSrc(compare.operand2);
       ShaderVariable var = a;
 
-      if(opdata.op == Op::IEqual || opdata.op == Op::LogicalEqual)
+      if(inst.op == Op::IEqual || inst.op == Op::LogicalEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1555,7 +1648,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::INotEqual || opdata.op == Op::LogicalNotEqual)
+      else if(inst.op == Op::INotEqual || inst.op == Op::LogicalNotEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1565,7 +1658,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::LogicalAnd)
+      else if(inst.op == Op::LogicalAnd)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1575,7 +1668,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::LogicalOr)
+      else if(inst.op == Op::LogicalOr)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1585,7 +1678,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::UGreaterThan)
+      else if(inst.op == Op::UGreaterThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1595,7 +1688,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::UGreaterThanEqual)
+      else if(inst.op == Op::UGreaterThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1605,7 +1698,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::ULessThan)
+      else if(inst.op == Op::ULessThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1615,7 +1708,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::ULessThanEqual)
+      else if(inst.op == Op::ULessThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1625,7 +1718,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::SGreaterThan)
+      else if(inst.op == Op::SGreaterThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1635,7 +1728,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::SGreaterThanEqual)
+      else if(inst.op == Op::SGreaterThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1645,7 +1738,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::SLessThan)
+      else if(inst.op == Op::SLessThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1655,7 +1748,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::SLessThanEqual)
+      else if(inst.op == Op::SLessThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1679,7 +1772,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       // always return true. So we negate and invert the actual comparison so that the comparison
       // will be unchanged effectively.
 
-      if(opdata.op == Op::FOrdEqual)
+      if(inst.op == Op::FOrdEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1689,7 +1782,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FOrdNotEqual)
+      else if(inst.op == Op::FOrdNotEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1699,7 +1792,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FOrdGreaterThan)
+      else if(inst.op == Op::FOrdGreaterThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1709,7 +1802,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FOrdGreaterThanEqual)
+      else if(inst.op == Op::FOrdGreaterThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1719,7 +1812,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FOrdLessThan)
+      else if(inst.op == Op::FOrdLessThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1729,7 +1822,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FOrdLessThanEqual)
+      else if(inst.op == Op::FOrdLessThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1740,7 +1833,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         }
       }
 
-      if(opdata.op == Op::FUnordEqual)
+      if(inst.op == Op::FUnordEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1750,7 +1843,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FUnordNotEqual)
+      else if(inst.op == Op::FUnordNotEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1760,7 +1853,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FUnordGreaterThan)
+      else if(inst.op == Op::FUnordGreaterThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1770,7 +1863,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FUnordGreaterThanEqual)
+      else if(inst.op == Op::FUnordGreaterThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1780,7 +1873,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FUnordLessThan)
+      else if(inst.op == Op::FUnordLessThan)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1790,7 +1883,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FUnordLessThanEqual)
+      else if(inst.op == Op::FUnordLessThanEqual)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -1829,7 +1922,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       for(uint8_t c = 1; c < var.columns; c++)
       {
-        if(opdata.op == Op::Any)
+        if(inst.op == Op::Any)
           setUintComp(var, 0, uintComp(var, 0) | uintComp(var, c));
         else
           setUintComp(var, 0, uintComp(var, 0) & uintComp(var, c));
@@ -1949,7 +2042,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
   comp<U>(var, c) >>= comp<U>(offset, c);            \
   comp<U>(var, c) &= mask;                           \
                                                      \
-  if(opdata.op == Op::BitFieldSExtract)              \
+  if(inst.op == Op::BitFieldSExtract)              \
   {                                                  \
     U topbit = (mask + U(1)) >> U(1);                \
     if(comp<U>(var, c) & topbit)                     \
@@ -1998,7 +2091,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable var = GetSrc(bitwise.operand1);
       ShaderVariable b = GetSrc(bitwise.operand2);
 
-      if(opdata.op == Op::BitwiseOr)
+      if(inst.op == Op::BitwiseOr)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2008,7 +2101,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::BitwiseAnd)
+      else if(inst.op == Op::BitwiseAnd)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2018,7 +2111,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::BitwiseXor)
+      else if(inst.op == Op::BitwiseXor)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2028,7 +2121,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::ShiftLeftLogical)
+      else if(inst.op == Op::ShiftLeftLogical)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2038,7 +2131,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::ShiftRightArithmetic)
+      else if(inst.op == Op::ShiftRightArithmetic)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2048,7 +2141,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::ShiftRightLogical)
+      else if(inst.op == Op::ShiftRightLogical)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2106,7 +2199,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable var = GetSrc(math.operand1);
       ShaderVariable b = GetSrc(math.operand2);
 
-      if(opdata.op == Op::FMul)
+      if(inst.op == Op::FMul)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2116,7 +2209,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FDiv)
+      else if(inst.op == Op::FDiv)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2126,7 +2219,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FMod)
+      else if(inst.op == Op::FMod)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2142,7 +2235,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FRem)
+      else if(inst.op == Op::FRem)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2158,7 +2251,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FAdd)
+      else if(inst.op == Op::FAdd)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2168,7 +2261,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::FSub)
+      else if(inst.op == Op::FSub)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2178,7 +2271,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::IMul)
+      else if(inst.op == Op::IMul)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2188,7 +2281,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::SDiv)
+      else if(inst.op == Op::SDiv)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2208,7 +2301,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::UDiv)
+      else if(inst.op == Op::UDiv)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2228,7 +2321,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::UMod)
+      else if(inst.op == Op::UMod)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2248,7 +2341,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::SRem || opdata.op == Op::SMod)
+      else if(inst.op == Op::SRem || inst.op == Op::SMod)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2268,7 +2361,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::IAdd)
+      else if(inst.op == Op::IAdd)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2278,7 +2371,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::ISub)
+      else if(inst.op == Op::ISub)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2309,7 +2402,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       uint32_t elemSize = VarTypeByteSize(a.type);
       uint32_t elemBits = elemSize * 8;
 
-      if(opdata.op == Op::UMulExtended)
+      if(inst.op == Op::UMulExtended)
       {
         // if this is less than 64-bit precision inputs, we can just upcast, do the mul, and then
         // mask off the bits we care about
@@ -2331,7 +2424,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           RDCERR("Unsupported UMulExtended on 64-bit operands");
         }
       }
-      else if(opdata.op == Op::SMulExtended)
+      else if(inst.op == Op::SMulExtended)
       {
         if(elemSize < 8)
         {
@@ -2351,7 +2444,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           RDCERR("Unsupported SMulExtended on 64-bit operands");
         }
       }
-      else if(opdata.op == Op::IAddCarry)
+      else if(inst.op == Op::IAddCarry)
       {
         for(uint8_t c = 0; c < a.columns; c++)
         {
@@ -2365,7 +2458,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, a.type);
         }
       }
-      else if(opdata.op == Op::ISubBorrow)
+      else if(inst.op == Op::ISubBorrow)
       {
         for(uint8_t c = 0; c < a.columns; c++)
         {
@@ -2406,7 +2499,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       ShaderVariable var = GetSrc(math.operand);
 
-      if(opdata.op == Op::FNegate)
+      if(inst.op == Op::FNegate)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2416,7 +2509,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           IMPL_FOR_FLOAT_TYPES(_IMPL);
         }
       }
-      else if(opdata.op == Op::SNegate)
+      else if(inst.op == Op::SNegate)
       {
         for(uint8_t c = 0; c < var.columns; c++)
         {
@@ -2656,7 +2749,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       for(uint32_t idx = 0; idx < activeLanes.size(); idx++)
       {
         uint32_t lane = activeLanes[idx];
-        if(opdata.op == Op::GroupNonUniformBallotFindMSB)
+        if(inst.op == Op::GroupNonUniformBallotFindMSB)
           activeLanes[activeLanes.size() - 1 - idx];
 
         uint32_t c = lane / 32;
@@ -2679,7 +2772,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
 
       // fix up result type
-      const DataType &resultType = debugger.GetType(opdata.resultType);
+      const DataType &resultType = debugger.GetType(inst.resultType);
 
       var.type = resultType.scalar().Type();
       var.rows = 1;
@@ -2734,7 +2827,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::SubgroupFirstInvocationKHR:
     {
       Id value;
-      if(opdata.op == Op::GroupNonUniformBroadcastFirst)
+      if(inst.op == Op::GroupNonUniformBroadcastFirst)
       {
         OpGroupNonUniformBroadcastFirst group(it);
         value = group.value;
@@ -2742,7 +2835,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        RDCASSERT(opdata.op == Op::SubgroupFirstInvocationKHR);
+        RDCASSERT(inst.op == Op::SubgroupFirstInvocationKHR);
         OpSubgroupFirstInvocationKHR group(it);
         value = group.value;
       }
@@ -2763,7 +2856,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       RDCASSERT(firstActiveLane < debugger.GetSubgroupSize(), firstActiveLane,
                 debugger.GetSubgroupSize());
 
-      SetDst(opdata.result, workgroup[firstActiveLane].GetSrc(value));
+      SetDst(inst.result, workgroup[firstActiveLane].GetSrc(value));
       break;
     }
     // "read from a specific lane"
@@ -2782,14 +2875,14 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       const uint32_t firstLaneInSub = workgroupIndex - subgroupId;
 
-      if(opdata.op == Op::GroupNonUniformBroadcast)
+      if(inst.op == Op::GroupNonUniformBroadcast)
       {
         OpGroupNonUniformBroadcast group(it);
         RDCASSERT(uintComp(GetSrc(group.execution), 0) == (uint32_t)Scope::Subgroup);
         value = group.value;
         lane = firstLaneInSub + uintComp(GetSrc(group.id), 0);
       }
-      else if(opdata.op == Op::GroupNonUniformQuadBroadcast)
+      else if(inst.op == Op::GroupNonUniformQuadBroadcast)
       {
         OpGroupNonUniformQuadBroadcast group(it);
         RDCASSERT(uintComp(GetSrc(group.execution), 0) == (uint32_t)Scope::Subgroup);
@@ -2805,7 +2898,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           lane = workgroupIndex;
         }
       }
-      else if(opdata.op == Op::GroupNonUniformQuadSwap)
+      else if(inst.op == Op::GroupNonUniformQuadSwap)
       {
         OpGroupNonUniformQuadSwap group(it);
         RDCASSERT(uintComp(GetSrc(group.execution), 0) == (uint32_t)Scope::Subgroup);
@@ -2846,35 +2939,35 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           }
         }
       }
-      else if(opdata.op == Op::GroupNonUniformShuffle)
+      else if(inst.op == Op::GroupNonUniformShuffle)
       {
         OpGroupNonUniformShuffle group(it);
         RDCASSERT(uintComp(GetSrc(group.execution), 0) == (uint32_t)Scope::Subgroup);
         value = group.value;
         lane = firstLaneInSub + uintComp(GetSrc(group.id), 0);
       }
-      else if(opdata.op == Op::GroupNonUniformShuffleXor ||
-              opdata.op == Op::GroupNonUniformShuffleUp ||
-              opdata.op == Op::GroupNonUniformShuffleDown)
+      else if(inst.op == Op::GroupNonUniformShuffleXor ||
+              inst.op == Op::GroupNonUniformShuffleUp ||
+              inst.op == Op::GroupNonUniformShuffleDown)
       {
         OpGroupNonUniformShuffleUp group(it);
         RDCASSERT(uintComp(GetSrc(group.execution), 0) == (uint32_t)Scope::Subgroup);
         value = group.value;
         uint32_t delta = uintComp(GetSrc(group.delta), 0);
 
-        if(opdata.op == Op::GroupNonUniformShuffleXor)
+        if(inst.op == Op::GroupNonUniformShuffleXor)
         {
           lane = subgroupId ^ delta;
           RDCASSERT(lane < debugger.GetSubgroupSize(), lane, debugger.GetSubgroupSize());
           lane = firstLaneInSub + RDCMIN(lane, debugger.GetSubgroupSize() - 1);
         }
-        else if(opdata.op == Op::GroupNonUniformShuffleUp)
+        else if(inst.op == Op::GroupNonUniformShuffleUp)
         {
           lane = subgroupId;
           RDCASSERT(lane >= delta, delta, lane);
           lane = firstLaneInSub + RDCMAX(delta, lane) - delta;
         }
-        else if(opdata.op == Op::GroupNonUniformShuffleDown)
+        else if(inst.op == Op::GroupNonUniformShuffleDown)
         {
           lane = subgroupId;
           RDCASSERT(lane + delta < debugger.GetSubgroupSize(), lane, delta,
@@ -2887,7 +2980,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           lane = 0;
         }
       }
-      else if(opdata.op == Op::GroupNonUniformRotateKHR)
+      else if(inst.op == Op::GroupNonUniformRotateKHR)
       {
         OpGroupNonUniformRotateKHR group(it);
         value = group.value;
@@ -2927,13 +3020,13 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        RDCASSERT(opdata.op == Op::SubgroupReadInvocationKHR);
+        RDCASSERT(inst.op == Op::SubgroupReadInvocationKHR);
         OpSubgroupReadInvocationKHR group(it);
         value = group.value;
         lane = firstLaneInSub + uintComp(GetSrc(group.index), 0);
       }
 
-      SetDst(opdata.result, workgroup[lane].GetSrc(value));
+      SetDst(inst.result, workgroup[lane].GetSrc(value));
       break;
     }
     case Op::GroupNonUniformQuadAllKHR:
@@ -2946,7 +3039,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       var.columns = 1;
 
       bool result = false;
-      if(opdata.op == Op::GroupNonUniformQuadAllKHR)
+      if(inst.op == Op::GroupNonUniformQuadAllKHR)
         result = true;
       for(uint32_t i = 0; i < 4; i++)
       {
@@ -2957,9 +3050,9 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           break;
         }
 
-        if(opdata.op == Op::GroupNonUniformQuadAllKHR)
+        if(inst.op == Op::GroupNonUniformQuadAllKHR)
           result = result && workgroup[quadNeighbours[i]].GetSrc(quad.predicate).value.u32v[0];
-        else if(opdata.op == Op::GroupNonUniformQuadAnyKHR)
+        else if(inst.op == Op::GroupNonUniformQuadAnyKHR)
           result = result || workgroup[quadNeighbours[i]].GetSrc(quad.predicate).value.u32v[0];
         else
           RDCERR("Unexpected op");
@@ -3005,7 +3098,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       Id valueId;
 
-      switch(opdata.op)
+      switch(inst.op)
       {
         // arithmetic
         case Op::GroupNonUniformIAdd:
@@ -3074,14 +3167,14 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         }
         default:
         {
-          RDCERR("Unexpected opcode %s", ToStr(opdata.op).c_str());
+          RDCERR("Unexpected opcode %s", ToStr(inst.op).c_str());
           break;
         }
       }
 
       // get starting var and define operation
       bool identityPlusFunction = true;
-      switch(opdata.op)
+      switch(inst.op)
       {
         case Op::GroupNonUniformIAdd:
         case Op::GroupNonUniformUMax:
@@ -3089,47 +3182,47 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         case Op::GroupNonUniformLogicalOr:
         case Op::GroupNonUniformBitwiseXor:
         case Op::GroupNonUniformLogicalXor:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), (uint64_t)0);
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), (uint64_t)0);
           break;
         case Op::GroupNonUniformFAdd:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), 0.0f, false, false);
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), 0.0f, false, false);
           break;
         case Op::GroupNonUniformIMul:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), (uint64_t)1);
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), (uint64_t)1);
           break;
         case Op::GroupNonUniformFMul:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), 1.0f, false, false);
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), 1.0f, false, false);
           break;
         case Op::GroupNonUniformSMin:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), int64_t(INT64_MAX));
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), int64_t(INT64_MAX));
           break;
         case Op::GroupNonUniformUMin:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), UINT64_MAX);
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), UINT64_MAX);
           break;
         case Op::GroupNonUniformSMax:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), int64_t(INT64_MIN));
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), int64_t(INT64_MIN));
           break;
         case Op::GroupNonUniformFMin:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), 0.0f, true, true);
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), 0.0f, true, true);
           break;
         case Op::GroupNonUniformFMax:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), 0.0f, true, false);
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), 0.0f, true, false);
           break;
         case Op::GroupNonUniformBitwiseAnd:
         case Op::GroupNonUniformLogicalAnd:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), uint64_t(~0ULL));
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), uint64_t(~0ULL));
           break;
 
           // simplified versions that we 'promote' to be plain versions of the above more complicated transforms
         case Op::GroupNonUniformAny:
         case Op::SubgroupAnyKHR:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), (uint64_t)0U);
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), (uint64_t)0U);
           break;
         case Op::GroupNonUniformAll:
         case Op::SubgroupAllKHR:
         case Op::GroupNonUniformAllEqual:
         case Op::SubgroupAllEqualKHR:
-          var = MakeIdentity(debugger.GetDataType(opdata.resultType), (uint64_t)1);
+          var = MakeIdentity(debugger.GetDataType(inst.resultType), (uint64_t)1);
           break;
 
         default: identityPlusFunction = false; break;
@@ -3166,13 +3259,13 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           // stop before processing our lane if we're exclusive scan
           if(groupOp == GroupOperation::ExclusiveScan && lane == workgroupIndex)
           {
-            SetDst(opdata.result, var);
+            SetDst(inst.result, var);
             break;
           }
 
           ShaderVariable x = workgroup[lane].GetSrc(valueId);
 
-          switch(opdata.op)
+          switch(inst.op)
           {
             case Op::GroupNonUniformIAdd:
               for(uint8_t c = 0; c < var.columns; c++)
@@ -3311,7 +3404,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           // stop after processing our lane if we're inclusive scane
           if(groupOp == GroupOperation::InclusiveScan && lane == workgroupIndex)
           {
-            SetDst(opdata.result, var);
+            SetDst(inst.result, var);
             break;
           }
         }
@@ -3319,12 +3412,12 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         // for reduce operations, set the final result now
         if(groupOp != GroupOperation::InclusiveScan && groupOp != GroupOperation::ExclusiveScan)
         {
-          SetDst(opdata.result, var);
+          SetDst(inst.result, var);
           break;
         }
       }
       // special case of different operation that can use group operations so needs scan/reduce handling
-      else if(opdata.op == Op::GroupNonUniformBallotBitCount)
+      else if(inst.op == Op::GroupNonUniformBallotBitCount)
       {
         ShaderVariable mask = GetSrc(valueId);
         uint32_t count = 0;
@@ -3345,7 +3438,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
             break;
         }
 
-        const DataType &resultType = debugger.GetType(opdata.resultType);
+        const DataType &resultType = debugger.GetType(inst.resultType);
 
         var.type = resultType.scalar().Type();
         var.rows = var.columns = 1;
@@ -3354,9 +3447,9 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 #define _IMPL(I, S, U) comp<U>(var, 0) = U(count);
         IMPL_FOR_INT_TYPES(_IMPL);
 
-        SetDst(opdata.result, var);
+        SetDst(inst.result, var);
       }
-      else if(opdata.op == Op::GroupNonUniformBallot || opdata.op == Op::SubgroupBallotKHR)
+      else if(inst.op == Op::GroupNonUniformBallot || inst.op == Op::SubgroupBallotKHR)
       {
         var = ShaderVariable(rdcstr(), 0U, 0U, 0U, 0U);
 
@@ -3371,21 +3464,21 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
             var.value.u32v[c] |= bit;
         }
 
-        SetDst(opdata.result, var);
+        SetDst(inst.result, var);
       }
-      else if(opdata.op == Op::GroupNonUniformElect)
+      else if(inst.op == Op::GroupNonUniformElect)
       {
         // unclear if this will match GPUs in the presence of helper invocations
         var = ShaderVariable(rdcstr(), workgroupIndex == activeLanes[0] ? 1U : 0U, 0U, 0U, 0U);
         var.type = VarType::Bool;
         var.columns = 1;
 
-        SetDst(opdata.result, var);
+        SetDst(inst.result, var);
       }
       else
       {
         RDCERR("Unexpected operation case");
-        SetDst(opdata.result, var);
+        SetDst(inst.result, var);
       }
 
       break;
@@ -3411,7 +3504,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       result.members[0].name = "image";
       result.members[1].name = "sampler";
 
-      SetDst(opdata.result, result);
+      SetDst(inst.result, result);
       break;
     }
     case Op::Image:
@@ -3456,7 +3549,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       Id derivId;
 
-      if(opdata.op == Op::ImageFetch)
+      if(inst.op == Op::ImageFetch)
       {
         OpImageFetch image(it);
 
@@ -3464,7 +3557,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         uv = GetSrc(image.coordinate);
         operands = image.imageOperands;
       }
-      else if(opdata.op == Op::ImageGather)
+      else if(inst.op == Op::ImageGather)
       {
         OpImageGather image(it);
 
@@ -3473,7 +3566,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         gather = GatherChannel(uintComp(GetSrc(image.component), 0));
         operands = image.imageOperands;
       }
-      else if(opdata.op == Op::ImageDrefGather)
+      else if(inst.op == Op::ImageDrefGather)
       {
         OpImageDrefGather image(it);
 
@@ -3483,7 +3576,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         gather = GatherChannel::Red;
         compare = GetSrc(image.dref);
       }
-      else if(opdata.op == Op::ImageQueryLod)
+      else if(inst.op == Op::ImageQueryLod)
       {
         OpImageQueryLod image(it);
 
@@ -3492,7 +3585,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
         derivId = image.coordinate;
       }
-      else if(opdata.op == Op::ImageSampleExplicitLod)
+      else if(inst.op == Op::ImageSampleExplicitLod)
       {
         OpImageSampleExplicitLod image(it);
 
@@ -3500,7 +3593,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         uv = GetSrc(image.coordinate);
         operands = image.imageOperands;
       }
-      else if(opdata.op == Op::ImageSampleImplicitLod)
+      else if(inst.op == Op::ImageSampleImplicitLod)
       {
         OpImageSampleImplicitLod image(it);
 
@@ -3510,7 +3603,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
         derivId = image.coordinate;
       }
-      else if(opdata.op == Op::ImageSampleDrefExplicitLod)
+      else if(inst.op == Op::ImageSampleDrefExplicitLod)
       {
         OpImageSampleDrefExplicitLod image(it);
 
@@ -3519,7 +3612,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         operands = image.imageOperands;
         compare = GetSrc(image.dref);
       }
-      else if(opdata.op == Op::ImageSampleDrefImplicitLod)
+      else if(inst.op == Op::ImageSampleDrefImplicitLod)
       {
         OpImageSampleDrefImplicitLod image(it);
 
@@ -3530,7 +3623,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
         derivId = image.coordinate;
       }
-      else if(opdata.op == Op::ImageSampleProjExplicitLod)
+      else if(inst.op == Op::ImageSampleProjExplicitLod)
       {
         OpImageSampleProjExplicitLod image(it);
 
@@ -3538,7 +3631,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         uv = GetSrc(image.coordinate);
         operands = image.imageOperands;
       }
-      else if(opdata.op == Op::ImageSampleProjImplicitLod)
+      else if(inst.op == Op::ImageSampleProjImplicitLod)
       {
         OpImageSampleProjImplicitLod image(it);
 
@@ -3548,7 +3641,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
         derivId = image.coordinate;
       }
-      else if(opdata.op == Op::ImageSampleProjDrefExplicitLod)
+      else if(inst.op == Op::ImageSampleProjDrefExplicitLod)
       {
         OpImageSampleProjDrefExplicitLod image(it);
 
@@ -3557,7 +3650,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         operands = image.imageOperands;
         compare = GetSrc(image.dref);
       }
-      else if(opdata.op == Op::ImageSampleProjDrefImplicitLod)
+      else if(inst.op == Op::ImageSampleProjDrefImplicitLod)
       {
         OpImageSampleProjDrefImplicitLod image(it);
 
@@ -3568,15 +3661,15 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
         derivId = image.coordinate;
       }
-      else if(opdata.op == Op::ImageQueryLevels || opdata.op == Op::ImageQuerySamples ||
-              opdata.op == Op::ImageQuerySize)
+      else if(inst.op == Op::ImageQueryLevels || inst.op == Op::ImageQuerySamples ||
+              inst.op == Op::ImageQuerySize)
       {
         // these opcodes are all identical, they just query a property of the image
         OpImageQueryLevels query(it);
 
         img = GetSrc(query.image);
       }
-      else if(opdata.op == Op::ImageQuerySizeLod)
+      else if(inst.op == Op::ImageQuerySizeLod)
       {
         OpImageQuerySizeLod query(it);
 
@@ -3598,7 +3691,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         sampler = sampler.members[1];
       }
 
-      const DataType &resultType = debugger.GetType(opdata.resultType);
+      const DataType &resultType = debugger.GetType(inst.resultType);
 
       RDCASSERT(img.type == VarType::ReadOnlyResource || img.type == VarType::ReadWriteResource);
       RDCASSERT(sampler.type == VarType::Unknown || sampler.type == VarType::ReadOnlyResource ||
@@ -3619,7 +3712,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         samplerIndex = sampler.GetBindIndex();
 
       if(!debugger.GetAPIWrapper()->CalculateSampleGather(
-             *this, opdata.op, texType, img.GetBindIndex(), samplerIndex, uv, ddxCalc, ddyCalc,
+             *this, inst.op, texType, img.GetBindIndex(), samplerIndex, uv, ddxCalc, ddyCalc,
              compare, gather, operands, result))
       {
         // sample failed. Pretend we got 0 columns back
@@ -3629,7 +3722,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       result.rows = 1;
       result.columns = RDCMAX(1U, resultType.vector().count) & 0xff;
 
-      SetDst(opdata.result, result);
+      SetDst(inst.result, result);
       break;
     }
     case Op::ImageRead:
@@ -3639,7 +3732,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable img = GetSrc(read.image);
       ShaderVariable coord = GetSrc(read.coordinate);
 
-      const DataType &resultType = debugger.GetType(opdata.resultType);
+      const DataType &resultType = debugger.GetType(inst.resultType);
 
       // only the sample operand should be here
       RDCASSERT((read.imageOperands.flags & ImageOperands::Sample) == read.imageOperands.flags);
@@ -3701,11 +3794,11 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       // only the sample operand should be here
       RDCASSERT((write.imageOperands.flags & ImageOperands::Sample) == write.imageOperands.flags);
 
-      debugger.GetAPIWrapper()->WriteTexel(img.GetBindIndex(), coord,
-                                           write.imageOperands.flags & ImageOperands::Sample
-                                               ? uintComp(GetSrc(write.imageOperands.sample), 0)
-                                               : 0,
-                                           texel);
+      debugger.WriteTexel(img.GetBindIndex(), coord,
+                          write.imageOperands.flags & ImageOperands::Sample
+                              ? uintComp(GetSrc(write.imageOperands.sample), 0)
+                              : 0,
+                          texel);
 
       break;
     }
@@ -3727,7 +3820,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::LoopMerge:
     {
       // we shouldn't process these, we should always jump past them
-      RDCERR("Unexpected %s", ToStr(opdata.op).c_str());
+      RDCERR("Unexpected %s", ToStr(inst.op).c_str());
       break;
     }
     case Op::Switch:
@@ -3830,7 +3923,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     }
     case Op::ReadClockKHR:
     {
-      const DataType &resultType = debugger.GetType(opdata.resultType);
+      const DataType &resultType = debugger.GetType(inst.resultType);
 
       ShaderVariable result;
 
@@ -3843,7 +3936,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       // the union.
       result.value.u64v[0] = global.clock;
 
-      SetDst(opdata.result, result);
+      SetDst(inst.result, result);
       break;
     }
     case Op::IsHelperInvocationEXT:
@@ -3856,7 +3949,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       setUintComp(result, 0, helperInvocation ? 1 : 0);
 
-      SetDst(opdata.result, result);
+      SetDst(inst.result, result);
       break;
     }
     case Op::DemoteToHelperInvocation:
@@ -3905,7 +3998,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       // destroy all stack frames
       for(StackFrame *exitingFrame : callstack)
-        delete exitingFrame;
+        exitingFrame->Release();
 
       callstack.clear();
 
@@ -3933,7 +4026,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       else
       {
         returnValue.name = "<return value>";
-        if(opdata.op == Op::ReturnValue)
+        if(inst.op == Op::ReturnValue)
         {
           OpReturnValue ret(it);
 
@@ -3950,9 +4043,9 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
 
       for(Id id : exitingFrame->idsCreated)
-        ids[id] = ShaderVariable();
+        ids.Mutable(id) = ShaderVariable();
 
-      delete exitingFrame;
+      exitingFrame->Release();
 
       break;
     }
@@ -3978,7 +4071,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       result.members[1].name = "coord";
       result.members[2].name = "sample";
 
-      SetDst(opdata.result, result);
+      SetDst(inst.result, result);
       break;
     }
     case Op::AtomicLoad:
@@ -3998,7 +4091,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        const DataType &resultType = debugger.GetType(opdata.resultType);
+        const DataType &resultType = debugger.GetType(inst.resultType);
 
         result.rows = result.columns = 1;
         result.type = resultType.scalar().Type();
@@ -4031,8 +4124,8 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        debugger.GetAPIWrapper()->WriteTexel(ptr.members[0].GetBindIndex(), ptr.members[1],
-                                             uintComp(ptr.members[2], 0), value);
+        debugger.WriteTexel(ptr.members[0].GetBindIndex(), ptr.members[1],
+                            uintComp(ptr.members[2], 0), value);
       }
 
       break;
@@ -4056,7 +4149,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        const DataType &resultType = debugger.GetType(opdata.resultType);
+        const DataType &resultType = debugger.GetType(inst.resultType);
 
         result.rows = result.columns = 1;
         result.type = resultType.scalar().Type();
@@ -4068,8 +4161,8 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
           RDCEraseEl(result.value);
         }
 
-        debugger.GetAPIWrapper()->WriteTexel(ptr.members[0].GetBindIndex(), ptr.members[1],
-                                             uintComp(ptr.members[2], 0), value);
+        debugger.WriteTexel(ptr.members[0].GetBindIndex(), ptr.members[1],
+                            uintComp(ptr.members[2], 0), value);
       }
 
       SetDst(excg.result, result);
@@ -4096,7 +4189,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        const DataType &resultType = debugger.GetType(opdata.resultType);
+        const DataType &resultType = debugger.GetType(inst.resultType);
 
         result.rows = result.columns = 1;
         result.type = resultType.scalar().Type();
@@ -4132,8 +4225,8 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
         }
         else
         {
-          debugger.GetAPIWrapper()->WriteTexel(ptr.members[0].GetBindIndex(), ptr.members[1],
-                                               uintComp(ptr.members[2], 0), value);
+          debugger.WriteTexel(ptr.members[0].GetBindIndex(), ptr.members[1],
+                              uintComp(ptr.members[2], 0), value);
         }
       }
       break;
@@ -4156,7 +4249,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        const DataType &resultType = debugger.GetType(opdata.resultType);
+        const DataType &resultType = debugger.GetType(inst.resultType);
 
         result.rows = result.columns = 1;
         result.type = resultType.scalar().Type();
@@ -4174,7 +4267,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       {
 #undef _IMPL
 #define _IMPL(I, S, U)                  \
-  if(opdata.op == Op::AtomicIIncrement) \
+  if(inst.op == Op::AtomicIIncrement) \
     comp<I>(result, 0)++;               \
   else                                  \
     comp<I>(result, 0)--;
@@ -4189,8 +4282,8 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        debugger.GetAPIWrapper()->WriteTexel(ptr.members[0].GetBindIndex(), ptr.members[1],
-                                             uintComp(ptr.members[2], 0), result);
+        debugger.WriteTexel(ptr.members[0].GetBindIndex(), ptr.members[1],
+                            uintComp(ptr.members[2], 0), result);
       }
       break;
     }
@@ -4223,7 +4316,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        const DataType &resultType = debugger.GetType(opdata.resultType);
+        const DataType &resultType = debugger.GetType(inst.resultType);
 
         result.rows = result.columns = 1;
         result.type = resultType.scalar().Type();
@@ -4238,82 +4331,82 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
 
       SetDst(atomic.result, result);
 
-      if(opdata.op == Op::AtomicIAdd)
+      if(inst.op == Op::AtomicIAdd)
       {
 #undef _IMPL
 #define _IMPL(I, S, U) comp<I>(result, 0) += comp<I>(value, 0)
 
         IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, value.type);
       }
-      else if(opdata.op == Op::AtomicISub)
+      else if(inst.op == Op::AtomicISub)
       {
 #undef _IMPL
 #define _IMPL(I, S, U) comp<I>(result, 0) -= comp<I>(value, 0)
 
         IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, value.type);
       }
-      else if(opdata.op == Op::AtomicSMin)
+      else if(inst.op == Op::AtomicSMin)
       {
 #undef _IMPL
 #define _IMPL(I, S, U) comp<S>(result, 0) = RDCMIN(comp<S>(result, 0), comp<S>(value, 0))
 
         IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, value.type);
       }
-      else if(opdata.op == Op::AtomicUMin)
+      else if(inst.op == Op::AtomicUMin)
       {
 #undef _IMPL
 #define _IMPL(I, S, U) comp<U>(result, 0) = RDCMIN(comp<U>(result, 0), comp<U>(value, 0))
 
         IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, value.type);
       }
-      else if(opdata.op == Op::AtomicSMax)
+      else if(inst.op == Op::AtomicSMax)
       {
 #undef _IMPL
 #define _IMPL(I, S, U) comp<S>(result, 0) = RDCMAX(comp<S>(result, 0), comp<S>(value, 0))
 
         IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, value.type);
       }
-      else if(opdata.op == Op::AtomicUMax)
+      else if(inst.op == Op::AtomicUMax)
       {
 #undef _IMPL
 #define _IMPL(I, S, U) comp<U>(result, 0) = RDCMAX(comp<U>(result, 0), comp<U>(value, 0))
 
         IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, value.type);
       }
-      else if(opdata.op == Op::AtomicAnd)
+      else if(inst.op == Op::AtomicAnd)
       {
 #undef _IMPL
 #define _IMPL(I, S, U) comp<U>(result, 0) &= comp<U>(value, 0)
 
         IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, value.type);
       }
-      else if(opdata.op == Op::AtomicOr)
+      else if(inst.op == Op::AtomicOr)
       {
 #undef _IMPL
 #define _IMPL(I, S, U) comp<U>(result, 0) |= comp<U>(value, 0)
 
         IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, value.type);
       }
-      else if(opdata.op == Op::AtomicXor)
+      else if(inst.op == Op::AtomicXor)
       {
 #undef _IMPL
 #define _IMPL(I, S, U) comp<U>(result, 0) ^= comp<U>(value, 0)
 
         IMPL_FOR_INT_TYPES_FOR_TYPE(_IMPL, value.type);
       }
-      else if(opdata.op == Op::AtomicFAddEXT)
+      else if(inst.op == Op::AtomicFAddEXT)
       {
 #undef _IMPL
 #define _IMPL(T) comp<T>(result, 0) += comp<T>(value, 0)
         IMPL_FOR_FLOAT_TYPES_FOR_TYPE(_IMPL, value.type);
       }
-      else if(opdata.op == Op::AtomicFMaxEXT)
+      else if(inst.op == Op::AtomicFMaxEXT)
       {
 #undef _IMPL
 #define _IMPL(T) comp<T>(result, 0) += RDCMAX(comp<T>(result, 0), comp<T>(value, 0))
         IMPL_FOR_FLOAT_TYPES_FOR_TYPE(_IMPL, value.type);
       }
-      else if(opdata.op == Op::AtomicFMinEXT)
+      else if(inst.op == Op::AtomicFMinEXT)
       {
 #undef _IMPL
 #define _IMPL(T) comp<T>(result, 0) += RDCMIN(comp<T>(result, 0), comp<T>(value, 0))
@@ -4327,8 +4420,8 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       }
       else
       {
-        debugger.GetAPIWrapper()->WriteTexel(ptr.members[0].GetBindIndex(), ptr.members[1],
-                                             uintComp(ptr.members[2], 0), result);
+        debugger.WriteTexel(ptr.members[0].GetBindIndex(), ptr.members[1],
+                            uintComp(ptr.members[2], 0), result);
       }
       break;
     }
@@ -4381,7 +4474,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable var("", 0U, 0U, 0U, 0U);
       var.columns = 1;
 
-      SetDst(opdata.result, var);
+      SetDst(inst.result, var);
 
       break;
     }
@@ -4421,7 +4514,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable var("", 0U, 0U, 0U, 0U);
       var.columns = 1;
 
-      SetDst(opdata.result, var);
+      SetDst(inst.result, var);
 
       break;
     }
@@ -4435,7 +4528,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
       ShaderVariable var("", 0U, 0U, 0U, 0U);
       var.columns = 1;
 
-      SetDst(opdata.result, var);
+      SetDst(inst.result, var);
 
       break;
     }
@@ -4615,12 +4708,12 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::SpecConstantCompositeReplicateEXT:
     case Op::RawAccessChainNV:
     {
-      RDCERR("Unsupported extension opcode used %s", ToStr(opdata.op).c_str());
+      RDCERR("Unsupported extension opcode used %s", ToStr(inst.op).c_str());
 
       ShaderVariable var("", 0U, 0U, 0U, 0U);
       var.columns = 1;
 
-      SetDst(opdata.result, var);
+      SetDst(inst.result, var);
 
       break;
     }
@@ -4694,7 +4787,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::TypeTensorLayoutNV:
     case Op::TypeTensorViewNV:
     {
-      RDCERR("Encountered unexpected global SPIR-V operation %s", ToStr(opdata.op).c_str());
+      RDCERR("Encountered unexpected global SPIR-V operation %s", ToStr(inst.op).c_str());
       break;
     }
 
@@ -4812,7 +4905,7 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::CooperativeVectorReduceSumAccumulateNV:
     {
       // these are kernel only
-      RDCERR("Encountered unexpected kernel SPIR-V operation %s", ToStr(opdata.op).c_str());
+      RDCERR("Encountered unexpected kernel SPIR-V operation %s", ToStr(inst.op).c_str());
       break;
     }
 
@@ -4824,31 +4917,21 @@ void ThreadState::StepNext(ShaderDebugState *state, const rdcarray<ThreadState>
     case Op::Variable:
     {
       // these should be handled elsewhere specially
-      RDCERR("Encountered SPIR-V operation %s in general dispatch loop", ToStr(opdata.op).c_str());
+      RDCERR("Encountered SPIR-V operation %s in general dispatch loop", ToStr(inst.op).c_str());
       break;
     }
 
-    case Op::Max: RDCWARN("Unhandled SPIR-V operation %s", ToStr(opdata.op).c_str()); break;
+    case Op::Max: RDCWARN("Unhandled SPIR-V operation %s", ToStr(inst.op).c_str()); break;
   }
 
   // skip over any degenerate branches
   while(!debugger.HasDebugInfo())
   {
-    it = debugger.GetIterForInstruction(nextInstruction);
-    if(it.opcode() == Op::Branch)
+    const DecodedInstruction &next = debugger.GetDecodedInstruction(nextInstruction);
+    if(next.op == Op::Branch && next.fallthroughBranch)
     {
-      Id target = OpBranch(it).targetLabel;
-
-      it++;
-
-      while(it.opcode() == Op::Line || it.opcode() == Op::NoLine)
-        it++;
-
-      if(target == OpLabel(it).result)
-      {
-        JumpToLabel(target);
-        continue;
-      }
+      JumpToLabel(next.target);
+      continue;
     }
 
     break;
@@ -26,6 +26,7 @@
 
 #include "api/replay/rdcarray.h"
 #include "maths/vec.h"
+#include "replay/common/debug_checkpoints.h"
 #include "spirv_common.h"
 #include "spirv_processor.h"
 
@@ -166,17 +167,118 @@ struct StackFrame
   // the last block we were in and the current block, for OpPhis
   Id lastBlock, curBlock;
 
+  // frames are shared between the callstack and any checkpoints that saved it, so they can be
+  // restored after returning. They're deleted once nothing refers to them
+  void AddRef() { refCount++; }
+  void Release()
+  {
+    if(--refCount == 0)
+      delete this;
+  }
+
 private:
+  ~StackFrame() = default;
+
+  uint32_t refCount = 1;
+
   // disallow copying to ensure the locals we allocate never move around
   StackFrame(const StackFrame &o) = delete;
   StackFrame &operator=(const StackFrame &o) = delete;
 };
 
+// a lane's mutable state saved in a checkpoint. Storage is restored by value into the same
+// variables so that pointers to it stay valid
+struct LaneCheckpoint
+{
+  struct Frame
+  {
+    // holds a reference, released by the owning checkpoint
+    StackFrame *frame = NULL;
+    rdcarray<ShaderVariable> locals;
+    rdcarray<Id> idsCreated;
+    rdcarray<Id> localsUsed;
+    rdcarray<Id> live;
+    Id lastBlock, curBlock;
+  };
+
+  uint32_t nextInstruction = 0;
+  rdcarray<ShaderVariable> outputs, privates;
+  SparseIdMap<rdcarray<Id>> pointersForId;
+  Id mergeBlock;
+  ShaderVariable returnValue;
+  rdcarray<Frame> callstack;
+  rdcarray<Id> live;
+  bool helperInvocation = false;
+  bool dead = false;
+};
+
 class Debugger;
 
+// the values of every Id for every lane in the workgroup, stored as one column per Id with a slot
+// for each lane. Ids which are never written while stepping - constants, types, etc - only have a
+// single value shared by all lanes, and columns are only allocated for Ids that lanes can write.
+// Each Id's name is also stored here once rather than being regenerated each time it's written.
+class LaneRegisterFile
+{
+public:
+  void Init(uint32_t numIds, uint32_t numLanes);
+
+  // allocates per-lane storage for an Id, initialised with its current shared value. This should
+  // be done up front for every Id that can be written while stepping, so that lanes never need to
+  // allocate and can be stepped independently
+  void AllocateLanes(Id id);
+  bool HasLanes(Id id) const { return !m_Registers[id.value()].lanes.empty(); }
+
+  // sets the value shared by all lanes
+  void SetShared(Id id, const ShaderVariable &val);
+
+  const ShaderVariable &Get(Id id, uint32_t lane) const
+  {
+    const Register &reg = m_Registers[id.value()];
+    return reg.lanes.empty() ? reg.shared : reg.lanes[lane];
+  }
+  // lanes may be stepped concurrently, so this never allocates. The Id must have lanes allocated
+  ShaderVariable &GetMutable(Id id, uint32_t lane)
+  {
+    Register &reg = m_Registers[id.value()];
+    RDCASSERT(!reg.lanes.empty(), id);
+    return reg.lanes[lane];
+  }
+
+  const rdcstr &GetName(Id id) const { return m_Registers[id.value()].name; }
+  uint32_t GetNumLanes() const { return m_NumLanes; }
+
+  // the per-lane values of every Id that has them, sorted by Id
+  typedef rdcarray<rdcpair<Id, rdcarray<ShaderVariable>>> Snapshot;
+
+  void Save(Snapshot &snapshot) const;
+  void Restore(const Snapshot &snapshot);
+
+private:
+  struct Register
+  {
+    rdcstr name;
+    ShaderVariable shared;
+    rdcarray<ShaderVariable> lanes;
+  };
+
+  rdcarray<Register> m_Registers;
+  uint32_t m_NumLanes = 0;
+};
+
+// one lane's view of the register file, indexed by Id
+struct LaneRegisters
+{
+  const ShaderVariable &operator[](Id id) const { return file->Get(id, lane); }
+  ShaderVariable &Mutable(Id id) { return file->GetMutable(id, lane); }
+
+  LaneRegisterFile *file = NULL;
+  uint32_t lane = 0;
+};
+
 struct ThreadState
 {
-  ThreadState(Debugger &debug, const GlobalState &globalState);
+  ThreadState(Debugger &debug, const GlobalState &globalState, uint32_t laneIndex);
   ~ThreadState();
 
   void EnterEntryPoint(ShaderDebugState *state);
@@ -201,6 +303,9 @@ struct ThreadState
 
   bool Finished() const;
 
+  void SaveCheckpoint(LaneCheckpoint &checkpoint) const;
+  void RestoreCheckpoint(const LaneCheckpoint &checkpoint);
+
   uint32_t nextInstruction;
 
   const GlobalState &global;
@@ -212,8 +317,11 @@ struct ThreadState
   // thread-local private variables
   rdcarray<ShaderVariable> privates;
 
+  // how many times this lane has executed each instruction, for lanes that are profiled
+  rdcarray<uint32_t> executions;
+
   // every ID's variable, if a pointer it may be pointing at a ShaderVariable stored elsewhere
-  DenseIdMap<ShaderVariable> ids;
+  LaneRegisters ids;
 
   // for any allocated variables, a list of 'extra' pointers pointing to it. By default the actual
   // storage of allocated variables is not directly accessible (it's stored in e.g. inputs, outputs,
@@ -231,8 +339,6 @@ struct ThreadState
   // the list of IDs that are currently valid and live
   rdcarray<Id> live;
 
-  std::map<Id, uint32_t> lastWrite;
-
   // quad ID (arbitrary, just used to find neighbours for derivatives)
   uint32_t quadId = 0;
   // index in the pixel quad (relative to the active lane)
@@ -261,6 +367,9 @@ private:
   void SkipIgnoredInstructions();
 
   ShaderDebugState *m_State = NULL;
+
+  // scratch storage for evaluated access chain indices, to avoid allocating on each step
+  rdcarray<uint32_t> m_IndexScratch;
 };
 
 enum class DebugScope
@@ -367,6 +476,41 @@ struct LocalData
   TypeData *type;
 };
 
+// a compact pre-decoded form of an instruction inside a function. These are built once after
+// parsing so that stepping doesn't need to re-walk the raw words or look up per-instruction data
+struct DecodedInstruction
+{
+  Op op = Op::Max;
+  Id result, resultType;
+
+  // this instruction is stepped over without being executed: OpLine/OpNoLine/OpUndef, merge
+  // declarations, and debug info instructions that aren't values in scope
+  bool skip = false;
+
+  // for OpBranch, whether this branches directly to the label immediately following it
+  bool fallthroughBranch = false;
+
+  // this instruction only reads and writes the executing lane's own state - no other lanes, no
+  // shared memory and no calls out to the API wrapper - so lanes can execute it concurrently
+  bool laneLocal = false;
+
+  // how many lane-local instructions are executed in a row starting from this one, before reaching
+  // one that isn't. Skipped instructions don't count
+  uint32_t laneLocalRun = 0;
+
+  // the merge block for OpSelectionMerge/OpLoopMerge, or the target for OpBranch
+  Id target;
+
+  // for access chains, the base pointer and (for pointer access chains) the element. The indices
+  // are stored in the Debugger's shared operand list
+  Id base, element;
+  uint32_t firstOperand = 0, numOperands = 0;
+
+  // the debug info scope and inline site for this instruction, if any
+  const ScopeData *scope = NULL;
+  const InlineData *inlined = NULL;
+};
+
 Id ParseRawName(const rdcstr &name);
 rdcstr GetRawName(Id id);
 
@@ -383,8 +527,18 @@ public:
                                uint32_t threadsInWorkgroup, uint32_t threadsInSubgroup);
 
   rdcarray<ShaderDebugState> ContinueDebug();
+  ShaderDebugState SeekDebug(uint32_t stepIndex);
+  rdcarray<rdcarray<uint32_t>> GetLaneExecutions();
 
   Iter GetIterForInstruction(uint32_t inst);
+  const DecodedInstruction &GetDecodedInstruction(uint32_t inst) const
+  {
+    return decodedInstructions[inst];
+  }
+  const Id *GetDecodedOperands(const DecodedInstruction &inst) const
+  {
+    return decodedOperands.data() + inst.firstOperand;
+  }
   uint32_t GetInstructionForIter(Iter it);
   uint32_t GetInstructionForFunction(Id id);
   uint32_t GetInstructionForLabel(Id id);
@@ -409,6 +563,13 @@ public:
   bool IsOpaquePointer(const ShaderVariable &v) const;
   bool IsPhysicalPointer(const ShaderVariable &v) const;
 
+  // writes to buffers, memory and images go through these instead of the API wrapper directly, so
+  // the previous contents can be put back when restoring a checkpoint
+  void WriteBufferValue(ShaderBindIndex bind, uint64_t offset, uint64_t byteSize, const void *src);
+  void WriteAddress(uint64_t address, uint64_t byteSize, const void *src);
+  bool WriteTexel(ShaderBindIndex imageBind, const ShaderVariable &coord, uint32_t sample,
+                  const ShaderVariable &value);
+
   bool ArePointersAndEqual(const ShaderVariable &a, const ShaderVariable &b) const;
   void WriteThroughPointer(ShaderVariable &ptr, const ShaderVariable &val);
   ShaderVariable MakeCompositePointer(const ShaderVariable &base, Id id, rdcarray<uint32_t> &indices);
@@ -420,11 +581,14 @@ public:
   ThreadState &GetActiveLane() { return workgroup[activeLaneIndex]; }
   const ThreadState &GetActiveLane() const { return workgroup[activeLaneIndex]; }
   uint32_t GetSubgroupSize() const { return subgroupSize; }
+  LaneRegisterFile &GetRegisters() { return registers; }
 private:
   virtual void PreParse(uint32_t maxId);
   virtual void PostParse();
   virtual void RegisterOp(Iter it);
 
+  void DecodeInstructions();
+
   template <typename ShaderVarType, bool allocate>
   uint32_t WalkVariable(const Decorations &curDecorations, const DataType &type,
                         uint64_t offsetOrLocation, ShaderVarType &var, const rdcstr &accessSuffix,
@@ -437,6 +601,12 @@ private:
   void MakeSignatureNames(const rdcarray<SPIRVInterfaceAccess> &sigList, rdcarray<rdcstr> &sigNames);
 
   void FillCallstack(ThreadState &thread, ShaderDebugState &state);
+  ShaderDebugState BeginStepping();
+  bool StepWorkgroup(rdcarray<bool> &activeMask, rdcarray<ShaderDebugState> &ret);
+  void FinishWorkgroup();
+  void SaveCheckpoint();
+  void RestoreCheckpoint(uint32_t step);
+  void CompactExternalWrites();
   void FillDebugSourceVars(rdcarray<InstructionSourceInfo> &instInfo);
   void FillDefaultSourceVars(rdcarray<InstructionSourceInfo> &instInfo);
 
@@ -446,16 +616,92 @@ private:
   DebugAPIWrapper *apiWrapper = NULL;
 
   GlobalState global;
+  LaneRegisterFile registers;
   rdcarray<ThreadState> workgroup;
 
   Id convergeBlock;
 
+  // after a batch of lane-local instructions the other lanes are ahead of the active lane, which
+  // steps alone for this many more steps to catch up with them
+  uint32_t activeLaneBatchSteps = 0;
+
+  // whether the other lanes' executions have been counted from the start. They aren't saved in
+  // checkpoints, so they stop being valid once one is restored
+  bool laneExecutionsValid = false;
+
   uint32_t activeLaneIndex = 0;
   uint32_t subgroupSize = 0;
   ShaderStage stage;
 
   int steps = 0;
 
+  struct Checkpoint
+  {
+    Checkpoint() = default;
+    ~Checkpoint();
+
+    rdcarray<LaneCheckpoint> lanes;
+    LaneRegisterFile::Snapshot registers;
+    rdcarray<ShaderVariable> workgroups;
+    uint64_t clock = 0;
+    Id convergeBlock;
+    size_t numExternalWrites = 0;
+
+  private:
+    Checkpoint(const Checkpoint &) = delete;
+    Checkpoint &operator=(const Checkpoint &) = delete;
+  };
+
+  // a write outside of the debugger's own state, with the previous contents to undo it
+  struct ExternalWrite
+  {
+    enum class Type
+    {
+      Buffer,
+      Address,
+      Texel,
+    } type = Type::Buffer;
+    ShaderBindIndex bind;
+    uint64_t offset = 0;
+    bytebuf data;
+    ShaderVariable coord;
+    uint32_t sample = 0;
+    ShaderVariable texel;
+  };
+
+  // the memory an external write touched, ignoring the contents
+  struct ExternalWriteLocation
+  {
+    ExternalWriteLocation(const ExternalWrite &write);
+    bool operator<(const ExternalWriteLocation &o) const;
+
+    ExternalWrite::Type type;
+    ShaderBindIndex bind;
+    uint64_t offset;
+    uint64_t size;
+    rdcfixedarray<uint32_t, 4> coord;
+    uint32_t sample;
+  };
+
+  bool ShouldRecordExternalWrite(const ExternalWrite &write);
+
+  DebugCheckpoints<Checkpoint> checkpoints;
+
+  // restoring a checkpoint undoes every write after its numExternalWrites, newest first. Only the
+  // first write to each location after a checkpoint needs to be undone, so later ones aren't
+  // recorded and when checkpoints are dropped the log is compacted to match. That keeps its size
+  // bounded by the number of locations written rather than the number of writes
+  rdcarray<ExternalWrite> externalWrites;
+
+  // the locations written since the checkpoint at externalWriteStep
+  std::set<ExternalWriteLocation> externalWriteLocations;
+  uint32_t externalWriteStep = ~0U;
+
+  // how many states ContinueDebug has returned, to carry on from there after seeking, and the first
+  // of them which can't be re-executed
+  uint32_t numContinued = 0;
+  ShaderDebugState initialState;
+
   /////////////////////////////////////////////////////////
   // parsed data
 
@@ -496,9 +742,15 @@ private:
 
   rdcarray<size_t> instructionOffsets;
 
+  // parallel to instructionOffsets
+  rdcarray<DecodedInstruction> decodedInstructions;
+  rdcarray<Id> decodedOperands;
+
   std::set<rdcstr> usedNames;
   std::map<Id, rdcstr> dynamicNames;
   void CalcActiveMask(rdcarray<bool> &activeMask);
+  uint32_t GetLaneLocalBatch() const;
+  void StepActiveLane(const rdcarray<bool> &activeMask, rdcarray<ShaderDebugState> &ret);
 
   struct
   {
@@ -24,6 +24,7 @@
 
 #include "spirv_debug.h"
 #include "common/formatting.h"
+#include "common/threading.h"
 #include "core/settings.h"
 #include "replay/common/var_dispatch_helpers.h"
 #include "spirv_op_helpers.h"
@@ -36,6 +37,16 @@ RDOC_DEBUG_CONFIG(
     bool, Vulkan_Hack_EnableGroupCaps, false,
     "Work in progress allow shaders to be debugged with subgroup/workgroup requirements.");
 
+RDOC_EXTERN_CONFIG(bool, Replay_Debug_SingleThreadedShaderDebugging);
+RDOC_EXTERN_CONFIG(uint32_t, Replay_Debug_ShaderCheckpointInterval);
+RDOC_EXTERN_CONFIG(uint32_t, Replay_Debug_ShaderMaxCheckpoints);
+
+// a batch of lane-local instructions is only spread across worker threads when the other lanes
+// have at least this many instructions to execute between them, and each worker takes roughly
+// ParallelBatchGrainSize instructions at a time
+static const uint32_t ParallelBatchThreshold = 512;
+static const uint32_t ParallelBatchGrainSize = 128;
+
 // this could be cleaner if ShaderVariable wasn't a very public struct, but it's not worth it so
 // we just reserve value slots that we know won't be used in opaque variables.
 // there's significant wasted space to keep things simple with one property = one slot
@@ -971,14 +982,16 @@ ShaderDebugTrace *Debugger::BeginDebug(DebugAPIWrapper *api, const ShaderStage s
   stage = shaderStage;
   apiWrapper = api;
 
+  checkpoints.Init(Replay_Debug_ShaderCheckpointInterval(), Replay_Debug_ShaderMaxCheckpoints());
+
   for(uint32_t i = 0; i < threadsInWorkgroup; i++)
-    workgroup.push_back(ThreadState(*this, global));
+    workgroup.push_back(ThreadState(*this, global, i));
 
   ThreadState &active = GetActiveLane();
 
   active.nextInstruction = instructionOffsets.indexOf(functions[entryId].begin);
 
-  active.ids.resize(idOffsets.size());
+  registers.Init((uint32_t)idOffsets.size(), threadsInWorkgroup);
 
   // array names and struct member names are not set when constants are created
   for(auto it = constants.begin(); it != constants.end(); ++it)
@@ -989,11 +1002,27 @@ ShaderDebugTrace *Debugger::BeginDebug(DebugAPIWrapper *api, const ShaderStage s
     SetStructArrayNames(c.value, typeWalk, specInfo);
   }
 
-  // evaluate all constants
+  // evaluate all constants, these are shared by all lanes
   for(auto it = constants.begin(); it != constants.end(); it++)
+    registers.SetShared(it->first, EvaluateConstant(it->first, specInfo));
+
+  // anything produced by an instruction in a function gets a value per lane. Labels and functions
+  // are never written, nor are the results of non-semantic instructions which we don't execute
+  for(uint32_t i = 0; i < decodedInstructions.size(); i++)
   {
-    active.ids[it->first] = EvaluateConstant(it->first, specInfo);
-    active.ids[it->first].name = GetRawName(it->first);
+    const DecodedInstruction &inst = decodedInstructions[i];
+
+    if(inst.result == Id() || inst.op == Op::Label || inst.op == Op::Function)
+      continue;
+
+    if(inst.op == Op::ExtInst || inst.op == Op::ExtInstWithForwardRefsKHR)
+    {
+      auto ext = global.extInsts.find(Id::fromWord(GetIterForInstruction(i).word(3)));
+      if(ext != global.extInsts.end() && ext->second.nonsemantic)
+        continue;
+    }
+
+    registers.AllocateLanes(inst.result);
   }
 
   rdcarray<rdcstr> inputSigNames, outputSigNames;
@@ -1015,9 +1044,9 @@ ShaderDebugTrace *Debugger::BeginDebug(DebugAPIWrapper *api, const ShaderStage s
     void Set(Debugger &d, const GlobalState &global, ThreadState &lane) const
     {
       if(globalStorage)
-        lane.ids[id] = d.MakePointerVariable(id, &(global.*globalStorage)[index]);
+        lane.ids.Mutable(id) = d.MakePointerVariable(id, &(global.*globalStorage)[index]);
       else
-        lane.ids[id] = d.MakePointerVariable(id, &(lane.*threadStorage)[index]);
+        lane.ids.Mutable(id) = d.MakePointerVariable(id, &(lane.*threadStorage)[index]);
     }
 
     Id id;
@@ -1570,7 +1599,11 @@ ShaderDebugTrace *Debugger::BeginDebug(DebugAPIWrapper *api, const ShaderStage s
       lane.nextInstruction = active.nextInstruction;
       lane.outputs = active.outputs;
       lane.privates = active.privates;
-      lane.ids = active.ids;
+
+      // every thread in a compute workgroup is simulated with its real inputs, so count what the
+      // others execute for profiling. This is small next to each lane's registers
+      if(stage == ShaderStage::Compute || stage == ShaderStage::Task || stage == ShaderStage::Mesh)
+        lane.executions.fill(instructionOffsets.size(), 0U);
     }
 
     if(stage == ShaderStage::Pixel)
@@ -1588,9 +1621,14 @@ ShaderDebugTrace *Debugger::BeginDebug(DebugAPIWrapper *api, const ShaderStage s
 
     // now that the globals are allocated and their storage won't move, we can take pointers to them
     for(const PointerId &p : pointerIDs)
+    {
+      registers.AllocateLanes(p.id);
       p.Set(*this, global, lane);
+    }
   }
 
+  laneExecutionsValid = true;
+
   // find quad neighbours
   {
     rdcarray<uint32_t> processedQuads;
@@ -2450,175 +2488,585 @@ rdcarray<ShaderDebugState> Debugger::ContinueDebug()
 
   rdcarray<ShaderDebugState> ret;
 
+  rdcarray<bool> activeMask;
+  auto restore = [this](uint32_t step) { RestoreCheckpoint(step); };
+  auto stepWorkgroup = [this, &activeMask](rdcarray<ShaderDebugState> &states) {
+    return StepWorkgroup(activeMask, states);
+  };
+
   // initialise the first ShaderDebugState if we haven't stepped yet
   if(steps == 0)
+    ret.push_back(BeginStepping());
+  else if(checkpoints.Resume(uint32_t(steps - 1), numContinued, restore, stepWorkgroup))
+    ret.push_back(initialState);
+
+  // continue stepping until we have 100 target steps completed in a chunk. This may involve doing
+  // more steps if our target thread is inactive. If we've finished, return an empty set to signify
+  // that
+  for(int stepEnd = steps + 100; steps < stepEnd && !active.Finished();)
   {
-    ShaderDebugState initial;
+    if(!StepWorkgroup(activeMask, ret))
+      break;
+  }
 
-    // we should be sitting at the entry point function prologue, step forward into the first block
-    // and past any function-local variable declarations
-    for(size_t lane = 0; lane < workgroup.size(); lane++)
+  numContinued = uint32_t(steps);
+
+  return ret;
+}
+
+ShaderDebugState Debugger::SeekDebug(uint32_t stepIndex)
+{
+  ThreadState &active = GetActiveLane();
+
+  if(!checkpoints.Enabled())
+    return ShaderDebugState();
+
+  if(steps == 0)
+    BeginStepping();
+
+  uint32_t current = uint32_t(steps - 1);
+
+  // if we've already finished we know where the last step is
+  if(active.Finished())
+    stepIndex = RDCMIN(stepIndex, current);
+
+  rdcarray<bool> activeMask;
+  ShaderDebugState ret = checkpoints.Seek(
+      current, stepIndex, [this](uint32_t step) { RestoreCheckpoint(step); },
+      [this, &activeMask](rdcarray<ShaderDebugState> &states) {
+        return StepWorkgroup(activeMask, states);
+      });
+
+  ret.stepIndex = uint32_t(steps - 1);
+  ret.changes.clear();
+
+  if(ret.stepIndex == 0)
+  {
+    FillCallstack(active, ret);
+    ret.nextInstruction = active.nextInstruction;
+  }
+
+  const StackFrame *frame = active.callstack.empty() ? NULL : active.callstack.back();
+
+  // return a full state, rather than the changes made by this step
+  for(const Id &v : active.live)
+  {
+    // without debug info, locals are only shown from their first write
+    if(!m_DebugInfo.valid && frame && !frame->localsUsed.contains(v))
     {
-      ThreadState &thread = workgroup[lane];
+      const rdcstr &name = registers.GetName(v);
+      bool unusedLocal = false;
+      for(const ShaderVariable &local : frame->locals)
+        unusedLocal |= (local.name == name);
 
-      if(lane == activeLaneIndex)
-      {
-        thread.EnterEntryPoint(&initial);
-        FillCallstack(thread, initial);
-        initial.nextInstruction = thread.nextInstruction;
-      }
-      else
-      {
-        thread.EnterEntryPoint(NULL);
-      }
+      if(unusedLocal)
+        continue;
     }
 
-    // globals won't be filled out by entering the entry point, ensure their change is registered.
-    for(const Id &v : liveGlobals)
-      initial.changes.push_back({ShaderVariable(), GetPointerValue(active.ids[v])});
+    // ids are emptied when returning from the function that created them
+    if(active.ids[v].name.empty())
+      continue;
 
-    if(m_DebugInfo.valid)
+    ret.changes.push_back({ShaderVariable(), GetPointerValue(active.ids[v])});
+  }
+
+  if(m_DebugInfo.valid)
+  {
+    for(const Id &v : m_DebugInfo.constants)
+      ret.changes.push_back({ShaderVariable(), GetPointerValue(active.ids[v])});
+  }
+
+  return ret;
+}
+
+rdcarray<rdcarray<uint32_t>> Debugger::GetLaneExecutions()
+{
+  rdcarray<rdcarray<uint32_t>> ret;
+
+  if(!laneExecutionsValid || !GetActiveLane().Finished())
+    return ret;
+
+  FinishWorkgroup();
+
+  for(size_t lane = 0; lane < workgroup.size(); lane++)
+  {
+    if(lane != activeLaneIndex && !workgroup[lane].dead && !workgroup[lane].executions.empty())
+      ret.push_back(workgroup[lane].executions);
+  }
+
+  return ret;
+}
+
+ShaderDebugState Debugger::BeginStepping()
+{
+  ThreadState &active = GetActiveLane();
+
+  ShaderDebugState initial;
+
+  // we should be sitting at the entry point function prologue, step forward into the first block
+  // and past any function-local variable declarations
+  for(size_t lane = 0; lane < workgroup.size(); lane++)
+  {
+    ThreadState &thread = workgroup[lane];
+
+    if(lane == activeLaneIndex)
     {
-      // debug info can refer to constants for source variable values. Add an initial change for any
-      // that are so referenced
-      for(const Id &v : m_DebugInfo.constants)
-        initial.changes.push_back({ShaderVariable(), GetPointerValue(active.ids[v])});
+      thread.EnterEntryPoint(&initial);
+      FillCallstack(thread, initial);
+      initial.nextInstruction = thread.nextInstruction;
     }
+    else
+    {
+      thread.EnterEntryPoint(NULL);
+    }
+  }
+
+  // globals won't be filled out by entering the entry point, ensure their change is registered.
+  for(const Id &v : liveGlobals)
+    initial.changes.push_back({ShaderVariable(), GetPointerValue(active.ids[v])});
+
+  if(m_DebugInfo.valid)
+  {
+    // debug info can refer to constants for source variable values. Add an initial change for any
+    // that are so referenced
+    for(const Id &v : m_DebugInfo.constants)
+      initial.changes.push_back({ShaderVariable(), GetPointerValue(active.ids[v])});
+  }
 
-    ret.push_back(std::move(initial));
+  steps++;
 
-    steps++;
+  // always checkpoint the start so that every step can be reached again
+  if(checkpoints.ShouldSave(0))
+  {
+    SaveCheckpoint();
+    initialState = initial;
   }
 
-  // if we've finished, return an empty set to signify that
+  return initial;
+}
+
+bool Debugger::StepWorkgroup(rdcarray<bool> &activeMask, rdcarray<ShaderDebugState> &ret)
+{
+  ThreadState &active = GetActiveLane();
+
+  if(!active.Finished() && checkpoints.ShouldSave(uint32_t(steps - 1)))
+    SaveCheckpoint();
+
+  global.clock++;
+
   if(active.Finished())
-    return ret;
+    return false;
+
+  // the rest of the workgroup has already executed this step in a batch, and every lane is active
+  // until the active lane catches up
+  if(activeLaneBatchSteps > 0)
+  {
+    activeLaneBatchSteps--;
+    activeMask.fill(workgroup.size(), true);
+    StepActiveLane(activeMask, ret);
+    return true;
+  }
+
+  // calculate the current mask of which threads are active
+  CalcActiveMask(activeMask);
+
+  // if the workgroup is about to execute a run of instructions that only touch each lane's own
+  // state, the other lanes execute the whole run now spread across worker threads. The active lane
+  // records the debug state, so it still executes one instruction per step
+  uint32_t batch = GetLaneLocalBatch();
+  if(batch > 0)
+  {
+    Threading::JobSystem::ParallelFor(
+        workgroup.size(), RDCMAX(1U, ParallelBatchGrainSize / batch),
+        [this, &activeMask, batch](size_t begin, size_t end) {
+          for(size_t lane = begin; lane < end; lane++)
+          {
+            if(lane == activeLaneIndex)
+              continue;
+
+            for(uint32_t i = 0; i < batch; i++)
+              workgroup[lane].StepNext(NULL, workgroup, activeMask);
+          }
+        });
+
+    activeLaneBatchSteps = batch - 1;
+    StepActiveLane(activeMask, ret);
+
+    return true;
+  }
+
+  // step all active members of the workgroup
+  for(size_t lane = 0; lane < workgroup.size(); lane++)
+  {
+    if(!activeMask[lane])
+      continue;
+
+    if(lane == activeLaneIndex)
+    {
+      StepActiveLane(activeMask, ret);
+      continue;
+    }
 
+    ThreadState &thread = workgroup[lane];
+
+    if(thread.nextInstruction < instructionOffsets.size())
+      thread.StepNext(NULL, workgroup, activeMask);
+  }
+
+  return true;
+}
+
+void Debugger::FinishWorkgroup()
+{
   rdcarray<bool> activeMask;
 
-  // continue stepping until we have 100 target steps completed in a chunk. This may involve doing
-  // more steps if our target thread is inactive
-  for(int stepEnd = steps + 100; steps < stepEnd;)
+  // the debugged lane has finished, but the others may not have
+  for(;;)
   {
     global.clock++;
 
-    if(active.Finished())
-      break;
-
-    // calculate the current mask of which threads are active
     CalcActiveMask(activeMask);
 
-    // step all active members of the workgroup
+    bool anyActive = false;
     for(size_t lane = 0; lane < workgroup.size(); lane++)
     {
       ThreadState &thread = workgroup[lane];
 
-      if(activeMask[lane])
+      if(activeMask[lane] && thread.nextInstruction < instructionOffsets.size())
       {
-        if(thread.nextInstruction >= instructionOffsets.size())
-        {
-          if(lane == activeLaneIndex)
-            ret.emplace_back();
+        thread.StepNext(NULL, workgroup, activeMask);
+        anyActive = true;
+      }
+    }
 
-          continue;
-        }
+    if(!anyActive)
+      break;
+  }
+}
 
-        if(lane == activeLaneIndex)
-        {
-          ShaderDebugState state;
+Debugger::Checkpoint::~Checkpoint()
+{
+  for(LaneCheckpoint &lane : lanes)
+    for(LaneCheckpoint::Frame &frame : lane.callstack)
+      frame.frame->Release();
+}
 
-          size_t instOffs = instructionOffsets[thread.nextInstruction];
+void Debugger::SaveCheckpoint()
+{
+  const size_t prevCount = checkpoints.Count();
 
-          // see if we're retiring any IDs at this state
-          for(size_t l = 0; l < thread.live.size();)
-          {
-            Id id = thread.live[l];
-            if(idLiveRange[id].second < instOffs)
-            {
-              thread.live.erase(l);
-              ShaderVariableChange change;
-              change.before = GetPointerValue(thread.ids[id]);
-              state.changes.push_back(change);
+  Checkpoint &cp = checkpoints.Add(uint32_t(steps - 1));
 
-              continue;
-            }
+  cp.lanes.resize(workgroup.size());
+  for(size_t lane = 0; lane < workgroup.size(); lane++)
+    workgroup[lane].SaveCheckpoint(cp.lanes[lane]);
 
-            l++;
-          }
+  registers.Save(cp.registers);
+  cp.workgroups = global.workgroups;
+  cp.clock = global.clock;
+  cp.convergeBlock = convergeBlock;
+  cp.numExternalWrites = externalWrites.size();
 
-          uint32_t funcRet = ~0U;
-          size_t prevStackSize = thread.callstack.size();
+  // if any checkpoints were dropped, the writes after them now belong to the checkpoint before
+  if(checkpoints.Count() <= prevCount)
+    CompactExternalWrites();
+}
 
-          if(!thread.callstack.empty())
-            funcRet = thread.callstack.back()->funcCallInstruction;
+void Debugger::CompactExternalWrites()
+{
+  rdcarray<ExternalWrite> compacted;
+  std::set<ExternalWriteLocation> locations;
+
+  // keep the first write to each location after each checkpoint, which is the one that restores it
+  size_t w = 0;
+  checkpoints.ForEach([&](uint32_t, Checkpoint &cp) {
+    for(; w < cp.numExternalWrites; w++)
+      if(locations.insert(ExternalWriteLocation(externalWrites[w])).second)
+        compacted.push_back(std::move(externalWrites[w]));
+
+    locations.clear();
+    cp.numExternalWrites = compacted.size();
+  });
 
-          state.stepIndex = steps;
-          thread.StepNext(&state, workgroup, activeMask);
+  for(; w < externalWrites.size(); w++)
+    if(locations.insert(ExternalWriteLocation(externalWrites[w])).second)
+      compacted.push_back(std::move(externalWrites[w]));
 
-          if(thread.callstack.size() > prevStackSize)
-            instOffs =
-                instructionOffsets[GetInstructionForFunction(thread.callstack.back()->function)];
+  externalWrites.swap(compacted);
 
-          else if(thread.callstack.size() < prevStackSize && funcRet != ~0U)
-            instOffs = instructionOffsets[funcRet];
+  externalWriteLocations.clear();
+  externalWriteStep = ~0U;
+}
 
-          FillCallstack(thread, state);
+Debugger::ExternalWriteLocation::ExternalWriteLocation(const ExternalWrite &write)
+    : type(write.type),
+      bind(write.bind),
+      offset(write.offset),
+      size(write.data.size()),
+      sample(write.sample)
+{
+  for(uint32_t i = 0; i < 4; i++)
+    coord[i] = write.type == ExternalWrite::Type::Texel ? write.coord.value.u32v[i] : 0;
+}
 
-          if(m_DebugInfo.valid)
-          {
-            size_t endOffs = instructionOffsets[thread.nextInstruction - 1];
+bool Debugger::ExternalWriteLocation::operator<(const ExternalWriteLocation &o) const
+{
+  if(type != o.type)
+    return type < o.type;
+  if(!(bind == o.bind))
+    return bind < o.bind;
+  if(offset != o.offset)
+    return offset < o.offset;
+  if(size != o.size)
+    return size < o.size;
+  for(uint32_t i = 0; i < 4; i++)
+    if(coord[i] != o.coord[i])
+      return coord[i] < o.coord[i];
+  return sample < o.sample;
+}
 
-            // append any inlined functions to the top of the stack
-            InlineData *inlined = m_DebugInfo.lineInline[endOffs];
+bool Debugger::ShouldRecordExternalWrite(const ExternalWrite &write)
+{
+  // the log is appended after the latest checkpoint at or before this step. If that's changed
+  // since the last write, the locations written so far belong to an earlier checkpoint
+  uint32_t cpStep = ~0U;
+  checkpoints.FindNearest(uint32_t(steps - 1), cpStep);
+  if(cpStep != externalWriteStep)
+  {
+    externalWriteLocations.clear();
+    externalWriteStep = cpStep;
+  }
 
-            size_t insertPoint = state.callstack.size();
+  return externalWriteLocations.insert(ExternalWriteLocation(write)).second;
+}
 
-            // start with the current scope, it refers to the *inlined* function
-            if(inlined)
-            {
-              const ScopeData *scope = GetScope(endOffs);
-              // find the function parent of the current scope
-              while(scope && scope->parent && scope->type == DebugScope::Block)
-                scope = scope->parent;
+void Debugger::RestoreCheckpoint(uint32_t step)
+{
+  uint32_t cpStep = 0;
+  const Checkpoint *cp = checkpoints.FindNearest(step, cpStep);
+  if(!cp)
+  {
+    RDCERR("No checkpoint available to restore step %u", step);
+    return;
+  }
 
-              state.callstack.insert(insertPoint, scope->name);
-            }
+  // undo any writes made since the checkpoint, newest first
+  while(externalWrites.size() > cp->numExternalWrites)
+  {
+    const ExternalWrite &write = externalWrites.back();
+    switch(write.type)
+    {
+      case ExternalWrite::Type::Buffer:
+        apiWrapper->WriteBufferValue(write.bind, write.offset, write.data.size(),
+                                     write.data.data());
+        break;
+      case ExternalWrite::Type::Address:
+        apiWrapper->WriteAddress(write.offset, write.data.size(), write.data.data());
+        break;
+      case ExternalWrite::Type::Texel:
+        apiWrapper->WriteTexel(write.bind, write.coord, write.sample, write.texel);
+        break;
+    }
+    externalWrites.pop_back();
+  }
 
-            // if this instruction has no scope, don't give it a callstack
-            if(GetScope(endOffs) == NULL)
-            {
-              state.callstack.clear();
-            }
+  externalWriteLocations.clear();
+  externalWriteStep = ~0U;
 
-            // move to the next inline up on our inline stack. If we reach an actual function
-            // call, this parent will be NULL as there was no more inlining - the final scope will
-            // refer to the real function which is already on our stack
-            while(inlined && inlined->parent)
-            {
-              const ScopeData *scope = inlined->scope;
-              // find the function parent of the current scope
-              while(scope && scope->parent && scope->type == DebugScope::Block)
-                scope = scope->parent;
+  for(size_t lane = 0; lane < workgroup.size(); lane++)
+    workgroup[lane].RestoreCheckpoint(cp->lanes[lane]);
 
-              state.callstack.insert(insertPoint, scope->name);
+  registers.Restore(cp->registers);
+  for(size_t i = 0; i < cp->workgroups.size(); i++)
+    AssignValue(global.workgroups[i], cp->workgroups[i]);
+  global.clock = cp->clock;
+  convergeBlock = cp->convergeBlock;
+  activeLaneBatchSteps = 0;
+  laneExecutionsValid = false;
+  steps = int(cpStep + 1);
+}
 
-              inlined = inlined->parent;
-            }
-          }
+void Debugger::WriteBufferValue(ShaderBindIndex bind, uint64_t offset, uint64_t byteSize,
+                                const void *src)
+{
+  if(checkpoints.Enabled())
+  {
+    ExternalWrite write;
+    write.type = ExternalWrite::Type::Buffer;
+    write.bind = bind;
+    write.offset = offset;
+    write.data.resize((size_t)byteSize);
+    if(ShouldRecordExternalWrite(write))
+    {
+      apiWrapper->ReadBufferValue(bind, offset, byteSize, write.data.data());
+      externalWrites.push_back(std::move(write));
+    }
+  }
 
-          ret.push_back(std::move(state));
+  apiWrapper->WriteBufferValue(bind, offset, byteSize, src);
+}
 
-          steps++;
-        }
-        else
-        {
-          thread.StepNext(NULL, workgroup, activeMask);
-        }
-      }
+void Debugger::WriteAddress(uint64_t address, uint64_t byteSize, const void *src)
+{
+  if(checkpoints.Enabled())
+  {
+    ExternalWrite write;
+    write.type = ExternalWrite::Type::Address;
+    write.offset = address;
+    write.data.resize((size_t)byteSize);
+    if(ShouldRecordExternalWrite(write))
+    {
+      apiWrapper->ReadAddress(address, byteSize, write.data.data());
+      externalWrites.push_back(std::move(write));
     }
   }
 
-  return ret;
+  apiWrapper->WriteAddress(address, byteSize, src);
+}
+
+bool Debugger::WriteTexel(ShaderBindIndex imageBind, const ShaderVariable &coord, uint32_t sample,
+                          const ShaderVariable &value)
+{
+  if(checkpoints.Enabled())
+  {
+    ExternalWrite write;
+    write.type = ExternalWrite::Type::Texel;
+    write.bind = imageBind;
+    write.coord = coord;
+    write.sample = sample;
+    write.texel = value;
+    // if the read fails the write will too, so there's nothing to undo
+    if(ShouldRecordExternalWrite(write) &&
+       apiWrapper->ReadTexel(imageBind, coord, sample, write.texel))
+      externalWrites.push_back(std::move(write));
+  }
+
+  return apiWrapper->WriteTexel(imageBind, coord, sample, value);
+}
+
+uint32_t Debugger::GetLaneLocalBatch() const
+{
+  if(Replay_Debug_SingleThreadedShaderDebugging())
+    return 0;
+
+  // only batch while the workgroup is uniform. Every lane would then step through the run in
+  // lockstep, so executing it ahead of time gives the same result as stepping it serially
+  if(convergeBlock != Id())
+    return 0;
+
+  const uint32_t next = workgroup[0].nextInstruction;
+  if(next >= decodedInstructions.size())
+    return 0;
+
+  for(const ThreadState &lane : workgroup)
+  {
+    if(lane.Finished() || lane.nextInstruction != next)
+      return 0;
+  }
+
+  // checkpoints must be saved with every lane at the same step
+  uint32_t batch = RDCMIN(decodedInstructions[next].laneLocalRun,
+                          checkpoints.StepsUntilSave(uint32_t(steps - 1)));
+
+  if(batch * (workgroup.size() - 1) < ParallelBatchThreshold)
+    return 0;
+
+  return batch;
+}
+
+void Debugger::StepActiveLane(const rdcarray<bool> &activeMask, rdcarray<ShaderDebugState> &ret)
+{
+  ThreadState &thread = workgroup[activeLaneIndex];
+
+  if(thread.nextInstruction >= instructionOffsets.size())
+  {
+    ret.emplace_back();
+    return;
+  }
+
+  ShaderDebugState state;
+
+  size_t instOffs = instructionOffsets[thread.nextInstruction];
+
+  // see if we're retiring any IDs at this state
+  for(size_t l = 0; l < thread.live.size();)
+  {
+    Id id = thread.live[l];
+    if(idLiveRange[id].second < instOffs)
+    {
+      thread.live.erase(l);
+      ShaderVariableChange change;
+      change.before = GetPointerValue(thread.ids[id]);
+      state.changes.push_back(change);
+
+      continue;
+    }
+
+    l++;
+  }
+
+  uint32_t funcRet = ~0U;
+  size_t prevStackSize = thread.callstack.size();
+
+  if(!thread.callstack.empty())
+    funcRet = thread.callstack.back()->funcCallInstruction;
+
+  state.stepIndex = steps;
+  thread.StepNext(&state, workgroup, activeMask);
+
+  if(thread.callstack.size() > prevStackSize)
+    instOffs = instructionOffsets[GetInstructionForFunction(thread.callstack.back()->function)];
+
+  else if(thread.callstack.size() < prevStackSize && funcRet != ~0U)
+    instOffs = instructionOffsets[funcRet];
+
+  FillCallstack(thread, state);
+
+  if(m_DebugInfo.valid)
+  {
+    const DecodedInstruction &endInst = decodedInstructions[thread.nextInstruction - 1];
+
+    // append any inlined functions to the top of the stack
+    const InlineData *inlined = endInst.inlined;
+
+    size_t insertPoint = state.callstack.size();
+
+    // start with the current scope, it refers to the *inlined* function
+    if(inlined)
+    {
+      const ScopeData *scope = endInst.scope;
+      // find the function parent of the current scope
+      while(scope && scope->parent && scope->type == DebugScope::Block)
+        scope = scope->parent;
+
+      state.callstack.insert(insertPoint, scope->name);
+    }
+
+    // if this instruction has no scope, don't give it a callstack
+    if(endInst.scope == NULL)
+    {
+      state.callstack.clear();
+    }
+
+    // move to the next inline up on our inline stack. If we reach an actual function
+    // call, this parent will be NULL as there was no more inlining - the final scope will
+    // refer to the real function which is already on our stack
+    while(inlined && inlined->parent)
+    {
+      const ScopeData *scope = inlined->scope;
+      // find the function parent of the current scope
+      while(scope && scope->parent && scope->type == DebugScope::Block)
+        scope = scope->parent;
+
+      state.callstack.insert(insertPoint, scope->name);
+
+      inlined = inlined->parent;
+    }
+  }
+
+  ret.push_back(std::move(state));
+
+  steps++;
 }
 
 ShaderVariable Debugger::MakeTypedPointer(uint64_t value, const DataType &type) const
@@ -3245,7 +3693,7 @@ void Debugger::WriteThroughPointer(ShaderVariable &ptr, const ShaderVariable &va
     }
     baseAddress = ptr.GetPointer().pointer;
     pointerWriteCallback = [this, baseAddress](uint64_t offset, uint64_t size, const void *src) {
-      apiWrapper->WriteAddress(baseAddress + offset, size, src);
+      WriteAddress(baseAddress + offset, size, src);
     };
   }
   else
@@ -3269,7 +3717,7 @@ void Debugger::WriteThroughPointer(ShaderVariable &ptr, const ShaderVariable &va
         parentDecorations.matrixStride = varMatrixStride;
       }
       pointerWriteCallback = [this, bind](uint64_t offset, uint64_t size, const void *src) {
-        apiWrapper->WriteBufferValue(bind, offset, size, src);
+        WriteBufferValue(bind, offset, size, src);
       };
     }
   }
@@ -3746,6 +4194,230 @@ void Debugger::PostParse()
   }
 
   memberNames.clear();
+
+  DecodeInstructions();
+}
+
+void Debugger::DecodeInstructions()
+{
+  decodedInstructions.resize(instructionOffsets.size());
+  decodedOperands.clear();
+
+  // Function and Private variables are allocated per-lane, so accesses through pointers to them
+  // never touch another lane's data
+  auto lanePointer = [this](Id pointer) {
+    const DataType &type = dataTypes[idTypes[pointer]];
+    return type.type == DataType::PointerType &&
+           (type.pointerType.storage == StorageClass::Function ||
+            type.pointerType.storage == StorageClass::Private);
+  };
+
+  for(uint32_t i = 0; i < instructionOffsets.size(); i++)
+  {
+    Iter it(m_SPIRV, instructionOffsets[i]);
+    DecodedInstruction &inst = decodedInstructions[i];
+
+    OpDecoder opdata(it);
+    inst.op = opdata.op;
+    inst.result = opdata.result;
+    inst.resultType = opdata.resultType;
+
+    switch(inst.op)
+    {
+      case Op::Line:
+      case Op::NoLine:
+      case Op::Undef: inst.skip = true; break;
+      case Op::ExtInst:
+      case Op::ExtInstWithForwardRefsKHR:
+      {
+        if(IsDebugExtInstSet(Id::fromWord(it.word(3))))
+          inst.skip = ShaderDbg(it.word(4)) != ShaderDbg::Value || !InDebugScope(i);
+        break;
+      }
+      case Op::SelectionMerge:
+      {
+        inst.skip = true;
+        inst.target = OpSelectionMerge(it).mergeBlock;
+        break;
+      }
+      case Op::LoopMerge:
+      {
+        inst.skip = true;
+        inst.target = OpLoopMerge(it).mergeBlock;
+        break;
+      }
+      case Op::Branch:
+      {
+        inst.target = OpBranch(it).targetLabel;
+
+        Iter next = it;
+        next++;
+
+        while(next.opcode() == Op::Line || next.opcode() == Op::NoLine)
+          next++;
+
+        inst.fallthroughBranch =
+            next.opcode() == Op::Label && OpLabel(next).result == inst.target;
+        break;
+      }
+      case Op::AccessChain:
+      case Op::InBoundsAccessChain:
+      {
+        OpAccessChain chain(it);
+
+        inst.base = chain.base;
+        inst.firstOperand = decodedOperands.count();
+        inst.numOperands = chain.indexes.count();
+        decodedOperands.append(chain.indexes);
+        break;
+      }
+      case Op::PtrAccessChain:
+      case Op::InBoundsPtrAccessChain:
+      {
+        OpPtrAccessChain chain(it);
+
+        inst.base = chain.base;
+        inst.element = chain.element;
+        inst.firstOperand = decodedOperands.count();
+        inst.numOperands = chain.indexes.count();
+        decodedOperands.append(chain.indexes);
+        break;
+      }
+      default: break;
+    }
+
+    switch(inst.op)
+    {
+      case Op::Load: inst.laneLocal = lanePointer(OpLoad(it).pointer); break;
+      case Op::Store: inst.laneLocal = lanePointer(OpStore(it).pointer); break;
+      case Op::CopyMemory:
+      {
+        OpCopyMemory copy(it);
+        inst.laneLocal = lanePointer(copy.target) && lanePointer(copy.source);
+        break;
+      }
+      case Op::AccessChain:
+      case Op::InBoundsAccessChain: inst.laneLocal = lanePointer(inst.base); break;
+      case Op::Bitcast:
+      {
+        // casts to pointers create physical pointers, which need the API wrapper
+        inst.laneLocal = dataTypes[inst.resultType].type != DataType::PointerType;
+        break;
+      }
+      case Op::CompositeExtract:
+      case Op::CompositeInsert:
+      case Op::CompositeConstruct:
+      case Op::VectorShuffle:
+      case Op::VectorExtractDynamic:
+      case Op::VectorInsertDynamic:
+      case Op::CopyObject:
+      case Op::CopyLogical:
+      case Op::Select:
+      case Op::Phi:
+      case Op::ConvertFToS:
+      case Op::ConvertFToU:
+      case Op::ConvertSToF:
+      case Op::ConvertUToF:
+      case Op::QuantizeToF16:
+      case Op::UConvert:
+      case Op::SConvert:
+      case Op::FConvert:
+      case Op::LogicalEqual:
+      case Op::LogicalNotEqual:
+      case Op::LogicalOr:
+      case Op::LogicalAnd:
+      case Op::LogicalNot:
+      case Op::IEqual:
+      case Op::INotEqual:
+      case Op::UGreaterThan:
+      case Op::UGreaterThanEqual:
+      case Op::ULessThan:
+      case Op::ULessThanEqual:
+      case Op::SGreaterThan:
+      case Op::SGreaterThanEqual:
+      case Op::SLessThan:
+      case Op::SLessThanEqual:
+      case Op::FOrdEqual:
+      case Op::FOrdNotEqual:
+      case Op::FOrdGreaterThan:
+      case Op::FOrdGreaterThanEqual:
+      case Op::FOrdLessThan:
+      case Op::FOrdLessThanEqual:
+      case Op::FUnordEqual:
+      case Op::FUnordNotEqual:
+      case Op::FUnordGreaterThan:
+      case Op::FUnordGreaterThanEqual:
+      case Op::FUnordLessThan:
+      case Op::FUnordLessThanEqual:
+      case Op::Any:
+      case Op::All:
+      case Op::IsNan:
+      case Op::IsInf:
+      case Op::BitCount:
+      case Op::BitReverse:
+      case Op::BitFieldUExtract:
+      case Op::BitFieldSExtract:
+      case Op::BitFieldInsert:
+      case Op::BitwiseOr:
+      case Op::BitwiseAnd:
+      case Op::BitwiseXor:
+      case Op::ShiftLeftLogical:
+      case Op::ShiftRightArithmetic:
+      case Op::ShiftRightLogical:
+      case Op::Not:
+      case Op::FMul:
+      case Op::FDiv:
+      case Op::FMod:
+      case Op::FRem:
+      case Op::FAdd:
+      case Op::FSub:
+      case Op::IMul:
+      case Op::SDiv:
+      case Op::UDiv:
+      case Op::UMod:
+      case Op::SMod:
+      case Op::SRem:
+      case Op::IAdd:
+      case Op::ISub:
+      case Op::UMulExtended:
+      case Op::SMulExtended:
+      case Op::IAddCarry:
+      case Op::ISubBorrow:
+      case Op::FNegate:
+      case Op::SNegate:
+      case Op::Dot:
+      case Op::VectorTimesScalar:
+      case Op::MatrixTimesScalar:
+      case Op::VectorTimesMatrix:
+      case Op::Transpose:
+      case Op::MatrixTimesVector:
+      case Op::MatrixTimesMatrix:
+      case Op::OuterProduct: inst.laneLocal = true; break;
+      default: break;
+    }
+
+    if(m_DebugInfo.valid)
+    {
+      inst.scope = GetScope(instructionOffsets[i]);
+
+      auto inl = m_DebugInfo.lineInline.find(instructionOffsets[i]);
+      if(inl != m_DebugInfo.lineInline.end())
+        inst.inlined = inl->second;
+    }
+  }
+
+  // lane-local instructions never branch, so a run of them is executed in order
+  for(uint32_t i = (uint32_t)decodedInstructions.size(); i-- > 0;)
+  {
+    DecodedInstruction &inst = decodedInstructions[i];
+    uint32_t nextRun =
+        i + 1 < decodedInstructions.size() ? decodedInstructions[i + 1].laneLocalRun : 0;
+
+    if(inst.skip)
+      inst.laneLocalRun = nextRun;
+    else if(inst.laneLocal)
+      inst.laneLocalRun = nextRun + 1;
+  }
 }
 
 void Debugger::RegisterOp(Iter it)
@@ -4330,6 +5002,9 @@ void Debugger::RegisterOp(Iter it)
 #if ENABLED(ENABLE_UNIT_TESTS)
 
 #include "catch/catch.hpp"
+#include "common/timing.h"
+#include "core/core.h"
+#include "glslang_compile.h"
 
 TEST_CASE("Check SPIRV Id naming", "[tostr]")
 {
@@ -4357,4 +5032,902 @@ TEST_CASE("Check SPIRV Id naming", "[tostr]")
   };
 }
 
+TEST_CASE("Check SPIR-V debugger instruction decoding", "[spirv]")
+{
+  rdcspv::Init();
+  RenderDoc::Inst().RegisterShutdownFunction(&rdcspv::Shutdown);
+
+  rdcstr source = R"(
+#version 450 core
+
+layout(binding = 0, std430) buffer buf
+{
+  vec4 data[];
+};
+
+struct S
+{
+  vec4 a[4];
+  float b;
+};
+
+layout(local_size_x = 64) in;
+
+void main()
+{
+  S s;
+  for(int i = 0; i < 4; i++)
+    s.a[i] = data[gl_GlobalInvocationID.x * 4 + i];
+  s.b = 0.0f;
+
+  if(s.a[1].x > 0.5f)
+    s.b = s.a[2].y;
+
+  data[gl_GlobalInvocationID.x].w = s.b;
+}
+)";
+
+  rdcarray<uint32_t> spirv;
+  rdcspv::CompilationSettings settings(rdcspv::InputLanguage::VulkanGLSL,
+                                       rdcspv::ShaderStage::Compute);
+  settings.debugInfo = true;
+  rdcstr errors = rdcspv::Compile(settings, {source}, spirv);
+
+  INFO("SPIR-V compile output: " << errors);
+
+  REQUIRE(!spirv.empty());
+
+  rdcspv::Debugger debugger;
+  debugger.Parse(spirv);
+
+  uint32_t numChains = 0, numMerges = 0, numBranches = 0;
+
+  for(uint32_t i = 0; i < debugger.GetNumInstructions(); i++)
+  {
+    rdcspv::Iter it = debugger.GetIterForInstruction(i);
+    rdcspv::OpDecoder opdata(it);
+    const rdcspv::DecodedInstruction &inst = debugger.GetDecodedInstruction(i);
+
+    CHECK(inst.op == opdata.op);
+    CHECK(inst.result == opdata.result);
+    CHECK(inst.resultType == opdata.resultType);
+
+    if(opdata.op == rdcspv::Op::Line || opdata.op == rdcspv::Op::NoLine)
+    {
+      CHECK(inst.skip);
+    }
+    else if(opdata.op == rdcspv::Op::SelectionMerge)
+    {
+      CHECK(inst.skip);
+      CHECK(inst.target == rdcspv::OpSelectionMerge(it).mergeBlock);
+      numMerges++;
+    }
+    else if(opdata.op == rdcspv::Op::LoopMerge)
+    {
+      CHECK(inst.skip);
+      CHECK(inst.target == rdcspv::OpLoopMerge(it).mergeBlock);
+      numMerges++;
+    }
+    else if(opdata.op == rdcspv::Op::Branch)
+    {
+      CHECK(inst.target == rdcspv::OpBranch(it).targetLabel);
+      CHECK(inst.fallthroughBranch ==
+            (debugger.GetInstructionForLabel(inst.target) == i + 1 ||
+             (debugger.GetDecodedInstruction(i + 1).op == rdcspv::Op::Line &&
+              debugger.GetInstructionForLabel(inst.target) == i + 2)));
+      numBranches++;
+    }
+    else if(opdata.op == rdcspv::Op::AccessChain || opdata.op == rdcspv::Op::InBoundsAccessChain)
+    {
+      rdcspv::OpAccessChain chain(it);
+
+      CHECK(inst.base == chain.base);
+      REQUIRE(inst.numOperands == chain.indexes.size());
+      const rdcspv::Id *operands = debugger.GetDecodedOperands(inst);
+      for(uint32_t o = 0; o < inst.numOperands; o++)
+        CHECK(operands[o] == chain.indexes[o]);
+      numChains++;
+    }
+    else
+    {
+      CHECK(!inst.skip);
+    }
+  }
+
+  CHECK(numChains > 0);
+  CHECK(numMerges >= 2);
+  CHECK(numBranches > 0);
+}
+
+TEST_CASE("Check SPIR-V debugger lane-local instructions", "[spirv]")
+{
+  rdcspv::Init();
+  RenderDoc::Inst().RegisterShutdownFunction(&rdcspv::Shutdown);
+
+  rdcstr source = R"(
+#version 450 core
+
+layout(binding = 0, std430) buffer buf
+{
+  vec4 data[];
+};
+
+shared vec4 tile[64];
+
+layout(local_size_x = 64) in;
+
+void main()
+{
+  vec4 v = data[gl_LocalInvocationIndex];
+  v = v * 2.0f + vec4(1.0f);
+  tile[gl_LocalInvocationIndex] = v;
+  barrier();
+  data[gl_LocalInvocationIndex] = tile[63 - gl_LocalInvocationIndex] + v;
+}
+)";
+
+  rdcarray<uint32_t> spirv;
+  rdcspv::CompilationSettings settings(rdcspv::InputLanguage::VulkanGLSL,
+                                       rdcspv::ShaderStage::Compute);
+  rdcstr errors = rdcspv::Compile(settings, {source}, spirv);
+
+  INFO("SPIR-V compile output: " << errors);
+
+  REQUIRE(!spirv.empty());
+
+  rdcspv::Debugger debugger;
+  debugger.Parse(spirv);
+
+  uint32_t numLocal = 0, numStores = 0, numLocalStores = 0;
+
+  for(uint32_t i = 0; i < debugger.GetNumInstructions(); i++)
+  {
+    const rdcspv::DecodedInstruction &inst = debugger.GetDecodedInstruction(i);
+
+    switch(inst.op)
+    {
+      case rdcspv::Op::FMul:
+      case rdcspv::Op::FAdd:
+      case rdcspv::Op::ISub:
+        CHECK(inst.laneLocal);
+        numLocal++;
+        break;
+      // stores to v are lane-local, but not those to the buffer and shared memory
+      case rdcspv::Op::Store:
+        if(inst.laneLocal)
+          numLocalStores++;
+        else
+          numStores++;
+        break;
+      case rdcspv::Op::ControlBarrier:
+      case rdcspv::Op::Return:
+      case rdcspv::Op::Label: CHECK(!inst.laneLocal); break;
+      default: break;
+    }
+  }
+
+  CHECK(numLocal >= 3);
+  CHECK(numStores == 2);
+  CHECK(numLocalStores >= 1);
+
+  // each lane-local instruction starts a run continuing through the following lane-local ones
+  uint32_t longestRun = 0;
+  for(uint32_t i = 0; i < debugger.GetNumInstructions(); i++)
+  {
+    const rdcspv::DecodedInstruction &inst = debugger.GetDecodedInstruction(i);
+
+    if(inst.skip)
+      continue;
+
+    if(!inst.laneLocal)
+    {
+      CHECK(inst.laneLocalRun == 0);
+      continue;
+    }
+
+    uint32_t next = i + 1;
+    while(next < debugger.GetNumInstructions() && debugger.GetDecodedInstruction(next).skip)
+      next++;
+
+    uint32_t nextRun = 0;
+    if(next < debugger.GetNumInstructions())
+      nextRun = debugger.GetDecodedInstruction(next).laneLocalRun;
+
+    CHECK(inst.laneLocalRun == nextRun + 1);
+    longestRun = RDCMAX(longestRun, inst.laneLocalRun);
+  }
+
+  CHECK(longestRun >= 3);
+}
+
+TEST_CASE("Check SPIR-V debugger lane register file", "[spirv]")
+{
+  rdcspv::LaneRegisterFile file;
+  file.Init(16, 64);
+
+  rdcspv::Id constant = rdcspv::Id::fromWord(3);
+  rdcspv::Id value = rdcspv::Id::fromWord(7);
+  rdcspv::Id late = rdcspv::Id::fromWord(9);
+
+  CHECK(file.GetName(value) == "_7");
+
+  file.SetShared(constant, ShaderVariable("", 1.0f, 2.0f, 3.0f, 4.0f));
+  file.AllocateLanes(value);
+
+  CHECK(!file.HasLanes(constant));
+  CHECK(file.HasLanes(value));
+  CHECK(!file.HasLanes(late));
+
+  rdcspv::LaneRegisters lanes[64];
+  for(uint32_t l = 0; l < 64; l++)
+  {
+    lanes[l].file = &file;
+    lanes[l].lane = l;
+    lanes[l].Mutable(value) = ShaderVariable("", l, 0U, 0U, 0U);
+  }
+
+  for(uint32_t l = 0; l < 64; l++)
+  {
+    CHECK(lanes[l][constant].name == "_3");
+    CHECK(lanes[l][constant].value.f32v[2] == 3.0f);
+    CHECK(lanes[l][value].value.u32v[0] == l);
+  }
+
+  // lanes allocated later start from the shared value
+  file.SetShared(late, ShaderVariable("", 3U, 0U, 0U, 0U));
+  file.AllocateLanes(late);
+  lanes[5].Mutable(late).value.u32v[0] = 5;
+
+  CHECK(file.HasLanes(late));
+  CHECK(lanes[5][late].value.u32v[0] == 5);
+  CHECK(lanes[6][late].value.u32v[0] == 3);
+
+  // restoring puts lanes back, and lanes allocated since go back to the shared value
+  rdcspv::LaneRegisterFile::Snapshot snapshot;
+  file.Save(snapshot);
+
+  lanes[5].Mutable(value).value.u32v[0] = 99;
+  file.AllocateLanes(rdcspv::Id::fromWord(11));
+  lanes[5].Mutable(rdcspv::Id::fromWord(11)).value.u32v[0] = 11;
+
+  file.Restore(snapshot);
+
+  CHECK(lanes[5][value].value.u32v[0] == 5);
+  CHECK(lanes[5][late].value.u32v[0] == 5);
+  CHECK(lanes[5][rdcspv::Id::fromWord(11)].value.u32v[0] == 0);
+}
+
+TEST_CASE("Check shader debugger checkpoint thinning", "[spirv]")
+{
+  DebugCheckpoints<uint32_t> checkpoints;
+  checkpoints.Init(10, 4);
+
+  for(uint32_t step = 0; step <= 200; step++)
+  {
+    if(checkpoints.ShouldSave(step))
+      checkpoints.Add(step) = step;
+  }
+
+  // the interval doubles each time the limit is exceeded, so the count stays bounded
+  CHECK(checkpoints.Count() <= 4);
+  CHECK(checkpoints.Interval() == 80);
+
+  uint32_t found = ~0U;
+  const uint32_t *cp = checkpoints.FindNearest(0, found);
+  REQUIRE(cp);
+  CHECK(found == 0);
+  CHECK(*cp == 0);
+
+  cp = checkpoints.FindNearest(175, found);
+  REQUIRE(cp);
+  CHECK(found == 160);
+  CHECK(*cp == 160);
+
+  // steps are never saved twice, even when re-executing past them
+  CHECK(!checkpoints.ShouldSave(80));
+  CHECK(!checkpoints.ShouldSave(160));
+  CHECK(checkpoints.ShouldSave(240));
+}
+
+// sets a config value for the rest of a test, and restores it even if the test fails early
+struct ScopedConfigValue
+{
+  ScopedConfigValue(const rdcstr &name) : obj(RenderDoc::Inst().SetConfigSetting(name))
+  {
+    if(obj)
+      prev = obj->data.basic;
+  }
+  ~ScopedConfigValue()
+  {
+    if(obj)
+      obj->data.basic = prev;
+  }
+
+  SDObject *obj;
+  SDObjectPODData prev;
+};
+
+// runs compute shaders with a single SSBO and no other resources
+class BufferOnlyAPIWrapper : public rdcspv::DebugAPIWrapper
+{
+public:
+  BufferOnlyAPIWrapper(bytebuf &buf) : data(buf) {}
+  void AddDebugMessage(MessageCategory c, MessageSeverity sv, MessageSource src, rdcstr d) override
+  {
+  }
+  ResourceId GetShaderID() override { return ResourceId(); }
+  uint64_t GetBufferLength(ShaderBindIndex bind) override { return data.size(); }
+  void ReadBufferValue(ShaderBindIndex bind, uint64_t offset, uint64_t byteSize, void *dst) override
+  {
+    memcpy(dst, data.data() + offset, (size_t)byteSize);
+  }
+  void WriteBufferValue(ShaderBindIndex bind, uint64_t offset, uint64_t byteSize,
+                        const void *src) override
+  {
+    memcpy(data.data() + offset, src, (size_t)byteSize);
+  }
+  void ReadAddress(uint64_t address, uint64_t byteSize, void *dst) override {}
+  void WriteAddress(uint64_t address, uint64_t byteSize, const void *src) override {}
+  bool ReadTexel(ShaderBindIndex imageBind, const ShaderVariable &coord, uint32_t sample,
+                 ShaderVariable &output) override
+  {
+    return false;
+  }
+  bool WriteTexel(ShaderBindIndex imageBind, const ShaderVariable &coord, uint32_t sample,
+                  const ShaderVariable &value) override
+  {
+    return false;
+  }
+  void FillInputValue(ShaderVariable &var, ShaderBuiltin builtin, uint32_t threadIndex,
+                      uint32_t location, uint32_t component) override
+  {
+    // a single workgroup, laid out along X
+    if(builtin == ShaderBuiltin::GroupFlatIndex || builtin == ShaderBuiltin::GroupThreadIndex ||
+       builtin == ShaderBuiltin::DispatchThreadIndex)
+      var.value.u32v[0] = threadIndex;
+  }
+  uint32_t GetThreadProperty(uint32_t threadIndex, rdcspv::ThreadProperty prop) override
+  {
+    return prop == rdcspv::ThreadProperty::Active ? 1 : 0;
+  }
+  bool CalculateSampleGather(rdcspv::ThreadState &lane, rdcspv::Op opcode, TextureType texType,
+                             ShaderBindIndex imageBind, ShaderBindIndex samplerBind,
+                             const ShaderVariable &uv, const ShaderVariable &ddxCalc,
+                             const ShaderVariable &ddyCalc, const ShaderVariable &compare,
+                             rdcspv::GatherChannel gatherChannel,
+                             const rdcspv::ImageOperandsAndParamDatas &operands,
+                             ShaderVariable &output) override
+  {
+    return false;
+  }
+  bool CalculateMathOp(rdcspv::ThreadState &lane, rdcspv::GLSLstd450 op,
+                       const rdcarray<ShaderVariable> &params, ShaderVariable &output) override
+  {
+    return false;
+  }
+
+  bytebuf &data;
+};
+
+TEST_CASE("Check SPIR-V debugger seeking with checkpoints", "[spirv]")
+{
+  rdcspv::Init();
+  RenderDoc::Inst().RegisterShutdownFunction(&rdcspv::Shutdown);
+
+  rdcstr source = R"(
+#version 450 core
+
+layout(binding = 0, std430) buffer buf
+{
+  uint data[];
+};
+
+layout(local_size_x = 1) in;
+
+uint accumulate(uint a, uint b)
+{
+  uint ret = a * 3u;
+  return ret + b;
+}
+
+void main()
+{
+  uint sum = 1u;
+  for(uint i = 0u; i < 24u; i++)
+  {
+    sum = accumulate(sum, i);
+    data[i] = sum;
+  }
+}
+)";
+
+  rdcarray<uint32_t> spirv;
+  rdcspv::CompilationSettings settings(rdcspv::InputLanguage::VulkanGLSL,
+                                       rdcspv::ShaderStage::Compute);
+  rdcstr errors = rdcspv::Compile(settings, {source}, spirv);
+
+  INFO("SPIR-V compile output: " << errors);
+
+  REQUIRE(!spirv.empty());
+
+  // restored however the test exits, so a failure doesn't change the settings for later tests
+  ScopedConfigValue interval("Replay_Debug_ShaderCheckpointInterval");
+  ScopedConfigValue maxCheckpoints("Replay_Debug_ShaderMaxCheckpoints");
+  REQUIRE(interval.obj);
+  REQUIRE(maxCheckpoints.obj);
+
+  // use a small limit so the checkpoints are thinned while running
+  interval.obj->data.basic.u = 8;
+  maxCheckpoints.obj->data.basic.u = 4;
+
+  rdcspv::Reflector reflector;
+  reflector.Parse(spirv);
+
+  ShaderReflection refl;
+  SPIRVPatchData patchData;
+  reflector.MakeReflection(GraphicsAPI::Vulkan, ShaderStage::Compute, "main", {}, refl, patchData);
+
+  bytebuf data;
+  data.resize(24 * sizeof(uint32_t));
+
+  rdcspv::Debugger debugger;
+  debugger.Parse(spirv);
+  ShaderDebugTrace *trace =
+      debugger.BeginDebug(new BufferOnlyAPIWrapper(data), ShaderStage::Compute, "main", {}, {},
+                          patchData, 0, 1, 1);
+
+  rdcarray<ShaderDebugState> states;
+  for(rdcarray<ShaderDebugState> chunk = debugger.ContinueDebug(); !chunk.empty();
+      chunk = debugger.ContinueDebug())
+    states.append(chunk);
+
+  // a second run of the same shader, to mix seeking with a trace that is only partly returned
+  bytebuf partialData;
+  partialData.resize(data.size());
+
+  rdcspv::Debugger partial;
+  partial.Parse(spirv);
+  ShaderDebugTrace *partialTrace =
+      partial.BeginDebug(new BufferOnlyAPIWrapper(partialData), ShaderStage::Compute, "main", {},
+                         {}, patchData, 0, 1, 1);
+
+  REQUIRE(states.size() > 100);
+
+  const bytebuf finalData = data;
+  CHECK(((uint32_t *)finalData.data())[23] != 0);
+
+  // accumulate the variables a client would have after applying each state in turn
+  auto accumulate = [&states](uint32_t stepIndex) {
+    std::map<rdcstr, ShaderVariable> vars;
+    for(uint32_t s = 0; s <= stepIndex; s++)
+    {
+      for(const ShaderVariableChange &c : states[s].changes)
+      {
+        if(c.after.name.empty())
+          vars.erase(c.before.name);
+        else
+          vars[c.after.name] = c.after;
+      }
+    }
+    return vars;
+  };
+
+  auto checkSeek = [&](uint32_t stepIndex) {
+    INFO("Seeking to step " << stepIndex);
+
+    ShaderDebugState seek = debugger.SeekDebug(stepIndex);
+
+    CHECK(seek.stepIndex == stepIndex);
+    CHECK(seek.nextInstruction == states[stepIndex].nextInstruction);
+    CHECK(seek.callstack == states[stepIndex].callstack);
+
+    std::map<rdcstr, ShaderVariable> vars = accumulate(stepIndex);
+
+    for(const ShaderVariableChange &c : seek.changes)
+    {
+      INFO("Variable " << c.after.name.c_str());
+      CHECK(c.before.name.empty());
+      auto it = vars.find(c.after.name);
+      REQUIRE((it != vars.end()));
+      CHECK((it->second == c.after));
+    }
+  };
+
+  SECTION("Seeking backwards and forwards")
+  {
+    uint32_t last = uint32_t(states.size() - 1);
+
+    checkSeek(last / 2);
+    checkSeek(3);
+    checkSeek(last);
+    checkSeek(0);
+    checkSeek(last - 1);
+    checkSeek(17);
+    checkSeek(18);
+
+    // seeking past the end clamps to the last step
+    ShaderDebugState end = debugger.SeekDebug(last + 100);
+    CHECK(end.stepIndex == last);
+  };
+
+  auto continueAll = [](rdcspv::Debugger &d, rdcarray<ShaderDebugState> &ret) {
+    for(rdcarray<ShaderDebugState> chunk = d.ContinueDebug(); !chunk.empty();
+        chunk = d.ContinueDebug())
+      ret.append(chunk);
+  };
+
+  auto checkMatchesTrace = [&states](const rdcarray<ShaderDebugState> &rerun) {
+    REQUIRE(rerun.size() == states.size());
+    for(size_t i = 0; i < rerun.size(); i++)
+    {
+      const ShaderDebugState &a = rerun[i];
+      const ShaderDebugState &b = states[i];
+      INFO("Step " << b.stepIndex);
+      CHECK(a.stepIndex == b.stepIndex);
+      CHECK(a.nextInstruction == b.nextInstruction);
+      CHECK((a.changes == b.changes));
+    }
+  };
+
+  SECTION("Continuing after a seek carries on from the last state returned")
+  {
+    rdcarray<ShaderDebugState> rerun = partial.ContinueDebug();
+    REQUIRE(rerun.size() > 40);
+    REQUIRE(rerun.size() + 30 < states.size());
+
+    // neither seeking back nor past the returned states changes what is returned next
+    partial.SeekDebug(20);
+    partial.SeekDebug(uint32_t(rerun.size() + 30));
+
+    continueAll(partial, rerun);
+
+    checkMatchesTrace(rerun);
+    CHECK(partialData == finalData);
+
+    // once everything is returned, seeking doesn't return any of it again
+    debugger.SeekDebug(40);
+    CHECK(debugger.ContinueDebug().empty());
+    CHECK(data == finalData);
+  };
+
+  SECTION("Seeking before continuing returns the whole trace")
+  {
+    partial.SeekDebug(40);
+
+    rdcarray<ShaderDebugState> rerun;
+    continueAll(partial, rerun);
+
+    checkMatchesTrace(rerun);
+    CHECK(partialData == finalData);
+  };
+
+  SECTION("Buffer writes are undone when seeking backwards")
+  {
+    debugger.SeekDebug(0);
+
+    for(size_t i = 0; i < data.size(); i++)
+      CHECK(data[i] == 0);
+  };
+
+  delete partialTrace;
+  delete trace;
+}
+
+TEST_CASE("Check SPIR-V debugger batched lanes match stepping serially", "[spirv]")
+{
+  rdcspv::Init();
+  RenderDoc::Inst().RegisterShutdownFunction(&rdcspv::Shutdown);
+
+  // long runs of lane-local instructions between branches, with shared memory so that lanes read
+  // values computed by the others. Each lane reads the debugged lane's value straight after the
+  // run, so it would be wrong if the run left lanes out of step
+  rdcstr source = R"(
+#version 450 core
+
+layout(binding = 0, std430) buffer buf
+{
+  uint data[];
+};
+
+shared uint values[128];
+
+layout(local_size_x = 128) in;
+
+uint hashMix(uint h, uint v)
+{
+  h ^= v * 0xcc9e2d51u;
+  h = (h << 15u) | (h >> 17u);
+  h *= 0x1b873593u;
+  return h + (h >> 7u) * 5u + 0xe6546b64u;
+}
+
+void main()
+{
+  uint idx = gl_LocalInvocationIndex;
+  uint h = idx * 2654435761u;
+  h ^= h >> 16u;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13u;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16u;
+  h = (h << 5u) | (h >> 27u);
+
+  values[idx] = h;
+  barrier();
+
+  uint sum = values[(idx + 1u) % 128u] + values[(idx + 51u) % 128u];
+  for(uint i = 0u; i < 4u; i++)
+    sum = hashMix(sum, i + idx);
+  if((idx % 3u) == 0u)
+  {
+    for(uint j = 0u; j < (idx % 7u); j++)
+      sum = hashMix(sum, j);
+  }
+  else
+  {
+    sum ^= values[(idx + 5u) % 128u] * 3u;
+  }
+
+  data[idx] = sum;
+}
+)";
+
+  rdcarray<uint32_t> spirv;
+  rdcspv::CompilationSettings settings(rdcspv::InputLanguage::VulkanGLSL,
+                                       rdcspv::ShaderStage::Compute);
+  rdcstr errors = rdcspv::Compile(settings, {source}, spirv);
+
+  INFO("SPIR-V compile output: " << errors);
+
+  REQUIRE(!spirv.empty());
+
+  rdcspv::Reflector reflector;
+  reflector.Parse(spirv);
+
+  ShaderReflection refl;
+  SPIRVPatchData patchData;
+  reflector.MakeReflection(GraphicsAPI::Vulkan, ShaderStage::Compute, "main", {}, refl, patchData);
+
+  const uint32_t numLanes = 128;
+
+  // make sure there are runs long enough to be batched across the workgroup
+  {
+    rdcspv::Debugger debugger;
+    debugger.Parse(spirv);
+
+    uint32_t longestRun = 0;
+    for(uint32_t i = 0; i < debugger.GetNumInstructions(); i++)
+      longestRun = RDCMAX(longestRun, debugger.GetDecodedInstruction(i).laneLocalRun);
+
+    REQUIRE(longestRun * (numLanes - 1) >= 512);
+  }
+
+  ScopedConfigValue singleThreaded("Replay_Debug_SingleThreadedShaderDebugging");
+  ScopedConfigValue interval("Replay_Debug_ShaderCheckpointInterval");
+  REQUIRE(singleThreaded.obj);
+  REQUIRE(interval.obj);
+
+  bool ownsJobSystem = Threading::JobSystem::TryInit();
+
+  struct DebugRun
+  {
+    rdcarray<ShaderDebugState> states;
+    bytebuf data;
+
+    // what every other lane executed, for profiling
+    rdcarray<rdcarray<uint32_t>> laneExecutions;
+
+    // when checkpoints are enabled, the states reached by seeking back and forth afterwards
+    rdcarray<ShaderDebugState> seeks;
+    bytebuf seekData;
+  };
+
+  auto debugWorkgroup = [&](bool serial, uint32_t activeLane, uint32_t checkpointInterval,
+                            DebugRun &run) {
+    singleThreaded.obj->data.basic.b = serial;
+    interval.obj->data.basic.u = checkpointInterval;
+
+    run.data.resize(numLanes * sizeof(uint32_t));
+
+    rdcspv::Debugger debugger;
+    debugger.Parse(spirv);
+    ShaderDebugTrace *trace =
+        debugger.BeginDebug(new BufferOnlyAPIWrapper(run.data), ShaderStage::Compute, "main", {},
+                            {}, patchData, activeLane, numLanes, 32);
+
+    for(rdcarray<ShaderDebugState> chunk = debugger.ContinueDebug(); !chunk.empty();
+        chunk = debugger.ContinueDebug())
+      run.states.append(chunk);
+
+    run.laneExecutions = debugger.GetLaneExecutions();
+
+    // going back re-executes from checkpoints, which must have every lane at the same step
+    if(checkpointInterval > 0)
+    {
+      for(uint32_t step = uint32_t(run.states.size() - 1); step-- > 0;)
+        run.seeks.push_back(debugger.SeekDebug(step));
+      run.seeks.push_back(debugger.SeekDebug(uint32_t(run.states.size() - 1)));
+      run.seekData = run.data;
+
+      // restoring a checkpoint loses the other lanes' counts
+      CHECK(debugger.GetLaneExecutions().empty());
+    }
+
+    delete trace;
+  };
+
+  // how many times each instruction ran in a lane's own trace
+  auto countExecutions = [](const rdcarray<ShaderDebugState> &states) {
+    rdcarray<uint32_t> ret;
+    for(size_t i = 1; i < states.size(); i++)
+    {
+      uint32_t inst = states[i - 1].nextInstruction;
+      if(inst >= ret.size())
+        ret.resize(inst + 1);
+      ret[inst]++;
+    }
+    return ret;
+  };
+
+  rdcarray<rdcarray<uint32_t>> lane0Executions;
+  rdcarray<uint32_t> lane77Executions;
+
+  for(uint32_t activeLane : {0U, 77U})
+  {
+    // checkpoints are never saved partway through a batch, so check batches are split correctly
+    for(uint32_t checkpointInterval : {0U, 5U})
+    {
+      INFO("Debugging lane " << activeLane << " with checkpoint interval " << checkpointInterval);
+
+      DebugRun serial, batched;
+      debugWorkgroup(true, activeLane, checkpointInterval, serial);
+      debugWorkgroup(false, activeLane, checkpointInterval, batched);
+
+      REQUIRE(serial.laneExecutions.size() == numLanes - 1);
+      CHECK(batched.laneExecutions == serial.laneExecutions);
+
+      if(activeLane == 0)
+        lane0Executions = serial.laneExecutions;
+      else
+        lane77Executions = countExecutions(serial.states);
+
+      REQUIRE(serial.states.size() > 100);
+      REQUIRE(batched.states.size() == serial.states.size());
+
+      for(size_t i = 0; i < serial.states.size(); i++)
+      {
+        const ShaderDebugState &a = batched.states[i];
+        const ShaderDebugState &b = serial.states[i];
+        INFO("Step " << b.stepIndex);
+        CHECK(a.stepIndex == b.stepIndex);
+        CHECK(a.nextInstruction == b.nextInstruction);
+        REQUIRE(a.changes.size() == b.changes.size());
+        for(size_t c = 0; c < a.changes.size(); c++)
+        {
+          INFO("Change " << c << " to " << b.changes[c].after.name.c_str());
+          CHECK((a.changes[c] == b.changes[c]));
+        }
+      }
+
+      // every lane's results are written out, not only the debugged lane's
+      CHECK(batched.data == serial.data);
+
+      REQUIRE(batched.seeks.size() == serial.seeks.size());
+      for(size_t i = 0; i < serial.seeks.size(); i++)
+      {
+        const ShaderDebugState &a = batched.seeks[i];
+        const ShaderDebugState &b = serial.seeks[i];
+        INFO("Seek to step " << b.stepIndex);
+        CHECK(a.stepIndex == b.stepIndex);
+        CHECK(a.nextInstruction == b.nextInstruction);
+        CHECK((a.changes == b.changes));
+      }
+
+      CHECK(batched.seekData == serial.seekData);
+    }
+  }
+
+  // the counts for a lane that wasn't debugged match debugging that lane. The trace stops at the
+  // last executed instruction, while the counts cover the whole array
+  {
+    rdcarray<uint32_t> counted = lane0Executions[76];
+    REQUIRE(counted.size() >= lane77Executions.size());
+    for(size_t i = lane77Executions.size(); i < counted.size(); i++)
+      CHECK(counted[i] == 0);
+    counted.resize(lane77Executions.size());
+    CHECK(counted == lane77Executions);
+  }
+
+  if(ownsJobSystem)
+    Threading::JobSystem::Shutdown();
+}
+
+TEST_CASE("Benchmark SPIR-V debugger stepping a workgroup", "[spirv][!benchmark]")
+{
+  rdcspv::Init();
+  RenderDoc::Inst().RegisterShutdownFunction(&rdcspv::Shutdown);
+
+  // mostly arithmetic, as in e.g. a compute shader filtering an image
+  rdcstr source = R"(
+#version 450 core
+
+layout(binding = 0, std430) buffer buf
+{
+  vec4 data[];
+};
+
+layout(local_size_x = 256) in;
+
+void main()
+{
+  uint idx = gl_LocalInvocationIndex;
+  vec4 acc = vec4(0.0f);
+  for(uint i = 0u; i < 16u; i++)
+  {
+    vec4 v = vec4(float(idx + i), float(idx * i), float(i), 1.0f);
+    v = v * 0.5f + vec4(0.25f);
+    acc += v * v.wzyx - vec4(dot(v, acc));
+    acc = clamp(acc, vec4(-100.0f), vec4(100.0f));
+  }
+  data[idx] = acc;
+}
+)";
+
+  rdcarray<uint32_t> spirv;
+  rdcspv::CompilationSettings settings(rdcspv::InputLanguage::VulkanGLSL,
+                                       rdcspv::ShaderStage::Compute);
+  rdcstr errors = rdcspv::Compile(settings, {source}, spirv);
+
+  INFO("SPIR-V compile output: " << errors);
+
+  REQUIRE(!spirv.empty());
+
+  rdcspv::Reflector reflector;
+  reflector.Parse(spirv);
+
+  ShaderReflection refl;
+  SPIRVPatchData patchData;
+  reflector.MakeReflection(GraphicsAPI::Vulkan, ShaderStage::Compute, "main", {}, refl, patchData);
+
+  ScopedConfigValue singleThreaded("Replay_Debug_SingleThreadedShaderDebugging");
+  REQUIRE(singleThreaded.obj);
+
+  bool ownsJobSystem = Threading::JobSystem::TryInit();
+
+  const uint32_t numLanes = 256;
+
+  for(bool serial : {true, false})
+  {
+    singleThreaded.obj->data.basic.b = serial;
+
+    bytebuf data;
+    data.resize(numLanes * 4 * sizeof(float));
+
+    PerformanceTimer timer;
+
+    rdcspv::Debugger debugger;
+    debugger.Parse(spirv);
+    ShaderDebugTrace *trace =
+        debugger.BeginDebug(new BufferOnlyAPIWrapper(data), ShaderStage::Compute, "main", {}, {},
+                            patchData, 0, numLanes, 32);
+
+    size_t numStates = 0;
+    for(rdcarray<ShaderDebugState> chunk = debugger.ContinueDebug(); !chunk.empty();
+        chunk = debugger.ContinueDebug())
+      numStates += chunk.size();
+
+    double elapsed = timer.GetMilliseconds();
+
+    delete trace;
+
+    CHECK(numStates > 100);
+
+    RDCLOG("Debugging a %u lane workgroup %s: %zu steps in %.2f ms", numLanes,
+           serial ? "serially" : "with batched lanes", numStates, elapsed);
+  }
+
+  if(ownsJobSystem)
+    Threading::JobSystem::Shutdown();
+}
+
 #endif
@@ -1414,6 +1414,127 @@ void DescriptorSetSlot::AccumulateBindRefs(DescriptorBindRefs &refs, VulkanResou
   }
 }
 
+DescriptorSetSnapshot::DescriptorSetSnapshot(BindingStorage *source, uint32_t slotCount)
+    : m_SlotCount(slotCount), m_Source(source)
+{
+  m_Pages.resize((slotCount + SlotsPerPage - 1) / SlotsPerPage);
+}
+
+DescriptorSetSnapshot::~DescriptorSetSnapshot()
+{
+  for(DescriptorSetSlot *page : m_Pages)
+    delete[] page;
+}
+
+void DescriptorSetSnapshot::Release()
+{
+  if(Atomic::Dec32(&m_RefCount) == 0)
+    delete this;
+}
+
+uint32_t DescriptorSetSnapshot::copiedPageCount()
+{
+  SCOPED_SPINLOCK(m_Lock);
+
+  uint32_t ret = 0;
+  for(DescriptorSetSlot *page : m_Pages)
+    ret += page ? 1 : 0;
+  return ret;
+}
+
+void DescriptorSetSnapshot::CopyPage(uint32_t page)
+{
+  uint32_t first = page * SlotsPerPage;
+  uint32_t count = RDCMIN(uint32_t(SlotsPerPage), m_SlotCount - first);
+
+  m_Pages[page] = new DescriptorSetSlot[count];
+  memcpy(m_Pages[page], m_Source->elems.data() + first, sizeof(DescriptorSetSlot) * count);
+}
+
+void DescriptorSetSnapshot::Detach()
+{
+  if(!m_Source)
+    return;
+
+  for(uint32_t p = 0; p < m_Pages.size(); p++)
+    if(!m_Pages[p])
+      CopyPage(p);
+
+  m_Source = NULL;
+}
+
+void DescriptorSetSnapshot::Read(rdcarray<DescriptorSetSlot> &slots)
+{
+  slots.resize(m_SlotCount);
+
+  for(uint32_t p = 0; p < m_Pages.size(); p++)
+  {
+    uint32_t first = p * SlotsPerPage;
+    uint32_t count = RDCMIN(uint32_t(SlotsPerPage), m_SlotCount - first);
+
+    // only hold the lock per-page so the capturing thread isn't blocked on a large read
+    SCOPED_SPINLOCK(m_Lock);
+    const DescriptorSetSlot *src = m_Pages[p] ? m_Pages[p] : m_Source->elems.data() + first;
+    memcpy(slots.data() + first, src, sizeof(DescriptorSetSlot) * count);
+  }
+}
+
+DescriptorSetSnapshot *BindingStorage::snapshot(byte *&inlineData, size_t &inlineSize)
+{
+  SCOPED_SPINLOCK(m_SnapshotLock);
+
+  // any previous snapshot must stop sharing with us, as we only track one at a time
+  DetachSnapshotLocked();
+
+  m_Snapshot = new DescriptorSetSnapshot(this, elems.count());
+  // one reference is kept here until the snapshot is detached, the other is returned
+  m_Snapshot->AddRef();
+
+  inlineSize = inlineBytes.size();
+  inlineData = AllocAlignedBuffer(inlineSize);
+  memcpy(inlineData, inlineBytes.data(), inlineSize);
+
+  return m_Snapshot;
+}
+
+void BindingStorage::DetachSnapshotLocked()
+{
+  if(!m_Snapshot)
+    return;
+
+  // if we hold the only reference nobody can read the snapshot any more, so don't copy anything.
+  // Otherwise copy the remaining pages before the live storage changes underneath it. References
+  // are only handed out by snapshot() with the lock held, so the count can't go back up once it's
+  // reached 1. If it drops to 1 after we check, the copy is wasted but harmless
+  if(Atomic::CmpExch32(&m_Snapshot->m_RefCount, 1, 1) != 1)
+  {
+    SCOPED_SPINLOCK(m_Snapshot->m_Lock);
+    m_Snapshot->Detach();
+  }
+
+  m_Snapshot->Release();
+  m_Snapshot = NULL;
+}
+
+void BindingStorage::CopyOnWrite(const DescriptorSetSlot *slot)
+{
+  if(Atomic::CmpExch32(&m_Snapshot->m_RefCount, 1, 1) == 1)
+  {
+    DetachSnapshotLocked();
+    return;
+  }
+
+  uint32_t page = uint32_t(slot - elems.data()) / DescriptorSetSnapshot::SlotsPerPage;
+
+  // pages are only ever filled in with m_SnapshotLock held, so there's no need to take the
+  // snapshot's lock to check
+  if(m_Snapshot->m_Pages[page])
+    return;
+
+  SCOPED_SPINLOCK(m_Snapshot->m_Lock);
+  m_Snapshot->CopyPage(page);
+}
+
 void DynamicRenderingLocalRead::Init(const VkBaseInStructure *infoStruct)
 {
   const VkRenderingAttachmentLocationInfo *attachmentLocationInfo =
@@ -1767,4 +1888,201 @@ TEST_CASE("Validate CombineDepthStencilLayouts works", "[vulkan]")
   };
 }
 
+TEST_CASE("Test descriptor set snapshots", "[vulkan]")
+{
+  const uint32_t numSlots = DescriptorSetSnapshot::SlotsPerPage * 10 + 17;
+
+  DescSetLayout layout = {};
+  layout.bindings.resize(1);
+  layout.bindings[0].layoutDescType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  layout.bindings[0].descriptorCount = numSlots;
+  layout.totalElems = numSlots;
+  layout.inlineByteSize = 0;
+
+  BindingStorage storage;
+  layout.CreateBindingsArray(storage, 0);
+
+  DescriptorSetSlot *slots = storage.binds[0];
+  for(uint32_t i = 0; i < numSlots; i++)
+    slots[i].resource = ResourceIDGen::GetNewUniqueID();
+
+  rdcarray<DescriptorSetSlot> expected;
+  expected.assign(slots, numSlots);
+
+  auto write = [&](uint32_t idx) {
+    storage.PrepareWrite(&slots[idx]);
+    slots[idx].resource = ResourceId();
+  };
+
+  auto matches = [](const rdcarray<DescriptorSetSlot> &a, const rdcarray<DescriptorSetSlot> &b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.byteSize()) == 0;
+  };
+
+  byte *inlineData = NULL;
+  size_t inlineSize = 0;
+
+  DescriptorSetSnapshot *snap = storage.snapshot(inlineData, inlineSize);
+
+  CHECK(snap->slotCount() == numSlots);
+  CHECK(snap->copiedPageCount() == 0);
+
+  SECTION("Writes only copy the pages they touch")
+  {
+    write(0);
+    write(1);
+    write(numSlots - 1);
+
+    CHECK(snap->copiedPageCount() == 2);
+
+    write(DescriptorSetSnapshot::SlotsPerPage * 4 + 3);
+
+    CHECK(snap->copiedPageCount() == 3);
+
+    rdcarray<DescriptorSetSlot> read;
+    snap->Read(read);
+    CHECK(matches(read, expected));
+    CHECK(slots[0].resource == ResourceId());
+  };
+
+  SECTION("Resetting copies everything out first")
+  {
+    storage.reset();
+
+    CHECK(snap->copiedPageCount() == 11);
+
+    rdcarray<DescriptorSetSlot> read;
+    snap->Read(read);
+    CHECK(matches(read, expected));
+  };
+
+  SECTION("A new snapshot detaches the previous one")
+  {
+    write(5);
+
+    byte *inlineData2 = NULL;
+    DescriptorSetSnapshot *snap2 = storage.snapshot(inlineData2, inlineSize);
+
+    CHECK(snap->copiedPageCount() == 11);
+    CHECK(snap2->copiedPageCount() == 0);
+
+    write(6);
+
+    CHECK(snap2->copiedPageCount() == 1);
+
+    rdcarray<DescriptorSetSlot> read;
+    snap->Read(read);
+    CHECK(matches(read, expected));
+
+    expected[5].resource = ResourceId();
+    snap2->Read(read);
+    CHECK(matches(read, expected));
+
+    snap2->Release();
+    FreeAlignedBuffer(inlineData2);
+  };
+
+  SECTION("Released snapshots are dropped without copying")
+  {
+    snap->AddRef();
+    snap->Release();
+    snap->Release();
+    snap = NULL;
+
+    write(0);
+    write(numSlots - 1);
+  };
+
+  SAFE_RELEASE(snap);
+  FreeAlignedBuffer(inlineData);
+}
+
+TEST_CASE("Test descriptor set snapshots while the set is updated", "[vulkan]")
+{
+  const uint32_t numSlots = DescriptorSetSnapshot::SlotsPerPage * 10 + 17;
+  const uint32_t numPasses = 200;
+
+  DescSetLayout layout = {};
+  layout.bindings.resize(1);
+  layout.bindings[0].layoutDescType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  layout.bindings[0].descriptorCount = numSlots;
+  layout.totalElems = numSlots;
+  layout.inlineByteSize = 0;
+
+  BindingStorage storage;
+  layout.CreateBindingsArray(storage, 0);
+
+  DescriptorSetSlot *slots = storage.binds[0];
+
+  int32_t done = 0;
+
+  // the 'application' rewrites every slot in order with the number of the pass, so any snapshot
+  // must see a run of slots from one pass followed by a run from the pass before
+  Threading::ThreadHandle updater = Threading::CreateThread([&]() {
+    for(uint32_t pass = 1; pass <= numPasses; pass++)
+    {
+      for(uint32_t i = 0; i < numSlots; i++)
+      {
+        storage.PrepareWrite(&slots[i]);
+        slots[i].offset = pass;
+      }
+    }
+
+    Atomic::Inc32(&done);
+  });
+
+  uint32_t numSnapshots = 0;
+  bool consistent = true;
+
+  rdcarray<DescriptorSetSlot> read;
+
+  auto check = [&](DescriptorSetSnapshot *snap) {
+    snap->Read(read);
+    snap->Release();
+
+    for(uint32_t i = 1; i < numSlots; i++)
+    {
+      if(read[i].offset > read[i - 1].offset || read[i].offset + 1 < read[i - 1].offset)
+        consistent = false;
+    }
+
+    numSnapshots++;
+  };
+
+  DescriptorSetSnapshot *prev = NULL;
+
+  while(Atomic::CmpExch32(&done, 0, 0) == 0)
+  {
+    byte *inlineData = NULL;
+    size_t inlineSize = 0;
+
+    DescriptorSetSnapshot *snap = storage.snapshot(inlineData, inlineSize);
+    FreeAlignedBuffer(inlineData);
+
+    // every other snapshot is kept until the next one has been taken, so the updater writes to
+    // sets with both shared and unreferenced snapshots
+    if(prev)
+    {
+      check(prev);
+      check(snap);
+      prev = NULL;
+    }
+    else
+    {
+      prev = snap;
+    }
+  }
+
+  if(prev)
+    check(prev);
+
+  Threading::JoinThread(updater);
+  Threading::CloseThread(updater);
+
+  CHECK(numSnapshots > 0);
+  CHECK(consistent);
+
+  for(uint32_t i = 0; i < numSlots; i++)
+    CHECK(slots[i].offset == numPasses);
+}
+
 #endif
@@ -793,6 +793,50 @@ struct DescriptorSetSlot
   ResourceId sampler;
 };
 
+struct BindingStorage;
+
+// a copy-on-write snapshot of the slots in a BindingStorage. Taking the snapshot copies nothing -
+// the slots are split into fixed-size pages and each page is only copied out of the live storage
+// just before it's first written to, or when the storage is reset or reallocated. A snapshot of a
+// large bindless set then costs in proportion to how many descriptors change while it's alive.
+struct DescriptorSetSnapshot
+{
+  static const uint32_t SlotsPerPage = 256;
+
+  uint32_t slotCount() const { return m_SlotCount; }
+  // the number of pages that have been copied out of the live storage so far
+  uint32_t copiedPageCount();
+
+  // copies the snapshotted slots out into a contiguous array
+  void Read(rdcarray<DescriptorSetSlot> &slots);
+
+  void AddRef() { Atomic::Inc32(&m_RefCount); }
+  void Release();
+
+private:
+  friend struct BindingStorage;
+
+  DescriptorSetSnapshot(BindingStorage *source, uint32_t slotCount);
+  ~DescriptorSetSnapshot();
+
+  // both of these must be called with the lock held
+  void CopyPage(uint32_t page);
+  void Detach();
+
+  int32_t m_RefCount = 1;
+  uint32_t m_SlotCount = 0;
+
+  // held while copying pages out of the source or reading from it, so a reader doesn't see a page
+  // halfway through being modified
+  Threading::SpinLock m_Lock;
+
+  // the live storage, or NULL once every page has been copied
+  BindingStorage *m_Source = NULL;
+
+  // a copy of each page, or NULL if it's still unmodified in the source
+  rdcarray<DescriptorSetSlot *> m_Pages;
+};
+
 struct BindingStorage
 {
   BindingStorage() = default;
@@ -809,6 +853,7 @@ struct BindingStorage
 
   void clear()
   {
+    DetachSnapshot();
     inlineBytes.clear();
     binds.clear();
     elems.clear();
@@ -817,25 +862,43 @@ struct BindingStorage
 
   void reset()
   {
+    DetachSnapshot();
     memset(inlineBytes.data(), 0, inlineBytes.size());
     memset(elems.data(), 0, elems.byteSize());
   }
 
-  void copy(DescriptorSetSlot *&slots, uint32_t &slotCount, byte *&inlineData, size_t &inlineSize)
-  {
-    slotCount = elems.count();
+  // takes a snapshot of the current slots, returning a reference the caller must release. The
+  // inline data is small so it's copied immediately.
+  DescriptorSetSnapshot *snapshot(byte *&inlineData, size_t &inlineSize);
 
-    slots = new DescriptorSetSlot[slotCount];
-    memcpy(slots, elems.data(), sizeof(DescriptorSetSlot) * slotCount);
+  // must be called before modifying any slot in place, so that a snapshot can preserve its contents
+  void PrepareWrite(const DescriptorSetSlot *slot)
+  {
+    SCOPED_SPINLOCK(m_SnapshotLock);
+    if(m_Snapshot)
+      CopyOnWrite(slot);
+  }
 
-    inlineSize = inlineBytes.size();
-    inlineData = AllocAlignedBuffer(inlineSize);
-    memcpy(inlineData, inlineBytes.data(), inlineSize);
+  // copies anything still shared with the current snapshot, before the slots are reallocated
+  void DetachSnapshot()
+  {
+    SCOPED_SPINLOCK(m_SnapshotLock);
+    DetachSnapshotLocked();
   }
 
 private:
+  // both of these must be called with m_SnapshotLock held
+  void CopyOnWrite(const DescriptorSetSlot *slot);
+  void DetachSnapshotLocked();
+
   rdcarray<DescriptorSetSlot> elems;
+
+  // snapshots are taken on the capturing thread while the application updates the set, so the
+  // current snapshot is only accessed with this lock held
+  Threading::SpinLock m_SnapshotLock;
+  DescriptorSetSnapshot *m_Snapshot = NULL;
   friend struct DescSetLayout;
+  friend struct DescriptorSetSnapshot;
 };
 
 DECLARE_REFLECTION_STRUCT(DescriptorSetSlot);
@@ -2251,7 +2251,7 @@ void WrappedVulkan::EndCaptureFrame(VkImage presentImage)
 
   SERIALISE_ELEMENT_LOCAL(PresentedImage, GetResID(presentImage)).TypedAs("VkImage"_lit);
 
-  m_FrameCaptureRecord->AddChunk(scope.Get());
+  m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
 }
 
 void WrappedVulkan::FirstFrame()
@@ -2376,6 +2376,8 @@ void WrappedVulkan::StartFrameCapture(DeviceOwnedWindow devWnd)
 
     RDCDEBUG("Attempting capture");
     m_FrameCaptureRecord->DeleteChunks();
+    m_FrameChunkAllocators.Reset(false);
+    m_CoherentMapStats = {};
     {
       SCOPED_LOCK(m_ImageStatesLock);
       for(auto it = m_ImageStates.begin(); it != m_ImageStates.end(); ++it)
@@ -2519,6 +2521,8 @@ bool WrappedVulkan::EndFrameCapture(DeviceOwnedWindow devWnd)
       SCOPED_LOCK(m_CoherentMapsLock);
       for(auto it = m_CoherentMaps.begin(); it != m_CoherentMaps.end(); ++it)
       {
+        WriteWatch::Unwatch((*it)->memMapState->writeWatch);
+        (*it)->memMapState->writeWatch = NULL;
         FreeAlignedBuffer((*it)->memMapState->refData);
         (*it)->memMapState->refData = NULL;
         (*it)->memMapState->needRefData = false;
@@ -2845,6 +2849,27 @@ bool WrappedVulkan::EndFrameCapture(DeviceOwnedWindow devWnd)
 
       m_FrameCaptureRecord->DeleteChunks();
 
+      ThreadChunkAllocators::Stats allocStats = m_FrameChunkAllocators.GetStats();
+
+      RDCLOG(
+          "Frame chunks used %llu pages (%.2f MB) over %llu threads, %.2f MB allocated, %.2f MB "
+          "wasted, %llu oversized",
+          allocStats.pagesInUse, double(allocStats.bytesReserved) / (1024.0 * 1024.0),
+          allocStats.threads, double(allocStats.bytesAllocated) / (1024.0 * 1024.0),
+          double(allocStats.bytesWasted) / (1024.0 * 1024.0), allocStats.oversizedAllocs);
+
+      // release the frame's pages back to the system, they'll be allocated again if there's
+      // another capture
+      m_FrameChunkAllocators.Reset(true);
+
+      if(m_CoherentMapStats.checks > 0)
+        RDCLOG(
+            "Coherent maps checked %lld times, %.2f MB mapped, %.2f MB compared, %.2f MB "
+            "serialised",
+            m_CoherentMapStats.checks, double(m_CoherentMapStats.mappedBytes) / (1024.0 * 1024.0),
+            double(m_CoherentMapStats.scannedBytes) / (1024.0 * 1024.0),
+            double(m_CoherentMapStats.flushedBytes) / (1024.0 * 1024.0));
+
       RDCDEBUG("Done");
     }
 
@@ -2921,6 +2946,8 @@ bool WrappedVulkan::DiscardFrameCapture(DeviceOwnedWindow devWnd)
       SCOPED_LOCK(m_CoherentMapsLock);
       for(auto it = m_CoherentMaps.begin(); it != m_CoherentMaps.end(); ++it)
       {
+        WriteWatch::Unwatch((*it)->memMapState->writeWatch);
+        (*it)->memMapState->writeWatch = NULL;
         FreeAlignedBuffer((*it)->memMapState->refData);
         (*it)->memMapState->refData = NULL;
         (*it)->memMapState->needRefData = false;
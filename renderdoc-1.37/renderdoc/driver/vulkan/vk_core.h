@@ -340,6 +340,10 @@ private:
   Threading::CriticalSection m_ThreadSerialisersLock;
   rdcarray<WriteSerialiser *> m_ThreadSerialisers;
 
+  // chunks recorded into m_FrameCaptureRecord only live for the captured frame, so they're allocated
+  // from per-thread arenas that are reset in bulk when the frame's chunks are deleted.
+  ThreadChunkAllocators m_FrameChunkAllocators{256 * 1024};
+
   Threading::CriticalSection m_CallbacksLock;
   rdcarray<UserDebugReportCallbackData *> m_ReportCallbacks;
   rdcarray<UserDebugUtilsCallbackData *> m_UtilsCallbacks;
@@ -924,6 +928,16 @@ private:
   rdcarray<VkResourceRecord *> m_CoherentMaps;
   Threading::CriticalSection m_CoherentMapsLock;
 
+  // totals for the current frame capture of how much coherent mapped memory was checked for
+  // changes on submit. Updated atomically from concurrent submits and logged at the end of capture.
+  struct
+  {
+    int64_t checks = 0;
+    int64_t mappedBytes = 0;
+    int64_t scannedBytes = 0;
+    int64_t flushedBytes = 0;
+  } m_CoherentMapStats;
+
   rdcarray<VkResourceRecord *> m_ForcedReferences;
   Threading::CriticalSection m_ForcedReferencesLock;
 
@@ -1033,6 +1047,7 @@ private:
                                const VkIndirectRecordData &indirectcopy);
 
   WriteSerialiser &GetThreadSerialiser();
+  ChunkAllocator *GetFrameChunkAllocator() { return m_FrameChunkAllocators.Get(); }
   template <typename SerialiserType>
   bool Serialise_CaptureScope(SerialiserType &ser);
   bool HasSuccessfulCapture();
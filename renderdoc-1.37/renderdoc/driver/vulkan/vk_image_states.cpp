@@ -81,13 +81,12 @@ typename ImageSubresourceMap::SubresourceRangeIterTemplate<Map, Pair>
   }
   m_value.m_range.baseDepthSlice = m_slice = m_range.baseDepthSlice;
 
-  ++m_layer;
-  if(AreLayersSplit(m_splitFlags) && m_layer < m_range.baseArrayLayer + m_range.layerCount)
-  {
-    m_value.m_range.baseArrayLayer = m_layer;
+  // step to the start of the next layer interval. The layer range in m_value is filled in when the
+  // iterator is dereferenced, since the intervals can be split further while iterating.
+  m_layer = m_map->LayerSlotEnd(m_map->LayerSlot(m_layer));
+  if(m_layer < m_range.baseArrayLayer + m_range.layerCount)
     return *this;
-  }
-  m_value.m_range.baseArrayLayer = m_layer = m_range.baseArrayLayer;
+  m_layer = m_range.baseArrayLayer;
 
   ++m_level;
   if(AreLevelsSplit(m_splitFlags) && m_level < m_range.baseMipLevel + m_range.levelCount)
@@ -137,192 +136,197 @@ void ImageSubresourceMap::Split(bool splitAspects, bool splitLevels, bool splitL
   uint16_t newFlags = m_flags;
   if(splitAspects)
     newFlags |= (uint16_t)FlagBits::AreAspectsSplit;
-  else
-    splitAspects = AreAspectsSplit();
-
   if(splitLevels)
     newFlags |= (uint16_t)FlagBits::AreLevelsSplit;
-  else
-    splitLevels = AreLevelsSplit();
-
-  if(splitLayers)
-    newFlags |= (uint16_t)FlagBits::AreLayersSplit;
-  else
-    splitLayers = AreLayersSplit();
-
   if(splitDepth)
     newFlags |= (uint16_t)FlagBits::IsDepthSplit;
-  else
-    splitDepth = IsDepthSplit();
 
-  if(newFlags == m_flags)
+  rdcarray<uint32_t> newLayerStarts = m_layerStarts;
+  if(splitLayers && GetImageInfo().layerCount > 1 &&
+     LayerSlotCount() < (uint32_t)GetImageInfo().layerCount)
+  {
+    newFlags |= (uint16_t)FlagBits::AreLayersSplit;
+    newLayerStarts.resize(GetImageInfo().layerCount);
+    for(uint32_t layer = 0; layer < newLayerStarts.size(); layer++)
+      newLayerStarts[layer] = layer;
+  }
+
+  if(newFlags == m_flags && newLayerStarts.size() == m_layerStarts.size())
     // not splitting anything new
     return;
 
-  uint32_t oldSplitAspectCount = AreAspectsSplit() ? m_aspectCount : 1;
-  uint32_t newSplitAspectCount = splitAspects ? m_aspectCount : oldSplitAspectCount;
-
-  uint32_t oldSplitLevelCount = AreLevelsSplit() ? GetImageInfo().levelCount : 1;
-  uint32_t newSplitLevelCount = splitLevels ? GetImageInfo().levelCount : oldSplitLevelCount;
-
-  uint32_t oldSplitLayerCount = AreLayersSplit() ? GetImageInfo().layerCount : 1;
-  uint32_t newSplitLayerCount = splitLayers ? GetImageInfo().layerCount : oldSplitLayerCount;
+  Resplit(newFlags, newLayerStarts);
+}
 
-  uint32_t oldSplitSliceCount = IsDepthSplit() ? GetImageInfo().extent.depth : 1;
-  uint32_t newSplitSliceCount = splitDepth ? GetImageInfo().extent.depth : oldSplitSliceCount;
-
-  uint32_t oldSize = (uint32_t)m_values.size();
-
-  uint32_t newSize =
-      newSplitAspectCount * newSplitLevelCount * newSplitLayerCount * newSplitSliceCount;
-  RDCASSERT(newSize > RDCMAX(oldSize, 1U));
-
-  m_values.resize(newSize);
-  // if m_values was empty before, copy the first value from our inline storage
-  if(oldSize == 0)
-    m_values[0] = m_value;
-
-  uint32_t newAspectIndex = newSplitAspectCount - 1;
-  uint32_t oldAspectIndex = AreAspectsSplit() ? newAspectIndex : 0;
-  uint32_t newLevel = newSplitLevelCount - 1;
-  uint32_t oldLevel = AreLevelsSplit() ? newLevel : 0;
-  uint32_t newLayer = newSplitLayerCount - 1;
-  uint32_t oldLayer = AreLayersSplit() ? newLayer : 0;
-  uint32_t newSlice = newSplitSliceCount - 1;
-  uint32_t oldSlice = IsDepthSplit() ? newSlice : 0;
-  uint32_t newIndex = newSize - 1;
-  while(true)
+static void AddLayerStart(rdcarray<uint32_t> &layerStarts, uint32_t layer)
+{
+  size_t lo = 0, hi = layerStarts.size();
+  while(lo < hi)
   {
-    uint32_t oldIndex =
-        ((oldAspectIndex * oldSplitLevelCount + oldLevel) * oldSplitLayerCount + oldLayer) *
-            oldSplitSliceCount +
-        oldSlice;
-    m_values[newIndex] = m_values[oldIndex];
-
-    if(newIndex == 0)
-    {
-      RDCASSERT(oldIndex == 0);
-      break;
-    }
-    --newIndex;
-
-    if(newSlice > 0)
-    {
-      --newSlice;
-      oldSlice = IsDepthSplit() ? newSlice : 0;
-      continue;
-    }
-    newSlice = newSplitSliceCount - 1;
-    oldSlice = oldSplitSliceCount - 1;
-
-    if(newLayer > 0)
-    {
-      --newLayer;
-      oldLayer = AreLayersSplit() ? newLayer : 0;
-      continue;
-    }
-    newLayer = newSplitLayerCount - 1;
-    oldLayer = oldSplitLayerCount - 1;
-
-    if(newLevel > 0)
-    {
-      --newLevel;
-      oldLevel = AreLevelsSplit() ? newLevel : 0;
-      continue;
-    }
-    newLevel = newSplitLevelCount - 1;
-    oldLevel = oldSplitLevelCount - 1;
-
-    if(newAspectIndex > 0)
-    {
-      --newAspectIndex;
-      oldAspectIndex = AreAspectsSplit() ? newAspectIndex : 0;
-      continue;
-    }
-    RDCERR("Too many subresources in ImageSubresourceMap::Split");
-    break;
+    size_t mid = (lo + hi) / 2;
+    if(layerStarts[mid] < layer)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
+  if(lo == layerStarts.size() || layerStarts[lo] != layer)
+    layerStarts.insert(lo, layer);
+}
 
-  m_flags = newFlags;
+void ImageSubresourceMap::AddSplitsForRange(const ImageSubresourceRange &range, uint16_t &flags,
+                                            rdcarray<uint32_t> &layerStarts) const
+{
+  if(range.aspectMask != GetImageInfo().Aspects())
+    flags |= (uint16_t)FlagBits::AreAspectsSplit;
+  if(range.baseMipLevel != 0u || range.levelCount < (uint32_t)GetImageInfo().levelCount)
+    flags |= (uint16_t)FlagBits::AreLevelsSplit;
+  if(range.baseDepthSlice != 0u || range.sliceCount < GetImageInfo().extent.depth)
+    flags |= (uint16_t)FlagBits::IsDepthSplit;
+
+  uint32_t layerCount = GetImageInfo().layerCount;
+  uint32_t endLayer = range.baseArrayLayer + range.layerCount;
+  if((range.baseArrayLayer > 0u && range.baseArrayLayer < layerCount) ||
+     (endLayer > 0u && endLayer < layerCount))
+  {
+    if(layerStarts.empty())
+      layerStarts.push_back(0);
+    if(range.baseArrayLayer > 0u && range.baseArrayLayer < layerCount)
+      AddLayerStart(layerStarts, range.baseArrayLayer);
+    if(endLayer > 0u && endLayer < layerCount)
+      AddLayerStart(layerStarts, endLayer);
+    flags |= (uint16_t)FlagBits::AreLayersSplit;
+  }
 }
 
-void ImageSubresourceMap::Unsplit(bool unsplitAspects, bool unsplitLevels, bool unsplitLayers,
-                                  bool unsplitDepth)
+void ImageSubresourceMap::Split(const ImageSubresourceRange &range)
 {
   uint16_t newFlags = m_flags;
-  if(unsplitAspects)
-    newFlags &= ~(uint16_t)FlagBits::AreAspectsSplit;
+  rdcarray<uint32_t> newLayerStarts = m_layerStarts;
+  AddSplitsForRange(range, newFlags, newLayerStarts);
 
-  if(unsplitLevels)
-    newFlags &= ~(uint16_t)FlagBits::AreLevelsSplit;
-
-  if(unsplitLayers)
-    newFlags &= ~(uint16_t)FlagBits::AreLayersSplit;
-
-  if(unsplitDepth)
-    newFlags &= ~(uint16_t)FlagBits::IsDepthSplit;
-
-  if(newFlags == m_flags)
+  if(newFlags == m_flags && newLayerStarts.size() == m_layerStarts.size())
     // not splitting anything new
     return;
 
+  Resplit(newFlags, newLayerStarts);
+}
+
+void ImageSubresourceMap::Resplit(uint16_t newFlags, const rdcarray<uint32_t> &newLayerStarts)
+{
   uint32_t oldSplitAspectCount = AreAspectsSplit() ? m_aspectCount : 1;
-  uint32_t newSplitAspectCount = unsplitAspects ? 1 : oldSplitAspectCount;
+  uint32_t newSplitAspectCount = AreAspectsSplit(newFlags) ? m_aspectCount : 1;
 
   uint32_t oldSplitLevelCount = AreLevelsSplit() ? GetImageInfo().levelCount : 1;
-  uint32_t newSplitLevelCount = unsplitLevels ? 1 : oldSplitLevelCount;
+  uint32_t newSplitLevelCount = AreLevelsSplit(newFlags) ? GetImageInfo().levelCount : 1;
 
-  uint32_t oldSplitLayerCount = AreLayersSplit() ? GetImageInfo().layerCount : 1;
-  uint32_t newSplitLayerCount = unsplitLayers ? 1 : oldSplitLayerCount;
+  uint32_t oldSplitLayerCount = LayerSlotCount();
+  uint32_t newSplitLayerCount = AreLayersSplit(newFlags) ? (uint32_t)newLayerStarts.size() : 1;
 
   uint32_t oldSplitSliceCount = IsDepthSplit() ? GetImageInfo().extent.depth : 1;
-  uint32_t newSplitSliceCount = unsplitDepth ? 1 : oldSplitSliceCount;
+  uint32_t newSplitSliceCount = IsDepthSplit(newFlags) ? GetImageInfo().extent.depth : 1;
+
+  RDCASSERT(!AreLayersSplit(newFlags) || (newSplitLayerCount > 1 && newLayerStarts[0] == 0));
 
-  uint32_t oldSize = (uint32_t)m_values.size();
-  RDCASSERT(oldSize > 0);
+  // the old layer interval that each new layer interval begins in
+  rdcarray<uint32_t> oldLayerSlots;
+  oldLayerSlots.resize(newSplitLayerCount);
+  for(uint32_t newLayer = 0; newLayer < newSplitLayerCount; ++newLayer)
+    oldLayerSlots[newLayer] = AreLayersSplit(newFlags) ? LayerSlot(newLayerStarts[newLayer]) : 0;
 
-  uint32_t newSize =
-      newSplitAspectCount * newSplitLevelCount * newSplitLayerCount * newSplitSliceCount;
-  RDCASSERT(newSize < oldSize);
+  size_t newSize = (size_t)newSplitAspectCount * newSplitLevelCount * newSplitLayerCount *
+                   newSplitSliceCount;
 
   rdcarray<ImageSubresourceState> newValues;
   newValues.resize(newSize);
 
-  uint32_t aspectIndex = 0;
-  uint32_t level = 0;
-  uint32_t layer = 0;
-  uint32_t slice = 0;
-  uint32_t newIndex = 0;
+  size_t newIndex = 0;
+  for(uint32_t aspectIndex = 0; aspectIndex < newSplitAspectCount; ++aspectIndex)
+  {
+    uint32_t oldAspectIndex = AreAspectsSplit() ? aspectIndex : 0;
+    for(uint32_t level = 0; level < newSplitLevelCount; ++level)
+    {
+      uint32_t oldLevel = AreLevelsSplit() ? level : 0;
+      for(uint32_t layer = 0; layer < newSplitLayerCount; ++layer)
+      {
+        uint32_t oldLayer = oldLayerSlots[layer];
+        for(uint32_t slice = 0; slice < newSplitSliceCount; ++slice)
+        {
+          uint32_t oldSlice = IsDepthSplit() ? slice : 0;
+          if(m_values.empty())
+          {
+            newValues[newIndex++] = m_value;
+          }
+          else
+          {
+            size_t oldIndex =
+                (((size_t)oldAspectIndex * oldSplitLevelCount + oldLevel) * oldSplitLayerCount +
+                 oldLayer) *
+                    oldSplitSliceCount +
+                oldSlice;
+            newValues[newIndex++] = m_values[oldIndex];
+          }
+        }
+      }
+    }
+  }
+
+  m_flags = newFlags;
+  if(AreLayersSplit())
+    m_layerStarts = newLayerStarts;
+  else
+    m_layerStarts.clear();
 
-  while(newIndex < newValues.size())
+  if(newSize == 1)
+  {
+    m_value = newValues[0];
+    m_values.clear();
+  }
+  else
   {
-    uint32_t oldIndex = ((aspectIndex * oldSplitLevelCount + level) * oldSplitLayerCount + layer) *
-                            oldSplitSliceCount +
-                        slice;
-    newValues[newIndex] = m_values[oldIndex];
+    newValues.swap(m_values);
+  }
+}
 
-    ++newIndex;
+bool ImageSubresourceMap::LayerSlotsMatch(uint32_t slotA, uint32_t slotB) const
+{
+  uint32_t aspectCount = AreAspectsSplit() ? m_aspectCount : 1;
+  uint32_t levelCount = AreLevelsSplit() ? m_imageInfo.levelCount : 1;
+  uint32_t sliceCount = IsDepthSplit() ? m_imageInfo.extent.depth : 1;
 
-    ++slice;
-    if(slice < newSplitSliceCount)
-      continue;
-    slice = 0;
+  for(uint32_t aspectIndex = 0; aspectIndex < aspectCount; ++aspectIndex)
+    for(uint32_t level = 0; level < levelCount; ++level)
+      for(uint32_t slice = 0; slice < sliceCount; ++slice)
+        if(SubresourceSlotValue(aspectIndex, level, slotA, slice) !=
+           SubresourceSlotValue(aspectIndex, level, slotB, slice))
+          return false;
 
-    ++layer;
-    if(layer < newSplitLayerCount)
-      continue;
-    layer = 0;
+  return true;
+}
 
-    ++level;
-    if(level < newSplitLevelCount)
-      continue;
-    level = 0;
+void ImageSubresourceMap::CoalesceLayers(uint32_t baseLayer, uint32_t endLayer)
+{
+  if(!AreLayersSplit())
+    return;
 
-    ++aspectIndex;
+  rdcarray<uint32_t> newLayerStarts;
+  newLayerStarts.reserve(m_layerStarts.size());
+  newLayerStarts.push_back(0);
+  for(uint32_t slot = 1; slot < m_layerStarts.size(); ++slot)
+  {
+    uint32_t start = m_layerStarts[slot];
+    // states are compared against the immediately preceding interval, if that was itself merged
+    // then it matched the one before it too.
+    if(start < baseLayer || start > endLayer || !LayerSlotsMatch(slot - 1, slot))
+      newLayerStarts.push_back(start);
   }
 
-  newValues.swap(m_values);
-  m_flags = newFlags;
+  if(newLayerStarts.size() == m_layerStarts.size())
+    return;
+
+  uint16_t newFlags = m_flags;
+  if(newLayerStarts.size() == 1)
+    newFlags &= ~(uint16_t)FlagBits::AreLayersSplit;
+  Resplit(newFlags, newLayerStarts);
 }
 
 void ImageSubresourceMap::Unsplit()
@@ -334,7 +338,7 @@ void ImageSubresourceMap::Unsplit()
   uint32_t aspectIndex = 0;
   uint32_t levelCount = AreLevelsSplit() ? m_imageInfo.levelCount : 1;
   uint32_t level = 0;
-  uint32_t layerCount = AreLayersSplit() ? m_imageInfo.layerCount : 1;
+  uint32_t layerCount = LayerSlotCount();
   uint32_t layer = 0;
   uint32_t sliceCount = IsDepthSplit() ? m_imageInfo.extent.depth : 1;
   uint32_t slice = 0;
@@ -342,14 +346,18 @@ void ImageSubresourceMap::Unsplit()
 
   bool canUnsplitAspects = aspectCount > 1;
   bool canUnsplitLevels = levelCount > 1;
-  bool canUnsplitLayers = layerCount > 1;
   bool canUnsplitDepth = sliceCount > 1;
 
+  // layer intervals are merged individually with their neighbours, rather than all or nothing
+  rdcarray<bool> canMergeLayer;
+  canMergeLayer.resize(layerCount);
+  for(uint32_t i = 0; i < layerCount; i++)
+    canMergeLayer[i] = (i > 0);
+
   RDCASSERT(aspectCount * levelCount * layerCount * sliceCount == m_values.size());
 #define UNSPLIT_INDEX(ASPECT, LEVEL, LAYER, SLICE) \
   ((((ASPECT)*levelCount + (LEVEL)) * layerCount + (LAYER)) * sliceCount + (SLICE))
-  while(index < m_values.size() &&
-        (canUnsplitAspects || canUnsplitLevels || canUnsplitLayers || canUnsplitDepth))
+  while(index < m_values.size())
   {
     if(canUnsplitAspects && aspectIndex > 0)
     {
@@ -363,11 +371,11 @@ void ImageSubresourceMap::Unsplit()
       if(m_values[index] != m_values[index0])
         canUnsplitLevels = false;
     }
-    if(canUnsplitLayers && layer > 0)
+    if(canMergeLayer[layer])
     {
-      uint32_t index0 = UNSPLIT_INDEX(aspectIndex, level, 0, slice);
-      if(m_values[index] != m_values[index0])
-        canUnsplitLayers = false;
+      uint32_t indexPrev = UNSPLIT_INDEX(aspectIndex, level, layer - 1, slice);
+      if(m_values[index] != m_values[indexPrev])
+        canMergeLayer[layer] = false;
     }
     if(canUnsplitDepth && slice > 0)
     {
@@ -399,7 +407,27 @@ void ImageSubresourceMap::Unsplit()
   }
 #undef UNSPLIT_INDEX
 
-  Unsplit(canUnsplitAspects, canUnsplitLevels, canUnsplitLayers, canUnsplitDepth);
+  uint16_t newFlags = m_flags;
+  if(canUnsplitAspects)
+    newFlags &= ~(uint16_t)FlagBits::AreAspectsSplit;
+  if(canUnsplitLevels)
+    newFlags &= ~(uint16_t)FlagBits::AreLevelsSplit;
+  if(canUnsplitDepth)
+    newFlags &= ~(uint16_t)FlagBits::IsDepthSplit;
+
+  rdcarray<uint32_t> newLayerStarts;
+  for(uint32_t i = 0; i < layerCount; i++)
+  {
+    if(!canMergeLayer[i])
+      newLayerStarts.push_back(LayerSlotBegin(i));
+  }
+  if(newLayerStarts.size() <= 1)
+    newFlags &= ~(uint16_t)FlagBits::AreLayersSplit;
+
+  if(newFlags == m_flags && newLayerStarts.size() == m_layerStarts.size())
+    return;
+
+  Resplit(newFlags, newLayerStarts);
 }
 
 inline FrameRefType ImageSubresourceMap::Merge(const ImageSubresourceMap &other,
@@ -425,11 +453,13 @@ inline FrameRefType ImageSubresourceMap::Merge(const ImageSubresourceMap &other,
       }
     }
   }
+  if(didSplit)
+    CoalesceLayers(0, GetImageInfo().layerCount);
   return maxRefType;
 }
 
-size_t ImageSubresourceMap::SubresourceIndex(uint32_t aspectIndex, uint32_t level, uint32_t layer,
-                                             uint32_t slice) const
+size_t ImageSubresourceMap::SubresourceSlotIndex(uint32_t aspectIndex, uint32_t level,
+                                                 uint32_t layer, uint32_t slice) const
 {
   if(!AreAspectsSplit())
     aspectIndex = 0;
@@ -440,7 +470,7 @@ size_t ImageSubresourceMap::SubresourceIndex(uint32_t aspectIndex, uint32_t leve
     level = 0;
   int splitLayerCount = 1;
   if(AreLayersSplit())
-    splitLayerCount = GetImageInfo().layerCount;
+    splitLayerCount = (int)m_layerStarts.size();
   else
     layer = 0;
   int splitSliceCount = 1;
@@ -457,7 +487,22 @@ void ImageSubresourceMap::ToArray(rdcarray<ImageSubresourceStateForRange> &arr)
   arr.reserve(arr.size() + size());
   for(auto src = begin(); src != end(); ++src)
   {
-    arr.push_back(*src);
+    ImageSubresourceStateForRange value = *src;
+    if(!AreLayersSplit())
+    {
+      arr.push_back(value);
+      continue;
+    }
+
+    // keep the serialised form with one entry per layer once layers are split, so it's unchanged
+    // by tracking layers in intervals.
+    uint32_t endLayer = value.range.baseArrayLayer + value.range.layerCount;
+    value.range.layerCount = 1;
+    for(uint32_t layer = src->range().baseArrayLayer; layer < endLayer; ++layer)
+    {
+      value.range.baseArrayLayer = layer;
+      arr.push_back(value);
+    }
   }
 }
 
@@ -468,22 +513,26 @@ void ImageSubresourceMap::FromArray(const rdcarray<ImageSubresourceStateForRange
     RDCERR("No values for ImageSubresourceMap");
     return;
   }
-  Split(arr.front().range);
-  if(size() != arr.size())
-  {
-    RDCERR("Incorrect number of values for ImageSubresourceMap");
-    return;
-  }
-  auto src = arr.begin();
-  auto dst = begin();
-  while(src != arr.end())
+
+  // split once for all of the ranges, then fill in each range's state
+  uint16_t newFlags = m_flags;
+  rdcarray<uint32_t> newLayerStarts = m_layerStarts;
+  for(const ImageSubresourceStateForRange &src : arr)
+    AddSplitsForRange(src.range, newFlags, newLayerStarts);
+  if(newFlags != m_flags || newLayerStarts.size() != m_layerStarts.size())
+    Resplit(newFlags, newLayerStarts);
+
+  for(const ImageSubresourceStateForRange &src : arr)
   {
-    if(src->range != dst->range())
-      RDCERR("Subresource range mismatch in ImageSubresourceMap");
-    else
-      dst->SetState(src->state);
-    ++src;
-    ++dst;
+    for(auto dst = RangeBegin(src.range); dst != end(); ++dst)
+    {
+      if(!dst->range().ContainedIn(src.range))
+      {
+        RDCERR("Subresource range mismatch in ImageSubresourceMap");
+        break;
+      }
+      dst->SetState(src.state);
+    }
   }
 }
 
@@ -624,6 +673,35 @@ bool SanitiseSliceRange(uint32_t &baseSlice, uint32_t &sliceCount, uint32_t imag
   return res;
 }
 
+bool CoalesceImageBarrier(VkImageMemoryBarrier &barrier, const VkImageMemoryBarrier &next)
+{
+  if(barrier.image != next.image || barrier.oldLayout != next.oldLayout ||
+     barrier.newLayout != next.newLayout)
+    return false;
+
+  // ownership transfers are matched up release-to-acquire by range, so leave them alone
+  if(barrier.srcQueueFamilyIndex != barrier.dstQueueFamilyIndex ||
+     next.srcQueueFamilyIndex != barrier.srcQueueFamilyIndex ||
+     next.dstQueueFamilyIndex != barrier.dstQueueFamilyIndex)
+    return false;
+
+  const VkImageSubresourceRange &range = barrier.subresourceRange;
+  const VkImageSubresourceRange &nextRange = next.subresourceRange;
+  if(range.aspectMask != nextRange.aspectMask || range.baseMipLevel != nextRange.baseMipLevel ||
+     range.levelCount != nextRange.levelCount)
+    return false;
+
+  if(range.layerCount == VK_REMAINING_ARRAY_LAYERS ||
+     nextRange.baseArrayLayer != range.baseArrayLayer + range.layerCount)
+    return false;
+
+  if(nextRange.layerCount == VK_REMAINING_ARRAY_LAYERS)
+    barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+  else
+    barrier.subresourceRange.layerCount += nextRange.layerCount;
+  return true;
+}
+
 template <typename Map, typename Pair>
 ImageSubresourceMap::SubresourceRangeIterTemplate<Map, Pair>::SubresourceRangeIterTemplate(
     Map &map, const ImageSubresourceRange &range)
@@ -663,17 +741,6 @@ void ImageSubresourceMap::SubresourceRangeIterTemplate<Map, Pair>::FixSubRange()
     m_value.m_range.sliceCount = m_map->GetImageInfo().extent.depth;
   }
 
-  if(AreLayersSplit(m_splitFlags))
-  {
-    m_value.m_range.baseArrayLayer = m_layer;
-    m_value.m_range.layerCount = 1u;
-  }
-  else
-  {
-    m_value.m_range.baseArrayLayer = 0u;
-    m_value.m_range.layerCount = m_map->GetImageInfo().layerCount;
-  }
-
   if(AreLevelsSplit(m_splitFlags))
   {
     m_value.m_range.baseMipLevel = m_level;
@@ -712,10 +779,23 @@ template void ImageSubresourceMap::SubresourceRangeIterTemplate<
     const ImageSubresourceMap, ImageSubresourceMap::ConstSubresourcePairRef>::FixSubRange();
 
 template <typename Map, typename Pair>
-Pair *ImageSubresourceMap::SubresourceRangeIterTemplate<Map, Pair>::operator->()
+void ImageSubresourceMap::SubresourceRangeIterTemplate<Map, Pair>::FetchValue()
 {
   FixSubRange();
-  m_value.m_state = &m_map->SubresourceIndexValue(m_aspectIndex, m_level, m_layer, m_slice);
+  uint32_t layerSlot = m_map->LayerSlot(m_layer);
+  m_value.m_range.baseArrayLayer = m_map->LayerSlotBegin(layerSlot);
+  m_value.m_range.layerCount = m_map->LayerSlotEnd(layerSlot) - m_value.m_range.baseArrayLayer;
+  m_value.m_state = &m_map->SubresourceSlotValue(m_aspectIndex, m_level, layerSlot, m_slice);
+}
+template void ImageSubresourceMap::SubresourceRangeIterTemplate<
+    ImageSubresourceMap, ImageSubresourceMap::SubresourcePairRef>::FetchValue();
+template void ImageSubresourceMap::SubresourceRangeIterTemplate<
+    const ImageSubresourceMap, ImageSubresourceMap::ConstSubresourcePairRef>::FetchValue();
+
+template <typename Map, typename Pair>
+Pair *ImageSubresourceMap::SubresourceRangeIterTemplate<Map, Pair>::operator->()
+{
+  FetchValue();
   return &m_value;
 }
 template ImageSubresourceMap::SubresourcePairRef *ImageSubresourceMap::SubresourceRangeIterTemplate<
@@ -726,8 +806,7 @@ template ImageSubresourceMap::ConstSubresourcePairRef *ImageSubresourceMap::Subr
 template <typename Map, typename Pair>
 Pair &ImageSubresourceMap::SubresourceRangeIterTemplate<Map, Pair>::operator*()
 {
-  FixSubRange();
-  m_value.m_state = &m_map->SubresourceIndexValue(m_aspectIndex, m_level, m_layer, m_slice);
+  FetchValue();
   return m_value;
 }
 template ImageSubresourceMap::SubresourcePairRef &ImageSubresourceMap::SubresourceRangeIterTemplate<
@@ -908,6 +987,11 @@ void ImageState::Update(ImageSubresourceRange range, const ImageSubresourceState
       maxRefType = ComposeFrameRefsDisjoint(maxRefType, subState.refType);
     }
   }
+
+  // the update may have made this range match its neighbours, or made layer intervals inside it
+  // match each other, so merge them back together to keep later updates cheap.
+  if(didSplit)
+    subresourceStates.CoalesceLayers(range.baseArrayLayer, range.baseArrayLayer + range.layerCount);
 }
 
 void ImageState::Merge(const ImageState &other, ImageTransitionInfo info)
@@ -438,6 +438,9 @@ void DescSetLayout::Init(VulkanResourceManager *resourceMan, VulkanCreationInfo
 
 void DescSetLayout::CreateBindingsArray(BindingStorage &bindingStorage, uint32_t variableAllocSize) const
 {
+  // the slots are about to be reallocated, so any snapshot can't keep sharing them
+  bindingStorage.DetachSnapshot();
+
   bindingStorage.variableDescriptorCount = variableAllocSize;
 
   if(!bindings.empty())
@@ -508,6 +511,8 @@ void DescSetLayout::CreateBindingsArray(BindingStorage &bindingStorage, uint32_t
 void DescSetLayout::UpdateBindingsArray(const DescSetLayout &prevLayout,
                                         BindingStorage &bindingStorage) const
 {
+  bindingStorage.DetachSnapshot();
+
   if(bindings.empty())
   {
     bindingStorage.clear();
@@ -162,8 +162,9 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
 
     if((layout.flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT) == 0)
     {
-      record->descInfo->data.copy(initialContents.descriptorSlots, initialContents.numDescriptors,
-                                  initialContents.inlineData, initialContents.inlineByteSize);
+      initialContents.descriptorSnapshot = record->descInfo->data.snapshot(
+          initialContents.inlineData, initialContents.inlineByteSize);
+      initialContents.numDescriptors = initialContents.descriptorSnapshot->slotCount();
     }
     else
     {
@@ -1151,6 +1152,7 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id, V
     DescriptorSetSlot *Bindings = NULL;
     uint32_t NumBindings = 0;
     bytebuf InlineData;
+    rdcarray<DescriptorSetSlot> SnapshotSlots;
 
     // there's no point in setting up a lazy array when we're structured exporting because we KNOW
     // we're going to need all the data anyway.
@@ -1163,6 +1165,12 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id, V
       Bindings = initial->descriptorSlots;
       NumBindings = initial->numDescriptors;
 
+      if(initial->descriptorSnapshot)
+      {
+        initial->descriptorSnapshot->Read(SnapshotSlots);
+        Bindings = SnapshotSlots.data();
+      }
+
       InlineData.assign(initial->inlineData, initial->inlineByteSize);
     }
 
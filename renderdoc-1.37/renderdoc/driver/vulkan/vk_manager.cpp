@@ -211,13 +211,18 @@ void VulkanResourceManager::RecordBarriers(rdcarray<rdcpair<ResourceId, ImageReg
 
   for(uint32_t ti = 0; ti < numBarriers; ti++)
   {
-    const VkImageMemoryBarrier &t = barriers[ti];
+    VkImageMemoryBarrier t = barriers[ti];
 
     // ignore barriers that are do-nothing. Best case this doesn't change our tracking at all and
     // worst case this is a KHR_synchronization2 barrier that should not change the layout.
     if(t.oldLayout == t.newLayout)
       continue;
 
+    // apply runs of identical barriers over consecutive array layers as one, so that transitioning
+    // a large array one layer at a time only updates the tracked state once.
+    while(ti + 1 < numBarriers && CoalesceImageBarrier(t, barriers[ti + 1]))
+      ti++;
+
     ResourceId id = IsReplayMode(m_State) ? GetNonDispWrapper(t.image)->id : GetResID(t.image);
 
     if(id == ResourceId())
@@ -101,6 +101,7 @@ struct VkInitialContents
   void Free(ResourceManager<Configuration> *rm)
   {
     // any of these will be NULL if unused
+    SAFE_RELEASE(descriptorSnapshot);
     SAFE_DELETE_ARRAY(descriptorSlots);
     SAFE_DELETE_ARRAY(descriptorWrites);
     SAFE_DELETE_ARRAY(descriptorInfo);
@@ -119,7 +120,9 @@ struct VkInitialContents
     // MemoryAllocation ise not free'd here
   }
 
-  // for descriptor heaps, when capturing we save the slots, when replaying we store direct writes
+  // for descriptor heaps, when capturing we save a snapshot of the slots, when replaying we store
+  // direct writes
+  DescriptorSetSnapshot *descriptorSnapshot;
   DescriptorSetSlot *descriptorSlots;
   VkWriteDescriptorSet *descriptorWrites;
   VkDescriptorBufferInfo *descriptorInfo;
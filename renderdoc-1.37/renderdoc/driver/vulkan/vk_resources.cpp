@@ -2792,6 +2792,25 @@ ResourceFormat MakeResourceFormat(VkFormat fmt)
     }
   }
 
+  // PVRTC2 shares its block sizes with PVRTC1 but isn't decoded the same way, so we leave its
+  // footprint unknown rather than have it mistaken for PVRTC1 data.
+  switch(fmt)
+  {
+    case VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG:
+    case VK_FORMAT_PVRTC1_2BPP_SRGB_BLOCK_IMG: ret.SetBlockFootprint(8, 4, 1); break;
+    case VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG:
+    case VK_FORMAT_PVRTC1_4BPP_SRGB_BLOCK_IMG: ret.SetBlockFootprint(4, 4, 1); break;
+    default:
+    {
+      if(ret.type == ResourceFormatType::ASTC)
+      {
+        BlockShape shape = GetBlockShape(fmt, 0);
+        ret.SetBlockFootprint(shape.width, shape.height, 1);
+      }
+      break;
+    }
+  }
+
   return ret;
 }
 
@@ -1233,6 +1233,11 @@ struct MemMapState
   // flush this may point to the readback memory so that we read from that fast copy instead of the
   // slow actual pointer.
   byte *cpuReadPtr = NULL;
+  // when enabled, tracks which pages of the mapped range are written so only those need to be
+  // compared against refData. Only valid while refData is.
+  WriteWatch::Region *writeWatch = NULL;
+  // the dirty ranges from writeWatch, kept to reuse the allocation on each check
+  rdcarray<DiffRange> dirtyRanges;
   Threading::CriticalSection mrLock;
 };
 
@@ -1337,6 +1342,10 @@ bool SanitiseLevelRange(uint32_t &baseMipLevel, uint32_t &levelCount, uint32_t i
 bool SanitiseLayerRange(uint32_t &baseArrayLayer, uint32_t &layerCount, uint32_t imageLayerCount);
 bool SanitiseSliceRange(uint32_t &baseSlice, uint32_t &sliceCount, uint32_t imageSliceCount);
 
+// if `next` makes the same layout transition as `barrier` on the array layers directly after it,
+// with no queue family ownership transfer, extends `barrier` to cover both and returns true.
+bool CoalesceImageBarrier(VkImageMemoryBarrier &barrier, const VkImageMemoryBarrier &next);
+
 struct ImageSubresourceRange
 {
   VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_FLAG_BITS_MAX_ENUM >> 1;
@@ -1536,9 +1545,15 @@ class ImageSubresourceMap
 
   // The states of the subresources, without explicit ranges.
   // The ranges associated with each state are determined by the index in
-  // `m_values` and the `*Split` flags in `m_flags`.
+  // `m_values`, the `*Split` flags in `m_flags` and the layer intervals in `m_layerStarts`.
   rdcarray<ImageSubresourceState> m_values;
 
+  // When the layers are split, the first layer of each interval of layers that is tracked as one
+  // unit, in increasing order and always beginning with 0. Layers are only split at the boundaries
+  // of the ranges that are used, so an image with thousands of layers that are transitioned a few
+  // ranges at a time only stores one state per range instead of one per layer.
+  rdcarray<uint32_t> m_layerStarts;
+
   // commonly there will only be one value, in that case we inline it here. This is only valid if
   // m_values is empty.
   ImageSubresourceState m_value;
@@ -1577,8 +1592,63 @@ class ImageSubresourceMap
   inline bool AreLayersSplit() const { return AreLayersSplit(m_flags); }
   inline bool IsDepthSplit() const { return IsDepthSplit(m_flags); }
   void Split(bool splitAspects, bool splitLevels, bool splitLayers, bool splitDepth);
-  void Unsplit(bool unsplitAspects, bool unsplitLevels, bool unsplitLayers, bool unsplitDepth);
-  size_t SubresourceIndex(uint32_t aspectIndex, uint32_t level, uint32_t layer, uint32_t z) const;
+  void AddSplitsForRange(const ImageSubresourceRange &range, uint16_t &flags,
+                         rdcarray<uint32_t> &layerStarts) const;
+  // rearranges m_values for new split flags and layer intervals. Each subresource group in the
+  // new layout takes the state of the old group containing its first subresource.
+  void Resplit(uint16_t newFlags, const rdcarray<uint32_t> &newLayerStarts);
+  bool LayerSlotsMatch(uint32_t slotA, uint32_t slotB) const;
+  size_t SubresourceSlotIndex(uint32_t aspectIndex, uint32_t level, uint32_t layerSlot,
+                              uint32_t z) const;
+  size_t SubresourceIndex(uint32_t aspectIndex, uint32_t level, uint32_t layer, uint32_t z) const
+  {
+    return SubresourceSlotIndex(aspectIndex, level, LayerSlot(layer), z);
+  }
+
+  inline uint32_t LayerSlotCount() const
+  {
+    return AreLayersSplit() ? (uint32_t)m_layerStarts.size() : 1;
+  }
+  // returns the index of the layer interval containing `layer`
+  inline uint32_t LayerSlot(uint32_t layer) const
+  {
+    if(!AreLayersSplit())
+      return 0;
+    uint32_t lo = 0, hi = (uint32_t)m_layerStarts.size();
+    while(hi - lo > 1)
+    {
+      uint32_t mid = (lo + hi) / 2;
+      if(m_layerStarts[mid] <= layer)
+        lo = mid;
+      else
+        hi = mid;
+    }
+    return lo;
+  }
+  inline uint32_t LayerSlotBegin(uint32_t slot) const
+  {
+    return AreLayersSplit() ? m_layerStarts[slot] : 0;
+  }
+  inline uint32_t LayerSlotEnd(uint32_t slot) const
+  {
+    if(AreLayersSplit() && slot + 1 < m_layerStarts.size())
+      return m_layerStarts[slot + 1];
+    return GetImageInfo().layerCount;
+  }
+  inline ImageSubresourceState &SubresourceSlotValue(uint32_t aspectIndex, uint32_t level,
+                                                     uint32_t layerSlot, uint32_t slice)
+  {
+    if(m_values.empty())
+      return m_value;
+    return m_values[SubresourceSlotIndex(aspectIndex, level, layerSlot, slice)];
+  }
+  inline const ImageSubresourceState &SubresourceSlotValue(uint32_t aspectIndex, uint32_t level,
+                                                           uint32_t layerSlot, uint32_t slice) const
+  {
+    if(m_values.empty())
+      return m_value;
+    return m_values[SubresourceSlotIndex(aspectIndex, level, layerSlot, slice)];
+  }
 
 public:
   inline const ImageInfo &GetImageInfo() const { return m_imageInfo; }
@@ -1635,14 +1705,13 @@ public:
     return SubresourceIndexValue(aspectIndex, level, layer, slice);
   }
 
-  inline void Split(const ImageSubresourceRange &range)
-  {
-    Split(range.aspectMask != GetImageInfo().Aspects(),
-          range.baseMipLevel != 0u || range.levelCount < (uint32_t)GetImageInfo().levelCount,
-          range.baseArrayLayer != 0u || range.layerCount < (uint32_t)GetImageInfo().layerCount,
-          range.baseDepthSlice != 0u || range.sliceCount < GetImageInfo().extent.depth);
-  }
+  // splits the map so that `range` is covered exactly by whole subresource groups. Array layers
+  // are only split at the ends of the range.
+  void Split(const ImageSubresourceRange &range);
   void Unsplit();
+  // merges neighbouring layer intervals with identical states, if the boundary between them lies
+  // in [baseLayer, endLayer]. This is the cheap counterpart to Unsplit() for after an update.
+  void CoalesceLayers(uint32_t baseLayer, uint32_t endLayer);
   FrameRefType Merge(const ImageSubresourceMap &other, FrameRefCompFunc compose);
 
   template <typename Map, typename Pair>
@@ -1686,6 +1755,7 @@ public:
              m_slice < m_range.baseDepthSlice + m_range.sliceCount;
     }
     void FixSubRange();
+    void FetchValue();
   };
 
   template <typename State>
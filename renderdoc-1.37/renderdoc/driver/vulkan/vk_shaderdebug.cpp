@@ -6279,15 +6279,8 @@ ShaderDebugTrace *VulkanReplay::DebugComputeCommon(ShaderStage stage, uint32_t e
   }
 }
 
-rdcarray<ShaderDebugState> VulkanReplay::ContinueDebug(ShaderDebugger *debugger)
+void VulkanReplay::PrepareShaderDebugSimulation()
 {
-  rdcspv::Debugger *spvDebugger = (rdcspv::Debugger *)debugger;
-
-  if(!spvDebugger)
-    return {};
-
-  VkMarkerRegion region("ContinueDebug Simulation Loop");
-
   for(size_t fmt = 0; fmt < ARRAY_COUNT(m_TexRender.DummyImageViews); fmt++)
   {
     for(size_t dim = 0; dim < ARRAY_COUNT(m_TexRender.DummyImageViews[0]); dim++)
@@ -6329,6 +6322,18 @@ rdcarray<ShaderDebugState> VulkanReplay::ContinueDebug(ShaderDebugger *debugger)
           UnwrapPtr(m_TexRender.DummyBufferView[fmt]);
     }
   }
+}
+
+rdcarray<ShaderDebugState> VulkanReplay::ContinueDebug(ShaderDebugger *debugger)
+{
+  rdcspv::Debugger *spvDebugger = (rdcspv::Debugger *)debugger;
+
+  if(!spvDebugger)
+    return {};
+
+  VkMarkerRegion region("ContinueDebug Simulation Loop");
+
+  PrepareShaderDebugSimulation();
 
   rdcarray<ShaderDebugState> ret = spvDebugger->ContinueDebug();
 
@@ -6338,6 +6343,45 @@ rdcarray<ShaderDebugState> VulkanReplay::ContinueDebug(ShaderDebugger *debugger)
   return ret;
 }
 
+ShaderDebugState VulkanReplay::SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex)
+{
+  rdcspv::Debugger *spvDebugger = (rdcspv::Debugger *)debugger;
+
+  if(!spvDebugger)
+    return {};
+
+  VkMarkerRegion region("SeekDebug Simulation Loop");
+
+  PrepareShaderDebugSimulation();
+
+  ShaderDebugState ret = spvDebugger->SeekDebug(stepIndex);
+
+  VulkanAPIWrapper *api = (VulkanAPIWrapper *)spvDebugger->GetAPIWrapper();
+  api->ResetReplay();
+
+  return ret;
+}
+
+rdcarray<rdcarray<uint32_t>> VulkanReplay::GetDebugLaneExecutions(ShaderDebugger *debugger)
+{
+  rdcspv::Debugger *spvDebugger = (rdcspv::Debugger *)debugger;
+
+  if(!spvDebugger)
+    return {};
+
+  VkMarkerRegion region("GetDebugLaneExecutions Simulation Loop");
+
+  PrepareShaderDebugSimulation();
+
+  // the rest of the workgroup may still need to run to completion
+  rdcarray<rdcarray<uint32_t>> ret = spvDebugger->GetLaneExecutions();
+
+  VulkanAPIWrapper *api = (VulkanAPIWrapper *)spvDebugger->GetAPIWrapper();
+  api->ResetReplay();
+
+  return ret;
+}
+
 void VulkanReplay::FreeDebugger(ShaderDebugger *debugger)
 {
   delete debugger;
@@ -1288,7 +1288,7 @@ void WrappedVulkan::vkUpdateDescriptorSets(VkDevice device, uint32_t writeCount,
         Serialise_vkUpdateDescriptorSets(ser, device, writeCount, pDescriptorWrites, copyCount,
                                          pDescriptorCopies);
 
-        m_FrameCaptureRecord->AddChunk(scope.Get());
+        m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
       }
 
       // previously we would not mark descriptor set destinations as ref'd here. This is because all
@@ -1409,6 +1409,8 @@ void WrappedVulkan::vkUpdateDescriptorSets(VkDevice device, uint32_t writeCount,
 
         DescriptorSetSlot &bind = (*binding)[curIdx];
 
+        record->descInfo->data.PrepareWrite(&bind);
+
         if(descWrite.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER ||
            descWrite.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER)
         {
@@ -1516,6 +1518,7 @@ void WrappedVulkan::vkUpdateDescriptorSets(VkDevice device, uint32_t writeCount,
 
         DescriptorSetSlot &bind = (*dstbinding)[curDstIdx];
 
+        dstrecord->descInfo->data.PrepareWrite(&bind);
         bind = (*srcbinding)[curSrcIdx];
       }
     }
@@ -1769,7 +1772,7 @@ void WrappedVulkan::vkUpdateDescriptorSetWithTemplate(
       Serialise_vkUpdateDescriptorSetWithTemplate(ser, device, descriptorSet,
                                                   descriptorUpdateTemplate, pData);
 
-      m_FrameCaptureRecord->AddChunk(scope.Get());
+      m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
 
       // mark the destination set and template as referenced
       GetResourceManager()->MarkResourceFrameReferenced(GetResID(descriptorSet),
@@ -1833,6 +1836,8 @@ void WrappedVulkan::vkUpdateDescriptorSetWithTemplate(
 
         DescriptorSetSlot &bind = (*binding)[curIdx];
 
+        record->descInfo->data.PrepareWrite(&bind);
+
         if(entry.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER ||
            entry.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER)
         {
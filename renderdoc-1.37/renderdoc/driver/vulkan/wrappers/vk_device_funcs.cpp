@@ -4915,7 +4915,7 @@ VkResult WrappedVulkan::vkDeviceWaitIdle(VkDevice device)
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkDeviceWaitIdle);
     Serialise_vkDeviceWaitIdle(ser, device);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
   }
 
   return ret;
@@ -1804,7 +1804,7 @@ void WrappedVulkan::vkResetQueryPool(VkDevice device, VkQueryPool queryPool, uin
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkResetQueryPool);
     Serialise_vkResetQueryPool(ser, device, queryPool, firstQuery, queryCount);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(GetResID(queryPool), eFrameRef_Read);
   }
 }
@@ -30,6 +30,11 @@
 RDOC_EXTERN_CONFIG(bool, Vulkan_Debug_VerboseCommandRecording);
 RDOC_EXTERN_CONFIG(bool, Vulkan_Debug_SingleSubmitFlushing);
 
+RDOC_CONFIG(bool, Vulkan_Debug_TrackCoherentMapWrites, false,
+            "During a frame capture, write-protect coherent mapped memory so that only pages "
+            "written since the last submit are compared for changes. System calls that write "
+            "into mapped memory will fail while this is enabled.");
+
 template <typename SerialiserType>
 bool WrappedVulkan::Serialise_vkGetDeviceQueue(SerialiserType &ser, VkDevice device,
                                                uint32_t queueFamilyIndex, uint32_t queueIndex,
@@ -1180,9 +1185,6 @@ void WrappedVulkan::CaptureQueueSubmit(VkQueue queue,
           continue;
         }
 
-        size_t diffStart = 0, diffEnd = 0;
-        bool found = true;
-
         // this causes vkFlushMappedMemoryRanges call to allocate and copy to refData
         // from serialised buffer. We want to copy *precisely* the serialised data,
         // otherwise there is a gap in time between serialising out a snapshot of
@@ -1202,6 +1204,19 @@ void WrappedVulkan::CaptureQueueSubmit(VkQueue queue,
         // shouldn't miss anything
         state.needRefData = true;
 
+        // start tracking writes before the contents are read below for the first time, so that
+        // anything written after that is seen as dirty on the next submit.
+        bool fullDiff = true;
+        if(state.writeWatch)
+        {
+          fullDiff = false;
+        }
+        else if(Vulkan_Debug_TrackCoherentMapWrites() && WriteWatch::IsSupported())
+        {
+          state.writeWatch =
+              WriteWatch::Watch(state.mappedPtr + state.mapOffset, (size_t)state.mapSize);
+        }
+
         if(state.readbackOnGPU)
         {
           RDCDEBUG("Reading back %s with GPU for comparison", ToStr(record->GetResourceID()).c_str());
@@ -1287,35 +1302,66 @@ void WrappedVulkan::CaptureQueueSubmit(VkQueue queue,
 
         // if we have a previous set of data, compare.
         // otherwise just serialise it all
-        if(state.refData)
-          found = FindDiffRange(((byte *)state.cpuReadPtr) + state.mapOffset, state.refData,
-                                (size_t)state.mapSize, diffStart, diffEnd);
+        const byte *mapData = ((byte *)state.cpuReadPtr) + state.mapOffset;
+        size_t scannedBytes = 0;
+
+        // Since the mapped pointer might be written on another thread (or even the GPU) this could
+        // cause a difference to appear and disappear transiently. FindDiffRanges only returns
+        // non-empty ranges, and we don't need to write anything that was lost (the application is
+        // responsible for ensuring it's not writing to memory the GPU might need)
+        DiffRange diffs[MaxMapFlushRanges];
+        size_t numDiffs = 0;
+        if(!state.refData)
+        {
+          diffs[numDiffs++] = {0, (size_t)state.mapSize};
+        }
+        else if(fullDiff)
+        {
+          numDiffs = FindDiffRanges(mapData, state.refData, (size_t)state.mapSize, diffs,
+                                    MaxMapFlushRanges);
+          scannedBytes = (size_t)state.mapSize;
+        }
         else
-          diffEnd = (size_t)state.mapSize;
+        {
+          // only pages written since the last check can have changed. They're all scanned together
+          // so the flush is bounded to the same number of ranges as a full diff
+          WriteWatch::GetDirtyRanges(state.writeWatch, state.dirtyRanges);
 
-        // sanitise diff start/end. Since the mapped pointer might be written on another thread
-        // (or even the GPU) this could cause a difference to appear and disappear transiently. In
-        // this case FindDiffRange could find the difference when locating the start but not find
-        // it when locating the end. In this case we don't need to write the difference (the
-        // application is responsible for ensuring it's not writing to memory the GPU might need)
-        if(diffEnd <= diffStart)
-          found = false;
+          numDiffs = FindDiffRanges(mapData, state.refData, state.dirtyRanges.data(),
+                                    state.dirtyRanges.size(), diffs, MaxMapFlushRanges);
+
+          for(const DiffRange &dirty : state.dirtyRanges)
+            scannedBytes += dirty.end - dirty.start;
+        }
 
-        if(found)
+        Atomic::Inc64(&m_CoherentMapStats.checks);
+        Atomic::ExchAdd64(&m_CoherentMapStats.mappedBytes, (int64_t)state.mapSize);
+        Atomic::ExchAdd64(&m_CoherentMapStats.scannedBytes, (int64_t)scannedBytes);
+
+        if(numDiffs > 0)
         {
           // MULTIDEVICE should find the device for this queue.
           // MULTIDEVICE only want to flush maps associated with this queue
           VkDevice dev = GetDev();
 
+          uint64_t diffBytes = 0;
+          for(size_t d = 0; d < numDiffs; d++)
+            diffBytes += diffs[d].end - diffs[d].start;
+
+          Atomic::ExchAdd64(&m_CoherentMapStats.flushedBytes, (int64_t)diffBytes);
+
+          RDCLOG("Persistent map flush forced for %s (%llu bytes in %zu ranges, %llu -> %llu)",
+                 ToStr(record->GetResourceID()).c_str(), diffBytes, numDiffs,
+                 (uint64_t)diffs[0].start, (uint64_t)diffs[numDiffs - 1].end);
+
+          for(size_t d = 0; d < numDiffs; d++)
           {
-            RDCLOG("Persistent map flush forced for %s (%llu -> %llu)",
-                   ToStr(record->GetResourceID()).c_str(), (uint64_t)diffStart, (uint64_t)diffEnd);
             VkMappedMemoryRange range = {
                 VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
                 NULL,
                 (VkDeviceMemory)(uint64_t)record->Resource,
-                state.mapOffset + diffStart,
-                diffEnd - diffStart,
+                state.mapOffset + diffs[d].start,
+                diffs[d].end - diffs[d].start,
             };
             InternalFlushMemoryRange(dev, range, true, capframe);
           }
@@ -1517,7 +1563,7 @@ VkResult WrappedVulkan::vkQueueSubmit(VkQueue queue, uint32_t submitCount,
         SCOPED_SERIALISE_CHUNK(VulkanChunk::vkQueueSubmit);
         Serialise_vkQueueSubmit(ser, queue, submitCount, pSubmits, fence);
 
-        m_FrameCaptureRecord->AddChunk(scope.Get());
+        m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
       }
 
       for(uint32_t s = 0; s < submitCount; s++)
@@ -1685,7 +1731,7 @@ VkResult WrappedVulkan::vkQueueSubmit2(VkQueue queue, uint32_t submitCount,
         SCOPED_SERIALISE_CHUNK(VulkanChunk::vkQueueSubmit2);
         Serialise_vkQueueSubmit2(ser, queue, submitCount, pSubmits, fence);
 
-        m_FrameCaptureRecord->AddChunk(scope.Get());
+        m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
       }
 
       for(uint32_t s = 0; s < submitCount; s++)
@@ -1954,7 +2000,7 @@ VkResult WrappedVulkan::vkQueueBindSparse(VkQueue queue, uint32_t bindInfoCount,
       ser.SetActionChunk();
       Serialise_vkQueueBindSparse(ser, queue, bindInfoCount, pBindInfo, fence);
 
-      m_FrameCaptureRecord->AddChunk(scope.Get());
+      m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
     }
 
     for(uint32_t i = 0; i < bindInfoCount; i++)
@@ -2031,7 +2077,7 @@ VkResult WrappedVulkan::vkQueueWaitIdle(VkQueue queue)
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkQueueWaitIdle);
     Serialise_vkQueueWaitIdle(ser, queue);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(GetResID(queue), eFrameRef_Read);
   }
 
@@ -2089,7 +2135,7 @@ void WrappedVulkan::vkQueueBeginDebugUtilsLabelEXT(VkQueue queue,
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkQueueBeginDebugUtilsLabelEXT);
     Serialise_vkQueueBeginDebugUtilsLabelEXT(ser, queue, pLabelInfo);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(GetResID(queue), eFrameRef_Read);
   }
 }
@@ -2136,7 +2182,7 @@ void WrappedVulkan::vkQueueEndDebugUtilsLabelEXT(VkQueue queue)
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkQueueEndDebugUtilsLabelEXT);
     Serialise_vkQueueEndDebugUtilsLabelEXT(ser, queue);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(GetResID(queue), eFrameRef_Read);
   }
 }
@@ -2191,7 +2237,7 @@ void WrappedVulkan::vkQueueInsertDebugUtilsLabelEXT(VkQueue queue,
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkQueueInsertDebugUtilsLabelEXT);
     Serialise_vkQueueInsertDebugUtilsLabelEXT(ser, queue, pLabelInfo);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(GetResID(queue), eFrameRef_Read);
   }
 }
@@ -869,6 +869,9 @@ void WrappedVulkan::vkFreeMemory(VkDevice device, VkDeviceMemory memory, const V
     if(memMapState)
     {
       // there is an implicit unmap on free, so make sure to tidy up
+      WriteWatch::Unwatch(memMapState->writeWatch);
+      memMapState->writeWatch = NULL;
+
       if(memMapState->refData)
       {
         FreeAlignedBuffer(memMapState->refData);
@@ -1159,7 +1162,7 @@ void WrappedVulkan::vkUnmapMemory(VkDevice device, VkDeviceMemory mem)
           }
           else
           {
-            m_FrameCaptureRecord->AddChunk(scope.Get());
+            m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
             GetResourceManager()->MarkMemoryFrameReferenced(id, state.mapOffset, state.mapSize,
                                                             eFrameRef_PartialWrite);
           }
@@ -1169,6 +1172,9 @@ void WrappedVulkan::vkUnmapMemory(VkDevice device, VkDeviceMemory mem)
       state.cpuReadPtr = state.mappedPtr = NULL;
     }
 
+    WriteWatch::Unwatch(state.writeWatch);
+    state.writeWatch = NULL;
+
     FreeAlignedBuffer(state.refData);
     state.refData = NULL;
   }
@@ -1383,7 +1389,7 @@ void WrappedVulkan::InternalFlushMemoryRange(VkDevice device, const VkMappedMemo
                                          : VulkanChunk::vkFlushMappedMemoryRanges);
     Serialise_vkFlushMappedMemoryRanges(ser, device, 1, &memRange);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
   }
 
   if(capframe)
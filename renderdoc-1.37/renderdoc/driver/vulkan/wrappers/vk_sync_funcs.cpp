@@ -225,7 +225,7 @@ VkResult WrappedVulkan::vkGetFenceStatus(VkDevice device, VkFence fence)
       SCOPED_SERIALISE_CHUNK(VulkanChunk::vkGetFenceStatus);
       Serialise_vkGetFenceStatus(ser, device, fence);
 
-      m_FrameCaptureRecord->AddChunk(scope.Get());
+      m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
       GetResourceManager()->MarkResourceFrameReferenced(GetResID(fence), eFrameRef_Read);
     }
   }
@@ -273,7 +273,7 @@ VkResult WrappedVulkan::vkResetFences(VkDevice device, uint32_t fenceCount, cons
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkResetFences);
     Serialise_vkResetFences(ser, device, fenceCount, pFences);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
     for(uint32_t i = 0; i < fenceCount; i++)
       GetResourceManager()->MarkResourceFrameReferenced(GetResID(pFences[i]), eFrameRef_Read);
   }
@@ -321,7 +321,7 @@ VkResult WrappedVulkan::vkWaitForFences(VkDevice device, uint32_t fenceCount,
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkWaitForFences);
     Serialise_vkWaitForFences(ser, device, fenceCount, pFences, waitAll, timeout);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
     for(uint32_t i = 0; i < fenceCount; i++)
       GetResourceManager()->MarkResourceFrameReferenced(GetResID(pFences[i]), eFrameRef_Read);
   }
@@ -435,7 +435,7 @@ VkResult WrappedVulkan::vkSetEvent(VkDevice device, VkEvent event)
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkSetEvent);
     Serialise_vkSetEvent(ser, device, event);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
   }
 
   return ret;
@@ -473,7 +473,7 @@ VkResult WrappedVulkan::vkResetEvent(VkDevice device, VkEvent event)
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkResetEvent);
     Serialise_vkResetEvent(ser, device, event);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
   }
 
   return ret;
@@ -523,7 +523,7 @@ VkResult WrappedVulkan::vkGetEventStatus(VkDevice device, VkEvent event)
       SCOPED_SERIALISE_CHUNK(VulkanChunk::vkGetEventStatus);
       Serialise_vkGetEventStatus(ser, device, event);
 
-      m_FrameCaptureRecord->AddChunk(scope.Get());
+      m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
     }
   }
 
@@ -1038,7 +1038,7 @@ VkResult WrappedVulkan::vkGetSemaphoreCounterValue(VkDevice device, VkSemaphore
       SCOPED_SERIALISE_CHUNK(VulkanChunk::vkGetSemaphoreCounterValue);
       Serialise_vkGetSemaphoreCounterValue(ser, device, semaphore, pValue);
 
-      m_FrameCaptureRecord->AddChunk(scope.Get());
+      m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
       GetResourceManager()->MarkResourceFrameReferenced(GetResID(semaphore), eFrameRef_Read);
     }
   }
@@ -1088,7 +1088,7 @@ VkResult WrappedVulkan::vkWaitSemaphores(VkDevice device, const VkSemaphoreWaitI
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkWaitSemaphores);
     Serialise_vkWaitSemaphores(ser, device, pWaitInfo, timeout);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
     for(uint32_t i = 0; i < pWaitInfo->semaphoreCount; i++)
       GetResourceManager()->MarkResourceFrameReferenced(GetResID(pWaitInfo->pSemaphores[i]),
                                                         eFrameRef_Read);
@@ -1133,7 +1133,7 @@ VkResult WrappedVulkan::vkSignalSemaphore(VkDevice device, const VkSemaphoreSign
     SCOPED_SERIALISE_CHUNK(VulkanChunk::vkSignalSemaphore);
     Serialise_vkSignalSemaphore(ser, device, pSignalInfo);
 
-    m_FrameCaptureRecord->AddChunk(scope.Get());
+    m_FrameCaptureRecord->AddChunk(scope.Get(GetFrameChunkAllocator()));
     GetResourceManager()->MarkResourceFrameReferenced(GetResID(pSignalInfo->semaphore),
                                                       eFrameRef_Read);
   }
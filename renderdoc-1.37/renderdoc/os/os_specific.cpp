@@ -587,6 +587,52 @@ TEST_CASE("Test OS-specific functions", "[osspecific]")
     }
   };
 
+  SECTION("TLS slots")
+  {
+    int a = 1, b = 2, c = 3;
+
+    uint64_t slot = Threading::AllocateTLSSlot();
+    CHECK(Threading::GetTLSValue(slot) == NULL);
+    Threading::SetTLSValue(slot, &a);
+    CHECK(Threading::GetTLSValue(slot) == &a);
+
+    // another thread sets its own value that is left behind when the slot is freed
+    void *threadValue = &c;
+    Threading::ThreadHandle th = Threading::CreateThread([slot, &b, &threadValue]() {
+      threadValue = Threading::GetTLSValue(slot);
+      Threading::SetTLSValue(slot, &b);
+    });
+
+    Threading::JoinThread(th);
+    Threading::CloseThread(th);
+
+    CHECK(threadValue == NULL);
+    CHECK(Threading::GetTLSValue(slot) == &a);
+
+    Threading::FreeTLSSlot(slot);
+
+    // the index is reused, but neither thread's old value is visible through the new slot
+    uint64_t reused = Threading::AllocateTLSSlot();
+    CHECK(reused != slot);
+    CHECK(Threading::GetTLSValue(reused) == NULL);
+    CHECK(Threading::GetTLSValue(slot) == &a);
+
+    Threading::SetTLSValue(reused, &c);
+    CHECK(Threading::GetTLSValue(reused) == &c);
+    CHECK(Threading::GetTLSValue(slot) == NULL);
+
+    threadValue = &c;
+    th = Threading::CreateThread(
+        [reused, &threadValue]() { threadValue = Threading::GetTLSValue(reused); });
+
+    Threading::JoinThread(th);
+    Threading::CloseThread(th);
+
+    CHECK(threadValue == NULL);
+
+    Threading::FreeTLSSlot(reused);
+  };
+
   SECTION("Atomics")
   {
     int32_t value = 0;
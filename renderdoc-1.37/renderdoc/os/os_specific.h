@@ -142,6 +142,9 @@ public:
 void Init();
 void Shutdown();
 uint64_t AllocateTLSSlot();
+// the slot's index may be reused by a later allocation. Values other threads still hold in the
+// freed slot are never returned for the new one, but they aren't cleaned up either.
+void FreeTLSSlot(uint64_t slot);
 
 void *GetTLSValue(uint64_t slot);
 void SetTLSValue(uint64_t slot, void *value);
@@ -246,6 +249,7 @@ int64_t Inc64(int64_t *i);
 int64_t Dec64(int64_t *i);
 int64_t ExchAdd64(int64_t *i, int64_t a);
 int32_t CmpExch32(int32_t *dest, int32_t oldVal, int32_t newVal);
+int64_t CmpExch64(int64_t *dest, int64_t oldVal, int64_t newVal);
 };
 
 namespace Callstack
@@ -275,6 +279,17 @@ class StackResolver
 public:
   virtual ~StackResolver() {}
   virtual AddressDetails GetAddr(uint64_t addr) = 0;
+
+  // resolve a batch of addresses at once, which resolvers can override to share work such as
+  // loading each module only once
+  virtual rdcarray<AddressDetails> GetAddrs(const rdcarray<uint64_t> &addrs)
+  {
+    rdcarray<AddressDetails> ret;
+    ret.reserve(addrs.size());
+    for(uint64_t addr : addrs)
+      ret.push_back(GetAddr(addr));
+    return ret;
+  }
 };
 
 void Init();
@@ -285,6 +300,8 @@ Stackwalk *Create();
 StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
                             RENDERDOC_ProgressCallback);
 
+// call first with buf NULL to get the size. Modules can be loaded in between, so if they no longer
+// fit in size bytes nothing is written, size is updated, and false is returned to try again.
 bool GetLoadedModules(byte *buf, size_t &size);
 };    // namespace Callstack
 
@@ -347,6 +364,18 @@ bool feof(FILE *f);
 
 int fclose(FILE *f);
 
+// map a read-only view of [offset, offset+length) in an open file. The offset does not need to be
+// aligned. Returns NULL if the file can't be mapped, in which case the caller should fall back to
+// reading normally. The view stays valid after the FILE is closed, until UnmapFileRange is called
+// with the same pointer and length.
+const byte *MapFileRange(FILE *f, uint64_t offset, uint64_t length);
+void UnmapFileRange(const byte *data, uint64_t length);
+// copy a mapped view into memory private to this process at the same address, so it's unaffected if
+// the file is then modified or truncated. Only possible if CanDetachFileRange() returns true,
+// otherwise the file can't be safely modified while any view of it is mapped.
+bool CanDetachFileRange();
+bool DetachFileRange(const byte *data, uint64_t length);
+
 // functions for atomically appending to a log that may be in use in multiple
 // processes
 struct LogFileHandle;
@@ -526,6 +555,32 @@ uint64_t GetMachineIdent();
 rdcstr MakeMachineIdentString(uint64_t ident);
 };
 
+// tracks which pages of a region of memory are written, by write-protecting the pages and catching
+// the fault on the first write to each. Only direct CPU writes are tracked - writes the kernel makes
+// on the process's behalf (e.g. read() into the memory) will fail with EFAULT while a page is
+// protected, so this must only be used when opted into.
+struct DiffRange;
+
+namespace WriteWatch
+{
+struct Region;
+
+bool IsSupported();
+
+// begin tracking writes to [base, base + size), which must be readable and writable. Returns NULL
+// if the region can't be tracked. Pages only partly covered by the region are not protected and
+// are always reported as dirty.
+Region *Watch(void *base, size_t size);
+
+// returns the [start, end) byte ranges relative to the base of the region that may have been
+// written since the last call or since Watch, and marks them clean again. Adjacent dirty pages are
+// returned as one range.
+void GetDirtyRanges(Region *region, rdcarray<DiffRange> &ranges);
+
+// stop tracking and restore write access to the whole region.
+void Unwatch(Region *region);
+};
+
 namespace Bits
 {
 inline uint32_t CountLeadingZeroes(uint32_t value);
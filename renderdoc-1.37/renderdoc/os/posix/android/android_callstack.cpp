@@ -22,9 +22,145 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+// for dl_iterate_phdr
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <elf.h>
+#include <link.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <unwind.h>
 #include "common/common.h"
+#include "common/formatting.h"
 #include "os/os_specific.h"
 
+// the executable range of our own library, so our frames can be trimmed from the top of stacks
+static uint64_t renderdocBase = 0;
+static uint64_t renderdocEnd = 0;
+
+// the bounds of each thread's stack, looked up once per thread. Frame pointers are only followed
+// while they stay inside these bounds. Kept in thread-local storage directly so nothing needs to
+// be freed when a thread exits.
+struct ThreadStackBounds
+{
+  bool queried;
+  uint64_t lo;
+  uint64_t hi;
+};
+
+static __thread ThreadStackBounds threadStackBounds;
+
+static const ThreadStackBounds *GetThreadStackBounds()
+{
+  ThreadStackBounds *bounds = &threadStackBounds;
+  if(bounds->queried)
+    return bounds;
+
+  bounds->queried = true;
+
+  pthread_attr_t attr;
+  if(pthread_getattr_np(pthread_self(), &attr) == 0)
+  {
+    void *addr = NULL;
+    size_t size = 0;
+    if(pthread_attr_getstack(&attr, &addr, &size) == 0)
+    {
+      bounds->lo = (uint64_t)(uintptr_t)addr;
+      bounds->hi = bounds->lo + size;
+    }
+    pthread_attr_destroy(&attr);
+  }
+
+  return bounds;
+}
+
+static uint64_t StripReturnAddress(uint64_t addr)
+{
+#if defined(__aarch64__)
+  // remove any pointer authentication code or tag in the upper bits
+  return addr & 0x0000ffffffffffffULL;
+#elif defined(__arm__)
+  // the low bit only indicates thumb mode
+  return addr & ~1ULL;
+#else
+  return addr;
+#endif
+}
+
+// walk the frame records linked through the frame pointer. Each record is the caller's frame
+// pointer followed by the return address, on both aarch64 and x86. This is just a few loads per
+// frame so it's cheap enough to run on every chunk, but it stops at the first frame from code built
+// without frame pointers.
+static size_t FramePointerWalk(uint64_t *addrs, size_t maxLevels)
+{
+#if defined(__aarch64__) || defined(__x86_64__) || defined(__i386__)
+  const ThreadStackBounds *bounds = GetThreadStackBounds();
+  if(bounds->hi == 0)
+    return 0;
+
+  size_t numLevels = 0;
+
+  uintptr_t fp = (uintptr_t)__builtin_frame_address(0);
+
+  while(numLevels < maxLevels)
+  {
+    if(fp < bounds->lo || fp + 2 * sizeof(uintptr_t) > bounds->hi || (fp % sizeof(uintptr_t)) != 0)
+      break;
+
+    const uintptr_t *record = (const uintptr_t *)fp;
+
+    const uint64_t ret = StripReturnAddress(record[1]);
+    if(ret == 0)
+      break;
+
+    addrs[numLevels++] = ret;
+
+    // stacks grow down, so each caller's frame must be higher than the last
+    if(record[0] <= fp)
+      break;
+
+    fp = record[0];
+  }
+
+  return numLevels;
+#else
+  // frame pointers on 32-bit ARM are in different registers for ARM and thumb code with no
+  // standard record layout, so they can't be followed reliably.
+  return 0;
+#endif
+}
+
+struct UnwindState
+{
+  uint64_t *addrs;
+  size_t numLevels;
+  size_t maxLevels;
+};
+
+static _Unwind_Reason_Code UnwindCallback(struct _Unwind_Context *context, void *data)
+{
+  UnwindState *state = (UnwindState *)data;
+
+  uint64_t ip = StripReturnAddress((uint64_t)_Unwind_GetIP(context));
+  if(ip == 0)
+    return _URC_END_OF_STACK;
+
+  state->addrs[state->numLevels++] = ip;
+
+  return state->numLevels < state->maxLevels ? _URC_NO_REASON : _URC_END_OF_STACK;
+}
+
+// walk the stack with the EH frame unwind tables. Slower than following frame pointers but works
+// for any code with unwind info, which the NDK emits by default.
+static size_t UnwindTableWalk(uint64_t *addrs, size_t maxLevels)
+{
+  UnwindState state = {addrs, 0, maxLevels};
+  _Unwind_Backtrace(&UnwindCallback, &state);
+  return state.numLevels;
+}
+
 class AndroidCallstack : public Callstack::Stackwalk
 {
 public:
@@ -32,29 +168,144 @@ public:
   {
     RDCEraseEl(addrs);
     numLevels = 0;
+    Collect();
   }
   AndroidCallstack(uint64_t *calls, size_t num) { Set(calls, num); }
   ~AndroidCallstack() {}
   void Set(uint64_t *calls, size_t num)
   {
-    numLevels = num;
-    for(int i = 0; i < numLevels; i++)
+    numLevels = RDCMIN(num, ARRAY_COUNT(addrs));
+    for(size_t i = 0; i < numLevels; i++)
       addrs[i] = calls[i];
   }
 
-  size_t NumLevels() const { return 0; }
+  size_t NumLevels() const { return numLevels; }
   const uint64_t *GetAddrs() const { return addrs; }
 private:
   AndroidCallstack(const Callstack::Stackwalk &other);
 
+  void Collect()
+  {
+    uint64_t raw[ARRAY_COUNT(addrs)];
+
+    size_t num = FramePointerWalk(raw, ARRAY_COUNT(raw));
+
+    // if the frame pointer chain ended inside our own library, it's broken before reaching the
+    // application, so fall back to the unwind tables.
+    if(num == 0 || (raw[num - 1] >= renderdocBase && raw[num - 1] < renderdocEnd))
+      num = UnwindTableWalk(raw, ARRAY_COUNT(raw));
+
+    size_t offs = 0;
+    while(offs < num && raw[offs] >= renderdocBase && raw[offs] < renderdocEnd)
+      offs++;
+
+    numLevels = num - offs;
+    memcpy(addrs, raw + offs, numLevels * sizeof(uint64_t));
+  }
+
   uint64_t addrs[128];
-  int numLevels;
+  size_t numLevels;
 };
 
+static int FindOwnModuleCallback(struct dl_phdr_info *info, size_t size, void *data)
+{
+  const uint64_t self = (uint64_t)(uintptr_t)data;
+
+  for(int j = 0; j < info->dlpi_phnum; j++)
+  {
+    const ElfW(Phdr) &phdr = info->dlpi_phdr[j];
+    if(phdr.p_type == PT_LOAD && (phdr.p_flags & PF_X))
+    {
+      const uint64_t base = info->dlpi_addr + phdr.p_vaddr;
+      if(self >= base && self < base + phdr.p_memsz)
+      {
+        renderdocBase = base;
+        renderdocEnd = base + phdr.p_memsz;
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+static rdcstr GetBuildID(struct dl_phdr_info *info)
+{
+  for(int j = 0; j < info->dlpi_phnum; j++)
+  {
+    const ElfW(Phdr) &phdr = info->dlpi_phdr[j];
+    if(phdr.p_type != PT_NOTE)
+      continue;
+
+    // the notes are loaded, so we can read them in place without touching the file
+    const byte *note = (const byte *)(uintptr_t)(info->dlpi_addr + phdr.p_vaddr);
+    const byte *end = note + phdr.p_memsz;
+
+    while(note + sizeof(ElfW(Nhdr)) <= end)
+    {
+      const ElfW(Nhdr) *nhdr = (const ElfW(Nhdr) *)note;
+      const byte *name = note + sizeof(ElfW(Nhdr));
+      const byte *desc = name + AlignUp4(nhdr->n_namesz);
+      const byte *next = desc + AlignUp4(nhdr->n_descsz);
+
+      if(next > end)
+        break;
+
+      if(nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && memcmp(name, "GNU", 4) == 0)
+      {
+        rdcstr ret;
+        for(uint32_t b = 0; b < nhdr->n_descsz; b++)
+          ret += StringFormat::Fmt("%02x", desc[b]);
+        return ret;
+      }
+
+      note = next;
+    }
+  }
+
+  return "-";
+}
+
+static int ModuleDBCallback(struct dl_phdr_info *info, size_t size, void *data)
+{
+  rdcstr *out = (rdcstr *)data;
+
+  rdcstr name = info->dlpi_name ? info->dlpi_name : "";
+  if(name.empty())
+  {
+    char exe[1024] = {};
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if(len > 0)
+      name = rdcstr(exe, len);
+  }
+
+  if(name.empty())
+    return 0;
+
+  rdcstr buildID;
+
+  for(int j = 0; j < info->dlpi_phnum; j++)
+  {
+    const ElfW(Phdr) &phdr = info->dlpi_phdr[j];
+    if(phdr.p_type == PT_LOAD && (phdr.p_flags & PF_X))
+    {
+      if(buildID.empty())
+        buildID = GetBuildID(info);
+
+      const uint64_t base = info->dlpi_addr + phdr.p_vaddr;
+      *out += StringFormat::Fmt("%llx-%llx %llx %s %s\n", base, base + phdr.p_memsz,
+                                (uint64_t)phdr.p_vaddr, buildID.c_str(), name.c_str());
+    }
+  }
+
+  return 0;
+}
+
 namespace Callstack
 {
 void Init()
 {
+  dl_iterate_phdr(&FindOwnModuleCallback, (void *)&FindOwnModuleCallback);
 }
 
 Stackwalk *Collect()
@@ -69,12 +320,27 @@ Stackwalk *Create()
 
 bool GetLoadedModules(byte *buf, size_t &size)
 {
-  size = 0;
+  // the executable segment of each module, one per line as:
+  //   base-end vaddr buildid path
+  // with hex addresses and '-' if the module has no build ID. Callstacks are resolved on the host
+  // by finding unstripped copies of the libraries, see the Linux resolver.
+  rdcstr modules;
+  dl_iterate_phdr(&ModuleDBCallback, &modules);
+
+  // a library may have been loaded since the size was queried
+  if(buf && size < 8 + modules.size())
+  {
+    size = 8 + modules.size();
+    return false;
+  }
 
   if(buf)
+  {
     memcpy(buf, "ANRDCALL", 8);
+    memcpy(buf + 8, modules.data(), modules.size());
+  }
 
-  size += 8;
+  size = 8 + modules.size();
 
   return true;
 }
@@ -82,7 +348,7 @@ bool GetLoadedModules(byte *buf, size_t &size)
 StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
                             RENDERDOC_ProgressCallback progress)
 {
-  RDCERR("Callstack resolving not supported on Android.");
+  RDCERR("Callstack resolving not supported on Android, callstacks are resolved on the host.");
   return NULL;
 }
 };
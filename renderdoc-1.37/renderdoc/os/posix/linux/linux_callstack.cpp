@@ -34,7 +34,14 @@
 #include <map>
 #include "common/common.h"
 #include "common/formatting.h"
+#include "core/settings.h"
 #include "os/os_specific.h"
+#include "os/posix/posix_symbolizer.h"
+#include "strings/string_utils.h"
+
+RDOC_CONFIG(rdcstr, Android_SymbolSearchPath, "",
+            "Semicolon-separated list of directories to search for unstripped copies of Android "
+            "libraries when resolving callstacks from captures made on a device.");
 
 void *renderdocBase = NULL;
 void *renderdocEnd = NULL;
@@ -158,16 +165,6 @@ static int dl_iterate_callback(struct dl_phdr_info *info, size_t size, void *dat
 
 bool GetLoadedModules(byte *buf, size_t &size)
 {
-  size = 0;
-
-  if(buf)
-  {
-    memcpy(buf, "LNUXCALL", 8);
-    buf += 8;
-  }
-
-  size += 8;
-
   // generate a fake /proc/self/maps. This is mostly for backwards compatibility, we could generate
   // a more compact representation. The slight difference is that we change how we calculate the
   // offset for each segment, so that we handle non-PIE executables properly.
@@ -175,106 +172,118 @@ bool GetLoadedModules(byte *buf, size_t &size)
 
   dl_iterate_phdr(dl_iterate_callback, &fake_maps);
 
-  size += fake_maps.size();
+  // a library may have been loaded since the size was queried
+  if(buf && size < 8 + fake_maps.size())
+  {
+    size = 8 + fake_maps.size();
+    return false;
+  }
 
   if(buf)
-    memcpy(buf, fake_maps.data(), fake_maps.size());
+  {
+    memcpy(buf, "LNUXCALL", 8);
+    memcpy(buf + 8, fake_maps.data(), fake_maps.size());
+  }
+
+  size = 8 + fake_maps.size();
 
   return true;
 }
 
-struct LookupModule
+// find an unstripped copy on this machine of a library from an Android device. The search
+// directories are checked for a matching build ID in the same layout as /usr/lib/debug, then for
+// the library's full device path (e.g. a directory of libraries pulled from the device) and then
+// its filename (e.g. the app's build output).
+static rdcstr FindAndroidModule(const rdcstr &devicePath, const rdcstr &buildID)
 {
-  uint64_t base;
-  uint64_t end;
-  uint64_t offset;
-  char path[2048];
-};
+  rdcarray<rdcstr> dirs;
+  split(Android_SymbolSearchPath(), dirs, ';');
 
-class LinuxResolver : public Callstack::StackResolver
-{
-public:
-  LinuxResolver(rdcarray<LookupModule> modules) { m_Modules = modules; }
-  Callstack::AddressDetails GetAddr(uint64_t addr)
-  {
-    EnsureCached(addr);
+  // libraries loaded directly from inside an APK are named apk!/path/in/apk
+  rdcstr filename = get_basename(devicePath);
 
-    return m_Cache[addr];
+  for(rdcstr dir : dirs)
+  {
+    dir.trim();
+    if(dir.empty())
+      continue;
+
+    while(dir.size() > 1 && dir.back() == '/')
+      dir.pop_back();
+
+    rdcarray<rdcstr> candidates;
+    if(buildID.size() > 2)
+      candidates.push_back(StringFormat::Fmt("%s/.build-id/%s/%s.debug", dir.c_str(),
+                                             buildID.substr(0, 2).c_str(),
+                                             buildID.substr(2).c_str()));
+    candidates.push_back(dir + devicePath);
+    candidates.push_back(dir + "/" + filename);
+
+    for(const rdcstr &candidate : candidates)
+      if(FileIO::exists(candidate))
+        return candidate;
   }
 
-private:
-  void EnsureCached(uint64_t addr)
-  {
-    auto it = m_Cache.insert(
-        std::pair<uint64_t, Callstack::AddressDetails>(addr, Callstack::AddressDetails()));
-    if(!it.second)
-      return;
+  return rdcstr();
+}
 
-    Callstack::AddressDetails &ret = it.first->second;
+static StackResolver *MakeAndroidResolver(byte *moduleDB, size_t DBSize,
+                                          RENDERDOC_ProgressCallback progress)
+{
+  // see GetLoadedModules in android_callstack.cpp for the format
+  rdcstr db((const char *)moduleDB + 8, DBSize - 8);
 
-    ret.filename = "Unknown";
-    ret.line = 0;
-    ret.function = StringFormat::Fmt("0x%08llx", addr);
+  rdcarray<rdcstr> lines;
+  split(db, lines, '\n');
 
-    for(size_t i = 0; i < m_Modules.size(); i++)
-    {
-      if(addr >= m_Modules[i].base && addr < m_Modules[i].end)
-      {
-        RDCLOG("%llx relative to module %llx-%llx, with offset %llx", addr, m_Modules[i].base,
-               m_Modules[i].end, m_Modules[i].offset);
-        uint64_t relative = addr - m_Modules[i].base + m_Modules[i].offset;
-        rdcstr cmd = StringFormat::Fmt("addr2line -fCe \"%s\" 0x%llx", m_Modules[i].path, relative);
+  rdcarray<ELFModuleMapping> modules;
+  // the host path found for each device path, so each library is only searched for once
+  std::map<rdcstr, rdcstr> hostPaths;
 
-        RDCLOG(": %s", cmd.c_str());
+  for(size_t i = 0; i < lines.size(); i++)
+  {
+    if(progress)
+      progress(float(i) / float(lines.size()));
 
-        FILE *f = ::popen(cmd.c_str(), "r");
+    unsigned long long base = 0, end = 0, offset = 0;
+    char buildID[128] = {};
+    int offs = 0;
+    int num = sscanf(lines[i].c_str(), "%llx-%llx %llx %127s %n", &base, &end, &offset, buildID,
+                     &offs);
 
-        char result[2048] = {0};
-        fread(result, 1, 2047, f);
+    if(num != 4 || offs <= 0 || (size_t)offs >= lines[i].size())
+      continue;
 
-        ::pclose(f);
+    ELFModuleMapping mod;
+    mod.base = base;
+    mod.end = end;
+    mod.offset = offset;
+    if(strcmp(buildID, "-") != 0)
+      mod.buildID = buildID;
 
-        char *line2 = strchr(result, '\n');
-        if(line2)
-        {
-          *line2 = 0;
-          line2++;
-        }
+    rdcstr devicePath = lines[i].substr(offs);
 
-        ret.function = result;
+    auto it = hostPaths.find(devicePath);
+    if(it == hostPaths.end())
+    {
+      rdcstr hostPath = FindAndroidModule(devicePath, mod.buildID);
+      if(hostPath.empty())
+        RDCLOG("No local copy of %s found for resolving callstacks", devicePath.c_str());
+      it = hostPaths.insert(std::make_pair(devicePath, hostPath)).first;
+    }
 
-        if(line2)
-        {
-          char *linenum = line2 + strlen(line2) - 1;
-          while(linenum > line2 && *linenum != ':')
-            linenum--;
-
-          ret.line = 0;
-
-          if(*linenum == ':')
-          {
-            *linenum = 0;
-            linenum++;
-
-            while(*linenum >= '0' && *linenum <= '9')
-            {
-              ret.line *= 10;
-              ret.line += (uint32_t(*linenum) - uint32_t('0'));
-              linenum++;
-            }
-          }
-
-          ret.filename = line2;
-        }
+    // if there's no local copy keep the device path, addresses in it will still be reported
+    // relative to the library
+    mod.path = it->second.empty() ? devicePath : it->second;
 
-        break;
-      }
-    }
+    modules.push_back(mod);
   }
 
-  rdcarray<LookupModule> m_Modules;
-  std::map<uint64_t, Callstack::AddressDetails> m_Cache;
-};
+  if(progress)
+    progress(1.0f);
+
+  return MakeELFResolver(modules);
+}
 
 StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
                             RENDERDOC_ProgressCallback progress)
@@ -284,6 +293,9 @@ StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
   // the file is the right version). A good option for doing this would be
   // http://github.com/mlabbe/nativefiledialog
 
+  if(DBSize >= 8 && memcmp(moduleDB, "ANRDCALL", 8) == 0)
+    return MakeAndroidResolver(moduleDB, DBSize, progress);
+
   if(DBSize < 8 || memcmp(moduleDB, "LNUXCALL", 8))
   {
     RDCWARN("Can't load callstack resolve for this log. Possibly from another platform?");
@@ -294,7 +306,7 @@ StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
   char *search = start;
   char *dbend = (char *)(moduleDB + DBSize);
 
-  rdcarray<LookupModule> modules;
+  rdcarray<ELFModuleMapping> modules;
 
   while(search && search < dbend)
   {
@@ -315,7 +327,7 @@ StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
       // we read all 4 params (and so perms == r-xp)
       if(num == 4 && offs > 0)
       {
-        LookupModule mod = {0};
+        ELFModuleMapping mod;
 
         mod.base = (uint64_t)base;
         mod.end = (uint64_t)end;
@@ -327,22 +339,11 @@ StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
 
         if(search < dbend && *search != '[' && *search != 0 && *search != '\n')
         {
-          size_t n = ARRAY_COUNT(mod.path) - 1;
-          mod.path[n] = 0;
-          for(size_t i = 0; i < n; i++)
-          {
-            if(search[i] == 0 || search[i] == '\n')
-            {
-              mod.path[i] = 0;
-              break;
-            }
-            if(search + i >= dbend)
-            {
-              mod.path[i] = 0;
-              break;
-            }
-            mod.path[i] = search[i];
-          }
+          const char *pathEnd = search;
+          while(pathEnd < dbend && *pathEnd != 0 && *pathEnd != '\n')
+            pathEnd++;
+
+          mod.path = rdcstr(search, pathEnd - search);
 
           modules.push_back(mod);
         }
@@ -360,6 +361,6 @@ StackResolver *MakeResolver(bool interactive, byte *moduleDB, size_t DBSize,
       search++;
   }
 
-  return new LinuxResolver(modules);
+  return MakeELFResolver(modules);
 }
 };
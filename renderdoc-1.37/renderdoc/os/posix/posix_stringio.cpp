@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -463,6 +464,81 @@ int fclose(FILE *f)
   return ::fclose(f);
 }
 
+const byte *MapFileRange(FILE *f, uint64_t offset, uint64_t length)
+{
+  if(length == 0)
+    return NULL;
+
+  // mmap requires a page-aligned offset, so map from the page containing offset and return a
+  // pointer into it
+  uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t delta = offset % pageSize;
+
+  void *base = ::mmap(NULL, (size_t)(length + delta), PROT_READ, MAP_PRIVATE, ::fileno(f),
+                      (off_t)(offset - delta));
+
+  if(base == MAP_FAILED)
+    return NULL;
+
+  ::madvise(base, (size_t)(length + delta), MADV_SEQUENTIAL);
+
+  return (const byte *)base + delta;
+}
+
+void UnmapFileRange(const byte *data, uint64_t length)
+{
+  if(!data)
+    return;
+
+  uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t delta = uint64_t((uintptr_t)data % pageSize);
+
+  ::munmap((void *)(data - delta), (size_t)(length + delta));
+}
+
+bool CanDetachFileRange()
+{
+#if ENABLED(RDOC_LINUX) || ENABLED(RDOC_ANDROID)
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool DetachFileRange(const byte *data, uint64_t length)
+{
+  if(!data)
+    return true;
+
+#if ENABLED(RDOC_LINUX) || ENABLED(RDOC_ANDROID)
+  size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+  size_t delta = size_t((uintptr_t)data % pageSize);
+
+  byte *base = (byte *)data - delta;
+  size_t size = AlignUp((size_t)length + delta, pageSize);
+
+  // truncating the file discards even private copies of its pages, so the view has to be replaced
+  // entirely. Copy it into anonymous memory and move that over the view, so that it changes
+  // atomically for anyone still reading from it
+  void *copy = ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(copy == MAP_FAILED)
+    return false;
+
+  memcpy(copy, base, size);
+  ::mprotect(copy, size, PROT_READ);
+
+  if(::mremap(copy, size, size, MREMAP_MAYMOVE | MREMAP_FIXED, base) == MAP_FAILED)
+  {
+    ::munmap(copy, size);
+    return false;
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
+
 bool IsUntrustedFile(const rdcstr &filename)
 {
   // do android/linux have any way of marking files as potentially unsafe?
@@ -0,0 +1,1232 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "posix_symbolizer.h"
+#include <cxxabi.h>
+#include <elf.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "common/formatting.h"
+#include "common/threading.h"
+#include "miniz/miniz.h"
+#include "strings/string_utils.h"
+
+static const char SymbolCacheMagic[8] = {'R', 'D', 'S', 'Y', 'M', 'I', 'D', 'X'};
+static const uint32_t SymbolCacheVersion = 2;
+
+// not all elf.h versions have the compressed section header, so declare our own
+struct ELF32CompressionHeader
+{
+  uint32_t ch_type;
+  uint32_t ch_size;
+  uint32_t ch_addralign;
+};
+
+struct ELF64CompressionHeader
+{
+  uint32_t ch_type;
+  uint32_t ch_reserved;
+  uint64_t ch_size;
+  uint64_t ch_addralign;
+};
+
+static const uint32_t ELFSectionCompressed = 0x800;
+static const uint32_t ELFCompressZlib = 1;
+
+struct ELF32Types
+{
+  typedef Elf32_Ehdr Ehdr;
+  typedef Elf32_Shdr Shdr;
+  typedef Elf32_Sym Sym;
+  typedef ELF32CompressionHeader Chdr;
+};
+
+struct ELF64Types
+{
+  typedef Elf64_Ehdr Ehdr;
+  typedef Elf64_Shdr Shdr;
+  typedef Elf64_Sym Sym;
+  typedef ELF64CompressionHeader Chdr;
+};
+
+namespace
+{
+// little-endian reader for DWARF data. Reading past the end returns zeroes and flags the error,
+// so parsing can check once at the end of a structure.
+struct DWARFReader
+{
+  const byte *cur;
+  const byte *end;
+  bool error = false;
+
+  DWARFReader(const byte *start, const byte *e) : cur(start), end(e) {}
+
+  size_t Remaining() const { return size_t(end - cur); }
+
+  uint64_t ReadFixed(size_t bytes)
+  {
+    if(bytes > sizeof(uint64_t) || Remaining() < bytes)
+    {
+      error = true;
+      cur = end;
+      return 0;
+    }
+
+    uint64_t ret = 0;
+    for(size_t i = 0; i < bytes; i++)
+      ret |= uint64_t(cur[i]) << (i * 8);
+    cur += bytes;
+    return ret;
+  }
+
+  uint8_t ReadU8() { return (uint8_t)ReadFixed(1); }
+  uint16_t ReadU16() { return (uint16_t)ReadFixed(2); }
+  uint32_t ReadU32() { return (uint32_t)ReadFixed(4); }
+  uint64_t ReadU64() { return ReadFixed(8); }
+
+  uint64_t ReadULEB()
+  {
+    uint64_t ret = 0;
+    uint32_t shift = 0;
+    while(cur < end)
+    {
+      byte b = *(cur++);
+      if(shift < 64)
+        ret |= uint64_t(b & 0x7f) << shift;
+      shift += 7;
+      if((b & 0x80) == 0)
+        return ret;
+    }
+    error = true;
+    return ret;
+  }
+
+  int64_t ReadSLEB()
+  {
+    int64_t ret = 0;
+    uint32_t shift = 0;
+    while(cur < end)
+    {
+      byte b = *(cur++);
+      if(shift < 64)
+        ret |= int64_t(b & 0x7f) << shift;
+      shift += 7;
+      if((b & 0x80) == 0)
+      {
+        if(shift < 64 && (b & 0x40))
+          ret |= -(int64_t(1) << shift);
+        return ret;
+      }
+    }
+    error = true;
+    return ret;
+  }
+
+  rdcstr ReadString()
+  {
+    const byte *start = cur;
+    while(cur < end && *cur)
+      cur++;
+
+    if(cur >= end)
+    {
+      error = true;
+      return rdcstr();
+    }
+
+    rdcstr ret((const char *)start, cur - start);
+    cur++;
+    return ret;
+  }
+
+  void Skip(uint64_t bytes)
+  {
+    if(Remaining() < bytes)
+    {
+      error = true;
+      cur = end;
+      return;
+    }
+    cur += bytes;
+  }
+};
+
+// a section's contents, either pointing into the mapped file or into decompressed storage
+struct ELFSection
+{
+  const byte *data = NULL;
+  size_t size = 0;
+};
+
+rdcstr StringFromTable(const byte *table, size_t tableSize, uint64_t offset)
+{
+  if(table == NULL || offset >= tableSize)
+    return rdcstr();
+
+  const char *str = (const char *)table + offset;
+  return rdcstr(str, strnlen(str, tableSize - (size_t)offset));
+}
+
+rdcstr JoinPath(const rdcstr &dir, const rdcstr &name)
+{
+  if(dir.empty() || name.empty() || name[0] == '/')
+    return name;
+  if(dir.back() == '/')
+    return dir + name;
+  return dir + "/" + name;
+}
+
+// linkers write these as the address of sequences from functions they discarded
+bool IsTombstoneAddress(uint64_t addr)
+{
+  return addr == 0 || addr == ~0ULL || addr == ~1ULL || addr == 0xffffffffULL ||
+         addr == 0xfffffffeULL;
+}
+
+uint64_t HashPath(const rdcstr &path)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for(char c : path)
+  {
+    hash ^= (byte)c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+enum
+{
+  DW_LNS_copy = 1,
+  DW_LNS_advance_pc = 2,
+  DW_LNS_advance_line = 3,
+  DW_LNS_set_file = 4,
+  DW_LNS_const_add_pc = 8,
+  DW_LNS_fixed_advance_pc = 9,
+
+  DW_LNE_end_sequence = 1,
+  DW_LNE_set_address = 2,
+
+  DW_LNCT_path = 1,
+  DW_LNCT_directory_index = 2,
+
+  DW_FORM_data2 = 0x05,
+  DW_FORM_data4 = 0x06,
+  DW_FORM_data8 = 0x07,
+  DW_FORM_string = 0x08,
+  DW_FORM_block = 0x09,
+  DW_FORM_data1 = 0x0b,
+  DW_FORM_strp = 0x0e,
+  DW_FORM_udata = 0x0f,
+  DW_FORM_data16 = 0x1e,
+  DW_FORM_line_strp = 0x1f,
+};
+};    // anonymous namespace
+
+uint32_t ELFSymbolIndex::AddString(const rdcstr &str)
+{
+  uint32_t ret = (uint32_t)m_Strings.size();
+  m_Strings.append(str.c_str(), str.size());
+  m_Strings.push_back(0);
+  return ret;
+}
+
+const char *ELFSymbolIndex::GetString(uint32_t offs) const
+{
+  if(offs >= m_Strings.size())
+    return "";
+  return m_Strings.data() + offs;
+}
+
+bool ELFSymbolIndex::Load(const rdcstr &path)
+{
+  const uint64_t fileSize = FileIO::GetFileSize(path);
+  const uint64_t timestamp = FileIO::GetModifiedTimestamp(path);
+
+  if(fileSize == 0)
+    return false;
+
+  const rdcstr cachePath = FileIO::GetAppFolderFilename(
+      StringFormat::Fmt("symbol_cache/%016llx.rdsym", HashPath(path)));
+
+  if(ReadCache(cachePath, fileSize, timestamp, path))
+    return true;
+
+  // discard anything read from a stale or corrupt cache
+  *this = ELFSymbolIndex();
+
+  if(!ParseFile(path, false))
+    return false;
+
+  // if the module has been stripped of its line tables, look for separate debug info
+  if(m_Rows.empty())
+  {
+    rdcarray<rdcstr> candidates;
+
+    if(m_BuildID.size() > 2)
+      candidates.push_back(StringFormat::Fmt("/usr/lib/debug/.build-id/%s/%s.debug",
+                                             m_BuildID.substr(0, 2).c_str(),
+                                             m_BuildID.substr(2).c_str()));
+
+    if(!m_DebugLink.empty())
+    {
+      rdcstr dir = get_dirname(path);
+      candidates.push_back(dir + "/" + m_DebugLink);
+      candidates.push_back(dir + "/.debug/" + m_DebugLink);
+      candidates.push_back("/usr/lib/debug" + dir + "/" + m_DebugLink);
+    }
+
+    for(const rdcstr &candidate : candidates)
+    {
+      if(candidate != path && FileIO::exists(candidate) && ParseFile(candidate, true))
+        break;
+    }
+  }
+
+  FinaliseIndex();
+
+  WriteCache(cachePath, fileSize, timestamp, path);
+
+  return true;
+}
+
+bool ELFSymbolIndex::ParseFile(const rdcstr &path, bool debugFile)
+{
+  FILE *f = FileIO::fopen(path, FileIO::ReadBinary);
+  if(!f)
+    return false;
+
+  const uint64_t size = FileIO::GetFileSize(path);
+
+  // map the file so that only the sections we need are ever paged in
+  const byte *data = FileIO::MapFileRange(f, 0, size);
+
+  bytebuf contents;
+  if(!data)
+  {
+    contents.resize((size_t)size);
+    if(FileIO::fread(contents.data(), 1, contents.size(), f) != contents.size())
+      contents.clear();
+    data = contents.data();
+  }
+
+  FileIO::fclose(f);
+
+  bool ret = false;
+
+  if(size >= EI_NIDENT && data && memcmp(data, ELFMAG, SELFMAG) == 0 &&
+     data[EI_DATA] == ELFDATA2LSB)
+  {
+    if(data[EI_CLASS] == ELFCLASS64)
+      ret = ParseELF<ELF64Types>(data, (size_t)size, debugFile);
+    else if(data[EI_CLASS] == ELFCLASS32)
+      ret = ParseELF<ELF32Types>(data, (size_t)size, debugFile);
+  }
+
+  if(!ret)
+    RDCWARN("Couldn't parse '%s' as an ELF file", path.c_str());
+
+  if(contents.empty() && data)
+    FileIO::UnmapFileRange(data, size);
+
+  return ret;
+}
+
+template <typename ELFTypes>
+bool ELFSymbolIndex::ParseELF(const byte *data, size_t size, bool debugFile)
+{
+  typedef typename ELFTypes::Ehdr Ehdr;
+  typedef typename ELFTypes::Shdr Shdr;
+  typedef typename ELFTypes::Sym Sym;
+  typedef typename ELFTypes::Chdr Chdr;
+
+  if(size < sizeof(Ehdr))
+    return false;
+
+  Ehdr ehdr;
+  memcpy(&ehdr, data, sizeof(ehdr));
+
+  if(ehdr.e_shoff == 0 || ehdr.e_shentsize < sizeof(Shdr) || ehdr.e_shstrndx >= ehdr.e_shnum ||
+     ehdr.e_shoff + uint64_t(ehdr.e_shnum) * ehdr.e_shentsize > size)
+    return false;
+
+  if(!debugFile)
+    m_Thumb = (ehdr.e_machine == EM_ARM);
+
+  rdcarray<Shdr> sections;
+  sections.resize(ehdr.e_shnum);
+  for(size_t i = 0; i < sections.size(); i++)
+    memcpy(&sections[i], data + ehdr.e_shoff + i * ehdr.e_shentsize, sizeof(Shdr));
+
+  auto rawSection = [&](size_t idx) {
+    ELFSection ret;
+    if(idx < sections.size() && sections[idx].sh_type != SHT_NOBITS &&
+       sections[idx].sh_offset + sections[idx].sh_size <= size)
+    {
+      ret.data = data + sections[idx].sh_offset;
+      ret.size = (size_t)sections[idx].sh_size;
+    }
+    return ret;
+  };
+
+  const ELFSection shstrtab = rawSection(ehdr.e_shstrndx);
+
+  // storage for any sections we had to decompress, alive until we're done parsing
+  rdcarray<bytebuf> decompressed;
+
+  auto findSection = [&](const rdcstr &name) -> ELFSection {
+    for(size_t i = 0; i < sections.size(); i++)
+    {
+      const rdcstr secName = StringFromTable(shstrtab.data, shstrtab.size, sections[i].sh_name);
+      const bool gnuCompressed = (secName == ".z" + name.substr(1));
+
+      if(secName != name && !gnuCompressed)
+        continue;
+
+      ELFSection ret = rawSection(i);
+
+      uint64_t uncompSize = 0;
+      const byte *compData = NULL;
+      size_t compSize = 0;
+
+      if(sections[i].sh_flags & ELFSectionCompressed)
+      {
+        Chdr chdr;
+        if(ret.size < sizeof(chdr))
+          return ELFSection();
+        memcpy(&chdr, ret.data, sizeof(chdr));
+        if(chdr.ch_type != ELFCompressZlib)
+          return ELFSection();
+        uncompSize = chdr.ch_size;
+        compData = ret.data + sizeof(chdr);
+        compSize = ret.size - sizeof(chdr);
+      }
+      else if(gnuCompressed)
+      {
+        // the older GNU format, "ZLIB" followed by the big-endian uncompressed size
+        if(ret.size < 12 || memcmp(ret.data, "ZLIB", 4) != 0)
+          return ELFSection();
+        for(int b = 0; b < 8; b++)
+          uncompSize = (uncompSize << 8) | ret.data[4 + b];
+        compData = ret.data + 12;
+        compSize = ret.size - 12;
+      }
+      else
+      {
+        return ret;
+      }
+
+      bytebuf uncomp;
+      uncomp.resize((size_t)uncompSize);
+      mz_ulong destLen = (mz_ulong)uncompSize;
+      if(mz_uncompress(uncomp.data(), &destLen, compData, (mz_ulong)compSize) != MZ_OK)
+      {
+        RDCWARN("Couldn't decompress %s", secName.c_str());
+        return ELFSection();
+      }
+      uncomp.resize((size_t)destLen);
+
+      decompressed.push_back(std::move(uncomp));
+      ret.data = decompressed.back().data();
+      ret.size = decompressed.back().size();
+      return ret;
+    }
+
+    return ELFSection();
+  };
+
+  // function symbols from both the full and dynamic symbol tables. Duplicates are removed once all
+  // are added
+  for(size_t i = 0; i < sections.size(); i++)
+  {
+    if(sections[i].sh_type != SHT_SYMTAB && sections[i].sh_type != SHT_DYNSYM)
+      continue;
+
+    const ELFSection symtab = rawSection(i);
+    const ELFSection strtab = rawSection(sections[i].sh_link);
+
+    if(!symtab.data || !strtab.data)
+      continue;
+
+    const size_t numSyms = symtab.size / sizeof(Sym);
+    for(size_t s = 0; s < numSyms; s++)
+    {
+      Sym sym;
+      memcpy(&sym, symtab.data + s * sizeof(Sym), sizeof(Sym));
+
+      const uint32_t type = sym.st_info & 0xf;
+      if((type != STT_FUNC && type != STT_GNU_IFUNC) || sym.st_shndx == SHN_UNDEF ||
+         sym.st_value == 0)
+        continue;
+
+      rdcstr name = StringFromTable(strtab.data, strtab.size, sym.st_name);
+      if(name.empty())
+        continue;
+
+      uint64_t addr = sym.st_value;
+      // the low bit of ARM function addresses indicates thumb code
+      if(m_Thumb)
+        addr &= ~1ULL;
+
+      m_Functions.push_back({addr, (uint64_t)sym.st_size, AddString(name)});
+    }
+  }
+
+  const ELFSection debugLine = findSection(".debug_line");
+  if(debugLine.data)
+  {
+    const ELFSection lineStr = findSection(".debug_line_str");
+    const ELFSection str = findSection(".debug_str");
+    ParseLineTable(debugLine.data, debugLine.size, lineStr.data, lineStr.size, str.data, str.size);
+  }
+
+  if(!debugFile)
+  {
+    const ELFSection buildID = findSection(".note.gnu.build-id");
+    // namesz, descsz, type, then the name "GNU\0" and the ID itself
+    if(buildID.data && buildID.size >= 16)
+    {
+      uint32_t namesz, descsz;
+      memcpy(&namesz, buildID.data, sizeof(namesz));
+      memcpy(&descsz, buildID.data + 4, sizeof(descsz));
+      const size_t descOffs = 12 + AlignUp4(namesz);
+      if(descOffs + descsz <= buildID.size)
+      {
+        for(uint32_t b = 0; b < descsz; b++)
+          m_BuildID += StringFormat::Fmt("%02x", buildID.data[descOffs + b]);
+      }
+    }
+
+    const ELFSection debugLink = findSection(".gnu_debuglink");
+    if(debugLink.data)
+      m_DebugLink = StringFromTable(debugLink.data, debugLink.size, 0);
+  }
+
+  return true;
+}
+
+void ELFSymbolIndex::ParseLineTable(const byte *data, size_t size, const byte *lineStr,
+                                    size_t lineStrSize, const byte *str, size_t strSize)
+{
+  DWARFReader reader(data, data + size);
+
+  while(reader.Remaining() > 0 && !reader.error)
+  {
+    bool dwarf64 = false;
+    uint64_t unitLength = reader.ReadU32();
+    if(unitLength == 0xffffffffULL)
+    {
+      dwarf64 = true;
+      unitLength = reader.ReadU64();
+    }
+
+    if(reader.error || unitLength > reader.Remaining())
+      break;
+
+    const byte *unitEnd = reader.cur + unitLength;
+    DWARFReader unit(reader.cur, unitEnd);
+    reader.cur = unitEnd;
+
+    const uint16_t version = unit.ReadU16();
+    if(version < 2 || version > 5)
+      continue;
+
+    if(version >= 5)
+    {
+      unit.ReadU8();    // address_size
+      unit.ReadU8();    // segment_selector_size
+    }
+
+    const uint64_t headerLength = dwarf64 ? unit.ReadU64() : unit.ReadU32();
+    if(unit.error || headerLength > unit.Remaining())
+      continue;
+
+    const byte *programStart = unit.cur + headerLength;
+
+    const uint8_t minInstLength = unit.ReadU8();
+    if(version >= 4)
+      unit.ReadU8();    // maximum_operations_per_instruction, only used for VLIW
+    unit.ReadU8();      // default_is_stmt
+    const int8_t lineBase = (int8_t)unit.ReadU8();
+    const uint8_t lineRange = unit.ReadU8();
+    const uint8_t opcodeBase = unit.ReadU8();
+
+    if(lineRange == 0 || opcodeBase == 0)
+      continue;
+
+    rdcarray<uint8_t> opcodeLengths;
+    for(uint8_t i = 1; i < opcodeBase; i++)
+      opcodeLengths.push_back(unit.ReadU8());
+
+    rdcarray<rdcstr> dirs;
+    // the index of each file in m_Files
+    rdcarray<uint32_t> fileIds;
+
+    auto addFile = [this, &dirs](const rdcstr &name, uint64_t dirIdx) {
+      rdcstr path = name;
+      if(dirIdx < dirs.size())
+        path = JoinPath(dirs[(size_t)dirIdx], name);
+
+      auto it = m_FileIndices.find(path);
+      if(it != m_FileIndices.end())
+        return it->second;
+
+      uint32_t ret = (uint32_t)m_Files.size();
+      m_Files.push_back(AddString(path));
+      m_FileIndices[path] = ret;
+      return ret;
+    };
+
+    if(version >= 5)
+    {
+      bool supported = true;
+
+      // reads a directory or file table, calling the callback with the path and directory index
+      auto readEntries = [&](std::function<void(const rdcstr &, uint64_t)> callback) {
+        rdcarray<rdcpair<uint64_t, uint64_t>> formats;
+        const uint8_t formatCount = unit.ReadU8();
+        for(uint8_t i = 0; i < formatCount; i++)
+        {
+          uint64_t contentType = unit.ReadULEB();
+          uint64_t form = unit.ReadULEB();
+          formats.push_back({contentType, form});
+        }
+
+        const uint64_t count = unit.ReadULEB();
+        for(uint64_t e = 0; e < count && supported && !unit.error; e++)
+        {
+          rdcstr path;
+          uint64_t dirIdx = 0;
+
+          for(const rdcpair<uint64_t, uint64_t> &fmt : formats)
+          {
+            rdcstr strValue;
+            uint64_t intValue = 0;
+
+            switch(fmt.second)
+            {
+              case DW_FORM_string: strValue = unit.ReadString(); break;
+              case DW_FORM_line_strp:
+                strValue = StringFromTable(lineStr, lineStrSize,
+                                           dwarf64 ? unit.ReadU64() : unit.ReadU32());
+                break;
+              case DW_FORM_strp:
+                strValue =
+                    StringFromTable(str, strSize, dwarf64 ? unit.ReadU64() : unit.ReadU32());
+                break;
+              case DW_FORM_udata: intValue = unit.ReadULEB(); break;
+              case DW_FORM_data1: intValue = unit.ReadU8(); break;
+              case DW_FORM_data2: intValue = unit.ReadU16(); break;
+              case DW_FORM_data4: intValue = unit.ReadU32(); break;
+              case DW_FORM_data8: intValue = unit.ReadU64(); break;
+              case DW_FORM_data16: unit.Skip(16); break;
+              case DW_FORM_block: unit.Skip(unit.ReadULEB()); break;
+              default:
+                // string index forms need .debug_str_offsets and the unit's base, which we don't
+                // track. Skip this unit's files entirely rather than guessing.
+                supported = false;
+                break;
+            }
+
+            if(fmt.first == DW_LNCT_path)
+              path = strValue;
+            else if(fmt.first == DW_LNCT_directory_index)
+              dirIdx = intValue;
+          }
+
+          if(supported)
+            callback(path, dirIdx);
+        }
+      };
+
+      // directories other than the first (the compilation directory) may be relative to it
+      readEntries([&dirs](const rdcstr &path, uint64_t) {
+        dirs.push_back(dirs.empty() ? path : JoinPath(dirs[0], path));
+      });
+      readEntries([&](const rdcstr &path, uint64_t dirIdx) {
+        fileIds.push_back(addFile(path, dirIdx));
+      });
+
+      if(!supported)
+        continue;
+    }
+    else
+    {
+      // directory 0 is the compilation directory, which isn't stored in the line table
+      dirs.push_back(rdcstr());
+      while(!unit.error)
+      {
+        rdcstr dir = unit.ReadString();
+        if(dir.empty())
+          break;
+        dirs.push_back(dir);
+      }
+
+      // file indices start from 1 before DWARF 5
+      fileIds.push_back(~0U);
+      while(!unit.error)
+      {
+        rdcstr name = unit.ReadString();
+        if(name.empty())
+          break;
+        uint64_t dirIdx = unit.ReadULEB();
+        unit.ReadULEB();    // modification time
+        unit.ReadULEB();    // length
+        fileIds.push_back(addFile(name, dirIdx));
+      }
+    }
+
+    if(unit.error || programStart > unitEnd)
+      continue;
+
+    unit.cur = programStart;
+
+    uint64_t address = 0;
+    uint64_t file = 1;
+    int64_t line = 1;
+    rdcarray<LineRow> sequence;
+
+    auto emitRow = [&]() {
+      LineRow row;
+      row.addr = address;
+      row.file = file < fileIds.size() ? fileIds[(size_t)file] : ~0U;
+      row.line = (uint32_t)RDCCLAMP(line, (int64_t)0, (int64_t)UINT32_MAX);
+      sequence.push_back(row);
+    };
+
+    auto endSequence = [&]() {
+      if(!sequence.empty() && !IsTombstoneAddress(sequence[0].addr) && address > sequence[0].addr)
+      {
+        std::stable_sort(sequence.begin(), sequence.end(),
+                         [](const LineRow &a, const LineRow &b) { return a.addr < b.addr; });
+
+        LineSequence seq;
+        seq.start = sequence[0].addr;
+        seq.end = address;
+        seq.firstRow = (uint32_t)m_Rows.size();
+        seq.numRows = (uint32_t)sequence.size();
+        m_Sequences.push_back(seq);
+        m_Rows.append(sequence);
+      }
+
+      sequence.clear();
+      address = 0;
+      file = 1;
+      line = 1;
+    };
+
+    while(unit.Remaining() > 0 && !unit.error)
+    {
+      const uint8_t opcode = unit.ReadU8();
+
+      if(opcode >= opcodeBase)
+      {
+        const uint8_t adjusted = opcode - opcodeBase;
+        address += uint64_t(adjusted / lineRange) * minInstLength;
+        line += lineBase + (adjusted % lineRange);
+        emitRow();
+        continue;
+      }
+
+      switch(opcode)
+      {
+        case 0:
+        {
+          const uint64_t length = unit.ReadULEB();
+          if(length == 0 || length > unit.Remaining())
+          {
+            unit.error = true;
+            break;
+          }
+
+          const byte *next = unit.cur + length;
+          const uint8_t extOpcode = unit.ReadU8();
+
+          if(extOpcode == DW_LNE_end_sequence)
+            endSequence();
+          else if(extOpcode == DW_LNE_set_address)
+            address = unit.ReadFixed((size_t)length - 1);
+
+          unit.cur = next;
+          break;
+        }
+        case DW_LNS_copy: emitRow(); break;
+        case DW_LNS_advance_pc: address += unit.ReadULEB() * minInstLength; break;
+        case DW_LNS_advance_line: line += unit.ReadSLEB(); break;
+        case DW_LNS_set_file: file = unit.ReadULEB(); break;
+        case DW_LNS_const_add_pc:
+          address += uint64_t((255 - opcodeBase) / lineRange) * minInstLength;
+          break;
+        case DW_LNS_fixed_advance_pc: address += unit.ReadU16(); break;
+        default:
+          // skip the arguments of any opcodes we don't care about
+          for(uint8_t a = 0; a < opcodeLengths[opcode - 1]; a++)
+            unit.ReadULEB();
+          break;
+      }
+    }
+  }
+}
+
+void ELFSymbolIndex::FinaliseIndex()
+{
+  // for symbols at the same address prefer whichever has a size, then the first one seen which
+  // will be from the full symbol table
+  std::stable_sort(m_Functions.begin(), m_Functions.end(),
+                   [](const FunctionSymbol &a, const FunctionSymbol &b) {
+                     if(a.addr != b.addr)
+                       return a.addr < b.addr;
+                     return (a.size != 0) > (b.size != 0);
+                   });
+
+  size_t numUnique = 0;
+  for(size_t i = 0; i < m_Functions.size(); i++)
+  {
+    if(numUnique == 0 || m_Functions[numUnique - 1].addr != m_Functions[i].addr)
+      m_Functions[numUnique++] = m_Functions[i];
+  }
+  m_Functions.resize(numUnique);
+
+  std::sort(m_Sequences.begin(), m_Sequences.end(),
+            [](const LineSequence &a, const LineSequence &b) { return a.start < b.start; });
+
+  m_FileIndices.clear();
+}
+
+bool ELFSymbolIndex::Resolve(uint64_t vaddr, Callstack::AddressDetails &details) const
+{
+  bool found = false;
+
+  auto func = std::upper_bound(
+      m_Functions.begin(), m_Functions.end(), vaddr,
+      [](uint64_t addr, const FunctionSymbol &f) { return addr < f.addr; });
+
+  if(func != m_Functions.begin())
+  {
+    --func;
+
+    // symbols without a size are assumed to extend up to the next one
+    if(func->size == 0 || vaddr < func->addr + func->size)
+    {
+      const char *name = GetString(func->name);
+
+      int status = 0;
+      char *demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+      if(demangled && status == 0)
+        details.function = demangled;
+      else
+        details.function = name;
+      free(demangled);
+
+      found = true;
+    }
+  }
+
+  auto seq = std::upper_bound(
+      m_Sequences.begin(), m_Sequences.end(), vaddr,
+      [](uint64_t addr, const LineSequence &s) { return addr < s.start; });
+
+  if(seq != m_Sequences.begin())
+  {
+    --seq;
+
+    if(vaddr < seq->end)
+    {
+      const LineRow *first = m_Rows.data() + seq->firstRow;
+      const LineRow *last = first + seq->numRows;
+
+      // the last row at or before the address applies to it
+      const LineRow *row = std::upper_bound(
+          first, last, vaddr, [](uint64_t addr, const LineRow &r) { return addr < r.addr; });
+
+      if(row != first)
+      {
+        --row;
+
+        if(row->file < m_Files.size())
+          details.filename = GetString(m_Files[row->file]);
+        details.line = row->line;
+        found = true;
+      }
+    }
+  }
+
+  return found;
+}
+
+bool ELFSymbolIndex::ReadCache(const rdcstr &cachePath, uint64_t fileSize, uint64_t timestamp,
+                               const rdcstr &path)
+{
+  bytebuf cache;
+  if(!FileIO::exists(cachePath) || !FileIO::ReadAll(cachePath, cache))
+    return false;
+
+  DWARFReader reader(cache.begin(), cache.end());
+
+  if(reader.Remaining() < sizeof(SymbolCacheMagic) ||
+     memcmp(reader.cur, SymbolCacheMagic, sizeof(SymbolCacheMagic)) != 0)
+    return false;
+  reader.Skip(sizeof(SymbolCacheMagic));
+
+  if(reader.ReadU32() != SymbolCacheVersion || reader.ReadU64() != fileSize ||
+     reader.ReadU64() != timestamp)
+    return false;
+
+  const uint32_t pathLength = reader.ReadU32();
+  if(reader.Remaining() < pathLength || rdcstr((const char *)reader.cur, pathLength) != path)
+    return false;
+  reader.Skip(pathLength);
+
+  const uint32_t buildIDLength = reader.ReadU32();
+  if(reader.Remaining() < buildIDLength)
+    return false;
+  m_BuildID = rdcstr((const char *)reader.cur, buildIDLength);
+  reader.Skip(buildIDLength);
+
+  const uint64_t numFunctions = reader.ReadU64();
+  const uint64_t numRows = reader.ReadU64();
+  const uint64_t numSequences = reader.ReadU64();
+  const uint64_t numFiles = reader.ReadU64();
+  const uint64_t stringsSize = reader.ReadU64();
+
+  const uint64_t expected = numFunctions * sizeof(FunctionSymbol) + numRows * sizeof(LineRow) +
+                            numSequences * sizeof(LineSequence) + numFiles * sizeof(uint32_t) +
+                            stringsSize;
+
+  if(reader.error || expected != reader.Remaining())
+    return false;
+
+  auto readArray = [&reader](auto &arr, uint64_t count) {
+    arr.resize((size_t)count);
+    memcpy(arr.data(), reader.cur, arr.byteSize());
+    reader.cur += arr.byteSize();
+  };
+
+  readArray(m_Functions, numFunctions);
+  readArray(m_Rows, numRows);
+  readArray(m_Sequences, numSequences);
+  readArray(m_Files, numFiles);
+  readArray(m_Strings, stringsSize);
+
+  // validate the references so a corrupt cache can't cause out of bounds reads
+  for(const LineSequence &seq : m_Sequences)
+  {
+    if(uint64_t(seq.firstRow) + seq.numRows > m_Rows.size())
+      return false;
+  }
+
+  if(!m_Strings.empty() && m_Strings.back() != 0)
+    m_Strings.push_back(0);
+
+  return true;
+}
+
+void ELFSymbolIndex::WriteCache(const rdcstr &cachePath, uint64_t fileSize, uint64_t timestamp,
+                                const rdcstr &path) const
+{
+  bytebuf cache;
+
+  auto write = [&cache](const void *data, size_t size) { cache.append((const byte *)data, size); };
+  auto writeU32 = [&write](uint32_t val) { write(&val, sizeof(val)); };
+  auto writeU64 = [&write](uint64_t val) { write(&val, sizeof(val)); };
+
+  write(SymbolCacheMagic, sizeof(SymbolCacheMagic));
+  writeU32(SymbolCacheVersion);
+  writeU64(fileSize);
+  writeU64(timestamp);
+  writeU32((uint32_t)path.size());
+  write(path.c_str(), path.size());
+
+  writeU32((uint32_t)m_BuildID.size());
+  write(m_BuildID.c_str(), m_BuildID.size());
+
+  writeU64(m_Functions.size());
+  writeU64(m_Rows.size());
+  writeU64(m_Sequences.size());
+  writeU64(m_Files.size());
+  writeU64(m_Strings.size());
+
+  write(m_Functions.data(), m_Functions.byteSize());
+  write(m_Rows.data(), m_Rows.byteSize());
+  write(m_Sequences.data(), m_Sequences.byteSize());
+  write(m_Files.data(), m_Files.byteSize());
+  write(m_Strings.data(), m_Strings.byteSize());
+
+  FileIO::CreateParentDirectory(cachePath);
+
+  // write to a temporary file and move it into place, so another process reading the cache at the
+  // same time never sees it half-written
+  const rdcstr tempPath =
+      StringFormat::Fmt("%s.%u.tmp", cachePath.c_str(), Process::GetCurrentPID());
+
+  if(!FileIO::WriteAll(tempPath, cache) || !FileIO::Move(tempPath, cachePath, true))
+  {
+    RDCWARN("Couldn't write symbol cache for '%s' to '%s'", path.c_str(), cachePath.c_str());
+    FileIO::Delete(tempPath);
+  }
+}
+
+class ELFResolver : public Callstack::StackResolver
+{
+public:
+  ELFResolver(const rdcarray<ELFModuleMapping> &modules) : m_Modules(modules)
+  {
+    std::sort(m_Modules.begin(), m_Modules.end(),
+              [](const ELFModuleMapping &a, const ELFModuleMapping &b) { return a.base < b.base; });
+  }
+
+  ~ELFResolver()
+  {
+    for(auto it = m_Indices.begin(); it != m_Indices.end(); ++it)
+      delete it->second;
+  }
+
+  Callstack::AddressDetails GetAddr(uint64_t addr)
+  {
+    rdcarray<uint64_t> addrs = {addr};
+    return GetAddrs(addrs)[0];
+  }
+
+  rdcarray<Callstack::AddressDetails> GetAddrs(const rdcarray<uint64_t> &addrs)
+  {
+    SCOPED_LOCK(m_Lock);
+
+    rdcarray<Callstack::AddressDetails> ret;
+    ret.resize(addrs.size());
+
+    // the addresses we haven't seen before, and which module each is in
+    rdcarray<size_t> pending;
+    rdcarray<const ELFModuleMapping *> pendingModules;
+    rdcarray<rdcstr> toLoad;
+
+    for(size_t i = 0; i < addrs.size(); i++)
+    {
+      auto it = m_Cache.find(addrs[i]);
+      if(it != m_Cache.end())
+      {
+        ret[i] = it->second;
+        continue;
+      }
+
+      ret[i].filename = "Unknown";
+      ret[i].line = 0;
+      ret[i].function = StringFormat::Fmt("0x%08llx", addrs[i]);
+
+      const ELFModuleMapping *mod = FindModule(addrs[i]);
+
+      pending.push_back(i);
+      pendingModules.push_back(mod);
+
+      if(mod && m_Indices.find(mod->path) == m_Indices.end() && !toLoad.contains(mod->path))
+        toLoad.push_back(mod->path);
+    }
+
+    for(const rdcstr &path : toLoad)
+    {
+      ELFSymbolIndex *index = new ELFSymbolIndex;
+      if(!index->Load(path))
+      {
+        RDCWARN("Couldn't load symbols for '%s'", path.c_str());
+      }
+      else
+      {
+        const rdcstr &expected = FindBuildID(path);
+        if(!expected.empty() && !index->GetBuildID().empty() && expected != index->GetBuildID())
+        {
+          RDCWARN("'%s' has build ID %s but the captured module was %s, not using its symbols",
+                  path.c_str(), index->GetBuildID().c_str(), expected.c_str());
+          delete index;
+          index = new ELFSymbolIndex;
+        }
+      }
+
+      m_Indices[path] = index;
+    }
+
+    for(size_t p = 0; p < pending.size(); p++)
+    {
+      const ELFModuleMapping *mod = pendingModules[p];
+      Callstack::AddressDetails &details = ret[pending[p]];
+
+      if(mod)
+      {
+        const uint64_t vaddr = addrs[pending[p]] - mod->base + mod->offset;
+
+        if(!m_Indices[mod->path]->Resolve(vaddr, details))
+          details.function = StringFormat::Fmt("%s+0x%llx", get_basename(mod->path).c_str(), vaddr);
+      }
+
+      m_Cache[addrs[pending[p]]] = details;
+    }
+
+    return ret;
+  }
+
+private:
+  const rdcstr &FindBuildID(const rdcstr &path) const
+  {
+    static const rdcstr empty;
+    for(const ELFModuleMapping &mod : m_Modules)
+      if(mod.path == path && !mod.buildID.empty())
+        return mod.buildID;
+    return empty;
+  }
+
+  const ELFModuleMapping *FindModule(uint64_t addr) const
+  {
+    auto it = std::upper_bound(
+        m_Modules.begin(), m_Modules.end(), addr,
+        [](uint64_t a, const ELFModuleMapping &m) { return a < m.base; });
+
+    if(it == m_Modules.begin())
+      return NULL;
+
+    --it;
+
+    if(addr < it->end)
+      return it;
+
+    return NULL;
+  }
+
+  rdcarray<ELFModuleMapping> m_Modules;
+  // the indices are shared between all mappings of the same module
+  std::map<rdcstr, ELFSymbolIndex *> m_Indices;
+  std::map<uint64_t, Callstack::AddressDetails> m_Cache;
+  Threading::CriticalSection m_Lock;
+};
+
+Callstack::StackResolver *MakeELFResolver(const rdcarray<ELFModuleMapping> &modules)
+{
+  return new ELFResolver(modules);
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS) && defined(RENDERDOC_PLATFORM_LINUX)
+
+#include <dlfcn.h>
+#include "catch/catch.hpp"
+
+// kept out of line so it has its own symbol and line table entries
+static __attribute__((noinline)) int SymbolizerTestFunction(int a, int b)
+{
+  return a * b + a;
+}
+
+TEST_CASE("Resolve callstack addresses in-process", "[callstack]")
+{
+  REQUIRE(SymbolizerTestFunction(3, 4) == 15);
+
+  size_t dbSize = 0;
+  REQUIRE(Callstack::GetLoadedModules(NULL, dbSize));
+
+  bytebuf db;
+  db.resize(dbSize);
+
+  // as if a module was loaded after the size was queried, nothing is written and the caller retries
+  size_t smallSize = dbSize - 1;
+  CHECK_FALSE(Callstack::GetLoadedModules(db.data(), smallSize));
+  CHECK(smallSize == dbSize);
+
+  REQUIRE(Callstack::GetLoadedModules(db.data(), dbSize));
+
+  Callstack::StackResolver *resolver = Callstack::MakeResolver(false, db.data(), db.size(), NULL);
+  REQUIRE(resolver);
+
+  const uint64_t funcAddr = (uint64_t)(uintptr_t)&SymbolizerTestFunction;
+
+  Callstack::AddressDetails details = resolver->GetAddr(funcAddr);
+  CHECK(details.function.contains("SymbolizerTestFunction"));
+
+  // line information is only available if we were built with debug info
+  if(details.line > 0)
+    CHECK(details.filename.contains("posix_symbolizer.cpp"));
+
+  // resolving in a batch gives the same results as one at a time, including for addresses
+  // outside any module
+  rdcarray<uint64_t> addrs = {funcAddr, (uint64_t)(uintptr_t)&Callstack::MakeResolver, 0x10};
+  rdcarray<Callstack::AddressDetails> batch = resolver->GetAddrs(addrs);
+  REQUIRE(batch.size() == addrs.size());
+
+  for(size_t i = 0; i < addrs.size(); i++)
+  {
+    Callstack::AddressDetails single = resolver->GetAddr(addrs[i]);
+    CHECK(batch[i].function == single.function);
+    CHECK(batch[i].filename == single.filename);
+    CHECK(batch[i].line == single.line);
+  }
+
+  CHECK(batch[1].function.contains("MakeResolver"));
+  CHECK(batch[2].function == "0x00000010");
+
+  delete resolver;
+};
+
+TEST_CASE("Resolve callstack addresses from an Android module database", "[callstack]")
+{
+  Dl_info info = {};
+  REQUIRE(dladdr((void *)&SymbolizerTestFunction, &info) != 0);
+  REQUIRE(info.dli_fname);
+
+  const uint64_t base = (uint64_t)(uintptr_t)info.dli_fbase;
+  const uint64_t funcAddr = (uint64_t)(uintptr_t)&SymbolizerTestFunction;
+
+  // with no search paths configured the device path is used as-is, so describe ourselves as if we
+  // were a library on a device
+  auto makeDB = [&](const char *buildID) {
+    rdcstr db = "ANRDCALL";
+    db += StringFormat::Fmt("%llx-%llx %llx %s %s\n", base, funcAddr + 0x1000, 0ULL, buildID,
+                            info.dli_fname);
+    return bytebuf((const byte *)db.c_str(), db.size());
+  };
+
+  SECTION("Matching module")
+  {
+    bytebuf db = makeDB("-");
+    Callstack::StackResolver *resolver =
+        Callstack::MakeResolver(false, db.data(), db.size(), NULL);
+    REQUIRE(resolver);
+
+    CHECK(resolver->GetAddr(funcAddr).function.contains("SymbolizerTestFunction"));
+
+    delete resolver;
+  };
+
+  SECTION("Mismatched build ID")
+  {
+    bytebuf db = makeDB("0123456789abcdef");
+    Callstack::StackResolver *resolver =
+        Callstack::MakeResolver(false, db.data(), db.size(), NULL);
+    REQUIRE(resolver);
+
+    // the library's symbols can't be trusted so it's only reported as an offset into it. We're
+    // always linked with --build-id so there is an ID to compare
+    Callstack::AddressDetails details = resolver->GetAddr(funcAddr);
+    REQUIRE_FALSE(details.function.contains("SymbolizerTestFunction"));
+    CHECK(details.function ==
+          StringFormat::Fmt("%s+0x%llx", get_basename(info.dli_fname).c_str(), funcAddr - base));
+
+    delete resolver;
+  };
+};
+
+#endif
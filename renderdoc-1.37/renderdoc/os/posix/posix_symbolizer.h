@@ -0,0 +1,123 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <map>
+#include "os/os_specific.h"
+
+// An in-process symboliser for ELF modules, used instead of running addr2line per address. Each
+// module is memory mapped once and its function symbols (.symtab and .dynsym) and DWARF line tables
+// are indexed. After that any number of addresses can be looked up concurrently. The index doesn't
+// reference the file, and is cached on disk keyed by the module's path, size and timestamp, so
+// resolving another capture against the same libraries skips the parsing entirely.
+
+// where a module was loaded in the captured process. offset is the module's virtual address that
+// corresponds to base, so base + (vaddr - offset) is where vaddr in the ELF was loaded. If the
+// build ID is known, a module at path with a different build ID won't be used.
+struct ELFModuleMapping
+{
+  uint64_t base;
+  uint64_t end;
+  uint64_t offset;
+  rdcstr path;
+  rdcstr buildID;
+};
+
+class ELFSymbolIndex
+{
+public:
+  // index the module at path, reading from the on-disk cache if it's up to date. Also looks for
+  // separate debug info via the build ID or .gnu_debuglink if the module itself has no line tables.
+  bool Load(const rdcstr &path);
+
+  // resolve a virtual address in the module, filling in whatever details are known. Returns false
+  // if nothing was found. Safe to call from multiple threads once loaded.
+  bool Resolve(uint64_t vaddr, Callstack::AddressDetails &details) const;
+
+  // the module's GNU build ID as a hex string, or empty if it has none
+  const rdcstr &GetBuildID() const { return m_BuildID; }
+
+  size_t NumFunctions() const { return m_Functions.size(); }
+  size_t NumLineRows() const { return m_Rows.size(); }
+
+private:
+  struct FunctionSymbol
+  {
+    uint64_t addr;
+    uint64_t size;
+    uint32_t name;
+  };
+
+  struct LineRow
+  {
+    uint64_t addr;
+    uint32_t file;
+    uint32_t line;
+  };
+
+  struct LineSequence
+  {
+    uint64_t start;
+    uint64_t end;
+    uint32_t firstRow;
+    uint32_t numRows;
+  };
+
+  bool ParseFile(const rdcstr &path, bool debugFile);
+  template <typename ELFTypes>
+  bool ParseELF(const byte *data, size_t size, bool debugFile);
+  void ParseLineTable(const byte *data, size_t size, const byte *lineStr, size_t lineStrSize,
+                      const byte *str, size_t strSize);
+  void FinaliseIndex();
+
+  uint32_t AddString(const rdcstr &str);
+  const char *GetString(uint32_t offs) const;
+
+  bool ReadCache(const rdcstr &cachePath, uint64_t fileSize, uint64_t timestamp,
+                 const rdcstr &path);
+  void WriteCache(const rdcstr &cachePath, uint64_t fileSize, uint64_t timestamp,
+                  const rdcstr &path) const;
+
+  // sorted by address
+  rdcarray<FunctionSymbol> m_Functions;
+  // the rows of each sequence are contiguous and sorted by address, and sequences are sorted by
+  // their start address
+  rdcarray<LineRow> m_Rows;
+  rdcarray<LineSequence> m_Sequences;
+  // offsets of each file's full path in m_Strings
+  rdcarray<uint32_t> m_Files;
+  // NULL-terminated strings for symbol names and file paths
+  rdcarray<char> m_Strings;
+
+  // only used while parsing
+  std::map<rdcstr, uint32_t> m_FileIndices;
+  bool m_Thumb = false;
+  rdcstr m_BuildID;
+  rdcstr m_DebugLink;
+};
+
+// create a resolver for addresses in a process with the given modules loaded. Modules are indexed
+// the first time an address inside them is resolved.
+Callstack::StackResolver *MakeELFResolver(const rdcarray<ELFModuleMapping> &modules);
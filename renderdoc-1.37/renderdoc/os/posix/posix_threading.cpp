@@ -70,6 +70,11 @@ int32_t CmpExch32(int32_t *dest, int32_t oldVal, int32_t newVal)
 {
   return __sync_val_compare_and_swap(dest, oldVal, newVal);
 }
+
+int64_t CmpExch64(int64_t *dest, int64_t oldVal, int64_t newVal)
+{
+  return __sync_val_compare_and_swap(dest, oldVal, newVal);
+}
 };
 
 namespace Threading
@@ -180,13 +185,26 @@ static void *sThreadInit(void *init)
 pthread_key_t OSTLSHandle;
 int64_t nextTLSSlot = 0;
 
+// slots are 1-indexed in the lower 32 bits, with a generation in the upper 32 bits that is bumped
+// each time a freed index is reused.
+static const uint64_t TLSSlotIndexMask = 0xffffffffULL;
+static const uint64_t TLSSlotGeneration = 0x100000000ULL;
+
 struct TLSData
 {
-  rdcarray<void *> data;
+  // each value is stored with the slot that set it, so a value left behind by a freed slot isn't
+  // returned when its index is reused. Threads never have to touch each other's data.
+  struct Entry
+  {
+    uint64_t slot;
+    void *value;
+  };
+  rdcarray<Entry> data;
 };
 
 static CriticalSection *m_TLSListLock = NULL;
 static rdcarray<TLSData *> *m_TLSList = NULL;
+static rdcarray<uint64_t> *m_FreeTLSSlots = NULL;
 
 void Init()
 {
@@ -196,6 +214,7 @@ void Init()
 
   m_TLSListLock = new CriticalSection();
   m_TLSList = new rdcarray<TLSData *>();
+  m_FreeTLSSlots = new rdcarray<uint64_t>();
 
   CacheDebuggerPresent();
 }
@@ -206,36 +225,72 @@ void Shutdown()
     delete m_TLSList->at(i);
 
   delete m_TLSList;
+  delete m_FreeTLSSlots;
   delete m_TLSListLock;
 
+  // slots freed by objects destroyed after shutdown are ignored
+  m_FreeTLSSlots = NULL;
+  m_TLSListLock = NULL;
+
   pthread_key_delete(OSTLSHandle);
 }
 
-// allocate a TLS slot in our per-thread vectors with an atomic increment.
+// allocate a TLS slot in our per-thread vectors, reusing a freed index if there is one or
+// otherwise with an atomic increment.
 // Note this is going to be 1-indexed because Inc64 returns the post-increment
 // value
 uint64_t AllocateTLSSlot()
 {
+  // slots can be allocated by static constructors before Init()
+  if(m_TLSListLock)
+  {
+    uint64_t slot = 0;
+
+    m_TLSListLock->Lock();
+    if(!m_FreeTLSSlots->empty())
+    {
+      slot = m_FreeTLSSlots->back() + TLSSlotGeneration;
+      m_FreeTLSSlots->pop_back();
+    }
+    m_TLSListLock->Unlock();
+
+    if(slot != 0)
+      return slot;
+  }
+
   return Atomic::Inc64(&nextTLSSlot);
 }
 
+void FreeTLSSlot(uint64_t slot)
+{
+  if(slot == 0 || !m_TLSListLock)
+    return;
+
+  m_TLSListLock->Lock();
+  m_FreeTLSSlots->push_back(slot);
+  m_TLSListLock->Unlock();
+}
+
 // look up our per-thread vector.
 void *GetTLSValue(uint64_t slot)
 {
   TLSData *slots = (TLSData *)pthread_getspecific(OSTLSHandle);
-  if(slots == NULL || slot - 1 >= slots->data.size())
+  size_t idx = size_t(slot & TLSSlotIndexMask) - 1;
+  if(slots == NULL || idx >= slots->data.size() || slots->data[idx].slot != slot)
     return NULL;
-  return slots->data[(size_t)slot - 1];
+  return slots->data[idx].value;
 }
 
 void SetTLSValue(uint64_t slot, void *value)
 {
   TLSData *slots = (TLSData *)pthread_getspecific(OSTLSHandle);
 
+  size_t idx = size_t(slot & TLSSlotIndexMask) - 1;
+
   // resize or allocate slot data if needed.
   // We don't need to lock this, as it is by definition thread local so we are
   // blocking on the only possible concurrent access.
-  if(slots == NULL || slot - 1 >= slots->data.size())
+  if(slots == NULL || idx >= slots->data.size())
   {
     if(slots == NULL)
     {
@@ -250,11 +305,11 @@ void SetTLSValue(uint64_t slot, void *value)
       m_TLSListLock->Unlock();
     }
 
-    if(slot - 1 >= slots->data.size())
-      slots->data.resize((size_t)slot);
+    if(idx >= slots->data.size())
+      slots->data.resize(idx + 1);
   }
 
-  slots->data[(size_t)slot - 1] = value;
+  slots->data[idx] = {slot, value};
 }
 
 ThreadHandle CreateThread(std::function<void()> entryFunc)
@@ -0,0 +1,445 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "common/common.h"
+#include "common/threading.h"
+#include "os/os_specific.h"
+
+struct WriteWatch::Region
+{
+  byte *base;
+  size_t size;
+
+  // the whole pages inside the region, which are the ones we protect
+  byte *protBegin;
+  size_t numPages;
+
+  // one flag per protected page, set by the fault handler when the page is written
+  int32_t *dirty;
+};
+
+// regions are looked up from the fault handler, so they're stored in a fixed array of slots that
+// can be read without taking a lock.
+static const size_t MaxWatchedRegions = 256;
+static int64_t watchedRegions[MaxWatchedRegions] = {};
+
+// the number of fault handlers currently looking at regions, so a region isn't freed from under one
+static int32_t activeHandlers = 0;
+
+// incremented by each Unwatch before its region is removed. A write can fault on a region just
+// before it's made writable again and only be handled after it's removed, so each thread retries an
+// unrecognised fault once per generation before treating it as a real fault.
+static int64_t unwatchGeneration = 0;
+
+// the generation this thread last retried at. This is read and written from the fault handler so
+// it can't go through the TLS slot API, and uses the initial-exec model so accessing it never
+// allocates.
+static __thread int64_t retryGeneration __attribute__((tls_model("initial-exec"))) = 0;
+
+static size_t pageSize = 0;
+
+static Threading::SpinLock installLock;
+static struct sigaction oldSegvAction, oldBusAction;
+
+static void ChainFault(int signum, siginfo_t *info, void *context)
+{
+  struct sigaction &old = (signum == SIGBUS) ? oldBusAction : oldSegvAction;
+
+  if(old.sa_flags & SA_SIGINFO)
+  {
+    old.sa_sigaction(signum, info, context);
+  }
+  else if(old.sa_handler == SIG_DFL || old.sa_handler == SIG_IGN)
+  {
+    // restore the default behaviour and return, the faulting instruction will run again and fault
+    // as it would have without us.
+    struct sigaction dfl = {};
+    sigemptyset(&dfl.sa_mask);
+    dfl.sa_handler = SIG_DFL;
+    sigaction(signum, &dfl, NULL);
+  }
+  else
+  {
+    old.sa_handler(signum);
+  }
+}
+
+static void WriteFaultHandler(int signum, siginfo_t *info, void *context)
+{
+  int saved_errno = errno;
+
+  Atomic::Inc32(&activeHandlers);
+
+  byte *addr = (byte *)info->si_addr;
+  bool handled = false;
+
+  for(size_t i = 0; i < MaxWatchedRegions; i++)
+  {
+    WriteWatch::Region *region =
+        (WriteWatch::Region *)(uintptr_t)Atomic::CmpExch64(&watchedRegions[i], 0, 0);
+
+    if(region && addr >= region->protBegin && addr < region->protBegin + region->numPages * pageSize)
+    {
+      size_t page = size_t(addr - region->protBegin) / pageSize;
+
+      // allow writes before marking dirty. If GetDirtyRanges runs in between it will re-protect the
+      // page after clearing the flag, so we never end up writable and clean.
+      mprotect(region->protBegin + page * pageSize, pageSize, PROT_READ | PROT_WRITE);
+      Atomic::CmpExch32(&region->dirty[page], 0, 1);
+
+      handled = true;
+      break;
+    }
+  }
+
+  Atomic::Dec32(&activeHandlers);
+
+  // if a region has been unwatched since this thread last retried, the page may be writable now so
+  // return and let the write run again. A real fault will fault again and be chained below.
+  if(!handled)
+  {
+    int64_t gen = Atomic::CmpExch64(&unwatchGeneration, 0, 0);
+    if(gen != retryGeneration)
+    {
+      retryGeneration = gen;
+      handled = true;
+    }
+  }
+
+  errno = saved_errno;
+
+  if(!handled)
+    ChainFault(signum, info, context);
+}
+
+static bool IsWriteFaultHandler(const struct sigaction &action)
+{
+  return (action.sa_flags & SA_SIGINFO) && action.sa_sigaction == &WriteFaultHandler;
+}
+
+static void InstallWriteFaultHandler()
+{
+  SCOPED_SPINLOCK(installLock);
+
+  static bool installed = false;
+
+  struct sigaction new_action = {};
+  sigemptyset(&new_action.sa_mask);
+  new_action.sa_flags = SA_SIGINFO | SA_RESTART;
+  new_action.sa_sigaction = &WriteFaultHandler;
+
+  // the first time, save the previous handlers to chain faults that aren't ours to
+  if(!installed)
+  {
+    installed = true;
+
+    pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+    sigaction(SIGSEGV, &new_action, &oldSegvAction);
+    sigaction(SIGBUS, &new_action, &oldBusAction);
+    return;
+  }
+
+  // something else (e.g. the application's crash handler) may have replaced our handler since, in
+  // which case writes to watched pages would crash. Put ours back but keep chaining to the handlers
+  // from the first install - the replacement may itself chain back to us, and would recurse.
+  struct sigaction cur = {};
+
+  sigaction(SIGSEGV, NULL, &cur);
+  if(!IsWriteFaultHandler(cur))
+    sigaction(SIGSEGV, &new_action, NULL);
+
+  sigaction(SIGBUS, NULL, &cur);
+  if(!IsWriteFaultHandler(cur))
+    sigaction(SIGBUS, &new_action, NULL);
+}
+
+bool WriteWatch::IsSupported()
+{
+  return true;
+}
+
+WriteWatch::Region *WriteWatch::Watch(void *base, size_t size)
+{
+  InstallWriteFaultHandler();
+
+  Region *region = new Region;
+  region->base = (byte *)base;
+  region->size = size;
+
+  uintptr_t begin = AlignUp((uintptr_t)base, (uintptr_t)pageSize);
+  uintptr_t end = ((uintptr_t)base + size) & ~(uintptr_t(pageSize) - 1);
+
+  region->protBegin = (byte *)begin;
+  region->numPages = end > begin ? (end - begin) / pageSize : 0;
+  region->dirty = new int32_t[region->numPages ? region->numPages : 1]();
+
+  bool added = false;
+  for(size_t i = 0; i < MaxWatchedRegions; i++)
+  {
+    if(Atomic::CmpExch64(&watchedRegions[i], 0, (int64_t)(uintptr_t)region) == 0)
+    {
+      added = true;
+      break;
+    }
+  }
+
+  if(!added)
+  {
+    RDCWARN("Too many regions are being watched for writes, can't watch %p", base);
+    delete[] region->dirty;
+    delete region;
+    return NULL;
+  }
+
+  if(region->numPages > 0 &&
+     mprotect(region->protBegin, region->numPages * pageSize, PROT_READ) != 0)
+  {
+    RDCWARN("Couldn't write-protect %p for write watching: %d", base, errno);
+    Unwatch(region);
+    return NULL;
+  }
+
+  return region;
+}
+
+void WriteWatch::GetDirtyRanges(Region *region, rdcarray<DiffRange> &ranges)
+{
+  ranges.clear();
+
+  if(!region)
+    return;
+
+  const size_t protOffset = size_t(region->protBegin - region->base);
+
+  // the partial page at the start can't be tracked
+  size_t rangeStart = 0;
+  size_t rangeEnd = region->numPages > 0 ? protOffset : region->size;
+
+  for(size_t page = 0; page < region->numPages; page++)
+  {
+    // clear the flag before re-protecting, see the fault handler
+    if(Atomic::CmpExch32(&region->dirty[page], 1, 0) != 1)
+      continue;
+
+    const size_t pageStart = protOffset + page * pageSize;
+
+    mprotect(region->base + pageStart, pageSize, PROT_READ);
+
+    if(rangeEnd == pageStart)
+    {
+      rangeEnd += pageSize;
+    }
+    else
+    {
+      if(rangeEnd > rangeStart)
+        ranges.push_back({rangeStart, rangeEnd});
+      rangeStart = pageStart;
+      rangeEnd = pageStart + pageSize;
+    }
+  }
+
+  // likewise the partial page at the end
+  if(region->numPages > 0)
+  {
+    const size_t protEnd = protOffset + region->numPages * pageSize;
+
+    if(protEnd < region->size)
+    {
+      if(rangeEnd == protEnd)
+      {
+        rangeEnd = region->size;
+      }
+      else
+      {
+        if(rangeEnd > rangeStart)
+          ranges.push_back({rangeStart, rangeEnd});
+        rangeStart = protEnd;
+        rangeEnd = region->size;
+      }
+    }
+  }
+
+  if(rangeEnd > rangeStart)
+    ranges.push_back({rangeStart, rangeEnd});
+}
+
+void WriteWatch::Unwatch(Region *region)
+{
+  if(!region)
+    return;
+
+  if(region->numPages > 0)
+    mprotect(region->protBegin, region->numPages * pageSize, PROT_READ | PROT_WRITE);
+
+  // bump the generation before removing the region, so a handler that no longer finds it retries
+  Atomic::Inc64(&unwatchGeneration);
+
+  for(size_t i = 0; i < MaxWatchedRegions; i++)
+  {
+    if(Atomic::CmpExch64(&watchedRegions[i], (int64_t)(uintptr_t)region, 0) ==
+       (int64_t)(uintptr_t)region)
+      break;
+  }
+
+  // a fault handler may have found the region before it was removed, wait for it to finish
+  while(Atomic::CmpExch32(&activeHandlers, 0, 0) != 0)
+    Threading::Sleep(0);
+
+  delete[] region->dirty;
+  delete region;
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Test write watching", "[osspecific]")
+{
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t numPages = 16;
+
+  byte *mem = (byte *)mmap(NULL, page * numPages, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  REQUIRE(mem != MAP_FAILED);
+
+  rdcarray<DiffRange> ranges;
+
+  SECTION("Whole pages")
+  {
+    WriteWatch::Region *region = WriteWatch::Watch(mem, page * numPages);
+    REQUIRE(region);
+
+    // nothing written yet
+    WriteWatch::GetDirtyRanges(region, ranges);
+    CHECK(ranges.empty());
+
+    // reading doesn't dirty anything
+    volatile byte read = mem[page * 3];
+    (void)read;
+
+    mem[page * 3 + 5] = 1;
+    mem[page * 4] = 2;
+    mem[page * 10 + page - 1] = 3;
+
+    WriteWatch::GetDirtyRanges(region, ranges);
+    REQUIRE(ranges.size() == 2);
+    CHECK(ranges[0].start == page * 3);
+    CHECK(ranges[0].end == page * 5);
+    CHECK(ranges[1].start == page * 10);
+    CHECK(ranges[1].end == page * 11);
+
+    // ranges are cleared once returned
+    WriteWatch::GetDirtyRanges(region, ranges);
+    CHECK(ranges.empty());
+
+    // and pages are tracked again after being reported
+    mem[page * 4 + 7] = 4;
+    WriteWatch::GetDirtyRanges(region, ranges);
+    REQUIRE(ranges.size() == 1);
+    CHECK(ranges[0].start == page * 4);
+    CHECK(ranges[0].end == page * 5);
+
+    WriteWatch::Unwatch(region);
+
+    // writable again and not faulting after unwatching
+    mem[page * 6] = 5;
+    CHECK(mem[page * 6] == 5);
+  };
+
+  SECTION("Partial pages at each end")
+  {
+    const size_t offset = 100;
+    const size_t size = page * 4;
+
+    WriteWatch::Region *region = WriteWatch::Watch(mem + offset, size);
+    REQUIRE(region);
+
+    // the partial pages at either end are always dirty
+    WriteWatch::GetDirtyRanges(region, ranges);
+    REQUIRE(ranges.size() == 2);
+    CHECK(ranges[0].start == 0);
+    CHECK(ranges[0].end == page - offset);
+    CHECK(ranges[1].start == page * 4 - offset);
+    CHECK(ranges[1].end == size);
+
+    // a write to the first whole page merges with the partial page before it
+    mem[page + 1] = 1;
+    WriteWatch::GetDirtyRanges(region, ranges);
+    REQUIRE(ranges.size() == 2);
+    CHECK(ranges[0].start == 0);
+    CHECK(ranges[0].end == page * 2 - offset);
+    CHECK(ranges[1].start == page * 4 - offset);
+    CHECK(ranges[1].end == size);
+
+    WriteWatch::Unwatch(region);
+  };
+
+  SECTION("Regions smaller than a page")
+  {
+    WriteWatch::Region *region = WriteWatch::Watch(mem + 10, 64);
+    REQUIRE(region);
+
+    WriteWatch::GetDirtyRanges(region, ranges);
+    REQUIRE(ranges.size() == 1);
+    CHECK(ranges[0].start == 0);
+    CHECK(ranges[0].end == 64);
+
+    WriteWatch::Unwatch(region);
+  };
+
+  SECTION("Handler replaced after watching")
+  {
+    WriteWatch::Region *region = WriteWatch::Watch(mem, page * 2);
+    REQUIRE(region);
+    WriteWatch::Unwatch(region);
+
+    // something else takes over SIGSEGV, watching again must put our handler back
+    struct sigaction replaced = {}, prev = {};
+    sigemptyset(&replaced.sa_mask);
+    replaced.sa_handler = SIG_DFL;
+    sigaction(SIGSEGV, &replaced, &prev);
+
+    region = WriteWatch::Watch(mem, page * 2);
+    REQUIRE(region);
+
+    mem[page + 1] = 1;
+    WriteWatch::GetDirtyRanges(region, ranges);
+    REQUIRE(ranges.size() == 1);
+    CHECK(ranges[0].start == page);
+    CHECK(ranges[0].end == page * 2);
+
+    WriteWatch::Unwatch(region);
+
+    sigaction(SIGSEGV, &prev, NULL);
+  };
+
+  munmap(mem, page * numPages);
+};
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
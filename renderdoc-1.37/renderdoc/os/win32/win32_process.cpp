@@ -1751,3 +1751,24 @@ void Process::Shutdown()
 {
   // nothing to do
 }
+
+// writes to mapped memory can't be tracked on windows. GetWriteWatch only works on memory we
+// allocate ourselves with MEM_WRITE_WATCH, not on memory mapped by a driver.
+bool WriteWatch::IsSupported()
+{
+  return false;
+}
+
+WriteWatch::Region *WriteWatch::Watch(void *base, size_t size)
+{
+  return NULL;
+}
+
+void WriteWatch::GetDirtyRanges(Region *region, rdcarray<DiffRange> &ranges)
+{
+  ranges.clear();
+}
+
+void WriteWatch::Unwatch(Region *region)
+{
+}
@@ -743,6 +743,65 @@ int fclose(FILE *f)
   return ::fclose(f);
 }
 
+static uint64_t GetAllocationGranularity()
+{
+  SYSTEM_INFO info = {};
+  GetSystemInfo(&info);
+  return info.dwAllocationGranularity;
+}
+
+const byte *MapFileRange(FILE *f, uint64_t offset, uint64_t length)
+{
+  if(length == 0)
+    return NULL;
+
+  HANDLE file = (HANDLE)_get_osfhandle(_fileno(f));
+  if(file == INVALID_HANDLE_VALUE)
+    return NULL;
+
+  HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if(mapping == NULL)
+    return NULL;
+
+  // views must start on the allocation granularity, so map from the containing chunk and return a
+  // pointer into it
+  uint64_t delta = offset % GetAllocationGranularity();
+  uint64_t base = offset - delta;
+
+  void *view = MapViewOfFile(mapping, FILE_MAP_READ, DWORD(base >> 32), DWORD(base & 0xffffffff),
+                             SIZE_T(length + delta));
+
+  // the view holds its own reference to the mapping
+  CloseHandle(mapping);
+
+  if(view == NULL)
+    return NULL;
+
+  return (const byte *)view + delta;
+}
+
+void UnmapFileRange(const byte *data, uint64_t length)
+{
+  if(!data)
+    return;
+
+  uint64_t delta = uint64_t((uintptr_t)data % GetAllocationGranularity());
+
+  UnmapViewOfFile(data - delta);
+}
+
+bool CanDetachFileRange()
+{
+  // a file can't be truncated while any view of it is mapped, even if the view's pages have been
+  // copied, and a view can't be replaced in place without leaving a window where it's unmapped
+  return false;
+}
+
+bool DetachFileRange(const byte *data, uint64_t length)
+{
+  return false;
+}
+
 LogFileHandle *logfile_open(const rdcstr &filename)
 {
   rdcwstr wfn = StringFormat::UTF82Wide(filename);
@@ -27,6 +27,7 @@
 #if ENABLED(ENABLE_UNIT_TESTS)
 
 #include "api/replay/rdcarray.h"
+#include "api/replay/rdcflathashmap.h"
 #include "api/replay/rdcflatmap.h"
 #include "api/replay/rdcpair.h"
 #include "api/replay/rdcstr.h"
@@ -38,6 +39,8 @@
 
 #include "catch/catch.hpp"
 
+#include <unordered_map>
+
 static int32_t constructor = 0;
 static int32_t moveConstructor = 0;
 static int32_t valueConstructor = 0;
@@ -2311,6 +2314,206 @@ TEST_CASE("Test sorted flatmap type", "[basictypes][sortedflatmap]")
   }
 };
 
+TEST_CASE("Test flat hashmap type", "[basictypes][flathashmap]")
+{
+  SECTION("basic lookup, insert and erase")
+  {
+    rdcflathashmap<uint32_t, rdcstr> test;
+
+    CHECK(test.empty());
+    CHECK((test.begin() == test.end()));
+    CHECK((test.find(5) == test.end()));
+    CHECK(test.erase(5) == 0);
+
+    test[5] = "foo";
+    test[7] = "bar";
+    test[3] = "asdf";
+
+    CHECK(test.size() == 3);
+    CHECK(test[5] == "foo");
+    CHECK(test[7] == "bar");
+    CHECK(test[3] == "asdf");
+    CHECK(test.count(7) == 1);
+    CHECK(test.count(6) == 0);
+
+    auto ins = test.insert({7, "baz"});
+    CHECK_FALSE(ins.second);
+    CHECK(ins.first->second == "bar");
+
+    ins = test.insert({9, "baz"});
+    CHECK(ins.second);
+    CHECK(ins.first->first == 9);
+    CHECK(ins.first->second == "baz");
+
+    CHECK(test.erase(7) == 1);
+    CHECK(test.erase(7) == 0);
+    CHECK((test.find(7) == test.end()));
+    CHECK(test.size() == 3);
+
+    CHECK(test.find(5)->second == "foo");
+
+    test.clear();
+    CHECK(test.empty());
+    CHECK((test.find(5) == test.end()));
+  };
+
+  SECTION("growing, iteration and erasing while iterating")
+  {
+    rdcflathashmap<ResourceId, uint32_t> test;
+    std::unordered_map<ResourceId, uint32_t> reference;
+
+    for(uint32_t i = 0; i < 5000; i++)
+    {
+      ResourceId id = ResourceIDGen::GetNewUniqueID();
+      test[id] = i;
+      reference[id] = i;
+    }
+
+    CHECK(test.size() == reference.size());
+
+    size_t iterated = 0;
+    for(auto it = test.begin(); it != test.end(); ++it)
+    {
+      CHECK(reference[it->first] == it->second);
+      iterated++;
+    }
+    CHECK(iterated == reference.size());
+
+    // erase every odd value through iterators
+    for(auto it = test.begin(); it != test.end();)
+    {
+      if(it->second & 1)
+      {
+        reference.erase(it->first);
+        it = test.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+
+    CHECK(test.size() == reference.size());
+    for(auto it = reference.begin(); it != reference.end(); ++it)
+    {
+      auto find = test.find(it->first);
+      REQUIRE((find != test.end()));
+      CHECK(find->second == it->second);
+    }
+
+    // re-inserting after erasing reuses deleted slots without growing forever
+    size_t cap = test.capacity();
+    for(int pass = 0; pass < 10; pass++)
+    {
+      rdcarray<ResourceId> added;
+      for(uint32_t i = 0; i < 1000; i++)
+      {
+        added.push_back(ResourceIDGen::GetNewUniqueID());
+        test[added.back()] = i;
+      }
+      for(ResourceId id : added)
+        CHECK(test.erase(id) == 1);
+    }
+    CHECK(test.size() == reference.size());
+    CHECK(test.capacity() <= cap * 2);
+  };
+
+  SECTION("copy, move and swap")
+  {
+    rdcflathashmap<uint32_t, rdcstr> a;
+    for(uint32_t i = 0; i < 100; i++)
+      a[i] = StringFormat::Fmt("%u", i);
+
+    rdcflathashmap<uint32_t, rdcstr> b = a;
+    CHECK(b.size() == 100);
+    CHECK(b[42] == "42");
+
+    rdcflathashmap<uint32_t, rdcstr> c = std::move(b);
+    CHECK(c.size() == 100);
+    CHECK(c[99] == "99");
+    CHECK(b.empty());
+
+    b[1000] = "1000";
+    b.swap(c);
+    CHECK(b.size() == 100);
+    CHECK(c.size() == 1);
+    CHECK(c[1000] == "1000");
+  };
+};
+
+template <typename MapType>
+static double BenchmarkFrameRefs(const rdcarray<ResourceId> &ids, uint32_t frames,
+                                 uint32_t refsPerFrame)
+{
+  MapType refs;
+
+  PerformanceTimer timer;
+
+  // mimic frame references - repeatedly reference a subset of resources then clear the list
+  for(uint32_t f = 0; f < frames; f++)
+  {
+    for(uint32_t i = 0; i < refsPerFrame; i++)
+    {
+      ResourceId id = ids[(f * 131 + i * 7919) % ids.size()];
+      auto it = refs.find(id);
+      if(it == refs.end())
+        refs[id] = i;
+      else
+        it->second |= i;
+    }
+    refs.clear();
+  }
+
+  return timer.GetMilliseconds();
+}
+
+template <typename MapType>
+static double BenchmarkIDRemap(const rdcarray<ResourceId> &ids, uint32_t lookups)
+{
+  PerformanceTimer timer;
+
+  MapType map;
+
+  // mimic replay setup - register every live ID then look them up repeatedly
+  for(size_t i = 0; i < ids.size(); i++)
+    map[ids[i]] = ids[ids.size() - 1 - i];
+
+  uint64_t sum = 0;
+  for(uint32_t i = 0; i < lookups; i++)
+  {
+    uint64_t val = 0;
+    memcpy(&val, &map[ids[(i * 7919) % ids.size()]], sizeof(val));
+    sum += val;
+  }
+
+  double ret = timer.GetMilliseconds();
+
+  CHECK(sum != 0);
+
+  return ret;
+}
+
+TEST_CASE("Benchmark flat hashmap type", "[basictypes][flathashmap][!benchmark]")
+{
+  rdcarray<ResourceId> ids;
+  for(uint32_t i = 0; i < 100000; i++)
+    ids.push_back(ResourceIDGen::GetNewUniqueID());
+
+  const uint32_t frames = 200, refsPerFrame = 20000, lookups = 10000000;
+
+  double stdMs = BenchmarkFrameRefs<std::unordered_map<ResourceId, uint32_t>>(ids, frames, refsPerFrame);
+  double flatMs = BenchmarkFrameRefs<rdcflathashmap<ResourceId, uint32_t>>(ids, frames, refsPerFrame);
+
+  RDCLOG("Frame references, %u frames of %u refs: std::unordered_map %.1f ms, rdcflathashmap %.1f ms",
+         frames, refsPerFrame, stdMs, flatMs);
+
+  stdMs = BenchmarkIDRemap<std::unordered_map<ResourceId, ResourceId>>(ids, lookups);
+  flatMs = BenchmarkIDRemap<rdcflathashmap<ResourceId, ResourceId>>(ids, lookups);
+
+  RDCLOG("ID remapping, %zu IDs and %u lookups: std::unordered_map %.1f ms, rdcflathashmap %.1f ms",
+         ids.size(), lookups, stdMs, flatMs);
+};
+
 union foo
 {
   rdcfixedarray<float, 16> f32v;
@@ -0,0 +1,2062 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "block_decode.h"
+#include <math.h>
+#include "common/formatting.h"
+#include "maths/formatpacking.h"
+#include "maths/half_convert.h"
+
+// the largest block we decode is 6x6x6 ASTC
+static const uint32_t MaxBlockTexels = 6 * 6 * 6;
+
+typedef float DecodedTexel[4];
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// ETC2 / EAC
+
+static int ETCClamp(int v)
+{
+  return RDCCLAMP(v, 0, 255);
+}
+
+// extend an n-bit colour to 8 bits by replicating the high bits into the low bits
+static int ETCExtend(int v, int bits)
+{
+  return (v << (8 - bits)) | (v >> (2 * bits - 8));
+}
+
+// decode an ETC2 RGB block. With punchthrough set, the block is from an RGB8A1 format and the
+// differential bit indicates whether the block is opaque.
+static void DecodeETC2Colour(const byte *src, bool punchthrough, DecodedTexel *texels)
+{
+  static const int modifierTable[8][4] = {
+      {2, 8, -2, -8},       {5, 17, -5, -17},     {9, 29, -9, -29},     {13, 42, -13, -42},
+      {18, 60, -18, -60},   {24, 80, -24, -80},   {33, 106, -33, -106}, {47, 183, -47, -183},
+  };
+  static const int distanceTable[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+  const bool diff = (src[3] & 0x2) != 0;
+  const bool flip = (src[3] & 0x1) != 0;
+
+  // in punchthrough formats the differential bit is repurposed as the opaque bit, and the block is
+  // always differential
+  const bool opaque = punchthrough ? diff : true;
+  const bool differential = punchthrough ? true : diff;
+
+  // the per-texel indices are stored column-major in the lower 32 bits, with the MSBs of all
+  // indices in the upper half.
+  const uint32_t indexBits = (uint32_t(src[4]) << 24) | (uint32_t(src[5]) << 16) |
+                             (uint32_t(src[6]) << 8) | uint32_t(src[7]);
+
+  int rgb[16][3];
+  bool transparent[16] = {};
+
+  if(differential)
+  {
+    const int r = src[0] >> 3, g = src[1] >> 3, b = src[2] >> 3;
+    // sign extend the 3-bit deltas
+    const int dr = int(src[0] << 29) >> 29, dg = int(src[1] << 29) >> 29,
+              db = int(src[2] << 29) >> 29;
+
+    if(r + dr < 0 || r + dr > 31)
+    {
+      // T mode
+      int base[2][3] = {
+          {ETCExtend(((src[0] & 0x18) >> 1) | (src[0] & 0x3), 4), ETCExtend(src[1] >> 4, 4),
+           ETCExtend(src[1] & 0xf, 4)},
+          {ETCExtend(src[2] >> 4, 4), ETCExtend(src[2] & 0xf, 4), ETCExtend(src[3] >> 4, 4)},
+      };
+      const int d = distanceTable[((src[3] >> 1) & 0x6) | (src[3] & 0x1)];
+
+      int paint[4][3];
+      for(int c = 0; c < 3; c++)
+      {
+        paint[0][c] = base[0][c];
+        paint[1][c] = ETCClamp(base[1][c] + d);
+        paint[2][c] = base[1][c];
+        paint[3][c] = ETCClamp(base[1][c] - d);
+      }
+
+      for(int i = 0; i < 16; i++)
+      {
+        const uint32_t idx = (((indexBits >> (i + 16)) & 1) << 1) | ((indexBits >> i) & 1);
+        transparent[i] = !opaque && idx == 2;
+        for(int c = 0; c < 3; c++)
+          rgb[i][c] = paint[idx][c];
+      }
+    }
+    else if(g + dg < 0 || g + dg > 31)
+    {
+      // H mode
+      int base[2][3] = {
+          {ETCExtend((src[0] >> 3) & 0xf, 4),
+           ETCExtend(((src[0] & 0x7) << 1) | ((src[1] >> 4) & 0x1), 4),
+           ETCExtend((src[1] & 0x8) | ((src[1] & 0x3) << 1) | (src[2] >> 7), 4)},
+          {ETCExtend((src[2] >> 3) & 0xf, 4), ETCExtend(((src[2] & 0x7) << 1) | (src[3] >> 7), 4),
+           ETCExtend((src[3] >> 3) & 0xf, 4)},
+      };
+
+      // the lowest bit of the distance index is implied by the ordering of the base colours
+      int distIdx = (src[3] & 0x4) | ((src[3] & 0x1) << 1);
+      if(((base[0][0] << 16) | (base[0][1] << 8) | base[0][2]) >=
+         ((base[1][0] << 16) | (base[1][1] << 8) | base[1][2]))
+        distIdx |= 1;
+      const int d = distanceTable[distIdx];
+
+      int paint[4][3];
+      for(int c = 0; c < 3; c++)
+      {
+        paint[0][c] = ETCClamp(base[0][c] + d);
+        paint[1][c] = ETCClamp(base[0][c] - d);
+        paint[2][c] = ETCClamp(base[1][c] + d);
+        paint[3][c] = ETCClamp(base[1][c] - d);
+      }
+
+      for(int i = 0; i < 16; i++)
+      {
+        const uint32_t idx = (((indexBits >> (i + 16)) & 1) << 1) | ((indexBits >> i) & 1);
+        transparent[i] = !opaque && idx == 2;
+        for(int c = 0; c < 3; c++)
+          rgb[i][c] = paint[idx][c];
+      }
+    }
+    else if(b + db < 0 || b + db > 31)
+    {
+      // planar mode, which ignores the opaque bit
+      const int o[3] = {
+          ETCExtend((src[0] >> 1) & 0x3f, 6),
+          ETCExtend(((src[0] & 0x1) << 6) | ((src[1] >> 1) & 0x3f), 7),
+          ETCExtend(((src[1] & 0x1) << 5) | (src[2] & 0x18) | ((src[2] & 0x3) << 1) | (src[3] >> 7),
+                    6),
+      };
+      const int h[3] = {
+          ETCExtend(((src[3] >> 1) & 0x3e) | (src[3] & 0x1), 6),
+          ETCExtend((src[4] >> 1) & 0x7f, 7),
+          ETCExtend(((src[4] & 0x1) << 5) | ((src[5] >> 3) & 0x1f), 6),
+      };
+      const int v[3] = {
+          ETCExtend(((src[5] & 0x7) << 3) | (src[6] >> 5), 6),
+          ETCExtend(((src[6] & 0x1f) << 2) | (src[7] >> 6), 7),
+          ETCExtend(src[7] & 0x3f, 6),
+      };
+
+      for(int x = 0; x < 4; x++)
+        for(int y = 0; y < 4; y++)
+          for(int c = 0; c < 3; c++)
+            rgb[x * 4 + y][c] =
+                ETCClamp((x * (h[c] - o[c]) + y * (v[c] - o[c]) + 4 * o[c] + 2) >> 2);
+    }
+    else
+    {
+      // regular differential mode
+      const int base[2][3] = {
+          {ETCExtend(r, 5), ETCExtend(g, 5), ETCExtend(b, 5)},
+          {ETCExtend(r + dr, 5), ETCExtend(g + dg, 5), ETCExtend(b + db, 5)},
+      };
+      const int table[2] = {src[3] >> 5, (src[3] >> 2) & 0x7};
+
+      for(int x = 0; x < 4; x++)
+      {
+        for(int y = 0; y < 4; y++)
+        {
+          const int i = x * 4 + y;
+          const int sub = flip ? (y >= 2) : (x >= 2);
+          const uint32_t idx = (((indexBits >> (i + 16)) & 1) << 1) | ((indexBits >> i) & 1);
+
+          // non-opaque blocks have no modifier for the first and third index, and the third index
+          // is transparent instead.
+          int mod = modifierTable[table[sub]][idx];
+          if(!opaque && (idx == 0 || idx == 2))
+            mod = 0;
+          transparent[i] = !opaque && idx == 2;
+
+          for(int c = 0; c < 3; c++)
+            rgb[i][c] = ETCClamp(base[sub][c] + mod);
+        }
+      }
+    }
+  }
+  else
+  {
+    // individual mode
+    const int base[2][3] = {
+        {ETCExtend(src[0] >> 4, 4), ETCExtend(src[1] >> 4, 4), ETCExtend(src[2] >> 4, 4)},
+        {ETCExtend(src[0] & 0xf, 4), ETCExtend(src[1] & 0xf, 4), ETCExtend(src[2] & 0xf, 4)},
+    };
+    const int table[2] = {src[3] >> 5, (src[3] >> 2) & 0x7};
+
+    for(int x = 0; x < 4; x++)
+    {
+      for(int y = 0; y < 4; y++)
+      {
+        const int i = x * 4 + y;
+        const int sub = flip ? (y >= 2) : (x >= 2);
+        const uint32_t idx = (((indexBits >> (i + 16)) & 1) << 1) | ((indexBits >> i) & 1);
+
+        for(int c = 0; c < 3; c++)
+          rgb[i][c] = ETCClamp(base[sub][c] + modifierTable[table[sub]][idx]);
+      }
+    }
+  }
+
+  // convert from column-major to our row-major texel order
+  for(int x = 0; x < 4; x++)
+  {
+    for(int y = 0; y < 4; y++)
+    {
+      const int i = x * 4 + y;
+      float *out = texels[y * 4 + x];
+
+      if(transparent[i])
+      {
+        out[0] = out[1] = out[2] = out[3] = 0.0f;
+        continue;
+      }
+
+      out[0] = rgb[i][0] / 255.0f;
+      out[1] = rgb[i][1] / 255.0f;
+      out[2] = rgb[i][2] / 255.0f;
+      out[3] = 1.0f;
+    }
+  }
+}
+
+// decode a single EAC channel into component comp of the texels. With elevenBit unset this is the
+// 8-bit alpha channel of RGBA8 ETC2 formats.
+static void DecodeEACChannel(const byte *src, bool elevenBit, bool isSigned, uint32_t comp,
+                             DecodedTexel *texels)
+{
+  static const int modifierTable[16][8] = {
+      {-3, -6, -9, -15, 2, 5, 8, 14},   {-3, -7, -10, -13, 2, 6, 9, 12},
+      {-2, -5, -8, -13, 1, 4, 7, 12},   {-2, -4, -6, -13, 1, 3, 5, 12},
+      {-3, -6, -8, -12, 2, 5, 7, 11},   {-3, -7, -9, -11, 2, 6, 8, 10},
+      {-4, -7, -8, -11, 3, 6, 7, 10},   {-3, -5, -8, -11, 2, 4, 7, 10},
+      {-2, -6, -8, -10, 1, 5, 7, 9},    {-2, -5, -8, -10, 1, 4, 7, 9},
+      {-2, -4, -8, -10, 1, 3, 7, 9},    {-2, -5, -7, -10, 1, 4, 6, 9},
+      {-3, -4, -7, -10, 2, 3, 6, 9},    {-1, -2, -3, -10, 0, 1, 2, 9},
+      {-4, -6, -8, -9, 3, 5, 7, 8},     {-3, -5, -7, -9, 2, 4, 6, 8},
+  };
+
+  const int multiplier = src[1] >> 4;
+  const int *modifiers = modifierTable[src[1] & 0xf];
+
+  // 48 bits of 3-bit indices, column-major with the first texel in the top bits
+  uint64_t indexBits = 0;
+  for(int i = 2; i < 8; i++)
+    indexBits = (indexBits << 8) | src[i];
+
+  for(int x = 0; x < 4; x++)
+  {
+    for(int y = 0; y < 4; y++)
+    {
+      const int i = x * 4 + y;
+      const int mod = modifiers[(indexBits >> (45 - i * 3)) & 0x7];
+
+      float value;
+
+      if(!elevenBit)
+      {
+        value = ETCClamp(src[0] + mod * multiplier) / 255.0f;
+      }
+      else if(isSigned)
+      {
+        // -128 is not a valid base, and is treated as -127
+        const int base = RDCMAX(int(int8_t(src[0])), -127);
+        const int v = multiplier == 0 ? base * 8 + mod : base * 8 + mod * multiplier * 8;
+        value = RDCCLAMP(v, -1023, 1023) / 1023.0f;
+      }
+      else
+      {
+        const int v = multiplier == 0 ? src[0] * 8 + 4 + mod : src[0] * 8 + 4 + mod * multiplier * 8;
+        value = RDCCLAMP(v, 0, 2047) / 2047.0f;
+      }
+
+      texels[y * 4 + x][comp] = value;
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// ASTC
+
+namespace
+{
+// a whole 128-bit ASTC block, for extracting arbitrary bitfields
+struct ASTCBits
+{
+  uint64_t lo, hi;
+
+  uint32_t Get(uint32_t offset, uint32_t count) const
+  {
+    if(count == 0 || offset >= 128)
+      return 0;
+
+    uint64_t v;
+    if(offset == 0)
+      v = lo;
+    else if(offset < 64)
+      v = (lo >> offset) | (hi << (64 - offset));
+    else
+      v = hi >> (offset - 64);
+
+    return uint32_t(v & ((1ULL << count) - 1));
+  }
+};
+
+struct ASTCQuant
+{
+  uint16_t levels;
+  uint8_t trits, quints, bits;
+};
+
+// all the integer sequence encoding ranges. Weights use at most the first 12, colour endpoints must
+// use at least the fifth (6 levels).
+static const ASTCQuant astcQuants[21] = {
+    {2, 0, 0, 1},   {3, 1, 0, 0},   {4, 0, 0, 2},   {5, 0, 1, 0},   {6, 1, 0, 1},
+    {8, 0, 0, 3},   {10, 0, 1, 1},  {12, 1, 0, 2},  {16, 0, 0, 4},  {20, 0, 1, 2},
+    {24, 1, 0, 3},  {32, 0, 0, 5},  {40, 0, 1, 3},  {48, 1, 0, 4},  {64, 0, 0, 6},
+    {80, 0, 1, 4},  {96, 1, 0, 5},  {128, 0, 0, 7}, {160, 0, 1, 5}, {192, 1, 0, 6},
+    {256, 0, 0, 8},
+};
+
+static const uint32_t ASTCMinColourQuant = 4;
+
+static uint32_t ASTCSequenceBits(uint32_t count, uint32_t quant)
+{
+  const ASTCQuant &q = astcQuants[quant];
+  uint32_t ret = count * q.bits;
+  if(q.trits)
+    ret += (8 * count + 4) / 5;
+  if(q.quints)
+    ret += (7 * count + 2) / 3;
+  return ret;
+}
+
+// tables that are fixed but awkward to write out by hand, so they're computed once
+struct ASTCTables
+{
+  uint8_t trits[256][5];
+  uint8_t quints[128][3];
+  uint8_t colourUnquant[21][256];
+  uint8_t weightUnquant[12][32];
+
+  ASTCTables()
+  {
+    for(uint32_t T = 0; T < 256; T++)
+    {
+      uint32_t C, t4, t3;
+      if(((T >> 2) & 0x7) == 0x7)
+      {
+        C = ((T >> 3) & 0x1c) | (T & 0x3);
+        t4 = 2;
+        t3 = 2;
+      }
+      else
+      {
+        C = T & 0x1f;
+        if(((T >> 5) & 0x3) == 0x3)
+        {
+          t4 = 2;
+          t3 = (T >> 7) & 0x1;
+        }
+        else
+        {
+          t4 = (T >> 7) & 0x1;
+          t3 = (T >> 5) & 0x3;
+        }
+      }
+
+      uint32_t t2, t1, t0;
+      if((C & 0x3) == 0x3)
+      {
+        t2 = 2;
+        t1 = (C >> 4) & 0x1;
+        t0 = (((C >> 3) & 0x1) << 1) | (((C >> 2) & 0x1) & ~((C >> 3) & 0x1));
+      }
+      else if(((C >> 2) & 0x3) == 0x3)
+      {
+        t2 = 2;
+        t1 = 2;
+        t0 = C & 0x3;
+      }
+      else
+      {
+        t2 = (C >> 4) & 0x1;
+        t1 = (C >> 2) & 0x3;
+        t0 = (C & 0x2) | ((C & 0x1) & ~((C >> 1) & 0x1));
+      }
+
+      trits[T][0] = uint8_t(t0);
+      trits[T][1] = uint8_t(t1);
+      trits[T][2] = uint8_t(t2);
+      trits[T][3] = uint8_t(t3);
+      trits[T][4] = uint8_t(t4);
+    }
+
+    for(uint32_t Q = 0; Q < 128; Q++)
+    {
+      uint32_t q2, q1, q0;
+      if(((Q >> 1) & 0x3) == 0x3 && ((Q >> 5) & 0x3) == 0)
+      {
+        q2 = ((Q & 0x1) << 2) | ((((Q >> 4) & 0x1) & ~(Q & 0x1)) << 1) |
+             (((Q >> 3) & 0x1) & ~(Q & 0x1));
+        q1 = 4;
+        q0 = 4;
+      }
+      else
+      {
+        uint32_t C;
+        if(((Q >> 1) & 0x3) == 0x3)
+        {
+          q2 = 4;
+          C = (((Q >> 3) & 0x3) << 3) | ((~(Q >> 5) & 0x3) << 1) | (Q & 0x1);
+        }
+        else
+        {
+          q2 = (Q >> 5) & 0x3;
+          C = Q & 0x1f;
+        }
+
+        if((C & 0x7) == 0x5)
+        {
+          q1 = 4;
+          q0 = (C >> 3) & 0x3;
+        }
+        else
+        {
+          q1 = (C >> 3) & 0x3;
+          q0 = C & 0x7;
+        }
+      }
+
+      quints[Q][0] = uint8_t(q0);
+      quints[Q][1] = uint8_t(q1);
+      quints[Q][2] = uint8_t(q2);
+    }
+
+    // the bit patterns for 'B' in the unquantisation, where letters refer to bits of the stored
+    // value with 'a' as the least significant.
+    static const char *colourTritB[7] = {
+        NULL, "000000000", "b000b0bb0", "cb000cbcb", "dcb000dcb", "edcb000ed", "fedcb000f",
+    };
+    static const uint32_t colourTritC[7] = {0, 204, 93, 44, 22, 11, 5};
+    static const char *colourQuintB[6] = {
+        NULL, "000000000", "b0000bb00", "cb0000cbc", "dcb0000dc", "edcb0000e",
+    };
+    static const uint32_t colourQuintC[6] = {0, 113, 54, 26, 13, 6};
+
+    static const char *weightTritB[4] = {NULL, "0000000", "b000b0b", "cb000cb"};
+    static const uint32_t weightTritC[4] = {0, 50, 23, 11};
+    static const char *weightQuintB[3] = {NULL, "0000000", "b0000b0"};
+    static const uint32_t weightQuintC[3] = {0, 28, 13};
+
+    for(uint32_t q = 0; q < 21; q++)
+    {
+      const ASTCQuant &quant = astcQuants[q];
+
+      for(uint32_t v = 0; v < quant.levels; v++)
+      {
+        if(q < 12)
+          weightUnquant[q][v] = uint8_t(UnquantiseWeight(quant, v, weightTritB, weightTritC,
+                                                         weightQuintB, weightQuintC));
+
+        if(q >= ASTCMinColourQuant)
+          colourUnquant[q][v] = uint8_t(UnquantiseColour(quant, v, colourTritB, colourTritC,
+                                                         colourQuintB, colourQuintC));
+      }
+    }
+  }
+
+  static uint32_t PatternBits(const char *pattern, uint32_t m)
+  {
+    uint32_t ret = 0;
+    for(const char *c = pattern; *c; c++)
+    {
+      ret <<= 1;
+      if(*c != '0')
+        ret |= (m >> (*c - 'a')) & 0x1;
+    }
+    return ret;
+  }
+
+  static uint32_t Replicate(uint32_t v, uint32_t bits, uint32_t destBits)
+  {
+    uint32_t ret = 0;
+    int shift = int(destBits);
+    while(shift > 0)
+    {
+      shift -= int(bits);
+      ret |= shift >= 0 ? (v << shift) : (v >> -shift);
+    }
+    return ret;
+  }
+
+  static uint32_t UnquantiseColour(const ASTCQuant &quant, uint32_t v, const char **tritB,
+                                   const uint32_t *tritC, const char **quintB,
+                                   const uint32_t *quintC)
+  {
+    if(!quant.trits && !quant.quints)
+      return Replicate(v, quant.bits, 8);
+
+    const uint32_t D = v >> quant.bits;
+    const uint32_t m = v & ((1 << quant.bits) - 1);
+    const uint32_t A = (m & 0x1) ? 0x1ff : 0;
+    const uint32_t B = PatternBits(quant.trits ? tritB[quant.bits] : quintB[quant.bits], m);
+    const uint32_t C = quant.trits ? tritC[quant.bits] : quintC[quant.bits];
+
+    uint32_t T = D * C + B;
+    T ^= A;
+    return (A & 0x80) | (T >> 2);
+  }
+
+  static uint32_t UnquantiseWeight(const ASTCQuant &quant, uint32_t v, const char **tritB,
+                                   const uint32_t *tritC, const char **quintB,
+                                   const uint32_t *quintC)
+  {
+    uint32_t ret;
+
+    if(!quant.trits && !quant.quints)
+    {
+      ret = Replicate(v, quant.bits, 6);
+    }
+    else if(quant.bits == 0)
+    {
+      static const uint32_t tritValues[3] = {0, 32, 63};
+      static const uint32_t quintValues[5] = {0, 16, 32, 47, 63};
+      ret = quant.trits ? tritValues[v] : quintValues[v];
+    }
+    else
+    {
+      const uint32_t D = v >> quant.bits;
+      const uint32_t m = v & ((1 << quant.bits) - 1);
+      const uint32_t A = (m & 0x1) ? 0x7f : 0;
+      const uint32_t B = PatternBits(quant.trits ? tritB[quant.bits] : quintB[quant.bits], m);
+      const uint32_t C = quant.trits ? tritC[quant.bits] : quintC[quant.bits];
+
+      uint32_t T = D * C + B;
+      T ^= A;
+      ret = (A & 0x20) | (T >> 2);
+    }
+
+    // expand to the range [0, 64]
+    if(ret > 32)
+      ret++;
+
+    return ret;
+  }
+};
+
+static const ASTCTables &GetASTCTables()
+{
+  static const ASTCTables tables;
+  return tables;
+}
+
+// decode count values of an integer sequence encoding starting at bit offset. Bits past the end of
+// the sequence are treated as zero, as the final block of trits or quints may be truncated.
+static void DecodeASTCSequence(const ASTCBits &bits, uint32_t offset, uint32_t count,
+                               uint32_t quant, uint8_t *out)
+{
+  const ASTCTables &tables = GetASTCTables();
+  const ASTCQuant &q = astcQuants[quant];
+  const uint32_t end = offset + ASTCSequenceBits(count, quant);
+
+  uint32_t pos = offset;
+  auto read = [&](uint32_t n) {
+    uint32_t avail = pos < end ? RDCMIN(n, end - pos) : 0;
+    uint32_t ret = bits.Get(pos, avail);
+    pos += n;
+    return ret;
+  };
+
+  if(q.trits)
+  {
+    for(uint32_t i = 0; i < count; i += 5)
+    {
+      uint32_t m[5], T = 0;
+      m[0] = read(q.bits);
+      T |= read(2);
+      m[1] = read(q.bits);
+      T |= read(2) << 2;
+      m[2] = read(q.bits);
+      T |= read(1) << 4;
+      m[3] = read(q.bits);
+      T |= read(2) << 5;
+      m[4] = read(q.bits);
+      T |= read(1) << 7;
+
+      for(uint32_t j = 0; j < 5 && i + j < count; j++)
+        out[i + j] = uint8_t((tables.trits[T][j] << q.bits) | m[j]);
+    }
+  }
+  else if(q.quints)
+  {
+    for(uint32_t i = 0; i < count; i += 3)
+    {
+      uint32_t m[3], Q = 0;
+      m[0] = read(q.bits);
+      Q |= read(3);
+      m[1] = read(q.bits);
+      Q |= read(2) << 3;
+      m[2] = read(q.bits);
+      Q |= read(2) << 5;
+
+      for(uint32_t j = 0; j < 3 && i + j < count; j++)
+        out[i + j] = uint8_t((tables.quints[Q][j] << q.bits) | m[j]);
+    }
+  }
+  else
+  {
+    for(uint32_t i = 0; i < count; i++)
+      out[i] = uint8_t(read(q.bits));
+  }
+}
+
+struct ASTCBlockMode
+{
+  uint32_t gridX, gridY, gridZ;
+  uint32_t weightQuant;
+  bool dualPlane;
+};
+
+static bool DecodeASTCBlockMode2D(uint32_t mode, ASTCBlockMode &ret)
+{
+  uint32_t R = (mode >> 4) & 0x1;
+  uint32_t H = (mode >> 9) & 0x1;
+  uint32_t D = (mode >> 10) & 0x1;
+  const uint32_t A = (mode >> 5) & 0x3;
+
+  if(mode & 0x3)
+  {
+    R |= (mode & 0x3) << 1;
+    uint32_t B = (mode >> 7) & 0x3;
+    switch((mode >> 2) & 0x3)
+    {
+      case 0:
+        ret.gridX = B + 4;
+        ret.gridY = A + 2;
+        break;
+      case 1:
+        ret.gridX = B + 8;
+        ret.gridY = A + 2;
+        break;
+      case 2:
+        ret.gridX = A + 2;
+        ret.gridY = B + 8;
+        break;
+      case 3:
+        B &= 0x1;
+        if(mode & 0x100)
+        {
+          ret.gridX = B + 2;
+          ret.gridY = A + 2;
+        }
+        else
+        {
+          ret.gridX = A + 2;
+          ret.gridY = B + 6;
+        }
+        break;
+    }
+  }
+  else
+  {
+    R |= ((mode >> 2) & 0x3) << 1;
+    if(((mode >> 2) & 0x3) == 0)
+      return false;
+
+    const uint32_t B = (mode >> 9) & 0x3;
+    switch((mode >> 7) & 0x3)
+    {
+      case 0:
+        ret.gridX = 12;
+        ret.gridY = A + 2;
+        break;
+      case 1:
+        ret.gridX = A + 2;
+        ret.gridY = 12;
+        break;
+      case 2:
+        ret.gridX = A + 6;
+        ret.gridY = B + 6;
+        D = 0;
+        H = 0;
+        break;
+      case 3:
+        switch((mode >> 5) & 0x3)
+        {
+          case 0:
+            ret.gridX = 6;
+            ret.gridY = 10;
+            break;
+          case 1:
+            ret.gridX = 10;
+            ret.gridY = 6;
+            break;
+          default: return false;
+        }
+        break;
+    }
+  }
+
+  ret.gridZ = 1;
+  ret.weightQuant = (R - 2) + 6 * H;
+  ret.dualPlane = D != 0;
+  return true;
+}
+
+static bool DecodeASTCBlockMode3D(uint32_t mode, ASTCBlockMode &ret)
+{
+  uint32_t R = (mode >> 4) & 0x1;
+  uint32_t H = (mode >> 9) & 0x1;
+  uint32_t D = (mode >> 10) & 0x1;
+  const uint32_t A = (mode >> 5) & 0x3;
+
+  if(mode & 0x3)
+  {
+    R |= (mode & 0x3) << 1;
+    ret.gridX = A + 2;
+    ret.gridY = ((mode >> 7) & 0x3) + 2;
+    ret.gridZ = ((mode >> 2) & 0x3) + 2;
+  }
+  else
+  {
+    R |= ((mode >> 2) & 0x3) << 1;
+    if(((mode >> 2) & 0x3) == 0)
+      return false;
+
+    const uint32_t B = (mode >> 9) & 0x3;
+    if(((mode >> 7) & 0x3) != 0x3)
+    {
+      D = 0;
+      H = 0;
+    }
+
+    switch((mode >> 7) & 0x3)
+    {
+      case 0:
+        ret.gridX = 6;
+        ret.gridY = B + 2;
+        ret.gridZ = A + 2;
+        break;
+      case 1:
+        ret.gridX = A + 2;
+        ret.gridY = 6;
+        ret.gridZ = B + 2;
+        break;
+      case 2:
+        ret.gridX = A + 2;
+        ret.gridY = B + 2;
+        ret.gridZ = 6;
+        break;
+      case 3:
+        ret.gridX = ret.gridY = ret.gridZ = 2;
+        switch((mode >> 5) & 0x3)
+        {
+          case 0: ret.gridX = 6; break;
+          case 1: ret.gridY = 6; break;
+          case 2: ret.gridZ = 6; break;
+          default: return false;
+        }
+        break;
+    }
+  }
+
+  ret.weightQuant = (R - 2) + 6 * H;
+  ret.dualPlane = D != 0;
+  return true;
+}
+
+static uint32_t ASTCHash52(uint32_t p)
+{
+  p ^= p >> 15;
+  p -= p << 17;
+  p += p << 7;
+  p += p << 4;
+  p ^= p >> 5;
+  p += p << 16;
+  p ^= p >> 7;
+  p ^= p >> 3;
+  p ^= p << 6;
+  p ^= p >> 17;
+  return p;
+}
+
+static uint32_t ASTCSelectPartition(uint32_t seed, uint32_t x, uint32_t y, uint32_t z,
+                                    uint32_t partitionCount, bool smallBlock)
+{
+  if(smallBlock)
+  {
+    x <<= 1;
+    y <<= 1;
+    z <<= 1;
+  }
+
+  seed += (partitionCount - 1) * 1024;
+
+  const uint32_t rnum = ASTCHash52(seed);
+
+  uint8_t seeds[12] = {
+      uint8_t(rnum & 0xf),         uint8_t((rnum >> 4) & 0xf),  uint8_t((rnum >> 8) & 0xf),
+      uint8_t((rnum >> 12) & 0xf), uint8_t((rnum >> 16) & 0xf), uint8_t((rnum >> 20) & 0xf),
+      uint8_t((rnum >> 24) & 0xf), uint8_t((rnum >> 28) & 0xf), uint8_t((rnum >> 18) & 0xf),
+      uint8_t((rnum >> 22) & 0xf), uint8_t((rnum >> 26) & 0xf),
+      uint8_t(((rnum >> 30) | (rnum << 2)) & 0xf),
+  };
+
+  for(int i = 0; i < 12; i++)
+    seeds[i] = uint8_t(seeds[i] * seeds[i]);
+
+  int sh1, sh2;
+  if(seed & 1)
+  {
+    sh1 = (seed & 2) ? 4 : 5;
+    sh2 = (partitionCount == 3) ? 6 : 5;
+  }
+  else
+  {
+    sh1 = (partitionCount == 3) ? 6 : 5;
+    sh2 = (seed & 2) ? 4 : 5;
+  }
+  const int sh3 = (seed & 0x10) ? sh1 : sh2;
+
+  for(int i = 0; i < 8; i++)
+    seeds[i] >>= (i & 1) ? sh2 : sh1;
+  for(int i = 8; i < 12; i++)
+    seeds[i] >>= sh3;
+
+  uint32_t a = seeds[0] * x + seeds[1] * y + seeds[10] * z + (rnum >> 14);
+  uint32_t b = seeds[2] * x + seeds[3] * y + seeds[11] * z + (rnum >> 10);
+  uint32_t c = seeds[4] * x + seeds[5] * y + seeds[8] * z + (rnum >> 6);
+  uint32_t d = seeds[6] * x + seeds[7] * y + seeds[9] * z + (rnum >> 2);
+
+  a &= 0x3f;
+  b &= 0x3f;
+  c &= 0x3f;
+  d &= 0x3f;
+
+  if(partitionCount < 4)
+    d = 0;
+  if(partitionCount < 3)
+    c = 0;
+
+  if(a >= b && a >= c && a >= d)
+    return 0;
+  else if(b >= c && b >= d)
+    return 1;
+  else if(c >= d)
+    return 2;
+  return 3;
+}
+
+// decoded colour endpoints. LDR channels are 8-bit values, HDR channels are 16-bit values in
+// ASTC's pseudo-logarithmic representation.
+struct ASTCEndpoints
+{
+  int e0[4], e1[4];
+  bool hdrRGB, hdrAlpha;
+};
+
+static void ASTCBitTransferSigned(int &a, int &b)
+{
+  b >>= 1;
+  b |= a & 0x80;
+  a >>= 1;
+  a &= 0x3f;
+  if(a & 0x20)
+    a -= 0x40;
+}
+
+static void ASTCSetEndpoint(int *e, int r, int g, int b, int a)
+{
+  e[0] = r;
+  e[1] = g;
+  e[2] = b;
+  e[3] = a;
+}
+
+static void ASTCBlueContract(int *e, int r, int g, int b, int a)
+{
+  ASTCSetEndpoint(e, (r + b) >> 1, (g + b) >> 1, b, a);
+}
+
+static void ASTCClampLDR(int *e)
+{
+  for(int c = 0; c < 4; c++)
+    e[c] = RDCCLAMP(e[c], 0, 255);
+}
+
+static void ASTCDecodeHDRRGBScale(const int *v, ASTCEndpoints &ret)
+{
+  const int v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+
+  const int modeval = ((v0 & 0xc0) >> 6) | (((v1 & 0x80) >> 7) << 2) | (((v2 & 0x80) >> 7) << 3);
+
+  int majcomp, mode;
+  if((modeval & 0xc) != 0xc)
+  {
+    majcomp = modeval >> 2;
+    mode = modeval & 3;
+  }
+  else if(modeval != 0xf)
+  {
+    majcomp = modeval & 3;
+    mode = 4;
+  }
+  else
+  {
+    majcomp = 0;
+    mode = 5;
+  }
+
+  int red = v0 & 0x3f;
+  int green = v1 & 0x1f;
+  int blue = v2 & 0x1f;
+  int scale = v3 & 0x1f;
+
+  const int bit0 = (v1 >> 6) & 1;
+  const int bit1 = (v1 >> 5) & 1;
+  const int bit2 = (v2 >> 6) & 1;
+  const int bit3 = (v2 >> 5) & 1;
+  const int bit4 = (v3 >> 7) & 1;
+  const int bit5 = (v3 >> 6) & 1;
+  const int bit6 = (v3 >> 5) & 1;
+
+  const int ohcomp = 1 << mode;
+
+  if(ohcomp & 0x30)
+    green |= bit0 << 6;
+  if(ohcomp & 0x3a)
+    green |= bit1 << 5;
+  if(ohcomp & 0x30)
+    blue |= bit2 << 6;
+  if(ohcomp & 0x3a)
+    blue |= bit3 << 5;
+
+  if(ohcomp & 0x3d)
+    scale |= bit6 << 5;
+  if(ohcomp & 0x2d)
+    scale |= bit5 << 6;
+  if(ohcomp & 0x04)
+    scale |= bit4 << 7;
+
+  if(ohcomp & 0x3b)
+    red |= bit4 << 6;
+  if(ohcomp & 0x04)
+    red |= bit3 << 6;
+
+  if(ohcomp & 0x10)
+    red |= bit5 << 7;
+  if(ohcomp & 0x0f)
+    red |= bit2 << 7;
+
+  if(ohcomp & 0x05)
+    red |= bit1 << 8;
+  if(ohcomp & 0x0a)
+    red |= bit0 << 8;
+
+  if(ohcomp & 0x05)
+    red |= bit0 << 9;
+  if(ohcomp & 0x02)
+    red |= bit6 << 9;
+
+  if(ohcomp & 0x01)
+    red |= bit3 << 10;
+  if(ohcomp & 0x02)
+    red |= bit5 << 10;
+
+  static const int shamts[6] = {1, 1, 2, 3, 4, 5};
+  const int shamt = shamts[mode];
+  red <<= shamt;
+  green <<= shamt;
+  blue <<= shamt;
+  scale <<= shamt;
+
+  // all but the last mode store green and blue as differences from red
+  if(mode != 5)
+  {
+    green = red - green;
+    blue = red - blue;
+  }
+
+  if(majcomp == 1)
+    std::swap(red, green);
+  else if(majcomp == 2)
+    std::swap(red, blue);
+
+  const int red0 = RDCCLAMP(red - scale, 0, 0xfff);
+  const int green0 = RDCCLAMP(green - scale, 0, 0xfff);
+  const int blue0 = RDCCLAMP(blue - scale, 0, 0xfff);
+  red = RDCCLAMP(red, 0, 0xfff);
+  green = RDCCLAMP(green, 0, 0xfff);
+  blue = RDCCLAMP(blue, 0, 0xfff);
+
+  ASTCSetEndpoint(ret.e0, red0 << 4, green0 << 4, blue0 << 4, 0x7800);
+  ASTCSetEndpoint(ret.e1, red << 4, green << 4, blue << 4, 0x7800);
+}
+
+static void ASTCDecodeHDRRGB(const int *v, ASTCEndpoints &ret)
+{
+  const int v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3], v4 = v[4], v5 = v[5];
+
+  const int modeval = ((v1 & 0x80) >> 7) | (((v2 & 0x80) >> 7) << 1) | (((v3 & 0x80) >> 7) << 2);
+  const int majcomp = ((v4 & 0x80) >> 7) | (((v5 & 0x80) >> 7) << 1);
+
+  if(majcomp == 3)
+  {
+    ASTCSetEndpoint(ret.e0, v0 << 8, v2 << 8, (v4 & 0x7f) << 9, 0x7800);
+    ASTCSetEndpoint(ret.e1, v1 << 8, v3 << 8, (v5 & 0x7f) << 9, 0x7800);
+    return;
+  }
+
+  int a = v0 | ((v1 & 0x40) << 2);
+  int b0 = v2 & 0x3f;
+  int b1 = v3 & 0x3f;
+  int c = v1 & 0x3f;
+  int d0 = v4 & 0x7f;
+  int d1 = v5 & 0x7f;
+
+  static const int dbitsTable[8] = {7, 6, 7, 6, 5, 6, 5, 6};
+  const int dbits = dbitsTable[modeval];
+
+  const int bit0 = (v2 >> 6) & 1;
+  const int bit1 = (v3 >> 6) & 1;
+  const int bit2 = (v4 >> 6) & 1;
+  const int bit3 = (v5 >> 6) & 1;
+  const int bit4 = (v4 >> 5) & 1;
+  const int bit5 = (v5 >> 5) & 1;
+
+  const int ohmod = 1 << modeval;
+  if(ohmod & 0xa4)
+    a |= bit0 << 9;
+  if(ohmod & 0x8)
+    a |= bit2 << 9;
+  if(ohmod & 0x50)
+    a |= bit4 << 9;
+
+  if(ohmod & 0x50)
+    a |= bit5 << 10;
+  if(ohmod & 0xa0)
+    a |= bit1 << 10;
+
+  if(ohmod & 0xc0)
+    a |= bit2 << 11;
+
+  if(ohmod & 0x4)
+    c |= bit1 << 6;
+  if(ohmod & 0xe8)
+    c |= bit3 << 6;
+
+  if(ohmod & 0x20)
+    c |= bit2 << 7;
+
+  if(ohmod & 0x5b)
+  {
+    b0 |= bit0 << 6;
+    b1 |= bit1 << 6;
+  }
+
+  if(ohmod & 0x12)
+  {
+    b0 |= bit2 << 7;
+    b1 |= bit3 << 7;
+  }
+
+  if(ohmod & 0xaf)
+  {
+    d0 |= bit4 << 5;
+    d1 |= bit5 << 5;
+  }
+  if(ohmod & 0x5)
+  {
+    d0 |= bit2 << 6;
+    d1 |= bit3 << 6;
+  }
+
+  // sign extend the d values
+  const int sxShift = 32 - dbits;
+  d0 = int(uint32_t(d0) << sxShift) >> sxShift;
+  d1 = int(uint32_t(d1) << sxShift) >> sxShift;
+
+  // expand everything to 12 bits
+  const int valShift = (modeval >> 1) ^ 3;
+  a <<= valShift;
+  b0 <<= valShift;
+  b1 <<= valShift;
+  c <<= valShift;
+  d0 *= (1 << valShift);
+  d1 *= (1 << valShift);
+
+  int red1 = RDCCLAMP(a, 0, 0xfff);
+  int green1 = RDCCLAMP(a - b0, 0, 0xfff);
+  int blue1 = RDCCLAMP(a - b1, 0, 0xfff);
+  int red0 = RDCCLAMP(a - c, 0, 0xfff);
+  int green0 = RDCCLAMP(a - b0 - c - d0, 0, 0xfff);
+  int blue0 = RDCCLAMP(a - b1 - c - d1, 0, 0xfff);
+
+  if(majcomp == 1)
+  {
+    std::swap(red0, green0);
+    std::swap(red1, green1);
+  }
+  else if(majcomp == 2)
+  {
+    std::swap(red0, blue0);
+    std::swap(red1, blue1);
+  }
+
+  ASTCSetEndpoint(ret.e0, red0 << 4, green0 << 4, blue0 << 4, 0x7800);
+  ASTCSetEndpoint(ret.e1, red1 << 4, green1 << 4, blue1 << 4, 0x7800);
+}
+
+static void ASTCDecodeHDRAlpha(const int *v, ASTCEndpoints &ret)
+{
+  int v6 = v[6], v7 = v[7];
+
+  const int selector = ((v6 >> 7) & 1) | ((v7 >> 6) & 2);
+  v6 &= 0x7f;
+  v7 &= 0x7f;
+
+  if(selector == 3)
+  {
+    ret.e0[3] = v6 << 9;
+    ret.e1[3] = v7 << 9;
+    return;
+  }
+
+  v6 |= (v7 << (selector + 1)) & 0x780;
+  v7 &= (0x3f >> selector);
+  v7 ^= 32 >> selector;
+  v7 -= 32 >> selector;
+  v6 <<= (4 - selector);
+  v7 *= (1 << (4 - selector));
+  v7 += v6;
+
+  ret.e0[3] = v6 << 4;
+  ret.e1[3] = RDCCLAMP(v7, 0, 0xfff) << 4;
+}
+
+static void ASTCDecodeEndpoints(uint32_t cem, const int *v, ASTCEndpoints &ret)
+{
+  ret.hdrRGB = ret.hdrAlpha = false;
+
+  switch(cem)
+  {
+    // LDR luminance, direct
+    case 0:
+      ASTCSetEndpoint(ret.e0, v[0], v[0], v[0], 0xff);
+      ASTCSetEndpoint(ret.e1, v[1], v[1], v[1], 0xff);
+      break;
+    // LDR luminance, base+offset
+    case 1:
+    {
+      const int l0 = (v[0] >> 2) | (v[1] & 0xc0);
+      const int l1 = RDCMIN(l0 + (v[1] & 0x3f), 0xff);
+      ASTCSetEndpoint(ret.e0, l0, l0, l0, 0xff);
+      ASTCSetEndpoint(ret.e1, l1, l1, l1, 0xff);
+      break;
+    }
+    // HDR luminance, large range
+    case 2:
+    {
+      int y0, y1;
+      if(v[1] >= v[0])
+      {
+        y0 = v[0] << 4;
+        y1 = v[1] << 4;
+      }
+      else
+      {
+        y0 = (v[1] << 4) + 8;
+        y1 = (v[0] << 4) - 8;
+      }
+      ASTCSetEndpoint(ret.e0, y0 << 4, y0 << 4, y0 << 4, 0x7800);
+      ASTCSetEndpoint(ret.e1, y1 << 4, y1 << 4, y1 << 4, 0x7800);
+      ret.hdrRGB = ret.hdrAlpha = true;
+      break;
+    }
+    // HDR luminance, small range
+    case 3:
+    {
+      int y0, d;
+      if(v[0] & 0x80)
+      {
+        y0 = ((v[1] & 0xe0) << 4) | ((v[0] & 0x7f) << 2);
+        d = (v[1] & 0x1f) << 2;
+      }
+      else
+      {
+        y0 = ((v[1] & 0xf0) << 4) | ((v[0] & 0x7f) << 1);
+        d = (v[1] & 0x0f) << 1;
+      }
+      const int y1 = RDCMIN(y0 + d, 0xfff);
+      ASTCSetEndpoint(ret.e0, y0 << 4, y0 << 4, y0 << 4, 0x7800);
+      ASTCSetEndpoint(ret.e1, y1 << 4, y1 << 4, y1 << 4, 0x7800);
+      ret.hdrRGB = ret.hdrAlpha = true;
+      break;
+    }
+    // LDR luminance+alpha, direct
+    case 4:
+      ASTCSetEndpoint(ret.e0, v[0], v[0], v[0], v[2]);
+      ASTCSetEndpoint(ret.e1, v[1], v[1], v[1], v[3]);
+      break;
+    // LDR luminance+alpha, base+offset
+    case 5:
+    {
+      int v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+      ASTCBitTransferSigned(v1, v0);
+      ASTCBitTransferSigned(v3, v2);
+      ASTCSetEndpoint(ret.e0, v0, v0, v0, v2);
+      ASTCSetEndpoint(ret.e1, v0 + v1, v0 + v1, v0 + v1, v2 + v3);
+      ASTCClampLDR(ret.e0);
+      ASTCClampLDR(ret.e1);
+      break;
+    }
+    // LDR RGB, base+scale
+    case 6:
+      ASTCSetEndpoint(ret.e0, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, 0xff);
+      ASTCSetEndpoint(ret.e1, v[0], v[1], v[2], 0xff);
+      break;
+    // HDR RGB, base+scale
+    case 7:
+      ASTCDecodeHDRRGBScale(v, ret);
+      ret.hdrRGB = ret.hdrAlpha = true;
+      break;
+    // LDR RGB, direct
+    case 8:
+    case 12:
+    {
+      const int a0 = cem == 12 ? v[6] : 0xff;
+      const int a1 = cem == 12 ? v[7] : 0xff;
+      if(v[1] + v[3] + v[5] >= v[0] + v[2] + v[4])
+      {
+        ASTCSetEndpoint(ret.e0, v[0], v[2], v[4], a0);
+        ASTCSetEndpoint(ret.e1, v[1], v[3], v[5], a1);
+      }
+      else
+      {
+        ASTCBlueContract(ret.e0, v[1], v[3], v[5], a1);
+        ASTCBlueContract(ret.e1, v[0], v[2], v[4], a0);
+      }
+      break;
+    }
+    // LDR RGB, base+offset
+    case 9:
+    case 13:
+    {
+      int v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3], v4 = v[4], v5 = v[5];
+      int v6 = cem == 13 ? v[6] : 0xff, v7 = 0;
+      ASTCBitTransferSigned(v1, v0);
+      ASTCBitTransferSigned(v3, v2);
+      ASTCBitTransferSigned(v5, v4);
+      if(cem == 13)
+      {
+        v7 = v[7];
+        ASTCBitTransferSigned(v7, v6);
+      }
+
+      if(v1 + v3 + v5 >= 0)
+      {
+        ASTCSetEndpoint(ret.e0, v0, v2, v4, v6);
+        ASTCSetEndpoint(ret.e1, v0 + v1, v2 + v3, v4 + v5, v6 + v7);
+      }
+      else
+      {
+        ASTCBlueContract(ret.e0, v0 + v1, v2 + v3, v4 + v5, v6 + v7);
+        ASTCBlueContract(ret.e1, v0, v2, v4, v6);
+      }
+      ASTCClampLDR(ret.e0);
+      ASTCClampLDR(ret.e1);
+      break;
+    }
+    // LDR RGB, base+scale plus two alpha
+    case 10:
+      ASTCSetEndpoint(ret.e0, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, v[4]);
+      ASTCSetEndpoint(ret.e1, v[0], v[1], v[2], v[5]);
+      break;
+    // HDR RGB, direct
+    case 11:
+      ASTCDecodeHDRRGB(v, ret);
+      ret.hdrRGB = ret.hdrAlpha = true;
+      break;
+    // HDR RGB, direct with LDR alpha
+    case 14:
+      ASTCDecodeHDRRGB(v, ret);
+      ret.e0[3] = v[6];
+      ret.e1[3] = v[7];
+      ret.hdrRGB = true;
+      break;
+    // HDR RGBA, direct
+    case 15:
+      ASTCDecodeHDRRGB(v, ret);
+      ASTCDecodeHDRAlpha(v, ret);
+      ret.hdrRGB = ret.hdrAlpha = true;
+      break;
+  }
+}
+
+// convert an interpolated value in ASTC's HDR representation to a half float
+static uint16_t ASTCLNSToHalf(uint32_t c)
+{
+  const uint32_t e = (c >> 11) & 0x1f;
+  const uint32_t m = c & 0x7ff;
+
+  uint32_t mt;
+  if(m < 512)
+    mt = 3 * m;
+  else if(m >= 1536)
+    mt = 5 * m - 2048;
+  else
+    mt = 4 * m - 512;
+
+  return uint16_t(RDCMIN((e << 10) + (mt >> 3), 0x7bffU));
+}
+
+static void ASTCErrorBlock(uint32_t texelCount, DecodedTexel *texels)
+{
+  for(uint32_t i = 0; i < texelCount; i++)
+  {
+    texels[i][0] = 1.0f;
+    texels[i][1] = 0.0f;
+    texels[i][2] = 1.0f;
+    texels[i][3] = 1.0f;
+  }
+}
+
+static uint64_t ReverseBits64(uint64_t v)
+{
+  v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+  v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+  v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  v = ((v >> 8) & 0x00FF00FF00FF00FFULL) | ((v & 0x00FF00FF00FF00FFULL) << 8);
+  v = ((v >> 16) & 0x0000FFFF0000FFFFULL) | ((v & 0x0000FFFF0000FFFFULL) << 16);
+  return (v >> 32) | (v << 32);
+}
+};    // anonymous namespace
+
+// decode an ASTC block with the given footprint. sRGB blocks return the 8-bit sRGB encoded values
+// and HDR is only allowed when the format is a float format, otherwise HDR blocks decode to the
+// error colour like the LDR profile specifies.
+static void DecodeASTCBlock(const byte *src, uint32_t bw, uint32_t bh, uint32_t bd, bool srgb,
+                            bool hdr, DecodedTexel *texels)
+{
+  ASTCBits bits;
+  memcpy(&bits.lo, src, sizeof(uint64_t));
+  memcpy(&bits.hi, src + sizeof(uint64_t), sizeof(uint64_t));
+
+  const uint32_t texelCount = bw * bh * bd;
+
+  // convert a 16-bit LDR interpolation result to a normalised float
+  auto ldrToFloat = [srgb](uint32_t c) {
+    return srgb ? float(c >> 8) / 255.0f : float(c) / 65535.0f;
+  };
+
+  const uint32_t blockMode = bits.Get(0, 11);
+
+  // void-extent blocks are a single constant colour
+  if((blockMode & 0x1ff) == 0x1fc)
+  {
+    const bool voidHDR = (blockMode & 0x200) != 0;
+    if(voidHDR && !hdr)
+      return ASTCErrorBlock(texelCount, texels);
+
+    float colour[4];
+    for(uint32_t c = 0; c < 4; c++)
+    {
+      const uint32_t v = bits.Get(64 + c * 16, 16);
+      colour[c] = voidHDR ? ConvertFromHalf(uint16_t(v)) : ldrToFloat(v);
+    }
+
+    for(uint32_t i = 0; i < texelCount; i++)
+      memcpy(texels[i], colour, sizeof(colour));
+    return;
+  }
+
+  ASTCBlockMode mode = {};
+  if(!(bd > 1 ? DecodeASTCBlockMode3D(blockMode, mode) : DecodeASTCBlockMode2D(blockMode, mode)))
+    return ASTCErrorBlock(texelCount, texels);
+
+  if(mode.gridX > bw || mode.gridY > bh || mode.gridZ > bd)
+    return ASTCErrorBlock(texelCount, texels);
+
+  const uint32_t gridCount = mode.gridX * mode.gridY * mode.gridZ;
+  const uint32_t weightCount = gridCount * (mode.dualPlane ? 2 : 1);
+  if(weightCount > 64)
+    return ASTCErrorBlock(texelCount, texels);
+
+  const uint32_t weightBits = ASTCSequenceBits(weightCount, mode.weightQuant);
+  if(weightBits < 24 || weightBits > 96)
+    return ASTCErrorBlock(texelCount, texels);
+
+  const uint32_t partitionCount = bits.Get(11, 2) + 1;
+  if(partitionCount == 4 && mode.dualPlane)
+    return ASTCErrorBlock(texelCount, texels);
+
+  uint32_t cems[4] = {};
+  uint32_t seed = 0;
+  uint32_t colourStart = 17;
+  uint32_t belowWeights = 128 - weightBits;
+
+  if(partitionCount == 1)
+  {
+    cems[0] = bits.Get(13, 4);
+  }
+  else
+  {
+    seed = bits.Get(13, 10);
+    colourStart = 29;
+
+    uint32_t encoded = bits.Get(23, 6);
+    if((encoded & 0x3) == 0)
+    {
+      for(uint32_t p = 0; p < partitionCount; p++)
+        cems[p] = (encoded >> 2) & 0xf;
+    }
+    else
+    {
+      // the remaining mode bits are stored just below the weights
+      const uint32_t extraBits = 3 * partitionCount - 4;
+      belowWeights -= extraBits;
+      encoded |= bits.Get(belowWeights, extraBits) << 6;
+
+      const uint32_t baseClass = (encoded & 0x3) - 1;
+      uint32_t bitpos = 2;
+      for(uint32_t p = 0; p < partitionCount; p++, bitpos++)
+        cems[p] = (((encoded >> bitpos) & 0x1) + baseClass) << 2;
+      for(uint32_t p = 0; p < partitionCount; p++, bitpos += 2)
+        cems[p] |= (encoded >> bitpos) & 0x3;
+    }
+  }
+
+  uint32_t plane2Comp = ~0U;
+  if(mode.dualPlane)
+  {
+    belowWeights -= 2;
+    plane2Comp = bits.Get(belowWeights, 2);
+  }
+
+  if(belowWeights < colourStart)
+    return ASTCErrorBlock(texelCount, texels);
+
+  uint32_t colourValueCount = 0;
+  for(uint32_t p = 0; p < partitionCount; p++)
+    colourValueCount += ((cems[p] >> 2) + 1) * 2;
+
+  if(colourValueCount > 18)
+    return ASTCErrorBlock(texelCount, texels);
+
+  // the colour endpoints use the largest range that fits in the remaining space
+  const uint32_t colourBits = belowWeights - colourStart;
+  uint32_t colourQuant = 20;
+  while(colourQuant >= ASTCMinColourQuant &&
+        ASTCSequenceBits(colourValueCount, colourQuant) > colourBits)
+    colourQuant--;
+
+  if(colourQuant < ASTCMinColourQuant)
+    return ASTCErrorBlock(texelCount, texels);
+
+  const ASTCTables &tables = GetASTCTables();
+
+  uint8_t colourValues[18];
+  DecodeASTCSequence(bits, colourStart, colourValueCount, colourQuant, colourValues);
+
+  ASTCEndpoints endpoints[4];
+  {
+    const uint8_t *v = colourValues;
+    for(uint32_t p = 0; p < partitionCount; p++)
+    {
+      int unquant[8] = {};
+      const uint32_t count = ((cems[p] >> 2) + 1) * 2;
+      for(uint32_t i = 0; i < count; i++)
+        unquant[i] = tables.colourUnquant[colourQuant][v[i]];
+      v += count;
+
+      ASTCDecodeEndpoints(cems[p], unquant, endpoints[p]);
+
+      if(!hdr && (endpoints[p].hdrRGB || endpoints[p].hdrAlpha))
+        return ASTCErrorBlock(texelCount, texels);
+
+      // expand LDR endpoints to 16 bits. sRGB fills the low bits with 0x80 rather than replicating
+      for(uint32_t c = 0; c < 4; c++)
+      {
+        const bool channelHDR = c < 3 ? endpoints[p].hdrRGB : endpoints[p].hdrAlpha;
+        if(channelHDR)
+          continue;
+
+        int *e[2] = {&endpoints[p].e0[c], &endpoints[p].e1[c]};
+        for(int *x : e)
+          *x = srgb ? ((*x << 8) | 0x80) : (*x * 257);
+      }
+    }
+  }
+
+  // the weights are stored bit-reversed from the top of the block
+  uint8_t weights[64 + 4] = {};
+  {
+    ASTCBits reversed;
+    reversed.lo = ReverseBits64(bits.hi);
+    reversed.hi = ReverseBits64(bits.lo);
+
+    DecodeASTCSequence(reversed, 0, weightCount, mode.weightQuant, weights);
+
+    for(uint32_t i = 0; i < weightCount; i++)
+      weights[i] = tables.weightUnquant[mode.weightQuant][weights[i]];
+  }
+
+  const uint32_t planes = mode.dualPlane ? 2 : 1;
+
+  // weight of a grid point for the given plane, padded with zeros past the edge of the grid since
+  // the infill reads one past the last point with a 0 weight.
+  auto gridWeight = [&](uint32_t idx, uint32_t plane) -> int {
+    return idx < gridCount ? weights[idx * planes + plane] : 0;
+  };
+
+  const uint32_t Ds = (1024 + bw / 2) / (bw - 1);
+  const uint32_t Dt = (1024 + bh / 2) / (bh - 1);
+  const uint32_t Dr = bd > 1 ? (1024 + bd / 2) / (bd - 1) : 0;
+
+  const bool smallBlock = texelCount < 31;
+
+  for(uint32_t z = 0; z < bd; z++)
+  {
+    for(uint32_t y = 0; y < bh; y++)
+    {
+      for(uint32_t x = 0; x < bw; x++)
+      {
+        // infill the weight grid to this texel
+        const uint32_t gs = (Ds * x * (mode.gridX - 1) + 32) >> 6;
+        const uint32_t gt = (Dt * y * (mode.gridY - 1) + 32) >> 6;
+        const uint32_t gr = (Dr * z * (mode.gridZ - 1) + 32) >> 6;
+
+        const uint32_t js = gs >> 4, fs = gs & 0xf;
+        const uint32_t jt = gt >> 4, ft = gt & 0xf;
+        const uint32_t jr = gr >> 4, fr = gr & 0xf;
+
+        const uint32_t N = mode.gridX, NM = mode.gridX * mode.gridY;
+        const uint32_t v0 = js + jt * N + jr * NM;
+
+        int texelWeights[2] = {};
+
+        for(uint32_t plane = 0; plane < planes; plane++)
+        {
+          if(bd == 1)
+          {
+            const int w11 = int((fs * ft + 8) >> 4);
+            const int w10 = int(ft) - w11;
+            const int w01 = int(fs) - w11;
+            const int w00 = 16 - int(fs) - int(ft) + w11;
+
+            texelWeights[plane] =
+                (gridWeight(v0, plane) * w00 + gridWeight(v0 + 1, plane) * w01 +
+                 gridWeight(v0 + N, plane) * w10 + gridWeight(v0 + N + 1, plane) * w11 + 8) >>
+                4;
+          }
+          else
+          {
+            // 3D grids use simplex interpolation
+            const uint32_t cas = ((fs > ft) << 2) | ((ft > fr) << 1) | (fs > fr);
+            uint32_t s1, s2;
+            int w0, w1, w2, w3;
+            switch(cas)
+            {
+              case 7:
+                s1 = 1;
+                s2 = N;
+                w0 = 16 - fs;
+                w1 = fs - ft;
+                w2 = ft - fr;
+                w3 = fr;
+                break;
+              case 3:
+                s1 = N;
+                s2 = 1;
+                w0 = 16 - ft;
+                w1 = ft - fs;
+                w2 = fs - fr;
+                w3 = fr;
+                break;
+              case 5:
+                s1 = 1;
+                s2 = NM;
+                w0 = 16 - fs;
+                w1 = fs - fr;
+                w2 = fr - ft;
+                w3 = ft;
+                break;
+              case 4:
+                s1 = NM;
+                s2 = 1;
+                w0 = 16 - fr;
+                w1 = fr - fs;
+                w2 = fs - ft;
+                w3 = ft;
+                break;
+              case 2:
+                s1 = N;
+                s2 = NM;
+                w0 = 16 - ft;
+                w1 = ft - fr;
+                w2 = fr - fs;
+                w3 = fs;
+                break;
+              default:
+                s1 = NM;
+                s2 = N;
+                w0 = 16 - fr;
+                w1 = fr - ft;
+                w2 = ft - fs;
+                w3 = fs;
+                break;
+            }
+
+            texelWeights[plane] =
+                (gridWeight(v0, plane) * w0 + gridWeight(v0 + s1, plane) * w1 +
+                 gridWeight(v0 + s1 + s2, plane) * w2 + gridWeight(v0 + NM + N + 1, plane) * w3 +
+                 8) >>
+                4;
+          }
+        }
+
+        const uint32_t partition =
+            partitionCount > 1
+                ? ASTCSelectPartition(seed, x, y, z, partitionCount, smallBlock)
+                : 0;
+        const ASTCEndpoints &e = endpoints[partition];
+
+        float *out = texels[(z * bh + y) * bw + x];
+        for(uint32_t c = 0; c < 4; c++)
+        {
+          const int w = texelWeights[c == plane2Comp ? 1 : 0];
+          const uint32_t C = uint32_t(e.e0[c] * (64 - w) + e.e1[c] * w + 32) >> 6;
+
+          const bool channelHDR = c < 3 ? e.hdrRGB : e.hdrAlpha;
+          out[c] = channelHDR ? ConvertFromHalf(ASTCLNSToHalf(C)) : ldrToFloat(C);
+        }
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// PVRTC
+
+namespace
+{
+// the two low-resolution colours of a PVRTC block, in 5-bit RGB and 4-bit alpha
+struct PVRTCColours
+{
+  int a[4], b[4];
+};
+
+struct PVRTCImage
+{
+  const byte *data;
+  uint32_t blocksX, blocksY;
+  uint32_t blockWidth;
+
+  uint32_t Twiddle(uint32_t x, uint32_t y) const
+  {
+    // blocks are stored in morton order over the square part of the image, with the remaining
+    // bits of the larger dimension on top.
+    uint32_t minDim = blocksX, maxValue = y;
+    if(blocksY < blocksX)
+    {
+      minDim = blocksY;
+      maxValue = x;
+    }
+
+    uint32_t ret = 0;
+    uint32_t srcBit = 1, dstBit = 1, shift = 0;
+    while(srcBit < minDim)
+    {
+      if(y & srcBit)
+        ret |= dstBit;
+      if(x & srcBit)
+        ret |= dstBit << 1;
+      srcBit <<= 1;
+      dstBit <<= 2;
+      shift++;
+    }
+
+    return ret | ((maxValue >> shift) << (2 * shift));
+  }
+
+  void GetBlock(int x, int y, uint32_t &modulation, uint32_t &colour) const
+  {
+    // PVRTC1 wraps at the image edges
+    const uint32_t bx = uint32_t((x + int(blocksX)) % int(blocksX));
+    const uint32_t by = uint32_t((y + int(blocksY)) % int(blocksY));
+
+    const byte *block = data + Twiddle(bx, by) * 8;
+    memcpy(&modulation, block, sizeof(uint32_t));
+    memcpy(&colour, block + 4, sizeof(uint32_t));
+  }
+
+  PVRTCColours GetColours(int x, int y) const
+  {
+    uint32_t modulation, colour;
+    GetBlock(x, y, modulation, colour);
+
+    PVRTCColours ret;
+
+    // colour A is in the low half, with the modulation mode in the lowest bit
+    if(colour & 0x8000)
+    {
+      ret.a[0] = (colour >> 10) & 0x1f;
+      ret.a[1] = (colour >> 5) & 0x1f;
+      ret.a[2] = (colour & 0x1e) | ((colour & 0x1e) >> 4);
+      ret.a[3] = 0xf;
+    }
+    else
+    {
+      ret.a[0] = ((colour & 0xf00) >> 7) | ((colour & 0xf00) >> 11);
+      ret.a[1] = ((colour & 0xf0) >> 3) | ((colour & 0xf0) >> 7);
+      ret.a[2] = ((colour & 0xe) << 1) | ((colour & 0xe) >> 2);
+      ret.a[3] = (colour & 0x7000) >> 11;
+    }
+
+    if(colour & 0x80000000)
+    {
+      ret.b[0] = (colour >> 26) & 0x1f;
+      ret.b[1] = (colour >> 21) & 0x1f;
+      ret.b[2] = (colour >> 16) & 0x1f;
+      ret.b[3] = 0xf;
+    }
+    else
+    {
+      ret.b[0] = ((colour & 0xf000000) >> 23) | ((colour & 0xf000000) >> 27);
+      ret.b[1] = ((colour & 0xf00000) >> 19) | ((colour & 0xf00000) >> 23);
+      ret.b[2] = ((colour & 0xf0000) >> 15) | ((colour & 0xf0000) >> 19);
+      ret.b[3] = (colour & 0x70000000) >> 27;
+    }
+
+    return ret;
+  }
+
+  // the modulation weight out of 8 for a texel in 2bpp data that is stored explicitly, which is
+  // either any texel in a block without interpolated modulation, or the checkerboard texels with
+  // (x ^ y) even in a block with it.
+  int GetStored2bppModulation(int x, int y) const
+  {
+    static const int values[4] = {0, 3, 5, 8};
+
+    const int bx = int(floor(x / 8.0)), by = int(floor(y / 4.0));
+    const int px = x - bx * 8, py = y - by * 4;
+
+    uint32_t modulation, colour;
+    GetBlock(bx, by, modulation, colour);
+
+    if((colour & 0x1) == 0)
+      return ((modulation >> (py * 8 + px)) & 0x1) ? 8 : 0;
+
+    // the lowest bits of the first and centre values are used for flags, so they take their
+    // high bit's value instead.
+    if(modulation & 0x1)
+      modulation = (modulation & ~(1U << 20)) | (((modulation >> 21) & 0x1) << 20);
+    modulation = (modulation & ~1U) | ((modulation >> 1) & 0x1);
+
+    return values[(modulation >> ((py * 4 + px / 2) * 2)) & 0x3];
+  }
+
+  void DecodeTexel(int x, int y, float *out) const
+  {
+    const int bh = 4, bw = int(blockWidth);
+
+    // bilinearly upscale the A and B images, where each block's colours are centred in the block
+    const int sx = x - bw / 2, sy = y - bh / 2;
+    const int bx0 = int(floor(sx / double(bw))), by0 = int(floor(sy / double(bh)));
+    const int fx = sx - bx0 * bw, fy = sy - by0 * bh;
+
+    const PVRTCColours P = GetColours(bx0, by0), Q = GetColours(bx0 + 1, by0),
+                       R = GetColours(bx0, by0 + 1), S = GetColours(bx0 + 1, by0 + 1);
+
+    const int wP = (bw - fx) * (bh - fy), wQ = fx * (bh - fy), wR = (bw - fx) * fy, wS = fx * fy;
+    // scale the sums to a total weight of 32 to do the expansion to 8 bits in one step
+    const int scale = 32 / (bw * bh);
+
+    int colA[4], colB[4];
+    for(int c = 0; c < 4; c++)
+    {
+      const int a = (P.a[c] * wP + Q.a[c] * wQ + R.a[c] * wR + S.a[c] * wS) * scale;
+      const int b = (P.b[c] * wP + Q.b[c] * wQ + R.b[c] * wR + S.b[c] * wS) * scale;
+
+      if(c < 3)
+      {
+        colA[c] = (a >> 7) + (a >> 2);
+        colB[c] = (b >> 7) + (b >> 2);
+      }
+      else
+      {
+        colA[c] = (a >> 5) + (a >> 1);
+        colB[c] = (b >> 5) + (b >> 1);
+      }
+    }
+
+    // now find the modulation for this texel from its own block
+    const int bx = int(floor(x / double(bw))), by = int(floor(y / double(bh)));
+    const int px = x - bx * bw, py = y - by * bh;
+
+    uint32_t modulation, colour;
+    GetBlock(bx, by, modulation, colour);
+
+    int mod = 0;
+    bool punchthrough = false;
+
+    if(blockWidth == 4)
+    {
+      const uint32_t idx = (modulation >> ((py * 4 + px) * 2)) & 0x3;
+      if(colour & 0x1)
+      {
+        static const int values[4] = {0, 4, 4, 8};
+        mod = values[idx];
+        punchthrough = (idx == 2);
+      }
+      else
+      {
+        static const int values[4] = {0, 3, 5, 8};
+        mod = values[idx];
+      }
+    }
+    else if((colour & 0x1) == 0 || ((px ^ py) & 1) == 0)
+    {
+      mod = GetStored2bppModulation(x, y);
+    }
+    else
+    {
+      // interpolate from the neighbours, either in both directions or just horizontally or
+      // vertically as flagged in the block.
+      if(modulation & 0x1)
+      {
+        if(modulation & (1U << 20))
+          mod = (GetStored2bppModulation(x, y - 1) + GetStored2bppModulation(x, y + 1) + 1) / 2;
+        else
+          mod = (GetStored2bppModulation(x - 1, y) + GetStored2bppModulation(x + 1, y) + 1) / 2;
+      }
+      else
+      {
+        mod = (GetStored2bppModulation(x, y - 1) + GetStored2bppModulation(x, y + 1) +
+               GetStored2bppModulation(x - 1, y) + GetStored2bppModulation(x + 1, y) + 2) /
+              4;
+      }
+    }
+
+    for(int c = 0; c < 4; c++)
+      out[c] = float((colA[c] * (8 - mod) + colB[c] * mod) / 8) / 255.0f;
+
+    if(punchthrough)
+      out[3] = 0.0f;
+  }
+};
+};    // anonymous namespace
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// Output
+
+static uint32_t RemapTexelSize(RemapTexture remap)
+{
+  switch(remap)
+  {
+    case RemapTexture::RGBA8: return 4;
+    case RemapTexture::RGBA16: return 8;
+    case RemapTexture::RGBA32: return 16;
+    default: break;
+  }
+  return 0;
+}
+
+// write a decoded texel out the same way a GPU remap would: float outputs are linear, but 8-bit
+// outputs from sRGB formats keep the sRGB encoding as they're written to an sRGB target.
+static void WriteTexel(byte *out, RemapTexture remap, bool srgb, const float *texel)
+{
+  if(remap == RemapTexture::RGBA8)
+  {
+    for(int c = 0; c < 4; c++)
+      out[c] = byte(RDCCLAMP(texel[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+    return;
+  }
+
+  float linear[4];
+  for(int c = 0; c < 4; c++)
+    linear[c] = (srgb && c < 3) ? ConvertSRGBToLinear(texel[c]) : texel[c];
+
+  if(remap == RemapTexture::RGBA16)
+  {
+    uint16_t half[4];
+    for(int c = 0; c < 4; c++)
+      half[c] = ConvertToHalf(linear[c]);
+    memcpy(out, half, sizeof(half));
+  }
+  else
+  {
+    memcpy(out, linear, sizeof(linear));
+  }
+}
+
+bool CanDecodeBlockCompressed(const ResourceFormat &fmt)
+{
+  switch(fmt.type)
+  {
+    case ResourceFormatType::ETC2:
+    case ResourceFormatType::EAC: return true;
+    case ResourceFormatType::ASTC: return fmt.BlockWidth() != 0;
+    case ResourceFormatType::PVRTC:
+      // PVRTC1 is only 4x4 (4bpp) or 8x4 (2bpp)
+      return fmt.BlockHeight() == 4 && fmt.BlockDepth() == 1 &&
+             (fmt.BlockWidth() == 4 || fmt.BlockWidth() == 8);
+    default: break;
+  }
+
+  return false;
+}
+
+RDResult DecodeBlockCompressed(const ResourceFormat &fmt, RemapTexture remap, uint32_t width,
+                               uint32_t height, uint32_t depth, const bytebuf &src, bytebuf &dst)
+{
+  dst.clear();
+
+  if(!CanDecodeBlockCompressed(fmt))
+    RETURN_ERROR_RESULT(ResultCode::ImageUnsupported, "Can't decode %s on the CPU",
+                        fmt.Name().c_str());
+
+  const uint32_t texelSize = RemapTexelSize(remap);
+  if(texelSize == 0)
+    RETURN_ERROR_RESULT(ResultCode::InvalidParameter, "Invalid remap %s for block decoding",
+                        ToStr(remap).c_str());
+
+  width = RDCMAX(1U, width);
+  height = RDCMAX(1U, height);
+  depth = RDCMAX(1U, depth);
+
+  uint32_t bw = 4, bh = 4, bd = 1;
+  if(fmt.type == ResourceFormatType::ASTC || fmt.type == ResourceFormatType::PVRTC)
+  {
+    bw = fmt.BlockWidth();
+    bh = fmt.BlockHeight();
+    bd = fmt.BlockDepth();
+  }
+
+  const uint32_t blockSize = fmt.ElementSize();
+
+  uint32_t blocksX = (width + bw - 1) / bw;
+  uint32_t blocksY = (height + bh - 1) / bh;
+  const uint32_t blocksZ = (depth + bd - 1) / bd;
+
+  if(fmt.type == ResourceFormatType::PVRTC)
+  {
+    // PVRTC1 images are at least 2x2 blocks, but allow for data that's only as large as the image
+    if(src.size() >= size_t(RDCMAX(2U, blocksX)) * RDCMAX(2U, blocksY) * blockSize * depth)
+    {
+      blocksX = RDCMAX(2U, blocksX);
+      blocksY = RDCMAX(2U, blocksY);
+    }
+  }
+
+  const size_t blocksSize = size_t(blocksX) * blocksY * blocksZ * blockSize;
+  if(src.size() < blocksSize)
+    RETURN_ERROR_RESULT(ResultCode::InvalidParameter,
+                        "%s data for %ux%ux%u is %zu bytes, expected at least %zu",
+                        fmt.Name().c_str(), width, height, depth, src.size(), blocksSize);
+
+  dst.resize(size_t(width) * height * depth * texelSize);
+
+  const bool srgb = fmt.SRGBCorrected();
+
+  if(fmt.type == ResourceFormatType::PVRTC)
+  {
+    const size_t sliceSize = size_t(blocksX) * blocksY * blockSize;
+
+    DecodedTexel texel;
+    for(uint32_t z = 0; z < depth; z++)
+    {
+      PVRTCImage image = {src.data() + sliceSize * z, blocksX, blocksY, bw};
+
+      for(uint32_t y = 0; y < height; y++)
+      {
+        for(uint32_t x = 0; x < width; x++)
+        {
+          image.DecodeTexel(int(x), int(y), texel);
+          WriteTexel(dst.data() + ((size_t(z) * height + y) * width + x) * texelSize, remap, srgb,
+                     texel);
+        }
+      }
+    }
+
+    return ResultCode::Succeeded;
+  }
+
+  DecodedTexel texels[MaxBlockTexels];
+
+  const byte *block = src.data();
+  for(uint32_t bz = 0; bz < blocksZ; bz++)
+  {
+    for(uint32_t by = 0; by < blocksY; by++)
+    {
+      for(uint32_t bx = 0; bx < blocksX; bx++, block += blockSize)
+      {
+        if(fmt.type == ResourceFormatType::ASTC)
+        {
+          DecodeASTCBlock(block, bw, bh, bd, srgb, fmt.compType == CompType::Float, texels);
+        }
+        else if(fmt.type == ResourceFormatType::ETC2)
+        {
+          DecodeETC2Colour(block, fmt.compCount == 4, texels);
+        }
+        else if(fmt.compCount == 4)
+        {
+          // RGBA8 ETC2 has an EAC block for alpha before the colour block
+          DecodeETC2Colour(block + 8, false, texels);
+          DecodeEACChannel(block, false, false, 3, texels);
+        }
+        else
+        {
+          // R11 and RG11 EAC
+          const bool isSigned = fmt.compType == CompType::SNorm;
+          for(uint32_t i = 0; i < 16; i++)
+          {
+            texels[i][0] = texels[i][1] = texels[i][2] = 0.0f;
+            texels[i][3] = 1.0f;
+          }
+          DecodeEACChannel(block, true, isSigned, 0, texels);
+          if(fmt.compCount == 2)
+            DecodeEACChannel(block + 8, true, isSigned, 1, texels);
+        }
+
+        // write out the texels that are inside the image
+        for(uint32_t z = 0; z < bd && bz * bd + z < depth; z++)
+        {
+          for(uint32_t y = 0; y < bh && by * bh + y < height; y++)
+          {
+            byte *out = dst.data() + ((size_t(bz * bd + z) * height + by * bh + y) * width + bx * bw) *
+                                         texelSize;
+            for(uint32_t x = 0; x < bw && bx * bw + x < width; x++, out += texelSize)
+              WriteTexel(out, remap, srgb, texels[(z * bh + y) * bw + x]);
+          }
+        }
+      }
+    }
+  }
+
+  return ResultCode::Succeeded;
+}
@@ -0,0 +1,43 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "replay_driver.h"
+
+// CPU decoders for the mobile block-compressed formats - ETC2, EAC, ASTC (LDR and HDR, 2D and 3D
+// blocks) and PVRTC1. These let the raw block data be fetched and decompressed locally, instead of
+// requiring the replaying GPU to be able to sample the format and render it out to a remapped
+// texture.
+
+// returns true if the data for this format can be decoded with DecodeBlockCompressed. ASTC and
+// PVRTC need the block footprint to be known.
+bool CanDecodeBlockCompressed(const ResourceFormat &fmt);
+
+// decodes one subresource of raw block-compressed data, in the layout GetTextureData returns with
+// no remap. The result is in the same layout and format as GetTextureData would return with the
+// given remap: tightly packed RGBA8, RGBA16 float or RGBA32 float texels, with depth slices one
+// after another. width, height and depth are the subresource's dimensions in texels.
+RDResult DecodeBlockCompressed(const ResourceFormat &fmt, RemapTexture remap, uint32_t width,
+                               uint32_t height, uint32_t depth, const bytebuf &src, bytebuf &dst);
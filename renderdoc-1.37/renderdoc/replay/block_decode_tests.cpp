@@ -0,0 +1,444 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+#include "common/globalconfig.h"
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "block_decode.h"
+
+#include "catch/catch.hpp"
+
+static ResourceFormat MakeBlockFormat(ResourceFormatType type, uint8_t compCount,
+                                      CompType compType = CompType::UNorm)
+{
+  ResourceFormat ret;
+  ret.type = type;
+  ret.compCount = compCount;
+  ret.compByteWidth = 1;
+  ret.compType = compType;
+  return ret;
+}
+
+// set a bitfield in a little-endian block, for building ASTC blocks by hand
+static void SetBits(byte *block, uint32_t offset, uint32_t count, uint32_t value)
+{
+  for(uint32_t i = 0; i < count; i++)
+  {
+    const uint32_t bit = offset + i;
+    if(value & (1U << i))
+      block[bit / 8] |= byte(1U << (bit % 8));
+    else
+      block[bit / 8] &= byte(~(1U << (bit % 8)));
+  }
+}
+
+static void MakeASTCVoidExtent(byte *block, bool hdr, const uint16_t colour[4])
+{
+  memset(block, 0xff, 16);
+  SetBits(block, 0, 9, 0x1fc);
+  SetBits(block, 9, 1, hdr ? 1 : 0);
+  for(uint32_t c = 0; c < 4; c++)
+    SetBits(block, 64 + c * 16, 16, colour[c]);
+}
+
+static rdcarray<uint32_t> TexelsRGBA8(const bytebuf &data)
+{
+  rdcarray<uint32_t> ret;
+  ret.resize(data.size() / 4);
+  memcpy(ret.data(), data.data(), ret.byteSize());
+  return ret;
+}
+
+static uint32_t RGBA8(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+  return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+TEST_CASE("Check which block formats can be decoded", "[blockdecode]")
+{
+  CHECK(CanDecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::ETC2, 3)));
+  CHECK(CanDecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::EAC, 2)));
+  CHECK_FALSE(CanDecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::BC1, 4)));
+
+  // ASTC and PVRTC need to know the block size
+  ResourceFormat fmt = MakeBlockFormat(ResourceFormatType::ASTC, 4);
+  CHECK_FALSE(CanDecodeBlockCompressed(fmt));
+  fmt.SetBlockFootprint(10, 8, 1);
+  CHECK(fmt.BlockWidth() == 10);
+  CHECK(fmt.BlockHeight() == 8);
+  CHECK(fmt.BlockDepth() == 1);
+  CHECK(CanDecodeBlockCompressed(fmt));
+
+  // the footprint is independent of other flags
+  fmt.SetBGRAOrder(true);
+  CHECK(fmt.BlockWidth() == 10);
+  CHECK(fmt.BGRAOrder());
+  fmt.SetBGRAOrder(false);
+  CHECK(fmt.BlockHeight() == 8);
+
+  // formats compare the same whether or not the footprint is known
+  ResourceFormat unknown = MakeBlockFormat(ResourceFormatType::ASTC, 4);
+  CHECK((fmt == unknown));
+  CHECK_FALSE((fmt < unknown));
+  CHECK_FALSE((unknown < fmt));
+  unknown.SetBGRAOrder(true);
+  CHECK((fmt != unknown));
+
+  fmt.SetBlockFootprint(5, 7, 1);
+  CHECK(fmt.BlockWidth() == 0);
+  CHECK_FALSE(CanDecodeBlockCompressed(fmt));
+
+  fmt = MakeBlockFormat(ResourceFormatType::PVRTC, 4);
+  CHECK_FALSE(CanDecodeBlockCompressed(fmt));
+  fmt.SetBlockFootprint(8, 4, 1);
+  CHECK(CanDecodeBlockCompressed(fmt));
+}
+
+TEST_CASE("Decode ETC2 and EAC blocks", "[blockdecode]")
+{
+  bytebuf out;
+
+  SECTION("Individual mode")
+  {
+    // both sub-blocks are 0x8 in each channel, table 0, and every index is 0 for a +2 modifier
+    bytebuf src = {0x88, 0x88, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+    RDResult res = DecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::ETC2, 3),
+                                         RemapTexture::RGBA8, 4, 4, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+    REQUIRE(out.size() == 4 * 4 * 4);
+
+    for(uint32_t texel : TexelsRGBA8(out))
+      CHECK(texel == RGBA8(138, 138, 138, 255));
+  };
+
+  SECTION("Differential mode with a flipped split")
+  {
+    // base colour 16 in each channel with a delta of +1 for the second sub-block, which in the
+    // flipped case is the bottom half.
+    bytebuf src = {0x81, 0x81, 0x81, 0x03, 0x00, 0x00, 0x00, 0x00};
+
+    RDResult res = DecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::ETC2, 3),
+                                         RemapTexture::RGBA8, 4, 4, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    rdcarray<uint32_t> texels = TexelsRGBA8(out);
+    // 16 expands to 132 and 17 to 140, both plus 2
+    CHECK(texels[0] == RGBA8(134, 134, 134, 255));
+    CHECK(texels[7] == RGBA8(134, 134, 134, 255));
+    CHECK(texels[8] == RGBA8(142, 142, 142, 255));
+    CHECK(texels[15] == RGBA8(142, 142, 142, 255));
+  };
+
+  SECTION("Punch-through alpha")
+  {
+    // not opaque, and every index is 2 which makes the texel transparent black
+    bytebuf src = {0x80, 0x80, 0x80, 0x00, 0xff, 0xff, 0x00, 0x00};
+
+    RDResult res = DecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::ETC2, 4),
+                                         RemapTexture::RGBA8, 4, 4, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    for(uint32_t texel : TexelsRGBA8(out))
+      CHECK(texel == 0);
+
+    // with the opaque bit set the same indices select a colour instead
+    src[3] = 0x02;
+    res = DecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::ETC2, 4), RemapTexture::RGBA8,
+                                4, 4, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    for(uint32_t texel : TexelsRGBA8(out))
+      CHECK(texel == RGBA8(130, 130, 130, 255));
+  };
+
+  SECTION("EAC R11 and RG11")
+  {
+    // table 13 has a 0 modifier at index 4, which is 0b100 for every texel
+    const byte indices[6] = {0x92, 0x49, 0x24, 0x92, 0x49, 0x24};
+
+    bytebuf src = {128, 0x1d};
+    src.append(indices, 6);
+    src.append(bytebuf({0, 0x1d}));
+    src.append(indices, 6);
+
+    RDResult res = DecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::EAC, 2),
+                                         RemapTexture::RGBA32, 4, 4, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+    REQUIRE(out.size() == 4 * 4 * 16);
+
+    const float *texels = (const float *)out.data();
+    for(uint32_t i = 0; i < 16; i++)
+    {
+      CHECK(texels[i * 4 + 0] == (128 * 8 + 4) / 2047.0f);
+      CHECK(texels[i * 4 + 1] == 4 / 2047.0f);
+      CHECK(texels[i * 4 + 2] == 0.0f);
+      CHECK(texels[i * 4 + 3] == 1.0f);
+    }
+
+    // signed data has no bias, and a base of -128 is treated as -127
+    src[0] = 0x80;
+    res = DecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::EAC, 1, CompType::SNorm),
+                                RemapTexture::RGBA32, 4, 4, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    texels = (const float *)out.data();
+    CHECK(texels[0] == -127 * 8 / 1023.0f);
+  };
+
+  SECTION("Partial blocks and errors")
+  {
+    bytebuf src = {0x88, 0x88, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00};
+    src.append(src);
+
+    // a 6x3 image is two blocks wide, only the texels inside the image are written
+    RDResult res = DecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::ETC2, 3),
+                                         RemapTexture::RGBA8, 6, 3, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+    CHECK(out.size() == 6 * 3 * 4);
+
+    EXPECT_ERROR();
+    res = DecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::ETC2, 3), RemapTexture::RGBA8,
+                                12, 4, 1, src, out);
+    CHECK(res.code == ResultCode::InvalidParameter);
+
+    EXPECT_ERROR();
+    res = DecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::ETC2, 3),
+                                RemapTexture::NoRemap, 4, 4, 1, src, out);
+    CHECK(res.code == ResultCode::InvalidParameter);
+
+    EXPECT_ERROR();
+    res = DecodeBlockCompressed(MakeBlockFormat(ResourceFormatType::BC1, 4), RemapTexture::RGBA8,
+                                4, 4, 1, src, out);
+    CHECK(res.code == ResultCode::ImageUnsupported);
+  };
+}
+
+TEST_CASE("Decode ASTC blocks", "[blockdecode]")
+{
+  bytebuf out;
+
+  ResourceFormat fmt = MakeBlockFormat(ResourceFormatType::ASTC, 4);
+  fmt.SetBlockFootprint(4, 4, 1);
+
+  SECTION("LDR void-extent")
+  {
+    const uint16_t colour[4] = {0xffff, 0x0000, 0x8000, 0xffff};
+    bytebuf src;
+    src.resize(16);
+    MakeASTCVoidExtent(src.data(), false, colour);
+
+    RDResult res = DecodeBlockCompressed(fmt, RemapTexture::RGBA8, 4, 4, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    for(uint32_t texel : TexelsRGBA8(out))
+      CHECK(texel == RGBA8(255, 0, 128, 255));
+  };
+
+  SECTION("HDR void-extent")
+  {
+    // 2.0, 0.5, 0.0, 1.0 in half floats
+    const uint16_t colour[4] = {0x4000, 0x3800, 0x0000, 0x3c00};
+    bytebuf src;
+    src.resize(16);
+    MakeASTCVoidExtent(src.data(), true, colour);
+
+    fmt.compType = CompType::Float;
+    RDResult res = DecodeBlockCompressed(fmt, RemapTexture::RGBA32, 4, 4, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    const float *texels = (const float *)out.data();
+    CHECK(texels[0] == 2.0f);
+    CHECK(texels[1] == 0.5f);
+    CHECK(texels[2] == 0.0f);
+    CHECK(texels[3] == 1.0f);
+
+    // in an LDR format HDR blocks are errors and decode to magenta
+    fmt.compType = CompType::UNorm;
+    res = DecodeBlockCompressed(fmt, RemapTexture::RGBA8, 4, 4, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    CHECK(TexelsRGBA8(out)[0] == RGBA8(255, 0, 255, 255));
+  };
+
+  SECTION("Weighted luminance block")
+  {
+    // a 4x4 grid of 2-bit weights, one partition with direct LDR luminance endpoints 0 and 255
+    byte block[16] = {};
+    SetBits(block, 0, 11, 0x42);
+    SetBits(block, 11, 2, 0);
+    SetBits(block, 13, 4, 0);
+    SetBits(block, 17, 8, 0);
+    SetBits(block, 25, 8, 255);
+
+    // weights are stored bit-reversed from the top of the block, and each column has the same
+    // weight as its x coordinate.
+    for(uint32_t i = 0; i < 16; i++)
+    {
+      const uint32_t w = i % 4;
+      SetBits(block, 127 - i * 2, 1, w & 0x1);
+      SetBits(block, 126 - i * 2, 1, w >> 1);
+    }
+
+    bytebuf src(block, 16);
+
+    RDResult res = DecodeBlockCompressed(fmt, RemapTexture::RGBA8, 4, 4, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    rdcarray<uint32_t> texels = TexelsRGBA8(out);
+    for(uint32_t y = 0; y < 4; y++)
+    {
+      CHECK(texels[y * 4 + 0] == RGBA8(0, 0, 0, 255));
+      CHECK(texels[y * 4 + 1] == RGBA8(84, 84, 84, 255));
+      CHECK(texels[y * 4 + 2] == RGBA8(171, 171, 171, 255));
+      CHECK(texels[y * 4 + 3] == RGBA8(255, 255, 255, 255));
+    }
+
+    // sRGB data is returned still encoded, but decoded for float outputs
+    fmt.compType = CompType::UNormSRGB;
+    res = DecodeBlockCompressed(fmt, RemapTexture::RGBA32, 4, 4, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    const float *f = (const float *)out.data();
+    CHECK(f[0] == 0.0f);
+    CHECK(f[3 * 4 + 0] == Approx(1.0f));
+  };
+
+  SECTION("3D blocks")
+  {
+    fmt.SetBlockFootprint(3, 3, 3);
+
+    // a 4x4x4 texture is 2x2x2 blocks, give each a different colour
+    bytebuf src;
+    src.resize(8 * 16);
+    for(uint16_t b = 0; b < 8; b++)
+    {
+      const uint16_t colour[4] = {uint16_t(b * 0x1010), 0, 0, 0xffff};
+      MakeASTCVoidExtent(src.data() + b * 16, false, colour);
+    }
+
+    RDResult res = DecodeBlockCompressed(fmt, RemapTexture::RGBA8, 4, 4, 4, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+    REQUIRE(out.size() == 4 * 4 * 4 * 4);
+
+    rdcarray<uint32_t> texels = TexelsRGBA8(out);
+    for(uint32_t z = 0; z < 4; z++)
+    {
+      for(uint32_t y = 0; y < 4; y++)
+      {
+        for(uint32_t x = 0; x < 4; x++)
+        {
+          const uint32_t b = (z / 3) * 4 + (y / 3) * 2 + (x / 3);
+          CHECK(texels[(z * 4 + y) * 4 + x] == RGBA8(b * 0x10, 0, 0, 255));
+        }
+      }
+    }
+  };
+}
+
+TEST_CASE("Decode PVRTC blocks", "[blockdecode]")
+{
+  bytebuf out;
+
+  ResourceFormat fmt = MakeBlockFormat(ResourceFormatType::PVRTC, 4);
+
+  // opaque black for colour A and opaque white for colour B
+  const uint32_t colour = 0xffff8000;
+
+  SECTION("4bpp")
+  {
+    fmt.SetBlockFootprint(4, 4, 1);
+
+    for(uint32_t modulation : {0x00000000U, 0xffffffffU, 0x55555555U, 0xaaaaaaaaU})
+    {
+      bytebuf src;
+      for(int i = 0; i < 4; i++)
+      {
+        src.append((const byte *)&modulation, 4);
+        src.append((const byte *)&colour, 4);
+      }
+
+      RDResult res = DecodeBlockCompressed(fmt, RemapTexture::RGBA8, 8, 8, 1, src, out);
+      REQUIRE(res.code == ResultCode::Succeeded);
+      REQUIRE(out.size() == 8 * 8 * 4);
+
+      // the modulation weights are 0, 3/8, 5/8 and 8/8
+      uint32_t expected = 0;
+      if(modulation == 0xffffffffU)
+        expected = 255;
+      else if(modulation == 0x55555555U)
+        expected = 95;
+      else if(modulation == 0xaaaaaaaaU)
+        expected = 159;
+
+      for(uint32_t texel : TexelsRGBA8(out))
+        CHECK(texel == RGBA8(expected, expected, expected, 255));
+    }
+  };
+
+  SECTION("2bpp")
+  {
+    fmt.SetBlockFootprint(8, 4, 1);
+
+    const uint32_t modulation = 0x0f0f0f0f;
+    bytebuf src;
+    for(int i = 0; i < 4; i++)
+    {
+      src.append((const byte *)&modulation, 4);
+      src.append((const byte *)&colour, 4);
+    }
+
+    RDResult res = DecodeBlockCompressed(fmt, RemapTexture::RGBA8, 16, 8, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    // without interpolated modulation each bit selects A or B for one texel
+    rdcarray<uint32_t> texels = TexelsRGBA8(out);
+    for(uint32_t x = 0; x < 16; x++)
+    {
+      const uint32_t expected = (x % 8) < 4 ? 255 : 0;
+      CHECK(texels[x] == RGBA8(expected, expected, expected, 255));
+    }
+  };
+
+  SECTION("Small images are padded to 2x2 blocks")
+  {
+    fmt.SetBlockFootprint(4, 4, 1);
+
+    const uint32_t modulation = 0xffffffffU;
+    bytebuf src;
+    for(int i = 0; i < 4; i++)
+    {
+      src.append((const byte *)&modulation, 4);
+      src.append((const byte *)&colour, 4);
+    }
+
+    RDResult res = DecodeBlockCompressed(fmt, RemapTexture::RGBA8, 2, 2, 1, src, out);
+    REQUIRE(res.code == ResultCode::Succeeded);
+
+    for(uint32_t texel : TexelsRGBA8(out))
+      CHECK(texel == RGBA8(255, 255, 255, 255));
+  };
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
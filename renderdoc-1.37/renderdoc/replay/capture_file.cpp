@@ -841,12 +841,11 @@ rdcarray<rdcstr> CaptureFile::GetResolve(const rdcarray<uint64_t> &callstack)
     return ret;
   }
 
-  ret.reserve(callstack.size());
-  for(uint64_t frame : callstack)
-  {
-    Callstack::AddressDetails info = m_Resolver->GetAddr(frame);
+  rdcarray<Callstack::AddressDetails> infos = m_Resolver->GetAddrs(callstack);
+
+  ret.reserve(infos.size());
+  for(Callstack::AddressDetails &info : infos)
     ret.push_back(info.formattedString());
-  }
 
   return ret;
 }
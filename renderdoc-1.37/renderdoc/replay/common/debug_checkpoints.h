@@ -0,0 +1,213 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <map>
+#include "api/replay/rdcarray.h"
+#include "api/replay/shader_types.h"
+#include "common/common.h"
+
+// Checkpoints of a shader debugger's complete state, saved every so many steps so that an earlier
+// step can be reached again by restoring the nearest checkpoint before it and re-executing forward.
+// Checkpoints are keyed by the stepIndex of the last state emitted before they were saved.
+//
+// The number of checkpoints is bounded - when the limit is exceeded every other checkpoint is
+// dropped and the interval doubles, so memory use depends on the limit and not on how long the
+// shader runs. The checkpoint at step 0 is never dropped so every step stays reachable.
+template <typename Checkpoint>
+class DebugCheckpoints
+{
+public:
+  // an interval of 0 disables checkpoints
+  void Init(uint32_t interval, uint32_t maxCheckpoints)
+  {
+    m_Interval = interval;
+    m_MaxCheckpoints = RDCMAX(maxCheckpoints, 2U);
+    m_Checkpoints.clear();
+  }
+
+  bool Enabled() const { return m_Interval > 0; }
+  uint32_t Interval() const { return m_Interval; }
+  size_t Count() const { return m_Checkpoints.size(); }
+
+  // steps are only ever saved once, so re-executing past a step after restoring an earlier
+  // checkpoint doesn't save it again
+  bool ShouldSave(uint32_t step) const
+  {
+    if(m_Interval == 0 || (step % m_Interval) != 0)
+      return false;
+
+    return m_Checkpoints.empty() || step > m_Checkpoints.rbegin()->first;
+  }
+
+  // the number of steps after the given one until the next step that may be saved
+  uint32_t StepsUntilSave(uint32_t step) const
+  {
+    if(m_Interval == 0)
+      return ~0U;
+
+    return m_Interval - (step % m_Interval);
+  }
+
+  // returns a new checkpoint for the caller to fill out
+  Checkpoint &Add(uint32_t step)
+  {
+    Checkpoint &ret = m_Checkpoints[step];
+
+    if(m_Checkpoints.size() > m_MaxCheckpoints)
+    {
+      m_Interval *= 2;
+
+      for(auto it = m_Checkpoints.begin(); it != m_Checkpoints.end();)
+      {
+        if(it->first != step && (it->first % m_Interval) != 0)
+          it = m_Checkpoints.erase(it);
+        else
+          ++it;
+      }
+    }
+
+    return ret;
+  }
+
+  // calls func(step, checkpoint) for each checkpoint in step order
+  template <typename Func>
+  void ForEach(Func func)
+  {
+    for(auto it = m_Checkpoints.begin(); it != m_Checkpoints.end(); ++it)
+      func(it->first, it->second);
+  }
+
+  // returns the latest checkpoint at or before the given step, or NULL if there isn't one
+  const Checkpoint *FindNearest(uint32_t step, uint32_t &checkpointStep) const
+  {
+    auto it = m_Checkpoints.upper_bound(step);
+    if(it == m_Checkpoints.begin())
+      return NULL;
+
+    --it;
+    checkpointStep = it->first;
+    return &it->second;
+  }
+
+  // Brings a debugger to the state at stepIndex, where current is the stepIndex of the last state
+  // it emitted. If the target is behind, restore(step) is called to restore the nearest checkpoint
+  // at or before step. Then stepWorkgroup(states) is called to step the workgroup, appending any
+  // state emitted, until the target has been emitted or it returns false once the debugged lane
+  // has finished.
+  //
+  // Returns the state stopped at, whose changes are only those made by its own step. The initial
+  // state is restored rather than executed, so seeking to step 0 returns no changes.
+  template <typename RestoreFunc, typename StepFunc>
+  ShaderDebugState Seek(uint32_t current, uint32_t stepIndex, RestoreFunc restore,
+                        StepFunc stepWorkgroup) const
+  {
+    ShaderDebugState ret;
+
+    if(stepIndex == 0)
+    {
+      if(current != 0)
+        restore(0);
+
+      return ret;
+    }
+
+    // restart from the checkpoint before the target step, so that the target is re-executed and
+    // records its state. Checkpoints ahead of the current step are never restored, as a debugger
+    // may only be able to undo writes outside its own state and not redo the ones it skips
+    if(current >= stepIndex)
+      restore(stepIndex - 1);
+
+    // the debugged lane still records each step, as debuggers track state while recording that
+    // later steps depend on
+    rdcarray<ShaderDebugState> states;
+    while(ret.stepIndex < stepIndex)
+    {
+      states.clear();
+      if(!stepWorkgroup(states))
+        break;
+
+      if(!states.empty())
+        ret = std::move(states.back());
+    }
+
+    return ret;
+  }
+
+  // ContinueDebug returns every state once and in order, carrying on from the last one it returned
+  // even if the debugger has been seeked since. Called before ContinueDebug steps, with the number
+  // of states it has returned so far, to go back there. Returns true if the initial state has not
+  // been returned yet, which ContinueDebug must return first.
+  template <typename RestoreFunc, typename StepFunc>
+  bool Resume(uint32_t current, uint32_t numContinued, RestoreFunc restore,
+              StepFunc stepWorkgroup) const
+  {
+    uint32_t target = numContinued > 0 ? numContinued - 1 : 0;
+    if(current != target)
+      Seek(current, target, restore, stepWorkgroup);
+
+    return numContinued == 0;
+  }
+
+private:
+  uint32_t m_Interval = 0;
+  uint32_t m_MaxCheckpoints = 2;
+  std::map<uint32_t, Checkpoint> m_Checkpoints;
+};
+
+// a copy of a resource's contents held by checkpoints. Consecutive checkpoints share one copy while
+// the contents are unchanged, so large resources are only copied again after they're written
+class CheckpointBytes
+{
+public:
+  // returns prev with a new reference if it has the same contents, otherwise a new copy
+  static CheckpointBytes *Share(CheckpointBytes *prev, const bytebuf &data)
+  {
+    if(prev && prev->m_Data == data)
+    {
+      prev->AddRef();
+      return prev;
+    }
+
+    CheckpointBytes *ret = new CheckpointBytes;
+    ret->m_Data = data;
+    return ret;
+  }
+
+  const bytebuf &Data() const { return m_Data; }
+  void AddRef() { m_RefCount++; }
+  void Release()
+  {
+    if(--m_RefCount == 0)
+      delete this;
+  }
+
+private:
+  CheckpointBytes() = default;
+  ~CheckpointBytes() = default;
+
+  bytebuf m_Data;
+  uint32_t m_RefCount = 1;
+};
@@ -325,6 +325,16 @@ rdcarray<ShaderDebugState> DummyDriver::ContinueDebug(ShaderDebugger *debugger)
   return {};
 }
 
+ShaderDebugState DummyDriver::SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex)
+{
+  return {};
+}
+
+rdcarray<rdcarray<uint32_t>> DummyDriver::GetDebugLaneExecutions(ShaderDebugger *debugger)
+{
+  return {};
+}
+
 void DummyDriver::FreeDebugger(ShaderDebugger *debugger)
 {
 }
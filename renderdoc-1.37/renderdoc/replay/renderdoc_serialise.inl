@@ -410,6 +410,45 @@ void DoSerialise(SerialiserType &ser, ShaderDebugTrace &el)
   SIZE_CHECK(184);
 }
 
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, ShaderInstructionProfile &el)
+{
+  SERIALISE_MEMBER(instruction);
+  SERIALISE_MEMBER(executions);
+  SERIALISE_MEMBER(invocations);
+  SERIALISE_MEMBER(minExecutions);
+  SERIALISE_MEMBER(maxExecutions);
+
+  SIZE_CHECK(32);
+}
+
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, ShaderLineProfile &el)
+{
+  SERIALISE_MEMBER(fileIndex);
+  SERIALISE_MEMBER(line);
+  SERIALISE_MEMBER(executions);
+  SERIALISE_MEMBER(instructions);
+  SERIALISE_MEMBER(invocations);
+  SERIALISE_MEMBER(minExecutions);
+  SERIALISE_MEMBER(maxExecutions);
+
+  SIZE_CHECK(32);
+}
+
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, ShaderDebugProfile &el)
+{
+  SERIALISE_MEMBER(stage);
+  SERIALISE_MEMBER(invocations);
+  SERIALISE_MEMBER(failedInvocations);
+  SERIALISE_MEMBER(steps);
+  SERIALISE_MEMBER(instructions);
+  SERIALISE_MEMBER(lines);
+
+  SIZE_CHECK(72);
+}
+
 template <typename SerialiserType>
 void DoSerialise(SerialiserType &ser, TextureFilter &el)
 {
@@ -1000,6 +1039,23 @@ void DoSerialise(SerialiserType &ser, DebugPixelInputs &el)
   SIZE_CHECK(12);
 }
 
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, ShaderDebugInvocation &el)
+{
+  SERIALISE_MEMBER(stage);
+  SERIALISE_MEMBER(vertexId);
+  SERIALISE_MEMBER(instanceId);
+  SERIALISE_MEMBER(index);
+  SERIALISE_MEMBER(view);
+  SERIALISE_MEMBER(x);
+  SERIALISE_MEMBER(y);
+  SERIALISE_MEMBER(pixelInputs);
+  SERIALISE_MEMBER(groupId);
+  SERIALISE_MEMBER(threadId);
+
+  SIZE_CHECK(64);
+}
+
 #pragma region Common pipeline state
 
 template <typename SerialiserType>
@@ -2320,6 +2376,9 @@ INSTANTIATE_SERIALISE_TYPE(ShaderVariable)
 INSTANTIATE_SERIALISE_TYPE(SourceVariableMapping);
 INSTANTIATE_SERIALISE_TYPE(ShaderDebugState)
 INSTANTIATE_SERIALISE_TYPE(ShaderDebugTrace)
+INSTANTIATE_SERIALISE_TYPE(ShaderInstructionProfile)
+INSTANTIATE_SERIALISE_TYPE(ShaderLineProfile)
+INSTANTIATE_SERIALISE_TYPE(ShaderDebugProfile)
 INSTANTIATE_SERIALISE_TYPE(ResourceDescription)
 INSTANTIATE_SERIALISE_TYPE(TextureDescription)
 INSTANTIATE_SERIALISE_TYPE(BufferDescription)
@@ -2360,6 +2419,7 @@ INSTANTIATE_SERIALISE_TYPE(CounterValue)
 INSTANTIATE_SERIALISE_TYPE(GPUDevice)
 INSTANTIATE_SERIALISE_TYPE(ReplayOptions)
 INSTANTIATE_SERIALISE_TYPE(DebugPixelInputs)
+INSTANTIATE_SERIALISE_TYPE(ShaderDebugInvocation)
 INSTANTIATE_SERIALISE_TYPE(DescriptorRange)
 INSTANTIATE_SERIALISE_TYPE(Descriptor)
 INSTANTIATE_SERIALISE_TYPE(SamplerDescriptor)
@@ -26,6 +26,8 @@
 #include "replay_controller.h"
 #include <string.h>
 #include <time.h>
+#include "block_decode.h"
+#include "shader_profile.h"
 #include "common/dds_readwrite.h"
 #include "driver/ihv/amd/amd_isa.h"
 #include "driver/ihv/amd/amd_rgp.h"
@@ -597,7 +599,46 @@ bytebuf ReplayController::GetTextureData(ResourceId tex, const Subresource &sub)
   return ret;
 }
 
-ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const rdcstr &path)
+// everything needed to write out a texture once its data has been read back
+struct TextureSaveJob
+{
+  // the data for each subresource as returned by the replay, in the order it was fetched
+  struct Fetched
+  {
+    uint32_t mip;
+    bytebuf data;
+  };
+  rdcarray<Fetched> fetched;
+
+  rdcstr path;
+
+  // the save settings and texture description, after being adjusted for what's being written
+  TextureSave sd;
+  TextureDescription td;
+
+  // if the fetched data is raw blocks that need to be decoded with DecodeBlockCompressed
+  bool decodeOnCPU = false;
+  ResourceFormat sourceFormat;
+  RemapTexture remap = RemapTexture::NoRemap;
+
+  uint32_t numMips = 1;
+  uint32_t numSlices = 1;
+  uint32_t sliceOffset = 0;
+  bool singleSlice = false;
+
+  bool blockformat = false;
+  int blockSize = 0;
+  uint32_t bytesPerPixel = 1;
+  uint32_t rowPitch = 0;
+  uint32_t slicePitch = 0;
+};
+
+static RDResult WriteTextureSave(TextureSaveJob &job);
+
+// how many fetched textures can be waiting to be written at once, to bound memory use
+static const size_t MaxTextureSavesInFlight = 8;
+
+RDResult ReplayController::FetchTextureSave(const TextureSave &saveData, TextureSaveJob &job)
 {
   CHECK_REPLAY_THREAD();
   RENDERDOC_PROFILEFUNCTION();
@@ -763,8 +804,6 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
     // otherwise take all mips, as by default
   }
 
-  rdcarray<byte *> subdata;
-
   bool downcast = false;
 
   // don't support slice mappings for DDS - it supports slices natively
@@ -780,9 +819,11 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
 
   // we don't support any file formats that handle these block compression formats
   if(td.format.type == ResourceFormatType::ETC2 || td.format.type == ResourceFormatType::EAC ||
-     td.format.type == ResourceFormatType::ASTC)
+     td.format.type == ResourceFormatType::ASTC || td.format.type == ResourceFormatType::PVRTC)
     downcast = true;
 
+  const ResourceFormat sourceFormat = td.format;
+
   // for non-HDR always downcast if we're not already RGBA8 unorm
   if(sd.destType != FileType::DDS && sd.destType != FileType::HDR && sd.destType != FileType::EXR &&
      (td.format.compByteWidth != 1 || td.format.compCount != 4 ||
@@ -832,6 +873,14 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
     }
   }
 
+  // if we can decode the source format ourselves, fetch the raw blocks and decompress them here
+  // rather than relying on the replay GPU being able to sample the format. We can't do that if the
+  // data needs to be range-mapped or reinterpreted as a different type.
+  const bool decodeOnCPU =
+      remap != RemapTexture::NoRemap && CanDecodeBlockCompressed(sourceFormat) &&
+      sd.comp.blackPoint == 0.0f && sd.comp.whitePoint == 1.0f &&
+      (sd.typeCast == CompType::Typeless || sd.typeCast == sourceFormat.compType);
+
   uint32_t rowPitch = 0;
   uint32_t slicePitch = 0;
 
@@ -887,7 +936,8 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
     slicePitch = rowPitch * td.height;
   }
 
-  // loop over fetching subresources
+  // loop over fetching subresources. Any processing of the data is left for WriteTextureSave, so
+  // that it can be done off the replay thread while the next texture is fetched
   for(uint32_t s = 0; s < numSlices; s++)
   {
     uint32_t slice = s * sliceStride + sliceOffset;
@@ -901,78 +951,145 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
       params.standardLayout = true;
       params.typeCast = sd.typeCast;
       params.resolve = resolveSamples;
-      params.remap = remap;
+      params.remap = decodeOnCPU ? RemapTexture::NoRemap : remap;
       params.blackPoint = sd.comp.blackPoint;
       params.whitePoint = sd.comp.whitePoint;
 
       Subresource sub = {mip, slice / sampleCount, slice % sampleCount};
 
-      bytebuf data;
-      m_pDevice->GetTextureData(liveid, sub, params, data);
+      TextureSaveJob::Fetched fetched;
+      fetched.mip = m;
+      m_pDevice->GetTextureData(liveid, sub, params, fetched.data);
       FatalErrorCheck();
 
-      if(data.empty())
+      if(fetched.data.empty())
       {
-        for(size_t i = 0; i < subdata.size(); i++)
-          delete[] subdata[i];
-
         RETURN_ERROR_RESULT(ResultCode::DataNotAvailable,
                             "Couldn't readback bytes for mip %u, slice %u, sample %u", sub.mip,
                             sub.slice, sub.sample);
       }
 
-      if(td.depth == 1)
-      {
-        byte *bytes = new byte[data.size()];
-        memcpy(bytes, data.data(), data.size());
-        subdata.push_back(bytes);
-        continue;
-      }
+      job.fetched.push_back(std::move(fetched));
 
-      uint32_t mipSlicePitch = slicePitch;
+      // a 3D texture's depth slices all come back together, so skip over them. A single slice is
+      // extracted from the data when it's written
+      if(td.depth > 1 && numSlices != 1)
+        s += (RDCMAX(1U, td.depth >> m) - 1);
+    }
+  }
 
-      uint32_t w = RDCMAX(1U, td.width >> m);
-      uint32_t h = RDCMAX(1U, td.height >> m);
-      uint32_t d = RDCMAX(1U, td.depth >> m);
+  job.sd = sd;
+  job.td = td;
+  job.sourceFormat = sourceFormat;
+  job.remap = remap;
+  job.decodeOnCPU = decodeOnCPU;
+  job.numMips = numMips;
+  job.numSlices = numSlices;
+  job.sliceOffset = sliceOffset;
+  job.singleSlice = singleSlice;
+  job.blockformat = blockformat;
+  job.blockSize = blockSize;
+  job.bytesPerPixel = bytesPerPixel;
+  job.rowPitch = rowPitch;
+  job.slicePitch = slicePitch;
 
-      if(blockformat)
-      {
-        mipSlicePitch = RDCMAX(1U, ((w + 3) / 4)) * blockSize * RDCMAX(1U, h / 4);
-      }
-      else
-      {
-        mipSlicePitch = w * bytesPerPixel * h;
-      }
+  return ResultCode::Succeeded;
+}
+
+// decodes, converts and encodes the data fetched for a texture save, then writes it to disk. This
+// doesn't touch the replay so can be run on any thread
+static RDResult WriteTextureSave(TextureSaveJob &job)
+{
+  RENDERDOC_PROFILEFUNCTION();
+
+  TextureSave &sd = job.sd;
+  TextureDescription &td = job.td;
+  const rdcstr &path = job.path;
+  const uint32_t numMips = job.numMips;
+  const uint32_t numSlices = job.numSlices;
+  const uint32_t sliceOffset = job.sliceOffset;
+  const bool singleSlice = job.singleSlice;
+  const bool blockformat = job.blockformat;
+  const int blockSize = job.blockSize;
+  const uint32_t bytesPerPixel = job.bytesPerPixel;
+  const uint32_t slicePitch = job.slicePitch;
+  uint32_t rowPitch = job.rowPitch;
+
+  rdcarray<byte *> subdata;
+
+  for(TextureSaveJob::Fetched &fetched : job.fetched)
+  {
+    const uint32_t m = fetched.mip;
+    bytebuf data;
+    data.swap(fetched.data);
+
+    if(job.decodeOnCPU)
+    {
+      bytebuf decoded;
+      RDResult res = DecodeBlockCompressed(job.sourceFormat, job.remap, RDCMAX(1U, td.width >> m),
+                                           RDCMAX(1U, td.height >> m), RDCMAX(1U, td.depth >> m),
+                                           data, decoded);
 
-      // we don't support slice ranges, only all-or-nothing
-      // we're also not dealing with multisampled slices if
-      // depth > 1. So if we only want one slice out of a 3D texture
-      // then make sure we get it
-      if(numSlices == 1)
+      if(res != ResultCode::Succeeded)
       {
-        byte *depthslice = new byte[mipSlicePitch];
-        byte *b = data.data() + mipSlicePitch * sliceOffset;
-        memcpy(depthslice, b, mipSlicePitch);
-        subdata.push_back(depthslice);
+        for(size_t i = 0; i < subdata.size(); i++)
+          delete[] subdata[i];
 
-        continue;
+        return res;
       }
 
-      s += (d - 1);
+      data.swap(decoded);
+    }
 
-      byte *b = data.data();
+    if(td.depth == 1)
+    {
+      byte *bytes = new byte[data.size()];
+      memcpy(bytes, data.data(), data.size());
+      subdata.push_back(bytes);
+      continue;
+    }
 
-      // add each depth slice as a separate subdata
-      for(uint32_t di = 0; di < d; di++)
-      {
-        byte *depthslice = new byte[mipSlicePitch];
+    uint32_t mipSlicePitch = slicePitch;
 
-        memcpy(depthslice, b, mipSlicePitch);
+    uint32_t w = RDCMAX(1U, td.width >> m);
+    uint32_t h = RDCMAX(1U, td.height >> m);
+    uint32_t d = RDCMAX(1U, td.depth >> m);
 
-        subdata.push_back(depthslice);
+    if(blockformat)
+    {
+      mipSlicePitch = RDCMAX(1U, ((w + 3) / 4)) * blockSize * RDCMAX(1U, h / 4);
+    }
+    else
+    {
+      mipSlicePitch = w * bytesPerPixel * h;
+    }
 
-        b += mipSlicePitch;
-      }
+    // we don't support slice ranges, only all-or-nothing
+    // we're also not dealing with multisampled slices if
+    // depth > 1. So if we only want one slice out of a 3D texture
+    // then make sure we get it
+    if(numSlices == 1)
+    {
+      byte *depthslice = new byte[mipSlicePitch];
+      byte *b = data.data() + mipSlicePitch * sliceOffset;
+      memcpy(depthslice, b, mipSlicePitch);
+      subdata.push_back(depthslice);
+
+      continue;
+    }
+
+    byte *b = data.data();
+
+    // add each depth slice as a separate subdata
+    for(uint32_t di = 0; di < d; di++)
+    {
+      byte *depthslice = new byte[mipSlicePitch];
+
+      memcpy(depthslice, b, mipSlicePitch);
+
+      subdata.push_back(depthslice);
+
+      b += mipSlicePitch;
     }
   }
 
@@ -1459,6 +1576,90 @@ ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const r
   return res;
 }
 
+ResultDetails ReplayController::SaveTexture(const TextureSave &saveData, const rdcstr &path)
+{
+  CHECK_REPLAY_THREAD();
+  RENDERDOC_PROFILEFUNCTION();
+
+  TextureSaveJob job;
+  job.path = path;
+
+  RDResult res = FetchTextureSave(saveData, job);
+
+  if(res != ResultCode::Succeeded)
+    return res;
+
+  return WriteTextureSave(job);
+}
+
+ResultDetails ReplayController::SaveTextures(const rdcarray<TextureSave> &saveData,
+                                             const rdcarray<rdcstr> &paths)
+{
+  CHECK_REPLAY_THREAD();
+  RENDERDOC_PROFILEFUNCTION();
+
+  if(saveData.size() != paths.size())
+    RETURN_ERROR_RESULT(ResultCode::InvalidParameter,
+                        "Mismatched number of textures (%zu) and paths (%zu) to save",
+                        saveData.size(), paths.size());
+
+  rdcarray<RDResult> results;
+  results.resize(saveData.size());
+
+  // fetched textures are written out on the job system if it's available, so that the conversion
+  // and encoding of one texture overlaps with reading back the next
+  const bool useJobs = Threading::JobSystem::IsAvailable();
+
+  rdcarray<Threading::JobSystem::Job *> inFlight;
+
+  for(size_t i = 0; i < saveData.size(); i++)
+  {
+    TextureSaveJob *job = new TextureSaveJob;
+    job->path = paths[i];
+
+    results[i] = FetchTextureSave(saveData[i], *job);
+
+    if(results[i] != ResultCode::Succeeded)
+    {
+      delete job;
+      continue;
+    }
+
+    if(!useJobs)
+    {
+      results[i] = WriteTextureSave(*job);
+      delete job;
+      continue;
+    }
+
+    // wait for the oldest texture to be written before fetching any more
+    if(inFlight.size() >= MaxTextureSavesInFlight)
+    {
+      Threading::JobSystem::WaitForJob(inFlight[0]);
+      Threading::JobSystem::DeleteJob(inFlight[0]);
+      inFlight.erase(0);
+    }
+
+    inFlight.push_back(Threading::JobSystem::AddOwnedJob([&results, i, job]() {
+      results[i] = WriteTextureSave(*job);
+      delete job;
+    }));
+  }
+
+  for(Threading::JobSystem::Job *j : inFlight)
+  {
+    Threading::JobSystem::WaitForJob(j);
+    Threading::JobSystem::DeleteJob(j);
+  }
+
+  // return the first failure, if there was one
+  for(const RDResult &res : results)
+    if(res != ResultCode::Succeeded)
+      return res;
+
+  return RDResult();
+}
+
 rdcarray<PixelModification> ReplayController::PixelHistory(ResourceId target, uint32_t x, uint32_t y,
                                                            const Subresource &sub, CompType typeCast)
 {
@@ -1728,6 +1929,18 @@ rdcarray<ShaderDebugState> ReplayController::ContinueDebug(ShaderDebugger *debug
   return ret;
 }
 
+ShaderDebugState ReplayController::SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex)
+{
+  CHECK_REPLAY_THREAD();
+
+  RENDERDOC_PROFILEFUNCTION();
+
+  ShaderDebugState ret = m_pDevice->SeekDebug(debugger, stepIndex);
+  FatalErrorCheck();
+
+  return ret;
+}
+
 void ReplayController::FreeTrace(ShaderDebugTrace *trace)
 {
   CHECK_REPLAY_THREAD();
@@ -1740,6 +1953,102 @@ void ReplayController::FreeTrace(ShaderDebugTrace *trace)
   }
 }
 
+ShaderDebugProfile ReplayController::ProfileShaderDebug(
+    const rdcarray<ShaderDebugInvocation> &invocations)
+{
+  CHECK_REPLAY_THREAD();
+
+  RENDERDOC_PROFILEFUNCTION();
+
+  ShaderStage stage = invocations.empty() ? ShaderStage::Vertex : invocations[0].stage;
+
+  ShaderProfileBuilder builder(stage);
+
+  // compute and mesh debugging simulates the whole workgroup, so where the driver can return what
+  // the other threads executed, each group only needs to be simulated once
+  rdcarray<rdcfixedarray<uint32_t, 3>> simulatedGroups;
+
+  // invocations are debugged one after another rather than as jobs. Setting up a debug replays on
+  // the GPU to fetch inputs, and the API wrappers read resource contents lazily through the driver
+  // while stepping, none of which is thread-safe. The work that dominates - stepping the lanes of
+  // a workgroup - is already spread across worker threads by the debugger.
+  for(const ShaderDebugInvocation &inv : invocations)
+  {
+    ShaderDebugTrace *trace = NULL;
+
+    if((stage == ShaderStage::Compute || stage == ShaderStage::Mesh) &&
+       simulatedGroups.contains(inv.groupId))
+      continue;
+
+    if(inv.stage == stage)
+    {
+      switch(stage)
+      {
+        case ShaderStage::Vertex:
+          trace = m_pDevice->DebugVertex(m_EventID, inv.vertexId, inv.instanceId, inv.index,
+                                         inv.view);
+          break;
+        case ShaderStage::Pixel:
+          trace = m_pDevice->DebugPixel(m_EventID, inv.x, inv.y, inv.pixelInputs);
+          break;
+        case ShaderStage::Compute:
+          trace = m_pDevice->DebugThread(m_EventID, inv.groupId, inv.threadId);
+          break;
+        case ShaderStage::Mesh:
+          trace = m_pDevice->DebugMeshThread(m_EventID, inv.groupId, inv.threadId);
+          break;
+        default: RDCERR("Unsupported stage %s for shader debugging", ToStr(stage).c_str()); break;
+      }
+      FatalErrorCheck();
+    }
+
+    if(!trace || !trace->debugger)
+    {
+      builder.AddFailedInvocation();
+      delete trace;
+      continue;
+    }
+
+    builder.BeginInvocation(trace->instInfo);
+
+    for(;;)
+    {
+      rdcarray<ShaderDebugState> states = m_pDevice->ContinueDebug(trace->debugger);
+      FatalErrorCheck();
+
+      if(states.empty())
+        break;
+
+      builder.AddStates(states);
+    }
+
+    builder.EndInvocation();
+
+    rdcarray<rdcarray<uint32_t>> laneExecutions = m_pDevice->GetDebugLaneExecutions(trace->debugger);
+    FatalErrorCheck();
+
+    if(!laneExecutions.empty())
+    {
+      for(const rdcarray<uint32_t> &executions : laneExecutions)
+      {
+        builder.BeginInvocation(trace->instInfo);
+        builder.AddExecutions(executions);
+        builder.EndInvocation();
+      }
+
+      simulatedGroups.push_back(inv.groupId);
+    }
+
+    m_pDevice->FreeDebugger(trace->debugger);
+    delete trace;
+  }
+
+  // debugging may have replayed to different points, restore the current event
+  SetFrameEvent(m_EventID, true);
+
+  return builder.Finish();
+}
+
 rdcarray<ShaderVariable> ReplayController::GetCBufferVariableContents(
     ResourceId pipeline, ResourceId shader, ShaderStage stage, const rdcstr &entryPoint,
     uint32_t cbufslot, ResourceId buffer, uint64_t offset, uint64_t length)
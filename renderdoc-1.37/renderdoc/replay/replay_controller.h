@@ -131,6 +131,8 @@ private:
   friend struct ReplayController;
 };
 
+struct TextureSaveJob;
+
 struct ReplayController : public IReplayController
 {
 public:
@@ -218,7 +220,9 @@ public:
   ShaderDebugTrace *DebugMeshThread(const rdcfixedarray<uint32_t, 3> &groupid,
                                     const rdcfixedarray<uint32_t, 3> &threadid);
   rdcarray<ShaderDebugState> ContinueDebug(ShaderDebugger *debugger);
+  ShaderDebugState SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex);
   void FreeTrace(ShaderDebugTrace *trace);
+  ShaderDebugProfile ProfileShaderDebug(const rdcarray<ShaderDebugInvocation> &invocations);
 
   MeshFormat GetPostVSData(uint32_t instID, uint32_t viewID, MeshDataStage stage);
 
@@ -228,6 +232,7 @@ public:
   bytebuf GetTextureData(ResourceId buff, const Subresource &sub);
 
   ResultDetails SaveTexture(const TextureSave &saveData, const rdcstr &path);
+  ResultDetails SaveTextures(const rdcarray<TextureSave> &saveData, const rdcarray<rdcstr> &paths);
 
   rdcarray<ShaderVariable> GetCBufferVariableContents(ResourceId pipeline, ResourceId shader,
                                                       ShaderStage stage, const rdcstr &entryPoint,
@@ -254,6 +259,8 @@ private:
 
   void FetchPipelineState(uint32_t eventId);
 
+  RDResult FetchTextureSave(const TextureSave &saveData, TextureSaveJob &job);
+
   ActionDescription *GetActionByEID(uint32_t eventId);
   bool ContainsMarker(const rdcarray<ActionDescription> &actions);
   bool PassEquivalent(const ActionDescription &a, const ActionDescription &b);
@@ -236,6 +236,11 @@ public:
                                             const rdcfixedarray<uint32_t, 3> &groupid,
                                             const rdcfixedarray<uint32_t, 3> &threadid) = 0;
   virtual rdcarray<ShaderDebugState> ContinueDebug(ShaderDebugger *debugger) = 0;
+  virtual ShaderDebugState SeekDebug(ShaderDebugger *debugger, uint32_t stepIndex) = 0;
+  // once the debugged invocation has finished, returns per-instruction execution counts for each
+  // other invocation that was simulated alongside it, if the debugger simulates them faithfully.
+  // Used for profiling, so that a compute workgroup only needs to be simulated once.
+  virtual rdcarray<rdcarray<uint32_t>> GetDebugLaneExecutions(ShaderDebugger *debugger) = 0;
   virtual void FreeDebugger(ShaderDebugger *debugger) = 0;
 
   virtual ResourceId RenderOverlay(ResourceId texid, FloatVector clearCol, DebugOverlay overlay,
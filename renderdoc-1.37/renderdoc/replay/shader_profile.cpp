@@ -0,0 +1,378 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include "shader_profile.h"
+#include <algorithm>
+#include "common/common.h"
+
+void ShaderProfileBuilder::BeginInvocation(const rdcarray<InstructionSourceInfo> &instInfo)
+{
+  m_InstInfo = &instInfo;
+  m_Started = false;
+  m_NextInstruction = 0;
+}
+
+void ShaderProfileBuilder::AddStates(const rdcarray<ShaderDebugState> &states)
+{
+  for(const ShaderDebugState &state : states)
+  {
+    // the first state is the initial state before anything has executed. Every state after that
+    // is the result of executing the instruction the previous state was about to run
+    if(m_Started)
+      Execute(m_NextInstruction);
+
+    m_Started = true;
+    m_NextInstruction = state.nextInstruction;
+  }
+}
+
+void ShaderProfileBuilder::AddExecutions(const rdcarray<uint32_t> &executions)
+{
+  for(uint32_t instruction = 0; instruction < executions.size(); instruction++)
+  {
+    if(executions[instruction] > 0)
+      Execute(instruction, executions[instruction]);
+  }
+}
+
+void ShaderProfileBuilder::Execute(uint32_t instruction, uint32_t count)
+{
+  if(instruction >= m_Instructions.size())
+    m_Instructions.resize(instruction + 1);
+
+  InstructionCounts &inst = m_Instructions[instruction];
+
+  if(inst.current == 0)
+    m_TouchedInstructions.push_back(instruction);
+  inst.current += count;
+
+  m_Profile.steps += count;
+}
+
+int32_t ShaderProfileBuilder::LookupLine(uint32_t instruction)
+{
+  InstructionCounts &inst = m_Instructions[instruction];
+
+  if(inst.lineIndex != UnknownLine)
+    return inst.lineIndex;
+
+  inst.lineIndex = NoLine;
+
+  if(!m_InstInfo)
+    return inst.lineIndex;
+
+  // same lookup as the shader viewer uses, instInfo may be sparse
+  InstructionSourceInfo search;
+  search.instruction = instruction;
+  auto it = std::lower_bound(m_InstInfo->begin(), m_InstInfo->end(), search);
+  if(it == m_InstInfo->end())
+    return inst.lineIndex;
+
+  const LineColumnInfo &lineInfo = it->lineInfo;
+
+  // prefer the source line, but fall back to disassembly if there's no source mapping
+  rdcpair<int32_t, uint32_t> key;
+  if(lineInfo.fileIndex >= 0 && lineInfo.lineStart > 0)
+    key = {lineInfo.fileIndex, lineInfo.lineStart};
+  else if(lineInfo.disassemblyLine > 0)
+    key = {-1, lineInfo.disassemblyLine};
+  else
+    return inst.lineIndex;
+
+  auto lineIt = m_LineLookup.find(key);
+  if(lineIt == m_LineLookup.end())
+  {
+    ShaderLineProfile line;
+    line.fileIndex = key.first;
+    line.line = key.second;
+
+    lineIt = m_LineLookup.insert(std::make_pair(key, m_Profile.lines.count())).first;
+    m_Profile.lines.push_back(line);
+    m_LineCurrent.push_back(0);
+  }
+
+  inst.lineIndex = lineIt->second;
+  return inst.lineIndex;
+}
+
+void ShaderProfileBuilder::EndInvocation()
+{
+  m_Profile.invocations++;
+
+  for(uint32_t instruction : m_TouchedInstructions)
+  {
+    InstructionCounts &inst = m_Instructions[instruction];
+    ShaderInstructionProfile &profile = inst.profile;
+
+    profile.instruction = instruction;
+    profile.executions += inst.current;
+    if(profile.invocations == 0)
+    {
+      profile.minExecutions = profile.maxExecutions = inst.current;
+    }
+    else
+    {
+      profile.minExecutions = RDCMIN(profile.minExecutions, inst.current);
+      profile.maxExecutions = RDCMAX(profile.maxExecutions, inst.current);
+    }
+    profile.invocations++;
+
+    int32_t lineIndex = LookupLine(instruction);
+    if(lineIndex >= 0)
+    {
+      m_Profile.lines[lineIndex].executions += inst.current;
+
+      // a line's trip count is that of its most executed instruction, so that a line with several
+      // instructions in a loop body counts once per iteration
+      if(m_LineCurrent[lineIndex] == 0)
+        m_TouchedLines.push_back(lineIndex);
+      m_LineCurrent[lineIndex] = RDCMAX(m_LineCurrent[lineIndex], inst.current);
+    }
+
+    inst.current = 0;
+  }
+
+  for(int32_t lineIndex : m_TouchedLines)
+  {
+    ShaderLineProfile &line = m_Profile.lines[lineIndex];
+    uint32_t current = m_LineCurrent[lineIndex];
+
+    if(line.invocations == 0)
+    {
+      line.minExecutions = line.maxExecutions = current;
+    }
+    else
+    {
+      line.minExecutions = RDCMIN(line.minExecutions, current);
+      line.maxExecutions = RDCMAX(line.maxExecutions, current);
+    }
+    line.invocations++;
+
+    m_LineCurrent[lineIndex] = 0;
+  }
+
+  m_TouchedInstructions.clear();
+  m_TouchedLines.clear();
+  m_InstInfo = NULL;
+}
+
+ShaderDebugProfile ShaderProfileBuilder::Finish()
+{
+  ShaderDebugProfile ret = m_Profile;
+
+  for(const InstructionCounts &inst : m_Instructions)
+  {
+    if(inst.profile.invocations == 0)
+      continue;
+
+    ret.instructions.push_back(inst.profile);
+
+    if(inst.lineIndex >= 0)
+      ret.lines[inst.lineIndex].instructions++;
+  }
+
+  std::sort(ret.lines.begin(), ret.lines.end());
+
+  return ret;
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Check shader debug profile accumulation", "[shaderprofile]")
+{
+  // a small program with a loop and a branch:
+  //   0     line 1
+  //   1     line 2, loop header
+  //   2     line 3, loop body
+  //   3     line 2, loop back-edge
+  //   4     no source, disassembly line 40, only taken by some invocations
+  //   5     line 5
+  rdcarray<InstructionSourceInfo> instInfo;
+
+  auto addInfo = [&instInfo](uint32_t instruction, int32_t fileIndex, uint32_t line,
+                             uint32_t disasmLine) {
+    InstructionSourceInfo info;
+    info.instruction = instruction;
+    info.lineInfo.fileIndex = fileIndex;
+    info.lineInfo.lineStart = info.lineInfo.lineEnd = line;
+    info.lineInfo.disassemblyLine = disasmLine;
+    instInfo.push_back(info);
+  };
+
+  addInfo(0, 0, 1, 10);
+  addInfo(1, 0, 2, 11);
+  addInfo(2, 0, 3, 12);
+  addInfo(3, 0, 2, 13);
+  addInfo(4, -1, 0, 40);
+  addInfo(5, 0, 5, 50);
+
+  auto makeStates = [](const rdcarray<uint32_t> &executed) {
+    rdcarray<ShaderDebugState> states;
+    ShaderDebugState state;
+    for(uint32_t inst : executed)
+    {
+      state.nextInstruction = inst;
+      states.push_back(state);
+      state.stepIndex++;
+    }
+    // final state after the last instruction executed
+    states.push_back(state);
+    return states;
+  };
+
+  ShaderProfileBuilder builder(ShaderStage::Pixel);
+
+  // two loop iterations and the branch taken. Split the states across two calls like
+  // ContinueDebug would return them
+  {
+    rdcarray<ShaderDebugState> states = makeStates({0, 1, 2, 3, 1, 2, 3, 4, 5});
+
+    rdcarray<ShaderDebugState> first, second;
+    first.append(states.data(), 4);
+    second.append(states.data() + 4, states.count() - 4);
+
+    builder.BeginInvocation(instInfo);
+    builder.AddStates(first);
+    builder.AddStates(second);
+    builder.EndInvocation();
+  }
+
+  // one loop iteration and the branch not taken
+  builder.BeginInvocation(instInfo);
+  builder.AddStates(makeStates({0, 1, 2, 3, 5}));
+  builder.EndInvocation();
+
+  builder.AddFailedInvocation();
+
+  ShaderDebugProfile profile = builder.Finish();
+
+  CHECK(profile.stage == ShaderStage::Pixel);
+  CHECK(profile.invocations == 2);
+  CHECK(profile.failedInvocations == 1);
+  CHECK(profile.steps == 14);
+
+  REQUIRE(profile.instructions.size() == 6);
+
+  SECTION("Instructions")
+  {
+    const ShaderInstructionProfile &entry = profile.instructions[0];
+    CHECK(entry.instruction == 0);
+    CHECK(entry.executions == 2);
+    CHECK(entry.invocations == 2);
+    CHECK(entry.minExecutions == 1);
+    CHECK(entry.maxExecutions == 1);
+
+    const ShaderInstructionProfile &loopBody = profile.instructions[2];
+    CHECK(loopBody.instruction == 2);
+    CHECK(loopBody.executions == 3);
+    CHECK(loopBody.invocations == 2);
+    CHECK(loopBody.minExecutions == 1);
+    CHECK(loopBody.maxExecutions == 2);
+
+    const ShaderInstructionProfile &branch = profile.instructions[4];
+    CHECK(branch.instruction == 4);
+    CHECK(branch.executions == 1);
+    CHECK(branch.invocations == 1);
+    CHECK(branch.minExecutions == 1);
+    CHECK(branch.maxExecutions == 1);
+  };
+
+  SECTION("Lines")
+  {
+    REQUIRE(profile.lines.size() == 5);
+
+    // disassembly-only lines sort first
+    const ShaderLineProfile &branch = profile.lines[0];
+    CHECK(branch.fileIndex == -1);
+    CHECK(branch.line == 40);
+    CHECK(branch.executions == 1);
+    CHECK(branch.instructions == 1);
+    CHECK(branch.invocations == 1);
+
+    const ShaderLineProfile &loopHeader = profile.lines[2];
+    CHECK(loopHeader.fileIndex == 0);
+    CHECK(loopHeader.line == 2);
+    CHECK(loopHeader.executions == 6);
+    CHECK(loopHeader.instructions == 2);
+    CHECK(loopHeader.invocations == 2);
+    CHECK(loopHeader.minExecutions == 1);
+    CHECK(loopHeader.maxExecutions == 2);
+
+    const ShaderLineProfile &exit = profile.lines[4];
+    CHECK(exit.fileIndex == 0);
+    CHECK(exit.line == 5);
+    CHECK(exit.executions == 2);
+    CHECK(exit.invocations == 2);
+  };
+
+  SECTION("Execution counts")
+  {
+    // the same two invocations as counts per instruction, as returned for the other lanes of a
+    // simulated workgroup
+    ShaderProfileBuilder countBuilder(ShaderStage::Pixel);
+
+    countBuilder.BeginInvocation(instInfo);
+    countBuilder.AddExecutions({1, 2, 2, 2, 1, 1});
+    countBuilder.EndInvocation();
+
+    countBuilder.BeginInvocation(instInfo);
+    countBuilder.AddExecutions({1, 1, 1, 1, 0, 1});
+    countBuilder.EndInvocation();
+
+    ShaderDebugProfile countProfile = countBuilder.Finish();
+
+    CHECK(countProfile.invocations == profile.invocations);
+    CHECK(countProfile.steps == profile.steps);
+    CHECK((countProfile.instructions == profile.instructions));
+    CHECK((countProfile.lines == profile.lines));
+  };
+
+  SECTION("Sparse instruction info")
+  {
+    // instruction 1 has no entry, so it maps to instruction 2's line like the shader viewer does
+    rdcarray<InstructionSourceInfo> sparse;
+    sparse.push_back(instInfo[0]);
+    sparse.push_back(instInfo[2]);
+
+    ShaderProfileBuilder sparseBuilder(ShaderStage::Compute);
+    sparseBuilder.BeginInvocation(sparse);
+    sparseBuilder.AddStates(makeStates({0, 1, 2}));
+    sparseBuilder.EndInvocation();
+
+    ShaderDebugProfile sparseProfile = sparseBuilder.Finish();
+
+    REQUIRE(sparseProfile.lines.size() == 2);
+    CHECK(sparseProfile.lines[0].line == 1);
+    CHECK(sparseProfile.lines[0].executions == 1);
+    CHECK(sparseProfile.lines[1].line == 3);
+    CHECK(sparseProfile.lines[1].executions == 2);
+    CHECK(sparseProfile.lines[1].instructions == 2);
+    CHECK(sparseProfile.lines[1].maxExecutions == 1);
+  };
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
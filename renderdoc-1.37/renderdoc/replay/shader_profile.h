@@ -0,0 +1,78 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#pragma once
+
+#include <map>
+#include "api/replay/renderdoc_replay.h"
+
+// accumulates the states from debugging many invocations of one shader into per-instruction and
+// per-line execution counts. Only running totals are kept, so any number of invocations can be
+// profiled without holding on to their traces.
+class ShaderProfileBuilder
+{
+public:
+  ShaderProfileBuilder(ShaderStage stage) { m_Profile.stage = stage; }
+  // instInfo is used to map executed instructions to lines, and must stay valid until
+  // EndInvocation() is called.
+  void BeginInvocation(const rdcarray<InstructionSourceInfo> &instInfo);
+  // states must be passed in the order ContinueDebug returned them, starting with the first call.
+  void AddStates(const rdcarray<ShaderDebugState> &states);
+  // alternatively, how many times each instruction was executed, indexed by instruction.
+  void AddExecutions(const rdcarray<uint32_t> &executions);
+  void EndInvocation();
+  void AddFailedInvocation() { m_Profile.failedInvocations++; }
+  ShaderDebugProfile Finish();
+
+private:
+  static const int32_t UnknownLine = -2;
+  static const int32_t NoLine = -1;
+
+  struct InstructionCounts
+  {
+    ShaderInstructionProfile profile;
+    // executions in the current invocation
+    uint32_t current = 0;
+    // index into m_Profile.lines, or one of the values above
+    int32_t lineIndex = UnknownLine;
+  };
+
+  void Execute(uint32_t instruction, uint32_t count = 1);
+  int32_t LookupLine(uint32_t instruction);
+
+  ShaderDebugProfile m_Profile;
+
+  rdcarray<InstructionCounts> m_Instructions;
+  rdcarray<uint32_t> m_TouchedInstructions;
+
+  std::map<rdcpair<int32_t, uint32_t>, int32_t> m_LineLookup;
+  // the highest execution count of any instruction on each line in the current invocation
+  rdcarray<uint32_t> m_LineCurrent;
+  rdcarray<int32_t> m_TouchedLines;
+
+  const rdcarray<InstructionSourceInfo> *m_InstInfo = NULL;
+  bool m_Started = false;
+  uint32_t m_NextInstruction = 0;
+};
@@ -0,0 +1,128 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "blockpool.h"
+
+BlockWorkerPool::BlockWorkerPool(uint32_t numThreads, uint64_t srcCapacity, uint64_t dstCapacity,
+                                 ProcessCallback process)
+    : m_Process(process), m_SrcCapacity(srcCapacity), m_DstCapacity(dstCapacity)
+{
+  numThreads = RDCMAX(1U, numThreads);
+
+  // allow two blocks per thread in flight, so that there's always another block queued while the
+  // owner is filling or draining one.
+  m_Blocks.resize(numThreads * 2);
+  for(Slot &s : m_Blocks)
+  {
+    s.block.src = AllocAlignedBuffer(m_SrcCapacity);
+    s.block.dst = AllocAlignedBuffer(m_DstCapacity);
+  }
+}
+
+BlockWorkerPool::~BlockWorkerPool()
+{
+  // any jobs still running reference the blocks, so wait for them before freeing anything
+  for(Slot &s : m_Blocks)
+    WaitForSlot(s);
+
+  for(Slot &s : m_Blocks)
+  {
+    FreeAlignedBuffer(s.block.src);
+    FreeAlignedBuffer(s.block.dst);
+  }
+}
+
+uint32_t BlockWorkerPool::DefaultThreadCount()
+{
+  // leave a core for the thread producing/consuming the stream. Beyond a handful of threads we are
+  // bottlenecked on the disk or on the serialising thread anyway.
+  uint32_t numCores = Threading::NumberOfCores();
+  if(numCores <= 1)
+    return 1;
+  return RDCMIN(numCores - 1, 8U);
+}
+
+BlockWorkerPool::Block &BlockWorkerPool::Acquire()
+{
+  RDCASSERT(!Full());
+
+  Slot &s = m_Blocks[m_Submitted % m_Blocks.size()];
+  RDCASSERT(s.job == NULL);
+
+  s.block.srcSize = 0;
+  s.block.dstSize = 0;
+  s.block.error = RDResult();
+
+  return s.block;
+}
+
+void BlockWorkerPool::Submit()
+{
+  uint32_t idx = m_Submitted % m_Blocks.size();
+  m_Submitted++;
+
+  Slot &s = m_Blocks[idx];
+
+  if(!Threading::JobSystem::IsAvailable())
+  {
+    s.block.error = m_Process(idx, s.block);
+    return;
+  }
+
+  s.job = Threading::JobSystem::AddOwnedJob(
+      [this, idx]() { m_Blocks[idx].block.error = m_Process(idx, m_Blocks[idx].block); });
+}
+
+void BlockWorkerPool::WaitForSlot(Slot &s)
+{
+  if(s.job)
+  {
+    Threading::JobSystem::WaitForJob(s.job);
+    Threading::JobSystem::DeleteJob(s.job);
+    s.job = NULL;
+  }
+}
+
+BlockWorkerPool::Block *BlockWorkerPool::Oldest()
+{
+  if(InFlight() == 0)
+    return NULL;
+
+  Slot &s = m_Blocks[m_Retired % m_Blocks.size()];
+
+  WaitForSlot(s);
+
+  return &s.block;
+}
+
+void BlockWorkerPool::Retire()
+{
+  RDCASSERT(InFlight() > 0);
+
+  Slot &s = m_Blocks[m_Retired % m_Blocks.size()];
+  m_Retired++;
+
+  // the block must have been waited on with Oldest()
+  RDCASSERT(s.job == NULL);
+}
@@ -0,0 +1,109 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include "common/common.h"
+#include "common/threading.h"
+
+// Processes independent blocks (e.g. compression frames) out of order as jobs on the job system,
+// while the owner submits and retires them strictly in order. This lets a compressor or
+// decompressor keep a sequential stream interface while the expensive work happens in parallel.
+//
+// The owner is a single thread and is the only one to call the public interface. Blocks cycle
+// through a fixed ring:
+//
+//   Acquire() -> fill src -> Submit() -> [job processes src into dst] -> Oldest() -> Retire()
+//
+// The job system is initialised during replay, and by RDCFile while it writes a frame capture.
+// Jobs can only be added on its main thread or from within a job. If a block is submitted anywhere
+// else it's processed immediately instead.
+class BlockWorkerPool
+{
+public:
+  struct Block
+  {
+    // input data, filled by the owner before submission
+    byte *src = NULL;
+    uint64_t srcSize = 0;
+
+    // output data, filled by the job. dstSize is the size of the output after processing
+    byte *dst = NULL;
+    uint64_t dstSize = 0;
+
+    // any error encountered while processing
+    RDResult error;
+  };
+
+  // the callback to process a block. slotIndex is in [0, NumSlots()) and can be used to look up any
+  // per-block context, since no two blocks in the same slot are processed at once
+  typedef std::function<RDResult(uint32_t slotIndex, Block &block)> ProcessCallback;
+
+  // numThreads is how many blocks we expect to be processed at once. Twice as many can be in flight
+  BlockWorkerPool(uint32_t numThreads, uint64_t srcCapacity, uint64_t dstCapacity,
+                  ProcessCallback process);
+  ~BlockWorkerPool();
+
+  // the default number of threads to use for parallel compression, based on the number of cores
+  static uint32_t DefaultThreadCount();
+
+  uint32_t NumSlots() const { return (uint32_t)m_Blocks.size(); }
+  uint64_t SourceCapacity() const { return m_SrcCapacity; }
+  uint64_t DestCapacity() const { return m_DstCapacity; }
+  // the number of blocks submitted but not yet retired
+  uint32_t InFlight() const { return m_Submitted - m_Retired; }
+  bool Full() const { return InFlight() == (uint32_t)m_Blocks.size(); }
+
+  // returns the next block to be submitted, with srcSize reset to 0. Only valid if !Full()
+  Block &Acquire();
+  // submit the block last returned by Acquire() for processing
+  void Submit();
+
+  // wait for the oldest submitted block to finish processing and return it. Returns NULL if there
+  // are no blocks in flight.
+  Block *Oldest();
+  // retire the oldest block, returning it to be acquired again
+  void Retire();
+
+private:
+  struct Slot
+  {
+    Block block;
+    // the job processing this block, if it was submitted as one and hasn't been waited on yet
+    Threading::JobSystem::Job *job = NULL;
+  };
+
+  void WaitForSlot(Slot &s);
+
+  ProcessCallback m_Process;
+  uint64_t m_SrcCapacity;
+  uint64_t m_DstCapacity;
+
+  // index modulo the ring size gives the slot
+  uint32_t m_Submitted = 0;
+  uint32_t m_Retired = 0;
+
+  rdcarray<Slot> m_Blocks;
+};
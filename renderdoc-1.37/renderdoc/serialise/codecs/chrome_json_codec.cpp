@@ -26,8 +26,96 @@
 #include "api/replay/structured_data.h"
 #include "common/common.h"
 #include "common/formatting.h"
+#include "common/threading.h"
 #include "serialise/rdcfile.h"
 
+// writes trace events out to the file as they're added, with only a small amount buffered at once.
+// Events are passed as complete JSON objects and this handles the surrounding document and the
+// commas between them.
+class ChromeTraceWriter
+{
+public:
+  ChromeTraceWriter(FILE *f) : m_File(f)
+  {
+    // add header, customise this as needed.
+    m_Buffer = R"({
+  "displayTimeUnit": "ns",
+  "traceEvents": [)";
+  }
+
+  void Event(const rdcstr &json)
+  {
+    // stupid JSON not allowing trailing ,s :(
+    if(!m_First)
+      m_Buffer += ",";
+    m_First = false;
+
+    m_Buffer += "\n    ";
+    m_Buffer += json;
+
+    if(m_Buffer.size() > 64 * 1024)
+      Flush();
+  }
+
+  RDResult Finish()
+  {
+    // end trace events
+    m_Buffer += "\n  ]\n}";
+    Flush();
+
+    if(m_Error)
+      RETURN_ERROR_RESULT(ResultCode::FileIOFailed, "Failed to write trace: %s",
+                          FileIO::ErrorString().c_str());
+
+    return ResultCode::Succeeded;
+  }
+
+private:
+  void Flush()
+  {
+    if(!m_Buffer.empty() && FileIO::fwrite(m_Buffer.data(), 1, m_Buffer.size(), m_File) !=
+                                m_Buffer.size())
+      m_Error = true;
+    m_Buffer.clear();
+  }
+
+  FILE *m_File;
+  rdcstr m_Buffer;
+  bool m_First = true;
+  bool m_Error = false;
+};
+
+static rdcstr EscapeJSON(const rdcstr &str)
+{
+  rdcstr ret;
+  ret.reserve(str.size());
+  for(char c : str)
+  {
+    if(c == '"' || c == '\\')
+      ret.push_back('\\');
+
+    if((byte)c < 32)
+      ret += StringFormat::Fmt("\\u%04x", (uint32_t)c);
+    else
+      ret.push_back(c);
+  }
+  return ret;
+}
+
+// the trace is split into processes so that the different kinds of track are grouped together.
+// Thread IDs within each are the capturing application's threads.
+enum ChromeTracePID
+{
+  // each chunk, as long as the real API call took. This is the time spent in the driver.
+  APICallsPID = 5,
+  // the time on each thread from the end of one API call to the start of the next. This is an
+  // upper bound on the capture overhead, as it also includes any time the application spent
+  // between calls.
+  OverheadPID = 6,
+  // counters over the course of the capture
+  CountersPID = 7,
+};
+
 RDResult exportChrome(const rdcstr &filename, const RDCFile &rdc, const SDFile &structData,
                       RENDERDOC_ProgressCallback progress)
 {
@@ -37,45 +125,107 @@ RDResult exportChrome(const rdcstr &filename, const RDCFile &rdc, const SDFile &
     RETURN_ERROR_RESULT(ResultCode::FileIOFailed, "Failed to open '%s' for write: %s",
                         filename.c_str(), FileIO::ErrorString().c_str());
 
-  rdcstr str;
+  ChromeTraceWriter trace(f);
 
-  // add header, customise this as needed.
-  str = R"({
-  "displayTimeUnit": "ns",
-  "traceEvents": [)";
+  trace.Event(StringFormat::Fmt(
+      R"({ "name": "process_name", "ph": "M", "pid": %d, "args": { "name": "API calls" } })",
+      APICallsPID));
+  trace.Event(StringFormat::Fmt(
+      R"({ "name": "process_name", "ph": "M", "pid": %d,)"
+      R"( "args": { "name": "Between API calls" } })",
+      OverheadPID));
+  trace.Event(StringFormat::Fmt(
+      R"({ "name": "process_name", "ph": "M", "pid": %d, "args": { "name": "Counters" } })",
+      CountersPID));
 
   const char *category = "Initialisation";
 
-  // stupid JSON not allowing trailing ,s :(
-  bool first = true;
+  // the last timed chunk on each thread, to find the gap until that thread's next API call. There
+  // are only ever a handful of threads so a linear search is fine.
+  rdcarray<rdcpair<uint64_t, const SDChunk *>> lastChunk;
+
+  uint64_t totalBytes = 0;
 
   int i = 0;
   int numChunks = structData.chunks.count();
 
   for(const SDChunk *chunk : structData.chunks)
   {
-    if(chunk->metadata.chunkID == (uint32_t)SystemChunk::FirstDriverChunk + 1)
+    const SDChunkMetaData &meta = chunk->metadata;
+
+    if(meta.chunkID == (uint32_t)SystemChunk::FirstDriverChunk + 1)
       category = "Frame Capture";
 
-    if(!first)
-      str += ",";
+    const rdcstr name = EscapeJSON(chunk->name);
+
+    if(meta.durationMicro <= 0)
+    {
+      trace.Event(StringFormat::Fmt(
+          R"({ "name": "%s", "cat": "%s", "ph": "i", "s": "t", "ts": %llu, "pid": %d, "tid": %llu,)"
+          R"( "args": { "chunk": %d, "bytes": %llu } })",
+          name.c_str(), category, meta.timestampMicro, APICallsPID, meta.threadID, i, meta.length));
+    }
+    else
+    {
+      trace.Event(StringFormat::Fmt(
+          R"({ "name": "%s", "cat": "%s", "ph": "X", "ts": %llu, "dur": %lld, "pid": %d,)"
+          R"( "tid": %llu, "args": { "chunk": %d, "bytes": %llu } })",
+          name.c_str(), category, meta.timestampMicro, meta.durationMicro, APICallsPID,
+          meta.threadID, i, meta.length));
+    }
+
+    // chunks without a timestamp (e.g. initial contents) can't be placed relative to others
+    if(meta.timestampMicro != 0)
+    {
+      const SDChunk **prev = NULL;
+      for(rdcpair<uint64_t, const SDChunk *> &last : lastChunk)
+      {
+        if(last.first == meta.threadID)
+        {
+          prev = &last.second;
+          break;
+        }
+      }
+
+      if(prev)
+      {
+        const SDChunkMetaData &prevMeta = (*prev)->metadata;
+        const uint64_t prevEnd =
+            prevMeta.timestampMicro + RDCMAX(prevMeta.durationMicro, (int64_t)0);
+
+        if(meta.timestampMicro > prevEnd)
+        {
+          trace.Event(StringFormat::Fmt(
+              R"({ "name": "After %s", "cat": "Overhead", "ph": "X", "ts": %llu, "dur": %llu,)"
+              R"( "pid": %d, "tid": %llu, "args": { "bytes": %llu } })",
+              EscapeJSON((*prev)->name).c_str(), prevEnd, meta.timestampMicro - prevEnd,
+              OverheadPID, meta.threadID, prevMeta.length));
+        }
 
-    first = false;
+        *prev = chunk;
+      }
+      else
+      {
+        lastChunk.push_back({meta.threadID, chunk});
+      }
 
-    const char *fmt = R"(
-    { "name": "%s", "cat": "%s", "ph": "B", "ts": %llu, "pid": 5, "tid": %u },
-    { "ph": "E", "ts": %llu, "pid": 5, "tid": %u })";
+      totalBytes += meta.length;
 
-    if(chunk->metadata.durationMicro == 0)
+      // each chunk is one allocation out of the chunk allocator during capture
+      trace.Event(StringFormat::Fmt(
+          R"({ "name": "Bytes serialised", "ph": "C", "ts": %llu, "pid": %d,)"
+          R"( "args": { "bytes": %llu } })",
+          meta.timestampMicro, CountersPID, totalBytes));
+      trace.Event(StringFormat::Fmt(
+          R"({ "name": "Chunks allocated", "ph": "C", "ts": %llu, "pid": %d,)"
+          R"( "args": { "chunks": %d } })",
+          meta.timestampMicro, CountersPID, i + 1));
+    }
+    else
     {
-      fmt = R"(
-    { "name": "%s", "cat": "%s", "ph": "i", "ts": %llu, "pid": 5, "tid": %u })";
+      totalBytes += meta.length;
     }
 
-    str += StringFormat::Fmt(
-        fmt, chunk->name.c_str(), category, chunk->metadata.timestampMicro, chunk->metadata.threadID,
-        chunk->metadata.timestampMicro + chunk->metadata.durationMicro, chunk->metadata.threadID);
-
     if(progress)
       progress(float(i) / float(numChunks));
 
@@ -85,14 +235,11 @@ RDResult exportChrome(const rdcstr &filename, const RDCFile &rdc, const SDFile &
   if(progress)
     progress(1.0f);
 
-  // end trace events
-  str += "\n  ]\n}";
-
-  FileIO::fwrite(str.data(), 1, str.size(), f);
+  RDResult res = trace.Finish();
 
   FileIO::fclose(f);
 
-  return ResultCode::Succeeded;
+  return res;
 }
 
 static ConversionRegistration XMLConversionRegistration(
@@ -101,6 +248,386 @@ static ConversionRegistration XMLConversionRegistration(
         "chrome.json",
         "Chrome profiler JSON",
         R"(Exports the chunk threadID, timestamp and duration data to a JSON format that can be loaded
-by chrome's profiler at chrome://tracing)",
+by chrome's profiler at chrome://tracing or Perfetto. API calls are shown per-thread with the time
+spent in the driver, along with the time between calls on each thread and counters of the bytes
+and chunks serialised.)",
         false,
     });
+
+RDResult Threading::JobSystem::ExportTraceChrome(const rdcstr &filename,
+                                                 const rdcarray<TraceEvent> &events)
+{
+  FILE *f = FileIO::fopen(filename, FileIO::WriteText);
+
+  if(!f)
+    RETURN_ERROR_RESULT(ResultCode::FileIOFailed, "Failed to open '%s' for write: %s",
+                        filename.c_str(), FileIO::ErrorString().c_str());
+
+  uint32_t numWorkers = 0;
+  for(const TraceEvent &ev : events)
+    if(ev.thread != TraceEvent::MainThread)
+      numWorkers = RDCMAX(numWorkers, ev.thread + 1);
+
+  ChromeTraceWriter trace(f);
+
+  // name the threads first. The main thread is tid 0 and workers follow
+  for(uint32_t t = 0; t <= numWorkers; t++)
+  {
+    rdcstr name = t == 0 ? rdcstr("Main") : StringFormat::Fmt("Worker %u", t - 1);
+
+    trace.Event(StringFormat::Fmt(
+        R"({ "name": "thread_name", "ph": "M", "pid": 1, "tid": %u, "args": { "name": "%s" } })",
+        t, name.c_str()));
+  }
+
+  for(const TraceEvent &ev : events)
+  {
+    const uint32_t tid = ev.thread == TraceEvent::MainThread ? 0 : ev.thread + 1;
+
+    if(ev.type == TraceEvent::Job)
+    {
+      trace.Event(StringFormat::Fmt(
+          R"({ "name": "Job %llu", "cat": "Job", "ph": "X", "ts": %.3f, "dur": %.3f, "pid": 1,)"
+          R"( "tid": %u, "args": { "parents": %u, "parent_wait_us": %.3f,)"
+          R"( "queue_delay_us": %.3f } })",
+          ev.id, ev.start, ev.end - ev.start, tid, ev.numParents, ev.ready - ev.added,
+          ev.start - ev.ready));
+    }
+    else
+    {
+      const char *name = ev.type == TraceEvent::Idle ? "Idle" : "Wait";
+
+      trace.Event(StringFormat::Fmt(
+          R"({ "name": "%s", "cat": "%s", "ph": "X", "ts": %.3f, "dur": %.3f, "pid": 1,)"
+          R"( "tid": %u })",
+          name, name, ev.start, ev.end - ev.start, tid));
+    }
+  }
+
+  RDResult res = trace.Finish();
+
+  FileIO::fclose(f);
+
+  return res;
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Export chunk timings as a chrome trace", "[chrome]")
+{
+  SDFile structData;
+
+  struct
+  {
+    const char *name;
+    uint64_t thread;
+    uint64_t timestamp;
+    int64_t duration;
+    uint64_t length;
+  } chunks[] = {
+      {"vkCreateBuffer", 10, 100, 20, 64},
+      {"vkCmdDraw", 20, 110, 5, 32},
+      {"vkCmdDispatch", 10, 150, 10, 48},
+      {"Marker \"quoted\"", 20, 115, 0, 16},
+  };
+
+  for(size_t i = 0; i < ARRAY_COUNT(chunks); i++)
+  {
+    SDChunk *chunk = new SDChunk(rdcstr(chunks[i].name));
+    chunk->metadata.threadID = chunks[i].thread;
+    chunk->metadata.timestampMicro = chunks[i].timestamp;
+    chunk->metadata.durationMicro = chunks[i].duration;
+    chunk->metadata.length = chunks[i].length;
+    structData.chunks.push_back(chunk);
+  }
+
+  RDCFile rdc;
+
+  rdcstr filename = FileIO::GetTempFolderFilename() + "/chunktrace.json";
+  REQUIRE(exportChrome(filename, rdc, structData, NULL).code == ResultCode::Succeeded);
+
+  rdcstr json;
+  FileIO::ReadAll(filename, json);
+  FileIO::Delete(filename);
+
+  CHECK(json.beginsWith("{"));
+  CHECK(json.endsWith("}"));
+
+  // the draw took 5us
+  CHECK(json.contains(
+      R"("name": "vkCmdDraw", "cat": "Initialisation", "ph": "X", "ts": 110, "dur": 5, "pid": 5,)"
+      R"( "tid": 20)"));
+
+  // the gap between the end of vkCreateBuffer and the start of vkCmdDispatch on the same thread
+  CHECK(json.contains(
+      R"("name": "After vkCreateBuffer", "cat": "Overhead", "ph": "X", "ts": 120, "dur": 30,)"));
+
+  // the marker is an instant, and started as soon as the draw ended on its thread
+  CHECK(json.contains(R"("name": "Marker \"quoted\"", "cat": "Initialisation", "ph": "i")"));
+  CHECK_FALSE(json.contains(R"("name": "After vkCmdDraw")"));
+
+  // counters accumulate in chunk order
+  CHECK(json.contains(R"("args": { "bytes": 160 })"));
+  CHECK(json.contains(R"("args": { "chunks": 4 })"));
+
+  // no trailing commas before the end of the events
+  CHECK_FALSE(json.contains(",\n  ]"));
+}
+
+// a strict JSON parser that records each string member by its key, so the test doesn't depend on
+// how the output is formatted
+struct JSONChecker
+{
+  JSONChecker(const rdcstr &json) : cur(json.c_str()), end(json.c_str() + json.size()) {}
+
+  bool Document()
+  {
+    Whitespace();
+    if(!Value(rdcstr()))
+      return false;
+    Whitespace();
+    return cur == end;
+  }
+
+  // the string values of every member, in document order
+  rdcarray<rdcpair<rdcstr, rdcstr>> strings;
+  int objects = 0;
+
+private:
+  void Whitespace()
+  {
+    while(cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\n' || *cur == '\r'))
+      cur++;
+  }
+
+  bool Expect(char c)
+  {
+    Whitespace();
+    if(cur >= end || *cur != c)
+      return false;
+    cur++;
+    return true;
+  }
+
+  bool String(rdcstr &out)
+  {
+    if(!Expect('"'))
+      return false;
+
+    while(cur < end && *cur != '"')
+    {
+      char c = *(cur++);
+
+      // control characters must be escaped
+      if((byte)c < 32)
+        return false;
+
+      if(c != '\\')
+      {
+        out.push_back(c);
+        continue;
+      }
+
+      if(cur >= end)
+        return false;
+
+      c = *(cur++);
+      switch(c)
+      {
+        case '"':
+        case '\\':
+        case '/': out.push_back(c); break;
+        case 'b': out.push_back('\b'); break;
+        case 'f': out.push_back('\f'); break;
+        case 'n': out.push_back('\n'); break;
+        case 'r': out.push_back('\r'); break;
+        case 't': out.push_back('\t'); break;
+        case 'u':
+        {
+          if(end - cur < 4)
+            return false;
+          uint32_t code = 0;
+          for(int i = 0; i < 4; i++)
+          {
+            char h = *(cur++);
+            code <<= 4;
+            if(h >= '0' && h <= '9')
+              code |= h - '0';
+            else if(h >= 'a' && h <= 'f')
+              code |= h - 'a' + 10;
+            else if(h >= 'A' && h <= 'F')
+              code |= h - 'A' + 10;
+            else
+              return false;
+          }
+          // only ASCII is escaped by the exporter
+          if(code >= 0x80)
+            return false;
+          out.push_back(char(code));
+          break;
+        }
+        default: return false;
+      }
+    }
+
+    return Expect('"');
+  }
+
+  bool Number()
+  {
+    const char *start = cur;
+    if(cur < end && *cur == '-')
+      cur++;
+    const char *digits = cur;
+    while(cur < end && *cur >= '0' && *cur <= '9')
+      cur++;
+    if(cur == digits)
+      return false;
+    if(cur < end && *cur == '.')
+    {
+      cur++;
+      digits = cur;
+      while(cur < end && *cur >= '0' && *cur <= '9')
+        cur++;
+      if(cur == digits)
+        return false;
+    }
+    return cur > start;
+  }
+
+  bool Value(const rdcstr &key)
+  {
+    Whitespace();
+    if(cur >= end)
+      return false;
+
+    if(*cur == '{')
+    {
+      cur++;
+      objects++;
+      Whitespace();
+      if(cur < end && *cur == '}')
+      {
+        cur++;
+        return true;
+      }
+      do
+      {
+        rdcstr member;
+        if(!String(member) || !Expect(':') || !Value(member))
+          return false;
+      } while(Expect(','));
+      return Expect('}');
+    }
+    else if(*cur == '[')
+    {
+      cur++;
+      Whitespace();
+      if(cur < end && *cur == ']')
+      {
+        cur++;
+        return true;
+      }
+      do
+      {
+        if(!Value(key))
+          return false;
+      } while(Expect(','));
+      return Expect(']');
+    }
+    else if(*cur == '"')
+    {
+      rdcstr str;
+      if(!String(str))
+        return false;
+      strings.push_back({key, str});
+      return true;
+    }
+
+    return Number();
+  }
+
+  const char *cur;
+  const char *end;
+};
+
+TEST_CASE("Chrome trace export is valid JSON", "[chrome]")
+{
+  SDFile structData;
+
+  // names that need escaping, including control characters
+  const rdcstr names[] = {
+      "Marker \"quoted\"",
+      "C:\\path\\to\\file",
+      "line\nbreak\ttab\x01",
+  };
+
+  for(size_t i = 0; i < ARRAY_COUNT(names); i++)
+  {
+    SDChunk *chunk = new SDChunk(names[i]);
+    chunk->metadata.threadID = 1;
+    chunk->metadata.timestampMicro = 100 + i * 50;
+    chunk->metadata.durationMicro = 10;
+    chunk->metadata.length = 8;
+    structData.chunks.push_back(chunk);
+  }
+
+  // a chunk with no timing, only listed as an instant
+  structData.chunks.push_back(new SDChunk(rdcstr("Initial contents")));
+
+  RDCFile rdc;
+
+  rdcstr filename = FileIO::GetTempFolderFilename() + "/chunktrace_escaping.json";
+  REQUIRE(exportChrome(filename, rdc, structData, NULL).code == ResultCode::Succeeded);
+
+  rdcstr json;
+  FileIO::ReadAll(filename, json);
+  FileIO::Delete(filename);
+
+  JSONChecker checker(json);
+  REQUIRE(checker.Document());
+
+  rdcarray<rdcstr> eventNames;
+  int numEvents = 0;
+  for(const rdcpair<rdcstr, rdcstr> &str : checker.strings)
+  {
+    if(str.first == "name")
+      eventNames.push_back(str.second);
+    else if(str.first == "ph")
+      numEvents++;
+  }
+
+  // every name survives escaping, both as the call and as the gap after it on the same thread
+  for(size_t i = 0; i < ARRAY_COUNT(names); i++)
+  {
+    INFO("Chunk " << i);
+    CHECK(eventNames.contains(names[i]));
+    if(i + 1 < ARRAY_COUNT(names))
+      CHECK(eventNames.contains("After " + names[i]));
+  }
+
+  CHECK(eventNames.contains("Initial contents"));
+
+  // three process names, one event per chunk, two gaps, and two counters per timed chunk. Each
+  // event has an args object, inside the document's object
+  CHECK(numEvents == 3 + 4 + 2 + 3 * 2);
+  CHECK(checker.objects == 1 + numEvents * 2);
+
+  SECTION("Empty capture")
+  {
+    SDFile empty;
+    REQUIRE(exportChrome(filename, rdc, empty, NULL).code == ResultCode::Succeeded);
+
+    rdcstr emptyJson;
+    FileIO::ReadAll(filename, emptyJson);
+    FileIO::Delete(filename);
+
+    JSONChecker emptyChecker(emptyJson);
+    CHECK(emptyChecker.Document());
+    CHECK(emptyChecker.objects == 1 + 3 * 2);
+  };
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include <type_traits>
 #include <utility>
 #include "api/replay/structured_data.h"
 #include "common/common.h"
@@ -30,7 +31,6 @@
 #include "strings/string_utils.h"
 
 #include "miniz/miniz.h"
-#include "pugixml/pugixml.hpp"
 
 struct ThumbTypeAndData
 {
@@ -90,18 +90,6 @@ inline float StructuredProgress(float progress)
   return 0.2f + 0.8f * progress;
 }
 
-struct xml_file_writer : pugi::xml_writer
-{
-  StreamWriter stream;
-
-  xml_file_writer(const rdcstr &filename)
-      : stream(FileIO::fopen(filename, FileIO::WriteBinary), Ownership::Stream)
-  {
-  }
-
-  void write(const void *data, size_t size) { stream.Write(data, size); }
-};
-
 // avoid &, <, and > since they throw off the ascii alignment
 static constexpr bool IsXMLPrintable(const char c)
 {
@@ -221,144 +209,794 @@ static void HexDecode(const char *str, const char *end, bytebuf &out)
   }
 }
 
-static bool Obj2XML(pugi::xml_node &parent, SDObject &child)
+// writes XML straight to a stream as elements are started and ended, formatted the same as
+// pugixml's default output. Only the stack of open elements is kept, so a document of any size can
+// be written without building it in memory first.
+class XMLStreamWriter
+{
+public:
+  XMLStreamWriter(StreamWriter &stream) : m_Stream(stream)
+  {
+    m_Buffer = "<?xml version=\"1.0\"?>\n";
+  }
+  ~XMLStreamWriter() { Flush(); }
+
+  // element names must outlive the element, they're expected to be literals
+  void StartElement(const char *name)
+  {
+    if(!m_Open.empty())
+    {
+      OpenElement &parent = m_Open.back();
+      if(parent.startTagOpen)
+        m_Buffer += ">\n";
+      parent.startTagOpen = false;
+      parent.hasChildren = true;
+    }
+
+    Indent();
+    m_Buffer += '<';
+    m_Buffer += name;
+
+    m_Open.push_back({name});
+  }
+
+  void Attribute(const char *name, const char *value)
+  {
+    m_Buffer += ' ';
+    m_Buffer += name;
+    m_Buffer += "=\"";
+    Escape(value, true);
+    m_Buffer += '"';
+  }
+
+  void Attribute(const char *name, const rdcstr &value) { Attribute(name, value.c_str()); }
+  void Attribute(const char *name, const rdcinflexiblestr &value)
+  {
+    Attribute(name, value.c_str());
+  }
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  void Attribute(const char *name, T value)
+  {
+    Attribute(name, FormatValue(value));
+  }
+
+  void Text(const char *text)
+  {
+    OpenElement &el = m_Open.back();
+    if(el.startTagOpen)
+      m_Buffer += '>';
+    el.startTagOpen = false;
+    el.hasText = true;
+
+    Escape(text, false);
+  }
+
+  void Text(const rdcstr &text) { Text(text.c_str()); }
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  void Text(T value)
+  {
+    Text(FormatValue(value));
+  }
+
+  void EndElement()
+  {
+    OpenElement el = m_Open.back();
+    m_Open.pop_back();
+
+    if(el.startTagOpen)
+    {
+      m_Buffer += " />\n";
+    }
+    else
+    {
+      if(el.hasChildren)
+        Indent();
+      m_Buffer += "</";
+      m_Buffer += el.name;
+      m_Buffer += ">\n";
+    }
+
+    if(m_Buffer.size() > 64 * 1024)
+      Flush();
+  }
+
+  void Flush()
+  {
+    m_Stream.Write(m_Buffer.data(), m_Buffer.size());
+    m_Buffer.clear();
+  }
+
+private:
+  struct OpenElement
+  {
+    const char *name;
+    bool startTagOpen = true;
+    bool hasChildren = false;
+    bool hasText = false;
+  };
+
+  void Indent()
+  {
+    for(size_t i = 0; i < m_Open.size(); i++)
+      m_Buffer += '\t';
+  }
+
+  template <typename T>
+  static rdcstr FormatValue(T value)
+  {
+    if(std::is_same<T, bool>::value)
+      return value ? "true" : "false";
+    else if(std::is_floating_point<T>::value)
+      return StringFormat::Fmt("%.17g", (double)value);
+    else if(std::is_signed<T>::value)
+      return StringFormat::Fmt("%lld", (long long)value);
+    else
+      return StringFormat::Fmt("%llu", (unsigned long long)value);
+  }
+
+  void Escape(const char *str, bool attribute)
+  {
+    for(; *str; str++)
+    {
+      const char c = *str;
+      switch(c)
+      {
+        case '&': m_Buffer += "&amp;"; break;
+        case '<': m_Buffer += "&lt;"; break;
+        case '>': m_Buffer += "&gt;"; break;
+        case '"':
+          if(attribute)
+            m_Buffer += "&quot;";
+          else
+            m_Buffer += c;
+          break;
+        default:
+          // control characters are written as character references, except whitespace that will
+          // survive parsing - only tabs in attributes, since other whitespace is normalised there
+          if((byte)c < 32 && c != '\t' && (attribute || (c != '\n' && c != '\r')))
+            m_Buffer += StringFormat::Fmt("&#%u;", (uint32_t)(byte)c);
+          else
+            m_Buffer += c;
+          break;
+      }
+    }
+  }
+
+  StreamWriter &m_Stream;
+  rdcstr m_Buffer;
+  rdcarray<OpenElement> m_Open;
+};
+
+// a pull parser for the XML we write: elements, attributes and text, with any declarations,
+// comments and doctypes skipped. It reads incrementally from the stream and only holds the current
+// token, so a document can be converted chunk by chunk instead of loading it all as a DOM.
+//
+// Text is handled the same as pugixml's default parsing: line endings are normalised, whitespace in
+// attributes becomes spaces and text that is only whitespace is dropped.
+class XMLPullParser
+{
+public:
+  enum class Token
+  {
+    StartElement,
+    EndElement,
+    Text,
+    EndOfDocument,
+    Error,
+  };
+
+  XMLPullParser(StreamReader &reader) : m_Reader(reader) { m_Buffer.resize(64 * 1024); }
+  Token Next()
+  {
+    if(m_SelfClosing)
+    {
+      m_SelfClosing = false;
+      m_Name = m_Stack.back();
+      m_Stack.pop_back();
+      return Token::EndElement;
+    }
+
+    for(;;)
+    {
+      int c = Peek();
+
+      if(c < 0)
+      {
+        if(!m_Stack.empty())
+          return SetError(StringFormat::Fmt("Unexpected end of document inside <%s>",
+                                            m_Stack.back().c_str()));
+        return Token::EndOfDocument;
+      }
+
+      if(c != '<')
+      {
+        m_Text.clear();
+        bool whitespace = true;
+        while(c >= 0 && c != '<')
+        {
+          if(c == '&')
+          {
+            ReadEntity(m_Text);
+            whitespace = false;
+          }
+          else
+          {
+            Get();
+            if(c == '\r')
+            {
+              c = '\n';
+              if(Peek() == '\n')
+                Get();
+            }
+            if(c != ' ' && c != '\t' && c != '\n')
+              whitespace = false;
+            m_Text.push_back((char)c);
+          }
+          c = Peek();
+        }
+
+        if(whitespace)
+          continue;
+
+        return Token::Text;
+      }
+
+      Get();
+      c = Peek();
+
+      if(c == '?')
+      {
+        if(!SkipPast("?>"))
+          return SetError("Unterminated processing instruction");
+        continue;
+      }
+
+      if(c == '!')
+      {
+        Get();
+        if(Match("--"))
+        {
+          if(!SkipPast("-->"))
+            return SetError("Unterminated comment");
+          continue;
+        }
+        else if(Match("[CDATA["))
+        {
+          m_Text.clear();
+          if(!ReadPast("]]>", m_Text))
+            return SetError("Unterminated CDATA section");
+          return Token::Text;
+        }
+        else
+        {
+          // a doctype, which we don't support internal subsets for
+          if(!SkipPast(">"))
+            return SetError("Unterminated declaration");
+          continue;
+        }
+      }
+
+      if(c == '/')
+      {
+        Get();
+        if(!ReadName(m_Name))
+          return SetError("Expected element name in end tag");
+        SkipWhitespace();
+        if(Get() != '>')
+          return SetError(StringFormat::Fmt("Expected > after </%s", m_Name.c_str()));
+        if(m_Stack.empty() || m_Stack.back() != m_Name)
+          return SetError(StringFormat::Fmt("Mismatched end tag </%s>", m_Name.c_str()));
+        m_Stack.pop_back();
+        return Token::EndElement;
+      }
+
+      if(!ReadName(m_Name))
+        return SetError("Expected element name");
+
+      m_Attributes.clear();
+
+      for(;;)
+      {
+        SkipWhitespace();
+        c = Peek();
+
+        if(c == '>')
+        {
+          Get();
+          break;
+        }
+
+        if(c == '/')
+        {
+          Get();
+          if(Get() != '>')
+            return SetError(StringFormat::Fmt("Expected /> in <%s", m_Name.c_str()));
+          m_SelfClosing = true;
+          break;
+        }
+
+        if(c < 0)
+          return SetError(StringFormat::Fmt("Unexpected end of document in <%s", m_Name.c_str()));
+
+        rdcpair<rdcstr, rdcstr> attr;
+        if(!ReadName(attr.first))
+          return SetError(StringFormat::Fmt("Expected attribute name in <%s", m_Name.c_str()));
+
+        SkipWhitespace();
+        if(Get() != '=')
+          return SetError(StringFormat::Fmt("Expected = after attribute %s", attr.first.c_str()));
+        SkipWhitespace();
+
+        const int quote = Get();
+        if(quote != '"' && quote != '\'')
+          return SetError(StringFormat::Fmt("Expected quoted value for attribute %s",
+                                            attr.first.c_str()));
+
+        for(c = Peek(); c >= 0 && c != quote; c = Peek())
+        {
+          if(c == '&')
+          {
+            ReadEntity(attr.second);
+            continue;
+          }
+
+          Get();
+          if(c == '\r' && Peek() == '\n')
+            Get();
+          if(c == '\r' || c == '\n' || c == '\t')
+            c = ' ';
+          attr.second.push_back((char)c);
+        }
+
+        if(Get() != quote)
+          return SetError(StringFormat::Fmt("Unterminated value for attribute %s",
+                                            attr.first.c_str()));
+
+        m_Attributes.push_back(std::move(attr));
+      }
+
+      m_Stack.push_back(m_Name);
+      return Token::StartElement;
+    }
+  }
+
+  // the name of the element for StartElement and EndElement tokens
+  const rdcstr &Name() const { return m_Name; }
+  // the decoded text for Text tokens
+  const rdcstr &Text() const { return m_Text; }
+  // attributes of the last StartElement
+  bool HasAttribute(const char *name) const { return FindAttribute(name) != NULL; }
+  const char *Attribute(const char *name) const
+  {
+    const rdcstr *ret = FindAttribute(name);
+    return ret ? ret->c_str() : "";
+  }
+
+  const rdcstr &GetError() const { return m_Error; }
+  float Progress() const
+  {
+    return m_Reader.GetSize() ? float(m_Reader.GetOffset()) / float(m_Reader.GetSize()) : 1.0f;
+  }
+
+private:
+  const rdcstr *FindAttribute(const char *name) const
+  {
+    for(const rdcpair<rdcstr, rdcstr> &attr : m_Attributes)
+      if(attr.first == name)
+        return &attr.second;
+    return NULL;
+  }
+
+  Token SetError(const rdcstr &error)
+  {
+    m_Error = error;
+    // stop parsing, any further calls will hit the end
+    m_Pos = m_Size = 0;
+    m_EOF = true;
+    m_Stack.clear();
+    return Token::Error;
+  }
+
+  int Peek()
+  {
+    if(m_Pos >= m_Size && !Refill())
+      return -1;
+    return (byte)m_Buffer[m_Pos];
+  }
+
+  int Get()
+  {
+    if(m_Pos >= m_Size && !Refill())
+      return -1;
+    return (byte)m_Buffer[m_Pos++];
+  }
+
+  bool Refill()
+  {
+    if(m_EOF)
+      return false;
+
+    uint64_t remaining = m_Reader.GetSize() - m_Reader.GetOffset();
+    if(remaining == 0 || m_Reader.IsErrored())
+    {
+      m_EOF = true;
+      return false;
+    }
+
+    size_t toRead = (size_t)RDCMIN(remaining, (uint64_t)m_Buffer.size());
+    if(!m_Reader.Read(m_Buffer.data(), toRead))
+    {
+      m_EOF = true;
+      return false;
+    }
+
+    m_Pos = 0;
+    m_Size = toRead;
+    return true;
+  }
+
+  void SkipWhitespace()
+  {
+    for(int c = Peek(); c == ' ' || c == '\t' || c == '\r' || c == '\n'; c = Peek())
+      Get();
+  }
+
+  bool ReadName(rdcstr &name)
+  {
+    name.clear();
+    for(int c = Peek(); c >= 0; c = Peek())
+    {
+      if(c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '/' || c == '>' || c == '=' ||
+         c == '<')
+        break;
+      name.push_back((char)Get());
+    }
+    return !name.empty();
+  }
+
+  // consume str if it's next in the stream. Only used for prefixes that can't partially match
+  // anything else that's valid at that point.
+  bool Match(const char *str)
+  {
+    for(; *str; str++)
+    {
+      if(Peek() != (byte)*str)
+        return false;
+      Get();
+    }
+    return true;
+  }
+
+  bool ReadPast(const char *terminator, rdcstr &out)
+  {
+    const size_t len = strlen(terminator);
+    for(int c = Get(); c >= 0; c = Get())
+    {
+      out.push_back((char)c);
+      if(out.size() >= len && !strcmp(out.c_str() + out.size() - len, terminator))
+      {
+        out.resize(out.size() - len);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool SkipPast(const char *terminator)
+  {
+    // terminators are at most three characters, so only keep that many
+    const size_t len = strlen(terminator);
+    char tail[3] = {};
+    for(int c = Get(); c >= 0; c = Get())
+    {
+      tail[0] = tail[1];
+      tail[1] = tail[2];
+      tail[2] = (char)c;
+      if(!memcmp(tail + 3 - len, terminator, len))
+        return true;
+    }
+    return false;
+  }
+
+  // decode a character or entity reference, leaving unrecognised ones as they are
+  void ReadEntity(rdcstr &out)
+  {
+    rdcstr entity;
+    entity.push_back((char)Get());
+
+    for(int c = Peek(); c >= 0 && entity.size() < 12; c = Peek())
+    {
+      entity.push_back((char)Get());
+      if(c == ';')
+        break;
+    }
+
+    if(entity.back() != ';')
+    {
+      out += entity;
+      return;
+    }
+
+    if(entity == "&amp;")
+      out.push_back('&');
+    else if(entity == "&lt;")
+      out.push_back('<');
+    else if(entity == "&gt;")
+      out.push_back('>');
+    else if(entity == "&quot;")
+      out.push_back('"');
+    else if(entity == "&apos;")
+      out.push_back('\'');
+    else if(entity.size() > 3 && entity[1] == '#')
+    {
+      char *end = NULL;
+      uint32_t codepoint = 0;
+      if(entity[2] == 'x')
+        codepoint = (uint32_t)strtoul(entity.c_str() + 3, &end, 16);
+      else
+        codepoint = (uint32_t)strtoul(entity.c_str() + 2, &end, 10);
+
+      if(end != entity.c_str() + entity.size() - 1 || codepoint > 0x10FFFF)
+      {
+        out += entity;
+      }
+      else if(codepoint < 0x80)
+      {
+        out.push_back((char)codepoint);
+      }
+      else if(codepoint < 0x800)
+      {
+        out.push_back(char(0xC0 | (codepoint >> 6)));
+        out.push_back(char(0x80 | (codepoint & 0x3F)));
+      }
+      else if(codepoint < 0x10000)
+      {
+        out.push_back(char(0xE0 | (codepoint >> 12)));
+        out.push_back(char(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (codepoint & 0x3F)));
+      }
+      else
+      {
+        out.push_back(char(0xF0 | (codepoint >> 18)));
+        out.push_back(char(0x80 | ((codepoint >> 12) & 0x3F)));
+        out.push_back(char(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (codepoint & 0x3F)));
+      }
+    }
+    else
+    {
+      out += entity;
+    }
+  }
+
+  StreamReader &m_Reader;
+  bytebuf m_Buffer;
+  size_t m_Pos = 0, m_Size = 0;
+  bool m_EOF = false;
+  bool m_SelfClosing = false;
+
+  rdcarray<rdcstr> m_Stack;
+  rdcstr m_Name;
+  rdcstr m_Text;
+  rdcarray<rdcpair<rdcstr, rdcstr>> m_Attributes;
+  rdcstr m_Error;
+};
+
+// skip the rest of an element whose StartElement was just returned
+static bool SkipElement(XMLPullParser &xml)
+{
+  uint32_t depth = 1;
+  while(depth > 0)
+  {
+    XMLPullParser::Token t = xml.Next();
+    if(t == XMLPullParser::Token::StartElement)
+      depth++;
+    else if(t == XMLPullParser::Token::EndElement)
+      depth--;
+    else if(t != XMLPullParser::Token::Text)
+      return false;
+  }
+  return true;
+}
+
+// read the text content of an element whose StartElement was just returned, up to its end
+static bool ReadElementText(XMLPullParser &xml, rdcstr &text)
+{
+  text.clear();
+  for(;;)
+  {
+    XMLPullParser::Token t = xml.Next();
+    if(t == XMLPullParser::Token::Text)
+      text += xml.Text();
+    else if(t == XMLPullParser::Token::EndElement)
+      return true;
+    else if(t == XMLPullParser::Token::StartElement)
+    {
+      if(!SkipElement(xml))
+        return false;
+    }
+    else
+      return false;
+  }
+}
+
+// parse numbers the same way pugixml does, allowing leading whitespace and hex with 0x
+static uint64_t ParseXMLUInt(const char *str, uint64_t def = 0)
+{
+  while(*str == ' ' || *str == '\t' || *str == '\r' || *str == '\n')
+    str++;
+  if(*str == 0)
+    return def;
+  if(str[0] == '0' && (str[1] == 'x' || str[1] == 'X'))
+    return strtoull(str + 2, NULL, 16);
+  if(str[0] == '-')
+    return (uint64_t)strtoll(str, NULL, 10);
+  return strtoull(str, NULL, 10);
+}
+
+static int64_t ParseXMLInt(const char *str)
+{
+  while(*str == ' ' || *str == '\t' || *str == '\r' || *str == '\n')
+    str++;
+  if(str[0] == '-')
+    return strtoll(str, NULL, 10);
+  return (int64_t)ParseXMLUInt(str);
+}
+
+static bool ParseXMLBool(const char *str)
+{
+  while(*str == ' ' || *str == '\t' || *str == '\r' || *str == '\n')
+    str++;
+  return *str == '1' || *str == 't' || *str == 'T' || *str == 'y' || *str == 'Y';
+}
+
+static bool Obj2XML(XMLStreamWriter &xml, const SDObject &child, bool arrayElement)
 {
-  pugi::xml_node obj = parent.append_child(typeNames[(uint32_t)child.type.basetype]);
+  if(child.type.basetype == SDBasic::Chunk)
+  {
+    RDCERR("Cannot contain a chunk within a chunk");
+    return false;
+  }
 
-  obj.append_attribute("name") = child.name.c_str();
+  xml.StartElement(typeNames[(uint32_t)child.type.basetype]);
 
-  if(!child.type.name.empty())
-    obj.append_attribute("typename") = child.type.name.c_str();
+  // array elements are named implicitly
+  if(!arrayElement)
+    xml.Attribute("name", child.name);
+
+  // arrays with elements take their type name from them
+  if(!child.type.name.empty() &&
+     !(child.type.basetype == SDBasic::Array && child.NumChildren() > 0))
+    xml.Attribute("typename", child.type.name);
 
   if(child.type.basetype == SDBasic::UnsignedInteger ||
      child.type.basetype == SDBasic::SignedInteger || child.type.basetype == SDBasic::Float ||
      child.type.basetype == SDBasic::Resource || child.type.basetype == SDBasic::Enum)
   {
-    obj.append_attribute("width") = child.type.byteSize;
+    xml.Attribute("width", child.type.byteSize);
   }
 
   if(child.type.flags & SDTypeFlags::Hidden)
-    obj.append_attribute("hidden") = true;
+    xml.Attribute("hidden", true);
 
-  if(child.type.flags & SDTypeFlags::Nullable)
-    obj.append_attribute("nullable") = true;
+  // redundant for null objects
+  if((child.type.flags & SDTypeFlags::Nullable) && child.type.basetype != SDBasic::Null)
+    xml.Attribute("nullable", true);
 
   if(child.type.flags & SDTypeFlags::NullString)
-    obj.append_attribute("nullstring") = true;
+    xml.Attribute("nullstring", true);
 
   if(child.type.flags & SDTypeFlags::FixedArray)
-    obj.append_attribute("fixedarray") = true;
+    xml.Attribute("fixedarray", true);
 
   if(child.type.flags & SDTypeFlags::Union)
-    obj.append_attribute("union") = true;
+    xml.Attribute("union", true);
 
   if(child.type.flags & SDTypeFlags::Important)
-    obj.append_attribute("important") = true;
+    xml.Attribute("important", true);
 
   if(child.type.flags & SDTypeFlags::ImportantChildren)
-    obj.append_attribute("importantchildren") = true;
+    xml.Attribute("importantchildren", true);
 
   if(child.type.flags & SDTypeFlags::HiddenChildren)
-    obj.append_attribute("hiddenchildren") = true;
+    xml.Attribute("hiddenchildren", true);
 
-  if(child.type.basetype == SDBasic::Chunk)
+  if(child.type.basetype == SDBasic::Null)
   {
-    RDCERR("Cannot contain a chunk within a chunk");
-    return false;
-  }
-  else if(child.type.basetype == SDBasic::Null)
-  {
-    // redundant
-    obj.remove_attribute("nullable");
+    // nothing else to write
   }
   else if(child.type.basetype == SDBasic::Struct || child.type.basetype == SDBasic::Array)
   {
-    if(child.type.basetype == SDBasic::Array && child.NumChildren() > 0)
-      obj.remove_attribute("typename");
-
     for(size_t o = 0; o < child.NumChildren(); o++)
     {
-      if(!Obj2XML(obj, *child.GetChild(o)))
+      if(!Obj2XML(xml, *child.GetChild(o), child.type.basetype == SDBasic::Array))
         return false;
-
-      if(child.type.basetype == SDBasic::Array)
-        obj.last_child().remove_attribute("name");
     }
   }
   else if(child.type.basetype == SDBasic::Buffer)
   {
-    obj.append_attribute("byteLength") = child.type.byteSize;
-    obj.text() = child.data.basic.u;
+    xml.Attribute("byteLength", child.type.byteSize);
+    xml.Text(child.data.basic.u);
   }
   else
   {
     if(child.type.flags & SDTypeFlags::HasCustomString)
-    {
-      obj.append_attribute("string") = child.data.str.c_str();
-    }
+      xml.Attribute("string", child.data.str);
 
     switch(child.type.basetype)
     {
       case SDBasic::Resource:
       case SDBasic::Enum:
-      case SDBasic::UnsignedInteger: obj.text() = child.data.basic.u; break;
-      case SDBasic::SignedInteger: obj.text() = child.data.basic.i; break;
-      case SDBasic::String: obj.text() = child.data.str.c_str(); break;
-      case SDBasic::Float: obj.text() = child.data.basic.d; break;
-      case SDBasic::Boolean: obj.text() = child.data.basic.b; break;
+      case SDBasic::UnsignedInteger: xml.Text(child.data.basic.u); break;
+      case SDBasic::SignedInteger: xml.Text(child.data.basic.i); break;
+      case SDBasic::String: xml.Text(child.data.str); break;
+      case SDBasic::Float: xml.Text(child.data.basic.d); break;
+      case SDBasic::Boolean: xml.Text(child.data.basic.b); break;
       case SDBasic::Character:
       {
         char str[2] = {child.data.basic.c, '\0'};
-        obj.text().set(str);
+        xml.Text(str);
         break;
       }
       default: RDCERR("Unexpected case");
     }
   }
 
+  xml.EndElement();
+
   return true;
 }
 
 static RDResult Structured2XML(const rdcstr &filename, const RDCFile &file, uint64_t version,
                                const StructuredChunkList &chunks, RENDERDOC_ProgressCallback progress)
 {
-  pugi::xml_document doc;
+  StreamWriter stream(FileIO::fopen(filename, FileIO::WriteBinary), Ownership::Stream);
 
-  pugi::xml_node xRoot = doc.append_child("rdc");
+  if(stream.IsErrored())
+    return stream.GetError();
 
-  {
-    pugi::xml_node xHeader = xRoot.append_child("header");
+  XMLStreamWriter xml(stream);
 
-    pugi::xml_node xDriver = xHeader.append_child("driver");
-    xDriver.append_attribute("id") = (uint32_t)file.GetDriver();
-    xDriver.text() = file.GetDriverName().c_str();
+  xml.StartElement("rdc");
+
+  {
+    xml.StartElement("header");
 
-    pugi::xml_node xIdent = xHeader.append_child("machineIdent");
+    xml.StartElement("driver");
+    xml.Attribute("id", (uint32_t)file.GetDriver());
+    xml.Text(file.GetDriverName());
+    xml.EndElement();
 
-    xIdent.text().set(file.GetMachineIdent());
+    xml.StartElement("machineIdent");
+    xml.Text(file.GetMachineIdent());
+    xml.EndElement();
 
-    pugi::xml_node xThumbnail = xHeader.append_child("thumbnail");
+    xml.StartElement("thumbnail");
 
     const RDCThumb &th = file.GetThumbnail();
     if(!th.pixels.empty() && th.width > 0 && th.height > 0)
     {
-      xThumbnail.append_attribute("width") = th.width;
-      xThumbnail.append_attribute("height") = th.height;
+      xml.Attribute("width", th.width);
+      xml.Attribute("height", th.height);
 
       if(th.format == FileType::JPG)
-        xThumbnail.text() = "thumb.jpg";
+        xml.Text("thumb.jpg");
       else if(th.format == FileType::PNG)
-        xThumbnail.text() = "thumb.png";
+        xml.Text("thumb.png");
       else if(th.format == FileType::Raw)
-        xThumbnail.text() = "thumb.raw";
+        xml.Text("thumb.raw");
       else
         RDCERR("Unexpected thumbnail format %s", ToStr(th.format).c_str());
     }
 
-    pugi::xml_node xTimebase = xHeader.append_child("timebase");
+    xml.EndElement();
 
-    xTimebase.append_attribute("base") = file.GetTimestampBase();
-    xTimebase.append_attribute("frequency") = file.GetTimestampFrequency();
+    xml.StartElement("timebase");
+    xml.Attribute("base", file.GetTimestampBase());
+    xml.Attribute("frequency", file.GetTimestampFrequency());
+    xml.EndElement();
+
+    xml.EndElement();
   }
 
   if(progress)
@@ -383,20 +1021,22 @@ static RDResult Structured2XML(const rdcstr &filename, const RDCFile &file, uint
         bool succeeded = reader->SkipBytes(thumbHeader.len) && !reader->IsErrored();
         if(succeeded && (uint32_t)thumbHeader.format < (uint32_t)FileType::Count)
         {
-          pugi::xml_node xExtThumbnail = xRoot.append_child("extended_thumbnail");
+          xml.StartElement("extended_thumbnail");
 
-          xExtThumbnail.append_attribute("width") = thumbHeader.width;
-          xExtThumbnail.append_attribute("height") = thumbHeader.height;
-          xExtThumbnail.append_attribute("length") = thumbHeader.len;
+          xml.Attribute("width", thumbHeader.width);
+          xml.Attribute("height", thumbHeader.height);
+          xml.Attribute("length", thumbHeader.len);
 
           if(thumbHeader.format == FileType::JPG)
-            xExtThumbnail.text() = "ext_thumb.jpg";
+            xml.Text("ext_thumb.jpg");
           else if(thumbHeader.format == FileType::PNG)
-            xExtThumbnail.text() = "ext_thumb.png";
+            xml.Text("ext_thumb.png");
           else if(thumbHeader.format == FileType::Raw)
-            xExtThumbnail.text() = "ext_thumb.raw";
+            xml.Text("ext_thumb.raw");
           else
             RDCERR("Unexpected extended thumbnail format %s", ToStr(thumbHeader.format).c_str());
+
+          xml.EndElement();
         }
       }
 
@@ -411,105 +1051,125 @@ static RDResult Structured2XML(const rdcstr &filename, const RDCFile &file, uint
       {
         if(section.type == props.type)
         {
-          pugi::xml_node xFile = xRoot.append_child(section.chunkName.c_str());
-          xFile.text() = section.filename.c_str();
+          xml.StartElement(section.chunkName.c_str());
+          xml.Text(section.filename);
+          xml.EndElement();
 
-          delete reader;
           literalSection = true;
         }
       }
 
       if(literalSection)
+      {
+        delete reader;
         continue;
+      }
     }
 
-    pugi::xml_node xSection = xRoot.append_child("section");
+    xml.StartElement("section");
 
     if(props.flags & SectionFlags::ASCIIStored)
-      xSection.append_attribute("ascii");
+      xml.Attribute("ascii", "");
     if(props.flags & SectionFlags::LZ4Compressed)
-      xSection.append_attribute("lz4");
+      xml.Attribute("lz4", "");
     if(props.flags & SectionFlags::ZstdCompressed)
-      xSection.append_attribute("zstd");
+      xml.Attribute("zstd", "");
 
-    pugi::xml_node name = xSection.append_child("name");
-    name.text() = props.name.c_str();
+    xml.StartElement("name");
+    xml.Text(props.name);
+    xml.EndElement();
 
-    pugi::xml_node secVer = xSection.append_child("version");
-    secVer.text() = props.version;
+    xml.StartElement("version");
+    xml.Text(props.version);
+    xml.EndElement();
 
-    pugi::xml_node type = xSection.append_child("type");
-    type.text() = (uint32_t)props.type;
+    xml.StartElement("type");
+    xml.Text((uint32_t)props.type);
+    xml.EndElement();
 
     bytebuf contents;
     contents.resize((size_t)reader->GetSize());
     reader->Read(contents.data(), reader->GetSize());
 
-    pugi::xml_node data = xSection.append_child("data");
+    xml.StartElement("data");
 
     if(props.flags & SectionFlags::ASCIIStored)
     {
       // insert the contents literally
-      data.text().set((char *)contents.data());
+      const char *str = (const char *)contents.data();
+      xml.Text(rdcstr(str, strnlen(str, contents.size())));
     }
     else
     {
       // encode to simple hex. Not efficient, but easy.
       rdcstr hexdata;
-      hexdata.reserve(contents.size() * 2);
       HexEncode(contents, hexdata);
-      data.text().set(hexdata.c_str());
+      xml.Text(hexdata);
     }
 
+    xml.EndElement();
+
+    xml.EndElement();
+
     delete reader;
   }
 
   if(progress)
     progress(StructuredProgress(0.2f));
 
-  pugi::xml_node xChunks = xRoot.append_child("chunks");
+  xml.StartElement("chunks");
 
-  xChunks.append_attribute("version") = version;
+  xml.Attribute("version", version);
 
   for(size_t c = 0; c < chunks.size(); c++)
   {
-    pugi::xml_node xChunk = xChunks.append_child("chunk");
-    SDChunk *chunk = chunks[c];
+    const SDChunk *chunk = chunks[c];
 
-    xChunk.append_attribute("id") = chunk->metadata.chunkID;
-    xChunk.append_attribute("chunkIndex") = c;
-    xChunk.append_attribute("name") = chunk->name.c_str();
-    xChunk.append_attribute("length") = chunk->metadata.length;
+    xml.StartElement("chunk");
+
+    xml.Attribute("id", chunk->metadata.chunkID);
+    xml.Attribute("chunkIndex", c);
+    xml.Attribute("name", chunk->name);
+    xml.Attribute("length", chunk->metadata.length);
     if(chunk->metadata.threadID)
-      xChunk.append_attribute("threadID") = chunk->metadata.threadID;
+      xml.Attribute("threadID", chunk->metadata.threadID);
     if(chunk->metadata.timestampMicro)
-      xChunk.append_attribute("timestamp") = chunk->metadata.timestampMicro;
+      xml.Attribute("timestamp", chunk->metadata.timestampMicro);
     if(chunk->metadata.durationMicro >= 0)
-      xChunk.append_attribute("duration") = chunk->metadata.durationMicro;
+      xml.Attribute("duration", chunk->metadata.durationMicro);
+
+    const bool opaque = bool(chunk->metadata.flags & SDChunkFlags::OpaqueChunk);
+
+    if(opaque)
+      xml.Attribute("opaque", true);
+
     if(chunk->metadata.flags & SDChunkFlags::HasCallstack)
     {
-      pugi::xml_node stack = xChunk.append_child("callstack");
+      xml.StartElement("callstack");
 
       for(size_t i = 0; i < chunk->metadata.callstack.size(); i++)
       {
-        stack.append_child("address").text() = chunk->metadata.callstack[i];
+        xml.StartElement("address");
+        xml.Text(chunk->metadata.callstack[i]);
+        xml.EndElement();
       }
+
+      xml.EndElement();
     }
 
-    if(chunk->metadata.flags & SDChunkFlags::OpaqueChunk)
+    if(opaque)
     {
-      xChunk.append_attribute("opaque") = true;
-
       RDCASSERT(chunk->NumChildren() > 0);
-      pugi::xml_node opaque = xChunk.append_child("buffer");
-      opaque.append_attribute("byteLength") = chunk->GetChild(0)->type.byteSize;
-      opaque.text() = chunk->GetChild(0)->data.basic.u;
+      xml.StartElement("buffer");
+      xml.Attribute("byteLength", chunk->GetChild(0)->type.byteSize);
+      xml.Text(chunk->GetChild(0)->data.basic.u);
+      xml.EndElement();
     }
     else
     {
       for(size_t o = 0; o < chunk->NumChildren(); o++)
       {
-        if(!Obj2XML(xChunk, *chunk->GetChild(o)))
+        if(!Obj2XML(xml, *chunk->GetChild(o), false))
         {
           RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
                               "Malformed structured data, couldn't encode chunk child %s",
@@ -518,22 +1178,26 @@ static RDResult Structured2XML(const rdcstr &filename, const RDCFile &file, uint
       }
     }
 
+    xml.EndElement();
+
     if(progress)
       progress(StructuredProgress(0.2f + 0.8f * (float(c) / float(chunks.size()))));
   }
 
-  xml_file_writer writer(filename);
-  doc.save(writer);
+  xml.EndElement();
+  xml.EndElement();
+
+  xml.Flush();
 
-  return writer.stream.GetError();
+  return stream.GetError();
 }
 
-static SDObject *XML2Obj(pugi::xml_node &obj)
+// read an object whose StartElement was just returned
+static SDObject *XML2Obj(XMLPullParser &xml)
 {
-  SDObject *ret = new SDObject(rdcstr(obj.attribute("name").as_string()),
-                               rdcstr(obj.attribute("typename").as_string()));
+  SDObject *ret = new SDObject(rdcstr(xml.Attribute("name")), rdcstr(xml.Attribute("typename")));
 
-  rdcstr name = obj.name();
+  const rdcstr &name = xml.Name();
 
   for(size_t i = 0; i < ARRAY_COUNT(typeNames); i++)
   {
@@ -548,35 +1212,30 @@ static SDObject *XML2Obj(pugi::xml_node &obj)
      ret->type.basetype == SDBasic::SignedInteger || ret->type.basetype == SDBasic::Float ||
      ret->type.basetype == SDBasic::Resource || ret->type.basetype == SDBasic::Enum)
   {
-    ret->type.byteSize = obj.attribute("width").as_uint(4);
+    ret->type.byteSize = ParseXMLUInt(xml.Attribute("width"), 4);
   }
 
-  if(obj.attribute("hidden"))
+  if(xml.HasAttribute("hidden"))
     ret->type.flags |= SDTypeFlags::Hidden;
 
-  if(obj.attribute("nullable"))
+  if(xml.HasAttribute("nullable"))
     ret->type.flags |= SDTypeFlags::Nullable;
 
-  if(obj.attribute("fixedarray"))
+  if(xml.HasAttribute("fixedarray"))
     ret->type.flags |= SDTypeFlags::FixedArray;
 
-  if(obj.attribute("union"))
+  if(xml.HasAttribute("union"))
     ret->type.flags |= SDTypeFlags::Union;
 
-  if(obj.attribute("important"))
+  if(xml.HasAttribute("important"))
     ret->type.flags |= SDTypeFlags::Important;
 
-  if(obj.attribute("importantchildren"))
+  if(xml.HasAttribute("importantchildren"))
     ret->type.flags |= SDTypeFlags::ImportantChildren;
 
-  if(obj.attribute("hiddenchildren"))
+  if(xml.HasAttribute("hiddenchildren"))
     ret->type.flags |= SDTypeFlags::HiddenChildren;
 
-  if(obj.attribute("typename"))
-    ret->type.name = obj.attribute("typename").as_string();
-
-  ret->name = obj.attribute("name").as_string();
-
   if(ret->type.basetype == SDBasic::Chunk)
   {
     RDCERR("Cannot contain a chunk within a chunk");
@@ -587,11 +1246,41 @@ static SDObject *XML2Obj(pugi::xml_node &obj)
   {
     ret->type.flags |= SDTypeFlags::Nullable;
   }
-  else if(ret->type.basetype == SDBasic::Struct || ret->type.basetype == SDBasic::Array)
+  else if(ret->type.basetype == SDBasic::Buffer)
   {
-    for(pugi::xml_node child = obj.first_child(); child; child = child.next_sibling())
+    ret->type.byteSize = ParseXMLUInt(xml.Attribute("byteLength"));
+  }
+  else if(ret->type.basetype != SDBasic::Struct && ret->type.basetype != SDBasic::Array)
+  {
+    if(xml.HasAttribute("string"))
     {
-      SDObject *c = XML2Obj(child);
+      ret->type.flags |= SDTypeFlags::HasCustomString;
+      ret->data.str = xml.Attribute("string");
+    }
+
+    if(xml.HasAttribute("nullstring"))
+      ret->type.flags |= SDTypeFlags::NullString;
+  }
+
+  const bool hasChildren =
+      ret->type.basetype == SDBasic::Struct || ret->type.basetype == SDBasic::Array;
+
+  rdcstr text;
+
+  for(;;)
+  {
+    XMLPullParser::Token t = xml.Next();
+
+    if(t == XMLPullParser::Token::EndElement)
+      break;
+
+    if(t == XMLPullParser::Token::Text)
+    {
+      text += xml.Text();
+    }
+    else if(t == XMLPullParser::Token::StartElement && hasChildren)
+    {
+      SDObject *c = XML2Obj(xml);
       if(!c)
       {
         delete ret;
@@ -602,36 +1291,42 @@ static SDObject *XML2Obj(pugi::xml_node &obj)
       if(ret->type.basetype == SDBasic::Array)
         c->name = "$el";
     }
+    else if(t == XMLPullParser::Token::StartElement)
+    {
+      RDCERR("Unexpected <%s> inside <%s>", xml.Name().c_str(),
+             typeNames[(uint32_t)ret->type.basetype]);
+      delete ret;
+      return NULL;
+    }
+    else
+    {
+      RDCERR("Malformed xml: %s", xml.GetError().c_str());
+      delete ret;
+      return NULL;
+    }
+  }
 
+  if(hasChildren)
+  {
     if(ret->type.basetype == SDBasic::Array && ret->NumChildren() > 0)
       ret->type.name = ret->GetChild(0)->type.name;
   }
   else if(ret->type.basetype == SDBasic::Buffer)
   {
-    ret->type.byteSize = obj.attribute("byteLength").as_ullong();
-    ret->data.basic.u = obj.text().as_uint();
+    ret->data.basic.u = (uint32_t)ParseXMLUInt(text.c_str());
   }
-  else
+  else if(ret->type.basetype != SDBasic::Null)
   {
-    if(obj.attribute("string"))
-    {
-      ret->type.flags |= SDTypeFlags::HasCustomString;
-      ret->data.str = obj.attribute("string").as_string();
-    }
-
-    if(obj.attribute("nullstring"))
-      ret->type.flags |= SDTypeFlags::NullString;
-
     switch(ret->type.basetype)
     {
       case SDBasic::Resource:
       case SDBasic::Enum:
-      case SDBasic::UnsignedInteger: ret->data.basic.u = obj.text().as_ullong(); break;
-      case SDBasic::SignedInteger: ret->data.basic.i = obj.text().as_llong(); break;
-      case SDBasic::String: ret->data.str = obj.text().as_string(); break;
-      case SDBasic::Float: ret->data.basic.d = obj.text().as_double(); break;
-      case SDBasic::Boolean: ret->data.basic.b = obj.text().as_bool(); break;
-      case SDBasic::Character: ret->data.basic.c = obj.text().as_string()[0]; break;
+      case SDBasic::UnsignedInteger: ret->data.basic.u = ParseXMLUInt(text.c_str()); break;
+      case SDBasic::SignedInteger: ret->data.basic.i = ParseXMLInt(text.c_str()); break;
+      case SDBasic::String: ret->data.str = text; break;
+      case SDBasic::Float: ret->data.basic.d = strtod(text.c_str(), NULL); break;
+      case SDBasic::Boolean: ret->data.basic.b = ParseXMLBool(text.c_str()); break;
+      case SDBasic::Character: ret->data.basic.c = text.c_str()[0]; break;
       default: RDCERR("Unexpected case");
     }
   }
@@ -639,70 +1334,192 @@ static SDObject *XML2Obj(pugi::xml_node &obj)
   return ret;
 }
 
-static RDResult XML2Structured(const rdcstr &xml, const ThumbTypeAndData &thumb,
+// read a chunk whose StartElement was just returned
+static SDChunk *XML2Chunk(XMLPullParser &xml)
+{
+  SDChunk *chunk = new SDChunk(rdcstr(xml.Attribute("name")));
+
+  chunk->metadata.chunkID = (uint32_t)ParseXMLUInt(xml.Attribute("id"));
+  chunk->metadata.length = ParseXMLUInt(xml.Attribute("length"));
+  if(xml.HasAttribute("threadID"))
+    chunk->metadata.threadID = ParseXMLUInt(xml.Attribute("threadID"));
+  if(xml.HasAttribute("timestamp"))
+    chunk->metadata.timestampMicro = ParseXMLUInt(xml.Attribute("timestamp"));
+  if(xml.HasAttribute("duration"))
+    chunk->metadata.durationMicro = ParseXMLInt(xml.Attribute("duration"));
+
+  const bool opaque = xml.HasAttribute("opaque");
+
+  if(opaque)
+  {
+    chunk->metadata.flags |= SDChunkFlags::OpaqueChunk;
+
+    SDObject *buf = chunk->AddAndOwnChild(new SDObject("Opaque chunk"_lit, "Byte Buffer"_lit));
+    buf->type.basetype = SDBasic::Buffer;
+  }
+
+  for(;;)
+  {
+    XMLPullParser::Token t = xml.Next();
+
+    if(t == XMLPullParser::Token::EndElement)
+      break;
+
+    if(t == XMLPullParser::Token::Text)
+      continue;
+
+    if(t != XMLPullParser::Token::StartElement)
+    {
+      RDCERR("Malformed xml: %s", xml.GetError().c_str());
+      delete chunk;
+      return NULL;
+    }
+
+    if(xml.Name() == "callstack")
+    {
+      chunk->metadata.flags |= SDChunkFlags::HasCallstack;
+
+      for(t = xml.Next(); t != XMLPullParser::Token::EndElement; t = xml.Next())
+      {
+        rdcstr address;
+        if(t == XMLPullParser::Token::Text)
+          continue;
+        if(t != XMLPullParser::Token::StartElement || !ReadElementText(xml, address))
+        {
+          delete chunk;
+          return NULL;
+        }
+        chunk->metadata.callstack.push_back(ParseXMLUInt(address.c_str()));
+      }
+    }
+    else if(opaque)
+    {
+      if(xml.Name() == "buffer")
+      {
+        SDObject *buf = chunk->GetChild(0);
+        buf->type.byteSize = ParseXMLUInt(xml.Attribute("byteLength"));
+
+        rdcstr text;
+        if(!ReadElementText(xml, text))
+        {
+          delete chunk;
+          return NULL;
+        }
+        buf->data.basic.u = ParseXMLUInt(text.c_str());
+      }
+      else if(!SkipElement(xml))
+      {
+        delete chunk;
+        return NULL;
+      }
+    }
+    else
+    {
+      SDObject *obj = XML2Obj(xml);
+      if(!obj)
+      {
+        delete chunk;
+        return NULL;
+      }
+      chunk->AddAndOwnChild(obj);
+    }
+  }
+
+  return chunk;
+}
+
+static RDResult XML2Structured(StreamReader &reader, const ThumbTypeAndData &thumb,
                                const ThumbTypeAndData &extThumb,
                                const std::map<SectionType, bytebuf> &literalFiles,
                                const StructuredBufferList &buffers, RDCFile *rdc, uint64_t &version,
                                StructuredChunkList &chunks, RENDERDOC_ProgressCallback progress)
 {
-  pugi::xml_document doc;
-  doc.load_string(xml.c_str());
+  typedef XMLPullParser::Token Token;
+
+  XMLPullParser xml(reader);
 
-  pugi::xml_node root = doc.child("rdc");
+  // returns the next element start, skipping any text. Anything else is returned as-is
+  auto nextElement = [&xml]() {
+    Token t = xml.Next();
+    while(t == Token::Text)
+      t = xml.Next();
+    return t;
+  };
 
-  if(!root)
+  Token t = nextElement();
+
+  if(t != Token::StartElement || xml.Name() != "rdc")
     RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
                         "Malformed xml document, couldn't get root <rdc> node");
 
-  pugi::xml_node xHeader = root.first_child();
+  t = nextElement();
 
-  if(strcmp(xHeader.name(), "header") != 0)
+  if(t != Token::StartElement || xml.Name() != "header")
     RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
-                        "Malformed xml document, expected <header> node got <%s>", xHeader.name());
+                        "Malformed xml document, expected <header> node got <%s>",
+                        xml.Name().c_str());
 
   // process the header and push meta-data into RDC
   {
-    pugi::xml_node xDriver = xHeader.first_child();
+    RDCDriver driver = RDCDriver::Unknown;
+    rdcstr driverName;
+    uint64_t machineIdent = 0;
+    bool hasDriver = false, hasThumbnail = false;
 
-    if(strcmp(xDriver.name(), "driver") != 0)
-      RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
-                          "Malformed xml document, expected <driver> node got <%s>", xDriver.name());
+    uint16_t thumbWidth = 0, thumbHeight = 0;
 
-    RDCDriver driver = (RDCDriver)xDriver.attribute("id").as_uint();
-    rdcstr driverName = xDriver.text().as_string();
+    // newer XML documents have the timebase here, allow conversion without it
+    uint64_t timeBase = 0;
+    double timeFreq = 1.0;
 
-    pugi::xml_node xIdent = xDriver.next_sibling();
+    for(t = nextElement(); t == Token::StartElement; t = nextElement())
+    {
+      const rdcstr name = xml.Name();
+      rdcstr text;
 
-    uint64_t machineIdent = xIdent.text().as_ullong();
+      if(name == "driver")
+      {
+        driver = (RDCDriver)ParseXMLUInt(xml.Attribute("id"));
+        hasDriver = true;
+      }
+      else if(name == "thumbnail")
+      {
+        thumbWidth = (uint16_t)ParseXMLUInt(xml.Attribute("width"));
+        thumbHeight = (uint16_t)ParseXMLUInt(xml.Attribute("height"));
+        hasThumbnail = true;
+      }
+      else if(name == "timebase")
+      {
+        timeBase = ParseXMLUInt(xml.Attribute("base"));
+        timeFreq = strtod(xml.Attribute("frequency"), NULL);
+      }
 
-    pugi::xml_node xThumbnail = xIdent.next_sibling();
+      if(!ReadElementText(xml, text))
+        RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "Malformed xml document: %s",
+                            xml.GetError().c_str());
 
-    if(strcmp(xThumbnail.name(), "thumbnail") != 0)
-      RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
-                          "Malformed xml document, expected <thumbnail> node got <%s>",
-                          xThumbnail.name());
+      if(name == "driver")
+        driverName = text;
+      else if(name == "machineIdent")
+        machineIdent = ParseXMLUInt(text.c_str());
+    }
 
-    pugi::xml_node xTimebase = xThumbnail.next_sibling();
+    if(t != Token::EndElement)
+      RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "Malformed xml document: %s",
+                          xml.GetError().c_str());
 
-    uint64_t timeBase = 0;
-    double timeFreq = 1.0;
-
-    // newer XML documents have the timebase here, allow conversion without it
-    if(xTimebase)
-    {
-      if(strcmp(xTimebase.name(), "timebase") != 0)
-        RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
-                            "Malformed xml document, expected <timebase> node got <%s>",
-                            xTimebase.name());
+    if(!hasDriver)
+      RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
+                          "Malformed xml document, expected <driver> node in <header>");
 
-      timeBase = xTimebase.attribute("base").as_ullong();
-      timeFreq = xTimebase.attribute("frequency").as_double();
-    }
+    if(!hasThumbnail)
+      RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
+                          "Malformed xml document, expected <thumbnail> node in <header>");
 
     RDCThumb th;
     th.format = thumb.format;
-    th.width = (uint16_t)xThumbnail.attribute("width").as_uint();
-    th.height = (uint16_t)xThumbnail.attribute("height").as_uint();
+    th.width = thumbWidth;
+    th.height = thumbHeight;
 
     RDCThumb *rdcthumb = NULL;
 
@@ -719,12 +1536,9 @@ static RDResult XML2Structured(const rdcstr &xml, const ThumbTypeAndData &thumb,
     progress(StructuredProgress(0.1f));
 
   // push in other sections
-  pugi::xml_node xSection = xHeader.next_sibling();
-
-  while(!strcmp(xSection.name(), "section") || !strcmp(xSection.name(), "extended_thumbnail") ||
-        isLiteralFileChunkName(xSection.name()))
+  for(t = nextElement(); t == Token::StartElement && xml.Name() != "chunks"; t = nextElement())
   {
-    if(!strcmp(xSection.name(), "extended_thumbnail"))
+    if(xml.Name() == "extended_thumbnail")
     {
       SectionProperties props = {};
       props.type = SectionType::ExtendedThumbnail;
@@ -732,8 +1546,8 @@ static RDResult XML2Structured(const rdcstr &xml, const ThumbTypeAndData &thumb,
       StreamWriter *w = rdc->WriteSection(props);
 
       ExtThumbnailHeader header;
-      header.width = (uint16_t)xSection.attribute("width").as_uint();
-      header.height = (uint16_t)xSection.attribute("height").as_uint();
+      header.width = (uint16_t)ParseXMLUInt(xml.Attribute("width"));
+      header.height = (uint16_t)ParseXMLUInt(xml.Attribute("height"));
       header.len = (uint32_t)extThumb.data.size();
       header.format = extThumb.format;
       w->Write(header);
@@ -743,16 +1557,16 @@ static RDResult XML2Structured(const rdcstr &xml, const ThumbTypeAndData &thumb,
 
       delete w;
 
-      xSection = xSection.next_sibling();
+      if(!SkipElement(xml))
+        break;
+
       continue;
     }
-    else
+    else if(isLiteralFileChunkName(xml.Name()))
     {
-      bool literalSection = false;
-
       for(const LiteralFileSection &section : literalFileSections)
       {
-        if(section.chunkName == xSection.name())
+        if(section.chunkName == xml.Name())
         {
           auto litIt = literalFiles.find(section.type);
           if(litIt != literalFiles.end())
@@ -767,165 +1581,144 @@ static RDResult XML2Structured(const rdcstr &xml, const ThumbTypeAndData &thumb,
             w->Finish();
 
             delete w;
-
-            xSection = xSection.next_sibling();
-            literalSection = true;
+          }
+          else
+          {
+            RDCERR("Missing %s for <%s>", section.filename.c_str(), section.chunkName.c_str());
           }
         }
       }
 
-      if(literalSection)
-        continue;
+      if(!SkipElement(xml))
+        break;
+
+      continue;
+    }
+    else if(xml.Name() != "section")
+    {
+      break;
     }
 
     SectionProperties props;
 
-    if(xSection.attribute("ascii"))
+    if(xml.HasAttribute("ascii"))
       props.flags |= SectionFlags::ASCIIStored;
-    if(xSection.attribute("lz4"))
+    if(xml.HasAttribute("lz4"))
       props.flags |= SectionFlags::LZ4Compressed;
-    if(xSection.attribute("zstd"))
+    if(xml.HasAttribute("zstd"))
       props.flags |= SectionFlags::ZstdCompressed;
 
-    pugi::xml_node name = xSection.child("name");
-    if(!name)
+    bool hasName = false, hasVersion = false, hasType = false, hasData = false;
+    rdcstr data;
+
+    for(t = nextElement(); t == Token::StartElement; t = nextElement())
+    {
+      const rdcstr name = xml.Name();
+      rdcstr text;
+
+      if(!ReadElementText(xml, text))
+        break;
+
+      if(name == "name")
+      {
+        props.name = text;
+        hasName = true;
+      }
+      else if(name == "version")
+      {
+        props.version = ParseXMLUInt(text.c_str());
+        hasVersion = true;
+      }
+      else if(name == "type")
+      {
+        props.type = (SectionType)ParseXMLUInt(text.c_str());
+        hasType = true;
+      }
+      else if(name == "data")
+      {
+        data.swap(text);
+        hasData = true;
+      }
+    }
+
+    if(t != Token::EndElement)
+      RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "Malformed xml document: %s",
+                          xml.GetError().c_str());
+
+    if(!hasName)
     {
       RDCERR("Malformed section, expected name node");
-      xSection = xSection.next_sibling();
       continue;
     }
-    props.name = name.text().as_string();
-
-    pugi::xml_node secVer = xSection.child("version");
-    if(!secVer)
+    if(!hasVersion)
     {
       RDCERR("Malformed section, expected version node");
-      xSection = xSection.next_sibling();
       continue;
     }
-    props.version = secVer.text().as_ullong();
-
-    pugi::xml_node type = xSection.child("type");
-    if(!type)
+    if(!hasType)
     {
       RDCERR("Malformed section, expected type node");
-      xSection = xSection.next_sibling();
       continue;
     }
-    props.type = (SectionType)type.text().as_uint();
-
-    pugi::xml_node data = xSection.child("data");
-    if(!data)
+    if(!hasData)
     {
       RDCERR("Malformed section, expected data node");
-      xSection = xSection.next_sibling();
       continue;
     }
 
-    const char *str = (const char *)data.text().get();
-    size_t len = strlen(str);
-
     StreamWriter *writer = rdc->WriteSection(props);
 
     if(props.flags & SectionFlags::ASCIIStored)
     {
-      writer->Write(str, len);
+      writer->Write(data.c_str(), data.size());
     }
     else
     {
       bytebuf decoded;
-      HexDecode(str, str + len, decoded);
+      HexDecode(data.c_str(), data.c_str() + data.size(), decoded);
       writer->Write(decoded.data(), decoded.size());
     }
 
     writer->Finish();
     delete writer;
-
-    xSection = xSection.next_sibling();
   }
 
   if(progress)
     progress(StructuredProgress(0.2f));
 
-  pugi::xml_node xChunks = xSection;
-
-  if(strcmp(xSection.name(), "chunks") != 0)
+  if(t != Token::StartElement || xml.Name() != "chunks")
     RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
-                        "Malformed xml document, expected <chunks> node, got <%s>", xSection.name());
+                        "Malformed xml document, expected <chunks> node, got <%s>",
+                        xml.Name().c_str());
 
-  if(!xChunks.attribute("version"))
+  if(!xml.HasAttribute("version"))
     RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
                         "Malformed xml document, expected version attribute");
 
-  version = xChunks.attribute("version").as_ullong();
-
-  size_t chunkIdx = 0;
-  size_t numChunks = std::distance(xChunks.begin(), xChunks.end());
+  version = ParseXMLUInt(xml.Attribute("version"));
 
-  for(pugi::xml_node xChunk = xChunks.first_child(); xChunk; xChunk = xChunk.next_sibling())
+  for(t = nextElement(); t == Token::StartElement; t = nextElement())
   {
-    if(strcmp(xChunk.name(), "chunk") != 0)
+    if(xml.Name() != "chunk")
       RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
                           "Malformed xml document, expected <chunk> child under <chunks>, got <%s>",
-                          xChunk.name());
-
-    SDChunk *chunk = new SDChunk(rdcstr(xChunk.attribute("name").as_string()));
-
-    chunk->metadata.chunkID = xChunk.attribute("id").as_uint();
-    chunk->metadata.length = xChunk.attribute("length").as_ullong();
-    if(xChunk.attribute("threadID"))
-      chunk->metadata.threadID = xChunk.attribute("threadID").as_ullong();
-    if(xChunk.attribute("timestamp"))
-      chunk->metadata.timestampMicro = xChunk.attribute("timestamp").as_ullong();
-    if(xChunk.attribute("duration"))
-      chunk->metadata.durationMicro = xChunk.attribute("duration").as_ullong();
+                          xml.Name().c_str());
 
-    pugi::xml_node callstack = xChunk.child("callstack");
-    if(callstack)
-    {
-      chunk->metadata.flags |= SDChunkFlags::HasCallstack;
-
-      size_t i = 0;
-      for(pugi::xml_node address = callstack.first_child(); address; address = address.next_sibling())
-      {
-        chunk->metadata.callstack.push_back(address.text().as_ullong());
-        i++;
-      }
-    }
+    SDChunk *chunk = XML2Chunk(xml);
+    if(!chunk)
+      RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
+                          "Malformed xml document, converting chunk %zu", chunks.size());
 
     chunks.push_back(chunk);
 
-    if(xChunk.attribute("opaque"))
-    {
-      pugi::xml_node opaque = xChunk.child("buffer");
-
-      chunk->metadata.flags |= SDChunkFlags::OpaqueChunk;
-
-      SDObject *buf = chunk->AddAndOwnChild(new SDObject("Opaque chunk"_lit, "Byte Buffer"_lit));
-      buf->type.basetype = SDBasic::Buffer;
-      buf->type.byteSize = opaque.attribute("byteLength").as_ullong();
-      buf->data.basic.u = opaque.text().as_ullong();
-    }
-    else
-    {
-      for(pugi::xml_node child = xChunk.first_child(); child; child = child.next_sibling())
-      {
-        SDObject *obj = XML2Obj(child);
-        if(!obj)
-        {
-          RETURN_ERROR_RESULT(ResultCode::FileCorrupted,
-                              "Malformed xml document, converting chunk child <%s>", child.name());
-        }
-        chunk->AddAndOwnChild(obj);
-      }
-    }
-
     if(progress)
-      progress(StructuredProgress(0.2f + 0.8f * (float(chunkIdx) / float(numChunks))));
-
-    chunkIdx++;
+      progress(StructuredProgress(0.2f + 0.8f * xml.Progress()));
   }
 
+  if(t != Token::EndElement)
+    RETURN_ERROR_RESULT(ResultCode::FileCorrupted, "Malformed xml document: %s",
+                        xml.GetError().c_str());
+
   return ResultCode::Succeeded;
 }
 
@@ -1128,11 +1921,7 @@ RDResult importXMLZ(const rdcstr &filename, StreamReader &reader, RDCFile *rdc,
       return res;
   }
 
-  rdcstr buf;
-  buf.resize((size_t)reader.GetSize());
-  reader.Read(buf.data(), buf.size());
-
-  return XML2Structured(buf.c_str(), thumb, extThumb, literalFiles, structData.buffers, rdc,
+  return XML2Structured(reader, thumb, extThumb, literalFiles, structData.buffers, rdc,
                         structData.version, structData.chunks, progress);
 }
 
@@ -1179,9 +1968,6 @@ easier to work with but it cannot then be imported.)",
 
 TEST_CASE("XML/SDObject round trip", "[xml serialiser]")
 {
-  pugi::xml_document doc;
-  pugi::xml_node xRoot = doc.append_child("root");
-
   rdcarray<SDObject *> objs;
   SDObject *obj;
 
@@ -1209,17 +1995,62 @@ TEST_CASE("XML/SDObject round trip", "[xml serialiser]")
   obj->data.basic.u = UINT8_MAX;
   objs.push_back(obj);
 
-  for(int i = 0; i < objs.count(); ++i)
+  obj = new SDObject("SignedTest"_lit, "int32_t"_lit);
+  obj->type.basetype = SDBasic::SignedInteger;
+  obj->type.byteSize = 4;
+  obj->data.basic.i = -123456;
+  objs.push_back(obj);
+
+  obj = new SDObject("FloatTest"_lit, "double"_lit);
+  obj->type.basetype = SDBasic::Float;
+  obj->type.byteSize = 8;
+  obj->data.basic.d = 0.1;
+  objs.push_back(obj);
+
+  obj = new SDObject("StringTest"_lit, "string"_lit);
+  obj->type.basetype = SDBasic::String;
+  obj->type.flags = SDTypeFlags::Important;
+  obj->data.str = "a <tagged> & \"quoted\"\tstring\nover two lines";
+  objs.push_back(obj);
+
+  obj = new SDObject("EnumStringTest"_lit, "VkFormat"_lit);
+  obj->type.basetype = SDBasic::Enum;
+  obj->type.byteSize = 4;
+  obj->type.flags = SDTypeFlags::HasCustomString;
+  obj->data.basic.u = 37;
+  obj->data.str = "VK_FORMAT_R8G8B8A8_UNORM & \"friends\"";
+  objs.push_back(obj);
+
+  StreamWriter writer(1024);
+
   {
-    Obj2XML(xRoot, *objs[i]);
+    XMLStreamWriter xml(writer);
+
+    xml.StartElement("root");
+
+    for(int i = 0; i < objs.count(); ++i)
+    {
+      CHECK(Obj2XML(xml, *objs[i], false));
+    }
+
+    xml.EndElement();
   }
 
-  for(pugi::xml_node xChild = xRoot.last_child(); xChild; xChild = xChild.previous_sibling())
+  StreamReader reader(writer.GetData(), writer.GetOffset());
+  XMLPullParser xml(reader);
+
+  REQUIRE((xml.Next() == XMLPullParser::Token::StartElement));
+  CHECK(xml.Name() == "root");
+
+  for(int i = 0; i < objs.count(); ++i)
   {
-    SDObject *newObj = XML2Obj(xChild);
-    obj = objs.back();
-    objs.pop_back();
+    REQUIRE((xml.Next() == XMLPullParser::Token::StartElement));
 
+    SDObject *newObj = XML2Obj(xml);
+    REQUIRE(newObj);
+    obj = objs[i];
+
+    CHECK(newObj->name == obj->name);
     CHECK(newObj->type.basetype == obj->type.basetype);
     CHECK(newObj->type.byteSize == obj->type.byteSize);
     CHECK(newObj->type.name == obj->type.name);
@@ -1228,8 +2059,94 @@ TEST_CASE("XML/SDObject round trip", "[xml serialiser]")
     CHECK(newObj->data.str == obj->data.str);
 
     delete newObj;
-    delete obj;
   }
+
+  CHECK((xml.Next() == XMLPullParser::Token::EndElement));
+  CHECK((xml.Next() == XMLPullParser::Token::EndOfDocument));
+
+  for(SDObject *o : objs)
+    delete o;
+}
+
+TEST_CASE("XML pull parsing", "[xml serialiser]")
+{
+  typedef XMLPullParser::Token Token;
+
+  rdcstr doc =
+      "<?xml version=\"1.0\"?>\r\n"
+      "<!DOCTYPE rdc>\n"
+      "<!-- a comment with <tags> -- in it --->\n"
+      "<rdc a='1' b=\"x &amp; &lt;y&gt; &#65;&#x42; &#x20AC; &unknown;\">\n"
+      "\t<empty />\n"
+      "\t<text>line one\r\nline two</text>\n"
+      "\t<cdata><![CDATA[<not a tag> & not an entity]]></cdata>\n"
+      "\t<attr value=\"tab\tand\nnewline\" />\n"
+      "</rdc>\n";
+
+  SECTION("Well formed document")
+  {
+    StreamReader reader((const byte *)doc.c_str(), doc.size());
+    XMLPullParser xml(reader);
+
+    REQUIRE((xml.Next() == Token::StartElement));
+    CHECK(xml.Name() == "rdc");
+    CHECK(xml.HasAttribute("a"));
+    CHECK(rdcstr(xml.Attribute("a")) == "1");
+    CHECK(rdcstr(xml.Attribute("b")) == "x & <y> AB \xe2\x82\xac &unknown;");
+    CHECK_FALSE(xml.HasAttribute("c"));
+    CHECK(rdcstr(xml.Attribute("c")) == "");
+
+    REQUIRE((xml.Next() == Token::StartElement));
+    CHECK(xml.Name() == "empty");
+    REQUIRE((xml.Next() == Token::EndElement));
+    CHECK(xml.Name() == "empty");
+
+    REQUIRE((xml.Next() == Token::StartElement));
+    CHECK(xml.Name() == "text");
+    REQUIRE((xml.Next() == Token::Text));
+    CHECK(xml.Text() == "line one\nline two");
+    REQUIRE((xml.Next() == Token::EndElement));
+
+    REQUIRE((xml.Next() == Token::StartElement));
+    CHECK(xml.Name() == "cdata");
+    REQUIRE((xml.Next() == Token::Text));
+    CHECK(xml.Text() == "<not a tag> & not an entity");
+    REQUIRE((xml.Next() == Token::EndElement));
+
+    REQUIRE((xml.Next() == Token::StartElement));
+    CHECK(xml.Name() == "attr");
+    CHECK(rdcstr(xml.Attribute("value")) == "tab and newline");
+    REQUIRE((xml.Next() == Token::EndElement));
+
+    REQUIRE((xml.Next() == Token::EndElement));
+    CHECK(xml.Name() == "rdc");
+
+    CHECK((xml.Next() == Token::EndOfDocument));
+    CHECK(xml.Progress() == 1.0f);
+  };
+
+  SECTION("Mismatched end tag")
+  {
+    rdcstr bad = "<rdc><header></rdc>";
+    StreamReader reader((const byte *)bad.c_str(), bad.size());
+    XMLPullParser xml(reader);
+
+    CHECK((xml.Next() == Token::StartElement));
+    CHECK((xml.Next() == Token::StartElement));
+    CHECK((xml.Next() == Token::Error));
+    CHECK(xml.GetError().contains("</rdc>"));
+  };
+
+  SECTION("Truncated document")
+  {
+    rdcstr bad = "<rdc><header>";
+    StreamReader reader((const byte *)bad.c_str(), bad.size());
+    XMLPullParser xml(reader);
+
+    CHECK((xml.Next() == Token::StartElement));
+    CHECK((xml.Next() == Token::StartElement));
+    CHECK((xml.Next() == Token::Error));
+  };
 }
 
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
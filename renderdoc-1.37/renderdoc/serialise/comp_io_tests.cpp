@@ -190,4 +190,180 @@ TEST_CASE("Test ZSTD compression/decompression", "[streamio][zstd]")
   delete[] randomData;
 };
 
+template <typename CompressorType, typename DecompressorType>
+static void TestParallelRoundTrip(uint32_t numThreads, bool parallelDecompress)
+{
+  // enough data for several blocks of either compressor, with a partial block at the end
+  const size_t dataSize = 5 * 1024 * 1024 + 12345;
+
+  byte *data = new byte[dataSize];
+  for(size_t i = 0; i < dataSize; i++)
+    data[i] = (i % 3000) < 1000 ? byte(rand() & 0xff) : byte(i & 0xff);
+
+  StreamWriter buf(StreamWriter::DefaultScratchSize);
+
+  {
+    StreamWriter writer(new CompressorType(&buf, Ownership::Nothing, numThreads), Ownership::Stream);
+
+    // write in irregular sizes so that writes straddle blocks
+    size_t offs = 0;
+    size_t size = 17;
+    while(offs < dataSize)
+    {
+      size_t writeSize = RDCMIN(size, dataSize - offs);
+      writer.Write(data + offs, writeSize);
+      offs += writeSize;
+      size = (size * 7) % (3 * 1024 * 1024) + 1;
+    }
+
+    CHECK(writer.GetOffset() == dataSize);
+
+    writer.Finish();
+
+    CHECK_FALSE(writer.IsErrored());
+  }
+
+  CHECK(buf.GetOffset() < dataSize);
+
+  {
+    StreamReader reader(
+        new DecompressorType(new StreamReader(buf.GetData(), buf.GetOffset()), Ownership::Stream,
+                             parallelDecompress ? numThreads : 0),
+        dataSize, Ownership::Stream);
+
+    byte *readData = new byte[dataSize];
+
+    reader.Read(readData, 1000);
+    reader.Read(readData + 1000, dataSize - 1000);
+
+    CHECK_FALSE(reader.IsErrored());
+    CHECK(reader.AtEnd());
+    CHECK_FALSE(memcmp(readData, data, dataSize));
+
+    delete[] readData;
+  }
+
+  delete[] data;
+}
+
+template <typename CompressorType, typename DecompressorType>
+static void TestParallelRoundTrips()
+{
+  // without the job system blocks are processed inline, which must produce the same stream
+  for(bool useJobs : {false, true})
+  {
+    if(useJobs)
+      Threading::JobSystem::Init(3);
+
+    for(uint32_t numThreads : {1U, 3U})
+    {
+      // parallel compressed data must be readable by the serial decompressor too
+      TestParallelRoundTrip<CompressorType, DecompressorType>(numThreads, false);
+      TestParallelRoundTrip<CompressorType, DecompressorType>(numThreads, true);
+    }
+
+    if(useJobs)
+      Threading::JobSystem::Shutdown();
+  }
+}
+
+TEST_CASE("Test parallel compression/decompression", "[streamio][lz4][zstd]")
+{
+  SECTION("LZ4")
+  {
+    TestParallelRoundTrips<LZ4Compressor, LZ4Decompressor>();
+  };
+
+  SECTION("ZSTD")
+  {
+    TestParallelRoundTrips<ZSTDCompressor, ZSTDDecompressor>();
+  };
+};
+
+template <typename CompressorType, typename DecompressorType>
+static void TestSeekTable(uint32_t numThreads)
+{
+  const size_t dataSize = 7 * 1024 * 1024 + 4321;
+
+  byte *data = new byte[dataSize];
+  for(size_t i = 0; i < dataSize; i++)
+    data[i] = (i % 5000) < 100 ? byte(rand() & 0xff) : byte((i * 7) & 0xff);
+
+  StreamWriter buf(StreamWriter::DefaultScratchSize);
+
+  {
+    CompressorType *comp = new CompressorType(&buf, Ownership::Nothing, numThreads);
+    comp->EnableSeekTable();
+
+    StreamWriter writer(comp, Ownership::Stream);
+    writer.Write(data, dataSize);
+    writer.Finish();
+
+    CHECK_FALSE(writer.IsErrored());
+  }
+
+  // parse the seek table from the end of the stream
+  SeekTableFooter footer;
+  memcpy(&footer, buf.GetData() + buf.GetOffset() - sizeof(footer), sizeof(footer));
+
+  REQUIRE(footer.magic == (uint32_t)SeekTableFooter::MAGIC);
+  REQUIRE(footer.numBlocks > 1);
+
+  rdcarray<uint64_t> offsets;
+  offsets.resize((size_t)footer.numBlocks);
+
+  const uint64_t blocksLength = buf.GetOffset() - sizeof(footer) - offsets.byteSize();
+  memcpy(offsets.data(), buf.GetData() + blocksLength, offsets.byteSize());
+
+  CHECK(offsets[0] == 0);
+
+  DecompressorType *decomp = new DecompressorType(
+      new StreamReader(buf.GetData(), blocksLength), Ownership::Stream, numThreads);
+  CHECK(decomp->SetSeekTable(footer.blockSize, std::move(offsets)));
+  CHECK(decomp->CanSkip());
+
+  StreamReader reader(decomp, dataSize, Ownership::Stream);
+
+  byte readData[256];
+
+  // skip within a block, across a block, and across many blocks
+  uint64_t offs = 0;
+  for(uint64_t skip : {100ULL, 70000ULL, 3000000ULL, 1ULL, 2500000ULL})
+  {
+    reader.SkipBytes(skip);
+    offs += skip;
+
+    reader.Read(readData, sizeof(readData));
+    CHECK_FALSE(memcmp(readData, data + offs, sizeof(readData)));
+    offs += sizeof(readData);
+  }
+
+  // skip right up to the end
+  reader.SkipBytes(dataSize - offs);
+
+  CHECK_FALSE(reader.IsErrored());
+  CHECK(reader.AtEnd());
+
+  delete[] data;
+}
+
+TEST_CASE("Test compression seek tables", "[streamio][lz4][zstd]")
+{
+  Threading::JobSystem::Init(2);
+
+  SECTION("LZ4")
+  {
+    TestSeekTable<LZ4Compressor, LZ4Decompressor>(0);
+    TestSeekTable<LZ4Compressor, LZ4Decompressor>(2);
+  };
+
+  SECTION("ZSTD")
+  {
+    TestSeekTable<ZSTDCompressor, ZSTDDecompressor>(0);
+    TestSeekTable<ZSTDCompressor, ZSTDDecompressor>(2);
+  };
+
+  Threading::JobSystem::Shutdown();
+};
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -26,8 +26,52 @@
 
 static const uint64_t lz4BlockSize = 1024 * 1024;
 
-LZ4Compressor::LZ4Compressor(StreamWriter *write, Ownership own) : Compressor(write, own)
+static RDResult CompressLZ4Block(uint32_t, BlockWorkerPool::Block &block)
 {
+  RDResult ret;
+
+  // no history is used, so that each block is independent and can be compressed in any order
+  int32_t compSize = LZ4_compress_fast((const char *)block.src, (char *)block.dst,
+                                       (int)block.srcSize, (int)LZ4_COMPRESSBOUND(lz4BlockSize), 20);
+
+  if(compSize <= 0)
+    SET_ERROR_RESULT(ret, ResultCode::CompressionFailed, "LZ4 compression failed: %i", compSize);
+  else
+    block.dstSize = compSize;
+
+  return ret;
+}
+
+static RDResult DecompressLZ4Block(uint32_t, BlockWorkerPool::Block &block)
+{
+  RDResult ret;
+
+  int32_t decompSize = LZ4_decompress_safe((const char *)block.src, (char *)block.dst,
+                                           (int)block.srcSize, (int)lz4BlockSize);
+
+  if(decompSize < 0)
+    SET_ERROR_RESULT(ret, ResultCode::CompressionFailed, "LZ4 decompression failed on block: %i",
+                     decompSize);
+  else
+    block.dstSize = decompSize;
+
+  return ret;
+}
+
+LZ4Compressor::LZ4Compressor(StreamWriter *write, Ownership own, uint32_t numThreads)
+    : Compressor(write, own)
+{
+  if(numThreads > 0)
+  {
+    m_Page[0] = m_Page[1] = m_CompressBuffer = NULL;
+    m_LZ4Comp = NULL;
+
+    m_Pool = new BlockWorkerPool(numThreads, lz4BlockSize, LZ4_COMPRESSBOUND(lz4BlockSize),
+                                 &CompressLZ4Block);
+    AcquirePage0();
+    return;
+  }
+
   m_Page[0] = AllocAlignedBuffer(lz4BlockSize);
   m_Page[1] = AllocAlignedBuffer(lz4BlockSize);
   m_CompressBuffer = AllocAlignedBuffer(LZ4_COMPRESSBOUND(lz4BlockSize));
@@ -39,16 +83,29 @@ LZ4Compressor::LZ4Compressor(StreamWriter *write, Ownership own) : Compressor(wr
 
 LZ4Compressor::~LZ4Compressor()
 {
+  if(m_Pool)
+  {
+    // in the serial path any full pages are written as soon as they're flushed, so do the same
+    // here if Finish() wasn't called.
+    while(m_Page[0] && m_Pool->InFlight() > 0)
+      WriteOldestBlock();
+
+    // the pages are owned by the pool
+    delete m_Pool;
+    return;
+  }
+
   FreeAlignedBuffer(m_Page[0]);
   FreeAlignedBuffer(m_Page[1]);
   FreeAlignedBuffer(m_CompressBuffer);
-  LZ4_freeStream(m_LZ4Comp);
+  if(m_LZ4Comp)
+    LZ4_freeStream(m_LZ4Comp);
 }
 
 bool LZ4Compressor::Write(const void *data, uint64_t numBytes)
 {
   // if we encountered a stream error this will be NULL
-  if(!m_CompressBuffer)
+  if(!m_Page[0])
     return false;
 
   if(numBytes == 0)
@@ -115,15 +172,37 @@ bool LZ4Compressor::Finish()
   // uniform in size
   // only the last one can be smaller, so we only write a partial page when finishing.
   // Calling Write() after Finish() is illegal
-  return FlushPage0();
+  bool success = FlushPage0();
+
+  // when compressing in parallel, wait for all blocks to be written out
+  while(success && m_Pool && m_Pool->InFlight() > 0)
+    success &= WriteOldestBlock();
+
+  if(success)
+    success &= WriteSeekTable(lz4BlockSize);
+
+  return success;
 }
 
 bool LZ4Compressor::FlushPage0()
 {
   // if we encountered a stream error this will be NULL
-  if(!m_CompressBuffer)
+  if(!m_Page[0])
     return false;
 
+  if(m_Pool)
+  {
+    // submit this page to be compressed and start on the next one
+    m_CurBlock->srcSize = m_PageOffset;
+    m_Pool->Submit();
+
+    return AcquirePage0();
+  }
+
+  // blocks must be independent if we're writing a seek table, so don't use any history
+  if(m_WriteSeekTable)
+    LZ4_resetStream_fast(m_LZ4Comp);
+
   // m_PageOffset is the amount written, usually equal to lz4BlockSize except the last block.
   int32_t compSize =
       LZ4_compress_fast_continue(m_LZ4Comp, (const char *)m_Page[0], (char *)m_CompressBuffer,
@@ -141,6 +220,7 @@ bool LZ4Compressor::FlushPage0()
 
   bool success = true;
 
+  m_BlockOffsets.push_back(m_Write->GetOffset());
   success &= m_Write->Write(compSize);
   if(!success)
     m_Error = m_Write->GetError();
@@ -157,8 +237,63 @@ bool LZ4Compressor::FlushPage0()
   return success;
 }
 
-LZ4Decompressor::LZ4Decompressor(StreamReader *read, Ownership own) : Decompressor(read, own)
+bool LZ4Compressor::AcquirePage0()
 {
+  // if every block is in flight, the oldest must be written out before we can reuse it
+  if(m_Pool->Full() && !WriteOldestBlock())
+    return false;
+
+  m_CurBlock = &m_Pool->Acquire();
+  m_Page[0] = m_CurBlock->src;
+  m_PageOffset = 0;
+
+  return true;
+}
+
+bool LZ4Compressor::WriteOldestBlock()
+{
+  BlockWorkerPool::Block *block = m_Pool->Oldest();
+
+  bool success = true;
+
+  if(block->error != ResultCode::Succeeded)
+  {
+    m_Error = block->error;
+    success = false;
+  }
+  else
+  {
+    m_BlockOffsets.push_back(m_Write->GetOffset());
+    success &= m_Write->Write((int32_t)block->dstSize);
+    success &= m_Write->Write(block->dst, block->dstSize);
+    if(!success)
+      m_Error = m_Write->GetError();
+  }
+
+  m_Pool->Retire();
+
+  if(!success)
+    m_Page[0] = NULL;
+
+  return success;
+}
+
+LZ4Decompressor::LZ4Decompressor(StreamReader *read, Ownership own, uint32_t numThreads)
+    : Decompressor(read, own)
+{
+  if(numThreads > 0)
+  {
+    m_Page[0] = m_Page[1] = m_CompressBuffer = NULL;
+    m_LZ4Decomp = NULL;
+
+    m_PageOffset = 0;
+    m_PageLength = 0;
+
+    m_Pool = new BlockWorkerPool(numThreads, LZ4_COMPRESSBOUND(lz4BlockSize), lz4BlockSize,
+                                 &DecompressLZ4Block);
+    return;
+  }
+
   m_Page[0] = AllocAlignedBuffer(lz4BlockSize);
   m_Page[1] = AllocAlignedBuffer(lz4BlockSize);
   m_CompressBuffer = AllocAlignedBuffer(LZ4_COMPRESSBOUND(lz4BlockSize));
@@ -173,18 +308,38 @@ LZ4Decompressor::LZ4Decompressor(StreamReader *read, Ownership own) : Decompress
 
 LZ4Decompressor::~LZ4Decompressor()
 {
+  if(m_Pool)
+  {
+    // the pages are owned by the pool
+    delete m_Pool;
+    return;
+  }
+
   FreeAlignedBuffer(m_Page[0]);
   FreeAlignedBuffer(m_Page[1]);
   FreeAlignedBuffer(m_CompressBuffer);
 
-  LZ4_freeStreamDecode(m_LZ4Decomp);
+  if(m_LZ4Decomp)
+    LZ4_freeStreamDecode(m_LZ4Decomp);
+}
+
+bool LZ4Decompressor::NoMoreBlocks()
+{
+  if(m_Pool)
+  {
+    // blocks may still be in flight after we've read all the compressed data. The current page
+    // counts as in flight until the next page is filled
+    return m_Read->AtEnd() && m_Pool->InFlight() <= (m_Page[0] ? 1U : 0U);
+  }
+
+  return m_Read->AtEnd();
 }
 
 bool LZ4Decompressor::Recompress(Compressor *comp)
 {
   bool success = true;
 
-  while(success && !m_Read->AtEnd())
+  while(success && !NoMoreBlocks())
   {
     success &= FillPage0();
     if(success)
@@ -202,8 +357,8 @@ bool LZ4Decompressor::Recompress(Compressor *comp)
 
 bool LZ4Decompressor::Read(void *data, uint64_t numBytes)
 {
-  // if we encountered a stream error this will be NULL
-  if(!m_CompressBuffer)
+  // if we encountered a stream error these will be NULL
+  if(!m_CompressBuffer && !m_Pool)
     return false;
 
   if(numBytes == 0)
@@ -262,6 +417,9 @@ bool LZ4Decompressor::Read(void *data, uint64_t numBytes)
 
 bool LZ4Decompressor::FillPage0()
 {
+  if(m_Pool)
+    return FillPage0Parallel();
+
   // swap pages
   std::swap(m_Page[0], m_Page[1]);
 
@@ -317,8 +475,165 @@ bool LZ4Decompressor::FillPage0()
     return false;
   }
 
+  m_PageStart += m_PageLength;
+  m_NextBlock++;
+
   m_PageOffset = 0;
   m_PageLength = decompSize;
 
   return success;
 }
+
+bool LZ4Decompressor::FillPage0Parallel()
+{
+  // the current page is in the oldest block, which we're now finished with
+  if(m_Page[0])
+    m_Pool->Retire();
+  m_Page[0] = NULL;
+
+  // read ahead as many compressed blocks as we have room for, so they can be decompressed
+  // while we consume this one
+  while(!m_Pool->Full() && !m_Read->AtEnd())
+  {
+    BlockWorkerPool::Block &block = m_Pool->Acquire();
+
+    int32_t compSize = 0;
+
+    bool success = m_Read->Read(compSize);
+    if(!success)
+    {
+      SetParallelError(m_Read->GetError());
+      return false;
+    }
+
+    if(compSize < 0 || (uint64_t)compSize > m_Pool->SourceCapacity())
+    {
+      RDResult error;
+      SET_ERROR_RESULT(error, ResultCode::CompressionFailed,
+                       "LZ4 decompression encountered invalid compressed block size: %i", compSize);
+      SetParallelError(error);
+      return false;
+    }
+
+    success = m_Read->Read(block.src, compSize);
+    if(!success)
+    {
+      SetParallelError(m_Read->GetError());
+      return false;
+    }
+
+    block.srcSize = compSize;
+    m_Pool->Submit();
+
+    m_NextBlock++;
+  }
+
+  BlockWorkerPool::Block *block = m_Pool->Oldest();
+
+  if(!block)
+  {
+    RDResult error;
+    SET_ERROR_RESULT(error, ResultCode::CompressionFailed,
+                     "LZ4 decompression ran out of compressed blocks");
+    SetParallelError(error);
+    return false;
+  }
+
+  if(block->error != ResultCode::Succeeded)
+  {
+    SetParallelError(block->error);
+    return false;
+  }
+
+  m_Page[0] = block->dst;
+  m_PageStart += m_PageLength;
+  m_PageOffset = 0;
+  m_PageLength = block->dstSize;
+
+  return true;
+}
+
+void LZ4Decompressor::SetParallelError(RDResult error)
+{
+  m_Error = error;
+
+  delete m_Pool;
+  m_Pool = NULL;
+  m_Page[0] = NULL;
+}
+
+bool LZ4Decompressor::SetSeekTable(uint64_t blockSize, rdcarray<uint64_t> &&blockOffsets)
+{
+  if(blockSize != lz4BlockSize)
+    return false;
+
+  m_SeekTable = std::move(blockOffsets);
+  return true;
+}
+
+bool LZ4Decompressor::Skip(uint64_t numBytes)
+{
+  // if we encountered a stream error these will be NULL
+  if(!m_CompressBuffer && !m_Pool)
+    return false;
+
+  const uint64_t target = m_PageStart + m_PageOffset + numBytes;
+
+  // if the target is in the current page, just move within it
+  if(target <= m_PageStart + m_PageLength)
+  {
+    m_PageOffset = target - m_PageStart;
+    return true;
+  }
+
+  const uint64_t block = target / lz4BlockSize;
+
+  if(block >= m_SeekTable.size())
+  {
+    SET_ERROR_RESULT(m_Error, ResultCode::CompressionFailed,
+                     "Skipping to offset %llu is past the end of the seek table", target);
+    return false;
+  }
+
+  // blocks that were already read from the stream (e.g. read ahead for parallel decompression)
+  // can't be skipped over in the underlying stream, so in that case we decompress until we reach
+  // the target. Otherwise we can seek directly to the block containing the target.
+  if(block >= m_NextBlock)
+  {
+    if(m_Pool)
+    {
+      // discard any blocks in flight, waiting for their jobs to finish with them first
+      while(m_Pool->Oldest())
+        m_Pool->Retire();
+      m_Page[0] = NULL;
+    }
+    else
+    {
+      // every block in a stream with a seek table is independent so we can discard history
+      LZ4_setStreamDecode(m_LZ4Decomp, NULL, 0);
+    }
+
+    if(!m_Read->SkipBytes(m_SeekTable[(size_t)block] - m_Read->GetOffset()))
+    {
+      m_Error = m_Read->GetError();
+      return false;
+    }
+
+    m_NextBlock = block;
+    m_PageStart = block * lz4BlockSize;
+    m_PageOffset = m_PageLength = 0;
+
+    if(!FillPage0())
+      return false;
+  }
+
+  while(target > m_PageStart + m_PageLength)
+  {
+    if(!FillPage0())
+      return false;
+  }
+
+  m_PageOffset = target - m_PageStart;
+
+  return true;
+}
@@ -25,12 +25,16 @@
 #pragma once
 
 #include "lz4/lz4.h"
+#include "blockpool.h"
 #include "streamio.h"
 
 class LZ4Compressor : public Compressor
 {
 public:
-  LZ4Compressor(StreamWriter *write, Ownership own);
+  // if numThreads is non-zero, blocks are compressed independently as jobs, with enough in flight
+  // to keep that many threads busy. The output format is the same and can be read by either
+  // decompressor mode.
+  LZ4Compressor(StreamWriter *write, Ownership own, uint32_t numThreads = 0);
   ~LZ4Compressor();
 
   bool Write(const void *data, uint64_t numBytes);
@@ -38,30 +42,53 @@ public:
 
 private:
   bool FlushPage0();
+  bool AcquirePage0();
+  bool WriteOldestBlock();
 
   byte *m_Page[2];
   byte *m_CompressBuffer;
   uint64_t m_PageOffset;
 
   LZ4_stream_t *m_LZ4Comp;
+
+  // only used when compressing in parallel. m_Page[0] then points into m_CurBlock
+  BlockWorkerPool *m_Pool = NULL;
+  BlockWorkerPool::Block *m_CurBlock = NULL;
 };
 
 class LZ4Decompressor : public Decompressor
 {
 public:
-  LZ4Decompressor(StreamReader *read, Ownership own);
+  // if numThreads is non-zero, blocks are read ahead and decompressed as jobs, with enough in
+  // flight to keep that many threads busy. This is only valid if the blocks were compressed independently, see
+  // SectionFlags::IndependentBlocks.
+  LZ4Decompressor(StreamReader *read, Ownership own, uint32_t numThreads = 0);
   ~LZ4Decompressor();
 
   bool Recompress(Compressor *comp);
   bool Read(void *data, uint64_t numBytes);
 
+  bool SetSeekTable(uint64_t blockSize, rdcarray<uint64_t> &&blockOffsets);
+  bool Skip(uint64_t numBytes);
+
 private:
   bool FillPage0();
+  bool FillPage0Parallel();
+  bool NoMoreBlocks();
+  void SetParallelError(RDResult error);
 
   byte *m_Page[2];
   byte *m_CompressBuffer;
   uint64_t m_PageOffset;
   uint64_t m_PageLength;
 
+  // the uncompressed offset of the start of the current page, and the index of the next block to be
+  // read from the compressed stream. Used for skipping with a seek table
+  uint64_t m_PageStart = 0;
+  uint64_t m_NextBlock = 0;
+
   LZ4_streamDecode_t *m_LZ4Decomp;
+
+  // only used when decompressing in parallel. m_Page[0] then points into the oldest block
+  BlockWorkerPool *m_Pool = NULL;
 };
@@ -227,12 +227,61 @@ struct BinarySectionHeader
 };
 };
 
+// sections smaller than this are (de)compressed serially. Each block in flight needs a source and
+// destination buffer, so parallel compression is only worthwhile for large sections
+static const uint64_t ParallelCompressionThreshold = 16 * 1024 * 1024;
+
+static bool UseParallelCompression(uint64_t sectionSize)
+{
+  // blocks are processed as jobs, so this is only possible where jobs can be added
+  return sectionSize >= ParallelCompressionThreshold && Threading::JobSystem::IsAvailable();
+}
+
 RDCFile::~RDCFile()
 {
+  for(FileMapping *mapping : m_Mappings)
+    mapping->Release();
+
   if(m_File)
     FileIO::fclose(m_File);
 }
 
+// must be called with m_MappingsLock held
+void RDCFile::ReleaseUnusedMappings() const
+{
+  for(size_t i = 0; i < m_Mappings.size();)
+  {
+    // if we hold the only reference, no readers are using it any more
+    if(Atomic::CmpExch32(&m_Mappings[i]->refcount, 1, 1) == 1)
+    {
+      m_Mappings[i]->Release();
+      m_Mappings.erase(i);
+      continue;
+    }
+
+    i++;
+  }
+}
+
+void RDCFile::DetachMappings()
+{
+  SCOPED_LOCK(m_MappingsLock);
+
+  ReleaseUnusedMappings();
+
+  // readers still using a mapping keep their data at the same address, it just stops being backed
+  // by the file so that it's unaffected when sections are moved or the file is truncated
+  for(FileMapping *mapping : m_Mappings)
+  {
+    if(!FileIO::DetachFileRange(mapping->data, mapping->size))
+      RDCERR("Couldn't detach mapped section data from %s before modifying it", m_Filename.c_str());
+
+    mapping->Release();
+  }
+
+  m_Mappings.clear();
+}
+
 void RDCFile::Open(const rdcstr &path)
 {
   // silently fail when opening the empty string, to allow 'releasing' a capture file by opening an
@@ -883,29 +932,113 @@ StreamReader *RDCFile::ReadSection(int index) const
 
   const SectionProperties &props = m_Sections[index];
   SectionLocation offsetSize = m_SectionLocations[index];
+
+  // the seek table is stored after the compressed blocks. Read it first and exclude it from the
+  // data given to the decompressor
+  uint64_t seekBlockSize = 0;
+  rdcarray<uint64_t> seekTable;
+
+  if((props.flags & SectionFlags::SeekTable) &&
+     (props.flags & (SectionFlags::LZ4Compressed | SectionFlags::ZstdCompressed)))
+  {
+    if(ReadSeekTable(offsetSize, seekBlockSize, seekTable))
+      offsetSize.diskLength -= seekTable.byteSize() + sizeof(SeekTableFooter);
+    else
+      RDCWARN("Section %d has an invalid seek table, it will be read sequentially", index);
+  }
+
+  // uncompressed sections are mapped rather than read, so they can be consumed in place without
+  // copying the whole section into memory. This falls back to reading the file if mapping fails.
+  // Readers can outlive modifications to the file by WriteSection, so mapping is only used if the
+  // mapping can be detached from the file first.
+  if(!(props.flags & (SectionFlags::LZ4Compressed | SectionFlags::ZstdCompressed)) &&
+     FileIO::CanDetachFileRange())
+  {
+    StreamReader *reader = new StreamReader(StreamReader::MappedStream, m_File,
+                                            offsetSize.dataOffset, offsetSize.diskLength);
+
+    SCOPED_LOCK(m_MappingsLock);
+
+    ReleaseUnusedMappings();
+
+    FileMapping *mapping = reader->GetMapping();
+    if(mapping)
+    {
+      mapping->AddRef();
+      m_Mappings.push_back(mapping);
+    }
+
+    return reader;
+  }
+
   FileIO::fseek64(m_File, offsetSize.dataOffset, SEEK_SET);
 
   StreamReader *fileReader = new StreamReader(m_File, offsetSize.diskLength, Ownership::Nothing);
 
   StreamReader *compReader = NULL;
 
+  // zstd frames are always independent, but older captures have LZ4 blocks that reference the
+  // previous block's history so they must be decompressed serially. Small sections are always
+  // decompressed serially, it's not worth the read-ahead buffers.
+  const uint32_t decompressThreads = UseParallelCompression(props.uncompressedSize)
+                                         ? BlockWorkerPool::DefaultThreadCount()
+                                         : 0;
+
+  Decompressor *decompressor = NULL;
+
   if(props.flags & SectionFlags::LZ4Compressed)
+    decompressor =
+        new LZ4Decompressor(fileReader, Ownership::Stream,
+                            (props.flags & SectionFlags::IndependentBlocks) ? decompressThreads : 0);
+  else if(props.flags & SectionFlags::ZstdCompressed)
+    decompressor = new ZSTDDecompressor(fileReader, Ownership::Stream, decompressThreads);
+
+  if(decompressor)
   {
+    if(!seekTable.empty() && !decompressor->SetSeekTable(seekBlockSize, std::move(seekTable)))
+      RDCWARN("Section %d has an incompatible seek table, it will be read sequentially", index);
+
     // the user will delete the compressed reader, and then it will delete the compressor and the
     // file reader
-    compReader = new StreamReader(new LZ4Decompressor(fileReader, Ownership::Stream),
-                                  props.uncompressedSize, Ownership::Stream);
-  }
-  else if(props.flags & SectionFlags::ZstdCompressed)
-  {
-    compReader = new StreamReader(new ZSTDDecompressor(fileReader, Ownership::Stream),
-                                  props.uncompressedSize, Ownership::Stream);
+    compReader = new StreamReader(decompressor, props.uncompressedSize, Ownership::Stream);
   }
 
   // if we're compressing return that writer, otherwise return the file writer directly
   return compReader ? compReader : fileReader;
 }
 
+bool RDCFile::ReadSeekTable(const SectionLocation &loc, uint64_t &blockSize,
+                            rdcarray<uint64_t> &blockOffsets) const
+{
+  if(loc.diskLength < sizeof(SeekTableFooter))
+    return false;
+
+  SeekTableFooter footer = {};
+
+  FileIO::fseek64(m_File, loc.dataOffset + loc.diskLength - sizeof(SeekTableFooter), SEEK_SET);
+  if(FileIO::fread(&footer, 1, sizeof(footer), m_File) != sizeof(footer))
+    return false;
+
+  if(footer.magic != SeekTableFooter::MAGIC || footer.blockSize == 0 ||
+     footer.numBlocks > (loc.diskLength - sizeof(SeekTableFooter)) / sizeof(uint64_t))
+    return false;
+
+  blockSize = footer.blockSize;
+  blockOffsets.resize((size_t)footer.numBlocks);
+
+  const uint64_t tableSize = blockOffsets.byteSize();
+
+  FileIO::fseek64(m_File, loc.dataOffset + loc.diskLength - sizeof(SeekTableFooter) - tableSize,
+                  SEEK_SET);
+  if(FileIO::fread(blockOffsets.data(), 1, (size_t)tableSize, m_File) != tableSize)
+  {
+    blockOffsets.clear();
+    return false;
+  }
+
+  return true;
+}
+
 StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
 {
   if(m_Error != ResultCode::Succeeded)
@@ -930,6 +1063,9 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
     return w;
   }
 
+  // anything we're about to move or truncate mustn't change under a reader
+  DetachMappings();
+
   // re-open the file as read-write
   {
     uint64_t offs = FileIO::ftell64(m_File);
@@ -973,6 +1109,13 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
     return new StreamWriter(StreamWriter::InvalidStream);
   }
 
+  // compressed sections are always written with independent blocks so that they can be
+  // decompressed in parallel, and with a seek table for random access. Don't trust the incoming
+  // flags, they may have been copied from another section's properties.
+  SectionFlags flags = props.flags & ~(SectionFlags::IndependentBlocks | SectionFlags::SeekTable);
+  if(flags & (SectionFlags::LZ4Compressed | SectionFlags::ZstdCompressed))
+    flags |= SectionFlags::IndependentBlocks | SectionFlags::SeekTable;
+
   // For handling a section that does exist, it depends on the section type:
   // - For frame capture, then we just write to a new file since we want it
   //   to be first. Once the writing is done, copy across any other sections
@@ -1193,7 +1336,7 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
                                 // sectionVersion
                                 props.version,
                                 // sectionFlags
-                                props.flags,
+                                flags,
                                 // sectionNameLength
                                 uint32_t(name.length() + 1)};
 
@@ -1214,23 +1357,41 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
 
   StreamWriter *compWriter = NULL;
 
-  if(props.flags & SectionFlags::LZ4Compressed)
+  // we don't know how large a section will be until it's written, but only the frame capture is
+  // expected to be large enough to be worth compressing in parallel. While capturing nothing else
+  // uses the job system, so it's started for as long as the frame capture is being written
+  bool ownsJobSystem = false;
+  if(type == SectionType::FrameCapture && (flags & (SectionFlags::LZ4Compressed |
+                                                    SectionFlags::ZstdCompressed)) &&
+     !Threading::JobSystem::IsAvailable())
+    ownsJobSystem = Threading::JobSystem::TryInit(BlockWorkerPool::DefaultThreadCount());
+
+  const uint32_t compressThreads =
+      UseParallelCompression(type == SectionType::FrameCapture ? ~0ULL : 0)
+          ? BlockWorkerPool::DefaultThreadCount()
+          : 0;
+
+  Compressor *compressor = NULL;
+
+  if(flags & SectionFlags::LZ4Compressed)
+    compressor = new LZ4Compressor(fileWriter, Ownership::Stream, compressThreads);
+  else if(flags & SectionFlags::ZstdCompressed)
+    compressor = new ZSTDCompressor(fileWriter, Ownership::Stream, compressThreads);
+
+  if(compressor)
   {
+    compressor->EnableSeekTable();
+
     // the user will delete the compressed writer, and then it will delete the compressor and the
     // file writer
-    compWriter =
-        new StreamWriter(new LZ4Compressor(fileWriter, Ownership::Stream), Ownership::Stream);
-  }
-  else if(props.flags & SectionFlags::ZstdCompressed)
-  {
-    compWriter =
-        new StreamWriter(new ZSTDCompressor(fileWriter, Ownership::Stream), Ownership::Stream);
+    compWriter = new StreamWriter(compressor, Ownership::Stream);
   }
 
   uint64_t dataOffset = FileIO::ftell64(m_File);
 
   m_CurrentWritingProps = props;
   m_CurrentWritingProps.name = name;
+  m_CurrentWritingProps.flags = flags;
 
   // register a destroy callback to tidy up the section at the end
   fileWriter->AddCloseCallback([this, type, name, headerOffset, dataOffset, fileWriter, compWriter]() {
@@ -1278,6 +1439,10 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
   if(modifySectionCallback)
     fileWriter->AddCloseCallback(modifySectionCallback);
 
+  // the compressor has finished with its jobs by the time the file writer is closed
+  if(ownsJobSystem)
+    fileWriter->AddCloseCallback([]() { Threading::JobSystem::Shutdown(); });
+
   // finally once we're done, re-open the file as read-only again
   fileWriter->AddCloseCallback([this]() {
     // remember our position and close the file
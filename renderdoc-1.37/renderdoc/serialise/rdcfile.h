@@ -121,7 +121,19 @@ private:
     uint64_t diskLength;
   };
 
+  bool ReadSeekTable(const SectionLocation &loc, uint64_t &blockSize,
+                     rdcarray<uint64_t> &blockOffsets) const;
+
+  void ReleaseUnusedMappings() const;
+  void DetachMappings();
+
   rdcarray<SectionProperties> m_Sections;
   rdcarray<SectionLocation> m_SectionLocations;
   rdcarray<bytebuf> m_MemorySections;
+
+  // mappings of sections that have been read, with a reference held so that they can be detached
+  // from the file before it's modified, if readers are still using them. Sections can be read from
+  // several threads at once, so this is only accessed with m_MappingsLock held
+  mutable rdcarray<FileMapping *> m_Mappings;
+  mutable Threading::CriticalSection m_MappingsLock;
 };
@@ -1095,6 +1095,45 @@ Chunk *Chunk::Create(Serialiser<SerialiserMode::Writing> &ser, uint16_t chunkTyp
   return ret;
 }
 
+Chunk *Chunk::Duplicate(ChunkAllocator *allocator)
+{
+  byte *data = NULL;
+
+  if(allocator)
+  {
+    data = allocator->AllocAlignedBuffer(m_Length);
+
+    if(!data)
+      allocator = NULL;
+  }
+
+  if(!allocator)
+    data = AllocAlignedBuffer(m_Length);
+
+  memcpy(data, m_Data, (size_t)m_Length);
+
+  Chunk *ret = NULL;
+
+  if(allocator)
+    ret = new(allocator->AllocChunk()) Chunk(true);
+  else
+    ret = new Chunk(false);
+
+  ret->m_Length = m_Length;
+  ret->m_ChunkType = m_ChunkType;
+  ret->m_Data = data;
+
+  if(allocator == NULL)
+  {
+#if ENABLED(RDOC_DEVEL)
+    Atomic::Inc64(&m_LiveChunks);
+    Atomic::ExchAdd64(&m_TotalMem, int64_t(m_Length));
+#endif
+  }
+
+  return ret;
+}
+
 ChunkPagePool::~ChunkPagePool()
 {
   // all allocated pages are in precisely one list, so just free the contents of both lists
@@ -1113,6 +1152,8 @@ ChunkPagePool::~ChunkPagePool()
 
 ChunkPage ChunkPagePool::AllocPage()
 {
+  SCOPED_LOCK(m_Lock);
+
   if(!freePages.empty())
   {
     // if there's a free page, move it to the allocated list and return it
@@ -1133,6 +1174,8 @@ ChunkPage ChunkPagePool::AllocPage()
 
 void ChunkPagePool::Trim()
 {
+  SCOPED_LOCK(m_Lock);
+
   // truly release any currently free pages back to the system
   for(ChunkPage &p : freePages)
   {
@@ -1145,6 +1188,8 @@ void ChunkPagePool::Trim()
 
 void ChunkPagePool::Reset()
 {
+  SCOPED_LOCK(m_Lock);
+
   // forcibly move all allocated pages into the free list
   freePages.append(allocatedPages);
   allocatedPages.clear();
@@ -1162,6 +1207,8 @@ void ChunkPagePool::Reset()
 
 void ChunkPagePool::ResetPageSet(const rdcarray<ChunkPage> &pages)
 {
+  SCOPED_LOCK(m_Lock);
+
   // iterate over each page being freed
   for(const ChunkPage &p : pages)
   {
@@ -1187,6 +1234,17 @@ void ChunkPagePool::ResetPageSet(const rdcarray<ChunkPage> &pages)
   }
 }
 
+ChunkPagePool::Stats ChunkPagePool::GetStats()
+{
+  SCOPED_LOCK(m_Lock);
+
+  Stats ret;
+  ret.pagesInUse = allocatedPages.size();
+  ret.pagesFree = freePages.size();
+  ret.bytesReserved = (ret.pagesInUse + ret.pagesFree) * (BufferPageSize + ChunkPageSize);
+  return ret;
+}
+
 ChunkAllocator::~ChunkAllocator()
 {
   // move any pages we have back to the pool on destruction
@@ -1206,12 +1264,19 @@ void ChunkAllocator::swap(ChunkAllocator &alloc)
   }
 
   pages.swap(alloc.pages);
+  std::swap(m_BytesAllocated, alloc.m_BytesAllocated);
+  std::swap(m_BytesWasted, alloc.m_BytesWasted);
+  std::swap(m_OversizedAllocs, alloc.m_OversizedAllocs);
 }
 
 byte *ChunkAllocator::AllocAlignedBuffer(uint64_t size)
 {
   // always allocate 64-bytes at a time even if the size is smaller
-  return AllocateFromPages(false, AlignUp((size_t)size, (size_t)64));
+  size_t alignedSize = AlignUp((size_t)size, (size_t)64);
+  byte *ret = AllocateFromPages(false, alignedSize);
+  if(ret)
+    m_BytesWasted += alignedSize - size;
+  return ret;
 }
 
 byte *ChunkAllocator::AllocChunk()
@@ -1224,6 +1289,18 @@ void ChunkAllocator::Reset()
 {
   m_Pool.ResetPageSet(pages);
   pages.clear();
+
+  m_BytesAllocated = m_BytesWasted = 0;
+}
+
+ChunkAllocator::Stats ChunkAllocator::GetStats() const
+{
+  Stats ret;
+  ret.pagesInUse = pages.size();
+  ret.bytesAllocated = m_BytesAllocated;
+  ret.bytesWasted = m_BytesWasted;
+  ret.oversizedAllocs = m_OversizedAllocs;
+  return ret;
 }
 
 byte *ChunkAllocator::AllocateFromPages(bool chunkAlloc, size_t size)
@@ -1231,12 +1308,23 @@ byte *ChunkAllocator::AllocateFromPages(bool chunkAlloc, size_t size)
   // if the size can't be satisfied in a page, return NULL and we'll force a full allocation which
   // will be freed on its own
   if(size > m_Pool.GetBufferPageSize())
+  {
+    m_OversizedAllocs++;
     return NULL;
+  }
 
   // if we don't have a current page, or it can't satisfy the allocation, get a new page from the
   // pool
   if(pages.empty() || GetRemainingBytes(chunkAlloc, pages.back()) < size)
+  {
+    // whatever is left in the current page will never be used
+    if(!pages.empty())
+      m_BytesWasted += GetRemainingBufferBytes(pages.back()) + GetRemainingChunkBytes(pages.back());
+
     pages.push_back(m_Pool.AllocPage());
+  }
+
+  m_BytesAllocated += size;
 
   ChunkPage &p = pages.back();
 
@@ -1255,3 +1343,69 @@ byte *ChunkAllocator::AllocateFromPages(bool chunkAlloc, size_t size)
 
   return ret;
 }
+
+ThreadChunkAllocators::ThreadChunkAllocators(size_t PageSize) : m_Pool(PageSize)
+{
+  m_TLSSlot = Threading::AllocateTLSSlot();
+}
+
+ThreadChunkAllocators::~ThreadChunkAllocators()
+{
+  for(ChunkAllocator *alloc : m_Allocators)
+    delete alloc;
+
+  Threading::FreeTLSSlot(m_TLSSlot);
+}
+
+ChunkAllocator *ThreadChunkAllocators::Get()
+{
+  ChunkAllocator *alloc = (ChunkAllocator *)Threading::GetTLSValue(m_TLSSlot);
+  if(alloc)
+    return alloc;
+
+  // slow path, once per thread
+  alloc = new ChunkAllocator(m_Pool);
+
+  Threading::SetTLSValue(m_TLSSlot, (void *)alloc);
+
+  {
+    SCOPED_LOCK(m_Lock);
+    m_Allocators.push_back(alloc);
+  }
+
+  return alloc;
+}
+
+void ThreadChunkAllocators::Reset(bool trim)
+{
+  SCOPED_LOCK(m_Lock);
+
+  for(ChunkAllocator *alloc : m_Allocators)
+    alloc->Reset();
+
+  if(trim)
+    m_Pool.Trim();
+}
+
+ThreadChunkAllocators::Stats ThreadChunkAllocators::GetStats()
+{
+  SCOPED_LOCK(m_Lock);
+
+  ChunkPagePool::Stats poolStats = m_Pool.GetStats();
+
+  Stats ret = {};
+  ret.threads = m_Allocators.size();
+  ret.pagesInUse = poolStats.pagesInUse;
+  ret.pagesFree = poolStats.pagesFree;
+  ret.bytesReserved = poolStats.bytesReserved;
+
+  for(ChunkAllocator *alloc : m_Allocators)
+  {
+    ChunkAllocator::Stats allocStats = alloc->GetStats();
+    ret.bytesAllocated += allocStats.bytesAllocated;
+    ret.bytesWasted += allocStats.bytesWasted;
+    ret.oversizedAllocs += allocStats.oversizedAllocs;
+  }
+
+  return ret;
+}
@@ -1089,8 +1089,6 @@ public:
       m_InternalElement--;
     }
 
-    size_t byteSize = (size_t)totalSize;
-
     byte *structBuf = NULL;
 
     if(ExportStructure())
@@ -1138,7 +1136,9 @@ public:
       if(totalSize % (uint64_t)bufSize > 0)
         numBufs++;
 
-      byte *buf = new byte[byteSize];
+      // if the data is in memory (including mapped files) we can write it straight out of the
+      // reader, otherwise read via a chunk-sized temporary buffer
+      byte *buf = NULL;
 
       if(progress)
         progress(0.0001f);
@@ -1147,12 +1147,21 @@ public:
       {
         uint64_t payloadLength = RDCMIN(bufSize, totalSize);
 
-        m_Read->Read(buf, payloadLength);
-        stream.Write(buf, payloadLength);
+        const byte *src = m_Read->ReadInPlace(payloadLength);
+        if(src == NULL)
+        {
+          if(buf == NULL)
+            buf = new byte[(size_t)bufSize];
+
+          m_Read->Read(buf, payloadLength);
+          src = buf;
+        }
+
+        stream.Write(src, payloadLength);
 
         if(structBuf)
         {
-          memcpy(structBuf, buf, (size_t)payloadLength);
+          memcpy(structBuf, src, (size_t)payloadLength);
           structBuf += payloadLength;
         }
 
@@ -1827,6 +1836,18 @@ public:
   // reset a page set, other pages will remain in use
   void ResetPageSet(const rdcarray<ChunkPage> &pages);
 
+  struct Stats
+  {
+    // number of pages currently handed out to allocators
+    uint64_t pagesInUse;
+    // number of pages allocated but free for re-use
+    uint64_t pagesFree;
+    // total memory held by the pool, in use or not
+    uint64_t bytesReserved;
+  };
+
+  Stats GetStats();
+
   size_t GetBufferPageSize() { return BufferPageSize; }
   size_t GetChunkPageSize() { return ChunkPageSize; }
 private:
@@ -1835,6 +1856,10 @@ private:
 
   size_t m_ID = 1;
 
+  // allocators pulling from the same pool may be on different threads, they lock here only when
+  // fetching or returning whole pages.
+  Threading::CriticalSection m_Lock;
+
   // a page is in precisely ONE of these arrays at any time.
   // Reset() will move all allocated pages back to free pages and reclaim all that memory
   // ResetPageSet() will move any referenced pages from allocatedPages back to freePages
@@ -1862,6 +1887,20 @@ public:
 
   void Reset();
 
+  struct Stats
+  {
+    // number of pages held by this allocator
+    uint64_t pagesInUse;
+    // bytes handed out for chunks and their data
+    uint64_t bytesAllocated;
+    // bytes lost to alignment padding and to the unused tails of pages that were retired
+    uint64_t bytesWasted;
+    // allocations too large for a page, which had to be allocated externally
+    uint64_t oversizedAllocs;
+  };
+
+  Stats GetStats() const;
+
 private:
   ChunkPagePool &m_Pool;
 
@@ -1869,6 +1908,10 @@ private:
   // currently allocating from.
   rdcarray<ChunkPage> pages;
 
+  uint64_t m_BytesAllocated = 0;
+  uint64_t m_BytesWasted = 0;
+  uint64_t m_OversizedAllocs = 0;
+
   // given a page and the known page size, how much is left
   inline size_t GetRemainingBufferBytes(const ChunkPage &p)
   {
@@ -1886,6 +1929,48 @@ private:
   byte *AllocateFromPages(bool chunkAlloc, size_t size);
 };
 
+// this is a set of allocators sharing one pool, one for each thread that records. This is used for
+// chunks recorded on many application threads that all share the same lifetime - e.g. those
+// recorded for a frame capture and thrown away at the end of the frame. Each thread allocates from
+// its own allocator without any locking except to fetch a new page, and all allocators are reset
+// together. The caller must ensure no thread is allocating while the allocators are reset.
+class ThreadChunkAllocators
+{
+public:
+  ThreadChunkAllocators(size_t PageSize);
+  ThreadChunkAllocators(const ThreadChunkAllocators &) = delete;
+  ThreadChunkAllocators(ThreadChunkAllocators &&) = delete;
+  ThreadChunkAllocators &operator=(const ThreadChunkAllocators &) = delete;
+  ~ThreadChunkAllocators();
+
+  // get the current thread's allocator
+  ChunkAllocator *Get();
+
+  // reset every thread's allocator, returning all pages to the pool. If trim is true the pages are
+  // then freed as well.
+  void Reset(bool trim);
+
+  struct Stats
+  {
+    uint64_t threads;
+    uint64_t pagesInUse;
+    uint64_t pagesFree;
+    uint64_t bytesReserved;
+    uint64_t bytesAllocated;
+    uint64_t bytesWasted;
+    uint64_t oversizedAllocs;
+  };
+
+  Stats GetStats();
+
+private:
+  ChunkPagePool m_Pool;
+  uint64_t m_TLSSlot;
+
+  Threading::CriticalSection m_Lock;
+  rdcarray<ChunkAllocator *> m_Allocators;
+};
+
 // holds the memory, length and type for a given chunk, so that it can be
 // passed around and moved between owners before being serialised out
 class Chunk
@@ -1928,24 +2013,9 @@ public:
                        ChunkAllocator *allocator = NULL, bool stealDataFromWriter = false);
 
   byte *GetData() const { return m_Data; }
-  Chunk *Duplicate()
-  {
-    Chunk *ret = new Chunk();
-    ret->m_Length = m_Length;
-    ret->m_ChunkType = m_ChunkType;
-
-    ret->m_Data = AllocAlignedBuffer(m_Length);
-    ret->m_FromAllocator = false;
-
-    memcpy(ret->m_Data, m_Data, (size_t)m_Length);
-
-#if ENABLED(RDOC_DEVEL)
-    Atomic::Inc64(&m_LiveChunks);
-    Atomic::ExchAdd64(&m_TotalMem, int64_t(m_Length));
-#endif
-
-    return ret;
-  }
+  // copy this chunk, optionally into an allocator. The same rules apply as for Create() - both the
+  // chunk and its data come from the allocator or neither does.
+  Chunk *Duplicate(ChunkAllocator *allocator = NULL);
 
   void Write(Serialiser<SerialiserMode::Writing> &ser)
   {
@@ -26,6 +26,8 @@
 
 #if ENABLED(ENABLE_UNIT_TESTS)
 
+#include "common/timing.h"
+
 #include "catch/catch.hpp"
 
 void WriteAllBasicTypes(WriteSerialiser &ser)
@@ -840,6 +842,209 @@ TEST_CASE("Verify multiple chunks can be merged", "[serialiser][chunks]")
   delete buf;
 };
 
+TEST_CASE("Allocate chunks from per-thread allocators", "[serialiser][chunks]")
+{
+  enum ChunkType
+  {
+    SMALL = 5,
+    LARGE,
+  };
+
+  const size_t pageSize = 4096;
+
+  ThreadChunkAllocators allocs(pageSize);
+
+  const uint32_t numThreads = 4;
+  const uint32_t chunksPerThread = 200;
+
+  rdcarray<Chunk *> chunks[numThreads];
+
+  rdcarray<Threading::ThreadHandle> threads;
+  for(uint32_t t = 0; t < numThreads; t++)
+  {
+    threads.push_back(Threading::CreateThread([t, &allocs, &chunks]() {
+      WriteSerialiser ser(new StreamWriter(StreamWriter::DefaultScratchSize), Ownership::Stream);
+
+      ChunkAllocator *alloc = allocs.Get();
+
+      // the same thread always gets the same allocator
+      CHECK(alloc == allocs.Get());
+
+      for(uint32_t i = 0; i < chunksPerThread; i++)
+      {
+        SCOPED_SERIALISE_CHUNK(SMALL);
+
+        uint32_t thread = t;
+        uint32_t idx = i;
+
+        SERIALISE_ELEMENT(thread);
+        SERIALISE_ELEMENT(idx);
+
+        chunks[t].push_back(scope.Get(alloc));
+      }
+
+      // one chunk too large for a page, which is allocated externally
+      {
+        SCOPED_SERIALISE_CHUNK(LARGE);
+
+        bytebuf data;
+        data.resize(pageSize * 2);
+
+        SERIALISE_ELEMENT(data);
+
+        chunks[t].push_back(scope.Get(alloc));
+      }
+    }));
+  }
+
+  for(Threading::ThreadHandle th : threads)
+  {
+    Threading::JoinThread(th);
+    Threading::CloseThread(th);
+  }
+
+  ThreadChunkAllocators::Stats stats = allocs.GetStats();
+
+  CHECK(stats.threads == numThreads);
+  CHECK(stats.pagesInUse >= numThreads);
+  CHECK(stats.pagesFree == 0);
+  CHECK(stats.bytesAllocated > 0);
+  CHECK(stats.bytesWasted > 0);
+  CHECK(stats.oversizedAllocs == numThreads);
+
+  for(uint32_t t = 0; t < numThreads; t++)
+  {
+    REQUIRE(chunks[t].size() == chunksPerThread + 1);
+
+    for(uint32_t i = 0; i < chunksPerThread; i++)
+    {
+      CHECK(chunks[t][i]->IsFromAllocator());
+      CHECK(chunks[t][i]->GetChunkType<uint32_t>() == (uint32_t)SMALL);
+    }
+
+    CHECK_FALSE(chunks[t].back()->IsFromAllocator());
+    CHECK(chunks[t].back()->GetChunkType<uint32_t>() == (uint32_t)LARGE);
+
+    // duplicating into an allocator gives an identical chunk from that allocator
+    Chunk *dup = chunks[t][10]->Duplicate(allocs.Get());
+    CHECK(dup->IsFromAllocator());
+    CHECK(dup->GetChunkType<uint32_t>() == (uint32_t)SMALL);
+    CHECK(memcmp(dup->GetData(), chunks[t][10]->GetData(), 16) == 0);
+    dup->Delete();
+  }
+
+  // check the contents survived all the interleaved allocation
+  for(uint32_t t = 0; t < numThreads; t++)
+  {
+    StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+    {
+      WriteSerialiser ser(buf, Ownership::Nothing);
+      for(uint32_t i = 0; i < chunksPerThread; i++)
+        chunks[t][i]->Write(ser);
+    }
+
+    ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+
+    for(uint32_t i = 0; i < chunksPerThread; i++)
+    {
+      CHECK(ser.ReadChunk<uint32_t>() == (uint32_t)SMALL);
+
+      uint32_t thread = ~0U;
+      uint32_t idx = ~0U;
+
+      SERIALISE_ELEMENT(thread);
+      SERIALISE_ELEMENT(idx);
+
+      CHECK(thread == t);
+      CHECK(idx == i);
+
+      ser.EndChunk();
+    }
+
+    delete buf;
+  }
+
+  for(uint32_t t = 0; t < numThreads; t++)
+    for(Chunk *c : chunks[t])
+      c->Delete();
+
+  allocs.Reset(false);
+
+  stats = allocs.GetStats();
+
+  CHECK(stats.pagesInUse == 0);
+  CHECK(stats.pagesFree > 0);
+  CHECK(stats.bytesAllocated == 0);
+
+  allocs.Reset(true);
+
+  stats = allocs.GetStats();
+
+  CHECK(stats.pagesFree == 0);
+  CHECK(stats.bytesReserved == 0);
+};
+
+TEST_CASE("Recreate per-thread chunk allocators", "[serialiser][chunks]")
+{
+  // the TLS slot is freed with the allocators and reused, so a later set must not see the
+  // allocator this thread had in the old one
+  for(int i = 0; i < 4; i++)
+  {
+    ThreadChunkAllocators allocs(4096);
+
+    CHECK(allocs.GetStats().threads == 0);
+
+    ChunkAllocator *alloc = allocs.Get();
+    CHECK(alloc == allocs.Get());
+    CHECK(allocs.GetStats().threads == 1);
+  }
+};
+
+TEST_CASE("Benchmark chunk allocation", "[serialiser][chunks][!benchmark]")
+{
+  const uint32_t numChunks = 1000000;
+
+  WriteSerialiser ser(new StreamWriter(StreamWriter::DefaultScratchSize), Ownership::Stream);
+
+  ThreadChunkAllocators allocs(256 * 1024);
+
+  rdcarray<Chunk *> chunks;
+  chunks.reserve(numChunks);
+
+  double ms[2] = {};
+
+  for(int arena = 0; arena < 2; arena++)
+  {
+    PerformanceTimer timer;
+
+    for(uint32_t i = 0; i < numChunks; i++)
+    {
+      SCOPED_SERIALISE_CHUNK(1);
+
+      uint64_t a = i, b = i * 3, c = i * 7;
+
+      SERIALISE_ELEMENT(a);
+      SERIALISE_ELEMENT(b);
+      SERIALISE_ELEMENT(c);
+
+      chunks.push_back(scope.Get(arena ? allocs.Get() : NULL));
+    }
+
+    for(Chunk *c : chunks)
+      c->Delete();
+    chunks.clear();
+
+    if(arena)
+      allocs.Reset(false);
+
+    ms[arena] = timer.GetMilliseconds();
+  }
+
+  RDCLOG("%u small chunks created and deleted: heap %.1f ms, per-thread arena %.1f ms", numChunks,
+         ms[0], ms[1]);
+};
+
 TEST_CASE("Read/write container types", "[serialiser][structured]")
 {
   StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
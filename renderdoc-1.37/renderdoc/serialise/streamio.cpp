@@ -33,6 +33,27 @@ Compressor::~Compressor()
     delete m_Write;
 }
 
+bool Compressor::WriteSeekTable(uint64_t blockSize)
+{
+  if(!m_WriteSeekTable)
+    return true;
+
+  SeekTableFooter footer;
+  footer.magic = SeekTableFooter::MAGIC;
+  footer.blockSize = (uint32_t)blockSize;
+  footer.numBlocks = m_BlockOffsets.size();
+
+  bool success = true;
+
+  success &= m_Write->Write(m_BlockOffsets.data(), m_BlockOffsets.byteSize());
+  success &= m_Write->Write(footer);
+
+  if(!success)
+    m_Error = m_Write->GetError();
+
+  return success;
+}
+
 Decompressor::~Decompressor()
 {
   if(m_Ownership == Ownership::Stream && m_Read)
@@ -170,14 +191,76 @@ StreamReader::StreamReader(FILE *file)
   m_Ownership = Ownership::Stream;
 }
 
+StreamReader::StreamReader(StreamMappedType, FILE *file, uint64_t offset, uint64_t size)
+{
+  if(file == NULL)
+  {
+    SET_ERROR_RESULT(m_Error, ResultCode::InvalidParameter,
+                     "Stream created with invalid file handle");
+    m_InputSize = 0;
+
+    m_BufferSize = 0;
+    m_BufferHead = m_BufferBase = NULL;
+
+    m_Ownership = Ownership::Nothing;
+    return;
+  }
+
+  m_Ownership = Ownership::Nothing;
+
+  const byte *data = FileIO::MapFileRange(file, offset, size);
+
+  if(data == NULL)
+  {
+    if(size > 0)
+      RDCWARN("Couldn't map %llu bytes of file, falling back to reading", size);
+
+    FileIO::fseek64(file, offset, SEEK_SET);
+
+    m_File = file;
+    m_InputSize = size;
+
+    m_BufferSize = initialBufferSize;
+    m_BufferHead = m_BufferBase = AllocAlignedBuffer(m_BufferSize);
+
+    ReadFromExternal(m_BufferBase, RDCMIN(m_InputSize, m_BufferSize));
+    return;
+  }
+
+  m_Mapping = new FileMapping;
+  m_Mapping->data = data;
+  m_Mapping->size = size;
+  m_Mapping->refcount = 1;
+
+  // the mapping is read-only, but in-memory readers never write to their buffer
+  m_InputSize = m_BufferSize = size;
+  m_BufferHead = m_BufferBase = (byte *)data;
+}
+
 StreamReader::StreamReader(StreamReader *reader, uint64_t bufferSize)
 {
+  m_Ownership = Ownership::Nothing;
+
+  // if the parent is mapped, share its mapping instead of copying the data
+  if(reader->m_Mapping)
+  {
+    const byte *data = reader->ReadInPlace(bufferSize);
+
+    if(data)
+    {
+      m_Mapping = reader->m_Mapping;
+      m_Mapping->AddRef();
+
+      m_InputSize = m_BufferSize = bufferSize;
+      m_BufferHead = m_BufferBase = (byte *)data;
+      return;
+    }
+  }
+
   m_InputSize = m_BufferSize = bufferSize;
   m_BufferHead = m_BufferBase = AllocAlignedBuffer(m_BufferSize);
 
   reader->Read(m_BufferBase, bufferSize);
-
-  m_Ownership = Ownership::Nothing;
 }
 
 StreamReader::StreamReader(Decompressor *decompressor, uint64_t uncompressedSize, Ownership own)
@@ -198,7 +281,10 @@ StreamReader::~StreamReader()
   for(StreamCloseCallback cb : m_Callbacks)
     cb();
 
-  FreeAlignedBuffer(m_BufferBase);
+  if(m_Mapping)
+    m_Mapping->Release();
+  else
+    FreeAlignedBuffer(m_BufferBase);
 
   if(m_Ownership == Ownership::Stream)
   {
@@ -493,6 +579,11 @@ bool StreamReader::ReadFromExternal(void *buffer, uint64_t length)
   return success;
 }
 
+static int64_t AtomicLoad64(int64_t *val)
+{
+  return Atomic::CmpExch64(val, 0, 0);
+}
+
 FileWriter *FileWriter::MakeDefault(FILE *file, Ownership own)
 {
   if(file == NULL)
@@ -502,14 +593,14 @@ FileWriter *FileWriter::MakeDefault(FILE *file, Ownership own)
   return ret;
 }
 
-FileWriter *FileWriter::MakeThreaded(FILE *file, Ownership own)
+FileWriter *FileWriter::MakeThreaded(FILE *file, Ownership own, uint64_t blockSize)
 {
   if(file == NULL)
     return NULL;
   FileWriter *ret = new FileWriter(file, own);
-  for(size_t i = 0; i < NumBlocks; i++)
-    ret->m_AllocBlocks[i] = {AllocAlignedBuffer(BlockSize), 0};
-  ret->m_ProducerOwned.append(ret->m_AllocBlocks, NumBlocks);
+  ret->m_BlockSize = RDCMAX(blockSize, (uint64_t)1024);
+  ret->m_RingSize = ret->m_BlockSize * NumBlocks;
+  ret->m_Ring = AllocAlignedBuffer(ret->m_RingSize);
   ret->m_ThreadRunning = 1;
   ret->m_Thread = Threading::CreateThread([ret]() { ret->ThreadEntry(); });
   return ret;
@@ -539,122 +630,125 @@ RDResult FileWriter::WriteUnthreaded(const void *data, uint64_t length)
 
 RDResult FileWriter::WriteThreaded(const void *data, uint64_t length)
 {
-  // if write fits in this block, memcpy and return. We allow this to completely fill a block, it
-  // will get flushed on the next write or Flush() call
-  if(!m_ProducerOwned.empty() && length <= BlockSize - m_ProducerOwned.back().second)
+  if(length == 0)
+    return GetError();
+
+  const int64_t ringSize = (int64_t)m_RingSize;
+
+  // claim our range of the output. This fixes where our data goes relative to other threads
+  int64_t start = AtomicLoad64(&m_ReservePos);
+  while(true)
   {
-    memcpy(m_ProducerOwned.back().first + m_ProducerOwned.back().second, data, (size_t)length);
-    m_ProducerOwned.back().second += length;
-    return ResultCode::Succeeded;
+    int64_t prev = Atomic::CmpExch64(&m_ReservePos, start, start + (int64_t)length);
+    if(prev == start)
+      break;
+    start = prev;
   }
 
-  RDResult ret;
+  const int64_t end = start + (int64_t)length;
+  const byte *src = (const byte *)data;
 
-  // write doesn't fit in the block (or we don't have one free)
+  // everything before copied is in the ring, everything before published is visible to the work
+  // thread. We can't publish until every earlier range has been published.
+  int64_t copied = start;
+  int64_t published = start;
 
-  // loop until all bytes are written
-  const byte *dataPtr = (byte *)data;
-  while(length > 0)
-  {
-    // blocks to submit, we'll have at least one
-    rdcarray<Block> pending;
+  bool ringFull = false, ordering = false;
 
-    // while we have free blocks that we own, and still bytes to write
-    while(length > 0 && !m_ProducerOwned.empty())
+  while(published < end)
+  {
+    // copy as much as we can into space in the ring that has been written out. If the write is
+    // larger than the ring we do this in pieces, publishing as we go so the ring can drain
+    const int64_t limit = RDCMIN(end, AtomicLoad64(&m_WrittenPos) + ringSize);
+    while(copied < limit)
     {
-      Block &curBlock = m_ProducerOwned.back();
-
-      // write either the rest of what will fit in the block, or the rest of the data, whatever is
-      // smaller
-      uint64_t writeSize = RDCMIN(length, BlockSize - curBlock.second);
-      memcpy(curBlock.first + curBlock.second, dataPtr, (size_t)writeSize);
-      curBlock.second += writeSize;
-      dataPtr += writeSize;
-      length -= writeSize;
-
-      // should not be possible with writeSize above being clamped
-      if(curBlock.second > BlockSize)
-      {
-        RDCERR("Block has been overrun");
-        // truncate writes to be safe
-        curBlock.second = BlockSize;
-        return ResultCode::InternalError;
-      }
+      const int64_t ringOffs = copied % ringSize;
+      const int64_t chunk = RDCMIN(limit - copied, ringSize - ringOffs);
+      memcpy(m_Ring + ringOffs, src + (copied - start), (size_t)chunk);
+      copied += chunk;
+    }
 
-      // if the block is completely full, push it to the consumer
-      if(curBlock.second == BlockSize)
+    if(copied > published)
+    {
+      // this only succeeds once all writes that started before us have published everything
+      if(Atomic::CmpExch64(&m_CommitPos, published, copied) == published)
       {
-        m_ProducerOwned.pop_back();
-        pending.push_back(curBlock);
+        published = copied;
+        continue;
       }
-    }
 
-    // we got here, either we ran out of blocks to write to (or more likely) we finished writing.
-    // now we push the pending list to the consumer and at the same time grab any blocks that have
-    // freed up. Hold the lock while modifying those block-passing lists
-    m_Lock.Lock();
-    if(!pending.empty())
-    {
-      m_PendingForConsumer.append(pending);
-      pending.clear();
+      // an earlier write is still copying. This should be brief so just yield
+      ordering = true;
+      Threading::Sleep(0);
     }
-    if(!m_CompletedFromConsumer.empty())
+    else
     {
-      m_ProducerOwned.insert(0, m_CompletedFromConsumer);
-      m_CompletedFromConsumer.clear();
+      // the ring is full, wait for the disk to catch up
+      ringFull = true;
+      Threading::Sleep(1);
     }
-    if(ret == ResultCode::Succeeded)
-      ret = m_Error;
-    m_Lock.Unlock();
-
-    // if we still have bytes to write and are waiting for blocks to free up, sleep here so we
-    // don't busy loop trying to get more blocks
-    if(length > 0)
-      Threading::Sleep(5);
   }
 
+  if(ringFull)
+    Atomic::Inc64(&m_StatRingFullWaits);
+  if(ordering)
+    Atomic::Inc64(&m_StatOrderingWaits);
+
+  return GetError();
+}
+
+RDResult FileWriter::GetError()
+{
+  if(Atomic::CmpExch32(&m_Errored, 0, 0) == 0)
+    return ResultCode::Succeeded;
+
+  m_Lock.Lock();
+  RDResult ret = m_Error;
+  m_Lock.Unlock();
   return ret;
 }
 
 void FileWriter::ThreadEntry()
 {
-  rdcarray<Block> completed;
-  RDResult error;
+  const int64_t ringSize = (int64_t)m_RingSize;
 
   int busyLoopCounter = 0;
 
+  // we are the only one to modify m_WrittenPos, so we can cache it
+  int64_t written = AtomicLoad64(&m_WrittenPos);
+
   // loop as long as the thread is not being killed
   while(Atomic::CmpExch32(&m_ThreadKill, 0, 0) == 0)
   {
-    Block work = {};
-
-    // hold the lock, take any new work and return any completed work
-    m_Lock.Lock();
-    m_ConsumerOwned.append(m_PendingForConsumer);
-    m_CompletedFromConsumer.append(completed);
-    m_PendingForConsumer.clear();
-    completed.clear();
-    // don't overwrite an old error, but update if there's a new error
-    if(m_Error == ResultCode::Succeeded && error != ResultCode::Succeeded)
-      m_Error = error;
-    m_Lock.Unlock();
-
-    // grab work to do if we can
-    if(!m_ConsumerOwned.empty())
-    {
-      work = m_ConsumerOwned[0];
-      m_ConsumerOwned.erase(0);
-      busyLoopCounter = 0;
-    }
+    const int64_t available = AtomicLoad64(&m_CommitPos) - written;
 
-    if(work.second)
+    // write whole blocks as soon as they're ready, and anything at all while we're flushing
+    if(available >= (int64_t)m_BlockSize || (available > 0 && AtomicLoad64(&m_FlushPos) > written))
     {
-      RDResult res = WriteUnthreaded(work.first, work.second);
-      if(error == ResultCode::Succeeded)
-        error = res;
+      // write up to the end of the ring, anything after it wraps around and will be written next
+      const int64_t ringOffs = written % ringSize;
+      const int64_t chunk = RDCMIN(available, ringSize - ringOffs);
+
+      RDResult res = WriteUnthreaded(m_Ring + ringOffs, chunk);
+
+      // don't overwrite an old error, but update if there's a new error
+      if(res != ResultCode::Succeeded && Atomic::CmpExch32(&m_Errored, 0, 0) == 0)
+      {
+        m_Lock.Lock();
+        m_Error = res;
+        m_Lock.Unlock();
+        Atomic::CmpExch32(&m_Errored, 0, 1);
+      }
+
+      // release the space back to the producers
+      Atomic::CmpExch64(&m_WrittenPos, written, written + chunk);
+      written += chunk;
 
-      // reset the offset/size to 0 when returning it
-      completed.push_back({work.first, 0});
+      Atomic::ExchAdd64(&m_StatBytesWritten, chunk);
+      Atomic::Inc64(&m_StatFileWrites);
+
+      busyLoopCounter = 0;
+      continue;
     }
 
     // after a certain number of loops without any work start to do small sleeps to break up the
@@ -668,37 +762,24 @@ void FileWriter::ThreadEntry()
 
 RDResult FileWriter::Flush()
 {
-  // if we have some writes, push these now even with a partial block
-  if(!m_ProducerOwned.empty() && m_ProducerOwned.back().second > 0)
-  {
-    Block b = m_ProducerOwned.back();
-    m_ProducerOwned.pop_back();
-
-    // hold the lock so we can push this incomplete block through
-    m_Lock.Lock();
-    m_PendingForConsumer.push_back(b);
-    m_Lock.Unlock();
-
-    // all other blocks should be empty
-    for(Block &owned : m_ProducerOwned)
-      RDCASSERTEQUAL(owned.second, 0);
-  }
-
-  // loop as long as the thread is alive. Flushing is rare so we don't mind sleeping here
-  // if we're unthreaded this loop just won't execute
-  while(Atomic::CmpExch32(&m_ThreadRunning, 1, 1) > 0)
+  if(m_Thread)
   {
-    m_Lock.Lock();
-    // take ownership of any blocks due to us
-    m_ProducerOwned.insert(0, m_CompletedFromConsumer);
-    m_CompletedFromConsumer.clear();
-    m_Lock.Unlock();
+    // all our writes have returned, so they've been published
+    const int64_t target = AtomicLoad64(&m_CommitPos);
 
-    // if we own all the blocks again, we're done
-    if(m_ProducerOwned.size() == NumBlocks)
-      break;
+    // ask the work thread to write out partial blocks up to there
+    int64_t flushPos = AtomicLoad64(&m_FlushPos);
+    while(flushPos < target)
+    {
+      int64_t prev = Atomic::CmpExch64(&m_FlushPos, flushPos, target);
+      if(prev == flushPos)
+        break;
+      flushPos = prev;
+    }
 
-    Threading::Sleep(1);
+    // loop as long as the thread is alive. Flushing is rare so we don't mind sleeping here
+    while(Atomic::CmpExch32(&m_ThreadRunning, 1, 1) > 0 && AtomicLoad64(&m_WrittenPos) < target)
+      Threading::Sleep(1);
   }
 
   RDResult ret;
@@ -710,6 +791,7 @@ RDResult FileWriter::Flush()
   {
     SET_ERROR_RESULT(m_Error, ResultCode::FileIOFailed, "File flushing failed: %s",
                      FileIO::ErrorString().c_str());
+    Atomic::CmpExch32(&m_Errored, 0, 1);
   }
   ret = m_Error;
   m_Lock.Unlock();
@@ -717,6 +799,16 @@ RDResult FileWriter::Flush()
   return ret;
 }
 
+FileWriter::Stats FileWriter::GetStats()
+{
+  Stats ret;
+  ret.bytesWritten = (uint64_t)AtomicLoad64(&m_StatBytesWritten);
+  ret.fileWrites = (uint64_t)AtomicLoad64(&m_StatFileWrites);
+  ret.ringFullWaits = (uint64_t)AtomicLoad64(&m_StatRingFullWaits);
+  ret.orderingWaits = (uint64_t)AtomicLoad64(&m_StatOrderingWaits);
+  return ret;
+}
+
 FileWriter::~FileWriter()
 {
   if(m_Thread)
@@ -731,8 +823,7 @@ FileWriter::~FileWriter()
     Threading::CloseThread(m_Thread);
     m_Thread = 0;
 
-    for(size_t i = 0; i < NumBlocks; i++)
-      FreeAlignedBuffer(m_AllocBlocks[i].first);
+    FreeAlignedBuffer(m_Ring);
   }
 
   if(m_Ownership == Ownership::Stream)
@@ -939,7 +1030,8 @@ void StreamTransfer(StreamWriter *writer, StreamReader *reader, RENDERDOC_Progre
   if(totalSize % (uint64_t)bufSize > 0)
     numBufs++;
 
-  byte *buf = new byte[(size_t)bufSize];
+  // only needed if the reader isn't entirely in memory
+  byte *buf = NULL;
 
   if(progress)
     progress(0.0001f);
@@ -948,8 +1040,17 @@ void StreamTransfer(StreamWriter *writer, StreamReader *reader, RENDERDOC_Progre
   {
     uint64_t payloadLength = RDCMIN(bufSize, totalSize);
 
-    reader->Read(buf, payloadLength);
-    writer->Write(buf, payloadLength);
+    const byte *src = reader->ReadInPlace(payloadLength);
+    if(src == NULL)
+    {
+      if(buf == NULL)
+        buf = new byte[(size_t)bufSize];
+
+      reader->Read(buf, payloadLength);
+      src = buf;
+    }
+
+    writer->Write(src, payloadLength);
 
     totalSize -= payloadLength;
     if(progress)
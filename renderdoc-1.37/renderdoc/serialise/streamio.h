@@ -43,6 +43,38 @@ class StreamReader;
 
 typedef std::function<void()> StreamCloseCallback;
 
+// a read-only view of part of a file, shared between a mapped reader and any sub-readers created
+// from it, and the RDCFile that created it. The last reference to be released unmaps it.
+struct FileMapping
+{
+  const byte *data;
+  uint64_t size;
+  int32_t refcount;
+
+  void AddRef() { Atomic::Inc32(&refcount); }
+  void Release()
+  {
+    if(Atomic::Dec32(&refcount) == 0)
+    {
+      FileIO::UnmapFileRange(data, size);
+      delete this;
+    }
+  }
+};
+
+// Optionally appended after the compressed blocks of a stream, preceded by numBlocks uint64_t
+// offsets giving where each block starts in the compressed data. Since every block except the last
+// decompresses to exactly blockSize bytes, this lets a reader seek directly to the block containing
+// any uncompressed offset - as long as the blocks are independent.
+struct SeekTableFooter
+{
+  static const uint32_t MAGIC = MAKE_FOURCC('R', 'D', 'S', 'K');
+
+  uint32_t magic;
+  uint32_t blockSize;
+  uint64_t numBlocks;
+};
+
 class Compressor
 {
 public:
@@ -52,10 +84,19 @@ public:
   virtual bool Write(const void *data, uint64_t numBytes) = 0;
   virtual bool Finish() = 0;
 
+  // if enabled, Finish() appends a seek table after the compressed blocks. See SeekTableFooter
+  void EnableSeekTable() { m_WriteSeekTable = true; }
+
 protected:
+  bool WriteSeekTable(uint64_t blockSize);
+
   StreamWriter *m_Write;
   Ownership m_Ownership;
   RDResult m_Error;
+
+  // the offset in m_Write of each block that has been written
+  rdcarray<uint64_t> m_BlockOffsets;
+  bool m_WriteSeekTable = false;
 };
 
 class Decompressor
@@ -67,10 +108,19 @@ public:
   virtual bool Recompress(Compressor *comp) = 0;
   virtual bool Read(void *data, uint64_t numBytes) = 0;
 
+  // provide the block offsets from a seek table, so that Skip() can seek directly in the compressed
+  // data. The table is ignored and false is returned if it isn't compatible with this decompressor.
+  virtual bool SetSeekTable(uint64_t blockSize, rdcarray<uint64_t> &&blockOffsets) { return false; }
+  bool CanSkip() const { return !m_SeekTable.empty(); }
+  // skip forward in the uncompressed data. Only valid to call if CanSkip() returns true.
+  virtual bool Skip(uint64_t numBytes) { return false; }
+
 protected:
   StreamReader *m_Read;
   Ownership m_Ownership;
   RDResult m_Error;
+
+  rdcarray<uint64_t> m_SeekTable;
 };
 
 class StreamReader
@@ -84,6 +134,10 @@ public:
   {
     DummyStream
   };
+  enum StreamMappedType
+  {
+    MappedStream
+  };
 
   StreamReader(StreamInvalidType, RDResult res);
   StreamReader(StreamDummyType);
@@ -96,9 +150,18 @@ public:
   StreamReader(StreamReader *reader, uint64_t bufferSize);
   StreamReader(Decompressor *decompressor, uint64_t uncompressedSize, Ownership own);
 
+  // reads [offset, offset+size) from the file through a read-only memory mapping, so the whole
+  // range behaves like an in-memory buffer without copying it. Sub-readers created from a mapped
+  // reader share the mapping rather than copying. If the file can't be mapped this falls back to
+  // reading normally, and the file is left positioned at offset. The file handle is not retained
+  // by a mapped reader and it can be closed while the reader is alive.
+  StreamReader(StreamMappedType, FILE *file, uint64_t offset, uint64_t size);
+
   ~StreamReader();
 
   bool IsErrored() { return m_Error != ResultCode::Succeeded; }
+  bool IsMapped() { return m_Mapping != NULL; }
+  FileMapping *GetMapping() { return m_Mapping; }
   RDResult GetError() { return m_Error; }
   void SetError(RDResult res)
   {
@@ -232,6 +295,24 @@ public:
       return true;
     }
 
+    // similarly if the decompressor can seek, exhaust the buffer and skip in the decompressor
+    if(m_Decompressor && numBytes > Available() && GetOffset() + numBytes <= GetSize() &&
+       m_Decompressor->CanSkip())
+    {
+      numBytes -= Available();
+      Read(NULL, Available());
+
+      if(!m_Decompressor->Skip(numBytes))
+      {
+        m_Error = m_Decompressor->GetError();
+        return false;
+      }
+
+      m_ReadOffset += numBytes;
+
+      return true;
+    }
+
     return Read(NULL, numBytes);
   }
 
@@ -242,6 +323,20 @@ public:
     return Read(&data, sizeof(T));
   }
 
+  // if the stream is entirely in memory, return a pointer to the next numBytes and advance past
+  // them as if they'd been read. Otherwise (or on error) returns NULL without reading anything and
+  // the caller should fall back to Read(). The data stays valid as long as the stream.
+  const byte *ReadInPlace(uint64_t numBytes)
+  {
+    if(m_File || m_Sock || m_Decompressor || m_Dummy || !m_BufferBase || IsErrored() ||
+       GetOffset() + numBytes > GetSize())
+      return NULL;
+
+    const byte *ret = m_BufferHead;
+    m_BufferHead += numBytes;
+    return ret;
+  }
+
   void AddCloseCallback(StreamCloseCallback callback) { m_Callbacks.push_back(callback); }
 private:
   inline uint64_t Available()
@@ -280,6 +375,9 @@ private:
   // the offset in the file/decompressor that corresponds to the start of m_BufferBase
   uint64_t m_ReadOffset = 0;
 
+  // the shared file mapping if m_BufferBase points into one, instead of being our own allocation
+  FileMapping *m_Mapping = NULL;
+
   // result indicating if an error has been encountered and the stream is now invalid, with details
   // of what happened
   RDResult m_Error;
@@ -299,19 +397,42 @@ private:
 class FileWriter
 {
 public:
+  // counters to show how often writers had to wait, e.g. because the disk isn't keeping up
+  struct Stats
+  {
+    // total bytes written to the file
+    uint64_t bytesWritten;
+    // number of writes to the underlying file
+    uint64_t fileWrites;
+    // number of Write() calls that found the ring full and had to wait for the disk
+    uint64_t ringFullWaits;
+    // number of Write() calls that had to wait for an earlier Write() on another thread to finish
+    // copying before their data could be made visible
+    uint64_t orderingWaits;
+  };
+
+  static const uint64_t DefaultBlockSize = 4 * 1024 * 1024;
+
   static FileWriter *MakeDefault(FILE *file, Ownership own);
-  static FileWriter *MakeThreaded(FILE *file, Ownership own);
+  static FileWriter *MakeThreaded(FILE *file, Ownership own, uint64_t blockSize = DefaultBlockSize);
 
   ~FileWriter();
 
+  // in threaded mode this can be called from multiple threads at once. Each call's data is written
+  // contiguously, ordered by when the call started.
   RDResult Write(const void *data, uint64_t length);
+  // ensures everything written so far is in the file. Must not be called concurrently with Write()
+  // from other threads
   RDResult Flush();
 
+  Stats GetStats();
+
 private:
   FileWriter(FILE *file, Ownership own) : m_File(file), m_Ownership(own) {}
   RDResult WriteThreaded(const void *data, uint64_t length);
   RDResult WriteUnthreaded(const void *data, uint64_t length);
   void ThreadEntry();
+  RDResult GetError();
 
   FILE *m_File;
 
@@ -319,31 +440,42 @@ private:
   // cleaning it up?
   Ownership m_Ownership;
 
-  static const uint64_t BlockSize = 4 * 1024 * 1024;
   static const uint64_t NumBlocks = 8;
 
-  // <base_pointer, byte_offset/size>
-  using Block = rdcpair<byte *, uint64_t>;
-
   int32_t m_ThreadRunning = 0;
   int32_t m_ThreadKill = 0;
   Threading::ThreadHandle m_Thread = 0;
 
-  // only touched by the producer, set of blocks allocated for easy cleanup. These blocks are in at
-  // most one of the arrays below
-  Block m_AllocBlocks[NumBlocks] = {};
-
-  // list of blocks the producer owns. The last in this list is the one we're writing to currently
-  rdcarray<Block> m_ProducerOwned;
-  // list of blocks the consumer owns. This list is being churned through on the work thread
-  rdcarray<Block> m_ConsumerOwned;
-
-  // the lock protects everything below
+  // In threaded mode data goes through a ring of NumBlocks * m_BlockSize bytes. Producers claim a
+  // range of the output stream, copy into the ring, then publish it in order. The work thread
+  // writes published data to the file a block at a time (or less when flushing), which frees that
+  // space in the ring for producers to reuse.
+  //
+  // The positions below are in the output stream and only ever increase, a position's location in
+  // the ring is pos % m_RingSize. They are only accessed atomically. m_WrittenPos <= m_CommitPos <=
+  // m_ReservePos, and producers only copy to positions before m_WrittenPos + m_RingSize.
+  uint64_t m_BlockSize = 0;
+  uint64_t m_RingSize = 0;
+  byte *m_Ring = NULL;
+
+  // the end of the last range claimed by a producer
+  int64_t m_ReservePos = 0;
+  // everything before this has been copied into the ring and can be written to the file
+  int64_t m_CommitPos = 0;
+  // everything before this is in the file, and its space in the ring can be reused
+  int64_t m_WrittenPos = 0;
+  // the work thread writes partial blocks until it has reached this position
+  int64_t m_FlushPos = 0;
+
+  int64_t m_StatBytesWritten = 0;
+  int64_t m_StatFileWrites = 0;
+  int64_t m_StatRingFullWaits = 0;
+  int64_t m_StatOrderingWaits = 0;
+
+  // set once m_Error has been set, so producers can check for errors without locking
+  int32_t m_Errored = 0;
+  // the lock protects m_Error
   Threading::SpinLock m_Lock;
-  // work to be pushed onto m_ConsumerOwned from the producer
-  rdcarray<Block> m_PendingForConsumer;
-  // blocks that can be pulled into m_ProducerOwned by the producer
-  rdcarray<Block> m_CompletedFromConsumer;
   // any error that has appeared
   RDResult m_Error;
 };
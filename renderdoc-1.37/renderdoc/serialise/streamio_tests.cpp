@@ -170,6 +170,127 @@ TEST_CASE("Test stream I/O with invalid/broken outputs", "[streamio]")
   };
 };
 
+TEST_CASE("Test memory-mapped stream reading", "[streamio]")
+{
+  rdcstr filename = FileIO::GetTempFolderFilename() + "/mapped_scratch.bin";
+
+  rdcarray<uint32_t> data;
+  data.resize(100000);
+  for(size_t i = 0; i < data.size(); i++)
+    data[i] = uint32_t(i * 2654435761U);
+
+  // write some leading bytes so the mapped range doesn't start on a page boundary
+  const uint64_t offset = 1234;
+  const uint64_t size = data.byteSize() - 400;
+
+  {
+    FILE *f = FileIO::fopen(filename, FileIO::WriteBinary);
+    REQUIRE(f);
+    byte prefix[offset] = {};
+    FileIO::fwrite(prefix, 1, sizeof(prefix), f);
+    FileIO::fwrite(data.data(), 1, (size_t)data.byteSize(), f);
+    FileIO::fclose(f);
+  }
+
+  FILE *f = FileIO::fopen(filename, FileIO::ReadBinary);
+  REQUIRE(f);
+
+  StreamReader *reader = new StreamReader(StreamReader::MappedStream, f, offset, size);
+
+  // the reader doesn't need the file once it's mapped
+  FileIO::fclose(f);
+
+  CHECK_FALSE(reader->IsErrored());
+  CHECK(reader->IsMapped());
+  CHECK(reader->GetSize() == size);
+
+  uint32_t val = 0;
+  reader->Read(val);
+  CHECK(val == data[0]);
+  reader->Read(val);
+  CHECK(val == data[1]);
+
+  // mapped readers can seek like in-memory readers
+  reader->SetOffset(400);
+  reader->Read(val);
+  CHECK(val == data[100]);
+
+  const byte *inplace = reader->ReadInPlace(4000);
+  REQUIRE(inplace);
+  CHECK(memcmp(inplace, &data[101], 4000) == 0);
+  CHECK(reader->GetOffset() == 4404);
+
+  SECTION("Sub-readers share the mapping")
+  {
+    StreamReader *sub = new StreamReader(reader, 40000);
+
+    CHECK(sub->IsMapped());
+    CHECK(sub->GetSize() == 40000);
+    CHECK(reader->GetOffset() == 44404);
+
+    // the sub-reader keeps the mapping alive after its parent is gone
+    delete reader;
+    reader = NULL;
+
+    rdcarray<uint32_t> readback;
+    readback.resize(10000);
+    sub->Read(readback.data(), readback.byteSize());
+    CHECK_FALSE(sub->IsErrored());
+    CHECK(memcmp(readback.data(), &data[1101], (size_t)readback.byteSize()) == 0);
+    CHECK(sub->AtEnd());
+
+    delete sub;
+  }
+
+  SECTION("Detached mappings are unaffected by the file changing")
+  {
+    if(FileIO::CanDetachFileRange())
+    {
+      FileMapping *mapping = reader->GetMapping();
+      REQUIRE(mapping);
+      REQUIRE(FileIO::DetachFileRange(mapping->data, mapping->size));
+
+      // overwrite the start of the range and truncate the rest
+      FILE *w = FileIO::fopen(filename, FileIO::UpdateBinary);
+      REQUIRE(w);
+      byte junk[4096];
+      memset(junk, 0xcc, sizeof(junk));
+      FileIO::fseek64(w, offset, SEEK_SET);
+      FileIO::fwrite(junk, 1, sizeof(junk), w);
+      FileIO::ftruncateat(w, offset + 8192);
+      FileIO::fclose(w);
+
+      rdcarray<uint32_t> readback;
+      readback.resize(size_t(size / sizeof(uint32_t)));
+
+      reader->SetOffset(0);
+      reader->Read(readback.data(), readback.byteSize());
+      CHECK_FALSE(reader->IsErrored());
+      CHECK(memcmp(readback.data(), data.data(), (size_t)readback.byteSize()) == 0);
+    }
+  }
+
+  SECTION("Reading past the end errors")
+  {
+    EXPECT_ERROR();
+
+    CHECK(reader->ReadInPlace(size) == NULL);
+    CHECK_FALSE(reader->IsErrored());
+
+    reader->SkipBytes(size - reader->GetOffset());
+    CHECK(reader->AtEnd());
+
+    reader->Read(val);
+    CHECK(val == 0);
+    CHECK(reader->IsErrored());
+    CHECK(DID_ERROR_HAPPEN());
+  }
+
+  delete reader;
+
+  FileIO::Delete(filename);
+};
+
 TEST_CASE("Test stream I/O operations over the network", "[streamio][network]")
 {
   uint16_t port = 8235;
@@ -382,4 +503,150 @@ TEST_CASE("Test stream I/O operations over the network", "[streamio][network]")
   delete server;
 };
 
+// writes records of varying size from several threads at once, each record tagged with the thread
+// and a sequence number so that the output can be checked for torn or misordered writes
+static void WriteRecordsThreaded(FileWriter *writer, uint32_t numThreads, uint32_t recordsPerThread,
+                                 uint32_t maxRecordSize)
+{
+  rdcarray<Threading::ThreadHandle> threads;
+
+  for(uint32_t t = 0; t < numThreads; t++)
+  {
+    threads.push_back(
+        Threading::CreateThread([writer, t, recordsPerThread, maxRecordSize]() {
+          rdcarray<uint32_t> record;
+          for(uint32_t i = 0; i < recordsPerThread; i++)
+          {
+            // [size, thread, sequence, payload...] with the payload derived from the header
+            uint32_t size = 3 + ((i * 7919 + t * 104729) % (maxRecordSize / 4 - 3));
+            record.resize(size);
+            record[0] = size;
+            record[1] = t;
+            record[2] = i;
+            for(uint32_t x = 3; x < size; x++)
+              record[x] = t ^ (i * x);
+
+            writer->Write(record.data(), record.byteSize());
+          }
+        }));
+  }
+
+  for(Threading::ThreadHandle th : threads)
+  {
+    Threading::JoinThread(th);
+    Threading::CloseThread(th);
+  }
+}
+
+TEST_CASE("Test threaded file writer with multiple producers", "[streamio]")
+{
+  rdcstr filename = FileIO::GetTempFolderFilename() + "/filewriter_scratch.bin";
+
+  const uint32_t numThreads = 4;
+  const uint32_t recordsPerThread = 250;
+
+  // use a small block size so that the ring wraps and fills up often, and some records are larger
+  // than the whole ring
+  FileWriter *writer =
+      FileWriter::MakeThreaded(FileIO::fopen(filename, FileIO::WriteBinary), Ownership::Stream, 4096);
+  REQUIRE(writer);
+
+  WriteRecordsThreaded(writer, numThreads, recordsPerThread, 40 * 1024);
+
+  CHECK(writer->Flush().code == ResultCode::Succeeded);
+
+  FileWriter::Stats stats = writer->GetStats();
+
+  delete writer;
+
+  FILE *f = FileIO::fopen(filename, FileIO::ReadBinary);
+  REQUIRE(f);
+
+  StreamReader reader(f);
+
+  CHECK(stats.bytesWritten == reader.GetSize());
+  CHECK(stats.fileWrites > 0);
+
+  uint32_t nextSequence[numThreads] = {};
+
+  rdcarray<uint32_t> record;
+  uint32_t numRecords = 0;
+  bool allValid = true;
+  while(!reader.AtEnd() && !reader.IsErrored())
+  {
+    uint32_t size = 0;
+    reader.Read(size);
+    REQUIRE(size >= 3);
+
+    record.resize(size);
+    record[0] = size;
+    reader.Read(&record[1], (size - 1) * sizeof(uint32_t));
+
+    uint32_t t = record[1];
+    REQUIRE(t < numThreads);
+
+    // each thread's records should be in order and intact
+    CHECK(record[2] == nextSequence[t]);
+    nextSequence[t] = record[2] + 1;
+
+    for(uint32_t x = 3; x < size; x++)
+      allValid &= (record[x] == (t ^ (record[2] * x)));
+
+    numRecords++;
+  }
+
+  CHECK_FALSE(reader.IsErrored());
+  CHECK(allValid);
+  CHECK(numRecords == numThreads * recordsPerThread);
+
+  for(uint32_t t = 0; t < numThreads; t++)
+    CHECK(nextSequence[t] == recordsPerThread);
+
+  FileIO::Delete(filename);
+};
+
+TEST_CASE("Benchmark threaded file writer", "[streamio][!benchmark]")
+{
+  rdcstr filename = FileIO::GetTempFolderFilename() + "/filewriter_bench.bin";
+
+  const uint64_t totalSize = 256 * 1024 * 1024;
+  const uint32_t recordSize = 16 * 1024;
+
+  const uint64_t blockSizes[] = {64 * 1024, 1024 * 1024, FileWriter::DefaultBlockSize};
+  const uint32_t threadCounts[] = {1, 2, 4};
+
+  RDCLOG("Threaded FileWriter throughput, %llu MB in %u byte writes", totalSize / (1024 * 1024),
+         recordSize);
+
+  for(uint64_t blockSize : blockSizes)
+  {
+    for(uint32_t numThreads : threadCounts)
+    {
+      FileWriter *writer = FileWriter::MakeThreaded(FileIO::fopen(filename, FileIO::WriteBinary),
+                                                    Ownership::Stream, blockSize);
+      REQUIRE(writer);
+
+      PerformanceTimer timer;
+
+      WriteRecordsThreaded(writer, numThreads, uint32_t(totalSize / recordSize / numThreads),
+                           recordSize);
+      writer->Flush();
+
+      double ms = timer.GetMilliseconds();
+
+      FileWriter::Stats stats = writer->GetStats();
+
+      delete writer;
+
+      RDCLOG("  block %6llu KB, %u threads: %8.1f MB/s (%llu file writes, %llu ring full waits, "
+             "%llu ordering waits)",
+             blockSize / 1024, numThreads,
+             double(stats.bytesWritten) / (1024.0 * 1024.0) / (ms / 1000.0), stats.fileWrites,
+             stats.ringFullWaits, stats.orderingWaits);
+    }
+  }
+
+  FileIO::Delete(filename);
+};
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -28,8 +28,44 @@
 static const uint64_t zstdBlockSize = 128 * 1024;
 static const uint64_t compressBlockSize = ZSTD_compressBound(zstdBlockSize);
 
-ZSTDCompressor::ZSTDCompressor(StreamWriter *write, Ownership own) : Compressor(write, own)
+static const int zstdCompressionLevel = 7;
+
+ZSTDCompressor::ZSTDCompressor(StreamWriter *write, Ownership own, uint32_t numThreads)
+    : Compressor(write, own)
 {
+  if(numThreads > 0)
+  {
+    m_Page = m_CompressBuffer = NULL;
+    m_PageOffset = 0;
+    m_Stream = NULL;
+
+    m_Pool = new BlockWorkerPool(
+        numThreads, zstdBlockSize, compressBlockSize,
+        [this](uint32_t slotIndex, BlockWorkerPool::Block &block) {
+          RDResult ret;
+
+          size_t size = ZSTD_compressCCtx(m_WorkerContexts[slotIndex], block.dst,
+                                          (size_t)compressBlockSize, block.src,
+                                          (size_t)block.srcSize, zstdCompressionLevel);
+
+          if(ZSTD_isError(size))
+            SET_ERROR_RESULT(ret, ResultCode::CompressionFailed, "ZSTD compression failed: %s",
+                             ZSTD_getErrorName(size));
+          else
+            block.dstSize = size;
+
+          return ret;
+        });
+
+    // each slot has its own context, since blocks in different slots are compressed concurrently
+    m_WorkerContexts.resize(m_Pool->NumSlots());
+    for(ZSTD_CCtx *&ctx : m_WorkerContexts)
+      ctx = ZSTD_createCCtx();
+
+    AcquirePage();
+    return;
+  }
+
   m_Page = AllocAlignedBuffer(zstdBlockSize);
   m_CompressBuffer = AllocAlignedBuffer(compressBlockSize);
 
@@ -40,6 +76,20 @@ ZSTDCompressor::ZSTDCompressor(StreamWriter *write, Ownership own) : Compressor(
 
 ZSTDCompressor::~ZSTDCompressor()
 {
+  if(m_Pool)
+  {
+    // in the serial path any full pages are written as soon as they're flushed, so do the same
+    // here if Finish() wasn't called.
+    while(m_Page && m_Pool->InFlight() > 0)
+      WriteOldestBlock();
+
+    // the pages are owned by the pool. Destroy it first so no jobs are using the contexts
+    delete m_Pool;
+    for(ZSTD_CCtx *ctx : m_WorkerContexts)
+      ZSTD_freeCCtx(ctx);
+    return;
+  }
+
   ZSTD_freeCStream(m_Stream);
 
   FreeAlignedBuffer(m_Page);
@@ -49,7 +99,7 @@ ZSTDCompressor::~ZSTDCompressor()
 bool ZSTDCompressor::Write(const void *data, uint64_t numBytes)
 {
   // if we encountered a stream error this will be NULL
-  if(!m_CompressBuffer)
+  if(!m_Page)
     return false;
 
   if(numBytes == 0)
@@ -112,15 +162,33 @@ bool ZSTDCompressor::Finish()
   // only the last one can be smaller, so we only write a partial page when finishing.
   // Calling Write() after Finish() is illegal
 
-  return FlushPage();
+  bool success = FlushPage();
+
+  // when compressing in parallel, wait for all frames to be written out
+  while(success && m_Pool && m_Pool->InFlight() > 0)
+    success &= WriteOldestBlock();
+
+  if(success)
+    success &= WriteSeekTable(zstdBlockSize);
+
+  return success;
 }
 
 bool ZSTDCompressor::FlushPage()
 {
   // if we encountered a stream error this will be NULL
-  if(!m_CompressBuffer)
+  if(!m_Page)
     return false;
 
+  if(m_Pool)
+  {
+    // submit this page to be compressed and start on the next one
+    m_CurBlock->srcSize = m_PageOffset;
+    m_Pool->Submit();
+
+    return AcquirePage();
+  }
+
   ZSTD_inBuffer in = {m_Page, (size_t)m_PageOffset, 0};
   ZSTD_outBuffer out = {m_CompressBuffer, ZSTD_CStreamOutSize(), 0};
 
@@ -134,6 +202,7 @@ bool ZSTDCompressor::FlushPage()
 
   // a bit redundant to write this but it means we can read the entire frame without
   // doing multiple reads
+  m_BlockOffsets.push_back(m_Write->GetOffset());
   success &= m_Write->Write((uint32_t)out.pos);
   success &= m_Write->Write(m_CompressBuffer, out.pos);
 
@@ -143,9 +212,50 @@ bool ZSTDCompressor::FlushPage()
   return success;
 }
 
+bool ZSTDCompressor::AcquirePage()
+{
+  // if every block is in flight, the oldest must be written out before we can reuse it
+  if(m_Pool->Full() && !WriteOldestBlock())
+    return false;
+
+  m_CurBlock = &m_Pool->Acquire();
+  m_Page = m_CurBlock->src;
+  m_PageOffset = 0;
+
+  return true;
+}
+
+bool ZSTDCompressor::WriteOldestBlock()
+{
+  BlockWorkerPool::Block *block = m_Pool->Oldest();
+
+  bool success = true;
+
+  if(block->error != ResultCode::Succeeded)
+  {
+    m_Error = block->error;
+    success = false;
+  }
+  else
+  {
+    m_BlockOffsets.push_back(m_Write->GetOffset());
+    success &= m_Write->Write((uint32_t)block->dstSize);
+    success &= m_Write->Write(block->dst, block->dstSize);
+    if(!success)
+      m_Error = m_Write->GetError();
+  }
+
+  m_Pool->Retire();
+
+  if(!success)
+    m_Page = NULL;
+
+  return success;
+}
+
 bool ZSTDCompressor::CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out)
 {
-  size_t err = ZSTD_initCStream(m_Stream, 7);
+  size_t err = ZSTD_initCStream(m_Stream, zstdCompressionLevel);
 
   if(ZSTD_isError(err))
   {
@@ -199,8 +309,40 @@ bool ZSTDCompressor::CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out)
   return true;
 }
 
-ZSTDDecompressor::ZSTDDecompressor(StreamReader *read, Ownership own) : Decompressor(read, own)
+ZSTDDecompressor::ZSTDDecompressor(StreamReader *read, Ownership own, uint32_t numThreads)
+    : Decompressor(read, own)
 {
+  if(numThreads > 0)
+  {
+    m_Page = m_CompressBuffer = NULL;
+    m_PageOffset = 0;
+    m_PageLength = 0;
+    m_Stream = NULL;
+
+    m_Pool = new BlockWorkerPool(
+        numThreads, compressBlockSize, zstdBlockSize,
+        [this](uint32_t slotIndex, BlockWorkerPool::Block &block) {
+          RDResult ret;
+
+          size_t size = ZSTD_decompressDCtx(m_WorkerContexts[slotIndex], block.dst,
+                                            (size_t)zstdBlockSize, block.src, (size_t)block.srcSize);
+
+          if(ZSTD_isError(size))
+            SET_ERROR_RESULT(ret, ResultCode::CompressionFailed, "ZSTD decompression failed: %s",
+                             ZSTD_getErrorName(size));
+          else
+            block.dstSize = size;
+
+          return ret;
+        });
+
+    m_WorkerContexts.resize(m_Pool->NumSlots());
+    for(ZSTD_DCtx *&ctx : m_WorkerContexts)
+      ctx = ZSTD_createDCtx();
+
+    return;
+  }
+
   m_Page = AllocAlignedBuffer(zstdBlockSize);
   m_CompressBuffer = AllocAlignedBuffer(compressBlockSize);
 
@@ -212,16 +354,37 @@ ZSTDDecompressor::ZSTDDecompressor(StreamReader *read, Ownership own) : Decompre
 
 ZSTDDecompressor::~ZSTDDecompressor()
 {
+  if(m_Pool || !m_WorkerContexts.empty())
+  {
+    // the pages are owned by the pool. Destroy it first so no jobs are using the contexts
+    delete m_Pool;
+    for(ZSTD_DCtx *ctx : m_WorkerContexts)
+      ZSTD_freeDCtx(ctx);
+    return;
+  }
+
   ZSTD_freeDStream(m_Stream);
   FreeAlignedBuffer(m_Page);
   FreeAlignedBuffer(m_CompressBuffer);
 }
 
+bool ZSTDDecompressor::NoMoreBlocks()
+{
+  if(m_Pool)
+  {
+    // frames may still be in flight after we've read all the compressed data. The current page
+    // counts as in flight until the next page is filled
+    return m_Read->AtEnd() && m_Pool->InFlight() <= (m_Page ? 1U : 0U);
+  }
+
+  return m_Read->AtEnd();
+}
+
 bool ZSTDDecompressor::Recompress(Compressor *comp)
 {
   bool success = true;
 
-  while(success && !m_Read->AtEnd())
+  while(success && !NoMoreBlocks())
   {
     success &= FillPage();
     if(success)
@@ -239,8 +402,8 @@ bool ZSTDDecompressor::Recompress(Compressor *comp)
 
 bool ZSTDDecompressor::Read(void *data, uint64_t numBytes)
 {
-  // if we encountered a stream error this will be NULL
-  if(!m_CompressBuffer)
+  // if we encountered a stream error these will be NULL
+  if(!m_CompressBuffer && !m_Pool)
     return false;
 
   if(numBytes == 0)
@@ -298,6 +461,9 @@ bool ZSTDDecompressor::Read(void *data, uint64_t numBytes)
 
 bool ZSTDDecompressor::FillPage()
 {
+  if(m_Pool)
+    return FillPageParallel();
+
   uint32_t compSize = 0;
 
   bool success = true;
@@ -352,8 +518,161 @@ bool ZSTDDecompressor::FillPage()
     }
   }
 
+  m_PageStart += m_PageLength;
+  m_NextBlock++;
+
   m_PageOffset = 0;
   m_PageLength = out.pos;
 
   return success;
 }
+
+bool ZSTDDecompressor::FillPageParallel()
+{
+  // the current page is in the oldest block, which we're now finished with
+  if(m_Page)
+    m_Pool->Retire();
+  m_Page = NULL;
+
+  // read ahead as many compressed frames as we have room for, so they can be decompressed
+  // while we consume this one
+  while(!m_Pool->Full() && !m_Read->AtEnd())
+  {
+    BlockWorkerPool::Block &block = m_Pool->Acquire();
+
+    uint32_t compSize = 0;
+
+    bool success = m_Read->Read(compSize);
+    if(!success)
+    {
+      SetParallelError(m_Read->GetError());
+      return false;
+    }
+
+    if(compSize > m_Pool->SourceCapacity())
+    {
+      RDResult error;
+      SET_ERROR_RESULT(error, ResultCode::CompressionFailed,
+                       "ZSTD decompression encountered invalid compressed frame size: %u", compSize);
+      SetParallelError(error);
+      return false;
+    }
+
+    success = m_Read->Read(block.src, compSize);
+    if(!success)
+    {
+      SetParallelError(m_Read->GetError());
+      return false;
+    }
+
+    block.srcSize = compSize;
+    m_Pool->Submit();
+
+    m_NextBlock++;
+  }
+
+  BlockWorkerPool::Block *block = m_Pool->Oldest();
+
+  if(!block)
+  {
+    RDResult error;
+    SET_ERROR_RESULT(error, ResultCode::CompressionFailed,
+                     "ZSTD decompression ran out of compressed frames");
+    SetParallelError(error);
+    return false;
+  }
+
+  if(block->error != ResultCode::Succeeded)
+  {
+    SetParallelError(block->error);
+    return false;
+  }
+
+  m_Page = block->dst;
+  m_PageStart += m_PageLength;
+  m_PageOffset = 0;
+  m_PageLength = block->dstSize;
+
+  return true;
+}
+
+void ZSTDDecompressor::SetParallelError(RDResult error)
+{
+  m_Error = error;
+
+  // the worker contexts are freed in the destructor
+  delete m_Pool;
+  m_Pool = NULL;
+  m_Page = NULL;
+}
+
+bool ZSTDDecompressor::SetSeekTable(uint64_t blockSize, rdcarray<uint64_t> &&blockOffsets)
+{
+  if(blockSize != zstdBlockSize)
+    return false;
+
+  m_SeekTable = std::move(blockOffsets);
+  return true;
+}
+
+bool ZSTDDecompressor::Skip(uint64_t numBytes)
+{
+  // if we encountered a stream error these will be NULL
+  if(!m_CompressBuffer && !m_Pool)
+    return false;
+
+  const uint64_t target = m_PageStart + m_PageOffset + numBytes;
+
+  // if the target is in the current page, just move within it
+  if(target <= m_PageStart + m_PageLength)
+  {
+    m_PageOffset = target - m_PageStart;
+    return true;
+  }
+
+  const uint64_t block = target / zstdBlockSize;
+
+  if(block >= m_SeekTable.size())
+  {
+    SET_ERROR_RESULT(m_Error, ResultCode::CompressionFailed,
+                     "Skipping to offset %llu is past the end of the seek table", target);
+    return false;
+  }
+
+  // blocks that were already read from the stream (e.g. read ahead for parallel decompression)
+  // can't be skipped over in the underlying stream, so in that case we decompress until we reach
+  // the target. Otherwise we can seek directly to the block containing the target.
+  if(block >= m_NextBlock)
+  {
+    if(m_Pool)
+    {
+      // discard any blocks in flight, waiting for their jobs to finish with them first
+      while(m_Pool->Oldest())
+        m_Pool->Retire();
+      m_Page = NULL;
+    }
+
+    if(!m_Read->SkipBytes(m_SeekTable[(size_t)block] - m_Read->GetOffset()))
+    {
+      m_Error = m_Read->GetError();
+      return false;
+    }
+
+    m_NextBlock = block;
+    m_PageStart = block * zstdBlockSize;
+    m_PageOffset = m_PageLength = 0;
+
+    if(!FillPage())
+      return false;
+  }
+
+  while(target > m_PageStart + m_PageLength)
+  {
+    if(!FillPage())
+      return false;
+  }
+
+  m_PageOffset = target - m_PageStart;
+
+  return true;
+}
@@ -25,12 +25,16 @@
 #pragma once
 
 #include "zstd/zstd.h"
+#include "blockpool.h"
 #include "streamio.h"
 
 class ZSTDCompressor : public Compressor
 {
 public:
-  ZSTDCompressor(StreamWriter *write, Ownership own);
+  // if numThreads is non-zero, pages are compressed as jobs, with enough in flight to keep that
+  // many threads busy. Each page is always its own frame, so the output format is the same in
+  // either mode.
+  ZSTDCompressor(StreamWriter *write, Ownership own, uint32_t numThreads = 0);
   ~ZSTDCompressor();
 
   bool Write(const void *data, uint64_t numBytes);
@@ -38,6 +42,8 @@ public:
 
 private:
   bool FlushPage();
+  bool AcquirePage();
+  bool WriteOldestBlock();
 
   bool CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out);
 
@@ -46,24 +52,46 @@ private:
   uint64_t m_PageOffset;
 
   ZSTD_CStream *m_Stream;
+
+  // only used when compressing in parallel. m_Page then points into m_CurBlock
+  BlockWorkerPool *m_Pool = NULL;
+  BlockWorkerPool::Block *m_CurBlock = NULL;
+  rdcarray<ZSTD_CCtx *> m_WorkerContexts;
 };
 
 class ZSTDDecompressor : public Decompressor
 {
 public:
-  ZSTDDecompressor(StreamReader *read, Ownership own);
+  // if numThreads is non-zero, pages are read ahead and decompressed as jobs, with enough in flight
+  // to keep that many threads busy.
+  ZSTDDecompressor(StreamReader *read, Ownership own, uint32_t numThreads = 0);
   ~ZSTDDecompressor();
 
   bool Recompress(Compressor *comp);
   bool Read(void *data, uint64_t numBytes);
 
+  bool SetSeekTable(uint64_t blockSize, rdcarray<uint64_t> &&blockOffsets);
+  bool Skip(uint64_t numBytes);
+
 private:
   bool FillPage();
+  bool FillPageParallel();
+  bool NoMoreBlocks();
+  void SetParallelError(RDResult error);
 
   byte *m_Page;
   byte *m_CompressBuffer;
   uint64_t m_PageOffset;
   uint64_t m_PageLength;
 
+  // the uncompressed offset of the start of the current page, and the index of the next block to be
+  // read from the compressed stream. Used for skipping with a seek table
+  uint64_t m_PageStart = 0;
+  uint64_t m_NextBlock = 0;
+
   ZSTD_DStream *m_Stream;
+
+  // only used when decompressing in parallel. m_Page then points into the oldest block
+  BlockWorkerPool *m_Pool = NULL;
+  rdcarray<ZSTD_DCtx *> m_WorkerContexts;
 };
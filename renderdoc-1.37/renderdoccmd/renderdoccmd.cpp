@@ -58,6 +58,9 @@ inline std::ostream &operator<<(std::ostream &os, rdcstr const &str)
 
 #include <replay/renderdoc_tostr.inl>
 
+// PipeState is implemented inline for each user of the replay API
+#include <replay/pipestate.inl>
+
 bool usingKillSignal = false;
 volatile bool killSignal = false;
 
@@ -124,6 +127,50 @@ void DisplayRendererPreview(IReplayController *renderer, uint32_t width, uint32_
   DisplayRendererPreview(renderer, d, width, height, numLoops);
 }
 
+static uint32_t LastEvent(const rdcarray<ActionDescription> &actions)
+{
+  if(actions.empty())
+    return 0;
+
+  const ActionDescription &last = actions.back();
+  if(!last.children.empty())
+    return LastEvent(last.children);
+
+  return last.eventId;
+}
+
+// opens a capture for local replay, printing an error and returning NULL if it can't be. An eventId
+// of ~0U is replaced with the last event in the frame
+static IReplayController *OpenLocalReplay(const std::string &filename, uint32_t &eventId)
+{
+  ICaptureFile *file = RENDERDOC_OpenCaptureFile();
+
+  ResultDetails res = file->OpenFile(conv(filename), "rdc", NULL);
+
+  if(res.code != ResultCode::Succeeded)
+  {
+    std::cerr << "Couldn't load '" << filename << "': " << res.Message() << std::endl;
+    file->Shutdown();
+    return NULL;
+  }
+
+  IReplayController *renderer = NULL;
+  rdctie(res, renderer) = file->OpenCapture(ReplayOptions(), NULL);
+
+  file->Shutdown();
+
+  if(!res.OK())
+  {
+    std::cerr << "Couldn't load and replay '" << filename << "': " << res.Message() << std::endl;
+    return NULL;
+  }
+
+  if(eventId == ~0U)
+    eventId = LastEvent(renderer->GetRootActions());
+
+  return renderer;
+}
+
 static std::vector<std::string> version_lines;
 
 struct VersionCommand : public Command
@@ -527,6 +574,7 @@ struct ReplayCommand : public Command
 private:
   std::string filename;
   std::string remote_host;
+  std::string job_trace;
   uint32_t width = 0;
   uint32_t height = 0;
   uint32_t loops = 0;
@@ -543,6 +591,11 @@ public:
     parser.add<std::string>("remote-host", 0,
                             "Instead of replaying locally, replay on this host over the network.",
                             false);
+    parser.add<std::string>(
+        "job-trace", 0,
+        "Write a Chrome profiler JSON trace of the replay's worker jobs (e.g. while loading) to "
+        "this path when the replay is closed. Only for local replays.",
+        false);
   }
   virtual const char *Description()
   {
@@ -570,6 +623,17 @@ public:
     if(parser.exist("remote-host"))
       remote_host = parser.get<std::string>("remote-host");
 
+    if(parser.exist("job-trace"))
+    {
+      job_trace = parser.get<std::string>("job-trace");
+
+      if(!remote_host.empty())
+      {
+        std::cerr << "Error: --job-trace is not supported when replaying remotely." << std::endl;
+        return false;
+      }
+    }
+
     width = parser.get<uint32_t>("width");
     height = parser.get<uint32_t>("height");
     loops = parser.get<uint32_t>("loops");
@@ -619,6 +683,13 @@ public:
     {
       std::cout << "Replaying '" << filename << "' locally.." << std::endl;
 
+      if(!job_trace.empty())
+      {
+        SDObject *setting = RENDERDOC_SetConfigSetting("Replay.Debug.JobTracePath");
+        if(setting)
+          setting->data.str = conv(job_trace);
+      }
+
       ICaptureFile *file = RENDERDOC_OpenCaptureFile();
 
       ResultDetails res = file->OpenFile(conv(filename), "rdc", NULL);
@@ -652,6 +723,607 @@ public:
   }
 };
 
+struct SaveTexturesCommand : public Command
+{
+private:
+  struct TextureRequest
+  {
+    std::string id;
+    int32_t mip = 0;
+    int32_t slice = 0;
+  };
+
+  std::string filename;
+  std::string outdir;
+  std::string format;
+  uint32_t eventId = ~0U;
+  std::vector<TextureRequest> requests;
+
+public:
+  SaveTexturesCommand() : Command() {}
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.set_footer("<capture.rdc>");
+    parser.add<std::string>("output", 'o', "The existing directory to save the textures to.", true);
+    parser.add<std::string>("format", 'f', "The file format to save the textures as.", false, "png",
+                            cmdline::oneof<std::string>("png", "jpg", "bmp", "tga", "hdr", "exr",
+                                                        "dds"));
+    parser.add<uint32_t>("event", 'e',
+                         "The event to save the textures at. By default the end of the frame.",
+                         false, ~0U);
+    parser.add<std::string>(
+        "textures", 't',
+        "A comma-separated list of textures to save, each as ID[:mip[:slice]] where ID is the "
+        "number in ResourceId::ID. It is an error if any ID doesn't match a texture. By default "
+        "every color and depth target in the capture is saved, at mip 0 and slice 0.",
+        false, "");
+  }
+  virtual const char *Description()
+  {
+    return "Replay a capture and save textures from it to disk, converting them in parallel.";
+  }
+  virtual bool IsInternalOnly() { return false; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual bool Parse(cmdline::parser &parser, GlobalEnvironment &)
+  {
+    std::vector<std::string> rest = parser.rest();
+    if(rest.empty())
+    {
+      std::cerr << "Error: savetextures command requires a capture filename." << std::endl
+                << std::endl
+                << parser.usage();
+      return false;
+    }
+
+    filename = rest[0];
+
+    rest.erase(rest.begin());
+
+    parser.set_rest(rest);
+
+    outdir = parser.get<std::string>("output");
+    format = parser.get<std::string>("format");
+    eventId = parser.get<uint32_t>("event");
+
+    std::string list = parser.get<std::string>("textures");
+
+    size_t start = 0;
+    while(start < list.size())
+    {
+      size_t end = list.find(',', start);
+      if(end == std::string::npos)
+        end = list.size();
+
+      std::string entry = list.substr(start, end - start);
+      start = end + 1;
+
+      if(entry.empty())
+        continue;
+
+      TextureRequest req;
+
+      size_t colon = entry.find(':');
+      req.id = entry.substr(0, colon);
+
+      if(colon != std::string::npos)
+      {
+        req.mip = atoi(entry.c_str() + colon + 1);
+
+        colon = entry.find(':', colon + 1);
+        if(colon != std::string::npos)
+          req.slice = atoi(entry.c_str() + colon + 1);
+      }
+
+      requests.push_back(req);
+    }
+
+    return true;
+  }
+  virtual int Execute(const CaptureOptions &)
+  {
+    FileType type = FileType::PNG;
+
+    if(format == "jpg")
+      type = FileType::JPG;
+    else if(format == "bmp")
+      type = FileType::BMP;
+    else if(format == "tga")
+      type = FileType::TGA;
+    else if(format == "hdr")
+      type = FileType::HDR;
+    else if(format == "exr")
+      type = FileType::EXR;
+    else if(format == "dds")
+      type = FileType::DDS;
+
+    IReplayController *renderer = OpenLocalReplay(filename, eventId);
+
+    if(!renderer)
+      return 1;
+
+    renderer->SetFrameEvent(eventId, true);
+
+    rdcarray<TextureSave> saves;
+    rdcarray<rdcstr> paths;
+
+    std::vector<bool> matched(requests.size(), false);
+
+    for(const TextureDescription &tex : renderer->GetTextures())
+    {
+      // the number shown in ResourceId::1234
+      uint64_t num = 0;
+      memcpy(&num, &tex.resourceId, sizeof(num));
+      std::string id = std::to_string(num);
+
+      std::vector<TextureRequest> texRequests;
+
+      if(requests.empty())
+      {
+        if(tex.creationFlags & (TextureCategory::ColorTarget | TextureCategory::DepthTarget))
+          texRequests.push_back(TextureRequest());
+      }
+      else
+      {
+        for(size_t i = 0; i < requests.size(); i++)
+        {
+          if(requests[i].id == id)
+          {
+            texRequests.push_back(requests[i]);
+            matched[i] = true;
+          }
+        }
+      }
+
+      for(const TextureRequest &req : texRequests)
+      {
+        TextureSave save;
+        save.resourceId = tex.resourceId;
+        save.destType = type;
+        save.mip = req.mip;
+        save.slice.sliceIndex = req.slice;
+
+        std::string path = outdir + "/" + id;
+        if(req.mip != 0 || req.slice != 0)
+          path += "_mip" + std::to_string(req.mip) + "_slice" + std::to_string(req.slice);
+        path += "." + format;
+
+        saves.push_back(save);
+        paths.push_back(conv(path));
+      }
+    }
+
+    bool missing = false;
+    for(size_t i = 0; i < requests.size(); i++)
+    {
+      if(!matched[i])
+      {
+        std::cerr << "No texture with ID " << requests[i].id << " in '" << filename << "'."
+                  << std::endl;
+        missing = true;
+      }
+    }
+
+    if(missing)
+    {
+      renderer->Shutdown();
+      return 1;
+    }
+
+    std::cout << "Saving " << saves.size() << " textures at event " << eventId << " to '" << outdir
+              << "'." << std::endl;
+
+    ResultDetails res = renderer->SaveTextures(saves, paths);
+
+    renderer->Shutdown();
+
+    if(!res.OK())
+    {
+      std::cerr << "Not all textures could be saved: " << res.Message() << std::endl;
+      return 1;
+    }
+
+    return 0;
+  }
+};
+
+struct ShaderProfileCommand : public Command
+{
+private:
+  std::string filename;
+  std::string outfile;
+  std::string stageName;
+  uint32_t eventId = ~0U;
+  uint32_t maxInvocations = 1024;
+  uint32_t top = 20;
+
+  static const ActionDescription *FindAction(const rdcarray<ActionDescription> &actions,
+                                             uint32_t eventId)
+  {
+    for(const ActionDescription &a : actions)
+    {
+      if(a.eventId == eventId)
+        return &a;
+
+      const ActionDescription *ret = FindAction(a.children, eventId);
+      if(ret)
+        return ret;
+    }
+
+    return NULL;
+  }
+
+  // picks up to maxInvocations threads spread evenly over the whole dispatch
+  void AddThreads(ShaderStage stage, const rdcfixedarray<uint32_t, 3> &groups,
+                  const rdcfixedarray<uint32_t, 3> &threads,
+                  rdcarray<ShaderDebugInvocation> &invocations)
+  {
+    uint64_t groupSize = uint64_t(threads[0]) * threads[1] * threads[2];
+    uint64_t total = groupSize * groups[0] * groups[1] * groups[2];
+
+    if(total == 0)
+      return;
+
+    uint64_t stride = std::max<uint64_t>(1, (total + maxInvocations - 1) / maxInvocations);
+
+    for(uint64_t i = 0; i < total; i += stride)
+    {
+      uint64_t group = i / groupSize;
+      uint64_t thread = i % groupSize;
+
+      ShaderDebugInvocation inv;
+      inv.stage = stage;
+      inv.groupId[0] = uint32_t(group % groups[0]);
+      inv.groupId[1] = uint32_t((group / groups[0]) % groups[1]);
+      inv.groupId[2] = uint32_t(group / (uint64_t(groups[0]) * groups[1]));
+      inv.threadId[0] = uint32_t(thread % threads[0]);
+      inv.threadId[1] = uint32_t((thread / threads[0]) % threads[1]);
+      inv.threadId[2] = uint32_t(thread / (threads[0] * threads[1]));
+      invocations.push_back(inv);
+    }
+  }
+
+  void AddVertices(IReplayController *renderer, const ActionDescription &action,
+                   rdcarray<ShaderDebugInvocation> &invocations)
+  {
+    if(action.numIndices == 0)
+      return;
+
+    uint32_t stride = std::max(1U, (action.numIndices + maxInvocations - 1) / maxInvocations);
+
+    const PipeState &pipe = renderer->GetPipelineState();
+
+    bytebuf indices;
+    uint32_t indexStride = 0;
+    uint32_t restartIndex = ~0U;
+
+    if(action.flags & ActionFlags::Indexed)
+    {
+      BoundVBuffer ib = pipe.GetIBuffer();
+      indexStride = ib.byteStride;
+
+      if(indexStride == 1 || indexStride == 2 || indexStride == 4)
+      {
+        uint64_t offset = ib.byteOffset + uint64_t(action.indexOffset) * indexStride;
+        indices = renderer->GetBufferData(ib.resourceId, offset,
+                                          uint64_t(action.numIndices) * indexStride);
+
+        if(pipe.IsRestartEnabled())
+          restartIndex = pipe.GetRestartIndex() & (0xffffffffU >> (32 - indexStride * 8));
+      }
+      else
+      {
+        indexStride = 0;
+      }
+    }
+
+    for(uint32_t vtx = 0; vtx < action.numIndices; vtx += stride)
+    {
+      ShaderDebugInvocation inv;
+      inv.stage = ShaderStage::Vertex;
+      inv.vertexId = vtx;
+      inv.index = vtx;
+
+      if(action.flags & ActionFlags::Indexed)
+      {
+        if(indexStride == 0 || (vtx + 1) * indexStride > indices.size())
+          break;
+
+        uint32_t idx = 0;
+        memcpy(&idx, indices.data() + vtx * indexStride, indexStride);
+
+        if(idx == restartIndex)
+          continue;
+
+        inv.index = idx + action.baseVertex;
+      }
+
+      invocations.push_back(inv);
+    }
+  }
+
+  void AddPixels(IReplayController *renderer, rdcarray<ShaderDebugInvocation> &invocations)
+  {
+    Viewport vp = renderer->GetPipelineState().GetViewport(0);
+
+    uint32_t x0 = uint32_t(std::max(vp.x, 0.0f));
+    uint32_t y0 = uint32_t(std::max(vp.y, 0.0f));
+    uint32_t w = uint32_t(std::max(vp.width, 0.0f));
+    uint32_t h = uint32_t(std::max(vp.height, 0.0f));
+
+    if(w == 0 || h == 0)
+      return;
+
+    // an evenly spaced grid of pixels. Pixels that the event didn't shade are skipped by the
+    // debugger and counted as failed
+    uint32_t step = 1;
+    while(uint64_t((w + step - 1) / step) * ((h + step - 1) / step) > maxInvocations)
+      step++;
+
+    for(uint32_t y = step / 2; y < h; y += step)
+    {
+      for(uint32_t x = step / 2; x < w; x += step)
+      {
+        ShaderDebugInvocation inv;
+        inv.stage = ShaderStage::Pixel;
+        inv.x = x0 + x;
+        inv.y = y0 + y;
+        invocations.push_back(inv);
+      }
+    }
+  }
+
+  static std::vector<std::string> SplitLines(const rdcstr &text)
+  {
+    std::vector<std::string> ret;
+    std::istringstream stream(std::string(text.c_str(), text.size()));
+    std::string line;
+    while(std::getline(stream, line))
+    {
+      if(!line.empty() && line.back() == '\r')
+        line.pop_back();
+      ret.push_back(line);
+    }
+    return ret;
+  }
+
+public:
+  ShaderProfileCommand() : Command() {}
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.set_footer("<capture.rdc>");
+    parser.add<uint32_t>("event", 'e',
+                         "The event to profile. By default the last action in the frame.", false,
+                         ~0U);
+    parser.add<std::string>(
+        "stage", 's',
+        "The shader stage to profile. By default compute for dispatches, mesh for mesh dispatches "
+        "and pixel for draws.",
+        false, "auto",
+        cmdline::oneof<std::string>("auto", "vertex", "pixel", "compute", "mesh"));
+    parser.add<uint32_t>("max-invocations", 'n',
+                         "The most invocations to debug. They are spread evenly over the event.",
+                         false, 1024);
+    parser.add<uint32_t>("top", 't', "How many of the hottest lines to list first.", false, 20);
+    parser.add<std::string>("output", 'o', "Write the report to a file instead of stdout.", false,
+                            "");
+  }
+  virtual const char *Description()
+  {
+    return "Debug many shader invocations at an event and report execution counts per line.";
+  }
+  virtual bool IsInternalOnly() { return false; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual bool Parse(cmdline::parser &parser, GlobalEnvironment &)
+  {
+    std::vector<std::string> rest = parser.rest();
+    if(rest.empty())
+    {
+      std::cerr << "Error: shaderprofile command requires a capture filename." << std::endl
+                << std::endl
+                << parser.usage();
+      return false;
+    }
+
+    filename = rest[0];
+
+    rest.erase(rest.begin());
+
+    parser.set_rest(rest);
+
+    eventId = parser.get<uint32_t>("event");
+    stageName = parser.get<std::string>("stage");
+    maxInvocations = std::max(1U, parser.get<uint32_t>("max-invocations"));
+    top = parser.get<uint32_t>("top");
+    outfile = parser.get<std::string>("output");
+
+    return true;
+  }
+  virtual int Execute(const CaptureOptions &)
+  {
+    IReplayController *renderer = OpenLocalReplay(filename, eventId);
+
+    if(!renderer)
+      return 1;
+
+    const ActionDescription *action = FindAction(renderer->GetRootActions(), eventId);
+
+    if(!action)
+    {
+      std::cerr << "Event " << eventId << " is not an action." << std::endl;
+      renderer->Shutdown();
+      return 1;
+    }
+
+    renderer->SetFrameEvent(eventId, true);
+
+    ShaderStage stage = ShaderStage::Pixel;
+    if(stageName == "vertex")
+      stage = ShaderStage::Vertex;
+    else if(stageName == "compute")
+      stage = ShaderStage::Compute;
+    else if(stageName == "mesh")
+      stage = ShaderStage::Mesh;
+    else if(stageName == "auto" && (action->flags & ActionFlags::Dispatch))
+      stage = ShaderStage::Compute;
+    else if(stageName == "auto" && (action->flags & ActionFlags::MeshDispatch))
+      stage = ShaderStage::Mesh;
+
+    const PipeState &pipe = renderer->GetPipelineState();
+    const ShaderReflection *refl = pipe.GetShaderReflection(stage);
+
+    if(!refl)
+    {
+      std::cerr << "No " << ToStr(stage) << " shader is bound at event " << eventId << "."
+                << std::endl;
+      renderer->Shutdown();
+      return 1;
+    }
+
+    rdcarray<ShaderDebugInvocation> invocations;
+
+    if(stage == ShaderStage::Compute || stage == ShaderStage::Mesh)
+    {
+      rdcfixedarray<uint32_t, 3> threads = action->dispatchThreadsDimension;
+      if(threads[0] == 0)
+        threads = refl->dispatchThreadsDimension;
+
+      AddThreads(stage, action->dispatchDimension, threads, invocations);
+    }
+    else if(stage == ShaderStage::Vertex)
+    {
+      AddVertices(renderer, *action, invocations);
+    }
+    else
+    {
+      AddPixels(renderer, invocations);
+    }
+
+    if(invocations.empty())
+    {
+      std::cerr << "Event " << eventId << " has no " << ToStr(stage) << " invocations to debug."
+                << std::endl;
+      renderer->Shutdown();
+      return 1;
+    }
+
+    std::cerr << "Debugging " << invocations.size() << " " << ToStr(stage)
+              << " invocations at event " << eventId << "." << std::endl;
+
+    ShaderDebugProfile profile = renderer->ProfileShaderDebug(invocations);
+
+    // the reflection is owned by the replay, so copy out what the report needs before shutting down
+    std::vector<std::string> filenames;
+    std::vector<std::vector<std::string>> sources;
+    for(const ShaderSourceFile &f : refl->debugInfo.files)
+    {
+      filenames.push_back(conv(f.filename));
+      sources.push_back(SplitLines(f.contents));
+    }
+
+    std::vector<std::string> disasm;
+    rdcarray<rdcstr> targets = renderer->GetDisassemblyTargets(true);
+    if(!targets.empty())
+    {
+      ResourceId pipeline = stage == ShaderStage::Compute ? pipe.GetComputePipelineObject()
+                                                          : pipe.GetGraphicsPipelineObject();
+      disasm = SplitLines(renderer->DisassembleShader(pipeline, refl, targets[0]));
+    }
+
+    renderer->Shutdown();
+
+    std::ostringstream report;
+    char buf[512];
+
+    report << "Shader profile of " << ToStr(stage) << " at event " << eventId << " in '"
+           << filename << "'" << std::endl;
+    report << profile.invocations << " invocations debugged, " << profile.failedInvocations
+           << " failed, " << profile.steps << " instructions executed." << std::endl;
+
+    if(profile.invocations == 0)
+    {
+      std::cerr << report.str() << "No invocations could be debugged." << std::endl;
+      return 1;
+    }
+
+    auto location = [&](const ShaderLineProfile &l) {
+      std::string name = "disasm";
+      if(l.fileIndex >= 0 && l.fileIndex < (int32_t)filenames.size())
+        name = filenames[l.fileIndex];
+      return name + ":" + std::to_string(l.line);
+    };
+
+    auto sourceText = [&](const ShaderLineProfile &l) {
+      const std::vector<std::string> *lines = &disasm;
+      if(l.fileIndex >= 0 && l.fileIndex < (int32_t)sources.size())
+        lines = &sources[l.fileIndex];
+      if(l.line == 0 || l.line > lines->size())
+        return std::string();
+      std::string text = (*lines)[l.line - 1];
+      text.erase(0, text.find_first_not_of(" \t"));
+      return text;
+    };
+
+    // a line is divergent if not every invocation reached it, or if they ran it a different number
+    // of times e.g. due to varying loop trip counts
+    auto formatLine = [&](const ShaderLineProfile &l) {
+      bool divergent = l.invocations < profile.invocations || l.minExecutions != l.maxExecutions;
+      snprintf(buf, sizeof(buf), "%-32s %12llu %6.2f%% %6.1f%% %7u %7u %c  ", location(l).c_str(),
+               (unsigned long long)l.executions,
+               100.0 * double(l.executions) / double(profile.steps),
+               100.0 * double(l.invocations) / double(profile.invocations), l.minExecutions,
+               l.maxExecutions, divergent ? '*' : ' ');
+      return std::string(buf) + sourceText(l);
+    };
+
+    snprintf(buf, sizeof(buf), "%-32s %12s %7s %7s %7s %7s %c  %s", "Location", "Executions",
+             "Heat", "Reached", "MinTrip", "MaxTrip", 'D', "Source");
+    std::string header = buf;
+
+    std::vector<const ShaderLineProfile *> hottest;
+    for(const ShaderLineProfile &l : profile.lines)
+      hottest.push_back(&l);
+    std::stable_sort(hottest.begin(), hottest.end(),
+                     [](const ShaderLineProfile *a, const ShaderLineProfile *b) {
+                       return a->executions > b->executions;
+                     });
+    if(hottest.size() > top)
+      hottest.resize(top);
+
+    if(!hottest.empty())
+    {
+      report << std::endl << "Hottest lines:" << std::endl << header << std::endl;
+      for(const ShaderLineProfile *l : hottest)
+        report << formatLine(*l) << std::endl;
+    }
+
+    report << std::endl << "All executed lines:" << std::endl << header << std::endl;
+    for(const ShaderLineProfile &l : profile.lines)
+      report << formatLine(l) << std::endl;
+
+    if(outfile.empty())
+    {
+      std::cout << report.str();
+    }
+    else
+    {
+      FILE *f = fopen(outfile.c_str(), "wb");
+      if(!f)
+      {
+        std::cerr << "Couldn't open '" << outfile << "' for writing." << std::endl;
+        return 1;
+      }
+
+      std::string str = report.str();
+      fwrite(str.c_str(), 1, str.size(), f);
+      fclose(f);
+
+      std::cerr << "Wrote report to '" << outfile << "'." << std::endl;
+    }
+
+    return 0;
+  }
+};
+
 struct formats_reader
 {
   formats_reader(bool input)
@@ -1569,6 +2241,8 @@ int renderdoccmd(GlobalEnvironment &env, std::vector<std::string> &argv)
     add_command("thumb", new ThumbCommand());
     add_command("remoteserver", new RemoteServerCommand());
     add_command("replay", new ReplayCommand());
+    add_command("savetextures", new SaveTexturesCommand());
+    add_command("shaderprofile", new ShaderProfileCommand());
     add_command("capaltbit", new CapAltBitCommand());
     add_command("test", new TestCommand());
     add_command("convert", new ConvertCommand());
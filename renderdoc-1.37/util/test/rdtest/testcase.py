@@ -604,6 +604,15 @@ class TestCase:
 
             cycles = states[-1].stepIndex
 
+        # seeking to the last step rebuilds the state from a checkpoint, and must agree with the
+        # changes applied in order. An empty state means the debugger can't seek
+        seek: rd.ShaderDebugState = self.controller.SeekDebug(trace.debugger, cycles)
+        if seek.stepIndex == cycles and len(seek.changes) > 0:
+            for change in seek.changes:
+                if change.after.name not in variables or variables[change.after.name] != change.after:
+                    raise TestFailureException("Seeking to step {} gives a different value for {}"
+                                               .format(cycles, change.after.name))
+
         return cycles, variables
 
     def get_sig_index(self, signature, builtin: rd.ShaderBuiltin, reg_index: int = -1):